@@ -31,6 +31,8 @@ export USING_GUI_SURFACE=1
 export USING_CAMERA=1
 export USING_MEDIACODEC=0
 export USING_V4L2CODEC=0
+# software v4l2 device on libavcodec (v4l2codec_device_soft.cc), for boards without a v4l2 codec
+export USING_V4L2CODEC_SOFT=0
 ifeq ($(XMAKE_ENABLE_CNTR_HAL),true)
     export USING_MEDIACODEC=1
 else
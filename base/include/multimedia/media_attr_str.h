@@ -164,6 +164,7 @@ namespace YUNOS_MM {
     DEFINE_MEDIA_MIMETYPE(VIDEO_SCREEN_SOURCE)
     DEFINE_MEDIA_MIMETYPE(VIDEO_SURFACE_SOURCE)
     DEFINE_MEDIA_MIMETYPE(MEDIA_FILE_SINK)
+    DEFINE_MEDIA_MIMETYPE(MEDIA_SEGMENTER_SINK)
     DEFINE_MEDIA_MIMETYPE(IMAGE_CAMERA_SOURCE)
     DEFINE_MEDIA_MIMETYPE(MEDIA_CAMERA_SOURCE)
     DEFINE_MEDIA_MIMETYPE(SUBTITLE_SOURCE)
@@ -210,6 +211,12 @@ namespace YUNOS_MM {
     DEFINE_MEDIA_ATTR(CROP_RECT)
     DEFINE_MEDIA_ATTR(VOLUME)
     DEFINE_MEDIA_ATTR(MUTE)
+    DEFINE_MEDIA_ATTR(AUDIO_LATENCY_MODE)
+    DEFINE_MEDIA_ATTR(AUDIO_LATENCY_TARGET)
+    DEFINE_MEDIA_ATTR(AUDIO_LATENCY)
+    DEFINE_MEDIA_ATTR(AUDIO_RT_PRIORITY)
+    DEFINE_MEDIA_ATTR(AUDIO_PERIOD)
+    DEFINE_MEDIA_ATTR(AUDIO_FRAGSIZE)
     DEFINE_MEDIA_ATTR(AVG_FRAMERATE)
     DEFINE_MEDIA_ATTR(AVC_PROFILE)
     DEFINE_MEDIA_ATTR(AVC_LEVEL)
@@ -389,7 +396,47 @@ namespace YUNOS_MM {
     // when one buffer is ahead of other stream than this threshold, muxer will reject it (MM_ERROR_AGAIN). unit is ms
     DEFINE_MEDIA_ATTR(MUXER_STREAM_DRIFT_MAX)
 
+    // pre-roll recording: the muxer keeps the last PRE_ROLL_DURATION ms of encoded data in memory (at most
+    // PRE_ROLL_MAX_BYTES) from a video key frame on, and writes nothing until PRE_ROLL_TRIGGER.
+    // type: int32
+    DEFINE_MEDIA_ATTR(PRE_ROLL_DURATION)
+    DEFINE_MEDIA_ATTR(PRE_ROLL_MAX_BYTES)
+    DEFINE_MEDIA_ATTR(PRE_ROLL_TRIGGER)
+
+    // segmented recording: with FILE_ROTATION set, the muxer goes on in the next file at the first video key frame
+    // past MAX_DURATION/MAX_FILE_SIZE instead of stopping. the buffers to the sink carry SEGMENT_INDEX, the
+    // last one of a finished file (no data) SEGMENT_END as well.
+    // type: int32
+    DEFINE_MEDIA_ATTR(FILE_ROTATION)
+    DEFINE_MEDIA_ATTR(SEGMENT_INDEX)
+    DEFINE_MEDIA_ATTR(SEGMENT_END)
+
+    // live segmenting (HLS/DASH): with SEGMENT_DURATION set, the muxer cuts one stream into segments at the
+    // first video key frame past it, and into parts of SEGMENT_PART_DURATION for low latency. the init data
+    // carries SEGMENT_INDEX -1; a part end (no data) SEGMENT_PART, pts/duration of the part and the key frame
+    // flag when it starts with one. SEGMENT_LIST_SIZE is the number of segments kept in the playlists.
+    // SEGMENT_CODECS (string) is the RFC 6381 codecs of the stream, on the end of the init data.
+    // type: int32
+    DEFINE_MEDIA_ATTR(SEGMENT_DURATION)
+    DEFINE_MEDIA_ATTR(SEGMENT_PART_DURATION)
+    DEFINE_MEDIA_ATTR(SEGMENT_PART)
+    DEFINE_MEDIA_ATTR(SEGMENT_LIST_SIZE)
+    DEFINE_MEDIA_ATTR(SEGMENT_CODECS)
+
+    // more outputs of the recorder beside OUTPUT_FORMAT/FILE_PATH, encoded once: "<format>,<path>[,drop][,queue=<n>]"
+    // separated by ';', e.g. "rtp,rtp://10.0.0.2:5004,drop;hls,/tmp/live". type: string
+    DEFINE_MEDIA_ATTR(OUTPUT_SPECS)
+    // MediaFission, for the sinks added after: queue depth, and dropping (1) instead of holding the input when
+    // the queue is full. type: int32
+    DEFINE_MEDIA_ATTR(OUTPUT_QUEUE_SIZE)
+    DEFINE_MEDIA_ATTR(OUTPUT_DROP)
+
     DEFINE_MEDIA_ATTR(FILE_DOWNLOAD_PATH)
+
+    // startup metrics of the player, from prepare() on. unit is ms
+    // type: int64
+    DEFINE_MEDIA_ATTR(PREPARE_TIME)
+    DEFINE_MEDIA_ATTR(TIME_TO_FIRST_FRAME)
 ///////////////////////////////////////////////////////////////////
 //codecId2Mime
    const char * codecId2Mime(CowCodecID id);
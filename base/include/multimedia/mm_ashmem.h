@@ -32,6 +32,12 @@ typedef MMSharedPtr<MMAshMem> MMAshMemSP;
 // around the OS primitive for a memory mapped file.
 class MMAshMem {
 public:
+    // flags of createMemFd()
+    enum {
+        kMemFdSeal      = 1 << 0,   // seal the size, a peer can't shrink the memory under its mapping
+        kMemFdHugePage  = 1 << 1,   // hugetlb pages if available, transparent huge pages otherwise
+    };
+
     /* static functions */
     /**
     *   @brief Returns MMAshMem object, when pass name and size.
@@ -45,6 +51,22 @@ public:
     */
     static MMAshMemSP create(const char* name, size_t size);
 
+    /**
+    *   @brief Returns MMAshMem object backed by memfd_create(), for sharing with fd passing.
+    *   @note use getFd to get the fd and pass it to remote process with SCM_RIGHTS
+    *   @(see SideBandIPC::sendAshMem), the remote process uses importFd.
+    *   @size may be rounded up to the huge page size with kMemFdHugePage.
+    *   @return one valid pointer to MMAshMem object or NULL.
+    */
+    static MMAshMemSP createMemFd(const char* name, size_t size, uint32_t flags = kMemFdSeal);
+
+    /**
+    *   @brief create MMAshMem object from fd received from another process.
+    *   @note fd is owned by the returned object. size 0 means the size of fd.
+    *   @return one valid pointer to MMAshMem object or NULL.
+    */
+    static MMAshMemSP importFd(int fd, size_t size = 0, bool readonly = false);
+
     /**
     *   @brief create MMAshMem object by provided key and size and readonly or not.
     *   @note that key maybe come from another MMAshMem which even in different process.
@@ -62,6 +84,11 @@ public:
     */
     key_t getKey() const;
 
+    /**
+    *   @brief get fd of memfd (or ashmem) backed shared memory, -1 for SysV shared memory.
+    */
+    int getFd() const;
+
     /**
     *   @brief get shared memory pointer, if it's not null, you can read/write content for it.
     */
@@ -73,6 +100,7 @@ public:
     size_t getSize() const;
 
 private:
+    MMAshMem(MMAshMemImpl *impl);
     MMAshMem(const MMAshMem &other);
     void operator=(const MMAshMem &other);
     MMAshMemImpl* mImpl;
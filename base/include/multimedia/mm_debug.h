@@ -63,6 +63,10 @@ typedef enum {
  *     export  MM_LOG_LEVEL=v/V | d/D | i/I | w/W | e/E
  *     debug/Debug/DEBUG is also fine
  * - compile time log level is set by: -DMM_LOG_LEVEL=MM_LOG_DEBUG
+ * - write log from a background thread, callers don't wait for the output:
+ *     setprop mm.log.async 1
+ *     export  MM_LOG_ASYNC=1
+ *     per thread buffer size in KB: mm.log.async.kb / MM_LOG_ASYNC_KB
  */
 
 /**
@@ -94,6 +98,16 @@ bool mm_log_set_level(MMLogLevelType level);
  */
 int mm_log(MMLogLevelType level, const char *tag, const char *fmt,...);
 
+/**
+ * Write the pending messages of asynchronous log, no-op for synchronous log.
+ */
+void mm_log_flush(void);
+
+/**
+ * Get the number of messages dropped by asynchronous log since start.
+ */
+uint64_t mm_log_get_dropped(void);
+
 //some necessary information show on stdout
 #define PRINTF printf
 
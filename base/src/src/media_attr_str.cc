@@ -163,6 +163,7 @@ namespace YUNOS_MM {
     MEDIA_MIMETYPE(VIDEO_SURFACE_SOURCE, "video/surface-source")
     MEDIA_MIMETYPE(VIDEO_UVC_SOURCE, "video/UVC-source")
     MEDIA_MIMETYPE(MEDIA_FILE_SINK, "media/file-sink")
+    MEDIA_MIMETYPE(MEDIA_SEGMENTER_SINK, "media/segmenter-sink")
     MEDIA_MIMETYPE(IMAGE_CAMERA_SOURCE, "image/camera-source")
     MEDIA_MIMETYPE(MEDIA_CAMERA_SOURCE, "video/camera-source")
     MEDIA_MIMETYPE(SUBTITLE_SOURCE, "subtitle/source")
@@ -212,6 +213,12 @@ namespace YUNOS_MM {
     MEDIA_ATTR(CROP_RECT,"crop-rect")
     MEDIA_ATTR(VOLUME,"volume")
     MEDIA_ATTR(MUTE,"mute")
+    MEDIA_ATTR(AUDIO_LATENCY_MODE,"audio-latency-mode")
+    MEDIA_ATTR(AUDIO_LATENCY_TARGET,"audio-latency-target-ms")
+    MEDIA_ATTR(AUDIO_LATENCY,"audio-latency-us")
+    MEDIA_ATTR(AUDIO_RT_PRIORITY,"audio-rt-priority")
+    MEDIA_ATTR(AUDIO_PERIOD,"audio-period-ms")
+    MEDIA_ATTR(AUDIO_FRAGSIZE,"audio-fragsize-ms")
     MEDIA_ATTR(AVG_FRAMERATE,"avg-framerate")
     MEDIA_ATTR(AVC_PROFILE,"avc-profile")
     MEDIA_ATTR(AVC_LEVEL,"avc-level")
@@ -380,6 +387,20 @@ namespace YUNOS_MM {
     MEDIA_ATTR(BITRATE_MODE, "bitrate-mode")
     MEDIA_ATTR(MUSIC_SPECTRUM, "music-spectrum")
     MEDIA_ATTR(MUXER_STREAM_DRIFT_MAX, "muxer-stream-drift-max")
+    MEDIA_ATTR(PRE_ROLL_DURATION, "pre-roll-duration-ms")
+    MEDIA_ATTR(PRE_ROLL_MAX_BYTES, "pre-roll-max-bytes")
+    MEDIA_ATTR(PRE_ROLL_TRIGGER, "pre-roll-trigger")
+    MEDIA_ATTR(FILE_ROTATION, "file-rotation")
+    MEDIA_ATTR(SEGMENT_INDEX, "segment-index")
+    MEDIA_ATTR(SEGMENT_END, "segment-end")
+    MEDIA_ATTR(SEGMENT_DURATION, "segment-duration-ms")
+    MEDIA_ATTR(SEGMENT_PART_DURATION, "segment-part-duration-ms")
+    MEDIA_ATTR(SEGMENT_PART, "segment-part")
+    MEDIA_ATTR(SEGMENT_LIST_SIZE, "segment-list-size")
+    MEDIA_ATTR(SEGMENT_CODECS, "segment-codecs")
+    MEDIA_ATTR(OUTPUT_SPECS, "output-specs")
+    MEDIA_ATTR(OUTPUT_QUEUE_SIZE, "output-queue-size")
+    MEDIA_ATTR(OUTPUT_DROP, "output-drop")
     MEDIA_ATTR(BUFFER_LIST, "buffer-list")
 
     MEDIA_ATTR(CODEC_MEDIA_DECRYPT, "codec-media-decrypt")
@@ -390,6 +411,9 @@ namespace YUNOS_MM {
 
     MEDIA_ATTR(FILE_DOWNLOAD_PATH, "file-download-path")
 
+    MEDIA_ATTR(PREPARE_TIME, "prepare-time-ms")
+    MEDIA_ATTR(TIME_TO_FIRST_FRAME, "time-to-first-frame-ms")
+
 /////////////////////////////////////////////////////////
 // codeId and mimetype mapping
 typedef struct {
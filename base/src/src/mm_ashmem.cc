@@ -17,6 +17,12 @@
 
 #define LOG_TAG "MMAshMem"
 #include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
 
 #ifdef USE_ASHMEM_RPC
 #include <stdlib.h>
@@ -33,9 +39,42 @@
 #include <multimedia/mm_debug.h>
 #include <multimedia/mm_cpp_utils.h>
 
+// memfd/sealing definitions for older libc headers
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC             0x0001U
+#endif
+#ifndef MFD_ALLOW_SEALING
+#define MFD_ALLOW_SEALING       0x0002U
+#endif
+#ifndef MFD_HUGETLB
+#define MFD_HUGETLB             0x0004U
+#endif
+#ifndef F_ADD_SEALS
+#define F_ADD_SEALS             (1024 + 9)
+#define F_GET_SEALS             (1024 + 10)
+#define F_SEAL_SEAL             0x0001
+#define F_SEAL_SHRINK           0x0002
+#define F_SEAL_GROW             0x0004
+#endif
+#ifndef MADV_HUGEPAGE
+#define MADV_HUGEPAGE           14
+#endif
+
+#define MM_HUGE_PAGE_SIZE       (2 * 1024 * 1024)
+
 namespace YUNOS_MM {
 DEFINE_LOGTAG(MMAshMem)
 
+static int memfdCreate(const char *name, unsigned int flags)
+{
+#ifdef __NR_memfd_create
+    return (int)syscall(__NR_memfd_create, name, flags);
+#else
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
 class MMAshMemImpl {
 public:
     /**
@@ -46,6 +85,11 @@ public:
      */
     MMAshMemImpl(key_t key, size_t size, bool readonly=true, bool needrm=false);
 
+    /**
+     *   @brief create MMAshMemImpl object by memfd, fd is owned by the object.
+     */
+    static MMAshMemImpl* createFromFd(int fd, size_t size, bool readonly, bool hugePage);
+
     /**
     *   @brief destroy MMAshMemImpl, its key and shard memory buffer will be unmap and delete.
     */
@@ -56,6 +100,11 @@ public:
     */
     key_t getKey() const;
 
+    /**
+    *   @brief get fd of memfd/ashmem backed shared memory.
+    */
+    int getFd() const;
+
     /**
     *   @brief get shared memory pointer, if it's not null, you can read/write content for it.
     */
@@ -75,6 +124,8 @@ private:
     void*   mBuffer;
     bool    mReadOnly;
     bool    mNeedRM;
+    int     mFd;        // memfd, -1 for SysV/ashmem
+    bool    mHugePage;  // advise transparent huge pages on map
     DECLARE_LOGTAG();
 };
 
@@ -86,11 +137,29 @@ MMAshMemImpl::MMAshMemImpl(key_t key, size_t size, bool readonly, bool needrm)
       mSize(size),
       mBuffer(NULL),
       mReadOnly(readonly),
-      mNeedRM(needrm)
+      mNeedRM(needrm),
+      mFd(-1),
+      mHugePage(false)
 {
 }
 
+//static
+MMAshMemImpl* MMAshMemImpl::createFromFd(int fd, size_t size, bool readonly, bool hugePage)
+{
+    MMAshMemImpl *impl = new MMAshMemImpl(-1, size, readonly, false);
+    impl->mFd = fd;
+    impl->mHugePage = hugePage;
+    return impl;
+}
+
 MMAshMemImpl::~MMAshMemImpl() {
+    if (mFd >= 0) {
+        if (mBuffer)
+            munmap(mBuffer, mSize);
+        close(mFd);
+        return;
+    }
+
     if (mBuffer) {
 #ifdef USE_ASHMEM_RPC
         munmap(mBuffer, mSize);
@@ -115,6 +184,18 @@ void* MMAshMemImpl::getBase() {
     if (mBuffer) {
         return mBuffer;
     }
+    if (mFd >= 0) {
+        void* ret = mmap(NULL, mSize, PROT_READ | (mReadOnly ? 0 : PROT_WRITE), MAP_SHARED, mFd, 0);
+        if (ret == MAP_FAILED) {
+            ERROR("memfd %d map fail:%d %s", mFd, errno, strerror(errno));
+            return NULL;
+        }
+        // only a hint, fails without THP support for shmem
+        if (mHugePage && madvise(ret, mSize, MADV_HUGEPAGE))
+            DEBUG("madvise huge page fail:%d %s", errno, strerror(errno));
+        mBuffer = ret;
+        return ret;
+    }
 #ifdef USE_ASHMEM_RPC
     void* ret = mmap(NULL, mSize, PROT_READ | PROT_WRITE, MAP_SHARED, mKey, 0);
     if (ret == MAP_FAILED) {
@@ -141,6 +222,14 @@ key_t MMAshMemImpl::getKey() const {
     return mKey;
 }
 
+int MMAshMemImpl::getFd() const {
+#ifdef USE_ASHMEM_RPC
+    if (mFd < 0)
+        return mKey;
+#endif
+    return mFd;
+}
+
 size_t MMAshMemImpl::getSize() const {
     return mSize;
 }
@@ -170,7 +259,7 @@ MMAshMemSP MMAshMem::create(const char* name, size_t size)
         shmid = shmget(shmkey, size, IPC_CREAT | IPC_EXCL | 0777);
     } while (shmid < 0 && loops++ < 100);
     if (shmid < 0) {
-        ERROR("failed to get shmid.\n");
+        ERROR("failed to get shmid for %s, size %zu.\n", name ? name : "", size);
         return mem;
     }
 #endif
@@ -178,6 +267,88 @@ MMAshMemSP MMAshMem::create(const char* name, size_t size)
     return mem;
 }
 
+//static
+MMAshMemSP MMAshMem::createMemFd(const char* name, size_t size, uint32_t flags)
+{
+    MMAshMemSP mem;
+    if (size <= 0)
+        return mem;
+
+    unsigned int mfdFlags = MFD_CLOEXEC | ((flags & kMemFdSeal) ? MFD_ALLOW_SEALING : 0);
+    size_t hugeSize = (size + MM_HUGE_PAGE_SIZE - 1) & ~((size_t)MM_HUGE_PAGE_SIZE - 1);
+
+    // hugetlb first if asked for, the map fails when no huge page is reserved,
+    // then fall back to normal memfd with transparent huge pages advised
+    for (int hugeTLB = (flags & kMemFdHugePage) ? 1 : 0; hugeTLB >= 0; hugeTLB--) {
+        size_t allocSize = hugeTLB ? hugeSize : size;
+        int fd = memfdCreate(name, mfdFlags | (hugeTLB ? MFD_HUGETLB : 0));
+        if (fd < 0) {
+            if (hugeTLB)
+                DEBUG("hugetlb memfd_create fail:%d %s", errno, strerror(errno));
+            else
+                ERROR("memfd_create fail:%d %s", errno, strerror(errno));
+            continue;
+        }
+        if (ftruncate(fd, allocSize)) {
+            ERROR("memfd resize fail:%d %s", errno, strerror(errno));
+            close(fd);
+            continue;
+        }
+
+        if ((flags & kMemFdSeal) && fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL))
+            WARNING("memfd seal fail:%d %s", errno, strerror(errno));
+
+        mem.reset(new MMAshMem(MMAshMemImpl::createFromFd(fd, allocSize, false,
+                                                          (flags & kMemFdHugePage) && !hugeTLB)));
+        if (mem->getBase()) {
+            INFO("create memfd %d, size %zu, hugetlb %d", fd, allocSize, hugeTLB);
+            return mem;
+        }
+        mem.reset();
+    }
+
+    return mem;
+}
+
+//static
+MMAshMemSP MMAshMem::importFd(int fd, size_t size, bool readonly)
+{
+    MMAshMemSP mem;
+    if (fd < 0)
+        return mem;
+
+    struct stat st;
+    if (fstat(fd, &st)) {
+        ERROR("fstat fd %d fail:%d %s", fd, errno, strerror(errno));
+        close(fd);
+        return mem;
+    }
+
+    // mapping beyond the end of the file gets SIGBUS on access
+    if (!size)
+        size = st.st_size;
+    if (!size || (off_t)size > st.st_size) {
+        ERROR("invalid size %zu of fd %d, file size %" PRId64 "", size, fd, (int64_t)st.st_size);
+        close(fd);
+        return mem;
+    }
+
+    int seals = fcntl(fd, F_GET_SEALS);
+    if (seals < 0 || !(seals & F_SEAL_SHRINK))
+        WARNING("fd %d isn't sealed against shrink", fd);
+
+    mem.reset(new MMAshMem(MMAshMemImpl::createFromFd(fd, size, readonly, false)));
+    if (!mem->getBase())
+        mem.reset();
+    return mem;
+}
+
+// the caller maps the memory, to check the result
+MMAshMem::MMAshMem(MMAshMemImpl *impl)
+    : mImpl(impl)
+{
+}
+
 MMAshMem::MMAshMem(key_t key, size_t size, bool readonly, bool needrm)
 {
     mImpl = new MMAshMemImpl(key, size, readonly, needrm);
@@ -204,6 +375,13 @@ key_t MMAshMem::getKey() const {
     return key;
 }
 
+int MMAshMem::getFd() const {
+    int fd = -1;
+    if (mImpl)
+        fd = mImpl->getFd();
+    return fd;
+}
+
 size_t MMAshMem::getSize() const {
     size_t size = 0;
     if (mImpl)
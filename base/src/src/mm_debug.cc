@@ -24,6 +24,7 @@
 #include "multimedia/mm_cpp_utils.h"
 
 #include <unistd.h>
+#include <pthread.h>
 #include <sys/syscall.h>
 #define GETTID()    syscall(__NR_gettid)
 #define GETPID()    syscall(__NR_getpid)
@@ -38,6 +39,14 @@ static YUNOS_MM::Lock lock;
 #define MM_LOG_LEVEL_STR_ENV        "MM_LOG_LEVEL"
 #define MM_LOG_FILE_STR_KEY        "mm.log.file"
 #define MM_LOG_FILE_STR_ENV        "MM_LOG_FILE"
+#define MM_LOG_ASYNC_STR_KEY        "mm.log.async"
+#define MM_LOG_ASYNC_STR_ENV        "MM_LOG_ASYNC"
+#define MM_LOG_ASYNC_KB_STR_KEY     "mm.log.async.kb"
+#define MM_LOG_ASYNC_KB_STR_ENV     "MM_LOG_ASYNC_KB"
+
+#define MM_LOG_BUF_SIZE 1024
+
+static bool mm_log_async_start();
 
 static MMLogLevelType proToLevel(const char *buf)
 {
@@ -135,6 +144,9 @@ bool mm_log_set_level(MMLogLevelType level)
 #endif
     }
 
+    if (YUNOS_MM::mm_check_env_str(MM_LOG_ASYNC_STR_KEY, MM_LOG_ASYNC_STR_ENV) && mm_log_async_start())
+        fprintf(stderr, "mm log is asynchronous\n");
+
     loginit = true;
 
     return loginit;
@@ -151,31 +163,12 @@ static int logcatPriority[MM_LOG_LEVEL_COUNT] = {
 #endif
 static char log_level_char[MM_LOG_LEVEL_COUNT] = {'E', 'W', 'I', 'D', 'V'};
 
-int mm_log(MMLogLevelType level, const char *tag, const char *fmt, ...)
+static int mm_log_output(FILE *fp, MMLogLevelType level, const char *tag, const char *msg,
+                         int64_t nowMs, long int pid, long int tid)
 {
     int ret = 0;
-    #define MM_LOG_BUF_SIZE 1024
 
-    if(level > mm_current_log_level || level < MM_LOG_ERROR)
-        return -1;
-
-    YUNOS_MM::MMAutoLock locker(lock);
-    if(!loginit){
-        if (!mm_log_set_level(MM_LOG_DEFAULT))
-            return -1;
-    }
-
-    va_list ap;
-    char buf[MM_LOG_BUF_SIZE];
-    va_start(ap, fmt);
-    vsnprintf(buf, MM_LOG_BUF_SIZE, fmt, ap);
-    va_end(ap);
-
-    FILE *fp = mm_log_file.get();
     if (fp) {
-        timeval t;
-        gettimeofday(&t, NULL);
-        int64_t nowMs = t.tv_sec * 1000LL + t.tv_usec/1000LL;
         int32_t timeH = int32_t(nowMs/3600000 + 8); // hard code it, assume GMT 8 time zone
         nowMs = nowMs - nowMs/3600000*3600000;
         int32_t timeM = int32_t(nowMs/60000);
@@ -186,8 +179,8 @@ int mm_log(MMLogLevelType level, const char *tag, const char *fmt, ...)
 
         fprintf(fp, "%.2d:%.2d:%.2d.%.3d  %ld %ld [%c] %s: %s\n",
             timeH%24, timeM, timeS, timeMs,
-            (long int)GETPID(), (long int)GETTID(),
-            log_level_char[level], tag, buf);
+            pid, tid,
+            log_level_char[level], tag, msg);
     }
     else {
 #if defined(OS_YUNOS)
@@ -195,13 +188,349 @@ int mm_log(MMLogLevelType level, const char *tag, const char *fmt, ...)
         if (level>=MM_LOG_ERROR && level <=MM_LOG_VERBOSE)
             prio = logcatPriority[level];
 
-        ret = yunosLogPrint(kLogIdMain, prio, tag, "%s", buf);
+        ret = yunosLogPrint(kLogIdMain, prio, tag, "%s", msg);
 #else
         fprintf(stderr, "internal bug, log file isn't inited\n");
 #endif
     }
 
     return ret;
+}
+
+// ///////////////// async log /////////////////////////////////////
+/*
+ * with mm.log.async set, mm_log() formats the message on the calling thread into a ring
+ * of that thread (one producer, one consumer, no lock) and a writer thread drains all rings
+ * in time order to the log file/logcat.
+ * - ring size per thread is mm.log.async.kb, a message is dropped when the ring is full,
+ *   the writer reports the dropped count of each thread
+ * - the writer wakes up every MM_LOG_ASYNC_INTERVAL_MS, or at once for warning/error or
+ *   a ring above half full
+ * - pending messages are written by mm_log_flush() and at exit
+ */
+#define MM_LOG_ASYNC_RING_KB        32
+#define MM_LOG_ASYNC_INTERVAL_MS    20
+#define MM_LOG_ASYNC_TAG_MAX        63
+#define MM_LOG_RECORD_PAD           0x80000000  // skip to the end of the ring
+#define MM_LOG_ALIGN(x)             (((x) + 7) & ~7)
+
+struct LogRecord {
+    uint32_t size;          // record size with header, or MM_LOG_RECORD_PAD | bytes to skip
+    uint16_t level;
+    uint16_t tagLen;
+    int64_t timeMs;
+    uint32_t msgLen;
+    uint32_t reserved;
+    // NUL terminated tag and message follow
+};
+
+struct LogRing {
+    // written by the writer
+    uint32_t head;
+    uint32_t droppedReported;
+    LogRing *next;
+    char pad[64];
+    // written by the owner thread
+    uint32_t tail;
+    uint32_t dropped;
+    int32_t exited;
+    long int tid;
+    uint32_t size;          // power of 2
+    uint8_t *buf;
+};
+
+static bool mm_log_async = false;
+static long int mm_log_pid = 0;
+static uint32_t mm_log_ring_size = MM_LOG_ASYNC_RING_KB * 1024;
+static __thread LogRing *tls_ring = NULL;
+static pthread_key_t ring_key;
+static LogRing *rings = NULL;
+static pthread_mutex_t rings_lock = PTHREAD_MUTEX_INITIALIZER;     // ring list, held by drain
+static pthread_mutex_t writer_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t writer_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t writer_thread;
+static bool writer_exit = false;
+static uint64_t dropped_total = 0;
+
+static void mm_log_ring_exit(void *data)
+{
+    LogRing *ring = (LogRing*)data;
+    // freed by the writer once it is drained
+    __atomic_store_n(&ring->exited, 1, __ATOMIC_RELEASE);
+}
+
+static LogRing *mm_log_ring_create()
+{
+    LogRing *ring = (LogRing*)calloc(1, sizeof(LogRing));
+    if (!ring)
+        return NULL;
+    ring->buf = (uint8_t*)malloc(mm_log_ring_size);
+    if (!ring->buf) {
+        free(ring);
+        return NULL;
+    }
+    ring->size = mm_log_ring_size;
+    ring->tid = (long int)GETTID();
+
+    pthread_mutex_lock(&rings_lock);
+    ring->next = rings;
+    rings = ring;
+    pthread_mutex_unlock(&rings_lock);
+
+    pthread_setspecific(ring_key, ring);
+    tls_ring = ring;
+    return ring;
+}
+
+// returns -1 if the message isn't taken, the caller logs it synchronously
+static int mm_log_async_write(MMLogLevelType level, const char *tag, const char *fmt, va_list ap)
+{
+    LogRing *ring = tls_ring;
+    if (!ring && !(ring = mm_log_ring_create()))
+        return -1;
+
+    char msg[MM_LOG_BUF_SIZE];
+    int msgLen = vsnprintf(msg, MM_LOG_BUF_SIZE, fmt, ap);
+    if (msgLen < 0)
+        msgLen = 0;
+    else if (msgLen >= MM_LOG_BUF_SIZE)
+        msgLen = MM_LOG_BUF_SIZE - 1;
+    uint32_t tagLen = tag ? strnlen(tag, MM_LOG_ASYNC_TAG_MAX) : 0;
+
+    timeval t;
+    gettimeofday(&t, NULL);
+
+    uint32_t need = MM_LOG_ALIGN(sizeof(LogRecord) + tagLen + 1 + msgLen + 1);
+    uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    uint32_t tail = ring->tail;
+    uint32_t pos = tail & (ring->size - 1);
+    uint32_t pad = (ring->size - pos < need) ? ring->size - pos : 0;
+    uint32_t used = tail + pad + need - head;
+
+    if (used > ring->size) {
+        __atomic_add_fetch(&ring->dropped, 1, __ATOMIC_RELAXED);
+        pthread_cond_signal(&writer_cond);
+        return 0;
+    }
+
+    if (pad) {
+        // record never wraps, records are 8 bytes aligned so the size field always fits
+        *(uint32_t*)(ring->buf + pos) = MM_LOG_RECORD_PAD | pad;
+        pos = 0;
+    }
+
+    LogRecord *record = (LogRecord*)(ring->buf + pos);
+    record->size = need;
+    record->level = (uint16_t)level;
+    record->tagLen = (uint16_t)tagLen;
+    record->timeMs = t.tv_sec * 1000LL + t.tv_usec/1000LL;
+    record->msgLen = msgLen;
+    char *data = (char*)(record + 1);
+    memcpy(data, tag ? tag : "", tagLen);
+    data[tagLen] = '\0';
+    memcpy(data + tagLen + 1, msg, msgLen);
+    data[tagLen + 1 + msgLen] = '\0';
+
+    __atomic_store_n(&ring->tail, tail + pad + need, __ATOMIC_RELEASE);
+
+    if (level <= MM_LOG_WARN || used > ring->size / 2)
+        pthread_cond_signal(&writer_cond);
+
+    return 0;
+}
+
+static LogRecord *mm_log_ring_peek(LogRing *ring)
+{
+    uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    uint32_t head = ring->head;
+
+    while (head != tail) {
+        LogRecord *record = (LogRecord*)(ring->buf + (head & (ring->size - 1)));
+        if (!(record->size & MM_LOG_RECORD_PAD))
+            return record;
+        head += record->size & ~MM_LOG_RECORD_PAD;
+        __atomic_store_n(&ring->head, head, __ATOMIC_RELEASE);
+    }
+
+    return NULL;
+}
+
+static void mm_log_async_drain()
+{
+    FilePtr file;
+    {
+        YUNOS_MM::MMAutoLock locker(lock);
+        file = mm_log_file;
+    }
+
+    pthread_mutex_lock(&rings_lock);
+
+    // merge the rings by time, one ring is in order already
+    while (1) {
+        LogRing *best = NULL;
+        LogRecord *bestRecord = NULL;
+        for (LogRing *ring = rings; ring; ring = ring->next) {
+            LogRecord *record = mm_log_ring_peek(ring);
+            if (record && (!bestRecord || record->timeMs < bestRecord->timeMs)) {
+                best = ring;
+                bestRecord = record;
+            }
+        }
+        if (!best)
+            break;
+
+        const char *tag = (const char*)(bestRecord + 1);
+        mm_log_output(file.get(), (MMLogLevelType)bestRecord->level, tag, tag + bestRecord->tagLen + 1,
+                      bestRecord->timeMs, mm_log_pid, best->tid);
+        __atomic_store_n(&best->head, best->head + bestRecord->size, __ATOMIC_RELEASE);
+    }
+
+    LogRing **prev = &rings;
+    while (*prev) {
+        LogRing *ring = *prev;
+        uint32_t dropped = __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED);
+        if (dropped != ring->droppedReported) {
+            char msg[64];
+            timeval t;
+            gettimeofday(&t, NULL);
+            snprintf(msg, sizeof(msg), "%u messages are dropped, log ring is full", dropped - ring->droppedReported);
+            mm_log_output(file.get(), MM_LOG_WARN, "mm_log", msg, t.tv_sec * 1000LL + t.tv_usec/1000LL, mm_log_pid, ring->tid);
+            dropped_total += dropped - ring->droppedReported;
+            ring->droppedReported = dropped;
+        }
+
+        if (__atomic_load_n(&ring->exited, __ATOMIC_ACQUIRE) && !mm_log_ring_peek(ring)) {
+            *prev = ring->next;
+            free(ring->buf);
+            free(ring);
+            continue;
+        }
+        prev = &ring->next;
+    }
+
+    pthread_mutex_unlock(&rings_lock);
+}
+
+static void *mm_log_writer(void *)
+{
+    pthread_mutex_lock(&writer_lock);
+    while (!writer_exit) {
+        timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_nsec += MM_LOG_ASYNC_INTERVAL_MS * 1000000LL;
+        if (ts.tv_nsec >= 1000000000LL) {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000LL;
+        }
+        pthread_cond_timedwait(&writer_cond, &writer_lock, &ts);
+
+        pthread_mutex_unlock(&writer_lock);
+        mm_log_async_drain();
+        pthread_mutex_lock(&writer_lock);
+    }
+    pthread_mutex_unlock(&writer_lock);
+
+    mm_log_async_drain();
+    return NULL;
+}
+
+static void mm_log_async_stop()
+{
+    pthread_mutex_lock(&writer_lock);
+    writer_exit = true;
+    pthread_cond_signal(&writer_cond);
+    pthread_mutex_unlock(&writer_lock);
+
+    pthread_join(writer_thread, NULL);
+    mm_log_async = false;
+}
+
+// no writer thread in the child, go back to synchronous log
+static void mm_log_async_child()
+{
+    mm_log_async = false;
+}
+
+static bool mm_log_async_start()
+{
+    if (mm_log_async)
+        return true;
+
+    std::string env_str = YUNOS_MM::mm_get_env_str(MM_LOG_ASYNC_KB_STR_KEY, MM_LOG_ASYNC_KB_STR_ENV);
+    int kb = env_str.size() ? atoi(env_str.c_str()) : MM_LOG_ASYNC_RING_KB;
+    if (kb < 4)
+        kb = 4;
+    // power of 2 for the ring index mask
+    mm_log_ring_size = 4096;
+    while (mm_log_ring_size < (uint32_t)kb * 1024 && mm_log_ring_size < (1 << 24))
+        mm_log_ring_size <<= 1;
+
+    mm_log_pid = (long int)GETPID();
+    if (pthread_key_create(&ring_key, mm_log_ring_exit))
+        return false;
+
+    if (pthread_create(&writer_thread, NULL, mm_log_writer, NULL)) {
+        pthread_key_delete(ring_key);
+        return false;
+    }
+
+    atexit(mm_log_async_stop);
+    pthread_atfork(NULL, NULL, mm_log_async_child);
+    mm_log_async = true;
+    return true;
+}
+
+void mm_log_flush(void)
+{
+    if (mm_log_async)
+        mm_log_async_drain();
+}
+
+uint64_t mm_log_get_dropped(void)
+{
+    uint64_t dropped = 0;
+
+    pthread_mutex_lock(&rings_lock);
+    dropped = dropped_total;
+    for (LogRing *ring = rings; ring; ring = ring->next)
+        dropped += __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED) - ring->droppedReported;
+    pthread_mutex_unlock(&rings_lock);
+
+    return dropped;
+}
+
+int mm_log(MMLogLevelType level, const char *tag, const char *fmt, ...)
+{
+    if(level > mm_current_log_level || level < MM_LOG_ERROR)
+        return -1;
+
+    if (!loginit) {
+        YUNOS_MM::MMAutoLock locker(lock);
+        if (!loginit && !mm_log_set_level(MM_LOG_DEFAULT))
+            return -1;
+    }
+
+    va_list ap;
+    if (mm_log_async) {
+        va_start(ap, fmt);
+        int ret = mm_log_async_write(level, tag, fmt, ap);
+        va_end(ap);
+        if (ret == 0)
+            return 0;
+    }
+
+    YUNOS_MM::MMAutoLock locker(lock);
+
+    char buf[MM_LOG_BUF_SIZE];
+    va_start(ap, fmt);
+    vsnprintf(buf, MM_LOG_BUF_SIZE, fmt, ap);
+    va_end(ap);
+
+    timeval t;
+    gettimeofday(&t, NULL);
+    return mm_log_output(mm_log_file.get(), level, tag, buf,
+                         t.tv_sec * 1000LL + t.tv_usec/1000LL,
+                         (long int)GETPID(), (long int)GETTID());
  }
 
 #ifdef __cplusplus
@@ -49,6 +49,7 @@ include ${MY_MM_CURRENT_DIR}/drm/yunos.mk
 include ${MY_MM_CURRENT_DIR}/mcv4l2/yunos.mk
 # include ${MY_MM_CURRENT_DIR}/v4l2deviceservice/yunos.mk
 include ${MY_MM_CURRENT_DIR}/transcoding/yunos.mk
+include ${MY_MM_CURRENT_DIR}/thumbnail/yunos.mk
 include ${MY_MM_CURRENT_DIR}/vrvideoview/yunos.mk
 
 ## mdk
@@ -32,7 +32,8 @@ LOCAL_SRC_FILES :=  \
         $(SRC_PATH)/pipeline.cc                \
         $(SRC_PATH)/pipeline_player_base.cc    \
         $(SRC_PATH)/pipeline_recorder_base.cc  \
-        $(SRC_PATH)/cow_util.cc
+        $(SRC_PATH)/cow_util.cc                \
+        $(SRC_PATH)/audio_process.cc
 
 LOCAL_SHARED_LIBRARIES := mmbase dl stdc++
 LOCAL_LDFLAGS:= `pkg-config --cflags --libs expat`
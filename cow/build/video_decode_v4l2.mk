@@ -35,6 +35,13 @@ LOCAL_INSTALL_PATH := $(INST_LIB_PATH)/cow
 X11_CPP_LIBS_FLAGS :=-D_ENABLE_X11
 LOCAL_CPPFLAGS += $(X11_CPP_LIBS_FLAGS)
 
+# software v4l2 device on libavcodec, picked with MM_V4L2_SOFT=1
+ifeq ($(USING_V4L2CODEC_SOFT),1)
+LOCAL_SRC_FILES += $(SRC_PATH)/components/v4l2codec_device_soft.cc
+LOCAL_CPPFLAGS += -D_V4L2CODEC_SOFT `pkg-config --cflags libavcodec libavutil libswscale`
+LOCAL_LDFLAGS += `pkg-config --libs libavcodec libavutil libswscale`
+endif
+
 LOCAL_MODULE := libVideoDecodeV4l2.so
 
 MODULE_TYPE := usr
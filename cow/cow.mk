@@ -27,8 +27,10 @@ all:
 	make -C build -f video_encode_v4l2.mk
 	make -C build -f av_muxer.mk
 	make -C build -f file_sink.mk
+	make -C build -f segmenter_sink.mk
 	make -C build -f audio_source_file.mk
 	make -C build -f audio_sink_pulse.mk
+	make -C build -f audio_mixer.mk
 	make -C build -f audio_source_pulse.mk
 	make -C build -f codec_ffmpeg.mk
 	make -C build -f video_source_uvc.mk
@@ -49,8 +51,10 @@ clean:
 	make clean -C build -f video_encode_v4l2.mk
 	make clean -C build -f av_muxer.mk
 	make clean -C build -f file_sink.mk
+	make clean -C build -f segmenter_sink.mk
 	make clean -C build -f audio_source_file.mk
 	make clean -C build -f audio_sink_pulse.mk
+	make clean -C build -f audio_mixer.mk
 	make clean -C build -f audio_source_pulse.mk
 	make clean -C build -f codec_ffmpeg.mk
 	make clean -C build -f video_source_uvc.mk
@@ -72,8 +76,10 @@ install:
 	make install -C build -f video_encode_v4l2.mk
 	make install -C build -f av_muxer.mk
 	make install -C build -f file_sink.mk
+	make install -C build -f segmenter_sink.mk
 	make install -C build -f audio_source_file.mk
 	make install -C build -f audio_sink_pulse.mk
+	make install -C build -f audio_mixer.mk
 	make install -C build -f audio_source_pulse.mk
 	make install -C build -f codec_ffmpeg.mk
 	make install -C build -f video_source_uvc.mk
@@ -238,6 +238,12 @@ public:
         //   param2: cost memory size
         //   obj: not defined
         kEventCostMemorySize,
+        // params:
+        //   param1: kEventSegmentCompleted
+        //   param2: index of the file, from 0
+        //   obj: path of the file, a string
+        //  a file of a segmented recording is complete on disk (written, synced and closed)
+        kEventSegmentCompleted,
         kEventInfoSourceStart = 50,
         kEventInfoSourceMax = 99,
         kEventInfoFilterStart = 100,
@@ -450,6 +456,16 @@ public:
         //   param2: none zero if seekable, else not seekable.
         //   obj: not defined
         kEventInfoSeekable = SourceComponent::kEventInfoSubClassStart + 1,
+        // params:
+        //   param1: kEventInfoNextSourceStarted
+        //   param2: start time in ms of the next source, on the timeline of the buffers
+        //   obj: int64_t duration in ms of the next source
+        kEventInfoNextSourceStarted,
+        // params:
+        //   param1: kEventInfoLoopStarted
+        //   param2: start time in ms of the new pass, on the timeline of the buffers
+        //   obj: int32_t loop count
+        kEventInfoLoopStarted,
         kEventInfoSubClassStart
     };
 
@@ -457,6 +473,25 @@ public:
     // type: set/get
     // value: int64_t -> buffering time
     static const char * PARAM_KEY_BUFFERING_TIME;
+    // max bytes read to detect the streams, <= 0 for the default
+    // type: set
+    // value: int64_t
+    static const char * PARAM_KEY_PROBE_SIZE;
+    // max duration in usec analyzed to find the stream parameters, <= 0 for the default
+    // type: set
+    // value: int64_t
+    static const char * PARAM_KEY_ANALYZE_DURATION;
+    // reuse the stream parameters found at a previous open of the same local file, skipping
+    // avformat_find_stream_info (the parsers are not set up by it then)
+    // type: set
+    // value: int32_t, 1 to enable, default 0
+    static const char * PARAM_KEY_PROBE_CACHE;
+    // at the end, go on from the start of the source without EOS: timestamps continue from the
+    // end, the downstream components see no flush. kEventInfoLoopStarted is sent at each wrap.
+    // sources that can't seek end with EOS as usual.
+    // type: set
+    // value: int32_t, 0 to disable, default 0
+    static const char * PARAM_KEY_SEAMLESS_LOOP;
 
 public:
     virtual const std::list<std::string> & supportedProtocols() const = 0;
@@ -467,6 +502,13 @@ public:
 
     virtual MediaMetaSP getMetaData() = 0;
 
+    // gapless playback: the source opens the uri ahead of time and continues with it
+    // after the current one ends, timestamps go on from the end of the current source.
+    // kEventInfoNextSourceStarted is sent on the switch; a NULL uri cancels it.
+    // if the next source can't be joined, the source ends with EOS as usual.
+    virtual mm_status_t setNextUri(const char * uri,
+                            const std::map<std::string, std::string> * headers = NULL) { return MM_ERROR_UNSUPPORTED; }
+
 
     MM_DISALLOW_COPY(PlaySourceComponent);
 };
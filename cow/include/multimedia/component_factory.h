@@ -20,6 +20,8 @@
 
 #include <map>
 #include <list>
+#include <string>
+#include <vector>
 
 #include <multimedia/mm_types.h>
 #include <multimedia/mm_errors.h>
@@ -44,42 +46,69 @@ namespace YUNOS_MM {
 class Component;
 typedef MMSharedPtr<Component> ComponentSP;
 
+/*
+ * plugins xml files are compiled once into a hashed mime -> candidates registry,
+ * candidates are sorted by priority. create() looks the registry up without lock,
+ * libraries are dlopen'ed out of the factory lock on first use.
+ * - mm.cow.registry.cache: path of a binary cache of the parsed default xml files,
+ *   it is used while the mtime and size of all of them are unchanged
+ * - mm.cow.preload: comma separated mime types for preloadAsync()
+ */
 class ComponentFactory {
 
 public:
     static ComponentSP create(const char* componentName, const char* mimeType, bool isEncoder);
     static bool appendPluginsXml(const char* xmlFile);
 
+    // dlopen the library of the top candidate of each mime type in a background thread,
+    // the libraries stay loaded. NULL uses mm.cow.preload, or a default list of hot mime types
+    static void preloadAsync(const char* mimeTypes = NULL);
+
 private:
     struct ComponentInfo {
         typedef Component *(*CreateComponentFunc)(const char *, bool);
         typedef void (*ReleaseComponentFunc)(Component *);
 
+        ComponentInfo() : mCreate(NULL), mRelease(NULL), mLibHandle(NULL), mPending(0), mResident(false) {}
+
         CreateComponentFunc mCreate;
         ReleaseComponentFunc mRelease;
         void *mLibHandle;
-        const char* mLibComName;
+        std::string mLibComName;
         std::list<Component *> mComponent;
+        int32_t mPending;       // components being created out of the lock
+        bool mResident;         // preloaded, never closed
     };
+    typedef MMSharedPtr<ComponentInfo> ComponentInfoSP;
+
+    struct Registry;
 
     ComponentFactory() {}
     virtual ~ComponentFactory(){}
 
     static void release(Component * component);
 
-    static ComponentSP loadComponent_l(const char* libComponentName, const char* mimeType, bool isEncoder);
+    static ComponentSP loadComponent(const char* libComponentName, const char* mimeType, bool isEncoder);
+    static ComponentInfoSP acquireLibrary(const char* libComponentName);
+    static ComponentInfoSP openLibrary(const char* libComponentName);
+    static void closeLibraryIfUnused_l(const std::string &libComponentName);
     static bool appendPluginsXml_l(const char* xmlFile);
     static bool loadXmlFile_l(const char* xmlFile);
     static bool loadDefaultXmlIfNeeded_l();
+    static bool loadCache_l(const std::string &cacheFile, const std::vector<std::string> &xmlFiles);
+    static void saveCache_l(const std::string &cacheFile, const std::vector<std::string> &xmlFiles,
+                            const std::vector<int64_t> &xmlStamps);
+    static void buildRegistry_l();
+    static const Registry* getRegistry();
+    static void* preloadThread(void *arg);
 
 private:
-    typedef MMSharedPtr<ComponentInfo> ComponentInfoSP;
-
     typedef std::map<std::string, ComponentInfoSP> MComponentMap;
     typedef std::pair<std::string, ComponentInfoSP> MComponentMapPair;
 
     static MComponentMap mComponentMap;
     static Lock mLock;
+    static Registry *mRegistry;
 
     MM_DISALLOW_COPY(ComponentFactory);
 };
@@ -65,6 +65,12 @@ public:
     virtual mm_status_t setDataSourceAsync(int fd, int64_t offset, int64_t length);
     virtual mm_status_t setDataSource(const unsigned char * mem, size_t size);
     virtual mm_status_t setSubtitleSource(const char* uri);
+    // playlist: queued sources are played in order after the current one. sources with the same
+    // codec configuration continue without gap, others are loaded on EOS of the previous one.
+    // kEventInfo/kEventInfoNextSourceStarted is sent when the next one starts playing.
+    virtual mm_status_t queueDataSource(const char * uri,
+                            const std::map<std::string, std::string> * headers = NULL);
+    virtual mm_status_t clearDataSourceQueue();
     virtual mm_status_t setDisplayName(const char* name);
     virtual mm_status_t setNativeDisplay(void * display);
     virtual mm_status_t setVideoSurface(void * handle, bool isTexture = false);
@@ -0,0 +1,96 @@
+/**
+ * Copyright (C) 2017 Alibaba Group Holding Limited. All Rights Reserved.
+ *
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef memory_asset_h
+#define memory_asset_h
+
+#include <map>
+#include <string>
+
+#include <multimedia/mm_types.h>
+#include <multimedia/mm_errors.h>
+#include <multimedia/mm_cpp_utils.h>
+
+namespace YUNOS_MM {
+
+class MemoryAsset;
+typedef MMSharedPtr<MemoryAsset> MemoryAssetSP;
+
+/*
+ * a complete media file in memory, played through the uri "mem://<id>".
+ * AVDemuxer reads it with its own AVIO context, the file system isn't touched.
+ * players share one asset: each reader keeps its own position, the data is read only.
+ */
+class MemoryAsset {
+public:
+    ~MemoryAsset();
+
+    const uint8_t * data() const { return mData; }
+    size_t size() const { return mSize; }
+    // unique for the life of the process, also the key of the demuxer probe cache
+    uint64_t id() const { return mId; }
+    const std::string & uri() const { return mUri; }
+
+private:
+    MemoryAsset(uint64_t id, const uint8_t * data, size_t size, uint8_t * owned);
+
+    uint64_t mId;
+    const uint8_t * mData;
+    size_t mSize;
+    uint8_t * mOwned;   // copy made by MemoryAssetCache::add(), NULL for wrapped memory
+    std::string mUri;
+
+    friend class MemoryAssetCache;
+    MM_DISALLOW_COPY(MemoryAsset);
+};
+
+class MemoryAssetCache {
+public:
+    static const char * kScheme; // "mem://"
+
+    /* refers to the memory of the caller, which must stay valid until the last holder of the
+     * asset releases it (the player does on reset). the same memory gets the same asset while it lives.
+     */
+    static MemoryAssetSP wrap(const uint8_t * data, size_t size);
+
+    /* copies the data once and keeps it under the name until remove(), so clips preloaded at
+     * startup are played by any number of players. adding a name again replaces its data,
+     * players already holding the old asset keep it.
+     */
+    static MemoryAssetSP add(const char * name, const uint8_t * data, size_t size);
+    static MemoryAssetSP get(const char * name);
+    static void remove(const char * name);
+
+    // the asset of a "mem://" uri, if some holder keeps it alive
+    static MemoryAssetSP find(const char * uri);
+    static bool isMemoryUri(const char * uri);
+
+private:
+    static MemoryAssetSP create_l(const uint8_t * data, size_t size, uint8_t * owned);
+
+    static Lock sLock;
+    static uint64_t sNextId;
+    static std::map<uint64_t, MMWeakPtr<MemoryAsset> > sAssets;
+    static std::map<std::string, MemoryAssetSP> sNamed;
+
+    MemoryAssetCache();
+    MM_DISALLOW_COPY(MemoryAssetCache);
+};
+
+} // YUNOS_MM
+
+#endif // memory_asset_h
@@ -134,6 +134,16 @@ class Pipeline : public MMMsgThread {
     virtual mm_status_t load(int fd, int64_t offset, int64_t length) { return MM_ERROR_UNSUPPORTED; }
     virtual mm_status_t loadSubtitleUri(const char * uri) { return MM_ERROR_UNSUPPORTED; }
 
+    // playlist, the queued uri are played after the loaded one, without gap if the source can join them
+    // returns: MM_ERROR_SUCCESS: successfuly executed.
+    //              others: error
+    virtual mm_status_t queueUri(const char * uri,
+                              const std::map<std::string, std::string> * headers = NULL) { return MM_ERROR_UNSUPPORTED; }
+    virtual mm_status_t clearQueue() { return MM_ERROR_UNSUPPORTED; }
+    // take the head of the queue, to load it when the source couldn't join it
+    // returns: false if the queue is empty
+    virtual bool dequeueUri(std::string & uri, std::map<std::string, std::string> & headers) { return false; }
+
     // set display name (for example X11 display name as hostname:protocol.port or Wayland nested display name)
     // returns: MM_ERROR_SUCCESS: successfuly executed.
     //              others:error
@@ -184,6 +194,18 @@ class Pipeline : public MMMsgThread {
     virtual mm_status_t setVolume(const float left, const float right) { return MM_ERROR_UNSUPPORTED; }
     virtual mm_status_t getVolume(float& left, float& right) const{ return MM_ERROR_UNSUPPORTED; }
     ComponentSP createComponentHelper(const char* componentName, const char* mimeType, bool isEncoder=false);
+
+    struct ComponentRequest {
+        ComponentRequest(const char* name, const char* mime, bool encoder = false)
+            : componentName(name), mimeType(mime), isEncoder(encoder) {}
+        const char* componentName;
+        const char* mimeType;
+        bool isEncoder;
+        ComponentSP component;  // result, NULL on failure
+    };
+    // create independent components in parallel: library loading and init of each one overlap.
+    // as createComponentHelper(), the pipeline listens to them
+    void createComponentsHelper(std::vector<ComponentRequest> & requests);
     static ComponentSP createComponentHelper(const char* componentName, const char* mimeType, Component::ListenerSP listener, bool isEncoder=true);
 
     static void printMsgInfo(int event, int param1, const char* _sender=NULL);
@@ -44,6 +44,10 @@ class PipelinePlayerBase : public Pipeline {
                               const std::map<std::string, std::string> * headers = NULL);
     virtual mm_status_t load(int fd, int64_t offset, int64_t length);
     virtual mm_status_t loadSubtitleUri(const char * uri);
+    virtual mm_status_t queueUri(const char * uri,
+                              const std::map<std::string, std::string> * headers = NULL);
+    virtual mm_status_t clearQueue();
+    virtual bool dequeueUri(std::string & uri, std::map<std::string, std::string> & headers);
 
     // set display name (for example X11 display name as hostname:protocol.port or Wayland nested display name)
     // returns: MM_ERROR_SUCCESS: successfuly executed.
@@ -176,6 +180,23 @@ class PipelinePlayerBase : public Pipeline {
     std::string mAudioConnectionId;
     mutable int64_t mSeekPositionMs;
 
+    // playlist
+    struct QueuedUri {
+        std::string mUri;
+        std::map<std::string, std::string> mHeaders;
+    };
+    // items joined by the source, not rendered yet
+    struct ItemBoundary {
+        int64_t mStartMs; // on the sink timeline
+        int64_t mDurationMs;
+        int32_t mLoop;    // > 0: the source wrapped to its start, loop count
+    };
+    std::list<QueuedUri> mUriQueue;
+    bool mNextUriHandedOver;
+    int64_t mItemStartMs; // start of the current item on the sink timeline
+    std::list<ItemBoundary> mItemBoundaries;
+    int32_t mSeamlessLoop; // PlaySourceComponent::PARAM_KEY_SEAMLESS_LOOP, given to each source
+
     bool mHasVideo;
     bool mHasAudio;
     bool mHasSubTitle;
@@ -192,6 +213,12 @@ class PipelinePlayerBase : public Pipeline {
     ClockSP mClock;
     std::string mDownloadPath;
 
+    // startup timing, saved to mMediaMeta as MEDIA_ATTR_PREPARE_TIME/MEDIA_ATTR_TIME_TO_FIRST_FRAME.
+    // the first frame is the first rendered video frame, or the start of an audio only content
+    int64_t mPrepareBeginUs;
+    int64_t mStartBeginUs;
+    bool mFirstFrameReported;
+
     PipelinePlayerBase();
     mm_status_t updateTrackInfo();
 
@@ -202,6 +229,11 @@ class PipelinePlayerBase : public Pipeline {
     DashSourceComponent* getDashSecondSourceComponent();
     PlaySinkComponent* getSinkComponent(Component::MediaType type) const;
     mm_status_t flushInternal(bool skipDemuxer=false);
+    void handOverNextUri();
+    void applySeamlessLoop();
+    int64_t sinkPositionMs() const;
+    void advanceItems(int64_t positionMs);
+    void reportFirstFrame();
 
     class StateAutoSet;
 
@@ -210,6 +242,7 @@ class PipelinePlayerBase : public Pipeline {
     DECLARE_MSG_LOOP()
     DECLARE_MSG_HANDLER2(onComponentMessage)
     DECLARE_MSG_HANDLER2(onCowMessage)
+    DECLARE_MSG_HANDLER(onCheckItemBoundary)
 
 }; // PipelinePlayerBase
 
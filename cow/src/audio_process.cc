@@ -0,0 +1,619 @@
+/**
+ * Copyright (C) 2017 Alibaba Group Holding Limited. All Rights Reserved.
+ *
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <list>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define AUDIO_PROCESS_NEON
+#endif
+
+#include "multimedia/mm_debug.h"
+#include "audio_process.h"
+
+namespace YUNOS_MM {
+
+MM_LOG_DEFINE_MODULE_NAME("AudioProcess")
+
+#define ENTER() VERBOSE(">>>\n")
+#define EXIT() do {VERBOSE(" <<<\n"); return;}while(0)
+#define EXIT_AND_RETURN(_code) do {VERBOSE("<<<(status: %d)\n", (_code)); return (_code);}while(0)
+
+static const char * AudioBufferPoolMetaName = "AudioBufferPoolPointer";
+static const char * AudioBufferChunkMetaName = "AudioBufferChunkPointer";
+// keep the chunk 16 bytes aligned for SIMD load/store
+static const int32_t CHUNK_ALIGN = 16;
+static const float S16_SCALE = 32768.0f;
+static const float S16_SCALE_INV = 1.0f / 32768.0f;
+
+////////////////////////////////////////////////////////////////////////
+// AudioBufferPool
+class AudioBufferPool::Core {
+  public:
+    Core(const char *name, int32_t maxFree)
+        : mName(name ? name : "AudioBufferPool")
+        , mMaxFree(maxFree)
+        , mRefs(1)
+        , mAllocated(0)
+    {
+    }
+
+    // chunk layout: [capacity(int32_t) + padding][data ...], data is what MediaBuffer sees
+    uint8_t *get(int32_t capacity)
+    {
+        {
+            MMAutoLock locker(mLock);
+            std::list<uint8_t*>::iterator it;
+            for (it = mFree.begin(); it != mFree.end(); ++it) {
+                if (chunkCapacity(*it) >= capacity) {
+                    uint8_t *data = *it;
+                    mFree.erase(it);
+                    mRefs++;
+                    return data;
+                }
+            }
+        }
+
+        // round up, so the chunk can be reused by slightly bigger frames later
+        int32_t rounded = (capacity + 1023) & ~1023;
+        void *mem = NULL;
+        if (posix_memalign(&mem, CHUNK_ALIGN, rounded + CHUNK_ALIGN) != 0 || !mem) {
+            ERROR("%s, fail to alloc %d bytes", mName.c_str(), rounded);
+            return NULL;
+        }
+        *(int32_t*)mem = rounded;
+
+        MMAutoLock locker(mLock);
+        mRefs++;
+        mAllocated++;
+        VERBOSE("%s, new chunk %d bytes, allocated %d", mName.c_str(), rounded, mAllocated);
+        return (uint8_t*)mem + CHUNK_ALIGN;
+    }
+
+    void put(uint8_t *data)
+    {
+        bool destroy = false;
+        {
+            MMAutoLock locker(mLock);
+            // the owner is gone (mMaxFree is 0 then) or enough cached
+            if ((int32_t)mFree.size() < mMaxFree) {
+                mFree.push_back(data);
+            } else {
+                free(data - CHUNK_ALIGN);
+                mAllocated--;
+            }
+            destroy = (--mRefs == 0);
+        }
+        if (destroy)
+            delete this;
+    }
+
+    void trim()
+    {
+        MMAutoLock locker(mLock);
+        while (!mFree.empty()) {
+            free(mFree.front() - CHUNK_ALIGN);
+            mFree.pop_front();
+            mAllocated--;
+        }
+    }
+
+    // called by the owner AudioBufferPool
+    void detach()
+    {
+        trim();
+        bool destroy = false;
+        {
+            MMAutoLock locker(mLock);
+            mMaxFree = 0;
+            destroy = (--mRefs == 0);
+        }
+        if (destroy)
+            delete this;
+    }
+
+  private:
+    ~Core() {}
+    static int32_t chunkCapacity(uint8_t *data) { return *(int32_t*)(data - CHUNK_ALIGN); }
+
+    std::string mName;
+    Lock mLock;
+    std::list<uint8_t*> mFree;
+    int32_t mMaxFree;
+    int32_t mRefs;
+    int32_t mAllocated;
+};
+
+static bool releasePooledBuffer(MediaBuffer *mediaBuffer)
+{
+    void *core = NULL;
+    void *data = NULL;
+    MediaMetaSP meta = mediaBuffer->getMediaMeta();
+    if (!meta || !meta->getPointer(AudioBufferPoolMetaName, core) || !core ||
+        !meta->getPointer(AudioBufferChunkMetaName, data) || !data) {
+        WARNING("seems pooled audio buffer leak");
+        return false;
+    }
+    static_cast<AudioBufferPool::Core*>(core)->put((uint8_t*)data);
+    return true;
+}
+
+AudioBufferPool::AudioBufferPool()
+    : mCore(NULL)
+{
+}
+
+AudioBufferPool::~AudioBufferPool()
+{
+    if (mCore)
+        mCore->detach();
+}
+
+/*static*/ AudioBufferPoolSP AudioBufferPool::create(const char *name, int32_t maxFreeChunks)
+{
+    AudioBufferPoolSP pool(new AudioBufferPool());
+    pool->mCore = new Core(name, maxFreeChunks);
+    return pool;
+}
+
+MediaBufferSP AudioBufferPool::getBuffer(int32_t capacity, uint8_t **data)
+{
+    MediaBufferSP buffer;
+    if (capacity <= 0 || !data)
+        return buffer;
+
+    *data = mCore->get(capacity);
+    if (!*data)
+        return buffer;
+
+    buffer = MediaBuffer::createMediaBuffer(MediaBuffer::MBT_RawAudio);
+    buffer->getMediaMeta()->setPointer(AudioBufferPoolMetaName, mCore);
+    buffer->getMediaMeta()->setPointer(AudioBufferChunkMetaName, *data);
+    buffer->addReleaseBufferFunc(releasePooledBuffer);
+    return buffer;
+}
+
+void AudioBufferPool::trim()
+{
+    mCore->trim();
+}
+
+////////////////////////////////////////////////////////////////////////
+// AudioKernels
+static inline int16_t clampS16(float v)
+{
+    if (v >= 32767.0f)
+        return 32767;
+    if (v <= -32768.0f)
+        return -32768;
+    return (int16_t)lrintf(v);
+}
+
+#if defined(AUDIO_PROCESS_NEON)
+// vcvtq truncates toward zero, round to nearest like cvtps/lrintf on the other paths
+static inline int32x4_t roundF32ToS32(float32x4_t v)
+{
+#if defined(__aarch64__)
+    return vcvtnq_s32_f32(v);
+#else
+    uint32x4_t sign = vandq_u32(vreinterpretq_u32_f32(v), vdupq_n_u32(0x80000000));
+    float32x4_t half = vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(vdupq_n_f32(0.5f)), sign));
+    return vcvtq_s32_f32(vaddq_f32(v, half));
+#endif
+}
+#endif
+
+/*static*/ void AudioKernels::s16ToF32(const int16_t *src, float *dst, int32_t samples)
+{
+    int32_t i = 0;
+#if defined(__SSE2__)
+    const __m128 scale = _mm_set1_ps(S16_SCALE_INV);
+    for (; i + 8 <= samples; i += 8) {
+        __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+        // sign extend by unpacking into the high half and arithmetic shift back
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16);
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+        _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+#elif defined(AUDIO_PROCESS_NEON)
+    for (; i + 8 <= samples; i += 8) {
+        int16x8_t s = vld1q_s16(src + i);
+        vst1q_f32(dst + i, vcvtq_n_f32_s32(vmovl_s16(vget_low_s16(s)), 15));
+        vst1q_f32(dst + i + 4, vcvtq_n_f32_s32(vmovl_s16(vget_high_s16(s)), 15));
+    }
+#endif
+    for (; i < samples; i++)
+        dst[i] = src[i] * S16_SCALE_INV;
+}
+
+/*static*/ void AudioKernels::f32ToS16(const float *src, int16_t *dst, int32_t samples)
+{
+    int32_t i = 0;
+#if defined(__SSE2__)
+    const __m128 scale = _mm_set1_ps(S16_SCALE);
+    for (; i + 8 <= samples; i += 8) {
+        // cvtps rounds to nearest, packs saturates to int16
+        __m128i lo = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(src + i), scale));
+        __m128i hi = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(src + i + 4), scale));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_packs_epi32(lo, hi));
+    }
+#elif defined(AUDIO_PROCESS_NEON)
+    const float32x4_t scale = vdupq_n_f32(S16_SCALE);
+    for (; i + 8 <= samples; i += 8) {
+        int32x4_t lo = roundF32ToS32(vmulq_f32(vld1q_f32(src + i), scale));
+        int32x4_t hi = roundF32ToS32(vmulq_f32(vld1q_f32(src + i + 4), scale));
+        vst1q_s16(dst + i, vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi)));
+    }
+#endif
+    for (; i < samples; i++)
+        dst[i] = clampS16(src[i] * S16_SCALE);
+}
+
+/*static*/ void AudioKernels::applyGainS16(int16_t *data, int32_t samples, float gain)
+{
+    int32_t i = 0;
+#if defined(__SSE2__)
+    const __m128 g = _mm_set1_ps(gain);
+    for (; i + 8 <= samples; i += 8) {
+        __m128i s = _mm_loadu_si128((const __m128i*)(data + i));
+        __m128 lo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16));
+        __m128 hi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16));
+        __m128i r = _mm_packs_epi32(_mm_cvtps_epi32(_mm_mul_ps(lo, g)), _mm_cvtps_epi32(_mm_mul_ps(hi, g)));
+        _mm_storeu_si128((__m128i*)(data + i), r);
+    }
+#elif defined(AUDIO_PROCESS_NEON)
+    const float32x4_t g = vdupq_n_f32(gain);
+    for (; i + 8 <= samples; i += 8) {
+        int16x8_t s = vld1q_s16(data + i);
+        float32x4_t lo = vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(s))), g);
+        float32x4_t hi = vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(s))), g);
+        vst1q_s16(data + i, vcombine_s16(vqmovn_s32(roundF32ToS32(lo)), vqmovn_s32(roundF32ToS32(hi))));
+    }
+#endif
+    for (; i < samples; i++)
+        data[i] = clampS16(data[i] * gain);
+}
+
+/*static*/ void AudioKernels::applyGainF32(float *data, int32_t samples, float gain)
+{
+    int32_t i = 0;
+#if defined(__SSE2__)
+    const __m128 g = _mm_set1_ps(gain);
+    for (; i + 4 <= samples; i += 4)
+        _mm_storeu_ps(data + i, _mm_mul_ps(_mm_loadu_ps(data + i), g));
+#elif defined(AUDIO_PROCESS_NEON)
+    const float32x4_t g = vdupq_n_f32(gain);
+    for (; i + 4 <= samples; i += 4)
+        vst1q_f32(data + i, vmulq_f32(vld1q_f32(data + i), g));
+#endif
+    for (; i < samples; i++)
+        data[i] *= gain;
+}
+
+/*static*/ void AudioKernels::mixF32(const float *src, float *dst, int32_t samples, float gain)
+{
+    int32_t i = 0;
+#if defined(__SSE2__)
+    const __m128 g = _mm_set1_ps(gain);
+    for (; i + 4 <= samples; i += 4)
+        _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(_mm_loadu_ps(src + i), g)));
+#elif defined(AUDIO_PROCESS_NEON)
+    const float32x4_t g = vdupq_n_f32(gain);
+    for (; i + 4 <= samples; i += 4)
+        vst1q_f32(dst + i, vmlaq_f32(vld1q_f32(dst + i), vld1q_f32(src + i), g));
+#endif
+    for (; i < samples; i++)
+        dst[i] += src[i] * gain;
+}
+
+/*static*/ void AudioKernels::mixS16ToF32(const int16_t *src, float *dst, int32_t samples, float gain)
+{
+    int32_t i = 0;
+    const float scale = gain * S16_SCALE_INV;
+#if defined(__SSE2__)
+    const __m128 g = _mm_set1_ps(scale);
+    for (; i + 8 <= samples; i += 8) {
+        __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128 lo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16));
+        __m128 hi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16));
+        _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(lo, g)));
+        _mm_storeu_ps(dst + i + 4, _mm_add_ps(_mm_loadu_ps(dst + i + 4), _mm_mul_ps(hi, g)));
+    }
+#elif defined(AUDIO_PROCESS_NEON)
+    const float32x4_t g = vdupq_n_f32(scale);
+    for (; i + 8 <= samples; i += 8) {
+        int16x8_t s = vld1q_s16(src + i);
+        float32x4_t lo = vcvtq_f32_s32(vmovl_s16(vget_low_s16(s)));
+        float32x4_t hi = vcvtq_f32_s32(vmovl_s16(vget_high_s16(s)));
+        vst1q_f32(dst + i, vmlaq_f32(vld1q_f32(dst + i), lo, g));
+        vst1q_f32(dst + i + 4, vmlaq_f32(vld1q_f32(dst + i + 4), hi, g));
+    }
+#endif
+    for (; i < samples; i++)
+        dst[i] += src[i] * scale;
+}
+
+/*static*/ void AudioKernels::deinterleaveS16ToF32(const int16_t *src, float **dst, int32_t channels, int32_t frames)
+{
+    int32_t i = 0;
+    if (channels == 1) {
+        s16ToF32(src, dst[0], frames);
+        return;
+    }
+#if defined(__SSE2__)
+    if (channels == 2) {
+        const __m128 scale = _mm_set1_ps(S16_SCALE_INV);
+        for (; i + 4 <= frames; i += 4) {
+            // L0 R0 L1 R1 L2 R2 L3 R3 -> take even/odd 16bit lanes
+            __m128i s = _mm_loadu_si128((const __m128i*)(src + i * 2));
+            __m128i l = _mm_srai_epi32(_mm_slli_epi32(s, 16), 16);
+            __m128i r = _mm_srai_epi32(s, 16);
+            _mm_storeu_ps(dst[0] + i, _mm_mul_ps(_mm_cvtepi32_ps(l), scale));
+            _mm_storeu_ps(dst[1] + i, _mm_mul_ps(_mm_cvtepi32_ps(r), scale));
+        }
+    }
+#elif defined(AUDIO_PROCESS_NEON)
+    if (channels == 2) {
+        for (; i + 4 <= frames; i += 4) {
+            int16x4x2_t s = vld2_s16(src + i * 2);
+            vst1q_f32(dst[0] + i, vcvtq_n_f32_s32(vmovl_s16(s.val[0]), 15));
+            vst1q_f32(dst[1] + i, vcvtq_n_f32_s32(vmovl_s16(s.val[1]), 15));
+        }
+    }
+#endif
+    for (; i < frames; i++) {
+        for (int32_t ch = 0; ch < channels; ch++)
+            dst[ch][i] = src[i * channels + ch] * S16_SCALE_INV;
+    }
+}
+
+/*static*/ void AudioKernels::interleaveF32ToS16(const float * const *src, int16_t *dst, int32_t channels, int32_t frames)
+{
+    int32_t i = 0;
+    if (channels == 1) {
+        f32ToS16(src[0], dst, frames);
+        return;
+    }
+#if defined(__SSE2__)
+    if (channels == 2) {
+        const __m128 scale = _mm_set1_ps(S16_SCALE);
+        for (; i + 4 <= frames; i += 4) {
+            __m128i l = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(src[0] + i), scale));
+            __m128i r = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(src[1] + i), scale));
+            __m128i l16 = _mm_packs_epi32(l, l);
+            __m128i r16 = _mm_packs_epi32(r, r);
+            _mm_storeu_si128((__m128i*)(dst + i * 2), _mm_unpacklo_epi16(l16, r16));
+        }
+    }
+#elif defined(AUDIO_PROCESS_NEON)
+    if (channels == 2) {
+        const float32x4_t scale = vdupq_n_f32(S16_SCALE);
+        for (; i + 4 <= frames; i += 4) {
+            int16x4x2_t d;
+            d.val[0] = vqmovn_s32(roundF32ToS32(vmulq_f32(vld1q_f32(src[0] + i), scale)));
+            d.val[1] = vqmovn_s32(roundF32ToS32(vmulq_f32(vld1q_f32(src[1] + i), scale)));
+            vst2_s16(dst + i * 2, d);
+        }
+    }
+#endif
+    for (; i < frames; i++) {
+        for (int32_t ch = 0; ch < channels; ch++)
+            dst[i * channels + ch] = clampS16(src[ch][i] * S16_SCALE);
+    }
+}
+
+/*static*/ bool AudioKernels::downmixF32(const float *src, int32_t inChannels, float *dst, int32_t outChannels, int32_t frames)
+{
+    static const float C = 0.7071f; // -3dB
+    int32_t i = 0;
+
+    if (inChannels == outChannels) {
+        memcpy(dst, src, frames * inChannels * sizeof(float));
+        return true;
+    }
+
+    if (inChannels == 1 && outChannels == 2) {
+        for (i = 0; i < frames; i++)
+            dst[i * 2] = dst[i * 2 + 1] = src[i];
+        return true;
+    }
+
+    if (inChannels == 2 && outChannels == 1) {
+#if defined(__SSE2__)
+        const __m128 half = _mm_set1_ps(0.5f);
+        for (; i + 4 <= frames; i += 4) {
+            __m128 a = _mm_loadu_ps(src + i * 2);       // L0 R0 L1 R1
+            __m128 b = _mm_loadu_ps(src + i * 2 + 4);   // L2 R2 L3 R3
+            __m128 l = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+            __m128 r = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+            _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_add_ps(l, r), half));
+        }
+#elif defined(AUDIO_PROCESS_NEON)
+        for (; i + 4 <= frames; i += 4) {
+            float32x4x2_t s = vld2q_f32(src + i * 2);
+            vst1q_f32(dst + i, vmulq_n_f32(vaddq_f32(s.val[0], s.val[1]), 0.5f));
+        }
+#endif
+        for (; i < frames; i++)
+            dst[i] = (src[i * 2] + src[i * 2 + 1]) * 0.5f;
+        return true;
+    }
+
+    if (outChannels != 1 && outChannels != 2)
+        return false;
+
+    // FL FR FC LFE BL BR [SL SR], LFE is dropped
+    for (i = 0; i < frames; i++) {
+        const float *s = src + i * inChannels;
+        float l, r;
+        if (inChannels >= 6) {
+            l = s[0] + C * s[2] + C * s[4];
+            r = s[1] + C * s[2] + C * s[5];
+            if (inChannels >= 8) {
+                l += C * s[6];
+                r += C * s[7];
+            }
+            // normalize so a full scale input can not clip
+            l *= (inChannels >= 8) ? 1.0f / (1.0f + 3 * C) : 1.0f / (1.0f + 2 * C);
+            r *= (inChannels >= 8) ? 1.0f / (1.0f + 3 * C) : 1.0f / (1.0f + 2 * C);
+        } else {
+            // 3/4/5 channels: average even/odd channels
+            l = r = 0.0f;
+            for (int32_t ch = 0; ch < inChannels; ch++) {
+                if (ch & 1)
+                    r += s[ch];
+                else
+                    l += s[ch];
+            }
+            l /= (inChannels + 1) / 2;
+            r /= inChannels / 2;
+        }
+        if (outChannels == 2) {
+            dst[i * 2] = l;
+            dst[i * 2 + 1] = r;
+        } else {
+            dst[i] = (l + r) * 0.5f;
+        }
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////
+// AudioProcessor
+AudioProcessor::AudioProcessor(const char *name)
+    : mName(name ? name : "AudioProcessor")
+    , mInFormat(SND_FORMAT_PCM_16_BIT)
+    , mInChannels(2)
+    , mOutFormat(SND_FORMAT_PCM_16_BIT)
+    , mOutChannels(2)
+    , mGain(1.0f)
+{
+    mPool = AudioBufferPool::create(mName.c_str());
+}
+
+AudioProcessor::~AudioProcessor()
+{
+}
+
+/*static*/ bool AudioProcessor::isFormatSupported(snd_format_t format)
+{
+    return format == SND_FORMAT_PCM_16_BIT || format == SND_FORMAT_PCM_FLOAT;
+}
+
+mm_status_t AudioProcessor::configure(snd_format_t inFormat, int32_t inChannels, snd_format_t outFormat, int32_t outChannels)
+{
+    ENTER();
+    if (!isFormatSupported(inFormat) || !isFormatSupported(outFormat)) {
+        ERROR("%s, unsupported format 0x%x -> 0x%x", mName.c_str(), inFormat, outFormat);
+        EXIT_AND_RETURN(MM_ERROR_UNSUPPORTED);
+    }
+    if (inChannels <= 0 || inChannels > 8 || outChannels <= 0 ||
+        (outChannels > inChannels && !(inChannels == 1 && outChannels == 2)) ||
+        (outChannels != inChannels && outChannels > 2)) {
+        ERROR("%s, unsupported channel mapping %d -> %d", mName.c_str(), inChannels, outChannels);
+        EXIT_AND_RETURN(MM_ERROR_UNSUPPORTED);
+    }
+
+    mInFormat = inFormat;
+    mInChannels = inChannels;
+    mOutFormat = outFormat;
+    mOutChannels = outChannels;
+    INFO("%s, format 0x%x -> 0x%x, channels %d -> %d", mName.c_str(), inFormat, outFormat, inChannels, outChannels);
+    EXIT_AND_RETURN(MM_ERROR_SUCCESS);
+}
+
+void AudioProcessor::setGain(float gain)
+{
+    mGain = gain < 0.0f ? 0.0f : gain;
+}
+
+bool AudioProcessor::isPassThrough() const
+{
+    return mInFormat == mOutFormat && mInChannels == mOutChannels && mGain == 1.0f;
+}
+
+MediaBufferSP AudioProcessor::process(const MediaBufferSP &in)
+{
+    uint8_t *src = NULL;
+    int32_t offset = 0;
+    int32_t size = 0;
+
+    if (!in || isPassThrough())
+        return in;
+    // audio buffers keep the payload size in strides[0], it starts at offset
+    if (!in->getBufferInfo((uintptr_t*)&src, &offset, &size, 1) || !src)
+        return in;
+    if (size <= 0)
+        return in;
+    src += offset;
+
+    int32_t inSampleSize = mInFormat == SND_FORMAT_PCM_FLOAT ? sizeof(float) : sizeof(int16_t);
+    int32_t outSampleSize = mOutFormat == SND_FORMAT_PCM_FLOAT ? sizeof(float) : sizeof(int16_t);
+    int32_t frames = size / inSampleSize / mInChannels;
+    int32_t outSize = frames * mOutChannels * outSampleSize;
+
+    uint8_t *dst = NULL;
+    MediaBufferSP out = mPool->getBuffer(outSize, &dst);
+    if (!out) {
+        ERROR("%s, no mem", mName.c_str());
+        return MediaBufferSP((MediaBuffer*)NULL);
+    }
+
+    if (mInFormat == SND_FORMAT_PCM_16_BIT && mOutFormat == SND_FORMAT_PCM_16_BIT && mInChannels == mOutChannels) {
+        // volume only, skip the float domain
+        memcpy(dst, src, outSize);
+        AudioKernels::applyGainS16((int16_t*)dst, frames * mOutChannels, mGain);
+    } else {
+        const float *fin = (const float*)src;
+        if (mInFormat == SND_FORMAT_PCM_16_BIT) {
+            mScratch.resize(frames * mInChannels);
+            AudioKernels::s16ToF32((const int16_t*)src, &mScratch[0], frames * mInChannels);
+            fin = &mScratch[0];
+        }
+
+        float *fout = (float*)dst;
+        if (mOutFormat == SND_FORMAT_PCM_16_BIT) {
+            mMixScratch.resize(frames * mOutChannels);
+            fout = &mMixScratch[0];
+        }
+        AudioKernels::downmixF32(fin, mInChannels, fout, mOutChannels, frames);
+        if (mGain != 1.0f)
+            AudioKernels::applyGainF32(fout, frames * mOutChannels, mGain);
+        if (mOutFormat == SND_FORMAT_PCM_16_BIT)
+            AudioKernels::f32ToS16(fout, (int16_t*)dst, frames * mOutChannels);
+    }
+
+    out->setBufferInfo((uintptr_t*)&dst, NULL, &outSize, 1);
+    out->setSize(outSize);
+    out->setPts(in->pts());
+    out->setDts(in->dts());
+    out->setDuration(in->duration());
+    out->setBirthTimeInMs(in->birthTimeInMs());
+    if (in->isFlagSet(MediaBuffer::MBFT_EOS))
+        out->setFlag(MediaBuffer::MBFT_EOS);
+    if (in->isFlagSet(MediaBuffer::MBFT_Discontinue))
+        out->setFlag(MediaBuffer::MBFT_Discontinue);
+    return out;
+}
+
+} // end of namespace YUNOS_MM
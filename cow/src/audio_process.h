@@ -0,0 +1,130 @@
+/**
+ * Copyright (C) 2017 Alibaba Group Holding Limited. All Rights Reserved.
+ *
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef audio_process_h
+#define audio_process_h
+
+#include <stdint.h>
+#include <vector>
+#include <string>
+
+#include "multimedia/mm_types.h"
+#include "multimedia/mm_errors.h"
+#include "multimedia/mm_cpp_utils.h"
+#include "multimedia/mm_audio.h"
+#include "multimedia/media_buffer.h"
+
+namespace YUNOS_MM {
+
+/*
+ * AudioBufferPool recycles fixed-capacity PCM chunks for MBT_RawAudio MediaBuffers.
+ * a buffer returned by getBuffer() goes back to the pool when the last MediaBufferSP
+ * reference goes away, even if the pool itself has been destroyed in between
+ * (the chunks are freed then).
+ */
+class AudioBufferPool;
+typedef MMSharedPtr<AudioBufferPool> AudioBufferPoolSP;
+
+class AudioBufferPool {
+  public:
+    // maxFreeChunks limits the memory kept for reuse, chunks beyond it are freed on return
+    static AudioBufferPoolSP create(const char *name, int32_t maxFreeChunks = 16);
+    ~AudioBufferPool();
+
+    // get a MBT_RawAudio buffer backed by a chunk of at least 'capacity' bytes.
+    // buffer info is left to the caller: setBufferInfo(data, NULL, &validSize, 1) once the data is ready
+    MediaBufferSP getBuffer(int32_t capacity, uint8_t **data);
+
+    // drop all the cached free chunks
+    void trim();
+
+    class Core;
+
+  private:
+    AudioBufferPool();
+    Core *mCore;
+
+    MM_DISALLOW_COPY(AudioBufferPool)
+};
+
+/*
+ * PCM kernels shared by audio decoder/encoder/sinks; SSE2/NEON versions are used when
+ * the compiler targets them, plain C otherwise.
+ * sample counts are 'samples' (frames * channels) for interleaved data, frames for planar.
+ */
+class AudioKernels {
+  public:
+    static void s16ToF32(const int16_t *src, float *dst, int32_t samples);
+    static void f32ToS16(const float *src, int16_t *dst, int32_t samples);
+    static void applyGainS16(int16_t *data, int32_t samples, float gain);
+    static void applyGainF32(float *data, int32_t samples, float gain);
+
+    // accumulate src * gain into dst, the mixing bus is kept in F32 to avoid clipping between inputs
+    static void mixF32(const float *src, float *dst, int32_t samples, float gain);
+    static void mixS16ToF32(const int16_t *src, float *dst, int32_t samples, float gain);
+
+    // interleaved S16 <-> planar F32, which is AV_SAMPLE_FMT_FLTP of most ffmpeg encoders
+    static void deinterleaveS16ToF32(const int16_t *src, float **dst, int32_t channels, int32_t frames);
+    static void interleaveF32ToS16(const float * const *src, int16_t *dst, int32_t channels, int32_t frames);
+
+    // down-mix interleaved F32 to mono or stereo; 5.1/7.1 follow the ITU-R BS.775 coefficients
+    static bool downmixF32(const float *src, int32_t inChannels, float *dst, int32_t outChannels, int32_t frames);
+};
+
+/*
+ * AudioProcessor converts interleaved PCM between S16/F32, down-mixes channels and applies
+ * software gain in one pass, output buffers come from an AudioBufferPool.
+ * timestamps, flags and duration of the input buffer are kept.
+ */
+class AudioProcessor;
+typedef MMSharedPtr<AudioProcessor> AudioProcessorSP;
+
+class AudioProcessor {
+  public:
+    AudioProcessor(const char *name);
+    ~AudioProcessor();
+
+    // support SND_FORMAT_PCM_16_BIT and SND_FORMAT_PCM_FLOAT, outChannels <= inChannels (or mono->stereo)
+    mm_status_t configure(snd_format_t inFormat, int32_t inChannels, snd_format_t outFormat, int32_t outChannels);
+    void setGain(float gain);
+    float gain() const { return mGain; }
+
+    // nothing to do, caller can use the input buffer directly
+    bool isPassThrough() const;
+
+    // return a new (pooled) buffer, or the input buffer when isPassThrough() or it has no data (EOS)
+    MediaBufferSP process(const MediaBufferSP &in);
+
+    static bool isFormatSupported(snd_format_t format);
+
+  private:
+    std::string mName;
+    snd_format_t mInFormat;
+    int32_t mInChannels;
+    snd_format_t mOutFormat;
+    int32_t mOutChannels;
+    float mGain;
+    AudioBufferPoolSP mPool;
+    std::vector<float> mScratch;
+    std::vector<float> mMixScratch;
+
+    MM_DISALLOW_COPY(AudioProcessor)
+};
+
+} // end of namespace YUNOS_MM
+
+#endif // audio_process_h
@@ -74,7 +74,8 @@ mm_status_t Clock::getCurrentPositionFromAnchor_l(int64_t &mediaUs) {
         return MM_ERROR_INVALID_PARAM;
     }
 
-    int64_t positionUs = (nowUs - mAnchorTimeRealUs) + mAnchorTimeMediaUs;
+    // media time runs at the play rate, backwards for reverse trick play
+    int64_t positionUs = (nowUs - mAnchorTimeRealUs) * mScaledPlayRate / SCALED_PLAY_RATE + mAnchorTimeMediaUs;
     VERBOSE("nowUs %0.3f, mAnchorTimeRealUs %0.3f, mAnchorTimeMediaUs %0.3f, positionUs %0.3f, mAnchorTimeMaxUs %0.3f\n",
         nowUs/1000000.0f, mAnchorTimeRealUs/1000000.0f, mAnchorTimeMediaUs/1000000.0f, positionUs/1000000.0f, mAnchorTimeMaxUs/1000000.0f);
 
@@ -64,6 +64,10 @@ const char * SourceComponent::PARAM_KEY_PREPARE_TIMEOUT = "prepare-timeout";
 const char * SourceComponent::PARAM_KEY_READ_TIMEOUT = "read-timeout";
 
 const char * PlaySourceComponent::PARAM_KEY_BUFFERING_TIME = "buffering-time";
+const char * PlaySourceComponent::PARAM_KEY_PROBE_SIZE = "probe-size";
+const char * PlaySourceComponent::PARAM_KEY_ANALYZE_DURATION = "analyze-duration";
+const char * PlaySourceComponent::PARAM_KEY_PROBE_CACHE = "probe-cache";
+const char * PlaySourceComponent::PARAM_KEY_SEAMLESS_LOOP = "seamless-loop";
 const char * DashSourceComponent::PARAM_KEY_SEGMENT_BUFFER = "segment-buffer";
 
 MMParamSP nilParam;
@@ -20,6 +20,11 @@
 #include <dlfcn.h>
 #include <vector>
 #include <algorithm>
+#include <unordered_map>
+#include <stdio.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
 
 
 #include <multimedia/component.h>
@@ -39,6 +44,8 @@ ComponentFactory::MComponentMap ComponentFactory::mComponentMap;
 
 Lock ComponentFactory::mLock;
 
+ComponentFactory::Registry *ComponentFactory::mRegistry = NULL;
+
 static const char* gXmlFileList[] = {
     "cow_plugins.xml",
 #ifdef __MM_NATIVE_BUILD__
@@ -51,113 +58,158 @@ static const char* gXmlFileList[] = {
 static std::vector<ComNameLibName> kComponentsNameToLibMap;
 static std::vector<MimeTypeComName> kMimeTypeToComName;
 
-// C++ issue, it can't be declared inside ::create when it is used for STL
-struct ComWithPriority {
-    ComWithPriority(const char *name, int32_t pri)
-        : comName(name)
-        , priority(pri)
-        {}
-    ComWithPriority() : comName(NULL), priority(LOW_PRIORITY-1) {}
-
-    void operator()(ComWithPriority &com) {
-        DEBUG("comName:%s, priority:%d\n", PRINTABLE_STR(com.comName), com.priority);
-    }
+// compiled from the two tables above, immutable once published
+struct ComponentFactory::Registry {
+    struct Candidate {
+        std::string mComName;
+        std::string mLibName;
+        int32_t mCap;
+        int32_t mPriority;
 
-    bool operator < (const ComWithPriority &m)const {
-        return priority > m.priority;
-    }
+        bool operator < (const Candidate &m) const {
+            return mPriority > m.mPriority;
+        }
+    };
+    typedef std::vector<Candidate> CandidateList;       // sorted by priority, high first
+    typedef std::unordered_map<std::string, CandidateList> MimeMap;
+    typedef std::unordered_map<std::string, std::string> LibMap;
 
-    const char *comName;
-    int32_t priority;
+    MimeMap mMimes;
+    LibMap mLibs;       // component name -> library
 };
 
-/*static*/
-ComponentSP ComponentFactory::loadComponent_l(const char* libNameWithPath, const char* mimeType, bool isEncoder)
-{
-    void *libHandle = NULL;
-    ComponentInfo::CreateComponentFunc create = NULL;
+#define COW_REGISTRY_CACHE_MAGIC    0x47455243  // 'CREG'
+#define COW_REGISTRY_CACHE_VERSION  1
+#define COW_REGISTRY_CACHE_MAX_SIZE (4 * 1024 * 1024)
 
-    INFO("[%s]: mComponentMap.size(): %d, libNameWithPath: %s, isEncoder: %d",
-        PRINTABLE_STR(mimeType), mComponentMap.size(), PRINTABLE_STR(libNameWithPath), isEncoder);
+static bool isResidentLibrary(const std::string &libName)
+{
+    //skip libMediaCodecComponent.so
+    return strstr(libName.c_str(), "MediaCodecComponent") != NULL;
+}
 
-    ComponentInfoSP info;
-    MComponentMap::iterator ite = mComponentMap.find(std::string(libNameWithPath));
-    if ( ite == mComponentMap.end() ) {
+/*static*/
+ComponentFactory::ComponentInfoSP ComponentFactory::openLibrary(const char* libNameWithPath)
+{
+    void *libHandle = dlopen(libNameWithPath, RTLD_NOW);
+    if (libHandle == NULL) {
+        ERROR("unable to dlopen %s, error: %s", libNameWithPath, dlerror());
+        return ComponentInfoSP();
+    }
 
-        libHandle = dlopen(libNameWithPath, RTLD_NOW);
-        if (libHandle == NULL) {
-            ERROR("unable to dlopen %s, error: %s", libNameWithPath, dlerror());
-            return ComponentSP((Component*)NULL);
-        }
+    //Use command "readelf -s -W libXXX.so" to find the right symbols
+    ComponentInfo::CreateComponentFunc create =
+        (ComponentInfo::CreateComponentFunc)dlsym(libHandle, "createComponent");
+    if (create == NULL) {
+        create = (ComponentInfo::CreateComponentFunc)dlsym(libHandle, "_Z15createComponentPKcb");
+    }
 
-        //Use command "readelf -s -W libXXX.so" to find the right symbols
-        create = (ComponentInfo::CreateComponentFunc)dlsym(libHandle, "createComponent");
-        if (create == NULL) {
-            create = (ComponentInfo::CreateComponentFunc)dlsym(libHandle, "_Z15createComponentPKcb");
-        }
+    ComponentInfo::ReleaseComponentFunc release =
+        (ComponentInfo::ReleaseComponentFunc)dlsym(libHandle, "releaseComponent");
+    if (release == NULL) {
+        release =
+            (ComponentInfo::ReleaseComponentFunc)dlsym(libHandle, "_Z16releaseComponentPN8YUNOS_MM9ComponentE");
+    }
 
-        ComponentInfo::ReleaseComponentFunc release =
-            (ComponentInfo::ReleaseComponentFunc)dlsym(libHandle, "releaseComponent");
-        if (release == NULL) {
-            release =
-                (ComponentInfo::ReleaseComponentFunc)dlsym(libHandle, "_Z16releaseComponentPN8YUNOS_MM9ComponentE");
-        }
+    if (create == NULL || release == NULL) {
+        ERROR("load create OR release method failed, error %s", dlerror());
+        dlclose(libHandle);
+        return ComponentInfoSP();
+    }
 
-        if (create == NULL || release == NULL) {
-            dlclose(libHandle);
-            libHandle = NULL;
-            ERROR("load create OR release method failed, error %s", dlerror());
-            return ComponentSP((Component*)NULL);
-        }
+    ComponentInfoSP info(new ComponentInfo);
+    info->mCreate = create;
+    info->mRelease = release;
+    info->mLibHandle = libHandle;
+    info->mLibComName = libNameWithPath;
+    return info;
+}
 
-        info.reset(new ComponentInfo);
-        //skip libMediaCodecComponent.so
-        if (!info && strstr(libNameWithPath, "MediaCodecComponent") == NULL) {
-            ERROR("no memory, size %zu", sizeof(ComponentInfo));
-            dlclose(libHandle);
-            libHandle = NULL;
-            return ComponentSP((Component*)NULL);
+/*static*/
+ComponentFactory::ComponentInfoSP ComponentFactory::acquireLibrary(const char* libNameWithPath)
+{
+    std::string libName(libNameWithPath);
+    {
+        MMAutoLock locker(mLock);
+        MComponentMap::iterator ite = mComponentMap.find(libName);
+        if (ite != mComponentMap.end()) {
+            ite->second->mPending++;
+            return ite->second;
         }
+    }
 
-        info->mCreate = create;
-        info->mRelease = release;
-        info->mLibHandle = libHandle;
-        info->mLibComName = libNameWithPath;
-        mComponentMap.insert(MComponentMapPair(std::string(libNameWithPath), info));
+    // dlopen runs the static constructors of the library, don't block other creates
+    int64_t begin = getTimeUs();
+    ComponentInfoSP info = openLibrary(libNameWithPath);
+    if (!info)
+        return info;
+    INFO("open %s success, handle %p, cost %" PRId64 " us",
+        libNameWithPath, info->mLibHandle, getTimeUs() - begin);
 
-        INFO("[%s]: open %s success, handle %p", mimeType, libNameWithPath, libHandle);
-    }else {
-        INFO("%s is already opened, components.size: %zu",
-            ite->first.c_str(), ite->second->mComponent.size());
+    MMAutoLock locker(mLock);
+    MComponentMap::iterator ite = mComponentMap.find(libName);
+    if (ite != mComponentMap.end()) {
+        // opened by another thread meanwhile, only drops our reference
+        dlclose(info->mLibHandle);
         info = ite->second;
+    } else {
+        mComponentMap.insert(MComponentMapPair(libName, info));
     }
+    info->mPending++;
+    return info;
+}
+
+/*static*/
+void ComponentFactory::closeLibraryIfUnused_l(const std::string &libName)
+{
+    MComponentMap::iterator ite = mComponentMap.find(libName);
+    if (ite == mComponentMap.end())
+        return;
+
+    ComponentInfoSP &info = ite->second;
+    if (!info->mComponent.empty() || info->mPending > 0 || info->mResident || isResidentLibrary(libName))
+        return;
+
+    DEBUG("close %s begin, handle %p", libName.c_str(), info->mLibHandle);
+    dlclose(info->mLibHandle);
+    INFO("close %s end", libName.c_str());
+    mComponentMap.erase(ite);
+}
+
+/*static*/
+ComponentSP ComponentFactory::loadComponent(const char* libNameWithPath, const char* mimeType, bool isEncoder)
+{
+    INFO("[%s]: libNameWithPath: %s, isEncoder: %d",
+        PRINTABLE_STR(mimeType), PRINTABLE_STR(libNameWithPath), isEncoder);
+
+    // mPending keeps the library loaded while the component is created out of the lock
+    ComponentInfoSP info = acquireLibrary(libNameWithPath);
+    if (!info)
+        return ComponentSP((Component*)NULL);
 
-    Component* com = NULL;
-    create = info->mCreate;
-    com = (*create)(mimeType, isEncoder);
+    Component* com = (*info->mCreate)(mimeType, isEncoder);
     if (!com) {
-        //skip libMediaCodecComponent.so
-        if(libHandle && strstr(libNameWithPath, "MediaCodecComponent") == NULL){
-            dlclose(libHandle);
-            libHandle = NULL;
-        }
         ERROR("com create method failed");
-        return ComponentSP((Component*)NULL);
+    } else {
+        mm_status_t status = com->init();
+        VERBOSE("%s's version:%s\n",libNameWithPath,com->version());
+        if (status != MM_ERROR_SUCCESS) {
+            ERROR("com %s init failed %d", com->name(), status);
+            delete com;
+            com = NULL;
+        }
     }
 
-    mm_status_t status = com->init();
-    VERBOSE("%s's version:%s\n",libNameWithPath,com->version());
-    if (status != MM_ERROR_SUCCESS) {
-        ERROR("com %s init failed %d", com->name(), status);
-        delete com;
+    MMAutoLock locker(mLock);
+    info->mPending--;
+    if (!com) {
+        closeLibraryIfUnused_l(info->mLibComName);
         return ComponentSP((Component*)NULL);
     }
 
-    if (com != NULL) {
-        info->mComponent.push_back(com);
-        INFO("%p added to %s,  mComponent.size %zu",
-            com, libNameWithPath, info->mComponent.size());
-    }
+    info->mComponent.push_back(com);
+    INFO("%p added to %s,  mComponent.size %zu",
+        com, libNameWithPath, info->mComponent.size());
 
     ComponentSP componentSP(com, &ComponentFactory::release);
     return componentSP;
@@ -211,6 +263,226 @@ bool ComponentFactory::loadXmlFile_l(const char* xmlFile)
     return true;
 }
 
+// (mtime sec, mtime nsec, size) of a xml file, -1 if it doesn't exist
+static void getXmlStamp(const std::string &file, std::vector<int64_t> &stamps)
+{
+    struct stat st;
+    if (stat(file.c_str(), &st) != 0) {
+        stamps.push_back(-1);
+        stamps.push_back(-1);
+        stamps.push_back(-1);
+        return;
+    }
+    stamps.push_back(st.st_mtim.tv_sec);
+    stamps.push_back(st.st_mtim.tv_nsec);
+    stamps.push_back(st.st_size);
+}
+
+namespace {
+
+class CacheWriter {
+public:
+    void putInt(int64_t value) {
+        mData.append((const char*)&value, sizeof(value));
+    }
+    void putString(const std::string &str) {
+        putInt(str.size());
+        mData.append(str);
+    }
+    const std::string & data() const { return mData; }
+
+private:
+    std::string mData;
+};
+
+class CacheReader {
+public:
+    CacheReader(const std::string &data) : mData(data), mPos(0), mError(false) {}
+
+    int64_t getInt() {
+        int64_t value = 0;
+        if (mError || mData.size() - mPos < sizeof(value)) {
+            mError = true;
+            return 0;
+        }
+        memcpy(&value, mData.data() + mPos, sizeof(value));
+        mPos += sizeof(value);
+        return value;
+    }
+    std::string getString() {
+        int64_t size = getInt();
+        if (mError || size < 0 || (uint64_t)size > mData.size() - mPos) {
+            mError = true;
+            return std::string();
+        }
+        std::string str(mData, mPos, size);
+        mPos += size;
+        return str;
+    }
+    bool error() const { return mError; }
+
+private:
+    const std::string &mData;
+    size_t mPos;
+    bool mError;
+};
+
+}
+
+/*static*/
+bool ComponentFactory::loadCache_l(const std::string &cacheFile, const std::vector<std::string> &xmlFiles)
+{
+    FILE *fp = fopen(cacheFile.c_str(), "rb");
+    if (!fp)
+        return false;
+
+    std::string data;
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0 && data.size() < COW_REGISTRY_CACHE_MAX_SIZE)
+        data.append(buf, n);
+    fclose(fp);
+
+    CacheReader reader(data);
+    if (reader.getInt() != COW_REGISTRY_CACHE_MAGIC || reader.getInt() != COW_REGISTRY_CACHE_VERSION) {
+        WARNING("invalid registry cache %s", cacheFile.c_str());
+        return false;
+    }
+
+    // stale if any xml file is added, removed or modified
+    if (reader.getInt() != (int64_t)xmlFiles.size())
+        return false;
+    for (size_t i = 0; i < xmlFiles.size(); i++) {
+        std::vector<int64_t> stamps;
+        getXmlStamp(xmlFiles[i], stamps);
+        if (reader.getString() != xmlFiles[i])
+            return false;
+        for (size_t j = 0; j < stamps.size(); j++) {
+            if (reader.getInt() != stamps[j]) {
+                INFO("%s changed, registry cache is stale", xmlFiles[i].c_str());
+                return false;
+            }
+        }
+    }
+
+    std::vector<ComNameLibName> libs;
+    int64_t count = reader.getInt();
+    for (int64_t i = 0; i < count && !reader.error(); i++) {
+        ComNameLibName lib;
+        lib.mComName = reader.getString();
+        lib.mLibName = reader.getString();
+        libs.push_back(lib);
+    }
+
+    std::vector<MimeTypeComName> mimes;
+    count = reader.getInt();
+    for (int64_t i = 0; i < count && !reader.error(); i++) {
+        MimeTypeComName mime;
+        mime.mMimeType = reader.getString();
+        mime.mComName = reader.getString();
+        mime.mCap = reader.getInt();
+        mime.mPriority = reader.getInt();
+        mimes.push_back(mime);
+    }
+
+    if (reader.error() || libs.empty() || mimes.empty()) {
+        WARNING("truncated registry cache %s", cacheFile.c_str());
+        return false;
+    }
+
+    kComponentsNameToLibMap.swap(libs);
+    kMimeTypeToComName.swap(mimes);
+    INFO("load registry cache %s: %zu,%zu", cacheFile.c_str(),
+        kComponentsNameToLibMap.size(), kMimeTypeToComName.size());
+    return true;
+}
+
+/*static*/
+void ComponentFactory::saveCache_l(const std::string &cacheFile, const std::vector<std::string> &xmlFiles,
+                                   const std::vector<int64_t> &xmlStamps)
+{
+    CacheWriter writer;
+    writer.putInt(COW_REGISTRY_CACHE_MAGIC);
+    writer.putInt(COW_REGISTRY_CACHE_VERSION);
+
+    writer.putInt(xmlFiles.size());
+    for (size_t i = 0; i < xmlFiles.size(); i++) {
+        writer.putString(xmlFiles[i]);
+        for (size_t j = i * 3; j < i * 3 + 3; j++)
+            writer.putInt(xmlStamps[j]);
+    }
+
+    writer.putInt(kComponentsNameToLibMap.size());
+    for (size_t i = 0; i < kComponentsNameToLibMap.size(); i++) {
+        writer.putString(kComponentsNameToLibMap[i].mComName);
+        writer.putString(kComponentsNameToLibMap[i].mLibName);
+    }
+
+    writer.putInt(kMimeTypeToComName.size());
+    for (size_t i = 0; i < kMimeTypeToComName.size(); i++) {
+        writer.putString(kMimeTypeToComName[i].mMimeType);
+        writer.putString(kMimeTypeToComName[i].mComName);
+        writer.putInt(kMimeTypeToComName[i].mCap);
+        writer.putInt(kMimeTypeToComName[i].mPriority);
+    }
+
+    // other processes may read the cache meanwhile, replace it atomically
+    char tmpFile[256];
+    snprintf(tmpFile, sizeof(tmpFile), "%s.%d", cacheFile.c_str(), getpid());
+    FILE *fp = fopen(tmpFile, "wb");
+    if (!fp) {
+        WARNING("fail to create %s", tmpFile);
+        return;
+    }
+    const std::string &data = writer.data();
+    bool ok = fwrite(data.data(), 1, data.size(), fp) == data.size();
+    ok = (fclose(fp) == 0) && ok;
+    if (!ok || rename(tmpFile, cacheFile.c_str()) != 0) {
+        WARNING("fail to write registry cache %s", cacheFile.c_str());
+        unlink(tmpFile);
+        return;
+    }
+    INFO("registry cache saved to %s, size %zu", cacheFile.c_str(), data.size());
+}
+
+/*static*/
+void ComponentFactory::buildRegistry_l()
+{
+    Registry *reg = new Registry;
+
+    for (size_t i = 0; i < kComponentsNameToLibMap.size(); i++) {
+        // the first library of a component wins, as the linear lookup did
+        reg->mLibs.insert(std::make_pair(kComponentsNameToLibMap[i].mComName,
+            kComponentsNameToLibMap[i].mLibName));
+    }
+
+    for (size_t i = 0; i < kMimeTypeToComName.size(); i++) {
+        const MimeTypeComName &entry = kMimeTypeToComName[i];
+        if (entry.mPriority < 0)
+            continue;
+        Registry::LibMap::iterator lib = reg->mLibs.find(entry.mComName);
+        if (lib == reg->mLibs.end()) {
+            WARNING("[%s]: no library for %s", entry.mMimeType.c_str(), entry.mComName.c_str());
+            continue;
+        }
+
+        Registry::Candidate candidate;
+        candidate.mComName = entry.mComName;
+        candidate.mLibName = lib->second;
+        candidate.mCap = entry.mCap;
+        candidate.mPriority = entry.mPriority;
+        reg->mMimes[entry.mMimeType].push_back(candidate);
+    }
+
+    for (Registry::MimeMap::iterator it = reg->mMimes.begin(); it != reg->mMimes.end(); it++)
+        std::stable_sort(it->second.begin(), it->second.end());
+
+    INFO("registry built, %zu components, %zu mime types", reg->mLibs.size(), reg->mMimes.size());
+
+    // the previous registry may still be in use by a lock free lookup, it is leaked (appendPluginsXml only)
+    __atomic_store_n(&mRegistry, reg, __ATOMIC_RELEASE);
+}
+
 /*static*/
 bool ComponentFactory::loadDefaultXmlIfNeeded_l()
 {
@@ -224,21 +496,53 @@ bool ComponentFactory::loadDefaultXmlIfNeeded_l()
     std::string xmlFilePath = mm_get_env_str(NULL, "COW_XML_PATH");
     if (xmlFilePath.empty())
         xmlFilePath = _COW_XML_PATH;
+    std::vector<std::string> xmlFiles;
     for (i=0; i<sizeof(gXmlFileList)/sizeof(gXmlFileList[0]); i++) {
         std::string xmlFileName =  xmlFilePath;
         xmlFileName.append("/");
         xmlFileName.append(gXmlFileList[i]);
+        xmlFiles.push_back(xmlFileName);
+    }
 
-        if (!loadXmlFile_l(xmlFileName.c_str())) {
-            WARNING("fail to load %s", xmlFileName.c_str());
+    std::string cacheFile = mm_get_env_str("mm.cow.registry.cache", "MM_COW_REGISTRY_CACHE");
+    if (!cacheFile.empty() && loadCache_l(cacheFile, xmlFiles))
+        return true;
+
+    // stamp before parsing, a xml modified during parsing makes the cache stale
+    std::vector<int64_t> xmlStamps;
+    for (i=0; i<xmlFiles.size(); i++) {
+        getXmlStamp(xmlFiles[i], xmlStamps);
+        if (!loadXmlFile_l(xmlFiles[i].c_str())) {
+            WARNING("fail to load %s", xmlFiles[i].c_str());
             if (i == 0)
                 return false;
         }
     }
 
+    if (!cacheFile.empty())
+        saveCache_l(cacheFile, xmlFiles, xmlStamps);
+
     return true;
 }
 
+/*static*/
+const ComponentFactory::Registry* ComponentFactory::getRegistry()
+{
+    Registry *reg = __atomic_load_n(&mRegistry, __ATOMIC_ACQUIRE);
+    if (reg)
+        return reg;
+
+    MMAutoLock locker(mLock);
+    if (mRegistry)
+        return mRegistry;
+
+    if (!loadDefaultXmlIfNeeded_l())
+        return NULL;
+
+    buildRegistry_l();
+    return mRegistry;
+}
+
 /*static */bool ComponentFactory::appendPluginsXml(const char* xmlFile) {
     MMAutoLock locker(mLock);
     return appendPluginsXml_l(xmlFile);
@@ -254,6 +558,7 @@ bool ComponentFactory::loadDefaultXmlIfNeeded_l()
     if (!loadXmlFile_l(xmlFile))
         return false;
 
+    buildRegistry_l();
     return true;
 }
 
@@ -261,59 +566,45 @@ bool ComponentFactory::loadDefaultXmlIfNeeded_l()
     const char* mimeType, bool isEncoder){
 
     INFO("[%s]: componentName:%s, isEncoder:%d", mimeType, componentName, isEncoder);
-    MMAutoLock locker(mLock);
-    uint32_t i=0, j=0;
 
     if (componentName == NULL && mimeType == NULL) {
         ERROR("invalid param");
         return ComponentSP((Component*)NULL);
     }
 
-    if (!loadDefaultXmlIfNeeded_l()) {
+    const Registry *reg = getRegistry();
+    if (!reg) {
         ERROR("fail to load plugins xml file");
         return ComponentSP((Component*)NULL);
     }
 
-    // filter suitable components to a vector, sort by priority
-    int32_t cap = isEncoder ? XML_COMP_ENCODER : XML_COMP_DECODER;
-    std::vector<ComWithPriority>comNames;
-
     if (componentName) {
-        comNames.push_back(ComWithPriority(componentName, DEFAULT_PRIORITY));
-    } else {
-        ASSERT(mimeType);
-
-        for (i = 0; i < kMimeTypeToComName.size(); ++i) {
-            if (strcmp(mimeType, kMimeTypeToComName[i].mMimeType.c_str())){
-                continue;
-            }
-            if ((kMimeTypeToComName[i].mCap == XML_COMP_GENERIC) || (kMimeTypeToComName[i].mCap & cap)){
-                if (kMimeTypeToComName[i].mPriority >= 0 ) {
-                    comNames.push_back(ComWithPriority(kMimeTypeToComName[i].mComName.c_str(),
-                        kMimeTypeToComName[i].mPriority));
-                }
+        Registry::LibMap::const_iterator lib = reg->mLibs.find(componentName);
+        if (lib != reg->mLibs.end()) {
+            ComponentSP com = loadComponent(lib->second.c_str(), mimeType, isEncoder);
+            if (com) {
+                INFO("use %s com finally\n", componentName);
+                return com;
             }
         }
-
-        std::sort(comNames.begin(), comNames.end());
-    }
-
-    DEBUG("find %d components\n", comNames.size());
-    for_each(comNames.begin(), comNames.end(), ComWithPriority());
-
-    // try to create suitable com in priority order
-    for (j=0; j< comNames.size(); j++) {
-        for (i = 0; i < kComponentsNameToLibMap.size(); ++i) {
-            if (strcmp(comNames[j].comName, kComponentsNameToLibMap[i].mComName.c_str())) {
-                continue;
+    } else {
+        Registry::MimeMap::const_iterator it = reg->mMimes.find(mimeType);
+        if (it != reg->mMimes.end()) {
+            // try to create suitable com in priority order
+            int32_t cap = isEncoder ? XML_COMP_ENCODER : XML_COMP_DECODER;
+            const Registry::CandidateList &candidates = it->second;
+            DEBUG("find %zu components\n", candidates.size());
+            for (size_t i = 0; i < candidates.size(); i++) {
+                if (candidates[i].mCap != XML_COMP_GENERIC && !(candidates[i].mCap & cap))
+                    continue;
+                DEBUG("comName:%s, priority:%d\n", candidates[i].mComName.c_str(), candidates[i].mPriority);
+
+                ComponentSP com = loadComponent(candidates[i].mLibName.c_str(), mimeType, isEncoder);
+                if (com) {
+                    INFO("use %s com finally\n", candidates[i].mComName.c_str());
+                    return com;
+                }
             }
-
-            ComponentSP com = loadComponent_l(kComponentsNameToLibMap[i].mLibName.c_str(), mimeType, isEncoder);
-            if (com) {
-                INFO("use %s com finally\n", comNames[j].comName);
-                return com;
-            } else
-                break;
         }
     }
 
@@ -323,46 +614,104 @@ bool ComponentFactory::loadDefaultXmlIfNeeded_l()
 }
 
 /*static*/void ComponentFactory::release(Component * com){
-    MMAutoLock locker(mLock);
-
     if (com == NULL) {
         WARNING("invalid param\n");
         return;
     }
 
+    MMAutoLock locker(mLock);
+
     MComponentMap::iterator itMap;
     std::list<Component *>::iterator itList;
-    bool isFind = false;
     for (itMap = mComponentMap.begin(); itMap != mComponentMap.end(); itMap++) {
         std::list<Component *> &list = itMap->second->mComponent;
         for( itList = list.begin(); itList != list.end(); itList++) {
-            if (*itList == com) {
-                list.erase(itList); //itList will be invalid after erase
-                DEBUG("after erase, %s has %d clients", itMap->first.c_str(), list.size());
-                isFind = true;
+            if (*itList == com)
                 break;
-            }
         }
-
-        if (isFind) {
-            if (itMap->second->mRelease) {
-                com->uninit();
-                (*(itMap->second->mRelease))(com);
-                INFO("com %p, %s uninit and released", com, itMap->first.c_str());
-            }
-            if (list.empty()) {
-                if (strstr(itMap->first.c_str(), "MediaCodecComponent") == NULL) {
-                    DEBUG("close %s begin, handle %p", itMap->first.c_str(), itMap->second->mLibHandle);
-                    dlclose(itMap->second->mLibHandle);
-                    INFO("close %s end", itMap->first.c_str());
-                    mComponentMap.erase(itMap);
-                }
-            }
-            break;
+        if (itList == list.end())
+            continue;
+
+        list.erase(itList); //itList will be invalid after erase
+        DEBUG("after erase, %s has %zu clients", itMap->first.c_str(), list.size());
+        if (itMap->second->mRelease) {
+            com->uninit();
+            (*(itMap->second->mRelease))(com);
+            INFO("com %p, %s uninit and released", com, itMap->first.c_str());
         }
+        closeLibraryIfUnused_l(itMap->first);
+        break;
     }
 
     return;
 }
 
+/*static*/
+void* ComponentFactory::preloadThread(void *arg)
+{
+    std::string *mimeTypes = static_cast<std::string*>(arg);
+    int64_t begin = getTimeUs();
+
+    const Registry *reg = getRegistry();
+    if (!reg) {
+        delete mimeTypes;
+        return NULL;
+    }
+
+    size_t pos = 0;
+    while (pos <= mimeTypes->size()) {
+        size_t end = mimeTypes->find(',', pos);
+        if (end == std::string::npos)
+            end = mimeTypes->size();
+        std::string mime = mimeTypes->substr(pos, end - pos);
+        pos = end + 1;
+
+        Registry::MimeMap::const_iterator it = reg->mMimes.find(mime);
+        if (mime.empty() || it == reg->mMimes.end() || it->second.empty())
+            continue;
+
+        const std::string &libName = it->second[0].mLibName;
+        ComponentInfoSP info = acquireLibrary(libName.c_str());
+        if (!info)
+            continue;
+
+        MMAutoLock locker(mLock);
+        info->mResident = true;
+        info->mPending--;
+        DEBUG("[%s]: %s preloaded", mime.c_str(), libName.c_str());
+    }
+
+    INFO("preload %s cost %" PRId64 " us", mimeTypes->c_str(), getTimeUs() - begin);
+    delete mimeTypes;
+    return NULL;
+}
+
+/*static*/
+void ComponentFactory::preloadAsync(const char* mimeTypes)
+{
+    std::string mimes;
+    if (mimeTypes)
+        mimes = mimeTypes;
+    else
+        mimes = mm_get_env_str("mm.cow.preload", "MM_COW_PRELOAD");
+    if (mimes.empty()) {
+        mimes = MEDIA_MIMETYPE_MEDIA_DEMUXER;
+        mimes.append(",").append(MEDIA_MIMETYPE_VIDEO_AVC);
+        mimes.append(",").append(MEDIA_MIMETYPE_AUDIO_AAC);
+        mimes.append(",").append(MEDIA_MIMETYPE_AUDIO_RENDER);
+        mimes.append(",").append(MEDIA_MIMETYPE_VIDEO_RENDER);
+    }
+
+    std::string *arg = new std::string(mimes);
+    pthread_t thread;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    if (pthread_create(&thread, &attr, preloadThread, arg) != 0) {
+        ERROR("fail to create preload thread");
+        delete arg;
+    }
+    pthread_attr_destroy(&attr);
+}
+
 }
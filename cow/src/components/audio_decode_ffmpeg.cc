@@ -88,17 +88,6 @@ void AudioDecodeFFmpeg::DecodeThread::signalContinue()
     EXIT();
 }
 
-static bool releaseOutputBuffer(MediaBuffer* mediaBuffer)
-{
-    uint8_t *buffer = NULL;
-    if (!(mediaBuffer->getBufferInfo((uintptr_t *)&buffer, NULL, NULL, 1))) {
-        WARNING("error in release mediabuffer");
-        return false;
-    }
-    MM_RELEASE_ARRAY(buffer);
-    return true;
-}
-
 // decode Buffer
 void AudioDecodeFFmpeg::DecodeThread::main()
 {
@@ -178,18 +167,23 @@ void AudioDecodeFFmpeg::DecodeThread::main()
                     if (mDecoder->mHasResample) {
                         bufferSize = mDecoder->mAVFrame->nb_samples * mDecoder->mAVCodecContext->channels * av_get_bytes_per_sample(AV_SAMPLE_FMT_S16);
                         bufferSize = bufferSize * mDecoder->mSampleRateOut / mDecoder->mAVCodecContext->sample_rate + 8;
-                        buffer = new uint8_t[bufferSize];
+                        // output buffers are recycled by mOutputPool once the sink releases them
+                        mediaBuf = mDecoder->mOutputPool->getBuffer(bufferSize, &buffer);
+                        if (!mediaBuf) {
+                            ERROR("no mem for decoded buffer, size %" PRId64, bufferSize);
+                            break;
+                        }
                         decodedSize = swr_convert(mDecoder->mAVResample, &buffer,
                             bufferSize/mDecoder->mAVCodecContext->channels/av_get_bytes_per_sample(AV_SAMPLE_FMT_S16),
-                            mDecoder->mAVFrame->data,
+                            (const uint8_t **)mDecoder->mAVFrame->data,
                             mDecoder->mAVFrame->nb_samples);
+                        if (decodedSize < 0)
+                            decodedSize = 0;
 
                         decodedSize = decodedSize*mDecoder->mAVCodecContext->channels*av_get_bytes_per_sample(AV_SAMPLE_FMT_S16);
-                        mediaBuf = MediaBuffer::createMediaBuffer(MediaBuffer::MBT_RawAudio);
                         mediaBuf->setBufferInfo((uintptr_t *)&buffer, NULL, &decodedSize, 1);
                         mediaBuf->setSize(decodedSize);
                         mediaBuf->setPts(mDecoder->mAVFrame->pkt_pts);
-                        mediaBuf->addReleaseBufferFunc(releaseOutputBuffer);
                     } else {
                         decodedSize = mDecoder->mAVFrame->linesize[0];
                         mediaBuf = AVBufferHelper::createMediaBuffer(mDecoder->mAVFrame, true, true);
@@ -279,6 +273,7 @@ mm_status_t AudioDecodeFFmpeg::release()
         swr_free(&mAVResample);
         mAVResample = NULL;
     }
+    mOutputPool.reset();
     if (mAVFrame) {
         av_free(mAVFrame);
         mAVFrame = NULL;
@@ -546,6 +541,13 @@ void AudioDecodeFFmpeg::onPrepare(param1_type param1, param2_type param2, uint32
             notify(kEventPrepareResult, MM_ERROR_OP_FAILED, 0, nilParam);
             EXIT();
         }
+        // sink holds up to TrafficControlHighBar buffers, keep a few more for the ones in flight
+        mOutputPool = AudioBufferPool::create("AudioDecodeFFmpegOutput", TrafficControlHighBar + 4);
+    }
+    // open the codec while the other components prepare, instead of delaying the first frame at start
+    if (openCodec_l() != MM_ERROR_SUCCESS) {
+        notify(kEventPrepareResult, MM_ERROR_OP_FAILED, 0, nilParam);
+        EXIT();
     }
     mState = PREPARED;
     notify(kEventPrepareResult, MM_ERROR_SUCCESS, 0, nilParam);
@@ -553,30 +555,41 @@ void AudioDecodeFFmpeg::onPrepare(param1_type param1, param2_type param2, uint32
 
 }
 
+mm_status_t AudioDecodeFFmpeg::openCodec_l()
+{
+    if (mAVCodec)
+        return MM_ERROR_SUCCESS;
+
+    AVCodec *codec = avcodec_find_decoder((AVCodecID)mCodecID);
+    if (codec == NULL) {
+        ERROR("error no Codec found\n");
+        return MM_ERROR_OP_FAILED;
+    }
+
+    int64_t begin = getTimeUs();
+    if(mAVCodecContextLock)
+        mAVCodecContextLock->acquire();
+    int ret = avcodec_open2(mAVCodecContext, codec, NULL) ;
+    if(mAVCodecContextLock)
+        mAVCodecContextLock->release();
+    if (ret < 0) {
+        ERROR("error avcodec_open failed.\n");
+        return MM_ERROR_OP_FAILED;
+    }
+
+    mAVCodec = codec;
+    INFO("codec %d opened, cost %" PRId64 " us", mCodecID, getTimeUs() - begin);
+    return MM_ERROR_SUCCESS;
+}
+
 void AudioDecodeFFmpeg::onStart(param1_type param1, param2_type param2, uint32_t rspId)
 {
     ENTER();
     MMAutoLock locker(mLock);
-    if (mAVCodec == NULL) {
-        int ret = -1;
-        mAVCodec = avcodec_find_decoder((AVCodecID)mCodecID);
-        if (mAVCodec == NULL) {
-            ERROR("error no Codec found\n");
-            notify(kEventStartResult, MM_ERROR_OP_FAILED, 0, nilParam);
-            EXIT();
-        }
-        {
-            if(mAVCodecContextLock)
-                mAVCodecContextLock->acquire();
-            ret = avcodec_open2(mAVCodecContext, mAVCodec, NULL) ;
-            if(mAVCodecContextLock)
-                mAVCodecContextLock->release();
-        }
-        if (ret < 0) {
-            ERROR("error avcodec_open failed.\n");
-            notify(kEventStartResult, MM_ERROR_OP_FAILED, 0, nilParam);
-            EXIT();
-        }
+    // reopen after stop
+    if (openCodec_l() != MM_ERROR_SUCCESS) {
+        notify(kEventStartResult, MM_ERROR_OP_FAILED, 0, nilParam);
+        EXIT();
     }
 
     if (!mDecodeThread) {
@@ -666,6 +679,15 @@ void AudioDecodeFFmpeg::onReset(param1_type param1, param2_type param2, uint32_t
         }
     }
     MMAutoLock locker(mLock);
+    // opened at prepare, reset may come without stop
+    if (mAVCodec && mAVCodecContext) {
+        if(mAVCodecContextLock)
+            mAVCodecContextLock->acquire();
+        avcodec_close(mAVCodecContext);
+        mAVCodec = NULL;
+        if(mAVCodecContextLock)
+            mAVCodecContextLock->release();
+    }
     release();
     mReader.reset();
     mWriter.reset();
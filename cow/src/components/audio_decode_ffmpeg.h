@@ -31,6 +31,7 @@
 #include "multimedia/av_buffer_helper.h"
 #include "multimedia/media_monitor.h"
 #include "multimedia/codec.h"
+#include "audio_process.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -115,6 +116,7 @@ public:
 private:
 
     AVCodecID CodecId2AVCodecId(CowCodecID id);
+    mm_status_t openCodec_l();
     enum State {
         UNINITIALIZED,
         INITIALIZED,
@@ -152,6 +154,7 @@ private:
     int32_t mCodecID;
     struct SwrContext *mAVResample;
     bool mHasResample;
+    AudioBufferPoolSP mOutputPool;
     MonitorSP mMonitorWrite;
     Condition mCondition;
     Lock mLock;
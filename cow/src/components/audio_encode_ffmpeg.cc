@@ -23,6 +23,7 @@
 #include "multimedia/mm_debug.h"
 
 #include "audio_encode_ffmpeg.h"
+#include "audio_process.h"
 
 namespace YUNOS_MM {
 
@@ -199,34 +200,45 @@ void AudioEncodeFFmpeg::CodecThread::main() {
 
         // mFifo means whether using audio fifo
         AVFrame *resampleFrame = NULL;
-        AudioFrameAllocatorSP frameAllocator;
         if ((mStreamInfo->mFifo &&
                     av_audio_fifo_size(mStreamInfo->mFifo) < mStreamInfo->mAVCodecContext->frame_size) ||
                 !mStreamInfo->mFifo) {
-            if (mStreamInfo->mAVResample) {
-                frameAllocator.reset(new AudioFrameAllocator(mStreamInfo->mAVCodecContext->sample_fmt,
-                            mStreamInfo->mAVCodecContext->channel_layout,
-                            mStreamInfo->mAVCodecContext->sample_rate,
-                            frame->nb_samples));
-                if (!frameAllocator) {
+            if (mStreamInfo->mAVResample || mStreamInfo->mConvertByKernels) {
+                // the converted samples are consumed (fifo or encoder) before next input, reuse the frame
+                if (!mStreamInfo->mConvertAllocator || !mStreamInfo->mConvertAllocator->mAVFrame ||
+                    mStreamInfo->mConvertAllocator->mAVFrame->nb_samples != frame->nb_samples) {
+                    mStreamInfo->mConvertAllocator.reset(new AudioFrameAllocator(mStreamInfo->mAVCodecContext->sample_fmt,
+                                mStreamInfo->mAVCodecContext->channel_layout,
+                                mStreamInfo->mAVCodecContext->sample_rate,
+                                frame->nb_samples));
+                }
+                if (!mStreamInfo->mConvertAllocator) {
                     ERROR("no mem\n");
                     EXIT();
                 }
-                resampleFrame = frameAllocator->mAVFrame;
+                resampleFrame = mStreamInfo->mConvertAllocator->mAVFrame;
                 if (!resampleFrame) {
                     ERROR("failed to create AudioFrame\n");
                     EXIT();
                 }
 
-
-                int outSamples = 0;
-                if ((outSamples = swr_convert(mStreamInfo->mAVResample,
-                                resampleFrame->data, frame->nb_samples,
-                                (const uint8_t**)frame->data, frame->nb_samples)) < 0) {
-                    ERROR("Convert failed");
-                    EXIT();
+                if (mStreamInfo->mConvertByKernels) {
+                    if (mStreamInfo->mAVCodecContext->sample_fmt == AV_SAMPLE_FMT_FLTP)
+                        AudioKernels::deinterleaveS16ToF32((const int16_t*)frame->data[0], (float**)resampleFrame->data,
+                            mStreamInfo->mChannelCount, frame->nb_samples);
+                    else
+                        AudioKernels::s16ToF32((const int16_t*)frame->data[0], (float*)resampleFrame->data[0],
+                            frame->nb_samples * mStreamInfo->mChannelCount);
+                } else {
+                    int outSamples = 0;
+                    if ((outSamples = swr_convert(mStreamInfo->mAVResample,
+                                    resampleFrame->data, frame->nb_samples,
+                                    (const uint8_t**)frame->data, frame->nb_samples)) < 0) {
+                        ERROR("Convert failed");
+                        EXIT();
+                    }
+                    ASSERT(outSamples == frame->nb_samples);
                 }
-                ASSERT(outSamples == frame->nb_samples);
                 VERBOSE("convert nb_samples %d to float", frame->nb_samples);
 
             } else {
@@ -729,6 +741,8 @@ void AudioEncodeFFmpeg::onPrepare(param1_type param1, param2_type param2, uint32
         notify(kEventPrepareResult, MM_ERROR_NO_MEM, 0, nilParam);
         EXIT();
     }
+    mStreamInfo->mAVResample = NULL;
+    mStreamInfo->mConvertByKernels = false;
 
     av_register_all();
 
@@ -830,6 +844,15 @@ void AudioEncodeFFmpeg::onPrepare(param1_type param1, param2_type param2, uint32
         DEBUG("using audio fifo");
     }
 
+    // same rate and layout, only sample format differs: S16 -> float is a plain kernel
+    if (needResampler && mStreamInfo->mSampleFormat == SND_FORMAT_PCM_16_BIT &&
+        (c->sample_fmt == AV_SAMPLE_FMT_FLTP || c->sample_fmt == AV_SAMPLE_FMT_FLT) &&
+        c->channels == mStreamInfo->mChannelCount) {
+        DEBUG("convert s16 to sample_fmt %d by AudioKernels", c->sample_fmt);
+        mStreamInfo->mConvertByKernels = true;
+        needResampler = false;
+    }
+
     if (needResampler) {
         mStreamInfo->mAVResample = swr_alloc();
         if (!mStreamInfo->mAVResample) {
@@ -961,6 +984,7 @@ void AudioEncodeFFmpeg::onReset(param1_type param1, param2_type param2, uint32_t
     if (mStreamInfo->mAVResample) {
         swr_free(&mStreamInfo->mAVResample);
     }
+    mStreamInfo->mConvertAllocator.reset();
 
     mReader.reset();
     mWriter.reset();
@@ -125,6 +125,11 @@ protected:
 
         AudioFrameAllocatorSP mFrameAllocator;
 
+        // S16 to FLT/FLTP is done by AudioKernels instead of libswresample
+        bool mConvertByKernels;
+        // conversion output, reused while the input frame size doesn't change
+        AudioFrameAllocatorSP mConvertAllocator;
+
     };
     typedef MMSharedPtr <StreamInfo> StreamInfoSP;
 
@@ -0,0 +1,901 @@
+/**
+ * Copyright (C) 2017 Alibaba Group Holding Limited. All Rights Reserved.
+ *
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include "audio_mixer.h"
+#include "multimedia/mm_types.h"
+#include "multimedia/mm_errors.h"
+#include "multimedia/media_buffer.h"
+#include "multimedia/media_meta.h"
+#include "multimedia/media_attr_str.h"
+#include "multimedia/mm_audio.h"
+#include "multimedia/mm_debug.h"
+
+namespace YUNOS_MM {
+
+MM_LOG_DEFINE_MODULE_NAME("AudioMixer")
+
+#define ENTER() VERBOSE(">>>\n")
+#define EXIT() do {VERBOSE(" <<<\n"); return;}while(0)
+#define EXIT_AND_RETURN(_code) do {VERBOSE("<<<(status: %d)\n", (_code)); return (_code);}while(0)
+
+static const char * COMPONENT_NAME = "AudioMixer";
+static const char * MMSGTHREAD_NAME = "AudioMixer";
+static const char * MMTHREAD_NAME = "AudioMixer-Mix";
+
+#define DEFAULT_SAMPLE_RATE     44100
+#define DEFAULT_CHANNEL         2
+#define DEFAULT_PERIOD_MS       20
+#define MIN_PERIOD_MS           5
+#define MAX_PERIOD_MS           100
+// mixed periods queued in the sink before the mix thread waits
+#define OUTPUT_QUEUE_LOW_BAR    2
+#define OUTPUT_QUEUE_HIGH_BAR   4
+
+#define AMIX_MSG_prepare (msg_type)1
+#define AMIX_MSG_start (msg_type)2
+#define AMIX_MSG_pause (msg_type)3
+#define AMIX_MSG_resume (msg_type)4
+#define AMIX_MSG_stop (msg_type)5
+#define AMIX_MSG_flush (msg_type)6
+#define AMIX_MSG_reset (msg_type)7
+
+BEGIN_MSG_LOOP(AudioMixer)
+    MSG_ITEM(AMIX_MSG_prepare, onPrepare)
+    MSG_ITEM(AMIX_MSG_start, onStart)
+    MSG_ITEM(AMIX_MSG_pause, onPause)
+    MSG_ITEM(AMIX_MSG_resume, onResume)
+    MSG_ITEM(AMIX_MSG_stop, onStop)
+    MSG_ITEM(AMIX_MSG_flush, onFlush)
+    MSG_ITEM(AMIX_MSG_reset, onReset)
+END_MSG_LOOP()
+
+struct AudioMixer::Input {
+    Input(int32_t index)
+        : mIndex(index)
+        , mFormat(SND_FORMAT_PCM_16_BIT)
+        , mChannelCount(0)
+        , mBytesPerFrame(0)
+        , mOffset(0)
+        , mGain(1.0f)
+        , mConfigured(false)
+        , mGotEOS(false)
+        , mEOSNotified(false)
+        , mRemoved(false)
+        , mMixedFrames(0)
+        , mUnderruns(0)
+    {
+        mClock.reset(new ClockWrapper());
+    }
+
+    int32_t mIndex;
+    // the upstream buffers are kept until they are mixed, so upstream TrafficControl follows the mixer
+    std::list<MediaBufferSP> mQueue;
+    MediaBufferSP mCurrent;       // head of mQueue after format conversion
+    AudioProcessorSP mProcessor;  // NULL when the input can be mixed as is
+    snd_format_t mFormat;         // format of mCurrent
+    int32_t mChannelCount;
+    int32_t mBytesPerFrame;
+    int32_t mOffset;              // bytes of mCurrent already mixed
+    float mGain;
+    bool mConfigured;
+    bool mGotEOS;
+    bool mEOSNotified;
+    bool mRemoved;
+    int64_t mMixedFrames;
+    uint32_t mUnderruns;
+    ClockWrapperSP mClock;
+};
+
+// ////////////////////// MixThread
+class AudioMixer::MixThread : public MMThread {
+  public:
+    MixThread(AudioMixer *mixer)
+        : MMThread(MMTHREAD_NAME)
+        , mMixer(mixer)
+        , mContinue(true)
+    {
+        ENTER();
+        EXIT();
+    }
+
+    ~MixThread()
+    {
+        ENTER();
+        EXIT();
+    }
+
+    void signalExit()
+    {
+        ENTER();
+        TrafficControl * traffic = static_cast<TrafficControl*>(mMixer->mMonitorWrite.get());
+        if (traffic)
+            traffic->unblockWait();
+        MMAutoLock locker(mMixer->mLock);
+        mContinue = false;
+        mMixer->mCondition.signal();
+        EXIT();
+    }
+
+  protected:
+    virtual void main();
+
+  private:
+    AudioMixer *mMixer;
+    bool mContinue;
+};
+
+void AudioMixer::MixThread::main()
+{
+    ENTER();
+    while (1) {
+        {
+            MMAutoLock locker(mMixer->mLock);
+            if (!mContinue)
+                break;
+            if (mMixer->mState != kStatePlaying || mMixer->mOutputEOS ||
+                (!mMixer->hasPendingData_l() && !mMixer->mKeepAlive)) {
+                // writers signal on new data, keep-alive and state changes signal too
+                mMixer->mCondition.timedWait(mMixer->mPeriodMs * 1000ll);
+                continue;
+            }
+        }
+
+        if (!mMixer->mixOnePeriod())
+            continue;
+
+        // sink releases the buffer after rendering it, wait here instead of running ahead of it
+        TrafficControl * traffic = static_cast<TrafficControl*>(mMixer->mMonitorWrite.get());
+        traffic->waitOnFull();
+    }
+    INFO("mix thread exited\n");
+    EXIT();
+}
+
+//////////////////////////////////////// MixerWriter
+AudioMixer::MixerWriter::MixerWriter(AudioMixer *mixer, InputSP input)
+    : mMixer(mixer)
+    , mInput(input)
+{
+    ENTER();
+    EXIT();
+}
+
+AudioMixer::MixerWriter::~MixerWriter()
+{
+    ENTER();
+    // the upstream component is gone, drop what it left behind
+    MMAutoLock locker(mMixer->mLock);
+    mInput->mRemoved = true;
+    mMixer->clearInput_l(mInput);
+    for (std::vector<InputSP>::iterator it = mMixer->mInputs.begin(); it != mMixer->mInputs.end(); ++it) {
+        if ((*it)->mIndex == mInput->mIndex) {
+            mMixer->mInputs.erase(it);
+            break;
+        }
+    }
+    mMixer->mCondition.signal();
+    EXIT();
+}
+
+mm_status_t AudioMixer::MixerWriter::write(const MediaBufferSP &buffer)
+{
+    ENTER();
+    if (!buffer) {
+        WARNING("input %d, buffer is nil", mInput->mIndex);
+        EXIT_AND_RETURN(MM_ERROR_INVALID_PARAM);
+    }
+    if (buffer->type() != MediaBuffer::MBT_RawAudio && !buffer->isFlagSet(MediaBuffer::MBFT_EOS)) {
+        ERROR("input %d, wrong buffer type %d", mInput->mIndex, buffer->type());
+        EXIT_AND_RETURN(MM_ERROR_INVALID_PARAM);
+    }
+
+    MMAutoLock locker(mMixer->mLock);
+    if (!mInput->mConfigured) {
+        ERROR("input %d, write before setMetaData", mInput->mIndex);
+        EXIT_AND_RETURN(MM_ERROR_IVALID_OPERATION);
+    }
+    mInput->mQueue.push_back(buffer);
+    mMixer->mCondition.signal();
+    EXIT_AND_RETURN(MM_ERROR_SUCCESS);
+}
+
+mm_status_t AudioMixer::MixerWriter::setMetaData(const MediaMetaSP & metaData)
+{
+    ENTER();
+    int32_t sampleRate = 0, format = 0, channelCount = 0;
+    if (!metaData->getInt32(MEDIA_ATTR_SAMPLE_RATE, sampleRate) ||
+        !metaData->getInt32(MEDIA_ATTR_SAMPLE_FORMAT, format) ||
+        !metaData->getInt32(MEDIA_ATTR_CHANNEL_COUNT, channelCount)) {
+        ERROR("input %d, incomplete audio format", mInput->mIndex);
+        EXIT_AND_RETURN(MM_ERROR_INVALID_PARAM);
+    }
+
+    MMAutoLock locker(mMixer->mLock);
+    if (sampleRate != mMixer->mSampleRate) {
+        // there is no resampler here, upstream is expected to follow MEDIA_ATTR_SAMPLE_RATE of getParameter()
+        ERROR("input %d, sample rate %d doesn't match mixer %d", mInput->mIndex, sampleRate, mMixer->mSampleRate);
+        EXIT_AND_RETURN(MM_ERROR_UNSUPPORTED);
+    }
+
+    AudioProcessorSP processor;
+    snd_format_t inFormat = (snd_format_t)format;
+    if (!AudioProcessor::isFormatSupported(inFormat)) {
+        ERROR("input %d, unsupported format %d", mInput->mIndex, format);
+        EXIT_AND_RETURN(MM_ERROR_UNSUPPORTED);
+    }
+    if (channelCount != mMixer->mChannelCount) {
+        processor.reset(new AudioProcessor(COMPONENT_NAME));
+        if (processor->configure(inFormat, channelCount, SND_FORMAT_PCM_FLOAT, mMixer->mChannelCount) != MM_ERROR_SUCCESS) {
+            ERROR("input %d, can't map %d channels to %d", mInput->mIndex, channelCount, mMixer->mChannelCount);
+            EXIT_AND_RETURN(MM_ERROR_UNSUPPORTED);
+        }
+        inFormat = SND_FORMAT_PCM_FLOAT;
+    }
+
+    // buffers queued with the previous format are converted with it already or mixed raw, keep it simple and drop them
+    mMixer->clearInput_l(mInput);
+    mInput->mProcessor = processor;
+    mInput->mFormat = inFormat;
+    mInput->mChannelCount = mMixer->mChannelCount;
+    mInput->mBytesPerFrame = mMixer->mChannelCount * (inFormat == SND_FORMAT_PCM_FLOAT ? sizeof(float) : sizeof(int16_t));
+    mInput->mConfigured = true;
+    mMixer->mFormatLocked = true;
+    INFO("input %d, sample rate %d, format %d, channel %d%s", mInput->mIndex, sampleRate, format, channelCount,
+        processor ? ", converted" : "");
+    EXIT_AND_RETURN(MM_ERROR_SUCCESS);
+}
+
+// /////////////////////////////////////
+AudioMixer::AudioMixer(const char *mimeType, bool isEncoder)
+    : MMMsgThread(MMSGTHREAD_NAME)
+    , mCondition(mLock)
+    , mComponentName(COMPONENT_NAME)
+    , mState(kStateNull)
+    , mSampleRate(DEFAULT_SAMPLE_RATE)
+    , mChannelCount(DEFAULT_CHANNEL)
+    , mFormat(SND_FORMAT_PCM_16_BIT)
+    , mPeriodMs(DEFAULT_PERIOD_MS)
+    , mPeriodFrames(0)
+    , mKeepAlive(false)
+    , mFormatLocked(false)
+    , mNextInputIndex(0)
+    , mOutputFrames(0)
+    , mOutputEOS(false)
+    , mUnderruns(0)
+{
+    ENTER();
+    mOutputFormat = MediaMeta::create();
+    mMonitorWrite.reset(new TrafficControl(OUTPUT_QUEUE_LOW_BAR, OUTPUT_QUEUE_HIGH_BAR, "AudioMixerWrite"));
+    EXIT();
+}
+
+AudioMixer::~AudioMixer()
+{
+    ENTER();
+    EXIT();
+}
+
+const char * AudioMixer::name() const
+{
+    return mComponentName.c_str();
+}
+
+mm_status_t AudioMixer::init()
+{
+    ENTER();
+    int ret = MMMsgThread::run();
+    if (ret)
+        EXIT_AND_RETURN(MM_ERROR_OP_FAILED);
+
+    EXIT_AND_RETURN(MM_ERROR_SUCCESS);
+}
+
+void AudioMixer::uninit()
+{
+    ENTER();
+    MMMsgThread::exit();
+    EXIT();
+}
+
+Component::WriterSP AudioMixer::getWriter(MediaType mediaType)
+{
+    ENTER();
+    if ((int)mediaType != Component::kMediaTypeAudio) {
+        ERROR("not supported mediatype: %d\n", mediaType);
+        return WriterSP((Writer*)NULL);
+    }
+
+    MMAutoLock locker(mLock);
+    InputSP input(new Input(mNextInputIndex++));
+    if (mState == kStatePaused)
+        input->mClock->pause();
+    mInputs.push_back(input);
+    INFO("input %d created, %zu inputs", input->mIndex, mInputs.size());
+    return WriterSP(new MixerWriter(this, input));
+}
+
+mm_status_t AudioMixer::addSource(Component * component, MediaType mediaType)
+{
+    ENTER();
+    // pulling from N upstream components would need N threads, let them push to our writers instead
+    ERROR("AudioMixer accepts input from addSink() of upstream component only\n");
+    EXIT_AND_RETURN(MM_ERROR_IVALID_OPERATION);
+}
+
+mm_status_t AudioMixer::addSink(Component * component, MediaType mediaType)
+{
+    ENTER();
+    if (!component || mediaType != kMediaTypeAudio)
+        EXIT_AND_RETURN(MM_ERROR_INVALID_PARAM);
+
+    MMAutoLock locker(mLock);
+    mWriter = component->getWriter(kMediaTypeAudio);
+    if (!mWriter)
+        EXIT_AND_RETURN(MM_ERROR_OP_FAILED);
+
+    mOutputFormat->setInt32(MEDIA_ATTR_SAMPLE_RATE, mSampleRate);
+    mOutputFormat->setInt32(MEDIA_ATTR_SAMPLE_FORMAT, mFormat);
+    mOutputFormat->setInt32(MEDIA_ATTR_CHANNEL_COUNT, mChannelCount);
+    mWriter->setMetaData(mOutputFormat);
+
+    ClockSP sinkClock = component->provideClock();
+    if (sinkClock) {
+        mSinkClock.reset(new ClockWrapper(ClockWrapper::kFlagVideoSink));
+        mSinkClock->setClock(sinkClock);
+    }
+    EXIT_AND_RETURN(MM_ERROR_SUCCESS);
+}
+
+ClockSP AudioMixer::provideClock()
+{
+    ENTER();
+    MMAutoLock locker(mLock);
+    if (mInputs.empty())
+        return ClockSP((Clock*)NULL);
+    return mInputs.back()->mClock->provideClock();
+}
+
+ClockSP AudioMixer::getInputClock(int32_t index)
+{
+    MMAutoLock locker(mLock);
+    InputSP input = findInput_l(index);
+    if (!input)
+        return ClockSP((Clock*)NULL);
+    return input->mClock->provideClock();
+}
+
+mm_status_t AudioMixer::setInputGain(int32_t index, float gain)
+{
+    MMAutoLock locker(mLock);
+    InputSP input = findInput_l(index);
+    if (!input || gain < 0.0f) {
+        ERROR("invalid input %d or gain %f", index, gain);
+        return MM_ERROR_INVALID_PARAM;
+    }
+    input->mGain = gain;
+    DEBUG("input %d, gain %f", index, gain);
+    return MM_ERROR_SUCCESS;
+}
+
+mm_status_t AudioMixer::flushInput(int32_t index)
+{
+    ENTER();
+    MMAutoLock locker(mLock);
+    InputSP input = findInput_l(index);
+    if (!input)
+        EXIT_AND_RETURN(MM_ERROR_INVALID_PARAM);
+    clearInput_l(input);
+    input->mGotEOS = false;
+    input->mEOSNotified = false;
+    input->mClock->flush();
+    EXIT_AND_RETURN(MM_ERROR_SUCCESS);
+}
+
+AudioMixer::InputSP AudioMixer::findInput_l(int32_t index)
+{
+    for (size_t i = 0; i < mInputs.size(); i++) {
+        if (mInputs[i]->mIndex == index)
+            return mInputs[i];
+    }
+    return InputSP();
+}
+
+void AudioMixer::clearInput_l(InputSP &input)
+{
+    input->mQueue.clear();
+    input->mCurrent.reset();
+    input->mOffset = 0;
+}
+
+// data to mix, or EOS to send once all inputs are done
+bool AudioMixer::hasPendingData_l()
+{
+    bool allEOS = !mInputs.empty();
+    for (size_t i = 0; i < mInputs.size(); i++) {
+        if (!mInputs[i]->mQueue.empty())
+            return true;
+        if (!mInputs[i]->mGotEOS)
+            allEOS = false;
+    }
+    return allEOS && !mOutputEOS && !mKeepAlive;
+}
+
+// the real time the next mixed period starts to play, the sink clock runs in mixer output time
+int64_t AudioMixer::periodRealTimeUs()
+{
+    int64_t nowUs = Clock::getNowUs();
+    int64_t outputUs = mOutputFrames * 1000000ll / mSampleRate;
+    int64_t positionUs = -1;
+    if (mSinkClock && mSinkClock->getCurrentPosition(positionUs) == MM_ERROR_SUCCESS && positionUs >= 0) {
+        if (outputUs > positionUs)
+            return nowUs + (outputUs - positionUs);
+        return nowUs;
+    }
+    // sink hasn't started rendering yet, everything mixed so far is queued ahead of this period
+    return nowUs + outputUs;
+}
+
+// mix up to one period of the input to mBus, return the frames mixed
+int32_t AudioMixer::mixInput_l(InputSP &input, int64_t realUs)
+{
+    int32_t done = 0;
+    int64_t startPts = -1;
+
+    while (done < mPeriodFrames) {
+        if (!input->mCurrent) {
+            if (input->mQueue.empty())
+                break;
+            input->mCurrent = input->mProcessor ? input->mProcessor->process(input->mQueue.front()) : input->mQueue.front();
+            input->mOffset = 0;
+            uintptr_t data = 0;
+            int32_t offset = 0, size = 0;
+            if (input->mCurrent && input->mCurrent->getBufferInfo(&data, &offset, &size, 1))
+                input->mOffset = offset;
+        }
+
+        MediaBufferSP &buffer = input->mCurrent;
+        uint8_t *data = NULL;
+        int32_t offset = 0, size = 0;
+        if (buffer)
+            buffer->getBufferInfo((uintptr_t*)&data, &offset, &size, 1);
+        // size is the payload after offset, mOffset starts at offset
+        int32_t frames = (data && offset + size > input->mOffset) ? (offset + size - input->mOffset) / input->mBytesPerFrame : 0;
+        if (frames > 0) {
+            int32_t n = frames < mPeriodFrames - done ? frames : mPeriodFrames - done;
+            if (startPts < 0 && buffer->pts() >= 0)
+                startPts = buffer->pts() + (int64_t)((input->mOffset - offset) / input->mBytesPerFrame) * 1000000ll / mSampleRate;
+            float *bus = &mBus[done * mChannelCount];
+            if (input->mFormat == SND_FORMAT_PCM_FLOAT)
+                AudioKernels::mixF32((const float*)(data + input->mOffset), bus, n * mChannelCount, input->mGain);
+            else
+                AudioKernels::mixS16ToF32((const int16_t*)(data + input->mOffset), bus, n * mChannelCount, input->mGain);
+            input->mOffset += n * input->mBytesPerFrame;
+            done += n;
+            frames -= n;
+        }
+        if (frames > 0)
+            break;
+
+        // buffer (or an empty EOS buffer) is used up
+        bool eos = input->mQueue.front()->isFlagSet(MediaBuffer::MBFT_EOS);
+        input->mCurrent.reset();
+        input->mOffset = 0;
+        input->mQueue.pop_front();
+        if (eos) {
+            input->mGotEOS = true;
+            clearInput_l(input);
+            break;
+        }
+    }
+
+    if (done > 0) {
+        input->mMixedFrames += done;
+        if (startPts >= 0) {
+            int64_t durationUs = (int64_t)done * 1000000ll / mSampleRate;
+            input->mClock->setAnchorTime(startPts, realUs, startPts + durationUs);
+        }
+    }
+    return done;
+}
+
+// return true if a buffer is sent to the sink
+bool AudioMixer::mixOnePeriod()
+{
+    MediaBufferSP out;
+    // <info, input index> to notify after mLock is released
+    std::vector<std::pair<int32_t, int32_t> > events;
+    {
+        MMAutoLock locker(mLock);
+        if (!mWriter || mBus.empty())
+            return false;
+
+        memset(&mBus[0], 0, mBus.size() * sizeof(float));
+        int64_t realUs = periodRealTimeUs();
+        bool mixed = false;
+        bool allEOS = !mInputs.empty();
+        std::vector<InputSP> starved;
+        for (size_t i = 0; i < mInputs.size(); i++) {
+            InputSP &input = mInputs[i];
+            if (!input->mConfigured || input->mRemoved) {
+                allEOS = false;
+                continue;
+            }
+            int32_t frames = 0;
+            if (!input->mGotEOS)
+                frames = mixInput_l(input, realUs);
+            if (frames > 0)
+                mixed = true;
+
+            if (input->mGotEOS) {
+                if (!input->mEOSNotified) {
+                    input->mEOSNotified = true;
+                    INFO("input %d EOS, %" PRId64 " frames mixed", input->mIndex, input->mMixedFrames);
+                    events.push_back(std::make_pair((int32_t)kEventInfoMixerInputEOS, input->mIndex));
+                }
+                continue;
+            }
+            allEOS = false;
+            if (frames < mPeriodFrames && input->mMixedFrames > 0)
+                starved.push_back(input);
+        }
+
+        if (mixed || mKeepAlive) {
+            // started and not finished but short of data, silence fills the rest of their period
+            for (size_t i = 0; i < starved.size(); i++) {
+                starved[i]->mUnderruns++;
+                mUnderruns++;
+                VERBOSE("input %d underrun", starved[i]->mIndex);
+                if (starved[i]->mUnderruns == 1)
+                    events.push_back(std::make_pair((int32_t)kEventInfoMixerInputUnderrun, starved[i]->mIndex));
+            }
+        }
+
+        if (allEOS && !mKeepAlive && !mixed) {
+            INFO("all %zu inputs reach EOS\n", mInputs.size());
+            mOutputEOS = true;
+            out = MediaBuffer::createMediaBuffer(MediaBuffer::MBT_RawAudio);
+            out->setFlag(MediaBuffer::MBFT_EOS);
+            out->setSize(0);
+        } else if (mixed || mKeepAlive) {
+            int32_t bytesPerSample = mFormat == SND_FORMAT_PCM_FLOAT ? sizeof(float) : sizeof(int16_t);
+            int32_t size = mPeriodFrames * mChannelCount * bytesPerSample;
+            uint8_t *data = NULL;
+            out = mPool->getBuffer(size, &data);
+            if (!out) {
+                ERROR("no memory for mixed period");
+            } else {
+                if (mFormat == SND_FORMAT_PCM_FLOAT)
+                    memcpy(data, &mBus[0], size);
+                else
+                    AudioKernels::f32ToS16(&mBus[0], (int16_t*)data, mPeriodFrames * mChannelCount);
+                out->setBufferInfo((uintptr_t*)&data, NULL, &size, 1);
+                out->setSize(size);
+                out->setPts(mOutputFrames * 1000000ll / mSampleRate);
+                out->setDts(out->pts());
+                out->setDuration((int64_t)mPeriodFrames * 1000000ll / mSampleRate);
+                mOutputFrames += mPeriodFrames;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < events.size(); i++)
+        notify(kEventInfo, events[i].first, events[i].second, nilParam);
+    if (!out)
+        return false;
+
+    out->setMonitor(mMonitorWrite);
+    if (mWriter->write(out) != MM_ERROR_SUCCESS) {
+        ERROR("fail to write mixed period to sink");
+        return false;
+    }
+    return true;
+}
+
+mm_status_t AudioMixer::prepare()
+{
+    ENTER();
+    postMsg(AMIX_MSG_prepare, 0, NULL);
+    EXIT_AND_RETURN(MM_ERROR_ASYNC);
+}
+
+mm_status_t AudioMixer::start()
+{
+    ENTER();
+    postMsg(AMIX_MSG_start, 0, NULL);
+    EXIT_AND_RETURN(MM_ERROR_ASYNC);
+}
+
+mm_status_t AudioMixer::stop()
+{
+    ENTER();
+    postMsg(AMIX_MSG_stop, 0, NULL);
+    EXIT_AND_RETURN(MM_ERROR_ASYNC);
+}
+
+mm_status_t AudioMixer::pause()
+{
+    ENTER();
+    postMsg(AMIX_MSG_pause, 0, NULL);
+    EXIT_AND_RETURN(MM_ERROR_ASYNC);
+}
+
+mm_status_t AudioMixer::resume()
+{
+    ENTER();
+    postMsg(AMIX_MSG_resume, 0, NULL);
+    EXIT_AND_RETURN(MM_ERROR_ASYNC);
+}
+
+mm_status_t AudioMixer::reset()
+{
+    ENTER();
+    postMsg(AMIX_MSG_reset, 0, NULL);
+    EXIT_AND_RETURN(MM_ERROR_ASYNC);
+}
+
+mm_status_t AudioMixer::flush()
+{
+    ENTER();
+    postMsg(AMIX_MSG_flush, 0, NULL);
+    EXIT_AND_RETURN(MM_ERROR_ASYNC);
+}
+
+void AudioMixer::onPrepare(param1_type param1, param2_type param2, uint32_t rspId)
+{
+    ENTER();
+    MMAutoLock locker(mLock);
+    if (!mWriter) {
+        ERROR("no sink is added");
+        notify(kEventPrepareResult, MM_ERROR_IVALID_OPERATION, 0, nilParam);
+        EXIT();
+    }
+
+    mPeriodFrames = mSampleRate * mPeriodMs / 1000;
+    mBus.resize(mPeriodFrames * mChannelCount);
+    if (!mPool)
+        mPool = AudioBufferPool::create(COMPONENT_NAME, OUTPUT_QUEUE_HIGH_BAR + 2);
+    mOutputEOS = false;
+    mState = kStatePrepared;
+    INFO("sample rate %d, channel %d, format %d, period %d frames", mSampleRate, mChannelCount, mFormat, mPeriodFrames);
+    notify(kEventPrepareResult, MM_ERROR_SUCCESS, 0, nilParam);
+    EXIT();
+}
+
+void AudioMixer::onStart(param1_type param1, param2_type param2, uint32_t rspId)
+{
+    ENTER();
+    if (!mMixThread) {
+        mMixThread.reset(new MixThread(this), MMThread::releaseHelper);
+        mMixThread->create();
+    }
+    {
+        MMAutoLock locker(mLock);
+        mState = kStatePlaying;
+        mCondition.signal();
+    }
+    notify(kEventStartResult, MM_ERROR_SUCCESS, 0, nilParam);
+    EXIT();
+}
+
+void AudioMixer::onPause(param1_type param1, param2_type param2, uint32_t rspId)
+{
+    ENTER();
+    MMAutoLock locker(mLock);
+    if (mState != kStatePlaying) {
+        ERROR("invalid pause command, not in kStatePlaying");
+        notify(kEventPaused, MM_ERROR_OP_FAILED, 0, nilParam);
+        EXIT();
+    }
+    mState = kStatePaused;
+    for (size_t i = 0; i < mInputs.size(); i++)
+        mInputs[i]->mClock->pause();
+    notify(kEventPaused, MM_ERROR_SUCCESS, 0, nilParam);
+    EXIT();
+}
+
+void AudioMixer::onResume(param1_type param1, param2_type param2, uint32_t rspId)
+{
+    ENTER();
+    MMAutoLock locker(mLock);
+    if (mState != kStatePaused) {
+        ERROR("invalid resume command, not in kStatePaused");
+        notify(kEventResumed, MM_ERROR_OP_FAILED, 0, nilParam);
+        EXIT();
+    }
+    mState = kStatePlaying;
+    for (size_t i = 0; i < mInputs.size(); i++)
+        mInputs[i]->mClock->resume();
+    mCondition.signal();
+    notify(kEventResumed, MM_ERROR_SUCCESS, 0, nilParam);
+    EXIT();
+}
+
+void AudioMixer::onStop(param1_type param1, param2_type param2, uint32_t rspId)
+{
+    ENTER();
+    if (mMixThread) {
+        mMixThread->signalExit();
+        mMixThread.reset(); // MMThread::releaseHelper waits for the exit of the mix thread
+    }
+    TrafficControl * traffic = static_cast<TrafficControl*>(mMonitorWrite.get());
+    traffic->unblockWait(false);
+
+    MMAutoLock locker(mLock);
+    for (size_t i = 0; i < mInputs.size(); i++)
+        clearInput_l(mInputs[i]);
+    mState = kStateStopped;
+    notify(kEventStopped, MM_ERROR_SUCCESS, 0, nilParam);
+    EXIT();
+}
+
+void AudioMixer::onFlush(param1_type param1, param2_type param2, uint32_t rspId)
+{
+    ENTER();
+    MMAutoLock locker(mLock);
+    for (size_t i = 0; i < mInputs.size(); i++) {
+        clearInput_l(mInputs[i]);
+        mInputs[i]->mGotEOS = false;
+        mInputs[i]->mEOSNotified = false;
+        mInputs[i]->mClock->flush();
+    }
+    // output time keeps going, the sink is flushed and re-anchors its clock on the next period
+    mOutputEOS = false;
+    notify(kEventFlushComplete, MM_ERROR_SUCCESS, 0, nilParam);
+    EXIT();
+}
+
+void AudioMixer::onReset(param1_type param1, param2_type param2, uint32_t rspId)
+{
+    ENTER();
+    if (mMixThread) {
+        mMixThread->signalExit();
+        mMixThread.reset();
+    }
+    TrafficControl * traffic = static_cast<TrafficControl*>(mMonitorWrite.get());
+    traffic->unblockWait(false);
+
+    {
+        MMAutoLock locker(mLock);
+        for (size_t i = 0; i < mInputs.size(); i++)
+            clearInput_l(mInputs[i]);
+        mWriter.reset();
+        mSinkClock.reset();
+        mBus.clear();
+        mOutputFrames = 0;
+        mOutputEOS = false;
+        mUnderruns = 0;
+        mState = kStateNull;
+    }
+    mPool.reset();
+    notify(kEventResetComplete, MM_ERROR_SUCCESS, 0, nilParam);
+    EXIT();
+}
+
+mm_status_t AudioMixer::setParameter(const MediaMetaSP & meta)
+{
+    ENTER();
+    MMAutoLock locker(mLock);
+    int32_t inputIndex = -1;
+    for ( MediaMeta::iterator i = meta->begin(); i != meta->end(); ++i ) {
+        const MediaMeta::MetaItem & item = *i;
+        if (!strcmp(item.mName, MEDIA_ATTR_SAMPLE_RATE) ||
+            !strcmp(item.mName, MEDIA_ATTR_CHANNEL_COUNT) ||
+            !strcmp(item.mName, MEDIA_ATTR_SAMPLE_FORMAT)) {
+            if (item.mType != MediaMeta::MT_Int32) {
+                WARNING("invalid type for %s\n", item.mName);
+                continue;
+            }
+            if (mFormatLocked || mState != kStateNull) {
+                ERROR("output format can't be changed once inputs are configured\n");
+                EXIT_AND_RETURN(MM_ERROR_IVALID_OPERATION);
+            }
+            if (!strcmp(item.mName, MEDIA_ATTR_SAMPLE_RATE)) {
+                mSampleRate = item.mValue.ii;
+            } else if (!strcmp(item.mName, MEDIA_ATTR_CHANNEL_COUNT)) {
+                if (item.mValue.ii != 1 && item.mValue.ii != 2) {
+                    ERROR("only mono or stereo output is supported\n");
+                    EXIT_AND_RETURN(MM_ERROR_INVALID_PARAM);
+                }
+                mChannelCount = item.mValue.ii;
+            } else {
+                if (item.mValue.ii != SND_FORMAT_PCM_16_BIT && item.mValue.ii != SND_FORMAT_PCM_FLOAT) {
+                    ERROR("unsupported output format %d\n", item.mValue.ii);
+                    EXIT_AND_RETURN(MM_ERROR_INVALID_PARAM);
+                }
+                mFormat = (snd_format_t)item.mValue.ii;
+            }
+            INFO("key: %s, value: %d\n", item.mName, item.mValue.ii);
+        } else if (!strcmp(item.mName, AUDIO_MIXER_PERIOD_MS)) {
+            if (item.mType != MediaMeta::MT_Int32) {
+                WARNING("invalid type for %s\n", item.mName);
+                continue;
+            }
+            if (mState != kStateNull || item.mValue.ii < MIN_PERIOD_MS || item.mValue.ii > MAX_PERIOD_MS) {
+                ERROR("invalid period %d ms in state %d\n", item.mValue.ii, mState);
+                EXIT_AND_RETURN(MM_ERROR_INVALID_PARAM);
+            }
+            mPeriodMs = item.mValue.ii;
+            INFO("key: %s, value: %d\n", item.mName, mPeriodMs);
+        } else if (!strcmp(item.mName, AUDIO_MIXER_KEEP_ALIVE)) {
+            if (item.mType != MediaMeta::MT_Int32) {
+                WARNING("invalid type for %s\n", item.mName);
+                continue;
+            }
+            mKeepAlive = item.mValue.ii != 0;
+            mCondition.signal();
+            INFO("key: %s, value: %d\n", item.mName, mKeepAlive);
+        } else if (!strcmp(item.mName, AUDIO_MIXER_INPUT_INDEX)) {
+            if (item.mType != MediaMeta::MT_Int32) {
+                WARNING("invalid type for %s\n", item.mName);
+                continue;
+            }
+            inputIndex = item.mValue.ii;
+        } else if (!strcmp(item.mName, AUDIO_MIXER_INPUT_GAIN)) {
+            if (item.mType != MediaMeta::MT_Float) {
+                WARNING("invalid type for %s\n", item.mName);
+                continue;
+            }
+            InputSP input = findInput_l(inputIndex);
+            if (!input || item.mValue.f < 0.0f) {
+                ERROR("invalid input %d or gain %f\n", inputIndex, item.mValue.f);
+                EXIT_AND_RETURN(MM_ERROR_INVALID_PARAM);
+            }
+            input->mGain = item.mValue.f;
+            INFO("input %d, gain %f\n", inputIndex, input->mGain);
+        } else {
+            WARNING("unknown parameter %s\n", item.mName);
+        }
+    }
+
+    EXIT_AND_RETURN(MM_ERROR_SUCCESS);
+}
+
+mm_status_t AudioMixer::getParameter(MediaMetaSP & meta) const
+{
+    ENTER();
+    MMAutoLock locker(const_cast<Lock&>(mLock));
+    // AudioDecodeFFmpeg resamples to MEDIA_ATTR_SAMPLE_RATE of its downstream component
+    meta->setInt32(MEDIA_ATTR_SAMPLE_RATE, mSampleRate);
+    meta->setInt32(MEDIA_ATTR_CHANNEL_COUNT, mChannelCount);
+    meta->setInt32(MEDIA_ATTR_SAMPLE_FORMAT, mFormat);
+    meta->setInt32(AUDIO_MIXER_PERIOD_MS, mPeriodMs);
+    meta->setInt32(AUDIO_MIXER_INPUT_COUNT, (int32_t)mInputs.size());
+    meta->setInt32(AUDIO_MIXER_UNDERRUNS, (int32_t)mUnderruns);
+    EXIT_AND_RETURN(MM_ERROR_SUCCESS);
+}
+
+} // YUNOS_MM
+
+/////////////////////////////////////////////////////////////////////////////////////
+extern "C" {
+
+YUNOS_MM::Component* createComponent(const char* mimeType, bool isEncoder)
+{
+    YUNOS_MM::AudioMixer *mixer = new YUNOS_MM::AudioMixer(mimeType, isEncoder);
+    if (mixer == NULL) {
+        return NULL;
+    }
+    return static_cast<YUNOS_MM::Component*>(mixer);
+}
+
+void releaseComponent(YUNOS_MM::Component *component)
+{
+    delete component;
+}
+
+}
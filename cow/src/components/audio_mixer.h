@@ -0,0 +1,170 @@
+/**
+ * Copyright (C) 2017 Alibaba Group Holding Limited. All Rights Reserved.
+ *
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef audio_mixer_h
+#define audio_mixer_h
+
+#include <list>
+#include <vector>
+#include "multimedia/mm_cpp_utils.h"
+#include "multimedia/component.h"
+#include "multimedia/mmmsgthread.h"
+#include "multimedia/media_monitor.h"
+#include "multimedia/clock.h"
+#include "clock_wrapper.h"
+#include "audio_process.h"
+
+// output period in ms, int32
+#define AUDIO_MIXER_PERIOD_MS       "mixer-period-ms"
+// int32, 1: keep running with silence when all inputs reach EOS instead of sending EOS downstream
+#define AUDIO_MIXER_KEEP_ALIVE      "mixer-keep-alive"
+// int32 input index followed by float gain, in the same MediaMeta
+#define AUDIO_MIXER_INPUT_INDEX     "mixer-input-index"
+#define AUDIO_MIXER_INPUT_GAIN      "mixer-input-gain"
+// int32, read only
+#define AUDIO_MIXER_INPUT_COUNT     "mixer-input-count"
+#define AUDIO_MIXER_UNDERRUNS       "mixer-underruns"
+
+namespace YUNOS_MM {
+
+/*
+ * AudioMixer mixes N upstream audio components into one sink stream.
+ * - each upstream component calls addSink(mixer) and gets its own input writer (slave mode only)
+ * - mixing is done per period on a float bus, with per-input gain, by the MixThread
+ * - output buffers are pushed to the sink added by addSink(), paced by TrafficControl
+ * - inputs must have the mixer sample rate, AudioDecodeFFmpeg resamples to MEDIA_ATTR_SAMPLE_RATE
+ *   reported by getParameter(); format and channel count are converted by AudioProcessor
+ * - every input has its own clock: the mixer anchors it with the input pts mapped to the time
+ *   the mixed period is rendered by the sink, so video/subtitle sinks of that input can follow it
+ */
+class AudioMixer : public FilterComponent, public MMMsgThread {
+  public:
+    enum {
+        // param2: input index, all data of the input has been mixed after it got EOS
+        kEventInfoMixerInputEOS = kEventInfoFilterStart,
+        // param2: input index, the input starved and silence was mixed in
+        kEventInfoMixerInputUnderrun,
+    };
+
+    AudioMixer(const char *mimeType = NULL, bool isEncoder = false);
+    virtual ~AudioMixer();
+
+    virtual const char * name() const;
+    COMPONENT_VERSION;
+    virtual mm_status_t init();
+    virtual void uninit();
+
+    virtual ReaderSP getReader(MediaType mediaType) { return ReaderSP((Reader*)NULL); }
+    virtual WriterSP getWriter(MediaType mediaType);
+    virtual mm_status_t addSource(Component * component, MediaType mediaType);
+    virtual mm_status_t addSink(Component * component, MediaType mediaType);
+
+    virtual mm_status_t prepare();
+    virtual mm_status_t start();
+    virtual mm_status_t stop();
+    virtual mm_status_t pause();
+    virtual mm_status_t resume();
+    virtual mm_status_t seek(int msec, int seekSequence) { return MM_ERROR_SUCCESS; }
+    virtual mm_status_t reset();
+    virtual mm_status_t flush();
+    virtual mm_status_t drain() { return MM_ERROR_UNSUPPORTED; }
+    virtual mm_status_t setParameter(const MediaMetaSP & meta);
+    virtual mm_status_t getParameter(MediaMetaSP & meta) const;
+
+    // clock of the input created by the latest getWriter(), pipelines ask for it right after connecting
+    virtual ClockSP provideClock();
+    ClockSP getInputClock(int32_t index);
+    mm_status_t setInputGain(int32_t index, float gain);
+    // drop the queued data of one input, for seek of one of the upstream pipelines
+    mm_status_t flushInput(int32_t index);
+
+  private:
+    struct Input;
+    typedef MMSharedPtr<Input> InputSP;
+
+    class MixerWriter : public Writer {
+      public:
+        MixerWriter(AudioMixer *mixer, InputSP input);
+        virtual ~MixerWriter();
+        virtual mm_status_t write(const MediaBufferSP &buffer);
+        virtual mm_status_t setMetaData(const MediaMetaSP & metaData);
+      private:
+        AudioMixer *mMixer;
+        InputSP mInput;
+    };
+
+    class MixThread;
+    typedef MMSharedPtr<MixThread> MixThreadSP;
+
+    enum StateType {
+        kStateNull = 0,
+        kStatePrepared,
+        kStatePaused,
+        kStatePlaying,
+        kStateStopped,
+    };
+
+    InputSP findInput_l(int32_t index);
+    void clearInput_l(InputSP &input);
+    bool hasPendingData_l();
+    bool mixOnePeriod();
+    int32_t mixInput_l(InputSP &input, int64_t realUs);
+    int64_t periodRealTimeUs();
+
+    Lock mLock;
+    Condition mCondition;
+    std::string mComponentName;
+    StateType mState;
+
+    int32_t mSampleRate;
+    int32_t mChannelCount;
+    snd_format_t mFormat;
+    int32_t mPeriodMs;
+    int32_t mPeriodFrames;
+    bool mKeepAlive;
+    bool mFormatLocked;      // an input has been configured, output format can't change any more
+
+    std::vector<InputSP> mInputs;
+    int32_t mNextInputIndex;
+    std::vector<float> mBus;
+
+    WriterSP mWriter;
+    ClockWrapperSP mSinkClock;   // observes the sink clock, which runs in mixer output time
+    MediaMetaSP mOutputFormat;
+    AudioBufferPoolSP mPool;
+    MonitorSP mMonitorWrite;
+    MixThreadSP mMixThread;
+
+    int64_t mOutputFrames;
+    bool mOutputEOS;
+    uint32_t mUnderruns;
+
+    DECLARE_MSG_LOOP()
+    DECLARE_MSG_HANDLER(onPrepare)
+    DECLARE_MSG_HANDLER(onStart)
+    DECLARE_MSG_HANDLER(onPause)
+    DECLARE_MSG_HANDLER(onResume)
+    DECLARE_MSG_HANDLER(onStop)
+    DECLARE_MSG_HANDLER(onFlush)
+    DECLARE_MSG_HANDLER(onReset)
+
+    MM_DISALLOW_COPY(AudioMixer)
+};
+
+}
+
+#endif // audio_mixer_h
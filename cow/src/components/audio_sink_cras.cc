@@ -15,6 +15,7 @@
  * limitations under the License.
  */
 #include "audio_sink_cras.h"
+#include "audio_process.h"
 #include "multimedia/mm_types.h"
 #include "multimedia/mm_errors.h"
 #include "multimedia/mmlistener.h"
@@ -148,6 +149,8 @@ class AudioSinkCras::Private
     int64_t mCurrentPositionUs;
 
     std::queue<MediaBufferSP> mAvailableSourceBuffers;
+    // converts pcm AudioRender can't take (float for example), NULL when not required
+    AudioProcessorSP mProcessor;
 
     ClockWrapperSP mClockWrapper;
 
@@ -367,6 +370,20 @@ mm_status_t AudioSinkCras::AudioSinkWriter::setMetaData(const MediaMetaSP & meta
         ERROR("fail to get int32_t data %s\n", MEDIA_ATTR_BUFFER_LIST);
     }
 
+    mRender->mPriv->mProcessor.reset();
+    if (mRender->mPriv->formatSize((snd_format_t)mRender->mPriv->mFormat) == 0 &&
+        AudioProcessor::isFormatSupported((snd_format_t)mRender->mPriv->mFormat)) {
+        AudioProcessorSP processor(new AudioProcessor("AudioSinkCras"));
+        if (processor->configure((snd_format_t)mRender->mPriv->mFormat, mRender->mPriv->mChannelCount,
+                SND_FORMAT_PCM_16_BIT, mRender->mPriv->mChannelCount) != MM_ERROR_SUCCESS) {
+            ERROR("unsupported format %d", mRender->mPriv->mFormat);
+            EXIT_AND_RETURN(MM_ERROR_UNSUPPORTED);
+        }
+        INFO("convert format %d to pcm 16 bit", mRender->mPriv->mFormat);
+        mRender->mPriv->mProcessor = processor;
+        mRender->mPriv->mFormat = SND_FORMAT_PCM_16_BIT;
+    }
+
     INFO("sampleRate %d, format %d, channel %d", mRender->mPriv->mSampleRate, mRender->mPriv->mFormat, mRender->mPriv->mChannelCount);
     EXIT_AND_RETURN(MM_ERROR_SUCCESS);
 }
@@ -925,6 +942,10 @@ void AudioSinkCras::onWrite(param1_type param1, param2_type param2, uint32_t rsp
 {
     ENTER();
     AudioSinkCras::Private::QueueEntry *pEntry = (AudioSinkCras::Private::QueueEntry *)param2;
+    if (pEntry->mBuffer && mPriv->mProcessor) {
+        // convert before queueing, onMoreData runs in AudioRender callback
+        pEntry->mBuffer = mPriv->mProcessor->process(pEntry->mBuffer);
+    }
     if (pEntry->mBuffer) {
         MMAutoLock locker(mPriv->mLock);
         mPriv->mAvailableSourceBuffers.push(pEntry->mBuffer);
@@ -16,7 +16,11 @@
  */
 
 #include <math.h>
+#include <string.h>
+#include <algorithm>
 #include "audio_sink_pulse.h"
+#include "audio_process.h"
+#include "pulse_latency.h"
 #include "multimedia/mm_types.h"
 #include "multimedia/mm_errors.h"
 #include "multimedia/mmlistener.h"
@@ -67,6 +71,19 @@ static const struct format_entry {
     {SND_FORMAT_INVALID, PA_SAMPLE_INVALID}
 };
 
+// pcm of an audio buffer: size bytes starting at data + offset, as the output thread writes it
+static int32_t getPcmPayload(const MediaBufferSP &buffer, uint8_t **payload)
+{
+    uint8_t *data = NULL;
+    int32_t offset = 0;
+    int32_t size = 0;
+    *payload = NULL;
+    if (!buffer->getBufferInfo((uintptr_t*)&data, &offset, &size, 1) || !data || size <= 0)
+        return 0;
+    *payload = data + offset;
+    return size;
+}
+
 #define ENTER() VERBOSE(">>>\n")
 #define EXIT() do {VERBOSE(" <<<\n"); return;}while(0)
 #define EXIT_AND_RETURN(_code) do {VERBOSE("<<<(status: %d)\n", (_code)); return (_code);}while(0)
@@ -156,6 +173,16 @@ class AudioSinkPulse::Private
         void main()
         {
           ENTER();
+          int err = audioThreadSetRealtime(mRender->mRtPriority);
+          if (err) {
+              WARNING("failed to set SCHED_FIFO priority %d (%s), keep normal priority", mRender->mRtPriority, strerror(err));
+          }
+          if (mRender->mLatencyMode == kAudioLatencyLow) {
+              lowLatencyLoop();
+              INFO("Output thread exited\n");
+              EXIT();
+          }
+
           MediaBufferSP mediaBuffer;
           uint8_t *sourceBuf = NULL;
           int64_t pts = 0;
@@ -218,6 +245,8 @@ class AudioSinkPulse::Private
 
                           if (pa_stream_get_latency(mRender->mPAStream, &latencyMicros, &negative) != 0)
                               ERROR("get latency error");
+                          else
+                              mRender->mLatencyUs = latencyMicros;
 
                           pa_sample_format paFormat = mRender->convertFormatToPulse((snd_format_t)mRender->mFormat);
                               pa_sample_spec sample_spec = {
@@ -273,6 +302,38 @@ class AudioSinkPulse::Private
           EXIT();
         }
 
+        // Low latency mode: every write is one minreq sized period, see writePeriod()
+        void lowLatencyLoop()
+        {
+          ENTER();
+          while (1) {
+              {
+                  MMAutoLock locker(mRender->mLock);
+                  if (!mContinue) {
+                      break;
+                  }
+                  if (mRender->mIsPaused || mRender->mAvailableSourceBuffers.empty()) {
+                      VERBOSE("waitting condition\n");
+                      mRender->mCondition.wait();
+                      continue;
+                  }
+              }
+
+              if (mRender->writePeriod()) {
+                  continue;
+              }
+
+              // streamWriteCallback() and onWrite() signal when a period may be ready, the timeout
+              // covers a signal sent between writePeriod() and the wait
+              MMAutoLock locker(mRender->mLock);
+              if (!mContinue) {
+                  break;
+              }
+              mRender->mCondition.timedWait(mRender->mPeriodUs);
+          }
+          EXIT();
+        }
+
       private:
         AudioSinkPulse::Private *mRender;
         bool mContinue;
@@ -340,6 +401,7 @@ class AudioSinkPulse::Private
     static void streamCorkCallback(pa_stream*s, int success, void *userdata);
     void clearPACallback();
     void clearSourceBuffers();
+    bool writePeriod();
     mm_status_t setVolume(double volume);
     double getVolume();
     mm_status_t setMute(bool mute);
@@ -364,6 +426,8 @@ class AudioSinkPulse::Private
     bool mIsDraining;
 
     std::queue<MediaBufferSP> mAvailableSourceBuffers;
+    // converts pcm the stream can't take (float for example), NULL when not required
+    AudioProcessorSP mProcessor;
 
     ClockWrapperSP mClockWrapper;
 
@@ -380,6 +444,19 @@ class AudioSinkPulse::Private
 #endif
     int32_t mScaledPlayRate;
     std::string mAudioConnectionId;
+
+    // latency mode, applied by the next creatPAStream()
+    int32_t mLatencyMode;
+    int32_t mLatencyTargetMs;
+    int32_t mRtPriority;
+    // latency reported by the server, from the last write
+    int64_t mLatencyUs;
+    // low latency mode only: the negotiated minreq, and the bookkeeping of the queued pcm
+    size_t mPeriodBytes;
+    int64_t mPeriodUs;
+    int32_t mFrontOffset;
+    int64_t mQueuedBytes;
+    bool mEOSQueued;
 #ifdef ENABLE_DEFAULT_AUDIO_CONNECTION
     ENSURE_AUDIO_DEF_CONNECTION_DECLARE()
 #endif
@@ -403,7 +480,16 @@ class AudioSinkPulse::Private
         mState(STATE_IDLE),
         mTotalBuffersQueued(0),
         mAudioSink(NULL),
-        mScaledPlayRate(SCALED_PLAY_RATE)
+        mScaledPlayRate(SCALED_PLAY_RATE),
+        mLatencyMode(kAudioLatencyDefault),
+        mLatencyTargetMs(0),
+        mRtPriority(0),
+        mLatencyUs(0),
+        mPeriodBytes(0),
+        mPeriodUs(0),
+        mFrontOffset(0),
+        mQueuedBytes(0),
+        mEOSQueued(false)
 
     {
         ENTER();
@@ -590,6 +676,20 @@ mm_status_t AudioSinkPulse::AudioSinkWriter::setMetaData(const MediaMetaSP & met
         EXIT_AND_RETURN(MM_ERROR_OP_FAILED);
     }
 
+    mRender->mPriv->mProcessor.reset();
+    if (mRender->mPriv->convertFormatToPulse((snd_format_t)mRender->mPriv->mFormat) == PA_SAMPLE_INVALID &&
+        AudioProcessor::isFormatSupported((snd_format_t)mRender->mPriv->mFormat)) {
+        AudioProcessorSP processor(new AudioProcessor("AudioSinkPulse"));
+        if (processor->configure((snd_format_t)mRender->mPriv->mFormat, mRender->mPriv->mChannelCount,
+                SND_FORMAT_PCM_16_BIT, mRender->mPriv->mChannelCount) != MM_ERROR_SUCCESS) {
+            ERROR("unsupported format %d", mRender->mPriv->mFormat);
+            EXIT_AND_RETURN(MM_ERROR_UNSUPPORTED);
+        }
+        INFO("convert format %d to pcm 16 bit", mRender->mPriv->mFormat);
+        mRender->mPriv->mProcessor = processor;
+        mRender->mPriv->mFormat = SND_FORMAT_PCM_16_BIT;
+    }
+
     INFO("sampleRate %d, format %d, channel %d", mRender->mPriv->mSampleRate, mRender->mPriv->mFormat, mRender->mPriv->mChannelCount);
 
     EXIT_AND_RETURN(MM_ERROR_SUCCESS);
@@ -645,6 +745,31 @@ mm_status_t AudioSinkPulse::setParameter(const MediaMetaSP & meta)
             continue;
         }
 
+        if ( !strcmp(item.mName, MEDIA_ATTR_AUDIO_LATENCY_MODE) ||
+             !strcmp(item.mName, MEDIA_ATTR_AUDIO_LATENCY_TARGET) ||
+             !strcmp(item.mName, MEDIA_ATTR_AUDIO_RT_PRIORITY) ) {
+            if ( item.mType != MediaMeta::MT_Int32 ) {
+                WARNING("invalid type for %s\n", item.mName);
+                continue;
+            }
+            if (mPriv->mPAStream) {
+                WARNING("%s takes effect from next prepare\n", item.mName);
+            }
+            if ( !strcmp(item.mName, MEDIA_ATTR_AUDIO_LATENCY_MODE) ) {
+                if (item.mValue.ii < kAudioLatencyDefault || item.mValue.ii > kAudioLatencyPowerSaving) {
+                    WARNING("invalid latency mode %d\n", item.mValue.ii);
+                    continue;
+                }
+                mPriv->mLatencyMode = item.mValue.ii;
+            } else if ( !strcmp(item.mName, MEDIA_ATTR_AUDIO_LATENCY_TARGET) ) {
+                mPriv->mLatencyTargetMs = item.mValue.ii;
+            } else {
+                mPriv->mRtPriority = item.mValue.ii;
+            }
+            INFO("key: %s, value: %d\n", item.mName, item.mValue.ii);
+            continue;
+        }
+
     }
 
     EXIT_AND_RETURN(MM_ERROR_SUCCESS);
@@ -659,6 +784,8 @@ mm_status_t AudioSinkPulse::getParameter(MediaMetaSP & meta) const
 
     meta->setInt32(MEDIA_ATTR_MUTE, mPriv->mMute);
     meta->setInt64(MEDIA_ATTR_VOLUME, mPriv->mVolume);
+    meta->setInt32(MEDIA_ATTR_AUDIO_LATENCY_MODE, mPriv->mLatencyMode);
+    meta->setInt64(MEDIA_ATTR_AUDIO_LATENCY, mPriv->mLatencyUs);
 
     EXIT_AND_RETURN(MM_ERROR_SUCCESS);
 }
@@ -934,8 +1061,18 @@ void AudioSinkPulse::onWrite(param1_type param1, param2_type param2, uint32_t rs
 {
     ENTER();
     AudioSinkPulse::Private::QueueEntry *pEntry = (AudioSinkPulse::Private::QueueEntry *)param2;
+    if (pEntry->mBuffer && mPriv->mProcessor) {
+        // convert on the msg thread, the output thread only does pa_stream_write
+        pEntry->mBuffer = mPriv->mProcessor->process(pEntry->mBuffer);
+    }
     if (pEntry->mBuffer) {
         MMAutoLock locker(mPriv->mLock);
+        if (mPriv->mLatencyMode == kAudioLatencyLow) {
+            uint8_t *data = NULL;
+            mPriv->mQueuedBytes += getPcmPayload(pEntry->mBuffer, &data);
+            if (pEntry->mBuffer->isFlagSet(MediaBuffer::MBFT_EOS))
+                mPriv->mEOSQueued = true;
+        }
         mPriv->mAvailableSourceBuffers.push(pEntry->mBuffer);
         mPriv->mCondition.signal();
     } else {
@@ -1306,14 +1443,19 @@ mm_status_t AudioSinkPulse::Private::creatPAStream()
         .channels = (uint8_t)mChannelCount
     };
     pa_buffer_attr wanted;
-    wanted.maxlength = (uint32_t)-1; // max buffer size on the server
-    wanted.tlength = (uint32_t) pa_usec_to_bytes(PA_USEC_PER_MSEC * 200/*DEFAULT_TLENGTH_MSEC*/, &sample_spec);
-    //wanted.tlength = (uint32_t)-1; // ?
-    wanted.prebuf = 1;//(uint32_t)-1; // play as soon as possible
-    wanted.minreq = (uint32_t)-1;
-    wanted.fragsize = (uint32_t)-1;
     // PA_STREAM_NOT_MONOTONIC?
     pa_stream_flags_t flags = pa_stream_flags_t(PA_STREAM_NOT_MONOTONIC|PA_STREAM_INTERPOLATE_TIMING|PA_STREAM_AUTO_TIMING_UPDATE);
+    if (mLatencyMode == kAudioLatencyDefault) {
+        wanted.maxlength = (uint32_t)-1; // max buffer size on the server
+        wanted.tlength = (uint32_t) pa_usec_to_bytes(PA_USEC_PER_MSEC * 200/*DEFAULT_TLENGTH_MSEC*/, &sample_spec);
+        //wanted.tlength = (uint32_t)-1; // ?
+        wanted.prebuf = 1;//(uint32_t)-1; // play as soon as possible
+        wanted.minreq = (uint32_t)-1;
+        wanted.fragsize = (uint32_t)-1;
+    } else {
+        flags = pa_stream_flags_t(flags | pulseLatencyBufferAttr(mLatencyMode, mLatencyTargetMs, &sample_spec, true, &wanted));
+        INFO("latency mode %d, tlength %u, minreq %u\n", mLatencyMode, wanted.tlength, wanted.minreq);
+    }
     if (pa_stream_connect_playback(mPAStream, NULL, &wanted, flags, NULL, NULL) < 0) {
         ERROR("PulseAudio failed: pa_stream_connect_playback");
         EXIT_AND_RETURN(MM_ERROR_OP_FAILED);
@@ -1335,6 +1477,17 @@ mm_status_t AudioSinkPulse::Private::creatPAStream()
         EXIT_AND_RETURN(MM_ERROR_OP_FAILED);
     }
 
+    const pa_buffer_attr *attr = pa_stream_get_buffer_attr(mPAStream);
+    if (attr) {
+        INFO("negotiated maxlength %u, tlength %u, prebuf %u, minreq %u\n",
+            attr->maxlength, attr->tlength, attr->prebuf, attr->minreq);
+        mLatencyUs = pa_bytes_to_usec((uint64_t)attr->tlength, &sample_spec);
+        mPeriodBytes = attr->minreq;
+    } else {
+        mPeriodBytes = pa_usec_to_bytes(PA_USEC_PER_MSEC * AUDIO_LOW_LATENCY_TARGET_MS / 2, &sample_spec);
+    }
+    mPeriodUs = pa_bytes_to_usec((uint64_t)mPeriodBytes, &sample_spec);
+
     INFO("over\n");
     EXIT_AND_RETURN(MM_ERROR_SUCCESS);
 
@@ -1482,6 +1635,107 @@ void AudioSinkPulse::Private::clearSourceBuffers()
     while(!mAvailableSourceBuffers.empty()) {
         mAvailableSourceBuffers.pop();
     }
+    mFrontOffset = 0;
+    mQueuedBytes = 0;
+    mEOSQueued = false;
+}
+
+// Write one period, assembled directly in the memblock from pa_stream_begin_write().
+// A short period is written only at EOS or when the server is about to run dry.
+// Returns false when nothing has been written and the caller should wait.
+bool AudioSinkPulse::Private::writePeriod()
+{
+    PAMMAutoLock paLoop(mPALoop);
+    if (mScaledPlayRate != SCALED_PLAY_RATE) {
+        return false;
+    }
+    size_t writable = pa_stream_writable_size(mPAStream);
+    if (writable == (size_t)-1 || writable < mPeriodBytes) {
+        return false;
+    }
+
+    pa_usec_t latencyMicros = 0;
+    int negative = 0;
+    if (pa_stream_get_latency(mPAStream, &latencyMicros, &negative) == 0) {
+        mLatencyUs = latencyMicros;
+    }
+
+    {
+        MMAutoLock locker(mLock);
+        if (mQueuedBytes < (int64_t)mPeriodBytes && !mEOSQueued && latencyMicros > (pa_usec_t)mPeriodUs) {
+            return false;
+        }
+    }
+
+    void *data = NULL;
+    size_t nbytes = mPeriodBytes;
+    if (pa_stream_begin_write(mPAStream, &data, &nbytes) < 0 || !data) {
+        ERROR("pa_stream_begin_write failed: %s", pa_strerror(pa_context_errno(mPAContext)));
+        return false;
+    }
+    if (nbytes > mPeriodBytes) {
+        nbytes = mPeriodBytes;
+    }
+
+    pa_sample_spec sample_spec = {
+        .format = convertFormatToPulse((snd_format_t)mFormat),
+        .rate = (uint32_t)mSampleRate,
+        .channels = (uint8_t)mChannelCount
+    };
+    size_t filled = 0;
+    int64_t pts = -1;
+    bool eos = false;
+    {
+        MMAutoLock locker(mLock);
+        while (filled < nbytes && !mAvailableSourceBuffers.empty()) {
+            MediaBufferSP buffer = mAvailableSourceBuffers.front();
+            uint8_t *sourceBuf = NULL;
+            int32_t size = getPcmPayload(buffer, &sourceBuf);
+            int32_t left = 0;
+            if (sourceBuf && buffer->type() == MediaBuffer::MBT_RawAudio) {
+                left = size - mFrontOffset;
+            } else if (sourceBuf) {
+                ERROR("wrong buffer type %d", buffer->type());
+            }
+
+            if (left > 0) {
+                if (pts < 0 && buffer->pts() >= 0) {
+                    pts = buffer->pts() + pa_bytes_to_usec((uint64_t)mFrontOffset, &sample_spec);
+                }
+                size_t copy = std::min((size_t)left, nbytes - filled);
+                memcpy((uint8_t*)data + filled, sourceBuf + mFrontOffset, copy);
+                filled += copy;
+                left -= copy;
+                mFrontOffset += copy;
+                mQueuedBytes -= copy;
+            }
+            if (left <= 0) {
+                eos = buffer->isFlagSet(MediaBuffer::MBFT_EOS);
+                mAvailableSourceBuffers.pop();
+                mFrontOffset = 0;
+                if (eos) {
+                    mEOSQueued = false;
+                    break;
+                }
+            }
+        }
+    }
+
+    if (filled > 0) {
+        if (pts >= 0) {
+            int64_t duration = pa_bytes_to_usec((uint64_t)filled, &sample_spec);
+            mClockWrapper->setAnchorTime(pts, Clock::getNowUs() + latencyMicros, pts + duration);
+        }
+        pa_stream_write(mPAStream, data, filled, NULL, 0LL, PA_SEEK_RELATIVE);
+    } else {
+        pa_stream_cancel_write(mPAStream);
+    }
+
+    if (eos) {
+        streamDrain();
+        mAudioSink->notify(kEventEOS, 0, 0, nilParam);
+    }
+    return filled > 0 || eos;
 }
 
 mm_status_t AudioSinkPulse::Private::setVolume(double volume)
@@ -17,6 +17,7 @@
 
 
 #include "audio_src_pulse.h"
+#include "pulse_latency.h"
 #include "multimedia/mm_types.h"
 #include "multimedia/mm_errors.h"
 #include "multimedia/mmlistener.h"
@@ -54,6 +55,13 @@ static const char * MMTHREAD_NAME = "AudioSinkPulse::Private::InputThread";
 #define DEFAULT_CHANNEL         2
 #define DEFAULT_FORMAT          SND_FORMAT_PCM_16_BIT
 #define CLOCK_TIME_NONE         -1
+#define MAX_PERIOD_MS           1000
+#define PERIOD_POOL_MS          1000    // audio preallocated for period buffers, see PeriodPool
+#define MAX_PERIOD_POOL_MS      4000    // audio held downstream before the capture is dropped
+#define MIN_PERIOD_POOL_COUNT   4
+
+// meta of a period buffer, see PeriodPool::releasePeriod()
+static const char * PERIOD_POOL_KEY = "pulse-period-pool";
 
 #define PA_ERROR(_retcode, _info, _pa_err_no) do {\
         ERROR("%s, retcode: %d, pa: %s\n", _info, _retcode, pa_strerror(_pa_err_no));\
@@ -116,6 +124,100 @@ class AudioSrcPulse::Private
         mm_status_t mFinalResult;
     };
 
+    /* fixed size blocks for the period buffers, allocated at prepare. a buffer gives its block back
+     * when released; it holds the pool through its meta, so it may outlive reset().
+     * the pool grows up to maxCount blocks when downstream holds all of them, then acquire()
+     * fails and the capture is dropped until blocks come back.
+     */
+    class PeriodPool;
+    typedef MMSharedPtr<PeriodPool> PeriodPoolSP;
+    class PeriodPool {
+    public:
+        PeriodPool(size_t periodBytes, uint32_t count, uint32_t maxCount)
+            : mPeriodBytes(periodBytes)
+            , mCount(0)
+            , mMaxCount(maxCount)
+        {
+            grow(count);
+        }
+
+        ~PeriodPool()
+        {
+            for (size_t i = 0; i < mChunks.size(); i++)
+                delete [] mChunks[i];
+        }
+
+        // NULL if downstream holds all the blocks and the pool is at its max
+        uint8_t *acquire()
+        {
+            MMAutoLock locker(mLock);
+            if (mFree.empty()) {
+                if (mCount >= mMaxCount)
+                    return NULL;
+                uint32_t count = mCount / 2 + 1;
+                if (count > mMaxCount - mCount)
+                    count = mMaxCount - mCount;
+                WARNING("all %d periods are held downstream, grow the pool by %d\n", mCount, count);
+                grow(count);
+            }
+            uint8_t *block = mFree.back();
+            mFree.pop_back();
+            return block;
+        }
+
+        void recycle(uint8_t *block)
+        {
+            MMAutoLock locker(mLock);
+            mFree.push_back(block);
+        }
+
+        size_t periodBytes() const { return mPeriodBytes; }
+
+        static bool releasePeriod(MediaBuffer *mediaBuf)
+        {
+            uint8_t *block = NULL;
+            void *ptr = NULL;
+            MediaMetaSP meta = mediaBuf->getMediaMeta();
+            if (!mediaBuf->getBufferInfo((uintptr_t *)&block, NULL, NULL, 1) || !meta ||
+                !meta->getPointer(PERIOD_POOL_KEY, ptr) || !ptr) {
+                WARNING("period buffer without its pool\n");
+                return false;
+            }
+            PeriodPoolSP *pool = (PeriodPoolSP*)ptr;
+            (*pool)->recycle(block);
+            delete pool;
+            return true;
+        }
+
+    private:
+        // with mLock held, or from the constructor
+        void grow(uint32_t count)
+        {
+            uint8_t *chunk = new uint8_t[mPeriodBytes * count];
+            mChunks.push_back(chunk);
+            mCount += count;
+            // recycle() never reallocates
+            mFree.reserve(mCount);
+            for (uint32_t i = 0; i < count; i++)
+                mFree.push_back(chunk + i * mPeriodBytes);
+        }
+
+        size_t mPeriodBytes;
+        uint32_t mCount;
+        uint32_t mMaxCount;
+        Lock mLock;
+        std::vector<uint8_t*> mFree;
+        std::vector<uint8_t*> mChunks;
+
+        MM_DISALLOW_COPY(PeriodPool);
+    };
+
+    // a filled period, timestamped once the whole read is done
+    struct ReadyPeriod {
+        uint8_t *mBlock;
+        size_t mEndByte;    // read position after its last byte
+    };
+
     class AudioSrcReader : public Reader {
     public:
         AudioSrcReader(AudioSrcPulse * src){
@@ -193,6 +295,10 @@ class AudioSrcPulse::Private
             ENTER();
             int toRead = 0;
             size_t readSize = 0;
+            int err = audioThreadSetRealtime(mPriv->mRtPriority);
+            if (err) {
+                WARNING("failed to set SCHED_FIFO priority %d (%s), keep normal priority", mPriv->mRtPriority, strerror(err));
+            }
             while(1) {
                 {
                     MMAutoLock locker(mPriv->mLock);
@@ -217,6 +323,10 @@ class AudioSrcPulse::Private
                 }
 
                 mPriv->mPAReadData = NULL;
+                if (mPriv->mPeriodBytes) {
+                    mPriv->readPeriods(toRead);
+                    continue;
+                }
                 while(toRead > 0) {
                     MediaBufferSP mediaBuf = MediaBuffer::createMediaBuffer(MediaBuffer::MBT_RawAudio);
                     uint8_t *buffer = NULL;
@@ -251,6 +361,11 @@ class AudioSrcPulse::Private
                         if (ret != 0) {
                             MMLOGE("drop error: %d\n", ret);
                         }
+                        pa_usec_t latencyMicros = 0;
+                        int negative = 0;
+                        if (pa_stream_get_latency(mPriv->mPAStream, &latencyMicros, &negative) == 0) {
+                            mPriv->mLatencyUs = negative ? 0 : latencyMicros;
+                        }
                         mediaBuf->setPts(mPriv->mPTS);
                         pa_sample_spec sample_spec = {
                             .format = mPriv->convertFormatToPulse((snd_format_t)mPriv->mFormat),
@@ -347,6 +462,10 @@ class AudioSrcPulse::Private
     bool getMute();
     bool waitPAOperation(pa_operation *op);
     mm_status_t resumeInternal();
+    pa_sample_spec sampleSpec();
+    void setupPeriods();
+    void readPeriods(size_t toRead);
+    void dropPartialPeriod();
 
     pa_threaded_mainloop *mPALoop;
     pa_context *mPAContext;
@@ -373,6 +492,24 @@ class AudioSrcPulse::Private
     const uint8_t * mPAReadData;
     uint64_t mDoubleDuration;
     uint64_t mPTS;
+    // latency mode, applied by the next creatPAStream()
+    int32_t mLatencyMode;
+    int32_t mLatencyTargetMs;
+    int32_t mRtPriority;
+    int64_t mLatencyUs;
+    // period framing, see readPeriods(). the fill state is used with the PA loop locked
+    int32_t mPeriodMs;          // 0 (default) passes the fragments of the server through
+    int32_t mFragsizeMs;        // 0 follows the latency mode, else the period
+    size_t mPeriodBytes;
+    int64_t mPeriodUs;
+    uint8_t mSilence;
+    PeriodPoolSP mPeriodPool;
+    uint8_t *mFill;             // period being filled
+    size_t mFillBytes;
+    std::vector<ReadyPeriod> mReadyPeriods;
+    int64_t mCaptureBaseUs;     // capture time of mPtsOrigin, -1 until the first period after start/flush
+    uint64_t mPtsOrigin;
+    uint64_t mBytesSinceOrigin;
 #ifdef DUMP_SRC_PULSE_DATA
             FILE* mDumpFile;
 #endif
@@ -399,7 +536,21 @@ class AudioSrcPulse::Private
         mTotalBuffersQueued(0),
         mPAReadData(NULL),
         mDoubleDuration(0),
-        mPTS(0)
+        mPTS(0),
+        mLatencyMode(kAudioLatencyDefault),
+        mLatencyTargetMs(0),
+        mRtPriority(0),
+        mLatencyUs(0),
+        mPeriodMs(0),
+        mFragsizeMs(0),
+        mPeriodBytes(0),
+        mPeriodUs(0),
+        mSilence(0),
+        mFill(NULL),
+        mFillBytes(0),
+        mCaptureBaseUs(-1),
+        mPtsOrigin(0),
+        mBytesSinceOrigin(0)
 
     {
         ENTER();
@@ -640,6 +791,53 @@ mm_status_t AudioSrcPulse::setParameter(const MediaMetaSP & meta)
             MMLOGI("key: %s, value: %d\n", item.mName, mPriv->mChannelCount);
             continue;
         }
+        if ( !strcmp(item.mName, MEDIA_ATTR_AUDIO_LATENCY_MODE) ) {
+            if ( item.mType != MediaMeta::MT_Int32 ||
+                 item.mValue.ii < kAudioLatencyDefault || item.mValue.ii > kAudioLatencyPowerSaving ) {
+                MMLOGW("invalid value for %s\n", item.mName);
+                continue;
+            }
+            mPriv->mLatencyMode = item.mValue.ii;
+            MMLOGI("key: %s, value: %d\n", item.mName, mPriv->mLatencyMode);
+            continue;
+        }
+        if ( !strcmp(item.mName, MEDIA_ATTR_AUDIO_LATENCY_TARGET) ) {
+            if ( item.mType != MediaMeta::MT_Int32 ) {
+                MMLOGW("invalid type for %s\n", item.mName);
+                continue;
+            }
+            mPriv->mLatencyTargetMs = item.mValue.ii;
+            MMLOGI("key: %s, value: %d\n", item.mName, mPriv->mLatencyTargetMs);
+            continue;
+        }
+        if ( !strcmp(item.mName, MEDIA_ATTR_AUDIO_RT_PRIORITY) ) {
+            if ( item.mType != MediaMeta::MT_Int32 ) {
+                MMLOGW("invalid type for %s\n", item.mName);
+                continue;
+            }
+            mPriv->mRtPriority = item.mValue.ii;
+            MMLOGI("key: %s, value: %d\n", item.mName, mPriv->mRtPriority);
+            continue;
+        }
+        // applied by the next prepare()
+        if ( !strcmp(item.mName, MEDIA_ATTR_AUDIO_PERIOD) ) {
+            if ( item.mType != MediaMeta::MT_Int32 || item.mValue.ii < 0 || item.mValue.ii > MAX_PERIOD_MS ) {
+                MMLOGW("invalid value for %s\n", item.mName);
+                continue;
+            }
+            mPriv->mPeriodMs = item.mValue.ii;
+            MMLOGI("key: %s, value: %d\n", item.mName, mPriv->mPeriodMs);
+            continue;
+        }
+        if ( !strcmp(item.mName, MEDIA_ATTR_AUDIO_FRAGSIZE) ) {
+            if ( item.mType != MediaMeta::MT_Int32 || item.mValue.ii < 0 ) {
+                MMLOGW("invalid value for %s\n", item.mName);
+                continue;
+            }
+            mPriv->mFragsizeMs = item.mValue.ii;
+            MMLOGI("key: %s, value: %d\n", item.mName, mPriv->mFragsizeMs);
+            continue;
+        }
     }
 
     EXIT_AND_RETURN(MM_ERROR_SUCCESS);
@@ -656,6 +854,10 @@ mm_status_t AudioSrcPulse::getParameter(MediaMetaSP & meta) const
     PAMMAutoLock paLoop(mPriv->mPALoop);
     meta->setInt64(MEDIA_ATTR_VOLUME, mPriv->getVolume());
     meta->setInt32(MEDIA_ATTR_MUTE, mPriv->getMute());
+    meta->setInt32(MEDIA_ATTR_AUDIO_LATENCY_MODE, mPriv->mLatencyMode);
+    meta->setInt64(MEDIA_ATTR_AUDIO_LATENCY, mPriv->mLatencyUs);
+    meta->setInt32(MEDIA_ATTR_AUDIO_PERIOD, mPriv->mPeriodMs);
+    meta->setInt32(MEDIA_ATTR_AUDIO_FRAGSIZE, mPriv->mFragsizeMs);
 
     EXIT_AND_RETURN(MM_ERROR_SUCCESS);
 }
@@ -684,6 +886,7 @@ void AudioSrcPulse::onPrepare(param1_type param1, param2_type param2, uint32_t r
     };
     size_t frameSize = pa_frame_size(&sample_spec);
     mPriv->mDoubleDuration = pa_bytes_to_usec((uint64_t)frameSize, &sample_spec) * 1000ll;
+    mPriv->setupPeriods();
     setState(mPriv->mState, mPriv->STATE_PREPARED);
     notify(kEventPrepareResult, MM_ERROR_SUCCESS, 0, nilParam);
     EXIT1();
@@ -704,6 +907,8 @@ mm_status_t AudioSrcPulse::Private::resumeInternal()
         EXIT_AND_RETURN(MM_ERROR_INVALID_PARAM);
     }
 
+    // the pause isn't a capture gap, the pts goes on from where it was
+    mCaptureBaseUs = -1;
     mIsPaused = false;
     setState(mState, STATE_STARTED);
     mAudioSource->notify(kEventStartResult, MM_ERROR_SUCCESS, 0, nilParam);
@@ -764,6 +969,7 @@ void AudioSrcPulse::onStop(param1_type param1, param2_type param2, uint32_t rspI
         }
     }
     mPriv->clearPACallback();
+    mPriv->dropPartialPeriod();
     setState(mPriv->mState, mPriv->STATE_STOPED);
     notify(kEventStopped, MM_ERROR_SUCCESS, 0, nilParam);
     EXIT1();
@@ -801,6 +1007,7 @@ void AudioSrcPulse::onFlush(param1_type param1, param2_type param2, uint32_t rsp
             notify(kEventError, MM_ERROR_OP_FAILED, 0, nilParam);
             EXIT1();
         }
+        mPriv->dropPartialPeriod();
     }
 
     MMAutoLock locker(mPriv->mLock);
@@ -819,6 +1026,7 @@ void AudioSrcPulse::onSeek(param1_type param1, param2_type param2, uint32_t rspI
             notify(kEventError, MM_ERROR_OP_FAILED, 0, nilParam);
             EXIT1();
         }
+        mPriv->dropPartialPeriod();
     }
     MMAutoLock locker(mPriv->mLock);
     mPriv->clearSourceBuffers();
@@ -853,12 +1061,14 @@ void AudioSrcPulse::onReset(param1_type param1, param2_type param2, uint32_t rsp
             }
         }
         mPriv->clearPACallback();
+        mPriv->dropPartialPeriod();
     }
     {
         MMAutoLock locker(mPriv->mLock);
         mPriv->clearSourceBuffers();
     }
     mPriv->release();
+    mPriv->mPeriodPool.reset();
     setState(mPriv->mState, mPriv->STATE_IDLE);
     notify(kEventResetComplete, MM_ERROR_SUCCESS, 0, nilParam);
     EXIT1();
@@ -1232,6 +1442,20 @@ mm_status_t AudioSrcPulse::Private::creatPAStream()
     attr.prebuf = (uint32_t)-1;
     attr.minreq = (uint32_t) -1;
     attr.fragsize = (uint32_t) -1;
+    if (mFragsizeMs > 0) {
+        // an explicit target wins over the latency mode; the server adjusts the source latency to it
+        attr.fragsize = (uint32_t)pa_usec_to_bytes(PA_USEC_PER_MSEC * mFragsizeMs, &ss);
+        flags |= PA_STREAM_ADJUST_LATENCY;
+        MMLOGI("fragsize target %d ms, %u bytes\n", mFragsizeMs, attr.fragsize);
+    } else if (mLatencyMode != kAudioLatencyDefault) {
+        // fragsize is how much the server collects before the read callback
+        flags |= pulseLatencyBufferAttr(mLatencyMode, mLatencyTargetMs, &ss, false, &attr);
+        MMLOGI("latency mode %d, fragsize %u\n", mLatencyMode, attr.fragsize);
+    } else if (mPeriodMs > 0) {
+        // about one period per read callback, instead of the server default
+        attr.fragsize = (uint32_t)pa_usec_to_bytes(PA_USEC_PER_MSEC * mPeriodMs, &ss);
+        MMLOGI("fragsize of one period, %u bytes\n", attr.fragsize);
+    }
     int ret = pa_stream_connect_record(mPAStream, NULL, &attr, (pa_stream_flags_t)flags);
     if( ret != 0 ){
         ERROR("PulseAudio: failed to connect record stream");
@@ -1264,6 +1488,12 @@ mm_status_t AudioSrcPulse::Private::creatPAStream()
         EXIT_AND_RETURN(MM_ERROR_OP_FAILED);
     }
 
+    const pa_buffer_attr *negotiated = pa_stream_get_buffer_attr(mPAStream);
+    if (negotiated) {
+        INFO("negotiated maxlength %u, fragsize %u\n", negotiated->maxlength, negotiated->fragsize);
+        mLatencyUs = pa_bytes_to_usec((uint64_t)negotiated->fragsize, &ss);
+    }
+
     INFO("over\n");
     EXIT_AND_RETURN(MM_ERROR_SUCCESS);
 
@@ -1388,6 +1618,180 @@ void AudioSrcPulse::Private::clearSourceBuffers()
     }
 }
 
+pa_sample_spec AudioSrcPulse::Private::sampleSpec()
+{
+    pa_sample_spec spec = {
+        .format = convertFormatToPulse((snd_format_t)mFormat),
+        .rate = (uint32_t)mSampleRate,
+        .channels = (uint8_t)mChannelCount
+    };
+    return spec;
+}
+
+void AudioSrcPulse::Private::setupPeriods()
+{
+    pa_sample_spec spec = sampleSpec();
+    mPeriodBytes = 0;
+    mPeriodUs = 0;
+    mFill = NULL;
+    mFillBytes = 0;
+    mCaptureBaseUs = -1;
+    mPtsOrigin = mPTS;
+    mBytesSinceOrigin = 0;
+    mPeriodPool.reset();
+    if (mPeriodMs <= 0)
+        return;
+
+    mPeriodBytes = pa_usec_to_bytes(PA_USEC_PER_MSEC * mPeriodMs, &spec);
+    if (!mPeriodBytes) {
+        WARNING("period of %d ms is less than one frame, pass the fragments through\n", mPeriodMs);
+        return;
+    }
+    mPeriodUs = pa_bytes_to_usec((uint64_t)mPeriodBytes, &spec);
+    mSilence = spec.format == PA_SAMPLE_U8 ? 0x80 : 0;
+    uint32_t count = PERIOD_POOL_MS / mPeriodMs;
+    if (count < MIN_PERIOD_POOL_COUNT)
+        count = MIN_PERIOD_POOL_COUNT;
+    uint32_t maxCount = MAX_PERIOD_POOL_MS / mPeriodMs;
+    if (maxCount < count)
+        maxCount = count;
+    mPeriodPool.reset(new PeriodPool(mPeriodBytes, count, maxCount));
+    mReadyPeriods.reserve(count);
+    INFO("period %d ms, %zu bytes, %d preallocated, at most %d\n", mPeriodMs, mPeriodBytes, count, maxCount);
+}
+
+// with the PA loop locked, or once the input thread is gone
+void AudioSrcPulse::Private::dropPartialPeriod()
+{
+    if (mFill && mPeriodPool)
+        mPeriodPool->recycle(mFill);
+    mFill = NULL;
+    mFillBytes = 0;
+    mCaptureBaseUs = -1;
+}
+
+/*
+ * Frame the captured data in buffers of exactly one period, copied once from the server memblock
+ * into a pool block. a hole (data lost by the server) is filled with silence so the time goes on.
+ * pts counts the samples read. pa_stream_get_latency() tells when the sample at the read position
+ * was captured: it gives the birth time of every buffer (so ageInMs() is the capture to delivery
+ * latency downstream), and moves the pts on when the capture is more than two periods ahead of
+ * it, i.e. the server dropped data on overflow.
+ */
+void AudioSrcPulse::Private::readPeriods(size_t toRead)
+{
+    pa_sample_spec spec = sampleSpec();
+    size_t consumed = 0;
+    int64_t nowUs = 0;
+    pa_usec_t latencyMicros = 0;
+    bool hasLatency = false;
+
+    mReadyPeriods.clear();
+    {
+        PAMMAutoLock paLoop(mPALoop);
+        if (!mPAStream || !mPeriodPool)
+            return;
+        while (toRead > 0) {
+            const void *data = NULL;
+            size_t readSize = 0;
+            if (pa_stream_peek(mPAStream, &data, &readSize) != 0) {
+                ERROR("read error: %s\n", pa_strerror(pa_context_errno(mPAContext)));
+                break;
+            }
+            if (readSize == 0)
+                break;
+            if (!data)
+                WARNING("there is a hole of %zu bytes, filled with silence\n", readSize);
+
+            size_t offset = 0;
+            while (offset < readSize) {
+                if (!mFill) {
+                    mFill = mPeriodPool->acquire();
+                    mFillBytes = 0;
+                    if (!mFill) {
+                        // downstream holds the whole pool, the pts moves on past the loss as on
+                        // a server overflow
+                        WARNING("no free period, %zu bytes of capture dropped\n", readSize - offset);
+                        break;
+                    }
+                }
+                size_t n = mPeriodBytes - mFillBytes;
+                if (n > readSize - offset)
+                    n = readSize - offset;
+                if (data)
+                    memcpy(mFill + mFillBytes, (const uint8_t*)data + offset, n);
+                else
+                    memset(mFill + mFillBytes, mSilence, n);
+                mFillBytes += n;
+                offset += n;
+                if (mFillBytes == mPeriodBytes) {
+                    ReadyPeriod period = { mFill, consumed + offset };
+                    mReadyPeriods.push_back(period);
+                    mFill = NULL;
+                    mFillBytes = 0;
+                }
+            }
+            pa_stream_drop(mPAStream);
+            consumed += readSize;
+            toRead = toRead > readSize ? toRead - readSize : 0;
+        }
+
+        int negative = 0;
+        hasLatency = pa_stream_get_latency(mPAStream, &latencyMicros, &negative) == 0;
+        if (hasLatency && negative)
+            latencyMicros = 0;
+        nowUs = getTimeUs();
+    }
+    if (mReadyPeriods.empty())
+        return;
+
+    if (hasLatency)
+        mLatencyUs = latencyMicros;
+    // capture time of the sample at the read position
+    int64_t readCaptureUs = nowUs - (int64_t)latencyMicros;
+    std::vector<ReadyPeriod>::iterator it;
+    for (it = mReadyPeriods.begin(); it != mReadyPeriods.end(); ++it) {
+        int64_t captureUs = readCaptureUs - (int64_t)pa_bytes_to_usec((uint64_t)(consumed - it->mEndByte), &spec) - mPeriodUs;
+        if (mCaptureBaseUs < 0) {
+            mCaptureBaseUs = captureUs;
+            mPtsOrigin = mPTS;
+            mBytesSinceOrigin = 0;
+        }
+        int64_t gapUs = captureUs - mCaptureBaseUs - (int64_t)(mPTS - mPtsOrigin);
+        if (hasLatency && gapUs > 2 * mPeriodUs) {
+            WARNING("%" PRId64 " us of capture lost, move the pts on\n", gapUs);
+            mPtsOrigin = mPTS + gapUs;
+            mBytesSinceOrigin = 0;
+            mCaptureBaseUs = captureUs;
+            mPTS = mPtsOrigin;
+        }
+
+        MediaBufferSP mediaBuf = MediaBuffer::createMediaBuffer(MediaBuffer::MBT_RawAudio);
+        uint8_t *buffer = it->mBlock;
+        int32_t size = (int32_t)mPeriodBytes;
+#ifdef DUMP_SRC_PULSE_DATA
+        fwrite(buffer, 1, size, mDumpFile);
+#endif
+        mediaBuf->setBufferInfo((uintptr_t *)&buffer, NULL, &size, 1);
+        mediaBuf->setSize((int64_t)size);
+        mediaBuf->setPts(mPTS);
+        mediaBuf->setDuration(mPeriodUs);
+        // kept in us like the default birth time
+        mediaBuf->setBirthTimeInMs(captureUs);
+        mediaBuf->getMediaMeta()->setPointer(PERIOD_POOL_KEY, new PeriodPoolSP(mPeriodPool));
+        mediaBuf->addReleaseBufferFunc(PeriodPool::releasePeriod);
+
+        // from the sample count since the origin, no rounding accumulates
+        mBytesSinceOrigin += mPeriodBytes;
+        mPTS = mPtsOrigin + pa_bytes_to_usec(mBytesSinceOrigin, &spec);
+
+        MMAutoLock locker(mLock);
+        mAvailableSourceBuffers.push(mediaBuf);
+        mCondition.signal();
+    }
+    mReadyPeriods.clear();
+}
+
 mm_status_t AudioSrcPulse::Private::setVolume(double volume)
 {
     ENTER();
@@ -19,6 +19,7 @@
 #include <unistd.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <sys/stat.h>
 #if (defined(__MM_YUNOS_CNTRHAL_BUILD__) || defined(__MM_YUNOS_YUNHAL_BUILD__) || defined(__MM_YUNOS_LINUX_BSP_BUILD__))
 #ifdef USE_RESMANAGER
 #include <data/ResManager.h>
@@ -109,6 +110,7 @@ static void useProxyFromConnectivity() {}
 namespace YUNOS_MM {
 
 #define MSG_PREPARE (MMMsgThread::msg_type)1
+#define MSG_PREPARE_NEXT (MMMsgThread::msg_type)2
 
 
 #define SET_STATE(_state) do {\
@@ -210,7 +212,7 @@ namespace YUNOS_MM {
         CHECK_TYPE(MT_Int64);\
         _val = item.mValue.ld;\
         INFO("setparam key: %s, val: %" PRId64 "\n", item.mName, item.mValue.ld);\
-        mMetaData->setInt32(_key_name, item.mValue.ld);\
+        mMetaData->setInt64(_key_name, item.mValue.ld);\
         continue;\
     }
 
@@ -264,6 +266,11 @@ static const int64_t MAX_BUFFER_SEEK = 5 * 1000 * 1000; // used for internet str
 
 static const AVRational gTimeBase = {1,1000000};
 
+// trick play shows about 10 key frames per second whatever the rate
+static const int64_t TRICK_FRAME_INTERVAL_US = 100 * 1000;
+// reverse trick play doubles the step back on each seek landing behind, up to this factor
+static const int32_t TRICK_MAX_MISSES = 8;
+
 static const size_t AVIO_BUFFER_SIZE = 128*1024;
 
 static const float PRECISION_DIFF = 0.000001f;
@@ -394,7 +401,9 @@ AVDemuxer::StreamInfo::StreamInfo() : mMediaType(kMediaTypeUnknown),
                         mLastDts(0),
                         mLastPts(0),
                         mTargetTimeUs(SEEK_NONE),
-                        mStartTimeUs(0)
+                        mStartTimeUs(0),
+                        mEndTimeUs(0),
+                        mLastReadTs(SEEK_NONE)
 {
     FUNC_ENTER();
     memset(&mTimeBase, 0, sizeof(AVRational));
@@ -437,6 +446,8 @@ void AVDemuxer::StreamInfo::reset()
     mLastPts = 0;
     mMetaData->clear();
     mStartTimeUs = 0;
+    mEndTimeUs = 0;
+    mLastReadTs = SEEK_NONE;
     FUNC_LEAVE();
 }
 bool AVDemuxer::StreamInfo::shortCircuitSelectTrack(int trackIndex)
@@ -513,6 +524,12 @@ int64_t AVDemuxer::StreamInfo::bufferedTime() const
     return dur;
 }
 
+size_t AVDemuxer::StreamInfo::bufferedCount() const
+{
+    MMAutoLock locker(mLock);
+    return mBufferList[mCurrentIndex].size();
+}
+
 int64_t AVDemuxer::StreamInfo::bufferedFirstTs(bool isPendingList) const
 {
     MMAutoLock locker(mLock);
@@ -647,6 +664,8 @@ mm_status_t AVDemuxer::StreamInfo::read(MediaBufferSP & buffer)
 
     buffer = mBufferList[mCurrentIndex].front();
     mBufferList[mCurrentIndex].pop_front();
+    if (!buffer->isFlagSet(MediaBuffer::MBFT_EOS) && buffer->pts() >= 0)
+        mLastReadTs = buffer->pts();
 
     // set mTargetTimeUs on mBufferList.front(), in case checkBufferSeek() is true
     if ((mTargetTimeUs > 0) && (buffer->pts() < mTargetTimeUs)) {
@@ -893,6 +912,13 @@ AVDemuxer::AVDemuxer() :
                 mScaledPlayRate(SCALED_PLAY_RATE),
                 mScaledThresholdRate(SCALED_PLAY_RATE * 2),
                 mScaledPlayRateCur(SCALED_PLAY_RATE),
+                mTrickMode(false),
+                mTrickEOS(false),
+                mTrickLastUs(SEEK_NONE),
+                mTrickSeekUs(SEEK_NONE),
+                mTrickTargetUs(SEEK_NONE),
+                mTrickStepUs(0),
+                mTrickMisses(0),
                 mInterruptHandler(NULL),
                 mEOF(false),
                 mReportedBufferingPercent(REPORTED_PERCENT_NONE),
@@ -903,7 +929,19 @@ AVDemuxer::AVDemuxer() :
                 mFd(-1),
                 mLength(-1),
                 mOffset(-1),
-                mBufferSeekExtra(0)
+                mMemSource(NULL),
+                mBufferSeekExtra(0),
+                mNextAVFormatContext(NULL),
+                mNextAVIOContext(NULL),
+                mNextMemSource(NULL),
+                mNextGeneration(0),
+                mNextOpening(0),
+                mTimeOffsetUs(0),
+                mSeamlessLoop(0),
+                mLoopCount(0),
+                mProbeSize(-1),
+                mAnalyzeDuration(-1),
+                mProbeCache(0)
 #ifdef DUMP_INPUT
                 , mInputFile(NULL)
 #endif
@@ -950,6 +988,7 @@ AVDemuxer::~AVDemuxer()
         close(mFd);
         mFd = -1;
     }
+    MM_RELEASE(mMemSource);
     FUNC_LEAVE();
 }
 
@@ -1495,6 +1534,7 @@ int AVDemuxer::getSelectedTrack(MediaType mediaType)
 
 BEGIN_MSG_LOOP(AVDemuxer)
     MSG_ITEM(MSG_PREPARE, onPrepare)
+    MSG_ITEM(MSG_PREPARE_NEXT, onPrepareNext)
 END_MSG_LOOP()
 
 
@@ -1502,13 +1542,27 @@ void AVDemuxer::resetInternal()
 {
     EXIT_TMHANDLER(true);
     mReadThread->reset();
+    {
+        MMAutoLock lock(mBufferLock);
+        mNextGeneration++;
+        mNextUri.clear();
+        releaseNextSource_l();
+        mTimeOffsetUs = 0;
+        mLoopCount = 0;
+    }
     releaseContext();
+    releaseRetiredContexts();
+    MM_RELEASE(mMemSource);
 
     mUri = "";
 
     mEOF = false;
     mScaledThresholdRate = SCALED_PLAY_RATE * 2;
     mScaledPlayRate = SCALED_PLAY_RATE;
+    mTrickMode = false;
+    mTrickEOS = false;
+    mTrickSeekUs = SEEK_NONE;
+    mTrickDiscard.clear();
 
     for ( int i = 0; i < kMediaTypeCount; ++i ) {
         mStreamInfoArray[i].reset();
@@ -1602,6 +1656,10 @@ mm_status_t AVDemuxer::setParameter(const MediaMetaSP & meta)
         SETPARAM_I64(PARAM_KEY_BUFFERING_TIME, mBufferingTime)
         SETPARAM_I32(MEDIA_ATTR_PALY_RATE, mScaledPlayRateCur)
         SETPARAM_STRING(MEDIA_ATTR_FILE_DOWNLOAD_PATH, mDownloadPath)
+        SETPARAM_I64(PARAM_KEY_PROBE_SIZE, mProbeSize)
+        SETPARAM_I64(PARAM_KEY_ANALYZE_DURATION, mAnalyzeDuration)
+        SETPARAM_I32(PARAM_KEY_PROBE_CACHE, mProbeCache)
+        SETPARAM_I32(PARAM_KEY_SEAMLESS_LOOP, mSeamlessLoop)
     SETPARAM_END()
     mBufferingTimeHigh = mBufferingTime * BUFFER_HIGH_FACTOR;
 
@@ -1623,6 +1681,18 @@ mm_status_t AVDemuxer::setUri(const char * uri,
     MMLOGI("uri: %s\n", uri);
     MMAutoLock lock(mLock);
     CHECK_STATE(STATE_IDLE);
+    MM_RELEASE(mMemSource);
+    if (MemoryAssetCache::isMemoryUri(uri)) {
+        MemoryAssetSP asset = MemoryAssetCache::find(uri);
+        if (!asset) {
+            MMLOGE("%s: asset released\n", uri);
+            return MM_ERROR_INVALID_URI;
+        }
+        mMemSource = new MemSource(asset);
+        mUri = uri;
+        FUNC_LEAVE();
+        return MM_ERROR_SUCCESS;
+    }
 #if (defined(__MM_YUNOS_CNTRHAL_BUILD__) || defined(__MM_YUNOS_YUNHAL_BUILD__) || defined(__MM_YUNOS_LINUX_BSP_BUILD__))
     if (uri) {
         if (!strncasecmp(uri, "page://", 7)) {
@@ -1665,6 +1735,7 @@ mm_status_t AVDemuxer::setUri(const char * uri,
 
 mm_status_t AVDemuxer::setUri(int fd, int64_t offset, int64_t length)
 {
+    MM_RELEASE(mMemSource);
     mFd = dup(fd);
     mOffset = offset;
     mLength = length;
@@ -1872,42 +1943,272 @@ void AVDemuxer::onPrepare(param1_type param1, param2_type param2, uint32_t rspId
     FUNC_LEAVE();
 }
 
+/*
+ * results of avformat_find_stream_info of recently opened local files, so a repeat open
+ * of the same file can skip it. shared by the demuxers of the process, it lives as long as
+ * the demuxer library is loaded.
+ * the key is the file identity (device, inode, size, mtime), plus offset/length for fd sources
+ */
+class ProbeCache {
+public:
+    struct Stream {
+        AVMediaType mType;
+        AVCodecID mCodecId;
+        uint32_t mCodecTag;
+        int64_t mBitRate;
+        int mProfile;
+        int mLevel;
+        int mBitsPerCodedSample;
+        int mBitsPerRawSample;
+        // video
+        int mWidth;
+        int mHeight;
+        int mPixFmt;
+        int mHasBFrames;
+        AVRational mSampleAspectRatio;
+        AVRational mRFrameRate;
+        AVRational mAvgFrameRate;
+        // audio
+        int mSampleRate;
+        int mChannels;
+        uint64_t mChannelLayout;
+        int mSampleFmt;
+        int mFrameSize;
+        int mBlockAlign;
+
+        int64_t mStartTime;
+        int64_t mDuration;
+        int64_t mNbFrames;
+        std::vector<uint8_t> mExtraData;  // codec specific data
+    };
+    struct Result {
+        std::vector<Stream> mStreams;
+        int64_t mStartTime;
+        int64_t mDuration;
+        int64_t mBitRate;
+    };
+
+    static bool lookup(const std::string & key, Result & result);
+    static void insert(const std::string & key, const Result & result);
+
+private:
+    typedef std::list<std::pair<std::string, Result> > EntryList;
+    static Lock sLock;
+    static EntryList sEntries;  // most recently used first
+    static const size_t kMaxEntries = 32;
+};
+
+Lock ProbeCache::sLock;
+ProbeCache::EntryList ProbeCache::sEntries;
+
+/*static*/ bool ProbeCache::lookup(const std::string & key, Result & result)
+{
+    MMAutoLock lock(sLock);
+    for (EntryList::iterator it = sEntries.begin(); it != sEntries.end(); it++) {
+        if (it->first == key) {
+            sEntries.splice(sEntries.begin(), sEntries, it);
+            result = sEntries.front().second;
+            return true;
+        }
+    }
+    return false;
+}
+
+/*static*/ void ProbeCache::insert(const std::string & key, const Result & result)
+{
+    MMAutoLock lock(sLock);
+    for (EntryList::iterator it = sEntries.begin(); it != sEntries.end(); it++) {
+        if (it->first == key) {
+            sEntries.erase(it);
+            break;
+        }
+    }
+    sEntries.push_front(std::make_pair(key, result));
+    if (sEntries.size() > kMaxEntries)
+        sEntries.pop_back();
+}
+
+// empty for sources without a stable identity (network, no stat)
+std::string AVDemuxer::probeCacheKey()
+{
+    if (!mProbeCache)
+        return std::string();
+
+    if (mMemSource) {
+        char key[64];
+        snprintf(key, sizeof(key), "mem:%" PRIu64 ":%zu", mMemSource->mAsset->id(), mMemSource->mAsset->size());
+        return key;
+    }
+
+    struct stat st;
+    int ret;
+    if (mUri.empty()) {
+        ret = fstat(mFd, &st);
+    } else {
+        const char * path = mUri.c_str();
+        if (!strncasecmp(path, "file://", 7))
+            path += 7;
+        else if (strstr(path, "://"))
+            return std::string();
+        ret = stat(path, &st);
+    }
+    if (ret != 0 || !S_ISREG(st.st_mode))
+        return std::string();
+
+    char key[160];
+    snprintf(key, sizeof(key), "%" PRIu64 ":%" PRIu64 ":%" PRId64 ":%" PRId64 ".%09ld:%" PRId64 ":%" PRId64,
+        (uint64_t)st.st_dev, (uint64_t)st.st_ino, (int64_t)st.st_size,
+        (int64_t)st.st_mtim.tv_sec, st.st_mtim.tv_nsec,
+        mUri.empty() ? mOffset : 0, mUri.empty() ? mLength : 0);
+    return key;
+}
+
+void AVDemuxer::saveProbeResult(const std::string & key)
+{
+    ProbeCache::Result result;
+    result.mStartTime = mAVFormatContext->start_time;
+    result.mDuration = mAVFormatContext->duration;
+    result.mBitRate = mAVFormatContext->bit_rate;
+
+    for (unsigned int i = 0; i < mAVFormatContext->nb_streams; ++i) {
+        AVStream * s = mAVFormatContext->streams[i];
+        AVCodecContext * c = s->codec;
+        ProbeCache::Stream stream;
+        stream.mType = c->codec_type;
+        stream.mCodecId = c->codec_id;
+        stream.mCodecTag = c->codec_tag;
+        stream.mBitRate = c->bit_rate;
+        stream.mProfile = c->profile;
+        stream.mLevel = c->level;
+        stream.mBitsPerCodedSample = c->bits_per_coded_sample;
+        stream.mBitsPerRawSample = c->bits_per_raw_sample;
+        stream.mWidth = c->width;
+        stream.mHeight = c->height;
+        stream.mPixFmt = c->pix_fmt;
+        stream.mHasBFrames = c->has_b_frames;
+        stream.mSampleAspectRatio = c->sample_aspect_ratio;
+        stream.mRFrameRate = s->r_frame_rate;
+        stream.mAvgFrameRate = s->avg_frame_rate;
+        stream.mSampleRate = c->sample_rate;
+        stream.mChannels = c->channels;
+        stream.mChannelLayout = c->channel_layout;
+        stream.mSampleFmt = c->sample_fmt;
+        stream.mFrameSize = c->frame_size;
+        stream.mBlockAlign = c->block_align;
+        stream.mStartTime = s->start_time;
+        stream.mDuration = s->duration;
+        stream.mNbFrames = s->nb_frames;
+        if (c->extradata && c->extradata_size > 0)
+            stream.mExtraData.assign(c->extradata, c->extradata + c->extradata_size);
+        result.mStreams.push_back(stream);
+    }
+
+    ProbeCache::insert(key, result);
+}
+
+// fills what avformat_find_stream_info would find, when the streams found by the header match the cache
+bool AVDemuxer::restoreProbeResult(const std::string & key)
+{
+    ProbeCache::Result result;
+    if (!ProbeCache::lookup(key, result))
+        return false;
+
+    if (result.mStreams.size() != mAVFormatContext->nb_streams) {
+        MMLOGI("probe cache mismatch: %zu streams, header has %u\n", result.mStreams.size(), mAVFormatContext->nb_streams);
+        return false;
+    }
+    for (unsigned int i = 0; i < mAVFormatContext->nb_streams; ++i) {
+        AVCodecContext * c = mAVFormatContext->streams[i]->codec;
+        const ProbeCache::Stream & stream = result.mStreams[i];
+        if ((c->codec_type != AVMEDIA_TYPE_UNKNOWN && c->codec_type != stream.mType) ||
+            (c->codec_id != AV_CODEC_ID_NONE && c->codec_id != stream.mCodecId)) {
+            MMLOGI("probe cache mismatch at stream %d\n", i);
+            return false;
+        }
+    }
+
+    for (unsigned int i = 0; i < mAVFormatContext->nb_streams; ++i) {
+        AVStream * s = mAVFormatContext->streams[i];
+        AVCodecContext * c = s->codec;
+        const ProbeCache::Stream & stream = result.mStreams[i];
+        c->codec_type = stream.mType;
+        c->codec_id = stream.mCodecId;
+        c->codec_tag = stream.mCodecTag;
+        c->bit_rate = stream.mBitRate;
+        c->profile = stream.mProfile;
+        c->level = stream.mLevel;
+        c->bits_per_coded_sample = stream.mBitsPerCodedSample;
+        c->bits_per_raw_sample = stream.mBitsPerRawSample;
+        c->width = stream.mWidth;
+        c->height = stream.mHeight;
+        c->pix_fmt = (AVPixelFormat)stream.mPixFmt;
+        c->has_b_frames = stream.mHasBFrames;
+        c->sample_aspect_ratio = stream.mSampleAspectRatio;
+        s->r_frame_rate = stream.mRFrameRate;
+        s->avg_frame_rate = stream.mAvgFrameRate;
+        c->sample_rate = stream.mSampleRate;
+        c->channels = stream.mChannels;
+        c->channel_layout = stream.mChannelLayout;
+        c->sample_fmt = (AVSampleFormat)stream.mSampleFmt;
+        c->frame_size = stream.mFrameSize;
+        c->block_align = stream.mBlockAlign;
+        s->start_time = stream.mStartTime;
+        s->duration = stream.mDuration;
+        s->nb_frames = stream.mNbFrames;
+
+        // csd from the header is kept, the parsers only extract it from the stream (ts)
+        if (!c->extradata && !stream.mExtraData.empty()) {
+            c->extradata = (uint8_t*)av_mallocz(stream.mExtraData.size() + AV_INPUT_BUFFER_PADDING_SIZE);
+            if (!c->extradata)
+                return false;
+            memcpy(c->extradata, &stream.mExtraData[0], stream.mExtraData.size());
+            c->extradata_size = stream.mExtraData.size();
+        }
+        avcodec_parameters_from_context(s->codecpar, c);
+    }
+
+    mAVFormatContext->start_time = result.mStartTime;
+    mAVFormatContext->duration = result.mDuration;
+    mAVFormatContext->bit_rate = result.mBitRate;
+    return true;
+}
+
 mm_status_t AVDemuxer::createContext()
 {
     FUNC_ENTER();
     MMASSERT(mAVFormatContext == NULL);
     MMASSERT(mAVIOContext == NULL);
 
-    if (mUri.empty()) {
-        MMLOGD("mUri is NULL\n");
+    if (usesCustomIO()) {
+        MMLOGD("custom io, %s\n", mMemSource ? "memory" : "fd");
         mAVFormatContext = avformat_alloc_context();
         if ( !mAVFormatContext ) {
             MMLOGE("failed to create avcontext\n");
             return MM_ERROR_INVALID_PARAM;
         }
 
-        unsigned char * ioBuf = (unsigned char*)av_malloc(AVIO_BUFFER_SIZE);
-        if ( !ioBuf ) {
-            MMLOGE("no mem\n");
-            avformat_free_context(mAVFormatContext);
-            mAVFormatContext = NULL;
-            return MM_ERROR_NO_MEM;
+        if (mMemSource) {
+            mMemSource->mPos = 0;
+            mAVIOContext = createMemIOContext(mMemSource);
+        } else {
+            unsigned char * ioBuf = (unsigned char*)av_malloc(AVIO_BUFFER_SIZE);
+            if ( ioBuf ) {
+                mAVIOContext = avio_alloc_context(ioBuf,
+                                AVIO_BUFFER_SIZE,
+                                0,
+                                this,
+                                avRead,
+                                NULL,
+                                avSeek);
+                if ( !mAVIOContext )
+                    av_free(ioBuf);
+            }
         }
 
-        mAVIOContext = avio_alloc_context(ioBuf,
-                        AVIO_BUFFER_SIZE,
-                        0,
-                        this,
-                        avRead,
-                        NULL,
-                        avSeek);
-
         if ( !mAVIOContext ) {
             MMLOGE("no mem\n");
             avformat_free_context(mAVFormatContext);
             mAVFormatContext = NULL;
-            av_free(ioBuf);
-            ioBuf = NULL;
             return MM_ERROR_NO_MEM;
         }
 
@@ -1925,10 +2226,14 @@ mm_status_t AVDemuxer::createContext()
     mAVFormatContext->interrupt_callback = *mInterruptHandler;
 
     mInterruptHandler->start(mPrepareTimeout);
-    const char *path = mUri.empty() ? NULL :  mUri.c_str();
+    const char *path = usesCustomIO() ? NULL :  mUri.c_str();
     DEBUG("url: %s", PRINTABLE_STR(path));
 
-    AVDictionary *options = NULL; //not used for now
+    AVDictionary *options = NULL;
+    if (mProbeSize > 0)
+        av_dict_set_int(&options, "probesize", mProbeSize, 0);
+    if (mAnalyzeDuration > 0)
+        av_dict_set_int(&options, "analyzeduration", mAnalyzeDuration, 0);
     if (path && (!strncasecmp(path, "http://", 7) ||!strncasecmp(path, "https://", 8))) {
         useProxyFromConnectivity();
         // set network read/write timeout, refer to libavformat/tcp.c for detail info
@@ -1955,17 +2260,29 @@ mm_status_t AVDemuxer::createContext()
         DEBUG("av input format name %s", mAVFormatContext->iformat->name);
 
     mAVFormatContext->flags |= AVFMT_FLAG_GENPTS;
-    if (mUri.empty()) {
+    if (usesCustomIO()) {
         mAVFormatContext->flags |= AVFMT_FLAG_CUSTOM_IO;
     }
 
+    std::string probeKey = probeCacheKey();
+    if (!probeKey.empty() && restoreProbeResult(probeKey)) {
+        mInterruptHandler->end();
+        MMLOGI("stream info from probe cache, %u streams\n", mAVFormatContext->nb_streams);
+        return MM_ERROR_SUCCESS;
+    }
+
     MMLOGV("finding stream info\n");
+    int64_t startUs = ElapsedTimer::getUs();
     ret = avformat_find_stream_info(mAVFormatContext, NULL);
     mInterruptHandler->end();
     if ( ret < 0 ) {
         MMLOGE("failed to find stream info: %d\n", ret);
         return ret;
     }
+    MMLOGI("find stream info costs %" PRId64 " us\n", ElapsedTimer::getUs() - startUs);
+
+    if (!probeKey.empty())
+        saveProbeResult(probeKey);
 
     return MM_ERROR_SUCCESS;
 }
@@ -1973,7 +2290,7 @@ mm_status_t AVDemuxer::createContext()
 void AVDemuxer::releaseContext()
 {
     FUNC_ENTER();
-    if (mUri.empty()) {
+    if (usesCustomIO()) {
         if ( mAVFormatContext ) {
             mAVFormatContext->interrupt_callback = {.callback = NULL, .opaque = NULL};
             mAVFormatContext->pb = NULL;
@@ -1999,6 +2316,345 @@ void AVDemuxer::releaseContext()
 }
 
 
+int AVDemuxer::nextSourceInterrupt(void * opaque)
+{
+    AVDemuxer * demuxer = static_cast<AVDemuxer*>(opaque);
+    return demuxer->mNextOpening != demuxer->mNextGeneration;
+}
+
+mm_status_t AVDemuxer::setNextUri(const char * uri,
+                            const std::map<std::string, std::string> * headers/* = NULL*/)
+{
+    MMLOGI("next uri: %s\n", PRINTABLE_STR(uri));
+    MMAutoLock lock(mLock);
+    if (uri && mState != STATE_PREPARED && mState != STATE_STARTED) {
+        MMLOGE("invalid state: %d\n", mState);
+        return MM_ERROR_INVALID_STATE;
+    }
+
+    MMAutoLock lock2(mBufferLock);
+    mNextGeneration++;
+    releaseNextSource_l();
+    mNextUri = uri ? uri : "";
+    if (mNextUri.empty()) {
+        if (mEOF) {
+            mEOF = false;
+            mReadThread->read();
+        }
+        return MM_ERROR_SUCCESS;
+    }
+
+    if ( postMsg(MSG_PREPARE_NEXT, mNextGeneration, 0, 0) ) {
+        MMLOGE("failed to post\n");
+        mNextUri.clear();
+        return MM_ERROR_NO_MEM;
+    }
+    return MM_ERROR_SUCCESS;
+}
+
+// opens and probes the next source while the current one is playing,
+// the packets read by avformat_find_stream_info stay queued in the context
+void AVDemuxer::onPrepareNext(param1_type param1, param2_type param2, uint32_t rspId)
+{
+    MMASSERT(rspId == 0);
+    AVFormatContext * context = NULL;
+    std::string uri;
+    {
+        MMAutoLock lock(mBufferLock);
+        if ((int32_t)param1 != mNextGeneration) {
+            MMLOGI("next source %d canceled\n", (int32_t)param1);
+            return;
+        }
+        uri = mNextUri;
+        mNextOpening = mNextGeneration;
+    }
+
+    // a "mem://" uri is read through MemSource as in createContext()
+    AVIOContext * ioContext = NULL;
+    MemSource * memSource = NULL;
+    int64_t startUs = ElapsedTimer::getUs();
+    do {
+        if (MemoryAssetCache::isMemoryUri(uri.c_str())) {
+            MemoryAssetSP asset = MemoryAssetCache::find(uri.c_str());
+            if (!asset) {
+                MMLOGW("next source %s: asset released\n", uri.c_str());
+                break;
+            }
+            memSource = new MemSource(asset);
+            ioContext = createMemIOContext(memSource);
+            if (!ioContext) {
+                MMLOGE("no mem\n");
+                break;
+            }
+        }
+
+        context = avformat_alloc_context();
+        if (!context) {
+            MMLOGE("failed to create avcontext\n");
+            break;
+        }
+        context->interrupt_callback.callback = nextSourceInterrupt;
+        context->interrupt_callback.opaque = this;
+        context->pb = ioContext;
+
+        int ret = avformat_open_input(&context, ioContext ? NULL : uri.c_str(), NULL, NULL);
+        if ( ret < 0 ) {
+            MMLOGW("failed to open next source %s: %d(%s)\n", uri.c_str(), ret, strerror(-ret));
+            context = NULL; // freed by avformat_open_input, the custom io is not
+            break;
+        }
+        context->flags |= AVFMT_FLAG_GENPTS;
+        if (ioContext)
+            context->flags |= AVFMT_FLAG_CUSTOM_IO;
+        ret = avformat_find_stream_info(context, NULL);
+        context->interrupt_callback.callback = NULL;
+        context->interrupt_callback.opaque = NULL;
+        if ( ret < 0 ) {
+            MMLOGW("failed to find stream info of next source: %d\n", ret);
+            closeFormatContext(context, ioContext);
+            context = NULL;
+            break;
+        }
+        for (uint32_t i = 0; i < context->nb_streams; i++)
+            context->streams[i]->discard = AVDISCARD_ALL;
+    } while (0);
+
+    if (!context) {
+        freeIOContext(ioContext);
+        ioContext = NULL;
+        MM_RELEASE(memSource);
+    }
+
+    MMAutoLock lock(mBufferLock);
+    if ((int32_t)param1 != mNextGeneration) {
+        MMLOGI("next source %d canceled\n", (int32_t)param1);
+        if (context) {
+            closeFormatContext(context, ioContext);
+            freeIOContext(ioContext);
+            MM_RELEASE(memSource);
+        }
+        return;
+    }
+
+    if (context) {
+        mNextAVFormatContext = context;
+        mNextAVIOContext = ioContext;
+        mNextMemSource = memSource;
+        MMLOGI("next source %s ready, costs %" PRId64 " us\n", uri.c_str(), ElapsedTimer::getUs() - startUs);
+    } else {
+        // give up, the current source ends with EOS
+        mNextUri.clear();
+    }
+
+    if (mEOF) {
+        mEOF = false;
+        mReadThread->read();
+    }
+}
+
+/*
+ * the decoders are kept for the next source, so it must have the same audio/video streams
+ * with the same codec configuration as the selected ones of the current source
+ */
+bool AVDemuxer::isNextSourceCompatible_l(int * nextStreams)
+{
+    for (int i = 0; i < kMediaTypeCount; ++i) {
+        nextStreams[i] = -1;
+        StreamInfo * si = &mStreamInfoArray[i];
+        bool selected = si->mMediaType != kMediaTypeUnknown && si->mPeerInstalled;
+        if (i == kMediaTypeSubtitle && selected)
+            return false;
+        if (!selected || (i != kMediaTypeAudio && i != kMediaTypeVideo))
+            continue;
+        if (si->mSelectedStreamPending != WANT_TRACK_NONE)
+            return false;
+
+        int index = av_find_best_stream(mNextAVFormatContext,
+            i == kMediaTypeAudio ? AVMEDIA_TYPE_AUDIO : AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
+        if (index >= 0 && (mNextAVFormatContext->streams[index]->disposition & AV_DISPOSITION_ATTACHED_PIC))
+            index = -1;
+        if (index < 0) {
+            MMLOGI("media %d: not found in the next source\n", i);
+            return false;
+        }
+
+        AVCodecContext * cur = mAVFormatContext->streams[si->mSelectedStream]->codec;
+        AVCodecContext * next = mNextAVFormatContext->streams[index]->codec;
+        if (cur->codec_id != next->codec_id ||
+            cur->extradata_size != next->extradata_size ||
+            (cur->extradata_size > 0 && memcmp(cur->extradata, next->extradata, cur->extradata_size))) {
+            MMLOGI("media %d: codec changed, 0x%x -> 0x%x\n", i, cur->codec_id, next->codec_id);
+            return false;
+        }
+        if (i == kMediaTypeAudio &&
+            (cur->sample_rate != next->sample_rate || cur->channels != next->channels)) {
+            MMLOGI("audio format changed: %d/%d -> %d/%d\n",
+                cur->sample_rate, cur->channels, next->sample_rate, next->channels);
+            return false;
+        }
+        if (i == kMediaTypeVideo && (cur->width != next->width || cur->height != next->height)) {
+            MMLOGI("video size changed: %dx%d -> %dx%d\n", cur->width, cur->height, next->width, next->height);
+            return false;
+        }
+        nextStreams[i] = index;
+    }
+    return nextStreams[kMediaTypeAudio] >= 0 || nextStreams[kMediaTypeVideo] >= 0;
+}
+
+// called with mBufferLock held when the current source reaches the end
+bool AVDemuxer::switchToNextSource_l()
+{
+    if (!mNextAVFormatContext)
+        return false;
+
+    int nextStreams[kMediaTypeCount];
+    if (!isNextSourceCompatible_l(nextStreams)) {
+        MMLOGI("next source %s can't be joined\n", mNextUri.c_str());
+        releaseNextSource_l();
+        return false;
+    }
+
+    // join where the audio ends, the timeline stays sample accurate for the audio sink clock
+    int64_t joinUs = mStreamInfoArray[kMediaTypeVideo].mEndTimeUs;
+    if (nextStreams[kMediaTypeAudio] >= 0)
+        joinUs = mStreamInfoArray[kMediaTypeAudio].mEndTimeUs;
+
+    RetiredContext retired = { mAVFormatContext, mAVIOContext, mMemSource };
+    mRetiredContexts.push_back(retired);
+    mAVFormatContext = mNextAVFormatContext;
+    mAVIOContext = mNextAVIOContext;
+    mMemSource = mNextMemSource;
+    mNextAVFormatContext = NULL;
+    mNextAVIOContext = NULL;
+    mNextMemSource = NULL;
+    mAVInputFormat = mAVFormatContext->iformat;
+    mUri = mNextUri;
+    mNextUri.clear();
+    mTimeOffsetUs = joinUs;
+    mEOF = false;
+
+    mStreamIdx2Info.clear();
+    for (int i = 0; i < kMediaTypeCount; ++i) {
+        if (nextStreams[i] < 0)
+            continue;
+        StreamInfo * si = &mStreamInfoArray[i];
+        AVStream * stream = mAVFormatContext->streams[nextStreams[i]];
+        stream->discard = AVDISCARD_DEFAULT;
+        si->mSelectedStream = nextStreams[i];
+        si->mAllStreams.clear();
+        si->mAllStreams.push_back(nextStreams[i]);
+        memcpy(&si->mTimeBase, &stream->time_base, sizeof(AVRational));
+        si->mLastDts = 0;
+        si->mLastPts = 0;
+        mStreamIdx2Info.insert(std::pair<int, StreamInfo*>(nextStreams[i], si));
+    }
+
+    int64_t durationMs = durationUs() / 1000;
+    mMetaData->setInt64(MEDIA_ATTR_DURATION, durationMs);
+    MMLOGI("switched to next source %s at %" PRId64 " us, duration %" PRId64 " ms\n",
+        mUri.c_str(), joinUs, durationMs);
+
+    MMParamSP param(new MMParam);
+    param->writeInt64(durationMs);
+    NOTIFY(kEventInfo, kEventInfoNextSourceStarted, int(joinUs / 1000), param);
+    return true;
+}
+
+/*
+ * seamless loop: like a joined source, but the same context is rewound. the timeline goes on
+ * from where the audio ends, nothing is flushed downstream.
+ * called with mBufferLock held at the end of the source
+ */
+bool AVDemuxer::loopToStart_l(MMAutoLock & lock)
+{
+    if (!mSeamlessLoop || mTrickMode || !isSeekableInternal())
+        return false;
+
+    int64_t joinUs = mStreamInfoArray[kMediaTypeVideo].mEndTimeUs;
+    if (mStreamInfoArray[kMediaTypeAudio].mMediaType != kMediaTypeUnknown &&
+        mStreamInfoArray[kMediaTypeAudio].mPeerInstalled)
+        joinUs = mStreamInfoArray[kMediaTypeAudio].mEndTimeUs;
+    if (joinUs <= mTimeOffsetUs) {
+        // nothing was read in this pass, don't spin on an empty source
+        MMLOGW("loop: empty pass, end\n");
+        return false;
+    }
+
+    int64_t beginUs = ElapsedTimer::getUs();
+    mInterruptHandler->start(mSeekTimeout);
+    lock.unlock();
+    int ret = av_seek_frame(mAVFormatContext, -1, startTimeUs(), AVSEEK_FLAG_BACKWARD);
+    if (ret < 0) {
+        // some demuxers only seek by bytes
+        ret = av_seek_frame(mAVFormatContext, -1, 0, AVSEEK_FLAG_BYTE);
+    }
+    lock.lock();
+    mInterruptHandler->end();
+    if (ret < 0) {
+        MMLOGW("loop: rewind failed: %d\n", ret);
+        return false;
+    }
+
+    mTimeOffsetUs = joinUs;
+    mLoopCount++;
+    mEOF = false;
+    for (int i = 0; i < kMediaTypeCount; ++i) {
+        StreamInfo * si = &mStreamInfoArray[i];
+        si->mLastDts = 0;
+        si->mLastPts = 0;
+    }
+
+    MMLOGI("loop %d at %" PRId64 " us, rewind costs %" PRId64 " us\n",
+        mLoopCount, joinUs, ElapsedTimer::getUs() - beginUs);
+    MMParamSP param(new MMParam);
+    param->writeInt32(mLoopCount);
+    NOTIFY(kEventInfo, kEventInfoLoopStarted, int(joinUs / 1000), param);
+    return true;
+}
+
+// a context opened on a custom io leaves the io to the caller
+/*static */void AVDemuxer::closeFormatContext(AVFormatContext * context, AVIOContext * ioContext)
+{
+    context->interrupt_callback = {.callback = NULL, .opaque = NULL};
+    if (ioContext) {
+        context->pb = NULL;
+        avformat_free_context(context);
+    } else {
+        avformat_close_input(&context);
+    }
+}
+
+/*static */void AVDemuxer::freeIOContext(AVIOContext * ioContext)
+{
+    if (ioContext) {
+        av_free(ioContext->buffer);
+        av_free(ioContext);
+    }
+}
+
+void AVDemuxer::releaseNextSource_l()
+{
+    if (mNextAVFormatContext) {
+        closeFormatContext(mNextAVFormatContext, mNextAVIOContext);
+        mNextAVFormatContext = NULL;
+    }
+    freeIOContext(mNextAVIOContext);
+    mNextAVIOContext = NULL;
+    MM_RELEASE(mNextMemSource);
+}
+
+void AVDemuxer::releaseRetiredContexts()
+{
+    while (!mRetiredContexts.empty()) {
+        RetiredContext & retired = mRetiredContexts.front();
+        closeFormatContext(retired.mFormatContext, retired.mIOContext);
+        freeIOContext(retired.mIOContext);
+        MM_RELEASE(retired.mMemSource);
+        mRetiredContexts.pop_front();
+    }
+}
+
+
 mm_status_t AVDemuxer::start()
 {
     FUNC_ENTER();
@@ -2243,7 +2899,13 @@ void AVDemuxer::checkSeek()
     }
 
     do { // make it easier to break to the end of func
-        if ( checkBufferSeek(seekUs) ) {
+        if ( mTrickMode ) {
+            // trick play goes on from the seek target, trickSeek_l() does the seek
+            flushInternal();
+            startTrickPlay_l(seekUs);
+            break;
+        }
+        if ( checkBufferSeek(seekUs + mTimeOffsetUs) ) {
             DEBUG("checkBufferSeek is ok: %" PRId64, seekUs);
             break;
         }
@@ -2271,7 +2933,9 @@ void AVDemuxer::checkSeek()
             NOTIFY(kEventSeekComplete, status, 0, mmparam);
     }
 
-    setTargetTimeUs(seekUs);
+    // trick play hands key frames on either side of the target, none is to be dropped
+    if ( !mTrickMode )
+        setTargetTimeUs(seekUs + mTimeOffsetUs);
     SET_BUFFERING_STATE(kBufferStateBuffering);
 }
 
@@ -2341,6 +3005,7 @@ mm_status_t AVDemuxer::flushInternal()
         //reset last pts when seeking
         si->mLastDts = (int64_t)AV_NOPTS_VALUE;
         si->mLastPts = (int64_t)AV_NOPTS_VALUE;
+        si->mEndTimeUs = 0;
     }
 
     mCheckVideoKeyFrame = hasMediaInternal(kMediaTypeVideo);
@@ -2362,15 +3027,6 @@ bool AVDemuxer::checkPacketWritable(StreamInfo * si, AVPacket * packet) {
         return false;
     }
 
-    if (mScaledPlayRateCur != mScaledPlayRate) {
-        if (mScaledPlayRate > mScaledThresholdRate && mScaledPlayRateCur <= mScaledThresholdRate) {
-            mCheckVideoKeyFrame = true;
-            MMLOGI("playrate change %d->%d, need to check video key frame\n", mScaledPlayRate, mScaledPlayRateCur);
-        }
-
-        mScaledPlayRate = mScaledPlayRateCur;
-    }
-
     if ( (mScaledPlayRate != SCALED_PLAY_RATE) && (si->mMediaType == kMediaTypeAudio)) {
         MMLOGV("mediatype %d, mScaledPlayRate %d\n",
             si->mMediaType, mScaledPlayRate);
@@ -2383,7 +3039,10 @@ bool AVDemuxer::checkPacketWritable(StreamInfo * si, AVPacket * packet) {
     if ((si->mMediaType == kMediaTypeVideo) && (packet->flags & AV_PKT_FLAG_KEY))
         MMLOGV("key frame\n");
 
-    if (mScaledPlayRate > mScaledThresholdRate) {
+    if (mTrickMode)
+        return checkTrickPacket(si, packet);
+
+    if (isTrickRate(mScaledPlayRate)) {
         if (!(packet->flags & AV_PKT_FLAG_KEY)) {
             MMLOGV("playRate: %d, skip B or P frame\n", mScaledPlayRate);
             return false;
@@ -2393,6 +3052,196 @@ bool AVDemuxer::checkPacketWritable(StreamInfo * si, AVPacket * packet) {
     return true;
 }
 
+bool AVDemuxer::isTrickRate(int32_t rate) const
+{
+    return rate < 0 || rate > mScaledThresholdRate;
+}
+
+void AVDemuxer::updatePlayRate_l()
+{
+    if (mScaledPlayRateCur == mScaledPlayRate)
+        return;
+
+    int32_t oldRate = mScaledPlayRate;
+    mScaledPlayRate = mScaledPlayRateCur;
+    bool wasTrick = isTrickRate(oldRate);
+    bool trick = isTrickRate(mScaledPlayRate);
+    MMLOGI("playrate change %d->%d, trick play %d->%d\n", oldRate, mScaledPlayRate, wasTrick, trick);
+
+    if (wasTrick && !trick) {
+        stopTrickPlay_l();
+        mCheckVideoKeyFrame = true;
+        MMLOGI("need to check video key frame\n");
+        return;
+    }
+    if (!trick)
+        return;
+
+    mTrickStepUs = (int64_t)abs(mScaledPlayRate) * TRICK_FRAME_INTERVAL_US / SCALED_PLAY_RATE;
+    if (!mTrickMode || (oldRate < 0) != (mScaledPlayRate < 0))
+        startTrickPlay_l(SEEK_NONE);
+}
+
+/* the read ahead is dropped and reading goes on from fromUs (file time), or from the last video
+ * frame handed downstream for SEEK_NONE; only the key frames of the video stream are demuxed
+ * from now on.
+ * live streams can't seek, they keep reading everything and drop all but the key frames.
+ */
+void AVDemuxer::startTrickPlay_l(int64_t fromUs)
+{
+    StreamInfo * si = &mStreamInfoArray[kMediaTypeVideo];
+    if (si->mMediaType == kMediaTypeUnknown || si->mSelectedStream < 0 || !isSeekableInternal()) {
+        MMLOGI("no trick play, video: %d, seekable: %d\n", si->mMediaType != kMediaTypeUnknown, isSeekableInternal());
+        return;
+    }
+
+    if (fromUs == SEEK_NONE) {
+        MMAutoLock locker(si->mLock);
+        if (si->mLastReadTs != SEEK_NONE)
+            fromUs = si->mLastReadTs - mTimeOffsetUs + startTimeUs();
+        else
+            fromUs = si->mLastPts;
+    }
+    if (fromUs == (int64_t)AV_NOPTS_VALUE)
+        fromUs = startTimeUs();
+
+    for ( int i = 0; i < kMediaTypeCount; ++i ) {
+        StreamInfo * s = &mStreamInfoArray[i];
+        if ( s->mMediaType == kMediaTypeUnknown || s->mMediaType == kMediaTypeSubtitle )
+            continue;
+        s->mBufferList[0].clear();
+        s->mBufferList[1].clear();
+    }
+
+    if (!mTrickMode) {
+        mTrickDiscard.resize(mAVFormatContext->nb_streams);
+        for (unsigned int i = 0; i < mAVFormatContext->nb_streams; i++) {
+            AVStream * stream = mAVFormatContext->streams[i];
+            mTrickDiscard[i] = stream->discard;
+            stream->discard = (int)i == si->mSelectedStream ? AVDISCARD_NONKEY : AVDISCARD_ALL;
+        }
+    }
+
+    mTrickMode = true;
+    mTrickEOS = false;
+    mTrickLastUs = fromUs;
+    mTrickSeekUs = fromUs;
+    mTrickMisses = 0;
+    mCheckVideoKeyFrame = false;
+    MMLOGI("trick play from %" PRId64 ", step %" PRId64 "\n", fromUs, mTrickStepUs);
+}
+
+void AVDemuxer::stopTrickPlay_l()
+{
+    if (!mTrickMode)
+        return;
+
+    for (unsigned int i = 0; i < mAVFormatContext->nb_streams && i < mTrickDiscard.size(); i++)
+        mAVFormatContext->streams[i]->discard = (AVDiscard)mTrickDiscard[i];
+    mTrickDiscard.clear();
+    mTrickMode = false;
+    mTrickEOS = false;
+    mTrickSeekUs = SEEK_NONE;
+    MMLOGI("trick play done at %" PRId64 "\n", mTrickLastUs);
+}
+
+/* forward: the first key frame after the last one, then a seek one step further.
+ * reverse: the key frame a seek back lands on must be before the last one, otherwise
+ * the seek goes back further; reaching the start of the file is the end of stream.
+ */
+bool AVDemuxer::checkTrickPacket(StreamInfo * si, AVPacket * packet)
+{
+    if (si->mMediaType != kMediaTypeVideo || !(packet->flags & AV_PKT_FLAG_KEY))
+        return false;
+
+    int64_t ts = packet->pts != (int64_t)AV_NOPTS_VALUE ? packet->pts : packet->dts;
+    if (ts == (int64_t)AV_NOPTS_VALUE)
+        return false;
+    ts = av_rescale_q(ts, si->mTimeBase, gTimeBase);
+
+    if (mScaledPlayRate > 0) {
+        if (ts <= mTrickLastUs)
+            return false;
+        mTrickLastUs = ts;
+        mTrickSeekUs = ts + mTrickStepUs;
+        return true;
+    }
+
+    if (ts >= mTrickLastUs) {
+        int64_t start = startTimeUs();
+        if (mTrickTargetUs <= start) {
+            MMLOGI("reverse trick play reaches the start\n");
+            mTrickEOS = true;
+            return false;
+        }
+        if (mTrickMisses < TRICK_MAX_MISSES)
+            mTrickMisses++;
+        mTrickSeekUs = mTrickLastUs - (mTrickStepUs << mTrickMisses);
+        MMLOGV("key frame %" PRId64 " not before %" PRId64 ", seek back to %" PRId64 "\n", ts, mTrickLastUs, mTrickSeekUs);
+        return false;
+    }
+
+    mTrickMisses = 0;
+    mTrickLastUs = ts;
+    mTrickSeekUs = ts - mTrickStepUs;
+    return true;
+}
+
+mm_status_t AVDemuxer::trickSeek_l(MMAutoLock & lock)
+{
+    if (mTrickEOS) {
+        SET_BUFFERING_STATE(kBufferStateEOS);
+        return writeEOS_l();
+    }
+    if (mTrickSeekUs == SEEK_NONE)
+        return MM_ERROR_SUCCESS;
+
+    StreamInfo * si = &mStreamInfoArray[kMediaTypeVideo];
+    int64_t start = startTimeUs();
+    int64_t target = mTrickSeekUs < start ? start : mTrickSeekUs;
+    mTrickSeekUs = SEEK_NONE;
+    mTrickTargetUs = target;
+
+    mInterruptHandler->start(mSeekTimeout);
+    lock.unlock();
+    int ret = av_seek_frame(mAVFormatContext, si->mSelectedStream,
+                            av_rescale_q(target, gTimeBase, si->mTimeBase), AVSEEK_FLAG_BACKWARD);
+    lock.lock();
+    mInterruptHandler->end();
+    if (ret < 0) {
+        MMLOGW("trick seek to %" PRId64 " failed: %d\n", target, ret);
+        if (mScaledPlayRate < 0) {
+            // reading on would go forward
+            SET_BUFFERING_STATE(kBufferStateEOS);
+            return writeEOS_l();
+        }
+    }
+
+    return MM_ERROR_SUCCESS;
+}
+
+mm_status_t AVDemuxer::writeEOS_l()
+{
+    for ( int i = 0; i < kMediaTypeCount; ++i ) {
+        StreamInfo * s = &mStreamInfoArray[i];
+        if ( s->mMediaType == kMediaTypeUnknown )
+            continue;
+
+        MediaBufferSP buf = MediaBuffer::createMediaBuffer(MediaBuffer::MBT_ByteBuffer);
+        if ( !buf ) {
+            MMLOGE("failed to createMediaBuffer\n");
+            NOTIFY_ERROR(MM_ERROR_NO_MEM);
+            return MM_ERROR_NO_MEM;
+        }
+        MMLOGI("write eos to media: %d\n", i);
+        buf->setFlag(MediaBuffer::MBFT_EOS);
+        buf->setSize(0);
+        s->write(buf, s->mSelectedStream);
+    }
+
+    return MM_ERROR_NO_MORE;
+}
+
 
 int AVDemuxer::avRead(uint8_t *buf, int buf_size)
 {
@@ -2448,6 +3297,68 @@ int AVDemuxer::avRead(uint8_t *buf, int buf_size)
     return me->avSeek(offset, whence);
 }
 
+/* memory sources: avio copies from the asset straight into its buffer, the asset itself is never
+ * duplicated; AVSEEK_SIZE lets the demuxers seek (mp4 moov at the end etc) as in a file
+ */
+/*static */int AVDemuxer::avMemRead(void *opaque, uint8_t *buf, int buf_size)
+{
+    MemSource * source = static_cast<MemSource*>(opaque);
+    int64_t size = source->mAsset->size();
+    if (source->mPos >= size)
+        return AVERROR_EOF;
+
+    int64_t len = size - source->mPos < buf_size ? size - source->mPos : buf_size;
+    memcpy(buf, source->mAsset->data() + source->mPos, len);
+    source->mPos += len;
+    return (int)len;
+}
+
+// the avio context of a memory source, NULL if no mem
+/*static */AVIOContext * AVDemuxer::createMemIOContext(MemSource * source)
+{
+    unsigned char * ioBuf = (unsigned char*)av_malloc(AVIO_BUFFER_SIZE);
+    if ( !ioBuf )
+        return NULL;
+
+    AVIOContext * ioContext = avio_alloc_context(ioBuf,
+                            AVIO_BUFFER_SIZE,
+                            0,
+                            source,
+                            avMemRead,
+                            NULL,
+                            avMemSeek);
+    if ( !ioContext )
+        av_free(ioBuf);
+    return ioContext;
+}
+
+/*static */int64_t AVDemuxer::avMemSeek(void *opaque, int64_t offset, int whence)
+{
+    MemSource * source = static_cast<MemSource*>(opaque);
+    int64_t size = source->mAsset->size();
+    int64_t pos;
+
+    switch (whence & ~AVSEEK_FORCE) {
+    case AVSEEK_SIZE:
+        return size;
+    case SEEK_SET:
+        pos = offset;
+        break;
+    case SEEK_CUR:
+        pos = source->mPos + offset;
+        break;
+    case SEEK_END:
+        pos = size + offset;
+        break;
+    default:
+        return -1;
+    }
+    if (pos < 0 || pos > size)
+        return -1;
+    source->mPos = pos;
+    return pos;
+}
+
 int64_t AVDemuxer::avSeek(int64_t offset, int whence)
 {
     //MMAutoLock lock(mFileMutex);
@@ -2477,6 +3388,13 @@ mm_status_t AVDemuxer::readFrame()
         return MM_ERROR_NO_MORE;
     }
 
+    updatePlayRate_l();
+    if (mTrickMode) {
+        mm_status_t status = trickSeek_l(lock);
+        if (status != MM_ERROR_SUCCESS)
+            return status;
+    }
+
     AVPacket * packet = NULL;
     do {
         packet = (AVPacket*)malloc(sizeof(AVPacket));
@@ -2508,27 +3426,22 @@ mm_status_t AVDemuxer::readFrame()
                     MMLOGI("EOS, buffering, send 100 percent\n");
                     NOTIFY(kEventInfoBufferingUpdate, 100, 0, nilParam);
                 }
+                if (switchToNextSource_l()) {
+                    return MM_ERROR_SUCCESS;
+                }
+                if (!mNextUri.empty()) {
+                    // onPrepareNext() wakes up the read thread when the next source is opened
+                    MMLOGI("eof, waiting for the next source\n");
+                    mEOF = true;
+                    return MM_ERROR_AGAIN;
+                }
+                if (loopToStart_l(lock)) {
+                    return MM_ERROR_SUCCESS;
+                }
                 SET_BUFFERING_STATE(kBufferStateEOS);
                 // eos event of DataSource is not needed
                 //NOTIFY(kEventEOS, 0, 0, nilParam);
-                for ( int i = 0; i < kMediaTypeCount; ++i ) {
-                    StreamInfo * s = &mStreamInfoArray[i];
-                    if ( s->mMediaType == kMediaTypeUnknown )
-                        continue;
-
-                    MediaBufferSP buf = MediaBuffer::createMediaBuffer(MediaBuffer::MBT_ByteBuffer);
-                    if ( !buf ) {
-                        MMLOGE("failed to createMediaBuffer\n");
-                        NOTIFY_ERROR(MM_ERROR_NO_MEM);
-                        return MM_ERROR_NO_MEM;
-                    }
-                    MMLOGI("write eos to media: %d\n", i);
-                    buf->setFlag(MediaBuffer::MBFT_EOS);
-                    buf->setSize(0);
-                    s->write(buf, s->mSelectedStream);
-                }
-
-                return MM_ERROR_NO_MORE;
+                return writeEOS_l();
             }
 
             if ( mInterruptHandler->isTimeout() ) {
@@ -2590,7 +3503,7 @@ mm_status_t AVDemuxer::readFrame()
         if (packet->pts != (int64_t)AV_NOPTS_VALUE){
             av_packet_rescale_ts(packet, si->mTimeBase, gTimeBase);
 
-            if (si->mLastDts != AV_NOPTS_VALUE && si->mLastPts != AV_NOPTS_VALUE) {
+            if (!mTrickMode && si->mLastDts != AV_NOPTS_VALUE && si->mLastPts != AV_NOPTS_VALUE) {
                 dtsDiff = packet->dts - si->mLastDts;
                 ptsDiff = packet->pts - si->mLastPts;
                 if ( MM_UNLIKELY(dtsDiff  > 1000000 || ptsDiff > 1000000  || dtsDiff <-1000000 || ptsDiff <-1000000) ) {
@@ -2615,6 +3528,21 @@ mm_status_t AVDemuxer::readFrame()
             packet->pts -= startTime;
         }
 
+        if (packet->dts != (int64_t)AV_NOPTS_VALUE)
+            packet->dts += mTimeOffsetUs;
+        if (packet->pts != (int64_t)AV_NOPTS_VALUE) {
+            packet->pts += mTimeOffsetUs;
+            // packets come in decode order, with b-frames the last one read doesn't end the stream
+            int64_t endUs = packet->pts + (packet->duration > 0 ? packet->duration : 0);
+            if (endUs > si->mEndTimeUs)
+                si->mEndTimeUs = endUs;
+        }
+
+        // key frames only, each one is shown at its own pts; the decoders take the dts as
+        // output pts, and in reverse the stream runs backwards anyway
+        if (mTrickMode && packet->pts != (int64_t)AV_NOPTS_VALUE)
+            packet->dts = packet->pts;
+
         MediaBufferSP buf = AVBufferHelper::createMediaBuffer(packet, true);
         if ( !buf ) {
             MMLOGE("failed to createMediaBuffer\n");
@@ -2752,7 +3680,8 @@ bool AVDemuxer::checkBuffer(int64_t & min)
             continue;
         }
 
-        int64_t j = si->bufferedTime();
+        // trick play timestamps jump (or run backwards), count the key frames instead
+        int64_t j = mTrickMode ? (int64_t)si->bufferedCount() * TRICK_FRAME_INTERVAL_US : si->bufferedTime();
         if ( min > j ) {
             MMLOGV("min change from %" PRId64 " to %" PRId64 "(mediatype: %d)\n", min, j, si->mMediaType);
             min = j;
@@ -39,6 +39,7 @@ extern "C" {
 #include <multimedia/mm_cpp_utils.h>
 #include <multimedia/elapsedtimer.h>
 #include <multimedia/codec.h>
+#include <multimedia/memory_asset.h>
 #include "multimedia/mm_audio.h"
 #include <queue>
 
@@ -88,6 +89,8 @@ public:
     virtual mm_status_t setUri(const char * uri,
                             const std::map<std::string, std::string> * headers = NULL);
     virtual mm_status_t setUri(int fd, int64_t offset, int64_t length);
+    virtual mm_status_t setNextUri(const char * uri,
+                            const std::map<std::string, std::string> * headers = NULL);
     static CowCodecID AVCodecId2CodecId(AVCodecID id);
 
 private:
@@ -133,6 +136,7 @@ private:
         void reset();
 
         int64_t bufferedTime() const;
+        size_t bufferedCount() const;
         int64_t bufferedFirstTs(bool isPendingList = false) const;
         int64_t bufferedLastTs(bool isPendingList = false) const;
         int64_t bufferedFirstTs_l(bool isPendingList = false) const;
@@ -168,6 +172,21 @@ private:
 
         int64_t mTargetTimeUs;
         int64_t mStartTimeUs;
+        int64_t mEndTimeUs; // max pts + duration of the packets read, where the next source joins
+        int64_t mLastReadTs; // pts of the last buffer handed to the reader
+    };
+
+    // read position in a MemoryAsset, the opaque of its AVIO context
+    struct MemSource {
+        explicit MemSource(const MemoryAssetSP & asset) : mAsset(asset), mPos(0) {}
+        MemoryAssetSP mAsset;
+        int64_t mPos;
+    };
+
+    struct RetiredContext {
+        AVFormatContext * mFormatContext;
+        AVIOContext * mIOContext; // custom io, NULL if opened by uri
+        MemSource * mMemSource;
     };
 
     struct SeekSequence {
@@ -232,6 +251,13 @@ protected:
     mm_status_t readFrame();
 
     bool checkPacketWritable(StreamInfo * si, AVPacket * packet);
+    bool isTrickRate(int32_t rate) const;
+    void updatePlayRate_l();
+    void startTrickPlay_l(int64_t fromUs);
+    void stopTrickPlay_l();
+    bool checkTrickPacket(StreamInfo * si, AVPacket * packet);
+    mm_status_t trickSeek_l(MMAutoLock & lock);
+    mm_status_t writeEOS_l();
 
     mm_status_t read(MediaBufferSP & buffer, StreamInfo * si);
     void checkSeek();
@@ -250,11 +276,26 @@ protected:
     void checkHighWater(int64_t readCosts, int64_t dur);
     mm_status_t createContext();
     void releaseContext();
+    std::string probeCacheKey();
+    void saveProbeResult(const std::string & key);
+    bool restoreProbeResult(const std::string & key);
+    bool isNextSourceCompatible_l(int * nextStreams);
+    bool switchToNextSource_l();
+    bool loopToStart_l(MMAutoLock & lock);
+    void releaseNextSource_l();
+    void releaseRetiredContexts();
+    static void closeFormatContext(AVFormatContext * context, AVIOContext * ioContext);
+    static void freeIOContext(AVIOContext * ioContext);
+    static int nextSourceInterrupt(void * opaque);
 
     int avRead(uint8_t *buf, int buf_size);
     static int avRead(void *opaque, uint8_t *buf, int buf_size);
     static int64_t avSeek(void *opaque, int64_t offset, int whence);
     int64_t avSeek(int64_t offset, int whence);
+    static int avMemRead(void *opaque, uint8_t *buf, int buf_size);
+    static int64_t avMemSeek(void *opaque, int64_t offset, int whence);
+    static AVIOContext * createMemIOContext(MemSource * source);
+    bool usesCustomIO() const { return mUri.empty() || mMemSource; }
 
     static const std::list<std::string> & getSupportedProtocols();
 
@@ -281,6 +322,17 @@ private:
     int32_t mScaledThresholdRate;
     int32_t mScaledPlayRateCur;
 
+    // trick play: beyond mScaledThresholdRate or reverse, the video key frames are read one by one
+    // with a seek in between, in raw stream time (us, start time not removed)
+    bool mTrickMode;
+    bool mTrickEOS;
+    int64_t mTrickLastUs;   // last key frame written
+    int64_t mTrickSeekUs;   // pending seek, SEEK_NONE if none
+    int64_t mTrickTargetUs; // last seek done
+    int64_t mTrickStepUs;   // media time between two shown key frames
+    int32_t mTrickMisses;
+    std::vector<int> mTrickDiscard; // AVStream::discard before trick play
+
     InterruptHandler * mInterruptHandler;
     bool mEOF;
 
@@ -298,11 +350,30 @@ private:
     int mFd;
     int64_t mLength;
     int64_t mOffset;
+    MemSource * mMemSource; // "mem://" uri
     int64_t mBufferSeekExtra;
     std::string mDownloadPath;
 
     Lock mAVLock; // send to downlink components for mutex operation between audio and video stream processing
 
+    // gapless playback, protected by mBufferLock
+    std::string mNextUri;
+    AVFormatContext * mNextAVFormatContext;
+    AVIOContext * mNextAVIOContext; // custom io of a "mem://" next source
+    MemSource * mNextMemSource;
+    int32_t mNextGeneration;    // bumped to cancel the pending open of the next source
+    int32_t mNextOpening;       // generation onPrepareNext is opening
+    int64_t mTimeOffsetUs;      // added to the buffer timestamps of the joined sources and loops
+    int32_t mSeamlessLoop;      // PlaySourceComponent::PARAM_KEY_SEAMLESS_LOOP
+    int32_t mLoopCount;
+    // decoders keep the AVCodecContext of the first source, so replaced contexts are released on reset
+    std::list<RetiredContext> mRetiredContexts;
+
+    // stream probing, see PlaySourceComponent::PARAM_KEY_PROBE_SIZE etc
+    int64_t mProbeSize;
+    int64_t mAnalyzeDuration;
+    int32_t mProbeCache;
+
 #ifdef DUMP_INPUT
     FILE * mInputFile;
 #endif
@@ -310,6 +381,7 @@ private:
 
     DECLARE_MSG_LOOP()
     DECLARE_MSG_HANDLER(onPrepare)
+    DECLARE_MSG_HANDLER(onPrepareNext)
 
     MM_DISALLOW_COPY(AVDemuxer)
     DECLARE_LOGTAG()
@@ -181,6 +181,7 @@ private:
 DEFINE_LOGTAG(AVMuxer)
 DEFINE_LOGTAG(AVMuxer::AVMuxWriter)
 DEFINE_LOGTAG(AVMuxer::MuxThread)
+DEFINE_LOGTAG(AVMuxer::FinalizeThread)
 DEFINE_LOGTAG(AVLogger)
 
 static const size_t AVIO_BUFFER_SIZE = 32768;
@@ -189,7 +190,12 @@ static const AVRational TIMEBASE_DEF = {1, 1000000};
 static const char * META_SI = "AV-META-SI";
 static const char * META_ME = "AV-META-ME";
 static const char * MMTHREAD_NAME = "AVMuxer::MuxThread";
+static const char * FINALIZE_THREAD_NAME = "AVMuxer::FinalizeThread";
 static const char * MMMSGTHREAD_NAME = "AVMuxer";
+static const int64_t PRE_ROLL_MAX_BYTES_DEF = 16 * 1024 * 1024;
+static const int64_t SEGMENT_DURATION_DEF = 6000000;
+static const int32_t SEGMENT_INDEX_INIT = -1;
+static const int32_t SEGMENT_INDEX_NONE = -2;  // after the last segment, the data isn't tagged
 
 AVMuxer::StreamInfo::StreamInfo(AVMuxer *muxer, MediaType mediaType) :
                     mComponent(muxer),
@@ -483,6 +489,90 @@ mm_status_t AVMuxer::AVMuxWriter::setMetaData(const MediaMetaSP & metaData)
     return MM_ERROR_SUCCESS;
 }
 
+AVMuxer::FinalizeThread::FinalizeThread(AVMuxer * muxer)
+                    : MMThread(FINALIZE_THREAD_NAME),
+                    mMuxer(muxer),
+                    mCond(mLock),
+                    mBusy(false),
+                    mContinue(false)
+{
+    FUNC_ENTER();
+    FUNC_LEAVE();
+}
+
+AVMuxer::FinalizeThread::~FinalizeThread()
+{
+    FUNC_ENTER();
+    MMASSERT(mFiles.empty());
+    FUNC_LEAVE();
+}
+
+mm_status_t AVMuxer::FinalizeThread::prepare()
+{
+    FUNC_ENTER();
+    mContinue = true;
+    if ( create() ) {
+        MMLOGE("failed to create thread\n");
+        return MM_ERROR_NO_MEM;
+    }
+
+    FUNC_LEAVE();
+    return MM_ERROR_SUCCESS;
+}
+
+// finishes the queued files first
+mm_status_t AVMuxer::FinalizeThread::reset()
+{
+    FUNC_ENTER();
+    {
+        MMAutoLock lock(mLock);
+        mContinue = false;
+        mCond.broadcast();
+    }
+    destroy();
+    FUNC_LEAVE();
+    return MM_ERROR_SUCCESS;
+}
+
+void AVMuxer::FinalizeThread::finalize(OutputFile * file)
+{
+    MMAutoLock lock(mLock);
+    mFiles.push_back(file);
+    mCond.broadcast();
+}
+
+void AVMuxer::FinalizeThread::waitDone()
+{
+    MMAutoLock lock(mLock);
+    while ( !mFiles.empty() || mBusy ) {
+        mCond.wait();
+    }
+}
+
+void AVMuxer::FinalizeThread::main()
+{
+    FUNC_ENTER();
+    MMAutoLock lock(mLock);
+    while ( true ) {
+        if ( mFiles.empty() ) {
+            if ( !mContinue )
+                break;
+            mCond.wait();
+            continue;
+        }
+
+        OutputFile * file = mFiles.front();
+        mFiles.pop_front();
+        mBusy = true;
+        lock.unlock();
+        mMuxer->finalizeFile(file);
+        lock.lock();
+        mBusy = false;
+        mCond.broadcast();
+    }
+    MMLOGI("-\n");
+}
+
 AVMuxer::MuxThread::MuxThread(AVMuxer * muxer)
                     : MMThread(MMTHREAD_NAME),
                     mMuxer(muxer),
@@ -589,6 +679,11 @@ void AVMuxer::MuxThread::main()
             si->mMediaType == kMediaTypeAudio ? "audio" : "video", si->mEncodedBuffers.size());
     }
 
+    // the rotated files are complete in the sink before its EOS
+    if ( mMuxer->mFinalizeThread ) {
+        mMuxer->mFinalizeThread->waitDone();
+    }
+
     if (MM_UNLIKELY(r == MM_ERROR_MALFORMED)) {
         MMLOGE("MALFORMED, not write trailer\n");
     } else {
@@ -612,11 +707,9 @@ AVMuxer::AVMuxer() : MMMsgThread(MMMSGTHREAD_NAME),
                         mMaxDuration(0),
                         mMaxFileSize(0),
                         mCurFileSize(0),
+                        mOutputFile(NULL),
                         mAVFormatContext(NULL),
-                        mAVIOContext(NULL),
                         mWriter((Writer*)NULL),
-                        mOutputSeekOffset(-1),
-                        mOutputSeekWhence(-1),
                     #ifdef HAVE_EIS_AUDIO_DELAY
                         mIsAudioDelay(false),
                     #endif
@@ -628,7 +721,21 @@ AVMuxer::AVMuxer() : MMMsgThread(MMMSGTHREAD_NAME),
                         mCheckVideoKeyFrame(false),
                         mTimeCostMux("TCAVMuxer", 1500),
                         mForceDisableMuxer(false),
-                        mStreamDriftMax(-1)
+                        mStreamDriftMax(-1),
+                        mPreRollBytes(0),
+                        mPreRollDurationUs(0),
+                        mPreRollMaxBytes(PRE_ROLL_MAX_BYTES_DEF),
+                        mPreRollTriggered(false),
+                        mFileRotation(false),
+                        mRotatePending(false),
+                        mFinalizeThread(NULL),
+                        mFileStartUs(-1ll),
+                        mSegmentDurationUs(0),
+                        mPartDurationUs(0),
+                        mSegmentIndex(SEGMENT_INDEX_INIT),
+                        mSegmentStartUs(0),
+                        mPartStartUs(0),
+                        mPartIndependent(false)
 {
     FUNC_ENTER();
     class AVInitializer {
@@ -701,6 +808,11 @@ mm_status_t AVMuxer::setParameter(const MediaMetaSP & meta)
             mOutputFormat = item.mValue.str;
             if (!strcmp(item.mValue.str, "m4a")) {
                 mOutputFormat = "mp4";
+            } else if (!strcmp(item.mValue.str, "hls") || !strcmp(item.mValue.str, "dash")) {
+                mOutputFormat = !strcmp(item.mValue.str, "hls") ? "mpegts" : "mp4";
+                if (mSegmentDurationUs <= 0 && mState != STATE_STARTED && mState != STATE_STOPPING) {
+                    mSegmentDurationUs = SEGMENT_DURATION_DEF;
+                }
             }
             MMLOGI("key: %s, value: %s\n", item.mName, mOutputFormat.c_str());
             continue;
@@ -758,6 +870,68 @@ mm_status_t AVMuxer::setParameter(const MediaMetaSP & meta)
             mStreamDriftMax = item.mValue.ii;
             MMLOGI("key: %s, value: %d ms" , item.mName, mStreamDriftMax);
             continue;
+        } else if ( !strcmp(item.mName, MEDIA_ATTR_PRE_ROLL_DURATION) ||
+                    !strcmp(item.mName, MEDIA_ATTR_PRE_ROLL_MAX_BYTES) ) {
+            if ( item.mType != MediaMeta::MT_Int32 || item.mValue.ii < 0 ) {
+                MMLOGW("invalid type or value for %s\n", item.mName);
+                continue;
+            }
+            // the recorder passes its file meta again while recording
+            if ( mState == STATE_STARTED || mState == STATE_STOPPING ) {
+                MMLOGV("key: %s, ignored while recording\n", item.mName);
+                continue;
+            }
+
+            if ( !strcmp(item.mName, MEDIA_ATTR_PRE_ROLL_DURATION) )
+                mPreRollDurationUs = item.mValue.ii * 1000ll;
+            else
+                mPreRollMaxBytes = item.mValue.ii ? item.mValue.ii : PRE_ROLL_MAX_BYTES_DEF;
+            MMLOGI("key: %s, value: %d\n", item.mName, item.mValue.ii);
+            continue;
+        } else if ( !strcmp(item.mName, MEDIA_ATTR_PRE_ROLL_TRIGGER) ) {
+            if ( item.mType != MediaMeta::MT_Int32 ) {
+                MMLOGW("invalid type for %s\n", item.mName);
+                continue;
+            }
+            if ( !item.mValue.ii )
+                continue;
+            if ( mState != STATE_STARTED ) {
+                MMLOGE("pre-roll trigger in state %d\n", mState);
+                return MM_ERROR_INVALID_STATE;
+            }
+
+            triggerPreRoll();
+            continue;
+        } else if ( !strcmp(item.mName, MEDIA_ATTR_FILE_ROTATION) ) {
+            if ( item.mType != MediaMeta::MT_Int32 ) {
+                MMLOGW("invalid type for %s\n", item.mName);
+                continue;
+            }
+            if ( mState == STATE_STARTED || mState == STATE_STOPPING ) {
+                MMLOGV("key: %s, ignored while recording\n", item.mName);
+                continue;
+            }
+
+            mFileRotation = item.mValue.ii != 0;
+            MMLOGI("key: %s, value: %d\n", item.mName, item.mValue.ii);
+            continue;
+        } else if ( !strcmp(item.mName, MEDIA_ATTR_SEGMENT_DURATION) ||
+                    !strcmp(item.mName, MEDIA_ATTR_SEGMENT_PART_DURATION) ) {
+            if ( item.mType != MediaMeta::MT_Int32 || item.mValue.ii < 0 ) {
+                MMLOGW("invalid type or value for %s\n", item.mName);
+                continue;
+            }
+            if ( mState == STATE_STARTED || mState == STATE_STOPPING ) {
+                MMLOGV("key: %s, ignored while recording\n", item.mName);
+                continue;
+            }
+
+            if ( !strcmp(item.mName, MEDIA_ATTR_SEGMENT_DURATION) )
+                mSegmentDurationUs = item.mValue.ii * 1000ll;
+            else
+                mPartDurationUs = item.mValue.ii * 1000ll;
+            MMLOGI("key: %s, value: %d\n", item.mName, item.mValue.ii);
+            continue;
         }
     }
 
@@ -844,8 +1018,16 @@ bool AVMuxer::writeHeader()
         av_dict_set(&mAVFormatContext->metadata, "need_moov_size", "1", 0);
     }
 
+    // fragments only where flushSegment() cuts, each starts with its own base
+    AVDictionary * options = NULL;
+    if (mSegmentDurationUs > 0 && !strcmp(mOutputFormat.c_str(), "mp4")) {
+        av_dict_set(&options, "movflags", "frag_custom+empty_moov+default_base_moof", 0);
+    }
+
     //AVStream.time_base will be overwritten by muxer
-    if ( avformat_write_header(mAVFormatContext, NULL) ) {
+    int ret = avformat_write_header(mAVFormatContext, &options);
+    av_dict_free(&options);
+    if ( ret < 0 ) {
         MMLOGE("failed to write header\n");
         return false;
     }
@@ -874,6 +1056,21 @@ bool AVMuxer::writeTrailer()
         return false;
     }
 
+    if ( mSegmentDurationUs > 0 && mSegmentIndex >= 0 ) {
+        // the last segment ends here, what the trailer adds isn't part of it
+        flushSegment();
+        MediaBufferSP marker = createMarkerBuffer(mSegmentIndex);
+        if ( marker ) {
+            marker->getMediaMeta()->setInt32(MEDIA_ATTR_SEGMENT_END, 1);
+            marker->setPts(mSegmentStartUs);
+            marker->setDuration(segmentEndUs() - mSegmentStartUs);
+            if ( mPartIndependent )
+                marker->setFlag(MediaBuffer::MBFT_KeyFrame);
+            mWriter->write(marker);
+        }
+        mSegmentIndex = SEGMENT_INDEX_NONE;
+    }
+
     if ( av_write_trailer(mAVFormatContext) ) {
         MMLOGE("failed to write trailer\n");
         // return false;
@@ -913,16 +1110,55 @@ mm_status_t AVMuxer::start()
 
     mAllMediaExtraDataDetermined = false;
     mEOS = false;
+    mPreRollTriggered = false;
+    mFileStartUs = -1ll;
+    if ( mPreRollDurationUs > 0 ) {
+        MMLOGI("pre-roll %" PRId64 " ms, max %" PRId64 " bytes\n", mPreRollDurationUs / 1000, mPreRollMaxBytes);
+    }
+    mCurFileSize = 0;
+    mRotatePending = false;
+    mSegmentIndex = SEGMENT_INDEX_INIT;
+    if ( mSegmentDurationUs > 0 ) {
+        if ( mFileRotation ) {
+            MMLOGW("file rotation is off while segmenting\n");
+            mFileRotation = false;
+        }
+        if ( mPartDurationUs >= mSegmentDurationUs ) {
+            mPartDurationUs = 0;
+        }
+        // segments start with a key frame
+        mCheckVideoKeyFrame = hasMediaInternal(kMediaTypeVideo);
+        MMLOGI("segmenting %s, %" PRId64 " ms, parts %" PRId64 " ms\n",
+            mOutputFormat.c_str(), mSegmentDurationUs / 1000, mPartDurationUs / 1000);
+    }
+    if ( mFileRotation ) {
+        MMLOGI("file rotation, max duration %" PRId64 " ms, max file size %" PRId64 "\n", mMaxDuration, mMaxFileSize);
+        mFinalizeThread = new FinalizeThread(this);
+        if ( !mFinalizeThread || mFinalizeThread->prepare() != MM_ERROR_SUCCESS ) {
+            MMLOGE("failed to start finalize thread\n");
+            MM_RELEASE(mFinalizeThread);
+            releaseContext();
+            return MM_ERROR_NO_MEM;
+        }
+    }
 
     mMuxThread = new MuxThread(this);
     if ( !mMuxThread ) {
         MMLOGE("failed to new thread\n");
+        if ( mFinalizeThread ) {
+            mFinalizeThread->reset();
+            MM_RELEASE(mFinalizeThread);
+        }
         releaseContext();
         return MM_ERROR_NO_MEM;
     }
 
     if ( mMuxThread->prepare() != MM_ERROR_SUCCESS ) {
         MMLOGE("failed to start thread\n");
+        if ( mFinalizeThread ) {
+            mFinalizeThread->reset();
+            MM_RELEASE(mFinalizeThread);
+        }
         releaseContext();
         MM_RELEASE(mMuxThread);
         return MM_ERROR_NO_MEM;
@@ -936,8 +1172,8 @@ mm_status_t AVMuxer::start()
 mm_status_t AVMuxer::createContext()
 {
     FUNC_ENTER();
+    MMASSERT(mOutputFile == NULL);
     MMASSERT(mAVFormatContext == NULL);
-    MMASSERT(mAVIOContext == NULL);
 
     if ( mOutputFormat.empty() ) {
         MMLOGE("output format not set\n");
@@ -965,25 +1201,33 @@ mm_status_t AVMuxer::createContext()
         return MM_ERROR_NO_MEM;
     }
 
-    mAVIOContext = avio_alloc_context(ioBuf,
+    OutputFile * file = new OutputFile;
+    file->mMuxer = this;
+    file->mIndex = 0;
+    file->mContext = mAVFormatContext;
+    file->mSeekOffset = -1;
+    file->mSeekWhence = -1;
+    file->mIOContext = avio_alloc_context(ioBuf,
                     AVIO_BUFFER_SIZE,
                     1,
-                    this,
+                    file,
                     NULL,
                     avWrite,
                     avSeek);
 
-    if ( !mAVIOContext ) {
+    if ( !file->mIOContext ) {
         MMLOGE("no mem\n");
         avformat_free_context(mAVFormatContext);
         mAVFormatContext = NULL;
         av_free(ioBuf);
         ioBuf = NULL;
+        delete file;
         return MM_ERROR_NO_MEM;
     }
 
-    mAVFormatContext->pb = mAVIOContext;
+    mAVFormatContext->pb = file->mIOContext;
     mAVFormatContext->flags |= AVFMT_FLAG_CUSTOM_IO;
+    mOutputFile = file;
 
     MMLOGI("success\n");
     return MM_ERROR_SUCCESS;
@@ -992,14 +1236,25 @@ mm_status_t AVMuxer::createContext()
 void AVMuxer::releaseContext()
 {
     FUNC_ENTER();
-    for ( auto i = mStreamInfoArray.begin(); i != mStreamInfoArray.end(); ++i ) {
-        StreamInfo * si = *i;
+    if ( mOutputFile ) {
+        releaseOutputFile(mOutputFile);
+        mOutputFile = NULL;
+    }
+    mAVFormatContext = NULL;
+}
+
+void AVMuxer::releaseOutputFile(OutputFile * file)
+{
+    AVFormatContext * context = file->mContext;
+    // streams are added in the order of mStreamInfoArray
+    for ( unsigned int i = 0; i < context->nb_streams && i < mStreamInfoArray.size(); ++i ) {
+        StreamInfo * si = mStreamInfoArray[i];
         void *ptr = nullptr;
         if (!si->mCodecMeta->getPointer("AVCodecContext", ptr)) {
             // Using Stream Codec member if "AVCodecContext" pointer is not set.
-            AVCodecContext *c = si->mStream->codec;
-            if (si->mStream->codec->extradata &&
-                si->mStream->codec->extradata_size) {
+            AVCodecContext *c = context->streams[i]->codec;
+            if (c->extradata &&
+                c->extradata_size) {
                 av_free(c->extradata);
                 c->extradata = NULL;
                 c->extradata_size = 0;
@@ -1007,20 +1262,18 @@ void AVMuxer::releaseContext()
         }
     }
 
-    if ( mAVFormatContext ) {
-        mAVFormatContext->pb = NULL;
-        avformat_free_context(mAVFormatContext);
-        mAVFormatContext = NULL;
-    }
+    context->pb = NULL;
+    avformat_free_context(context);
 
-    if ( mAVIOContext ) {
-        if ( mAVIOContext->buffer ) {
-            av_free(mAVIOContext->buffer);
-            mAVIOContext->buffer = NULL;
+    AVIOContext * ioContext = file->mIOContext;
+    if ( ioContext ) {
+        if ( ioContext->buffer ) {
+            av_free(ioContext->buffer);
+            ioContext->buffer = NULL;
         }
-        av_free(mAVIOContext);
-        mAVIOContext = NULL;
+        av_free(ioContext);
     }
+    delete file;
 }
 
 bool AVMuxer::hasMedia(MediaType mediaType)
@@ -1091,11 +1344,16 @@ void AVMuxer::stopInternal()
             }
             si->stop_l();
         }
+        preRollClear_l();
     }
 
 
 
     MM_RELEASE(mMuxThread);
+    if ( mFinalizeThread ) {
+        mFinalizeThread->reset();
+        MM_RELEASE(mFinalizeThread);
+    }
     releaseContext();
 
     SET_STATE(STATE_IDLE);
@@ -1389,10 +1647,10 @@ mm_status_t AVMuxer::write(const MediaBufferSP & buffer, StreamInfo * si)
     return MM_ERROR_SUCCESS;
 }
 
-void AVMuxer::avWrite(uint8_t *buf, int buf_size)
+void AVMuxer::avWrite(OutputFile * file, uint8_t *buf, int buf_size)
 {
     MMLOGV("+\n");
-    MediaBufferSP mb = createSinkBuffer(buf, buf_size);
+    MediaBufferSP mb = createSinkBuffer(file, buf, buf_size);
     if ( !mb ) {
         MMLOGE("failed to create sink buffer\n");
         return;
@@ -1406,13 +1664,13 @@ void AVMuxer::avWrite(uint8_t *buf, int buf_size)
 
 /*static */int AVMuxer::avWrite(void *opaque, uint8_t *buf, int buf_size)
 {
-    AVMuxer * me = static_cast<AVMuxer*>(opaque);
-    if ( !me ) {
+    OutputFile * file = static_cast<OutputFile*>(opaque);
+    if ( !file ) {
         MMLOGE("invalid cb\n");
         return -1;
     }
 
-    me->avWrite(buf, buf_size);
+    file->mMuxer->avWrite(file, buf, buf_size);
     return buf_size;
 }
 
@@ -1501,6 +1759,214 @@ MediaBufferSP AVMuxer::getMinFirstBuffer_l()
 }
 #endif
 
+// copy of an encoded buffer, the encoder gets its (device) buffer back at once
+static MediaBufferSP copyEncodedBuffer(const MediaBufferSP & buffer, const uint8_t * data, int32_t size)
+{
+    MediaBufferSP copy;
+    AVPacket * pkt = (AVPacket*)malloc(sizeof(AVPacket));
+    if ( !pkt ) {
+        return copy;
+    }
+    av_init_packet(pkt);
+    if ( av_new_packet(pkt, size) ) {
+        free(pkt);
+        return copy;
+    }
+    memcpy(pkt->data, data, size);
+    pkt->pts = buffer->pts();
+    pkt->dts = buffer->dts();
+    pkt->duration = buffer->duration();
+    if ( buffer->isFlagSet(MediaBuffer::MBFT_KeyFrame) ) {
+        pkt->flags |= AV_PKT_FLAG_KEY;
+    }
+
+    copy = AVBufferHelper::createMediaBuffer(pkt, true);
+    if ( !copy ) {
+        av_free_packet(pkt);
+        free(pkt);
+    }
+    return copy;
+}
+
+//protected by mBufferLock
+bool AVMuxer::preRollAdd_l(const MediaBufferSP & buffer, StreamInfo * si)
+{
+    if ( MM_UNLIKELY(si->mPaused) ) {
+        // the ring never spans a pause, what is triggered already is written
+        if ( !mPreRollTriggered ) {
+            preRollClear_l();
+        }
+        return true;
+    }
+    if ( !mPreRollTriggered ) {
+        // nothing kept is older than the resume
+        si->mResumeFirstFrameDone = false;
+        mCheckVideoKeyFrame = false;
+    }
+
+    bool sync = si->mMediaType == kMediaTypeVideo ?
+        buffer->isFlagSet(MediaBuffer::MBFT_KeyFrame) : !hasMediaInternal(kMediaTypeVideo);
+    if ( mPreRoll.empty() && !sync ) {
+        MMLOGV("pre-roll: drop media %d before sync point\n", si->mMediaType);
+        return true;
+    }
+
+    uint8_t * buffers = NULL;
+    int32_t offsets = 0;
+    int32_t strides = 0;
+    if ( !buffer->getBufferInfo((uintptr_t*)&buffers, &offsets, &strides, 1) ) {
+        MMLOGE("failed to get bufferinfo(media: %d)\n", si->mMediaType);
+        return true;
+    }
+    int32_t size = (int32_t)buffer->size() - offsets;
+    if ( size < 0 ) {
+        return true;
+    }
+    if ( mPreRollTriggered && !mPreRoll.empty() && mPreRollBytes + size > mPreRollMaxBytes ) {
+        // no room until the ring is written further, the buffer waits in its list
+        return false;
+    }
+    if ( size > mPreRollMaxBytes ) {
+        MMLOGW("pre-roll: %d bytes don't fit in %" PRId64 ", drop all\n", size, mPreRollMaxBytes);
+        preRollClear_l();
+        return true;
+    }
+
+    MediaBufferSP copy = copyEncodedBuffer(buffer, buffers + offsets, size);
+    if ( !copy ) {
+        MMLOGE("pre-roll: no mem for %d bytes\n", size);
+        return true;
+    }
+    MediaMetaSP meta = copy->getMediaMeta();
+    meta->setPointer(META_SI, si);
+
+    si->mFormerDtsAbs = buffer->dts();
+
+    PreRollEntry entry;
+    entry.mBuffer = copy;
+    entry.mTimeUs = av_rescale_q(buffer->dts(), si->mTimeBase, TIMEBASE_DEF);
+    entry.mSync = sync;
+    mPreRoll.push_back(entry);
+    mPreRollBytes += size;
+
+    if ( !mPreRollTriggered ) {
+        preRollTrim_l();
+    }
+    return true;
+}
+
+//protected by mBufferLock
+void AVMuxer::preRollTrim_l()
+{
+    // drop whole GOPs from the front while the rest still covers the duration, or while over the byte limit
+    while ( !mPreRoll.empty() ) {
+        bool overBytes = mPreRollBytes > mPreRollMaxBytes;
+        if ( !overBytes && mPreRoll.back().mTimeUs - mPreRoll.front().mTimeUs < mPreRollDurationUs ) {
+            break;
+        }
+
+        size_t next = 1;
+        while ( next < mPreRoll.size() && !mPreRoll[next].mSync ) {
+            next++;
+        }
+        if ( next == mPreRoll.size() ) {
+            if ( overBytes ) {
+                MMLOGW("pre-roll: one GOP is over %" PRId64 " bytes, drop it\n", mPreRollMaxBytes);
+                preRollClear_l();
+            }
+            break;
+        }
+        if ( !overBytes && mPreRoll.back().mTimeUs - mPreRoll[next].mTimeUs < mPreRollDurationUs ) {
+            break;
+        }
+
+        for ( size_t i = 0; i < next; i++ ) {
+            mPreRollBytes -= mPreRoll.front().mBuffer->size();
+            mPreRoll.pop_front();
+        }
+    }
+}
+
+//protected by mBufferLock
+void AVMuxer::preRollClear_l()
+{
+    mPreRoll.clear();
+    mPreRollBytes = 0;
+}
+
+//protected by mBufferLock
+// encoded buffers are moved to the ring as they come. nothing is written until the trigger,
+// then the ring is written first; new buffers still go to the ring while it has room, so the
+// encoders never wait for the file, and once it is empty they are written directly.
+MediaBufferSP AVMuxer::preRollNext_l()
+{
+    while ( !mPreRollTriggered || !mPreRoll.empty() ) {
+        MediaBufferSP buffer = getMinFirstBuffer_l();
+        if ( !buffer ) {
+            break;
+        }
+
+        void * p = NULL;
+        MediaMetaSP meta = buffer->getMediaMeta();
+        if ( !meta->getPointer(META_SI, p) || !p ) {
+            MMLOGE("no stream info\n");
+            continue;
+        }
+        StreamInfo * si = static_cast<StreamInfo*>(p);
+
+        if ( buffer->isFlagSet(MediaBuffer::MBFT_EOS) ) {
+            if ( !mPreRollTriggered ) {
+                // stopped without a trigger, nothing is written
+                preRollClear_l();
+                return buffer;
+            }
+            si->mEncodedBuffers.push_front(buffer);
+            break;
+        }
+
+        if ( !preRollAdd_l(buffer, si) ) {
+            si->mEncodedBuffers.push_front(buffer);
+            break;
+        }
+    }
+
+    MediaBufferSP buffer;
+    if ( !mPreRollTriggered ) {
+        return buffer;
+    }
+    if ( mPreRoll.empty() ) {
+        return getMinFirstBuffer_l();
+    }
+
+    buffer = mPreRoll.front().mBuffer;
+    mPreRollBytes -= buffer->size();
+    mPreRoll.pop_front();
+    return buffer;
+}
+
+void AVMuxer::triggerPreRoll()
+{
+    {
+        MMAutoLock lock(mBufferLock);
+        if ( mPreRollDurationUs <= 0 || mPreRollTriggered ) {
+            MMLOGI("pre-roll off or triggered already\n");
+            return;
+        }
+
+        mPreRollTriggered = true;
+        if ( mPreRoll.empty() ) {
+            // nothing kept yet, start at the next key frame
+            mCheckVideoKeyFrame = hasMediaInternal(kMediaTypeVideo);
+            MMLOGI("pre-roll triggered, nothing kept\n");
+        } else {
+            MMLOGI("pre-roll triggered, %zu buffers, %" PRId64 " bytes, %" PRId64 " ms\n",
+                mPreRoll.size(), mPreRollBytes,
+                (mPreRoll.back().mTimeUs - mPreRoll.front().mTimeUs) / 1000);
+        }
+    }
+    mMuxThread->mux();
+}
+
 mm_status_t AVMuxer::mux()
 {
     MMLOGV("+\n");
@@ -1516,7 +1982,7 @@ mm_status_t AVMuxer::mux()
     MediaBufferSP buffer;
     {
         MMAutoLock lock(mBufferLock);
-        buffer = getMinFirstBuffer_l();
+        buffer = mPreRollDurationUs > 0 ? preRollNext_l() : getMinFirstBuffer_l();
         if (!buffer) {
             MMLOGV("no more\n");
             if ( mEOS ) {
@@ -1577,6 +2043,20 @@ mm_status_t AVMuxer::mux()
         }
         MMLOGV("checking extra data: all extra data determined\n");
         mAllMediaExtraDataDetermined = true;
+        if ( mSegmentDurationUs > 0 ) {
+            // the init data is complete in the sink before the first segment
+            avio_flush(mAVFormatContext->pb);
+            MediaBufferSP marker = createMarkerBuffer(SEGMENT_INDEX_INIT);
+            if ( marker ) {
+                MediaMetaSP markerMeta = marker->getMediaMeta();
+                markerMeta->setInt32(MEDIA_ATTR_SEGMENT_END, 1);
+                std::string codecs = codecsString();
+                if ( !codecs.empty() ) {
+                    markerMeta->setString(MEDIA_ATTR_SEGMENT_CODECS, codecs.c_str());
+                }
+                mWriter->write(marker);
+            }
+        }
         // return MM_ERROR_SUCCESS;
     }
 
@@ -1585,6 +2065,32 @@ mm_status_t AVMuxer::mux()
         return MM_ERROR_INVALID_PARAM;
     }
 
+    // the next file starts with a video key frame, with any frame without video. the limits are
+    // checked before the sync frame is written (as cutSegment() does), so a sync frame right at
+    // them starts the next file, not the one after it
+    if (MM_UNLIKELY(mFileRotation) && !si->mPaused &&
+        (si->mMediaType == kMediaTypeVideo ? buffer->isFlagSet(MediaBuffer::MBFT_KeyFrame) : !hasMediaInternal(kMediaTypeVideo))) {
+        int64_t dtsUs = av_rescale_q(buffer->dts(), si->mTimeBase, TIMEBASE_DEF);
+        if (!mRotatePending && mFileStartUs != -1ll) {
+            int64_t fileUs = dtsUs - mFileStartUs;
+            if (si->mPausedDurationUs > 0)
+                fileUs -= av_rescale_q(si->mPausedDurationUs, si->mStream->time_base, TIMEBASE_DEF);
+            // in ms rounded, 30 frames of 33333 us are one second
+            if (mMaxDuration > 0 && (fileUs + 500) / 1000 >= mMaxDuration)
+                limitReached(Component::kEventMaxDurationReached);
+            else if (mMaxFileSize > 0 && mCurFileSize + buffer->size() - offsets > mMaxFileSize)
+                limitReached(Component::kEventMaxFileSizeReached);
+        }
+        if (mRotatePending) {
+            mRotatePending = false;
+            if (!rotateFile(dtsUs)) {
+                NOTIFY_ERROR(MM_ERROR_OP_FAILED);
+                mEOS = true;
+                return MM_ERROR_EOS;
+            }
+        }
+    }
+
     AVPacket pkt;
     av_init_packet(&pkt);
     pkt.data = (uint8_t*)buffers + offsets;
@@ -1633,6 +2139,17 @@ mm_status_t AVMuxer::mux()
         }
     }
 
+    if (mPreRollDurationUs > 0 || mFileRotation || mSegmentDurationUs > 0) {
+        // the file starts at the first kept key frame or at the rotation, not at start()
+        if (mFileStartUs == -1ll) {
+            mFileStartUs = av_rescale_q(pkt.dts, si->mStream->time_base, TIMEBASE_DEF);
+            MMLOGI("recording starts at %" PRId64 " ms\n", mFileStartUs / 1000);
+        }
+        int64_t offset = av_rescale_q(mFileStartUs, TIMEBASE_DEF, si->mStream->time_base);
+        pkt.dts = pkt.dts > offset ? pkt.dts - offset : 0;
+        pkt.pts = pkt.pts > offset ? pkt.pts - offset : 0;
+    }
+
     // note: mFrameDurationUs/mFormerDts/mFrameDurationUs are based on muxer timebase
     if (si->mResumeFirstFrameDone) {
 
@@ -1692,6 +2209,11 @@ mm_status_t AVMuxer::mux()
     muxDataDump.dump(pkt.data, pkt.size);
 #endif
 
+    if ( mSegmentDurationUs > 0 ) {
+        cutSegment(si, buffer->isFlagSet(MediaBuffer::MBFT_KeyFrame),
+            av_rescale_q(pkt.dts, si->mStream->time_base, TIMEBASE_DEF));
+    }
+
     if ( av_interleaved_write_frame(mAVFormatContext, &pkt) ) {
         MMLOGE("failed to write to avformat(media: %d)\n", si->mMediaType);
         return MM_ERROR_OP_FAILED;
@@ -1711,9 +2233,7 @@ mm_status_t AVMuxer::mux()
 
                 //add 1024 bytes as tolerance
                 if (mCurFileSize + iMoovSize + 1024 >  mMaxFileSize * 95 / 100) {
-                    NOTIFY(kEventInfo, Component::kEventMaxFileSizeReached, 0, nilParam);
-                    mEOS = true;
-                    return MM_ERROR_EOS;
+                    return limitReached(Component::kEventMaxFileSizeReached);
                 }
             } else {
                 MMLOGW("can not found moov_size in mp4 format");
@@ -1721,18 +2241,16 @@ mm_status_t AVMuxer::mux()
         } else if (!strcmp(mOutputFormat.c_str(), "amr")) {
             //arm header size 9
             if (mCurFileSize + 32 + 9 >  mMaxFileSize) {
-                NOTIFY(kEventInfo, Component::kEventMaxFileSizeReached, 0, nilParam);
-                mEOS = true;
-                return MM_ERROR_EOS;
+                return limitReached(Component::kEventMaxFileSizeReached);
             }
+        } else if (mFileRotation && mCurFileSize > mMaxFileSize) {
+            return limitReached(Component::kEventMaxFileSizeReached);
         }
     }
 
     if (mMaxDuration > 0) {
         if (mMaxDuration <= mCurrentDts / 1000) {
-            NOTIFY(kEventInfo, Component::kEventMaxDurationReached, 0, nilParam);
-            mEOS = true;
-            return MM_ERROR_EOS;
+            return limitReached(Component::kEventMaxDurationReached);
         }
     }
 
@@ -1740,7 +2258,7 @@ mm_status_t AVMuxer::mux()
     return MM_ERROR_SUCCESS;
 }
 
-MediaBufferSP AVMuxer::createSinkBuffer(const uint8_t * buf, size_t size)
+MediaBufferSP AVMuxer::createSinkBuffer(OutputFile * file, const uint8_t * buf, size_t size)
 {
     MMLOGV("+\n");
     MediaBufferSP buffer = MediaBuffer::createMediaBuffer(MediaBuffer::MBT_ByteBuffer);
@@ -1751,11 +2269,16 @@ MediaBufferSP AVMuxer::createSinkBuffer(const uint8_t * buf, size_t size)
 
     MediaMetaSP meta = buffer->getMediaMeta();
     meta->setPointer(META_ME, this);
-    if ( mOutputSeekOffset >= 0 ) {
-        MMLOGV("seek: offset: %" PRId64 ", whence: %d\n", mOutputSeekOffset, mOutputSeekWhence);
-        meta->setInt64(MEDIA_ATTR_SEEK_OFFSET, mOutputSeekOffset);
-        meta->setInt32(MEDIA_ATTR_SEEK_WHENCE, mOutputSeekWhence);
-        mOutputSeekOffset = -1;
+    if ( file->mSeekOffset >= 0 ) {
+        MMLOGV("seek: offset: %" PRId64 ", whence: %d\n", file->mSeekOffset, file->mSeekWhence);
+        meta->setInt64(MEDIA_ATTR_SEEK_OFFSET, file->mSeekOffset);
+        meta->setInt32(MEDIA_ATTR_SEEK_WHENCE, file->mSeekWhence);
+        file->mSeekOffset = -1;
+    }
+    if ( mFileRotation ) {
+        meta->setInt32(MEDIA_ATTR_SEGMENT_INDEX, file->mIndex);
+    } else if ( mSegmentDurationUs > 0 && mSegmentIndex != SEGMENT_INDEX_NONE ) {
+        meta->setInt32(MEDIA_ATTR_SEGMENT_INDEX, mSegmentIndex);
     }
 
     //buffer->setFlag(MediaBuffer::MBFT_CodecData);
@@ -1826,17 +2349,17 @@ void AVMuxer::sinkBufferReleased()
 
 /*static */int64_t AVMuxer::avSeek(void *opaque, int64_t offset, int whence)
 {
-    AVMuxer * me = static_cast<AVMuxer*>(opaque);
-    if ( !me ) {
+    OutputFile * file = static_cast<OutputFile*>(opaque);
+    if ( !file ) {
         MMLOGE("invalid cb\n");
         return -1;
     }
 
-    me->avSeek(offset, whence);
+    file->mMuxer->avSeek(file, offset, whence);
     return 0;
 }
 
-int64_t AVMuxer::avSeek(int64_t offset, int whence)
+int64_t AVMuxer::avSeek(OutputFile * file, int64_t offset, int whence)
 {
     if ( whence == SEEK_SET && offset < 0 ) {
         MMLOGE("seek from start, but offset < 0\n");
@@ -1849,13 +2372,13 @@ int64_t AVMuxer::avSeek(int64_t offset, int whence)
     }
 
     MMAutoLock lock(mBufferLock);
-    if ( mOutputSeekOffset >= 0 ) {
-        MMLOGW("cur seek not completed(%" PRId64 ")\n", mOutputSeekOffset);
+    if ( file->mSeekOffset >= 0 ) {
+        MMLOGW("cur seek not completed(%" PRId64 ")\n", file->mSeekOffset);
     }
 
-    mOutputSeekOffset = offset;
-    mOutputSeekWhence = whence;
-    MMLOGV("av_seek: req: offset: %" PRId64 ", whence: %d", mOutputSeekOffset, mOutputSeekWhence);
+    file->mSeekOffset = offset;
+    file->mSeekWhence = whence;
+    MMLOGV("av_seek: req: offset: %" PRId64 ", whence: %d", file->mSeekOffset, file->mSeekWhence);
     return offset;
 }
 
@@ -1873,6 +2396,309 @@ void AVMuxer::signalEOS2Sink()
     MMLOGV("-\n");
 }
 
+// no data, the sink opens the next file or closes a finished one
+void AVMuxer::signalSegment2Sink(int32_t index, bool end)
+{
+    MMLOGV("+\n");
+    MediaBufferSP buffer = createMarkerBuffer(index);
+    if (!buffer) {
+        return;
+    }
+
+    if ( end ) {
+        buffer->getMediaMeta()->setInt32(MEDIA_ATTR_SEGMENT_END, 1);
+    }
+    mWriter->write(buffer);
+    MMLOGV("-\n");
+}
+
+MediaBufferSP AVMuxer::createMarkerBuffer(int32_t index)
+{
+    MediaBufferSP buffer = MediaBuffer::createMediaBuffer(MediaBuffer::MBT_ByteBuffer);
+    if (!buffer) {
+        MMLOGE("no mem\n");
+        return buffer;
+    }
+
+    buffer->setSize(0);
+    buffer->getMediaMeta()->setInt32(MEDIA_ATTR_SEGMENT_INDEX, index);
+    return buffer;
+}
+
+// before writing the frame at timeUs: a new segment at a sync point past mSegmentDurationUs,
+// a new part past mPartDurationUs. the sink gets the end of the last one after its data
+void AVMuxer::cutSegment(StreamInfo * si, bool keyFrame, int64_t timeUs)
+{
+    bool hasVideo = hasMediaInternal(kMediaTypeVideo);
+    bool sync = si->mMediaType == kMediaTypeVideo ? keyFrame : !hasVideo;
+    if ( MM_UNLIKELY(mSegmentIndex < 0) ) {
+        mSegmentIndex = 0;
+        mSegmentStartUs = mPartStartUs = timeUs;
+        mPartIndependent = sync;
+        return;
+    }
+
+    bool segmentEnd = sync && timeUs - mSegmentStartUs >= mSegmentDurationUs;
+    // parts are cut at video frames, so a key frame always starts one
+    bool partEnd = mPartDurationUs > 0 && timeUs - mPartStartUs >= mPartDurationUs &&
+        (si->mMediaType == kMediaTypeVideo || !hasVideo);
+    if ( !segmentEnd && !partEnd ) {
+        return;
+    }
+
+    flushSegment();
+    MediaBufferSP marker = createMarkerBuffer(mSegmentIndex);
+    if ( marker ) {
+        MediaMetaSP meta = marker->getMediaMeta();
+        if ( segmentEnd ) {
+            meta->setInt32(MEDIA_ATTR_SEGMENT_END, 1);
+            marker->setPts(mSegmentStartUs);
+            marker->setDuration(timeUs - mSegmentStartUs);
+        } else {
+            meta->setInt32(MEDIA_ATTR_SEGMENT_PART, 1);
+            marker->setPts(mPartStartUs);
+            marker->setDuration(timeUs - mPartStartUs);
+        }
+        // of the (last) part
+        if ( mPartIndependent )
+            marker->setFlag(MediaBuffer::MBFT_KeyFrame);
+        mWriter->write(marker);
+    }
+
+    mPartStartUs = timeUs;
+    mPartIndependent = sync;
+    if ( !segmentEnd ) {
+        return;
+    }
+
+    MMLOGI("segment %d: %" PRId64 " ms\n", mSegmentIndex, (timeUs - mSegmentStartUs) / 1000);
+    mSegmentIndex++;
+    mSegmentStartUs = timeUs;
+    if ( !strcmp(mOutputFormat.c_str(), "mpegts") ) {
+        // each segment can be played alone
+        av_opt_set(mAVFormatContext->priv_data, "mpegts_flags", "+resend_headers", 0);
+    }
+}
+
+// what is muxed goes to the sink: the interleaving queue, the fragment (mp4) or PES (mpegts), the io buffer
+void AVMuxer::flushSegment()
+{
+    if ( av_interleaved_write_frame(mAVFormatContext, NULL) < 0 ) {
+        MMLOGW("failed to flush the interleaving queue\n");
+    }
+    if ( av_write_frame(mAVFormatContext, NULL) < 0 ) {
+        MMLOGW("failed to flush the muxer\n");
+    }
+    avio_flush(mAVFormatContext->pb);
+}
+
+// end of the last frame written
+int64_t AVMuxer::segmentEndUs()
+{
+    int64_t endUs = mSegmentStartUs;
+    for ( size_t i = 0; i < mStreamInfoArray.size(); ++i ) {
+        StreamInfo * si = mStreamInfoArray[i];
+        if ( si->mStartTimeUs == -1ll ) {
+            continue;
+        }
+        int64_t dts = si->mFormerDts + (si->mFrameDurationUs > 0 ? si->mFrameDurationUs : 0);
+        int64_t us = av_rescale_q(dts, si->mStream->time_base, TIMEBASE_DEF);
+        if ( us > endUs ) {
+            endUs = us;
+        }
+    }
+    return endUs;
+}
+
+// RFC 6381 codecs of the streams, for the playlists. empty when one isn't known
+std::string AVMuxer::codecsString()
+{
+    std::string codecs;
+    for ( size_t i = 0; i < mStreamInfoArray.size(); ++i ) {
+        StreamInfo * si = mStreamInfoArray[i];
+        const uint8_t * data = si->mStream->codecpar->extradata;
+        int size = si->mStream->codecpar->extradata_size;
+        if ( !size ) {
+            data = si->mStream->codec->extradata;
+            size = si->mStream->codec->extradata_size;
+        }
+
+        char str[64] = {0};
+        switch ( si->mCodecId ) {
+            case kCodecIDH264:
+            {
+                // profile, constraints and level: avcC bytes 1-3, or the SPS after its nal header
+                const uint8_t * sps = NULL;
+                if ( size >= 4 && data[0] == 1 ) {
+                    sps = data + 1;
+                } else if ( size > 0 && isAnnexBByteStream(data, size) ) {
+                    const uint8_t * src = data;
+                    size_t srcSize = size;
+                    const uint8_t * nal = NULL;
+                    size_t nalSize = 0;
+                    while ( getNextNALUnit(&src, &srcSize, &nal, &nalSize, true) == MM_ERROR_SUCCESS ) {
+                        if ( nalSize >= 4 && (nal[0] & 0x1f) == 7 ) {
+                            sps = nal + 1;
+                            break;
+                        }
+                    }
+                }
+                if ( sps ) {
+                    snprintf(str, sizeof(str), "avc1.%02X%02X%02X", sps[0], sps[1], sps[2]);
+                }
+                break;
+            }
+            case kCodecIDHEVC:
+                // hvcC only
+                if ( size >= 13 && data[0] == 1 ) {
+                    static const char * space[] = {"", "A", "B", "C"};
+                    uint32_t compat = (data[2] << 24) | (data[3] << 16) | (data[4] << 8) | data[5];
+                    uint32_t reversed = 0;
+                    for ( int b = 0; b < 32; b++ ) {
+                        reversed = (reversed << 1) | ((compat >> b) & 1);
+                    }
+                    int len = snprintf(str, sizeof(str), "hvc1.%s%d.%X.%c%d", space[data[1] >> 6], data[1] & 0x1f,
+                        reversed, (data[1] & 0x20) ? 'H' : 'L', data[12]);
+                    int last = 11;
+                    while ( last >= 6 && !data[last] ) {
+                        last--;
+                    }
+                    for ( int b = 6; b <= last && len < (int)sizeof(str) - 4; b++ ) {
+                        len += snprintf(str + len, sizeof(str) - len, ".%02X", data[b]);
+                    }
+                }
+                break;
+            case kCodecIDAAC:
+                // audio object type of the AudioSpecificConfig, LC without one
+                snprintf(str, sizeof(str), "mp4a.40.%d", size > 0 ? data[0] >> 3 : 2);
+                break;
+            case kCodecIDMP3:
+                snprintf(str, sizeof(str), "mp4a.40.34");
+                break;
+            default:
+                break;
+        }
+
+        if ( !str[0] ) {
+            MMLOGW("no codecs string for codec %d\n", si->mCodecId);
+            return std::string();
+        }
+        if ( !codecs.empty() ) {
+            codecs += ",";
+        }
+        codecs += str;
+    }
+    MMLOGI("codecs: %s\n", codecs.c_str());
+    return codecs;
+}
+
+// at a sync point past the limits: the next file gets new streams from the same codec meta
+// and its header here, the trailer of the last one is written on mFinalizeThread
+bool AVMuxer::rotateFile(int64_t startUs)
+{
+    OutputFile * last = mOutputFile;
+    mOutputFile = NULL;
+    mAVFormatContext = NULL;
+    if ( createContext() != MM_ERROR_SUCCESS ) {
+        MMLOGE("failed to create context for file %d\n", last->mIndex + 1);
+        mOutputFile = last;
+        mAVFormatContext = last->mContext;
+        return false;
+    }
+    mOutputFile->mIndex = last->mIndex + 1;
+
+    bool ok = true;
+    std::vector<AVStream*> lastStreams;
+    {
+        // write() sets the codec data of the streams
+        MMAutoLock lock(mBufferLock);
+        for ( size_t i = 0; i < mStreamInfoArray.size(); ++i ) {
+            StreamInfo * si = mStreamInfoArray[i];
+            lastStreams.push_back(si->mStream);
+            if ( !si->addStream() ) {
+                ok = false;
+                break;
+            }
+
+            void *ptr = nullptr;
+            AVCodecContext *from = lastStreams.back()->codec;
+            if (!si->mCodecMeta->getPointer("AVCodecContext", ptr) && from->extradata && from->extradata_size) {
+                AVCodecContext *c = si->mStream->codec;
+                c->extradata = (uint8_t*)av_malloc(from->extradata_size);
+                if ( !c->extradata ) {
+                    MMLOGE("media_%d copying codec data, no mem, need: %d\n", si->mMediaType, from->extradata_size);
+                    ok = false;
+                    break;
+                }
+                memcpy(c->extradata, from->extradata, from->extradata_size);
+                c->extradata_size = from->extradata_size;
+            }
+        }
+    }
+
+    if ( ok ) {
+        signalSegment2Sink(mOutputFile->mIndex, false);
+        ok = writeHeader();
+    }
+
+    if ( !ok ) {
+        MMLOGE("failed to start file %d\n", mOutputFile->mIndex);
+        {
+            MMAutoLock lock(mBufferLock);
+            for ( size_t i = 0; i < lastStreams.size(); ++i ) {
+                mStreamInfoArray[i]->mStream = lastStreams[i];
+            }
+        }
+        releaseContext();
+        mOutputFile = last;
+        mAVFormatContext = last->mContext;
+        return false;
+    }
+
+    for ( size_t i = 0; i < mStreamInfoArray.size(); ++i ) {
+        StreamInfo * si = mStreamInfoArray[i];
+        si->mFormerDts = 0;
+        si->mStartTimeUs = -1ll;
+        si->mTrackDurationUs = 0;
+        si->mPausedDurationUs = -1ll;
+        si->mResumeFirstFrameDone = false;
+    }
+    mCurFileSize = 0;
+    mFileStartUs = startUs;
+    MMLOGI("file %d starts at %" PRId64 " ms\n", mOutputFile->mIndex, startUs / 1000);
+
+    mFinalizeThread->finalize(last);
+    return true;
+}
+
+// on mFinalizeThread
+void AVMuxer::finalizeFile(OutputFile * file)
+{
+    MMLOGI("finalizing file %d\n", file->mIndex);
+    if ( av_write_trailer(file->mContext) ) {
+        MMLOGE("failed to write trailer of file %d\n", file->mIndex);
+    }
+    int32_t index = file->mIndex;
+    signalSegment2Sink(index, true);
+    releaseOutputFile(file);
+    MMLOGI("file %d finalized\n", index);
+}
+
+mm_status_t AVMuxer::limitReached(Component::EventInfo info)
+{
+    if ( mFileRotation ) {
+        if ( !mRotatePending ) {
+            MMLOGI("file %d reached limit %d, rotate at the next sync point\n", mOutputFile->mIndex, info);
+            mRotatePending = true;
+        }
+        return MM_ERROR_SUCCESS;
+    }
+
+    NOTIFY(kEventInfo, info, 0, nilParam);
+    mEOS = true;
+    return MM_ERROR_EOS;
+}
+
 }
 
 extern "C" {
@@ -30,9 +30,13 @@ extern "C" {
 #endif
 #include <inttypes.h>
 #include <libavformat/avformat.h>
+#include <libavutil/opt.h>
 }
 
 #include <semaphore.h>
+#include <deque>
+#include <list>
+#include <string>
 #include <vector>
 
 #include <multimedia/component.h>
@@ -66,6 +70,19 @@ public:
     //                      "mp4" -- mpeg4 file format
     //                      "adts" -- adts aac file format
     // }
+    // { key:       "pre-roll-duration-ms", "pre-roll-max-bytes" (before start)
+    //    param:    keep the last encoded data in memory instead of writing it, from a video key frame on
+    // }
+    // { key:       "pre-roll-trigger"
+    //    param:    1 -- write the kept data and go on recording
+    // }
+    // { key:       "file-rotation" (before start)
+    //    param:    1 -- at "max-duration"/"max-file-size" go on in the next file from a video key frame
+    // }
+    // { key:       "segment-duration-ms", "segment-part-duration-ms" (before start)
+    //    param:    cut the stream for a segmenter sink, fragmented "mp4" or "mpegts".
+    //              output format "hls" is "mpegts", "dash" is "mp4", segmented
+    // }
     virtual mm_status_t setParameter(const MediaMetaSP & meta);
     virtual mm_status_t getParameter(MediaMetaSP & meta) const;
     virtual mm_status_t prepare();
@@ -148,6 +165,43 @@ private:
         DECLARE_LOGTAG()
     };
 
+    // one output file, the AVIO callbacks get it
+    struct OutputFile {
+        AVMuxer * mMuxer;
+        int32_t mIndex;
+        AVFormatContext * mContext;
+        AVIOContext * mIOContext;
+        int64_t mSeekOffset;
+        int mSeekWhence;
+    };
+
+    // writes the trailers of rotated files, the next file is muxed meanwhile
+    class FinalizeThread : public MMThread {
+    public:
+        FinalizeThread(AVMuxer * muxer);
+        ~FinalizeThread();
+
+    public:
+        mm_status_t prepare();
+        mm_status_t reset();
+        void finalize(OutputFile * file);
+        void waitDone();
+
+    protected:
+        virtual void main();
+
+    private:
+        AVMuxer * mMuxer;
+        Lock mLock;
+        Condition mCond;
+        std::list<OutputFile*> mFiles;
+        bool mBusy;
+        bool mContinue;
+
+        DECLARE_LOGTAG()
+        MM_DISALLOW_COPY(FinalizeThread)
+    };
+
     class MuxThread : public MMThread {
     public:
         MuxThread(AVMuxer * muxer);
@@ -174,23 +228,38 @@ private:
 protected:
     bool hasMediaInternal(MediaType mediaType);
     mm_status_t write(const MediaBufferSP & buffer, StreamInfo * si);
-    void avWrite(uint8_t *buf, int buf_size);
+    void avWrite(OutputFile * file, uint8_t *buf, int buf_size);
     static int avWrite(void *opaque, uint8_t *buf, int buf_size);
     static int64_t avSeek(void *opaque, int64_t offset, int whence);
-    int64_t avSeek(int64_t offset, int whence);
+    int64_t avSeek(OutputFile * file, int64_t offset, int whence);
     mm_status_t createContext();
     void releaseContext();
+    void releaseOutputFile(OutputFile * file);
+    bool rotateFile(int64_t startUs);
+    void finalizeFile(OutputFile * file);
     //bool addStream(StreamInfo * si);
     void stopInternal();
     void resetInternal();
-    MediaBufferSP createSinkBuffer(const uint8_t * buf, size_t size);
+    MediaBufferSP createSinkBuffer(OutputFile * file, const uint8_t * buf, size_t size);
     static bool releaseSinkBuffer(MediaBuffer* mediaBuffer);
     void sinkBufferReleased();
     bool writeHeader();
     bool writeTrailer();
     void signalEOS2Sink();
+    void signalSegment2Sink(int32_t index, bool end);
+    MediaBufferSP createMarkerBuffer(int32_t index);
+    void cutSegment(StreamInfo * si, bool keyFrame, int64_t timeUs);
+    void flushSegment();
+    int64_t segmentEndUs();
+    std::string codecsString();
+    mm_status_t limitReached(Component::EventInfo info);
     mm_status_t mux();
     MediaBufferSP getMinFirstBuffer_l();
+    MediaBufferSP preRollNext_l();
+    bool preRollAdd_l(const MediaBufferSP & buffer, StreamInfo * si);
+    void preRollTrim_l();
+    void preRollClear_l();
+    void triggerPreRoll();
 
 private:
     Lock mLock;
@@ -203,11 +272,9 @@ private:
     int64_t mMaxDuration;
     int64_t mMaxFileSize;
     int64_t mCurFileSize;
-    AVFormatContext * mAVFormatContext;
-    AVIOContext * mAVIOContext;
+    OutputFile * mOutputFile;
+    AVFormatContext * mAVFormatContext;     // of mOutputFile
     WriterSP mWriter;
-    int64_t mOutputSeekOffset;
-    int mOutputSeekWhence;
 #ifdef HAVE_EIS_AUDIO_DELAY
     bool mIsAudioDelay;
 #endif
@@ -226,6 +293,32 @@ private:
     bool mConvertH264ByteStreamToAvcc;
     int32_t mStreamDriftMax;
 
+    // pre-roll ring, copies of encoded buffers in mux order, it starts at a sync point
+    struct PreRollEntry {
+        MediaBufferSP mBuffer;
+        int64_t mTimeUs;
+        bool mSync;     // video key frame, any audio frame without video
+    };
+    std::deque<PreRollEntry> mPreRoll;
+    int64_t mPreRollBytes;
+    int64_t mPreRollDurationUs;     // 0: pre-roll off
+    int64_t mPreRollMaxBytes;
+    bool mPreRollTriggered;
+
+    // segmented recording, mMaxDuration/mMaxFileSize start the next file instead of stopping
+    bool mFileRotation;
+    bool mRotatePending;            // limit passed, rotate at the next sync point
+    FinalizeThread * mFinalizeThread;
+    int64_t mFileStartUs;           // time of the first buffer written, the file starts there
+
+    // live segmenting, one file cut in segments (and parts) at flushes, the sink names the files
+    int64_t mSegmentDurationUs;     // 0: off
+    int64_t mPartDurationUs;        // 0: no parts
+    int32_t mSegmentIndex;          // of the data written, -1: init data, before the first frame
+    int64_t mSegmentStartUs;
+    int64_t mPartStartUs;
+    bool mPartIndependent;          // the current part starts with a video key frame
+
     // MonitorSP mMonitorFPS;
 
     DECLARE_MSG_LOOP()
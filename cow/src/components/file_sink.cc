@@ -89,7 +89,6 @@ DEFINE_LOGTAG(FileSink::FileSinkWriter)
 //////////////////////////////////////////////////////////////////////////////////////////////////
 mm_status_t FileSink::FileSinkWriter::write(const MediaBufferSP &buffer) {
     ENTER1();
-    MMAutoLock locker(mSink->mLock);
     mm_status_t status = MM_ERROR_UNKNOWN;
 
     if (!buffer) {
@@ -97,6 +96,36 @@ mm_status_t FileSink::FileSinkWriter::write(const MediaBufferSP &buffer) {
     }
 
     MediaMetaSP meta = buffer->getMediaMeta();
+    int32_t segment = -1;
+    int32_t segmentEnd = 0;
+    if (meta->getInt32(MEDIA_ATTR_SEGMENT_INDEX, segment) &&
+        meta->getInt32(MEDIA_ATTR_SEGMENT_END, segmentEnd) && segmentEnd) {
+        status = mSink->completeSegment(segment);
+        FLEAVE_WITH_CODE(status);
+    }
+
+    MMAutoLock locker(mSink->mLock);
+    int fd = mSink->mFd;
+    uint32_t *frameCount = &mSink->mFrameCount;
+    if (segment >= 0 && mSink->mWriteMode == WMT_Record) {
+        if (segment > mSink->mSegmentIndex) {
+            status = mSink->nextSegment_l(segment);
+            if (status != MM_ERROR_SUCCESS || buffer->size() <= 0) {
+                FLEAVE_WITH_CODE(status);
+            }
+            fd = mSink->mFd;
+        } else if (segment < mSink->mSegmentIndex) {
+            // the trailer of a finished file
+            std::map<int32_t, Segment>::iterator it = mSink->mClosingSegments.find(segment);
+            if (it == mSink->mClosingSegments.end()) {
+                ERROR("segment %d is closed already\n", segment);
+                FLEAVE_WITH_CODE(MM_ERROR_IVALID_OPERATION);
+            }
+            fd = it->second.mFd;
+            frameCount = &it->second.mFrameCount;
+        }
+    }
+
     int64_t fileOffset = 0;
     int32_t fileWhence = 0;
 
@@ -108,8 +137,8 @@ mm_status_t FileSink::FileSinkWriter::write(const MediaBufferSP &buffer) {
             return MM_ERROR_IVALID_OPERATION;
         }
 
-        if (mSink->mFd >= 0){
-            int64_t result = ::lseek(mSink->mFd, fileOffset, fileWhence);
+        if (fd >= 0){
+            int64_t result = ::lseek(fd, fileOffset, fileWhence);
             if (result == -1) {
                 ERROR("seek to %" PRId64 " failed, whence %d", fileOffset, fileWhence);
                 FLEAVE_WITH_CODE(MM_ERROR_UNKNOWN);
@@ -159,9 +188,9 @@ mm_status_t FileSink::FileSinkWriter::write(const MediaBufferSP &buffer) {
     } else {
         int count = -1;
 
-        if (mSink->mFd >= 0 && sourceBuf && length) {
-            count = ::write(mSink->mFd, sourceBuf, length);
-            mSink->mFrameCount++;
+        if (fd >= 0 && sourceBuf && length) {
+            count = ::write(fd, sourceBuf, length);
+            (*frameCount)++;
 
             if (count == length) {
                 status = MM_ERROR_SUCCESS;
@@ -196,6 +225,7 @@ FileSink::FileSink(const char *mimeType, bool isEncoder)
                      , mPrefix(DEFAULT_PREFIX)
                      , mExtension(DEFAULT_EXTENSION)
                      , mCurrentPosition(-1ll)
+                     , mSegmentIndex(0)
 {
     ENTER();
     FLEAVE();
@@ -214,21 +244,11 @@ mm_status_t FileSink::start()
     ENTER();
 
     MMAutoLock locker(mLock);
+    mSegmentIndex = 0;
     if (mWriteMode == WMT_Record) {
         if (!mUrl.empty() && mFd < 0) {
-            int32_t count = 0;
             mFilePath = getMediaFileName(mUrl.c_str(), mPrefix, mExtension);
-            do {
-                mFd = ::open(mFilePath.c_str(), O_WRONLY | O_CREAT, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH);
-                // try if errno is 2/11/30
-                if (mFd < 0 && (errno == EAGAIN || errno == ENOENT || errno == EROFS)) {
-                    usleep(10*1000);
-                    ERROR("open failed and try, errno %d(%s), count %d", errno, strerror(errno), count);
-                } else {
-                    break;
-                }
-            } while(count++ < 50);
-
+            mFd = openRecordFile(mFilePath.c_str(), O_WRONLY | O_CREAT);
             if (mFd < 0) {
                 ERROR("fail to open file (%s, %s) to record, errno %d(%s)",
                     mUrl.c_str(), mFilePath.c_str(), errno, strerror(errno));
@@ -253,6 +273,13 @@ mm_status_t FileSink::stop() {
         ::close(mFd);
         mFd = -1;
     }
+    for (std::map<int32_t, Segment>::iterator it = mClosingSegments.begin(); it != mClosingSegments.end(); ++it) {
+        WARNING("segment %d (%s) not finished\n", it->first, it->second.mPath.c_str());
+        if (it->second.mFd >= 0) {
+            ::close(it->second.mFd);
+        }
+    }
+    mClosingSegments.clear();
     FLEAVE_WITH_CODE(MM_ERROR_SUCCESS);
 }
 
@@ -385,6 +412,107 @@ mm_status_t FileSink::writeSingleFile(uint8_t *buffer,int32_t bufferSize)
     FLEAVE_WITH_CODE(MM_ERROR_SUCCESS);
 }
 
+/*static*/ int FileSink::openRecordFile(const char *path, int flags)
+{
+    int32_t count = 0;
+    int fd;
+    do {
+        fd = ::open(path, flags, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH);
+        // try if errno is 2/11/30
+        if (fd < 0 && (errno == EAGAIN || errno == ENOENT || errno == EROFS)) {
+            usleep(10*1000);
+            ERROR("open failed and try, errno %d(%s), count %d", errno, strerror(errno), count);
+        } else {
+            break;
+        }
+    } while(count++ < 50);
+    return fd;
+}
+
+// a directory gets a new time stamped name, a file path "<name>_<index>.<ext>"
+std::string FileSink::getSegmentFileName(int32_t index)
+{
+    std::string path = getMediaFileName(mUrl.c_str(), mPrefix, mExtension);
+    if (path != mUrl) {
+        return path;
+    }
+
+    char suffix[16];
+    snprintf(suffix, sizeof(suffix), "_%d", index);
+    size_t dot = path.rfind('.');
+    size_t slash = path.rfind('/');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+        path.append(suffix);
+    } else {
+        path.insert(dot, suffix);
+    }
+    return path;
+}
+
+// the muxer starts the next file, the current one waits for its trailer
+mm_status_t FileSink::nextSegment_l(int32_t index)
+{
+    Segment &last = mClosingSegments[mSegmentIndex];
+    last.mFd = mFd;
+    last.mPath = mFilePath;
+    last.mFrameCount = mFrameCount;
+
+    mFd = -1;
+    mFrameCount = 0;
+    mSegmentIndex = index;
+    if (mUrl.empty()) {
+        ERROR("segment %d: file rotation needs a file path or directory, not a file handle\n", index);
+        notify(kEventError, MM_ERROR_IVALID_OPERATION, 0, nilParam);
+        return MM_ERROR_IVALID_OPERATION;
+    }
+
+    mFilePath = getSegmentFileName(index);
+    mFd = openRecordFile(mFilePath.c_str(), O_WRONLY | O_CREAT | O_TRUNC);
+    if (mFd < 0) {
+        ERROR("segment %d: fail to open %s, errno %d(%s)\n", index, mFilePath.c_str(), errno, strerror(errno));
+        notify(kEventError, MM_ERROR_NO_SUCH_FILE, 0, nilParam);
+        return MM_ERROR_NO_SUCH_FILE;
+    }
+    INFO("segment %d: %s\n", index, mFilePath.c_str());
+    return MM_ERROR_SUCCESS;
+}
+
+// sync and close a finished file, without mLock: the next file is written meanwhile
+mm_status_t FileSink::completeSegment(int32_t index)
+{
+    Segment segment;
+    {
+        MMAutoLock locker(mLock);
+        std::map<int32_t, Segment>::iterator it = mClosingSegments.find(index);
+        if (it == mClosingSegments.end()) {
+            ERROR("segment %d is not open\n", index);
+            return MM_ERROR_IVALID_OPERATION;
+        }
+        segment = it->second;
+        mClosingSegments.erase(it);
+    }
+
+    if (segment.mFd >= 0) {
+        if (::fsync(segment.mFd)) {
+            WARNING("segment %d: fsync failed, errno %d(%s)\n", index, errno, strerror(errno));
+        }
+        ::close(segment.mFd);
+    }
+    if (segment.mFrameCount == 0) {
+        INFO("segment %d: %s is empty, delete it\n", index, segment.mPath.c_str());
+        if (!segment.mPath.empty()) {
+            unlink(segment.mPath.c_str());
+        }
+        return MM_ERROR_SUCCESS;
+    }
+
+    INFO("segment %d completed: %s\n", index, segment.mPath.c_str());
+    MMParamSP param(new MMParam);
+    param->writeCString(segment.mPath.c_str());
+    notify(kEventInfo, kEventSegmentCompleted, index, param);
+    return MM_ERROR_SUCCESS;
+}
+
 int64_t FileSink::getCurrentPosition()
 {
     return mCurrentPosition;
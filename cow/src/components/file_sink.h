@@ -18,6 +18,7 @@
 #ifndef file_sink_h
 #define file_sink_h
 
+#include <map>
 #include <string>
 
 #include <multimedia/mm_cpp_utils.h>
@@ -56,6 +57,10 @@ private:
     static std::string getMediaFileName(const char*url, const char*prefix, const char*extension);
 
     mm_status_t writeSingleFile(uint8_t *buffer,int32_t bufferSize);
+    static int openRecordFile(const char *path, int flags);
+    std::string getSegmentFileName(int32_t index);
+    mm_status_t nextSegment_l(int32_t index);
+    mm_status_t completeSegment(int32_t index);
 
     class FileSinkWriter : public Writer {
     public:
@@ -93,6 +98,18 @@ private:
     int64_t mCurrentPosition;
     MediaMetaSP mMediaMeta;
 
+    // segmented recording (MEDIA_ATTR_SEGMENT_INDEX on the buffers): mFd is the file of mSegmentIndex,
+    // the files before it stay open for the muxer to finish them, they are synced and closed on
+    // MEDIA_ATTR_SEGMENT_END by the thread sending it, not the one writing the next file.
+    struct Segment {
+        Segment() : mFd(-1), mFrameCount(0) {}
+        int mFd;
+        std::string mPath;
+        uint32_t mFrameCount;
+    };
+    int32_t mSegmentIndex;
+    std::map<int32_t, Segment> mClosingSegments;
+
 private:
     MM_DISALLOW_COPY(FileSink);
 
@@ -53,22 +53,61 @@ END_MSG_LOOP()
 
 #define INTERNAL_QUEUE_CAPACITY     4
 
+static const char * META_SHARED_BUFFER = "fission-shared-buffer";
+
+// the views keep the original buffer, its release funcs run once no output uses the payload
+static bool releaseSharedBuffer(MediaBuffer * view)
+{
+    void * ptr = NULL;
+    if (view->getMediaMeta()->getPointer(META_SHARED_BUFFER, ptr) && ptr) {
+        delete static_cast<MediaBufferSP*>(ptr);
+    }
+    return true;
+}
+
+// view of an encoded buffer for one output: the same payload, its own header and meta.
+// outputs tag the meta (muxer stream info, segment index) and attach traffic trackers
+// to the buffer, those must not reach the other outputs.
+static MediaBufferSP shareBuffer(const MediaBufferSP & buffer)
+{
+    MediaBufferSP view = MediaBuffer::createMediaBuffer(buffer->type());
+    uintptr_t buffers[MediaBufferMaxDataPlane];
+    int32_t offsets[MediaBufferMaxDataPlane];
+    int32_t strides[MediaBufferMaxDataPlane];
+    if (buffer->getBufferInfo(buffers, offsets, strides, MediaBufferMaxDataPlane)) {
+        view->setBufferInfo(buffers, offsets, strides, MediaBufferMaxDataPlane);
+    }
+    for (int flag = 0; flag < MediaBuffer::MBFT_LAST; flag++) {
+        MediaBuffer::MediaBufferFlagType type = (MediaBuffer::MediaBufferFlagType)flag;
+        if (type != MediaBuffer::MBFT_BufferInited && buffer->isFlagSet(type))
+            view->setFlag(type);
+    }
+    view->setSize(buffer->size());
+    view->setPts(buffer->pts());
+    view->setDts(buffer->dts());
+    view->setDuration(buffer->duration());
+    view->setBirthTimeInMs(buffer->birthTimeInMs());
+
+    MediaMetaSP meta = buffer->getMediaMeta()->copy();
+    meta->setPointer(META_SHARED_BUFFER, new MediaBufferSP(buffer));
+    view->setMediaMeta(meta);
+    view->addReleaseBufferFunc(releaseSharedBuffer);
+    return view;
+}
+
 ///////////////////////// OutBufferQueue
-MediaFission::OutBufferQueue::OutBufferQueue(uint32_t maxQSize)
+MediaFission::OutBufferQueue::OutBufferQueue(uint32_t maxQSize, bool dropOnFull)
     : mTraffic(new TrafficControl(1, maxQSize, "OutBufferQueue"))
+    , mDropOnFull(dropOnFull)
+    , mWaitKeyFrame(false)
+    , mDroppedCount(0)
     , MM_LOG_TAG(COMPONENT_NAME)
 {
     FUNC_TRACK();
 }
-void MediaFission::OutBufferQueue::pushBuffer(MediaBufferSP buffer)
+void MediaFission::OutBufferQueue::waitOnFull()
 {
     FUNC_TRACK();
-    struct BufferTracker bt;
-
-    if (!buffer) {
-        ERROR("empty buffer");
-        return;
-    }
     // in MediaFission::stop (not onStop), calls unblockWait()
     TrafficControl * traffic = DYNAMIC_CAST<TrafficControl*>(mTraffic.get());
     if(!traffic) {
@@ -77,7 +116,18 @@ void MediaFission::OutBufferQueue::pushBuffer(MediaBufferSP buffer)
     }
 
     traffic->waitOnFull();
+}
+
+// the caller waits for room (or drops) before
+void MediaFission::OutBufferQueue::pushBuffer(MediaBufferSP buffer)
+{
+    FUNC_TRACK();
+    struct BufferTracker bt;
 
+    if (!buffer) {
+        ERROR("empty buffer");
+        return;
+    }
     bt.mBuffer = buffer;
     bt.mTracker = Tracker::create(mTraffic);
     mBuffers.push(bt);
@@ -125,6 +175,24 @@ bool MediaFission::OutBufferQueue::isFull()
     return traffic->isFull();
 }
 
+bool MediaFission::OutBufferQueue::admit(const MediaBufferSP & buffer, bool isVideo)
+{
+    FUNC_TRACK();
+    if (buffer->isFlagSet(MediaBuffer::MBFT_EOS) || buffer->isFlagSet(MediaBuffer::MBFT_CodecData))
+        return true;
+
+    if ((mWaitKeyFrame && isVideo && !buffer->isFlagSet(MediaBuffer::MBFT_KeyFrame)) || isFull()) {
+        if (!mWaitKeyFrame)
+            INFO("output queue full, drop %s", isVideo ? "up to the next key frame" : "");
+        mWaitKeyFrame = true;
+        mDroppedCount++;
+        return false;
+    }
+
+    mWaitKeyFrame = false;
+    return true;
+}
+
 //////////////////////// FissionReader
 MediaFission::FissionReader::FissionReader(MediaFission * from, uint32_t index)
     : mComponent(from)
@@ -154,6 +222,7 @@ mm_status_t MediaFission::FissionReader::read(MediaBufferSP & buffer)
     DEBUG("FissionReader mOutputBufferCount: %d", mComponent->mOutputBufferCount);
     DEBUG("mComponent->mBufferQueues.size(): %zu, mIndex: %d", mComponent->mBufferQueues.size(), mIndex);
 
+    MMAutoLock locker(mComponent->mLock);
     MediaBufferSP buf = mComponent->mBufferQueues[mIndex].frontBuffer();
 
     if (!buf) {
@@ -178,9 +247,10 @@ MediaMetaSP MediaFission::FissionReader::getMetaData()
 // ////////////////////// PushDataThread
 class MediaFission::PushDataThread : public MMThread {
   public:
-    PushDataThread(MediaFission * fission)
+    PushDataThread(MediaFission * fission, uint32_t index)
         : MMThread(MMTHREAD_NAME)
         , mFission(fission)
+        , mIndex(index)
         , mContinue(true)
         , MM_LOG_TAG(COMPONENT_NAME)
     {
@@ -218,6 +288,7 @@ class MediaFission::PushDataThread : public MMThread {
   private:
     Lock mLock;
     MediaFission * mFission;
+    uint32_t mIndex;    // of mFission->mMasterWriters
     // FIXME, define a class for sem_t, does init/destroy automatically
     sem_t mSem;         // cork/uncork on pause/resume
     // FIXME, change to something like mExit
@@ -245,28 +316,28 @@ void MediaFission::PushDataThread::main()
             continue;
         }
 
-        // push data downstream
-        uint32_t i=0;
-        DEBUG("mMasterWriters.size(): %zu, mBufQueIndex: %d, ", mFission->mMasterWriters.size(), mFission->mMasterWriters[i].mBufQueIndex);
-        for (i=0; i<mFission->mMasterWriters.size(); i++) {
-            // FIXME, consider mWriter->writer() fail, we may need front()/pop()
-            MediaBufferSP buf = mFission->mBufferQueues[mFission->mMasterWriters[i].mBufQueIndex].frontBuffer();
-            if (buf) {
-                mm_status_t st = mFission->mMasterWriters[i].mWriter->write(buf);
-                if (st == MM_ERROR_SUCCESS) {
-                    mFission->mMasterWriters[i].mOutputBufferCount++;
-                    DEBUG("%s, mOutputBufferCount: %d, timestamp: (%" PRId64 ",%" PRId64 "), buffer age: %d", mFission->mMime.c_str(), mFission->mMasterWriters[i].mOutputBufferCount, buf->dts(), buf->pts(), buf->ageInMs());
-                    mFission->mBufferQueues[mFission->mMasterWriters[i].mBufQueIndex].popBuffer();
-                } else if (st == MM_ERROR_AGAIN) {
-                    if (mFission->mMime.c_str()) // FIXME, why NULL?
-                        DEBUG("%s, too fast, have a rest. mOutputBufferCount: %d", mFission->mMime.c_str(), mFission->mMasterWriters[i].mOutputBufferCount);
-                    // FIXME: for multiple output, we should sleep for current one only
-                    usleep(5000);
-                } else
-                    ERROR("fail to push buffer to downlink component");
-            } else
-                usleep(5000);
+        // push data downstream, a slow downlink component only holds its own queue
+        MasterWriter & writer = mFission->mMasterWriters[mIndex];
+        OutBufferQueue & queue = mFission->mBufferQueues[writer.mBufQueIndex];
+        MediaBufferSP buf;
+        {
+            MMAutoLock locker(mFission->mLock);
+            buf = queue.frontBuffer();
         }
+        if (buf) {
+            mm_status_t st = writer.mWriter->write(buf);
+            if (st == MM_ERROR_SUCCESS) {
+                writer.mOutputBufferCount++;
+                DEBUG("%s, mOutputBufferCount: %d, timestamp: (%" PRId64 ",%" PRId64 "), buffer age: %d", mFission->mMime.c_str(), writer.mOutputBufferCount, buf->dts(), buf->pts(), buf->ageInMs());
+                MMAutoLock locker(mFission->mLock);
+                queue.popBuffer();
+            } else if (st == MM_ERROR_AGAIN) {
+                DEBUG("%s, too fast, have a rest. mOutputBufferCount: %d", mFission->mMime.c_str(), writer.mOutputBufferCount);
+                usleep(5000);
+            } else
+                ERROR("fail to push buffer to downlink component");
+        } else
+            usleep(5000);
     }
 
     INFO("Poll thread exited\n");
@@ -293,16 +364,20 @@ mm_status_t MediaFission::FissionWriter::write(const MediaBufferSP &buffer) {
     DEBUG("mBufferQueues.size(): %zu", mFission->mBufferQueues.size());
 
     uint32_t i=0;
-    // check whether the buffer queue is full or not
+    // check whether the buffer queue is full or not, dropping queues don't hold the input
     for (i=0; i<mFission->mBufferQueues.size(); i++) {
-        if (mFission->mBufferQueues[i].isFull())
+        if (!mFission->mBufferQueues[i].dropOnFull() && mFission->mBufferQueues[i].isFull())
             return MM_ERROR_AGAIN;
     }
 
     // push buffer to the buffer queues, to be read by downlink components
     // if output port pushes data acvtively, the PushDataThread will handle it
+    bool share = mFission->mBufferQueues.size() > 1 && buffer->type() == MediaBuffer::MBT_ByteBuffer;
     for (i=0; i<mFission->mBufferQueues.size(); i++) {
-        mFission->mBufferQueues[i].pushBuffer(buffer);
+        OutBufferQueue & queue = mFission->mBufferQueues[i];
+        if (queue.dropOnFull() && !queue.admit(buffer, mFission->mIsVideo))
+            continue;
+        queue.pushBuffer(share ? shareBuffer(buffer) : buffer);
     }
 
     mFission->mInputBufferCount++;
@@ -315,6 +390,10 @@ mm_status_t MediaFission::FissionWriter::setMetaData(const MediaMetaSP & metaDat
     FUNC_TRACK();
     MMAutoLock locker(mFission->mLock);
     mFission->mFormat->merge(metaData);
+    // format updated after the downlink components are connected
+    for (uint32_t i=0; i<mFission->mMasterWriters.size(); i++) {
+        mFission->mMasterWriters[i].mWriter->setMetaData(mFission->mFormat);
+    }
     return  MM_ERROR_SUCCESS;
 }
 
@@ -327,6 +406,8 @@ MediaFission::MediaFission(const char* mimeType, bool isEncoder)
     , mEosState(kNoneEOS)
     , mInputMaster(true)
     , mBufferCapacity(INTERNAL_QUEUE_CAPACITY)
+    , mDropOnFull(false)
+    , mIsVideo(false)
     , mInputBufferCount(0)
     , mOutputBufferCount(0)
     , MM_LOG_TAG(COMPONENT_NAME)
@@ -366,6 +447,7 @@ Component::WriterSP MediaFission::getWriter(MediaType mediaType)
            return writer;
        }
 
+   mIsVideo = (int)mediaType == Component::kMediaTypeVideo;
    // return writer.reset(new MediaFission::FissionWriter(this));
    FissionWriter* w = new MediaFission::FissionWriter(this);
    writer.reset(w);
@@ -437,6 +519,7 @@ mm_status_t MediaFission::addSource(Component * component, MediaType mediaType)
 {
     FUNC_TRACK();
     mReader = component->getReader(mediaType);
+    mIsVideo = (int)mediaType == Component::kMediaTypeVideo;
     if (mReader) {
         mFormat->merge(mReader->getMetaData());
 
@@ -464,15 +547,14 @@ mm_status_t MediaFission::addSink(Component * component, MediaType mediaType)
         if (mFormat)
             mFormat->dump();
         writer->setMetaData(mFormat);
-        mBufferQueues.push_back(OutBufferQueue(mBufferCapacity));
-        DEBUG("mBufferQueues.size(): %zu", mBufferQueues.size());
+        mBufferQueues.push_back(OutBufferQueue(mBufferCapacity, mDropOnFull));
+        DEBUG("mBufferQueues.size(): %zu, capacity %u, drop %d", mBufferQueues.size(), mBufferCapacity, mDropOnFull);
         MasterWriter mw (writer, mBufferQueues.size()-1);
         mMasterWriters.push_back(mw);
-        if (!mPushThread) {
-            mPushThread.reset(new PushDataThread(this));
-            if (mPushThread) {
-                mPushThread->create();
-            }
+        PushDataThreadSP thread(new PushDataThread(this, mMasterWriters.size()-1));
+        if (thread) {
+            thread->create();
+            mPushThreads.push_back(thread);
         }
         return MM_ERROR_SUCCESS;
     }
@@ -526,8 +608,8 @@ void MediaFission::onStart(param1_type param1, param2_type param2, uint32_t rspI
 
     mState = kStatePlaying;
     DEBUG("signal output thread to continue");
-    if (mPushThread) {
-        mPushThread->signalContinue();
+    for (uint32_t i=0; i<mPushThreads.size(); i++) {
+        mPushThreads[i]->signalContinue();
     }
 }
 
@@ -553,9 +635,16 @@ void MediaFission::onHandleInputBuffer(param1_type param1, param2_type param2, u
         uint32_t i=0;
         mInputBufferCount++;
         DEBUG("mBufferQueues.size(): %zu", mBufferQueues.size());
+        bool share = mBufferQueues.size() > 1 && buffer->type() == MediaBuffer::MBT_ByteBuffer;
         for (i=0; i<mBufferQueues.size(); i++) {
+            OutBufferQueue & queue = mBufferQueues[i];
             // FIXME, it may be blocked when buffer queue is full
-            mBufferQueues[i].pushBuffer(buffer);
+            if (!queue.dropOnFull())
+                queue.waitOnFull();
+            MMAutoLock locker(mLock);
+            if (queue.dropOnFull() && !queue.admit(buffer, mIsVideo))
+                continue;
+            queue.pushBuffer(share ? shareBuffer(buffer) : buffer);
         }
     } else {
         usleep(5000);
@@ -590,14 +679,17 @@ void MediaFission::onResume(param1_type param1, param2_type param2, uint32_t rsp
 
     setState(kStatePlaying);
     notify(kEventResumed, MM_ERROR_SUCCESS, 0, nilParam);
-    mPushThread->signalContinue();
+    for (uint32_t i=0; i<mPushThreads.size(); i++) {
+        mPushThreads[i]->signalContinue();
+    }
 }
 
 void MediaFission::clearInternalBuffers()
 {
     FUNC_TRACK();
     uint32_t i=0;
-    // if MMMsgThread is blocked by pushBuffer() to mBufferQueues, it will be unblocked for the following popBuffer().
+    MMAutoLock locker(mLock);
+    // if MMMsgThread is blocked by waitOnFull() of mBufferQueues, it will be unblocked for the following popBuffer().
     for (i=0; i<mBufferQueues.size(); i++) {
         while (mBufferQueues[i].frontBuffer())
             mBufferQueues[i].popBuffer();
@@ -616,9 +708,14 @@ void MediaFission::onStop(param1_type param1, param2_type param2, uint32_t rspId
     }
 
     setState(kStateStopping);
-    if (mPushThread) {
-        mPushThread->signalExit();
-        mPushThread.reset(); // it will trigger MMThread::destroy() to wait until the exit of mPushThread
+    for (uint32_t i=0; i<mPushThreads.size(); i++) {
+        mPushThreads[i]->signalExit();
+    }
+    mPushThreads.clear(); // it will trigger MMThread::destroy() to wait until the exit of the threads
+
+    for (uint32_t i=0; i<mMasterWriters.size(); i++) {
+        INFO("output %u: %u buffers, %u dropped", i, mMasterWriters[i].mOutputBufferCount,
+            mBufferQueues[mMasterWriters[i].mBufQueIndex].droppedCount());
     }
 
     clearInternalBuffers();
@@ -641,7 +738,7 @@ void MediaFission::onReset(param1_type param1, param2_type param2, uint32_t rspI
 {
     FUNC_TRACK();
 
-    // FIXME, onStop wait until the pthread_join of mPushThread
+    // FIXME, onStop wait until the pthread_join of mPushThreads
     onStop(param1, param2, rspId);
 
     notify(kEventResetComplete, MM_ERROR_SUCCESS, 0, nilParam);
@@ -676,19 +773,22 @@ mm_status_t MediaFission::setParameter(const MediaMetaSP & meta)
     for ( MediaMeta::iterator i = meta->begin(); i != meta->end(); ++i ) {
         const MediaMeta::MetaItem & item = *i;
 
-#if 0
-        if ( !strcmp(item.mName, "queue-size") ) {
+        // for the sinks added later
+        if ( !strcmp(item.mName, MEDIA_ATTR_OUTPUT_QUEUE_SIZE) ) {
+            if ( item.mType != MediaMeta::MT_Int32 || item.mValue.ii <= 0) {
+                MMLOGW("invalid type or value for %s\n", item.mName);
+                continue;
+            }
+            mBufferCapacity = item.mValue.ii;
+            MMLOGI("key: %s, value: %d\n", item.mName, item.mValue.ii);
+        } else if ( !strcmp(item.mName, MEDIA_ATTR_OUTPUT_DROP) ) {
             if ( item.mType != MediaMeta::MT_Int32) {
                 MMLOGW("invalid type for %s\n", item.mName);
                 continue;
             }
-            mBufferCapacity = item.mValue.ui;
-            TrafficControl * traffic = DYNAMIC_CAST<TrafficControl*>(mTraffic.get());
-            traffic->updateHighBar(mBufferCapacity);
-            MMLOGI("key: %s, value: %d\n", item.mName, item.mValue.ui);
-        } else
-#endif
-        if ( !strcmp(item.mName, "comp-name") ) {
+            mDropOnFull = item.mValue.ii != 0;
+            MMLOGI("key: %s, value: %d\n", item.mName, item.mValue.ii);
+        } else if ( !strcmp(item.mName, "comp-name") ) {
             if ( item.mType != MediaMeta::MT_String) {
                 MMLOGW("invalid type for %s\n", item.mName);
                 continue;
@@ -26,17 +26,30 @@
 
 namespace YUNOS_MM {
 
+/*
+ * tee: every input buffer goes to all downlink components, each one has its own queue.
+ * "output-queue-size" and "output-drop" apply to the sinks added after them: a full queue of a
+ * blocking output (default) holds the input, a dropping one drops buffers for its output only
+ * (video up to the next key frame); EOS and codec data are never dropped.
+ * encoded buffers (MBT_ByteBuffer) go to several outputs as views, they share the payload but
+ * each output gets its own MediaBuffer and meta to tag.
+ */
 class MediaFission : public FilterComponent, public MMMsgThread {
   private: // ////// internal classes
     class OutBufferQueue {
       public:
-        OutBufferQueue(uint32_t maxQSize);
+        OutBufferQueue(uint32_t maxQSize, bool dropOnFull = false);
         ~OutBufferQueue(){}
+        void waitOnFull();
         void pushBuffer(MediaBufferSP buffer);
         MediaBufferSP frontBuffer();
         void popBuffer();
         void unblockWait();
         bool isFull();
+        bool dropOnFull() const { return mDropOnFull; }
+        // drop policy: false when the buffer is dropped for this queue
+        bool admit(const MediaBufferSP & buffer, bool isVideo);
+        uint32_t droppedCount() const { return mDroppedCount; }
 
       private:
         MonitorSP mTraffic;
@@ -45,6 +58,9 @@ class MediaFission : public FilterComponent, public MMMsgThread {
             TrackerSP mTracker;
         };
         std::queue<BufferTracker> mBuffers;
+        bool mDropOnFull;       // a full queue drops input instead of holding it
+        bool mWaitKeyFrame;     // video dropped, resume at the next key frame
+        uint32_t mDroppedCount;
         const char* MM_LOG_TAG;
     };
     std::vector<OutBufferQueue> mBufferQueues;
@@ -79,7 +95,7 @@ class MediaFission : public FilterComponent, public MMMsgThread {
         std::string mLogTag;
         const char * MM_LOG_TAG;
     };
-    // output in master mode: push data to downlink components
+    // output in master mode: push data to downlink components, one thread per downlink component
     class PushDataThread;
     typedef MMSharedPtr <PushDataThread> PushDataThreadSP;
 
@@ -144,13 +160,15 @@ class MediaFission : public FilterComponent, public MMMsgThread {
     ReaderSP mReader;
     MediaMetaSP mFormat;
 
-    uint32_t mBufferCapacity;
+    uint32_t mBufferCapacity;   // of the next output queue
+    bool mDropOnFull;           // of the next output queue
+    bool mIsVideo;
 
     // output in slave mode
     // FIXME, should we keep one reference of these Readers? it may help to differentiate stop() and reset() well.
     // std::vector<FissionReader> mReaders;
     // output in master mode
-    PushDataThreadSP mPushThread;
+    std::vector<PushDataThreadSP> mPushThreads;
     class MasterWriter {
       public:
         MasterWriter(WriterSP writer, uint32_t idx)
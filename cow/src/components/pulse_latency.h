@@ -0,0 +1,101 @@
+/**
+ * Copyright (C) 2017 Alibaba Group Holding Limited. All Rights Reserved.
+ *
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef pulse_latency_h
+#define pulse_latency_h
+
+#include <pthread.h>
+#include <sched.h>
+#include <errno.h>
+#include <pulse/sample.h>
+#include <pulse/def.h>
+
+// latency profile shared by AudioSinkPulse and AudioSrcPulse, see MEDIA_ATTR_AUDIO_LATENCY_MODE
+namespace YUNOS_MM {
+
+enum AudioLatencyMode {
+    kAudioLatencyDefault = 0,
+    kAudioLatencyLow,           // small tlength/fragsize, period sized writes/reads
+    kAudioLatencyPowerSaving,   // large buffers, fewer wakeups
+};
+
+#define AUDIO_LOW_LATENCY_TARGET_MS         20
+#define AUDIO_LOW_LATENCY_MIN_MS            5
+#define AUDIO_LOW_LATENCY_MAX_MS            100
+#define AUDIO_POWER_SAVING_TARGET_MS        2000
+
+static inline int32_t pulseLatencyTargetMs(int32_t mode, int32_t targetMs)
+{
+    if (mode == kAudioLatencyPowerSaving)
+        return targetMs > 0 ? targetMs : AUDIO_POWER_SAVING_TARGET_MS;
+    if (targetMs <= 0)
+        return AUDIO_LOW_LATENCY_TARGET_MS;
+    if (targetMs < AUDIO_LOW_LATENCY_MIN_MS)
+        return AUDIO_LOW_LATENCY_MIN_MS;
+    if (targetMs > AUDIO_LOW_LATENCY_MAX_MS)
+        return AUDIO_LOW_LATENCY_MAX_MS;
+    return targetMs;
+}
+
+/*
+ * fill the buffer attributes of a non default latency mode.
+ * playback: tlength is the target, the server asks for data in minreq sized periods
+ *   (half of the target for low latency, a quarter for power saving).
+ * record: fragsize is the target.
+ * returns the stream flags to add to the connect call.
+ */
+static inline pa_stream_flags_t pulseLatencyBufferAttr(int32_t mode, int32_t targetMs,
+        const pa_sample_spec *spec, bool playback, pa_buffer_attr *attr)
+{
+    uint32_t target = (uint32_t)pa_usec_to_bytes(PA_USEC_PER_MSEC * pulseLatencyTargetMs(mode, targetMs), spec);
+    attr->maxlength = (uint32_t)-1;
+    attr->tlength = (uint32_t)-1;
+    attr->prebuf = (uint32_t)-1;
+    attr->minreq = (uint32_t)-1;
+    attr->fragsize = (uint32_t)-1;
+
+    if (playback) {
+        attr->tlength = target;
+        attr->minreq = (uint32_t)pa_frame_align(target / (mode == kAudioLatencyLow ? 2 : 4), spec);
+        // start as soon as one period is queued
+        attr->prebuf = attr->minreq;
+    } else {
+        attr->fragsize = target;
+    }
+
+    return mode == kAudioLatencyLow ? PA_STREAM_ADJUST_LATENCY : PA_STREAM_NOFLAGS;
+}
+
+// returns 0 or the errno of pthread_setschedparam, usually EPERM without CAP_SYS_NICE/rtkit
+static inline int audioThreadSetRealtime(int32_t priority)
+{
+    if (priority <= 0)
+        return 0;
+    struct sched_param param;
+    param.sched_priority = priority;
+    int min = sched_get_priority_min(SCHED_FIFO);
+    int max = sched_get_priority_max(SCHED_FIFO);
+    if (param.sched_priority < min)
+        param.sched_priority = min;
+    if (param.sched_priority > max)
+        param.sched_priority = max;
+    return pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+}
+
+}
+
+#endif // pulse_latency_h
@@ -0,0 +1,686 @@
+/**
+ * Copyright (C) 2017 Alibaba Group Holding Limited. All Rights Reserved.
+ *
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <multimedia/mmparam.h>
+#include <multimedia/media_meta.h>
+#include <multimedia/media_buffer.h>
+
+#include "multimedia/media_attr_str.h"
+#include "segmenter_sink.h"
+
+#ifndef MM_LOG_OUTPUT_V
+//#define MM_LOG_OUTPUT_V
+#endif
+#include <multimedia/mm_debug.h>
+
+
+namespace YUNOS_MM {
+
+DEFINE_LOGTAG(SegmenterSink)
+DEFINE_LOGTAG(SegmenterSink::SegmenterSinkWriter)
+
+
+#define ENTER() INFO(">>>\n")
+#define FLEAVE() do {INFO(" <<<\n"); return;}while(0)
+#define FLEAVE_WITH_CODE(_code) do {INFO("<<<(status: %d)\n", (_code)); return (_code);}while(0)
+
+#define ENTER1() VERBOSE(">>>\n")
+#define FLEAVE1() do {VERBOSE(" <<<\n"); return;}while(0)
+#define FLEAVE_WITH_CODE1(_code) do {VERBOSE("<<<(status: %d)\n", (_code)); return (_code);}while(0)
+
+static const char * PLAYLIST_NAME = "index.m3u8";
+static const char * MANIFEST_NAME = "manifest.mpd";
+static const char * INIT_NAME = "init.mp4";
+static const int64_t SEGMENT_DURATION_DEF = 6000000;
+static const int32_t LIST_SIZE_DEF = 6;
+// segments listed with their parts, behind the live edge
+static const size_t PART_SEGMENTS = 3;
+
+static std::string formatTime(time_t t)
+{
+    struct tm tm;
+    char str[32];
+    gmtime_r(&t, &tm);
+    strftime(str, sizeof(str), "%Y-%m-%dT%H:%M:%SZ", &tm);
+    return str;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+mm_status_t SegmenterSink::SegmenterSinkWriter::write(const MediaBufferSP &buffer) {
+    ENTER1();
+    if (!buffer) {
+        FLEAVE_WITH_CODE1(MM_ERROR_INVALID_PARAM);
+    }
+
+    mm_status_t status = mSink->write(buffer);
+    FLEAVE_WITH_CODE1(status);
+}
+
+mm_status_t SegmenterSink::SegmenterSinkWriter::setMetaData(const MediaMetaSP & metaData) {
+    ENTER1();
+    FLEAVE_WITH_CODE1(MM_ERROR_SUCCESS);
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+SegmenterSink::SegmenterSink(const char *mimeType, bool isEncoder)
+                     : mFragmented(true)
+                     , mSegmentDurationUs(SEGMENT_DURATION_DEF)
+                     , mPartDurationUs(0)
+                     , mListSize(LIST_SIZE_DEF)
+                     , mFd(-1)
+                     , mInitFd(-1)
+                     , mInitSize(0)
+                     , mStreamPos(0)
+                     , mMaxDurationUs(0)
+                     , mMaxPartDurationUs(0)
+                     , mAvailabilityStart(0)
+                     , mEnded(false)
+                     , mCurrentPosition(-1ll)
+{
+    ENTER();
+    FLEAVE();
+}
+
+SegmenterSink::~SegmenterSink() {
+    ENTER();
+    FLEAVE();
+}
+
+const char *SegmenterSink::name() const{
+    return "SegmenterSink";
+}
+
+mm_status_t SegmenterSink::prepare()
+{
+    ENTER();
+    FLEAVE_WITH_CODE(MM_ERROR_SUCCESS);
+}
+
+mm_status_t SegmenterSink::start()
+{
+    ENTER();
+
+    MMAutoLock locker(mLock);
+    if (mDir.empty()) {
+        ERROR("no output directory\n");
+        FLEAVE_WITH_CODE(MM_ERROR_IVALID_OPERATION);
+    }
+    if (mkdir(mDir.c_str(), 0755) && errno != EEXIST) {
+        ERROR("fail to create %s, errno %d(%s)\n", mDir.c_str(), errno, strerror(errno));
+        FLEAVE_WITH_CODE(MM_ERROR_NO_SUCH_FILE);
+    }
+
+    clear_l();
+    if (mFragmented) {
+        std::string path = mDir + INIT_NAME;
+        mInitFd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (mInitFd < 0) {
+            ERROR("fail to open %s, errno %d(%s)\n", path.c_str(), errno, strerror(errno));
+            FLEAVE_WITH_CODE(MM_ERROR_NO_SUCH_FILE);
+        }
+    }
+    INFO("%s segments in %s, %" PRId64 " ms, parts %" PRId64 " ms, list %d\n", mFragmented ? "fmp4" : "ts",
+        mDir.c_str(), mSegmentDurationUs / 1000, mPartDurationUs / 1000, mListSize);
+    FLEAVE_WITH_CODE(MM_ERROR_SUCCESS);
+}
+
+mm_status_t SegmenterSink::stop() {
+    ENTER();
+
+    MMAutoLock locker(mLock);
+    if (mCurrent.mIndex >= 0) {
+        WARNING("segment %d not finished\n", mCurrent.mIndex);
+    }
+    closeSegment_l();
+    if (mInitFd >= 0) {
+        ::close(mInitFd);
+        mInitFd = -1;
+    }
+    FLEAVE_WITH_CODE(MM_ERROR_SUCCESS);
+}
+
+mm_status_t SegmenterSink::reset() {
+    ENTER();
+    FLEAVE_WITH_CODE(MM_ERROR_SUCCESS);
+}
+
+mm_status_t SegmenterSink::flush() {
+    ENTER();
+    FLEAVE_WITH_CODE(MM_ERROR_SUCCESS);
+}
+
+mm_status_t SegmenterSink::setParameter(const MediaMetaSP & meta) {
+    ENTER();
+
+    MMAutoLock locker(mLock);
+    for ( MediaMeta::iterator i = meta->begin(); i != meta->end(); ++i ) {
+        const MediaMeta::MetaItem & item = *i;
+        if ( !strcmp(item.mName, MEDIA_ATTR_FILE_PATH) ) {
+            if ( item.mType != MediaMeta::MT_String ) {
+                WARNING("invalid type for %s\n", item.mName);
+                continue;
+            }
+
+            mDir = item.mValue.str;
+            if (!mDir.empty() && mDir[mDir.size() - 1] != '/') {
+                mDir.append("/");
+            }
+            DEBUG("key: %s, value: %s\n", item.mName, mDir.c_str());
+            continue;
+        } else if ( !strcmp(item.mName, MEDIA_ATTR_OUTPUT_FORMAT) ) {
+            if ( item.mType != MediaMeta::MT_String ) {
+                WARNING("invalid type for %s\n", item.mName);
+                continue;
+            }
+
+            mFragmented = strcmp(item.mValue.str, "mpegts") && strcmp(item.mValue.str, "hls");
+            DEBUG("key: %s, value: %s\n", item.mName, item.mValue.str);
+            continue;
+        } else if ( !strcmp(item.mName, MEDIA_ATTR_SEGMENT_DURATION) ||
+                    !strcmp(item.mName, MEDIA_ATTR_SEGMENT_PART_DURATION) ||
+                    !strcmp(item.mName, MEDIA_ATTR_SEGMENT_LIST_SIZE) ) {
+            if ( item.mType != MediaMeta::MT_Int32 || item.mValue.ii < 0 ) {
+                WARNING("invalid type or value for %s\n", item.mName);
+                continue;
+            }
+
+            if ( !strcmp(item.mName, MEDIA_ATTR_SEGMENT_DURATION) ) {
+                if (item.mValue.ii > 0)
+                    mSegmentDurationUs = item.mValue.ii * 1000ll;
+            } else if ( !strcmp(item.mName, MEDIA_ATTR_SEGMENT_PART_DURATION) ) {
+                mPartDurationUs = item.mValue.ii * 1000ll;
+            } else {
+                mListSize = item.mValue.ii > 0 ? item.mValue.ii : LIST_SIZE_DEF;
+            }
+            DEBUG("key: %s, value: %d\n", item.mName, item.mValue.ii);
+            continue;
+        }
+    }
+
+    if (mPartDurationUs >= mSegmentDurationUs) {
+        mPartDurationUs = 0;
+    }
+    FLEAVE_WITH_CODE(MM_ERROR_SUCCESS);
+}
+
+Component::WriterSP SegmenterSink::getWriter(MediaType mediaType) {
+    ENTER();
+    if ( (int)mediaType != Component::kMediaTypeVideo &&
+        (int)mediaType != Component::kMediaTypeAudio) {
+        ERROR("not supported mediatype: %d\n", mediaType);
+        return Component::WriterSP((Component::Writer*)NULL);
+    }
+
+    return Component::WriterSP(new SegmenterSink::SegmenterSinkWriter(this));
+}
+
+int64_t SegmenterSink::getCurrentPosition()
+{
+    return mCurrentPosition;
+}
+
+void SegmenterSink::clear_l()
+{
+    closeSegment_l();
+    if (mInitFd >= 0) {
+        ::close(mInitFd);
+        mInitFd = -1;
+    }
+    mInitSize = 0;
+    mInitData.clear();
+    mCodecs.clear();
+    mStreamPos = 0;
+    mSegments.clear();
+    mMaxDurationUs = 0;
+    mMaxPartDurationUs = 0;
+    mAvailabilityStart = 0;
+    mEnded = false;
+    mCurrentPosition = -1ll;
+}
+
+// buffers of AVMuxer: data tagged with its segment (-1: init), markers without data
+mm_status_t SegmenterSink::write(const MediaBufferSP & buffer)
+{
+    std::string completed;
+    int32_t index = -1;
+    {
+        MMAutoLock locker(mLock);
+        if (buffer->isFlagSet(MediaBuffer::MBFT_EOS)) {
+            if (mCurrent.mIndex >= 0) {
+                WARNING("segment %d not finished at eos, dropped\n", mCurrent.mIndex);
+                closeSegment_l();
+            }
+            if (mInitFd >= 0) {
+                ::close(mInitFd);
+                mInitFd = -1;
+            }
+            mEnded = true;
+            if (!mSegments.empty()) {
+                writePlaylist_l();
+                if (mFragmented) {
+                    writeManifest_l();
+                }
+            }
+            INFO("Notify kEventEOS, %zu segments listed\n", mSegments.size());
+            notify(kEventEOS, 0, 0, nilParam);
+            return MM_ERROR_EOS;
+        }
+
+        MediaMetaSP meta = buffer->getMediaMeta();
+        if (!meta->getInt32(MEDIA_ATTR_SEGMENT_INDEX, index)) {
+            // the muxer trailer, after the last segment
+            VERBOSE("%" PRId64 " bytes out of segments, dropped\n", buffer->size());
+            return MM_ERROR_SUCCESS;
+        }
+
+        int32_t flag = 0;
+        if (meta->getInt32(MEDIA_ATTR_SEGMENT_END, flag) && flag) {
+            if (index >= 0) {
+                if (!endSegment_l(buffer, completed)) {
+                    return MM_ERROR_SUCCESS;
+                }
+            } else {
+                const char * codecs = NULL;
+                if (meta->getString(MEDIA_ATTR_SEGMENT_CODECS, codecs) && codecs) {
+                    mCodecs = codecs;
+                }
+                if (mInitFd >= 0) {
+                    ::close(mInitFd);
+                    mInitFd = -1;
+                }
+                INFO("init data: %" PRId64 " bytes, codecs %s\n", mInitSize, mCodecs.c_str());
+                return MM_ERROR_SUCCESS;
+            }
+        } else if (meta->getInt32(MEDIA_ATTR_SEGMENT_PART, flag) && flag) {
+            endPart_l(buffer);
+            return MM_ERROR_SUCCESS;
+        } else {
+            return writeData_l(index, buffer);
+        }
+    }
+
+    MMParamSP param(new MMParam);
+    param->writeCString(completed.c_str());
+    notify(kEventInfo, kEventSegmentCompleted, index, param);
+    return MM_ERROR_SUCCESS;
+}
+
+mm_status_t SegmenterSink::writeData_l(int32_t index, const MediaBufferSP & buffer)
+{
+    uint8_t *data = NULL;
+    int32_t offset = 0, length = 0;
+    buffer->getBufferInfo((uintptr_t *)&data, &offset, &length, 1);
+    int64_t size = buffer->size();
+    if (!data || size <= 0) {
+        return MM_ERROR_SUCCESS;
+    }
+
+    if (index >= 0 && index != mCurrent.mIndex) {
+        mm_status_t status = openSegment_l(index);
+        if (status != MM_ERROR_SUCCESS) {
+            return status;
+        }
+    }
+
+    // the muxer seeks in its whole output, the file has its part of it
+    MediaMetaSP meta = buffer->getMediaMeta();
+    int64_t seekOffset = 0;
+    int32_t seekWhence = 0;
+    if (meta->getInt64(MEDIA_ATTR_SEEK_OFFSET, seekOffset) &&
+        meta->getInt32(MEDIA_ATTR_SEEK_WHENCE, seekWhence)) {
+        int64_t base = index >= 0 ? mCurrent.mBase : 0;
+        int fd = index >= 0 ? mFd : mInitFd;
+        if (seekWhence != SEEK_SET || seekOffset < base || fd < 0) {
+            ERROR("segment %d: unsupported seek to %" PRId64 ", whence %d\n", index, seekOffset, seekWhence);
+            return MM_ERROR_IVALID_OPERATION;
+        }
+        if (::lseek(fd, seekOffset - base, SEEK_SET) < 0) {
+            ERROR("segment %d: seek to %" PRId64 " failed\n", index, seekOffset);
+            return MM_ERROR_UNKNOWN;
+        }
+        mStreamPos = seekOffset;
+    }
+
+    if (index < 0) {
+        if (!mFragmented) {
+            mInitData.append((const char*)data, size);
+        } else if (mInitFd < 0 || ::write(mInitFd, data, size) != size) {
+            ERROR("fail to write init data, errno %d(%s)\n", errno, strerror(errno));
+            notify(kEventError, MM_ERROR_IO, 0, nilParam);
+            return MM_ERROR_IO;
+        }
+        mStreamPos += size;
+        if (mInitSize < mStreamPos) {
+            mInitSize = mStreamPos;
+        }
+        return MM_ERROR_SUCCESS;
+    }
+
+    if (mFd < 0 || ::write(mFd, data, size) != size) {
+        ERROR("segment %d: write failed, errno %d(%s)\n", index, errno, strerror(errno));
+        notify(kEventError, MM_ERROR_IO, 0, nilParam);
+        return MM_ERROR_IO;
+    }
+    mStreamPos += size;
+    if (mCurrent.mSize < mStreamPos - mCurrent.mBase) {
+        mCurrent.mSize = mStreamPos - mCurrent.mBase;
+    }
+    if (mCurrentPosition < buffer->dts()) {
+        mCurrentPosition = buffer->dts();
+    }
+    return MM_ERROR_SUCCESS;
+}
+
+mm_status_t SegmenterSink::openSegment_l(int32_t index)
+{
+    if (mCurrent.mIndex >= 0) {
+        WARNING("segment %d not finished, dropped\n", mCurrent.mIndex);
+        closeSegment_l();
+    }
+
+    std::string path = mDir + segmentName(index);
+    mFd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (mFd < 0) {
+        ERROR("segment %d: fail to open %s, errno %d(%s)\n", index, path.c_str(), errno, strerror(errno));
+        notify(kEventError, MM_ERROR_NO_SUCH_FILE, 0, nilParam);
+        return MM_ERROR_NO_SUCH_FILE;
+    }
+
+    mCurrent = Segment();
+    mCurrent.mIndex = index;
+    mCurrent.mBase = mStreamPos;
+    if (!mInitData.empty()) {
+        // the tables before the first packet
+        if (::write(mFd, mInitData.data(), mInitData.size()) != (ssize_t)mInitData.size()) {
+            ERROR("segment %d: write failed, errno %d(%s)\n", index, errno, strerror(errno));
+        }
+        mCurrent.mBase -= mInitData.size();
+        mCurrent.mSize = mInitData.size();
+        mInitData.clear();
+    }
+    if (!mAvailabilityStart) {
+        mAvailabilityStart = time(NULL);
+    }
+    VERBOSE("segment %d: %s\n", index, path.c_str());
+    return MM_ERROR_SUCCESS;
+}
+
+void SegmenterSink::closeSegment_l()
+{
+    if (mFd >= 0) {
+        ::close(mFd);
+        mFd = -1;
+    }
+    mCurrent = Segment();
+}
+
+void SegmenterSink::endPart_l(const MediaBufferSP & marker)
+{
+    int32_t index = -1;
+    marker->getMediaMeta()->getInt32(MEDIA_ATTR_SEGMENT_INDEX, index);
+    if (index != mCurrent.mIndex) {
+        WARNING("part of segment %d, writing %d\n", index, mCurrent.mIndex);
+        return;
+    }
+
+    Part part;
+    part.mOffset = mCurrent.mParts.empty() ? 0 : mCurrent.mParts.back().mOffset + mCurrent.mParts.back().mSize;
+    part.mSize = mCurrent.mSize - part.mOffset;
+    part.mDurationUs = marker->duration();
+    part.mIndependent = marker->isFlagSet(MediaBuffer::MBFT_KeyFrame);
+    if (part.mSize <= 0) {
+        return;
+    }
+    mCurrent.mParts.push_back(part);
+    if (mMaxPartDurationUs < part.mDurationUs) {
+        mMaxPartDurationUs = part.mDurationUs;
+    }
+    writePlaylist_l();
+}
+
+bool SegmenterSink::endSegment_l(const MediaBufferSP & marker, std::string & path)
+{
+    int32_t index = -1;
+    marker->getMediaMeta()->getInt32(MEDIA_ATTR_SEGMENT_INDEX, index);
+    if (index != mCurrent.mIndex) {
+        WARNING("end of segment %d, writing %d\n", index, mCurrent.mIndex);
+        return false;
+    }
+    if (mFd >= 0) {
+        ::close(mFd);
+        mFd = -1;
+    }
+
+    Segment segment = mCurrent;
+    mCurrent = Segment();
+    segment.mStartUs = marker->pts();
+    segment.mDurationUs = marker->duration();
+    if (mPartDurationUs > 0) {
+        // the rest is the last part
+        Part part;
+        part.mOffset = 0;
+        part.mDurationUs = segment.mDurationUs;
+        for (size_t i = 0; i < segment.mParts.size(); i++) {
+            part.mOffset += segment.mParts[i].mSize;
+            part.mDurationUs -= segment.mParts[i].mDurationUs;
+        }
+        part.mSize = segment.mSize - part.mOffset;
+        part.mIndependent = marker->isFlagSet(MediaBuffer::MBFT_KeyFrame);
+        if (part.mSize > 0) {
+            segment.mParts.push_back(part);
+            if (mMaxPartDurationUs < part.mDurationUs) {
+                mMaxPartDurationUs = part.mDurationUs;
+            }
+        }
+    }
+    if (mMaxDurationUs < segment.mDurationUs) {
+        mMaxDurationUs = segment.mDurationUs;
+    }
+    mSegments.push_back(segment);
+    path = mDir + segmentName(index);
+    INFO("segment %d: %" PRId64 " ms, %" PRId64 " bytes, %zu parts\n", index,
+        segment.mDurationUs / 1000, segment.mSize, segment.mParts.size());
+
+    removeOldSegments_l();
+    writePlaylist_l();
+    if (mFragmented) {
+        writeManifest_l();
+    }
+    return true;
+}
+
+// RFC 8216 6.2.2: a segment stays available one playlist length after it left the playlist
+void SegmenterSink::removeOldSegments_l()
+{
+    while (mSegments.size() > (size_t)mListSize * 2) {
+        std::string path = mDir + segmentName(mSegments.front().mIndex);
+        if (unlink(path.c_str())) {
+            WARNING("fail to delete %s, errno %d(%s)\n", path.c_str(), errno, strerror(errno));
+        }
+        mSegments.pop_front();
+    }
+}
+
+std::string SegmenterSink::segmentName(int32_t index) const
+{
+    char name[32];
+    snprintf(name, sizeof(name), "seg_%d.%s", index, mFragmented ? "m4s" : "ts");
+    return name;
+}
+
+void SegmenterSink::writePlaylist_l()
+{
+    size_t first = mSegments.size() > (size_t)mListSize ? mSegments.size() - mListSize : 0;
+    int64_t targetUs = mSegmentDurationUs > mMaxDurationUs ? mSegmentDurationUs : mMaxDurationUs;
+    int32_t version = mFragmented ? 6 : (mPartDurationUs > 0 ? 4 : 3);
+    char line[256];
+    std::string s = "#EXTM3U\n";
+
+    snprintf(line, sizeof(line), "#EXT-X-VERSION:%d\n#EXT-X-TARGETDURATION:%" PRId64 "\n",
+        version, (targetUs + 999999) / 1000000);
+    s += line;
+    if (mPartDurationUs > 0) {
+        int64_t partUs = mPartDurationUs > mMaxPartDurationUs ? mPartDurationUs : mMaxPartDurationUs;
+        snprintf(line, sizeof(line), "#EXT-X-SERVER-CONTROL:PART-HOLD-BACK=%.3f\n#EXT-X-PART-INF:PART-TARGET=%.3f\n",
+            partUs * 3 / 1000000.0, partUs / 1000000.0);
+        s += line;
+    }
+    snprintf(line, sizeof(line), "#EXT-X-MEDIA-SEQUENCE:%d\n#EXT-X-INDEPENDENT-SEGMENTS\n",
+        first < mSegments.size() ? mSegments[first].mIndex : (mCurrent.mIndex >= 0 ? mCurrent.mIndex : 0));
+    s += line;
+    if (mFragmented) {
+        snprintf(line, sizeof(line), "#EXT-X-MAP:URI=\"%s\"\n", INIT_NAME);
+        s += line;
+    }
+
+    size_t partsFrom = mSegments.size() > PART_SEGMENTS ? mSegments.size() - PART_SEGMENTS : 0;
+    for (size_t i = first; i <= mSegments.size(); i++) {
+        const Segment & segment = i < mSegments.size() ? mSegments[i] : mCurrent;
+        if (segment.mIndex < 0) {
+            break;
+        }
+        std::string name = segmentName(segment.mIndex);
+        if (mPartDurationUs > 0 && !mEnded && i >= partsFrom) {
+            for (size_t p = 0; p < segment.mParts.size(); p++) {
+                const Part & part = segment.mParts[p];
+                snprintf(line, sizeof(line), "#EXT-X-PART:DURATION=%.5f,URI=\"%s\",BYTERANGE=\"%" PRId64 "@%" PRId64 "\"%s\n",
+                    part.mDurationUs / 1000000.0, name.c_str(), part.mSize, part.mOffset,
+                    part.mIndependent ? ",INDEPENDENT=YES" : "");
+                s += line;
+            }
+        }
+        if (i == mSegments.size()) {
+            // in progress, only its parts are out
+            break;
+        }
+        snprintf(line, sizeof(line), "#EXTINF:%.3f,\n%s\n", segment.mDurationUs / 1000000.0, name.c_str());
+        s += line;
+    }
+    if (mEnded) {
+        s += "#EXT-X-ENDLIST\n";
+    }
+
+    replaceFile(PLAYLIST_NAME, s);
+}
+
+void SegmenterSink::writeManifest_l()
+{
+    if (mSegments.empty()) {
+        return;
+    }
+    size_t first = mSegments.size() > (size_t)mListSize ? mSegments.size() - mListSize : 0;
+    int64_t listedUs = 0;
+    int64_t bandwidth = 0;
+    for (size_t i = first; i < mSegments.size(); i++) {
+        listedUs += mSegments[i].mDurationUs;
+        if (mSegments[i].mDurationUs > 0 && mSegments[i].mSize * 8000000 / mSegments[i].mDurationUs > bandwidth) {
+            bandwidth = mSegments[i].mSize * 8000000 / mSegments[i].mDurationUs;
+        }
+    }
+    const Segment & last = mSegments.back();
+    int64_t targetUs = mSegmentDurationUs > mMaxDurationUs ? mSegmentDurationUs : mMaxDurationUs;
+    bool video = mCodecs.empty() || mCodecs.find("avc1") != std::string::npos || mCodecs.find("hvc1") != std::string::npos;
+    char line[512];
+
+    std::string s = "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+        "<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\" profiles=\"urn:mpeg:dash:profile:isoff-live:2011\"";
+    if (mEnded) {
+        snprintf(line, sizeof(line), " type=\"static\" mediaPresentationDuration=\"PT%.3fS\"",
+            (last.mStartUs + last.mDurationUs) / 1000000.0);
+    } else {
+        snprintf(line, sizeof(line), " type=\"dynamic\" availabilityStartTime=\"%s\" publishTime=\"%s\""
+            " minimumUpdatePeriod=\"PT%.3fS\" timeShiftBufferDepth=\"PT%.3fS\"",
+            formatTime(mAvailabilityStart).c_str(), formatTime(time(NULL)).c_str(),
+            targetUs / 1000000.0, listedUs / 1000000.0);
+    }
+    s += line;
+    snprintf(line, sizeof(line), " minBufferTime=\"PT%.3fS\">\n"
+        "  <Period id=\"0\" start=\"PT0S\">\n"
+        "    <AdaptationSet mimeType=\"%s\" segmentAlignment=\"true\" startWithSAP=\"1\">\n"
+        "      <Representation id=\"0\" bandwidth=\"%" PRId64 "\"",
+        targetUs / 1000000.0, video ? "video/mp4" : "audio/mp4", bandwidth);
+    s += line;
+    if (!mCodecs.empty()) {
+        s += " codecs=\"" + mCodecs + "\"";
+    }
+    snprintf(line, sizeof(line), ">\n"
+        "        <SegmentTemplate timescale=\"1000\" initialization=\"%s\" media=\"seg_$Number$.m4s\" startNumber=\"%d\">\n"
+        "          <SegmentTimeline>\n",
+        INIT_NAME, mSegments[first].mIndex);
+    s += line;
+    for (size_t i = first; i < mSegments.size(); i++) {
+        snprintf(line, sizeof(line), "            <S t=\"%" PRId64 "\" d=\"%" PRId64 "\"/>\n",
+            mSegments[i].mStartUs / 1000, mSegments[i].mDurationUs / 1000);
+        s += line;
+    }
+    s += "          </SegmentTimeline>\n"
+        "        </SegmentTemplate>\n"
+        "      </Representation>\n"
+        "    </AdaptationSet>\n"
+        "  </Period>\n"
+        "</MPD>\n";
+
+    replaceFile(MANIFEST_NAME, s);
+}
+
+// players never read a half written playlist
+bool SegmenterSink::replaceFile(const std::string & name, const std::string & content)
+{
+    std::string path = mDir + name;
+    std::string tmp = path + ".tmp";
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        ERROR("fail to open %s, errno %d(%s)\n", tmp.c_str(), errno, strerror(errno));
+        return false;
+    }
+    bool ok = ::write(fd, content.data(), content.size()) == (ssize_t)content.size();
+    ::close(fd);
+    if (!ok || rename(tmp.c_str(), path.c_str())) {
+        ERROR("fail to write %s, errno %d(%s)\n", path.c_str(), errno, strerror(errno));
+        unlink(tmp.c_str());
+        return false;
+    }
+    VERBOSE("%s updated\n", path.c_str());
+    return true;
+}
+
+} // YUNOS_MM
+
+/////////////////////////////////////////////////////////////////////////////////////
+extern "C" {
+MM_LOG_DEFINE_MODULE_NAME("SegmenterSink");
+
+YUNOS_MM::Component* createComponent(const char* mimeType, bool isEncoder) {
+    YUNOS_MM::SegmenterSink *sinkComponent = new YUNOS_MM::SegmenterSink(mimeType, isEncoder);
+    if (sinkComponent == NULL) {
+        return NULL;
+    }
+    return static_cast<YUNOS_MM::Component*>(sinkComponent);
+}
+
+
+void releaseComponent(YUNOS_MM::Component *component) {
+    ENTER();
+    delete component;
+    FLEAVE();
+}
+
+}
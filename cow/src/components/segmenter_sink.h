@@ -0,0 +1,140 @@
+/**
+ * Copyright (C) 2017 Alibaba Group Holding Limited. All Rights Reserved.
+ *
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef segmenter_sink_h
+#define segmenter_sink_h
+
+#include <time.h>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <multimedia/mm_cpp_utils.h>
+#include <multimedia/component.h>
+
+
+namespace YUNOS_MM {
+
+class MediaBuffer;
+class MediaMeta;
+
+/*
+ * live HLS/DASH output of AVMuxer cutting segments ("segment-duration-ms"), in the directory
+ * MEDIA_ATTR_FILE_PATH:
+ * - "mp4"/"dash": init.mp4, fragments seg_<n>.m4s, index.m3u8 and manifest.mpd
+ * - "mpegts"/"hls": seg_<n>.ts, the first one starts with the tables of the header, index.m3u8
+ * the playlists are replaced (tmp file and rename) at each segment end, and at each part end with
+ * "segment-part-duration-ms": low latency HLS, EXT-X-PART byte ranges of the growing segment file.
+ * they list the last "segment-list-size" segments. the file of an older segment is deleted one
+ * playlist length later, players which loaded an older playlist still get it.
+ * at EOS the playlists are ended (EXT-X-ENDLIST, static MPD), then kEventEOS is notified.
+ */
+class SegmenterSink : public SinkComponent {
+
+public:
+    SegmenterSink(const char *mimeType = NULL, bool isEncoder = false);
+
+    virtual const char * name() const;
+    COMPONENT_VERSION;
+    virtual WriterSP getWriter(MediaType mediaType);
+    virtual mm_status_t addSource(Component * component, MediaType mediaType) {return  MM_ERROR_IVALID_OPERATION;}
+    virtual mm_status_t prepare();
+    virtual mm_status_t start();
+    virtual mm_status_t stop();
+    virtual mm_status_t seek(int msec, int seekSequence) { return MM_ERROR_SUCCESS;}
+    virtual mm_status_t reset();
+    virtual mm_status_t flush();
+    virtual mm_status_t setParameter(const MediaMetaSP & meta);
+    virtual int64_t getCurrentPosition();
+
+protected:
+    virtual ~SegmenterSink();
+
+private:
+    class SegmenterSinkWriter : public Writer {
+    public:
+        SegmenterSinkWriter(SegmenterSink *sink) : mSink(sink)
+        {
+        }
+        virtual ~SegmenterSinkWriter(){}
+        virtual mm_status_t write(const MediaBufferSP &buffer);
+        virtual mm_status_t setMetaData(const MediaMetaSP & metaData);
+    private:
+        SegmenterSink *mSink;
+
+        DECLARE_LOGTAG()
+    };
+
+    // byte range of the segment file
+    struct Part {
+        int64_t mOffset;
+        int64_t mSize;
+        int64_t mDurationUs;
+        bool mIndependent;
+    };
+    struct Segment {
+        Segment() : mIndex(-1), mStartUs(0), mDurationUs(0), mSize(0), mBase(0) {}
+        int32_t mIndex;
+        int64_t mStartUs;
+        int64_t mDurationUs;
+        int64_t mSize;
+        int64_t mBase;      // position of the first byte in the muxer output
+        std::vector<Part> mParts;
+    };
+
+    mm_status_t write(const MediaBufferSP & buffer);
+    mm_status_t writeData_l(int32_t index, const MediaBufferSP & buffer);
+    mm_status_t openSegment_l(int32_t index);
+    void closeSegment_l();
+    void endPart_l(const MediaBufferSP & marker);
+    bool endSegment_l(const MediaBufferSP & marker, std::string & path);
+    void removeOldSegments_l();
+    void writePlaylist_l();
+    void writeManifest_l();
+    bool replaceFile(const std::string & name, const std::string & content);
+    std::string segmentName(int32_t index) const;
+    void clear_l();
+
+    Lock mLock;
+    std::string mDir;
+    bool mFragmented;               // fmp4, else mpeg-ts
+    int64_t mSegmentDurationUs;
+    int64_t mPartDurationUs;        // 0: no parts
+    int32_t mListSize;
+
+    int mFd;                        // of mCurrent
+    int mInitFd;                    // init.mp4 until its end
+    int64_t mInitSize;
+    std::string mInitData;          // mpeg-ts tables for the first segment
+    std::string mCodecs;
+    int64_t mStreamPos;             // of the next byte in the muxer output
+    Segment mCurrent;               // mIndex -1: none open
+    std::deque<Segment> mSegments;  // complete, the last mListSize ones are listed
+    int64_t mMaxDurationUs;
+    int64_t mMaxPartDurationUs;
+    time_t mAvailabilityStart;      // wall clock of media time 0
+    bool mEnded;
+    int64_t mCurrentPosition;
+
+private:
+    MM_DISALLOW_COPY(SegmenterSink);
+
+    DECLARE_LOGTAG()
+};
+
+} // end of namespace YUNOS_MM
+#endif//segmenter_sink_h
@@ -38,6 +38,9 @@
 #ifdef _USE_V4L2DEVICE_CLIENT
 #include "v4l2codec_device_client.h"
 #endif
+#ifdef _V4L2CODEC_SOFT
+#include "v4l2codec_device_soft.h"
+#endif
 
 MM_LOG_DEFINE_MODULE_NAME("V4L2DVC");
 // #define FUNC_TRACK() FuncTracker tracker(MM_LOG_TAG, __FUNCTION__, __LINE__)
@@ -160,13 +163,22 @@ bool V4l2CodecDevice::close()
 {
     FUNC_TRACK();
     V4l2CodecDeviceSP deviceSP;
+    V4l2CodecDevice *device = NULL;
+#ifdef _V4L2CODEC_SOFT
+    if (mm_check_env_str("mm.v4l2.soft", "MM_V4L2_SOFT")) {
+        INFO("using v4l2 device soft\n");
+        device = new V4l2CodecDeviceSoft();
+    } else
+#endif
+    {
 #ifdef _USE_V4L2DEVICE_CLIENT
-    INFO("using v4l2 device client \n");
-    V4l2CodecDevice *device = new V4l2CodecDeviceClient();
+        INFO("using v4l2 device client \n");
+        device = new V4l2CodecDeviceClient();
 #else
-    INFO("using v4l2 device direct\n");
-    V4l2CodecDevice *device = new V4l2CodecDevice();
+        INFO("using v4l2 device direct\n");
+        device = new V4l2CodecDevice();
 #endif
+    }
 
     if (!device)
         return deviceSP;
@@ -0,0 +1,1358 @@
+/**
+ * Copyright (C) 2017 Alibaba Group Holding Limited. All Rights Reserved.
+ *
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <algorithm>
+
+extern "C" {
+#ifndef __STDC_FORMAT_MACROS
+#define __STDC_FORMAT_MACROS
+#endif
+#ifndef __STDC_CONSTANT_MACROS
+#define __STDC_CONSTANT_MACROS
+#endif
+#include <inttypes.h>
+#include <stdint.h>
+#include <libavcodec/avcodec.h>
+#include <libavutil/imgutils.h>
+#include <libavutil/opt.h>
+#include <libswscale/swscale.h>
+}
+
+#include "multimedia/mm_debug.h"
+#include "v4l2codec_device_soft.h"
+
+MM_LOG_DEFINE_MODULE_NAME("V4L2SOFT");
+// #define FUNC_TRACK() FuncTracker tracker(MM_LOG_TAG, __FUNCTION__, __LINE__)
+#define FUNC_TRACK()
+
+// the v4l2 components pack the int64 timestamp into timeval this way, carried as is
+#define INT64_TO_TIMEVAL(i64, time_val) do {            \
+        time_val.tv_sec = (int32_t)(i64 >> 31);         \
+        time_val.tv_usec = (int32_t)(i64 & 0x7fffffff); \
+    } while (0)
+#define TIMEVAL_TO_INT64(i64, time_val) do {            \
+        i64 = time_val.tv_sec;                          \
+        i64 = (i64 << 31)  + time_val.tv_usec;  \
+    } while(0)
+
+#ifndef V4L2_PIX_FMT_VC1
+#define V4L2_PIX_FMT_VC1 v4l2_fourcc('V', 'C', '1', '0')
+#endif
+#ifndef V4L2_PIX_FMT_VP8
+#define V4L2_PIX_FMT_VP8 v4l2_fourcc('V', 'P', '8', '0')
+#endif
+
+namespace YUNOS_MM {
+
+static const uint32_t kMaxBufferCount = VIDEO_MAX_FRAME;
+static const uint32_t kDefaultBitstreamSize = 1024 * 1024;
+static const uint32_t kMinBitstreamSize = 256 * 1024;
+static const uint32_t kDefaultMinCaptureBuffers = 4;
+// outputs kept while no capture buffer is queued, input waits beyond
+static const size_t kMaxPendingOutputs = 4;
+// poll() returns on new done buffers, and after this for buffers the client left in the done queue
+static const int64_t kPollTimeoutUs = 20000;
+// mem_offset cookie of QUERYBUF: queue | index | plane
+static const uint32_t kCaptureCookie = 0x10000;
+static const char * kDefaultPreset = "veryfast";
+
+static pthread_once_t s_av_once = PTHREAD_ONCE_INIT;
+static void av_init_once()
+{
+    avcodec_register_all();
+}
+
+static AVCodecID codecIdOf(uint32_t fourcc)
+{
+    switch (fourcc) {
+    case V4L2_PIX_FMT_H264:
+        return AV_CODEC_ID_H264;
+#ifdef V4L2_PIX_FMT_HEVC
+    case V4L2_PIX_FMT_HEVC:
+        return AV_CODEC_ID_HEVC;
+#endif
+    case V4L2_PIX_FMT_VP8:
+        return AV_CODEC_ID_VP8;
+#ifdef V4L2_PIX_FMT_VP9
+    case V4L2_PIX_FMT_VP9:
+        return AV_CODEC_ID_VP9;
+#endif
+    case V4L2_PIX_FMT_MPEG2:
+        return AV_CODEC_ID_MPEG2VIDEO;
+    case V4L2_PIX_FMT_MPEG4:
+        return AV_CODEC_ID_MPEG4;
+    case V4L2_PIX_FMT_H263:
+        return AV_CODEC_ID_H263;
+    case V4L2_PIX_FMT_MJPEG:
+        return AV_CODEC_ID_MJPEG;
+    case V4L2_PIX_FMT_VC1:
+        return AV_CODEC_ID_VC1;
+    default:
+        break;
+    }
+    return AV_CODEC_ID_NONE;
+}
+
+// raw input of the encoder, YVU420 is read as YUV420P with the chroma planes swapped
+static AVPixelFormat pixFmtOf(uint32_t fourcc)
+{
+    switch (fourcc) {
+    case V4L2_PIX_FMT_NV12:
+    case V4L2_PIX_FMT_NV12M:
+        return AV_PIX_FMT_NV12;
+    case V4L2_PIX_FMT_NV21:
+        return AV_PIX_FMT_NV21;
+    case V4L2_PIX_FMT_YUV420:
+    case V4L2_PIX_FMT_YUV420M:
+    case V4L2_PIX_FMT_YVU420:
+        return AV_PIX_FMT_YUV420P;
+    case V4L2_PIX_FMT_YUYV:
+        return AV_PIX_FMT_YUYV422;
+    case V4L2_PIX_FMT_YVYU:
+        return AV_PIX_FMT_YVYU422;
+    case V4L2_PIX_FMT_RGB32:
+        return AV_PIX_FMT_BGRA;
+    default:
+        break;
+    }
+    return AV_PIX_FMT_NONE;
+}
+
+static uint32_t planeCountOf(uint32_t fourcc)
+{
+    switch (fourcc) {
+    case V4L2_PIX_FMT_NV12:
+    case V4L2_PIX_FMT_NV12M:
+    case V4L2_PIX_FMT_NV21:
+        return 2;
+    case V4L2_PIX_FMT_YUV420:
+    case V4L2_PIX_FMT_YUV420M:
+    case V4L2_PIX_FMT_YVU420:
+        return 3;
+    default:
+        break;
+    }
+    return 1;
+}
+
+static int32_t nv12Stride(int32_t width)
+{
+    return (width + 1) & ~1;
+}
+
+static uint32_t envUint(const char *property, const char *env, uint32_t defaultValue)
+{
+    std::string value = mm_get_env_str(property, env);
+    if (value.empty())
+        return defaultValue;
+    return (uint32_t)atoi(value.c_str());
+}
+
+V4l2CodecDeviceSoft::Buffer::Buffer()
+    : handle(0)
+    , flags(0)
+    , bytesused(0)
+    , queuedUs(0)
+    , inputUs(0)
+    , doneUs(0)
+    , queued(false)
+{
+    memset(mem, 0, sizeof(mem));
+    memset(length, 0, sizeof(length));
+    for (uint32_t j = 0; j < kMaxPlanes; j++)
+        fd[j] = -1;
+    memset(planes, 0, sizeof(planes));
+    memset(&timestamp, 0, sizeof(timestamp));
+}
+
+V4l2CodecDeviceSoft::Queue::Queue()
+    : memory(V4L2_MEMORY_MMAP)
+    , planeCount(1)
+    , streaming(false)
+{
+}
+
+V4l2CodecDeviceSoft::WorkerThread::WorkerThread(V4l2CodecDeviceSoft *owner)
+    : MMThread("V4l2Soft")
+    , mOwner(owner)
+{
+}
+
+void V4l2CodecDeviceSoft::WorkerThread::main()
+{
+    mOwner->work();
+}
+
+V4l2CodecDeviceSoft::V4l2CodecDeviceSoft()
+    : mIsEncoder(false)
+    , mOutputFourcc(0)
+    , mBitstreamSize(kDefaultBitstreamSize)
+    , mWidth(0)
+    , mHeight(0)
+    , mFormatKnown(false)
+    , mMinCaptureBuffers(kDefaultMinCaptureBuffers)
+    , mFramerateNum(30)
+    , mFramerateDenom(1)
+    , mBitrate(0)
+    , mGop(0)
+    , mBaseline(false)
+    , mLowDelay(false)
+    , mForceKeyFrame(false)
+    , mCodec(NULL)
+    , mFrame(NULL)
+    , mSws(NULL)
+    , mResolutionChanged(false)
+    , mDraining(false)
+    , mStarved(false)
+    , mWorkCond(mLock)
+    , mIdleCond(mLock)
+    , mPollCond(mLock)
+    , mExit(false)
+    , mBusy(false)
+    , mPauseCount(0)
+    , mPollInterrupt(false)
+    , mDoneCount(0)
+    , mPolledDoneCount(0)
+    , mLatencySumUs(0)
+    , mDqbufWaitSumUs(0)
+{
+    FUNC_TRACK();
+    memset(&mStats, 0, sizeof(mStats));
+}
+
+V4l2CodecDeviceSoft::~V4l2CodecDeviceSoft()
+{
+    FUNC_TRACK();
+    close();
+}
+
+bool V4l2CodecDeviceSoft::open(const char* name, uint32_t flags)
+{
+    FUNC_TRACK();
+    pthread_once(&s_av_once, av_init_once);
+
+    if (!strcmp(name, "encoder")) {
+        mIsEncoder = true;
+        mOutputFourcc = V4L2_PIX_FMT_NV12;
+        mOutputQ.planeCount = 2;
+        mCaptureQ.planeCount = 1;
+    } else if (!strcmp(name, "decoder")) {
+        mIsEncoder = false;
+        mOutputFourcc = V4L2_PIX_FMT_H264;
+        mOutputQ.planeCount = 1;
+        mCaptureQ.planeCount = 2;
+    } else {
+        ERROR("unknown device %s\n", name);
+        return false;
+    }
+    mMinCaptureBuffers = envUint("mm.v4l2.soft.min_capture", "MM_V4L2_SOFT_MIN_CAPTURE", kDefaultMinCaptureBuffers);
+
+    mWorker.reset(new WorkerThread(this), MMThread::releaseHelper);
+    if (mWorker->create()) {
+        ERROR("fail to create worker thread\n");
+        mWorker.reset();
+        return false;
+    }
+
+    // not a file descriptor, only for the checks of the base class
+    mV4l2Fd = 1;
+    INFO("soft %s opened\n", name);
+    return true;
+}
+
+bool V4l2CodecDeviceSoft::close()
+{
+    FUNC_TRACK();
+    {
+        MMAutoLock locker(mLock);
+        if (!mV4l2Fd)
+            return true;
+        mV4l2Fd = 0;
+        mExit = true;
+        mWorkCond.signal();
+        mPollInterrupt = true;
+        mPollCond.broadcast();
+    }
+    // joins the worker
+    mWorker.reset();
+
+    MMAutoLock locker(mLock);
+    logStats_l();
+    clearOutputs_l();
+    freeBuffers_l(mOutputQ);
+    freeBuffers_l(mCaptureQ);
+    closeCodec();
+    return true;
+}
+
+V4l2CodecDeviceSoft::Queue *V4l2CodecDeviceSoft::queueOf(uint32_t type)
+{
+    if (type == V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE)
+        return &mOutputQ;
+    if (type == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE)
+        return &mCaptureQ;
+    return NULL;
+}
+
+int32_t V4l2CodecDeviceSoft::ioctl(uint64_t request, void* arg)
+{
+    FUNC_TRACK();
+    if (!mV4l2Fd || !arg)
+        return -1;
+
+    int32_t ret = -1;
+    switch (request) {
+    case VIDIOC_QUERYCAP:
+        ret = querycap((struct v4l2_capability*)arg);
+        break;
+    case VIDIOC_S_FMT:
+        ret = setFormat((struct v4l2_format*)arg);
+        break;
+    case VIDIOC_G_FMT:
+        ret = getFormat((struct v4l2_format*)arg);
+        break;
+    case VIDIOC_S_PARM:
+        ret = setParm((struct v4l2_streamparm*)arg);
+        break;
+    case VIDIOC_S_EXT_CTRLS:
+        ret = setExtCtrls((struct v4l2_ext_controls*)arg);
+        break;
+    case VIDIOC_G_CTRL:
+        ret = getCtrl((struct v4l2_control*)arg);
+        break;
+    case VIDIOC_REQBUFS:
+        ret = reqbufs((struct v4l2_requestbuffers*)arg);
+        break;
+    case VIDIOC_QUERYBUF:
+        ret = querybuf((struct v4l2_buffer*)arg);
+        break;
+    case VIDIOC_QBUF:
+        ret = qbuf((struct v4l2_buffer*)arg);
+        break;
+    case VIDIOC_DQBUF:
+        ret = dqbuf((struct v4l2_buffer*)arg);
+        break;
+    case VIDIOC_STREAMON:
+        ret = stream(*(uint32_t*)arg, true);
+        break;
+    case VIDIOC_STREAMOFF:
+        ret = stream(*(uint32_t*)arg, false);
+        break;
+    case VIDIOC_DQEVENT:
+        ret = dqevent((struct v4l2_event*)arg);
+        break;
+    case VIDIOC_EXPBUF:
+        ret = expbuf((struct v4l2_exportbuffer*)arg);
+        break;
+    case VIDIOC_SUBSCRIBE_EVENT:
+    case VIDIOC_UNSUBSCRIBE_EVENT:
+        ret = 0;
+        break;
+    default:
+        WARNING("not supported ioctl 0x%" PRIx64 "\n", request);
+        errno = ENOTTY;
+        break;
+    }
+
+    if (ret != 0)
+        VERBOSE("ret=%d\n", ret);
+    return ret;
+}
+
+int32_t V4l2CodecDeviceSoft::querycap(struct v4l2_capability *caps)
+{
+    memset(caps, 0, sizeof(*caps));
+    strncpy((char*)caps->driver, "v4l2codec-soft", sizeof(caps->driver) - 1);
+    strncpy((char*)caps->card, mIsEncoder ? "encoder" : "decoder", sizeof(caps->card) - 1);
+    caps->capabilities = V4L2_CAP_VIDEO_CAPTURE_MPLANE | V4L2_CAP_VIDEO_OUTPUT_MPLANE | V4L2_CAP_STREAMING;
+    caps->device_caps = caps->capabilities;
+    return 0;
+}
+
+int32_t V4l2CodecDeviceSoft::setFormat(struct v4l2_format *format)
+{
+    MMAutoLock locker(mLock);
+    if (format->type == V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE) {
+        uint32_t fourcc = format->fmt.pix_mp.pixelformat;
+        if (mIsEncoder) {
+            if (pixFmtOf(fourcc) == AV_PIX_FMT_NONE) {
+                ERROR("not supported raw format 0x%x\n", fourcc);
+                errno = EINVAL;
+                return -1;
+            }
+            mOutputFourcc = fourcc;
+            mOutputQ.planeCount = planeCountOf(fourcc);
+            mWidth = format->fmt.pix_mp.width;
+            mHeight = format->fmt.pix_mp.height;
+            mFormatKnown = mWidth > 0 && mHeight > 0;
+        } else {
+            if (codecIdOf(fourcc) == AV_CODEC_ID_NONE) {
+                ERROR("not supported codec 0x%x\n", fourcc);
+                errno = EINVAL;
+                return -1;
+            }
+            mOutputFourcc = fourcc;
+            uint32_t sizeimage = format->fmt.pix_mp.plane_fmt[0].sizeimage;
+            mBitstreamSize = sizeimage ? sizeimage : kDefaultBitstreamSize;
+        }
+        INFO("output format 0x%x, %dx%d\n", fourcc, format->fmt.pix_mp.width, format->fmt.pix_mp.height);
+        return 0;
+    }
+
+    if (format->type != V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (mIsEncoder) {
+        if (format->fmt.pix_mp.pixelformat != V4L2_PIX_FMT_H264) {
+            ERROR("only h264 encoding is supported\n");
+            errno = EINVAL;
+            return -1;
+        }
+        return 0;
+    }
+
+    // VideoDecodeV4l2 sends the codec data as size + data in fmt.raw_data, a zero size is pix_mp
+    uint32_t size = 0;
+    memcpy(&size, format->fmt.raw_data, sizeof(size));
+    if (size && size <= sizeof(format->fmt.raw_data) - sizeof(size)) {
+        const char *data = (const char*)format->fmt.raw_data + sizeof(size);
+        // avcC/hvcC would switch the parser to length prefixed input, the bitstream is annexb
+        // and carries the parameter sets
+        AVCodecID id = codecIdOf(mOutputFourcc);
+        bool lengthPrefixed = (id == AV_CODEC_ID_H264 || id == AV_CODEC_ID_HEVC) && data[0] == 1;
+        if (!lengthPrefixed)
+            mCodecData.assign(data, size);
+        DEBUG("codec data %u bytes%s\n", size, lengthPrefixed ? ", length prefixed, ignored" : "");
+    }
+    return 0;
+}
+
+int32_t V4l2CodecDeviceSoft::getFormat(struct v4l2_format *format)
+{
+    MMAutoLock locker(mLock);
+    struct v4l2_pix_format_mplane &pix = format->fmt.pix_mp;
+
+    if (format->type == V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE) {
+        memset(&pix, 0, sizeof(pix));
+        pix.pixelformat = mOutputFourcc;
+        pix.width = mIsEncoder ? mWidth : 0;
+        pix.height = mIsEncoder ? mHeight : 0;
+        pix.num_planes = mOutputQ.planeCount;
+        if (!mIsEncoder)
+            pix.plane_fmt[0].sizeimage = mBitstreamSize;
+        return 0;
+    }
+
+    if (format->type != V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (mIsEncoder) {
+        memset(&pix, 0, sizeof(pix));
+        pix.pixelformat = V4L2_PIX_FMT_H264;
+        pix.width = mWidth;
+        pix.height = mHeight;
+        pix.num_planes = 1;
+        pix.plane_fmt[0].sizeimage = std::max(kMinBitstreamSize, (uint32_t)(mWidth * mHeight * 3 / 2));
+        return 0;
+    }
+
+    // the size is known from the first decoded frame, VideoDecodeV4l2 retries on EAGAIN
+    if (!mFormatKnown)
+        return EAGAIN;
+
+    memset(&pix, 0, sizeof(pix));
+    int32_t stride = nv12Stride(mWidth);
+    pix.pixelformat = V4L2_PIX_FMT_NV12M;
+    pix.width = mWidth;
+    pix.height = mHeight;
+    pix.num_planes = 2;
+    pix.plane_fmt[0].bytesperline = stride;
+    pix.plane_fmt[0].sizeimage = stride * mHeight;
+    pix.plane_fmt[1].bytesperline = stride;
+    pix.plane_fmt[1].sizeimage = stride * ((mHeight + 1) / 2);
+    return 0;
+}
+
+int32_t V4l2CodecDeviceSoft::setParm(struct v4l2_streamparm *parms)
+{
+    if (parms->type != V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    // VideoEncodeV4l2 passes the frame rate, not the frame period
+    MMAutoLock locker(mLock);
+    struct v4l2_fract &fract = parms->parm.output.timeperframe;
+    if (fract.numerator && fract.denominator) {
+        mFramerateNum = fract.numerator;
+        mFramerateDenom = fract.denominator;
+    }
+    DEBUG("frame rate %d/%d\n", mFramerateNum, mFramerateDenom);
+    return 0;
+}
+
+int32_t V4l2CodecDeviceSoft::setExtCtrls(struct v4l2_ext_controls *control)
+{
+    MMAutoLock locker(mLock);
+    for (uint32_t i = 0; i < control->count; i++) {
+        struct v4l2_ext_control &ctrl = control->controls[i];
+        switch (ctrl.id) {
+        case V4L2_CID_MPEG_VIDEO_BITRATE:
+            mBitrate = ctrl.value;
+            break;
+        case V4L2_CID_MPEG_VIDEO_GOP_SIZE:
+            mGop = ctrl.value;
+            break;
+        case V4L2_CID_MPEG_VIDEO_H264_PROFILE:
+            mBaseline = ctrl.value == V4L2_MPEG_VIDEO_H264_PROFILE_BASELINE ||
+                        ctrl.value == V4L2_MPEG_VIDEO_H264_PROFILE_CONSTRAINED_BASELINE;
+            break;
+        case V4L2_CID_MPEG_MFC51_VIDEO_FORCE_FRAME_TYPE:
+            if (ctrl.value == V4L2_MPEG_MFC51_VIDEO_FORCE_FRAME_TYPE_I_FRAME)
+                mForceKeyFrame = true;
+            break;
+        default:
+            // b frames are always off, the level follows the encoder
+            DEBUG("ignore control 0x%x: %d\n", ctrl.id, ctrl.value);
+            break;
+        }
+    }
+    return 0;
+}
+
+int32_t V4l2CodecDeviceSoft::getCtrl(struct v4l2_control *ctrl)
+{
+    if (ctrl->id != V4L2_CID_MIN_BUFFERS_FOR_CAPTURE) {
+        errno = EINVAL;
+        return -1;
+    }
+    MMAutoLock locker(mLock);
+    ctrl->value = mIsEncoder ? 1 : mMinCaptureBuffers;
+    return 0;
+}
+
+int32_t V4l2CodecDeviceSoft::setParameter(const char* key, const char* value)
+{
+    FUNC_TRACK();
+    if (!key || !value)
+        return -1;
+
+    DEBUG("key: %s, value: %s", key, value);
+    MMAutoLock locker(mLock);
+    if (!strcmp(key, "frame-memory-type")) {
+        // buffer handles can't be read here
+        if (strcmp(value, "raw-data")) {
+            ERROR("not supported frame memory type %s\n", value);
+            return -1;
+        }
+    } else if (!strcmp(key, "encode-mode")) {
+        mLowDelay = !strcmp(value, "svct");
+    }
+    return 0;
+}
+
+void V4l2CodecDeviceSoft::pauseWorker_l()
+{
+    mPauseCount++;
+    while (mBusy)
+        mIdleCond.wait();
+}
+
+void V4l2CodecDeviceSoft::resumeWorker_l()
+{
+    mPauseCount--;
+    mWorkCond.signal();
+}
+
+void V4l2CodecDeviceSoft::freeBuffers_l(Queue &queue)
+{
+    for (size_t i = 0; i < queue.buffers.size(); i++) {
+        Buffer &buf = queue.buffers[i];
+        for (uint32_t j = 0; j < kMaxPlanes; j++) {
+            if (buf.fd[j] >= 0) {
+                ::munmap(buf.mem[j], buf.length[j]);
+                ::close(buf.fd[j]);
+            } else {
+                free(buf.mem[j]);
+            }
+        }
+    }
+    queue.buffers.clear();
+    queue.pending.clear();
+    queue.done.clear();
+}
+
+void V4l2CodecDeviceSoft::allocBuffers_l(Queue &queue, bool capture, uint32_t count)
+{
+    uint32_t lengths[kMaxPlanes] = {0, 0, 0};
+    bool deviceMemory = queue.memory == V4L2_MEMORY_MMAP;
+
+    if (!capture && mIsEncoder) {
+        int linesizes[4] = {0};
+        AVPixelFormat fmt = pixFmtOf(mOutputFourcc);
+        av_image_fill_linesizes(linesizes, fmt, mWidth);
+        for (uint32_t j = 0; j < queue.planeCount; j++) {
+            lengths[j] = linesizes[j] * (j ? (mHeight + 1) / 2 : mHeight);
+        }
+    } else if (!capture) {
+        lengths[0] = mBitstreamSize;
+    } else if (mIsEncoder) {
+        lengths[0] = std::max(kMinBitstreamSize, (uint32_t)(mWidth * mHeight * 3 / 2));
+        deviceMemory = true;
+    } else {
+        // frames are decoded to device memory whatever the client's memory type is
+        int32_t stride = nv12Stride(mWidth);
+        lengths[0] = stride * mHeight;
+        lengths[1] = stride * ((mHeight + 1) / 2);
+        deviceMemory = true;
+    }
+
+    // capture buffers mapped by the client can be exported (VIDIOC_EXPBUF)
+    bool exportable = capture && queue.memory == V4L2_MEMORY_MMAP;
+    queue.buffers.resize(count);
+    for (uint32_t i = 0; i < count; i++) {
+        Buffer &buf = queue.buffers[i];
+        for (uint32_t j = 0; j < queue.planeCount; j++) {
+            buf.length[j] = lengths[j];
+            if (!deviceMemory || !lengths[j])
+                continue;
+            if (exportable)
+                buf.fd[j] = createSharedMemory(lengths[j], &buf.mem[j]);
+            if (buf.fd[j] < 0)
+                buf.mem[j] = (uint8_t*)malloc(lengths[j]);
+        }
+    }
+}
+
+/* static */ int V4l2CodecDeviceSoft::createSharedMemory(size_t length, uint8_t **mem)
+{
+#ifdef SYS_memfd_create
+    int fd = syscall(SYS_memfd_create, "v4l2soft", 1 /* MFD_CLOEXEC */);
+    if (fd < 0)
+        return -1;
+    void *addr = MAP_FAILED;
+    if (ftruncate(fd, length) == 0)
+        addr = ::mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) {
+        ::close(fd);
+        return -1;
+    }
+    *mem = (uint8_t*)addr;
+    return fd;
+#else
+    return -1;
+#endif
+}
+
+int32_t V4l2CodecDeviceSoft::expbuf(struct v4l2_exportbuffer *expbuf)
+{
+    Queue *queue = queueOf(expbuf->type);
+    MMAutoLock locker(mLock);
+    if (!queue || expbuf->index >= queue->buffers.size() || expbuf->plane >= kMaxPlanes ||
+        queue->buffers[expbuf->index].fd[expbuf->plane] < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    // the importer keeps the memory alive after REQBUFS(0), like a dma-buf
+    int fd = fcntl(queue->buffers[expbuf->index].fd[expbuf->plane], F_DUPFD_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+    expbuf->fd = fd;
+    return 0;
+}
+
+int32_t V4l2CodecDeviceSoft::reqbufs(struct v4l2_requestbuffers *reqbufs)
+{
+    Queue *queue = queueOf(reqbufs->type);
+    if (!queue) {
+        errno = EINVAL;
+        return -1;
+    }
+    bool capture = queue == &mCaptureQ;
+
+    MMAutoLock locker(mLock);
+    if (capture && reqbufs->count && !mIsEncoder && !mFormatKnown) {
+        ERROR("capture buffers requested before the video size is known\n");
+        errno = EINVAL;
+        return -1;
+    }
+
+    pauseWorker_l();
+    freeBuffers_l(*queue);
+    queue->memory = reqbufs->memory;
+    reqbufs->count = std::min(reqbufs->count, kMaxBufferCount);
+    if (reqbufs->count)
+        allocBuffers_l(*queue, capture, reqbufs->count);
+    if (capture && reqbufs->count && mResolutionChanged) {
+        INFO("capture buffers reallocated for %dx%d\n", mWidth, mHeight);
+        mResolutionChanged = false;
+    }
+    resumeWorker_l();
+
+    DEBUG("%s: %u buffers, memory %u\n", capture ? "capture" : "output", reqbufs->count, reqbufs->memory);
+    return 0;
+}
+
+int32_t V4l2CodecDeviceSoft::querybuf(struct v4l2_buffer *buf)
+{
+    Queue *queue = queueOf(buf->type);
+    MMAutoLock locker(mLock);
+    if (!queue || buf->index >= queue->buffers.size() || !buf->m.planes) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    Buffer &buffer = queue->buffers[buf->index];
+    uint32_t count = std::min(buf->length, queue->planeCount);
+    for (uint32_t j = 0; j < count; j++) {
+        buf->m.planes[j].length = buffer.length[j];
+        buf->m.planes[j].m.mem_offset = (queue == &mCaptureQ ? kCaptureCookie : 0) | (buf->index << 4) | j;
+    }
+    buf->length = queue->planeCount;
+    buf->flags = buffer.queued ? V4L2_BUF_FLAG_QUEUED : 0;
+    return 0;
+}
+
+void* V4l2CodecDeviceSoft::mmap(void* addr, size_t length, uint32_t prot, uint32_t flags, uint32_t offset)
+{
+    FUNC_TRACK();
+    MMAutoLock locker(mLock);
+    Queue &queue = (offset & kCaptureCookie) ? mCaptureQ : mOutputQ;
+    uint32_t index = (offset & (kCaptureCookie - 1)) >> 4;
+    uint32_t plane = offset & 0xf;
+
+    if (index >= queue.buffers.size() || plane >= kMaxPlanes || length > queue.buffers[index].length[plane]) {
+        ERROR("invalid offset 0x%x or length %zu\n", offset, length);
+        return NULL;
+    }
+    void *ret = queue.buffers[index].mem[plane];
+    DEBUG("ret=%p\n", ret);
+    return ret;
+}
+
+int32_t V4l2CodecDeviceSoft::munmap(void* addr, size_t length)
+{
+    FUNC_TRACK();
+    // the memory goes with REQBUFS(0) or close
+    return 0;
+}
+
+int32_t V4l2CodecDeviceSoft::qbuf(struct v4l2_buffer *buf)
+{
+    Queue *queue = queueOf(buf->type);
+    MMAutoLock locker(mLock);
+    if (!queue || buf->index >= queue->buffers.size()) {
+        errno = EINVAL;
+        return -1;
+    }
+    bool capture = queue == &mCaptureQ;
+    Buffer &buffer = queue->buffers[buf->index];
+    if (buffer.queued) {
+        ERROR("%s buffer %u is queued already\n", capture ? "capture" : "output", buf->index);
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (capture) {
+        // VideoDecodeV4l2 passes the surface buffer in m.userptr, whatever the memory type
+        buffer.handle = buf->m.userptr;
+    } else {
+        if (!buf->m.planes) {
+            errno = EINVAL;
+            return -1;
+        }
+        memset(buffer.planes, 0, sizeof(buffer.planes));
+        memcpy(buffer.planes, buf->m.planes, std::min(buf->length, (uint32_t)kMaxPlanes) * sizeof(struct v4l2_plane));
+        // the client finds its memory in reserved on DQBUF
+        unsigned long userptr = 0;
+        memcpy(&userptr, buffer.planes[0].reserved, sizeof(userptr));
+        if (queue->memory == V4L2_MEMORY_USERPTR && !userptr)
+            memcpy(buffer.planes[0].reserved, &buffer.planes[0].m.userptr, sizeof(userptr));
+        buffer.flags = buf->flags;
+        buffer.timestamp = buf->timestamp;
+    }
+
+    buffer.queued = true;
+    buffer.queuedUs = getTimeUs();
+    queue->pending.push_back(buf->index);
+    if (capture) {
+        mStats.maxCaptureQueued = std::max(mStats.maxCaptureQueued, (uint32_t)queue->pending.size());
+    } else {
+        mStats.maxInputQueued = std::max(mStats.maxInputQueued, (uint32_t)queue->pending.size());
+    }
+    mWorkCond.signal();
+    return 0;
+}
+
+int32_t V4l2CodecDeviceSoft::dqbuf(struct v4l2_buffer *buf)
+{
+    Queue *queue = queueOf(buf->type);
+    MMAutoLock locker(mLock);
+    if (!queue) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (queue->done.empty()) {
+        errno = EAGAIN;
+        return -1;
+    }
+
+    bool capture = queue == &mCaptureQ;
+    uint32_t index = queue->done.front();
+    queue->done.pop_front();
+    Buffer &buffer = queue->buffers[index];
+    buffer.queued = false;
+
+    buf->index = index;
+    buf->flags = buffer.flags;
+    buf->timestamp = buffer.timestamp;
+    buf->bytesused = buffer.bytesused;
+    if (buf->m.planes) {
+        memcpy(buf->m.planes, buffer.planes,
+            std::min(buf->length, queue->planeCount) * sizeof(struct v4l2_plane));
+    } else if (capture) {
+        buf->m.userptr = buffer.handle;
+    }
+
+    if (capture && buffer.bytesused) {
+        int64_t now = getTimeUs();
+        int64_t wait = now - buffer.doneUs;
+        mStats.frames++;
+        mDqbufWaitSumUs += wait;
+        mStats.dqbufWaitMaxUs = std::max(mStats.dqbufWaitMaxUs, wait);
+        if (buffer.inputUs) {
+            int64_t latency = now - buffer.inputUs;
+            mLatencySumUs += latency;
+            mStats.latencyMaxUs = std::max(mStats.latencyMaxUs, latency);
+        }
+    }
+    return 0;
+}
+
+int32_t V4l2CodecDeviceSoft::stream(uint32_t type, bool on)
+{
+    Queue *queue = queueOf(type);
+    if (!queue) {
+        errno = EINVAL;
+        return -1;
+    }
+    bool capture = queue == &mCaptureQ;
+
+    MMAutoLock locker(mLock);
+    if (on) {
+        queue->streaming = true;
+        mWorkCond.signal();
+        return 0;
+    }
+
+    // every buffer goes back to the client, without being processed
+    pauseWorker_l();
+    queue->streaming = false;
+    queue->pending.clear();
+    queue->done.clear();
+    for (size_t i = 0; i < queue->buffers.size(); i++)
+        queue->buffers[i].queued = false;
+
+    if (capture) {
+        logStats_l();
+    } else {
+        // a flush: drop what the codec holds
+        clearOutputs_l();
+        mInputTimes.clear();
+        mDraining = false;
+        if (mCodec) {
+            if (mIsEncoder)
+                closeCodec();
+            else
+                avcodec_flush_buffers(mCodec);
+        }
+    }
+    resumeWorker_l();
+    return 0;
+}
+
+int32_t V4l2CodecDeviceSoft::dqevent(struct v4l2_event *ev)
+{
+    MMAutoLock locker(mLock);
+    if (mEvents.empty()) {
+        errno = ENOENT;
+        return -1;
+    }
+    *ev = mEvents.front();
+    mEvents.pop_front();
+    ev->pending = mEvents.size();
+    return 0;
+}
+
+int32_t V4l2CodecDeviceSoft::poll(bool poll_device, bool* event_pending)
+{
+    FUNC_TRACK();
+    MMAutoLock locker(mLock);
+    if (!mV4l2Fd)
+        return -1;
+
+    if (poll_device && !mPollInterrupt && mDoneCount == mPolledDoneCount && mEvents.empty())
+        mPollCond.timedWait(kPollTimeoutUs);
+    mPolledDoneCount = mDoneCount;
+    if (event_pending)
+        *event_pending = !mEvents.empty();
+    return 0;
+}
+
+int32_t V4l2CodecDeviceSoft::setDevicePollInterrupt()
+{
+    FUNC_TRACK();
+    MMAutoLock locker(mLock);
+    mPollInterrupt = true;
+    mPollCond.broadcast();
+    return 0;
+}
+
+int32_t V4l2CodecDeviceSoft::clearDevicePollInterrupt()
+{
+    FUNC_TRACK();
+    MMAutoLock locker(mLock);
+    mPollInterrupt = false;
+    return 0;
+}
+
+void V4l2CodecDeviceSoft::getStats(Stats &stats)
+{
+    MMAutoLock locker(mLock);
+    stats = mStats;
+    if (mStats.frames) {
+        stats.latencyAvgUs = mLatencySumUs / mStats.frames;
+        stats.dqbufWaitAvgUs = mDqbufWaitSumUs / mStats.frames;
+    }
+}
+
+void V4l2CodecDeviceSoft::logStats_l()
+{
+    if (!mStats.frames)
+        return;
+    INFO("%s: %u frames, latency avg %" PRId64 " max %" PRId64 " us, dqbuf wait avg %" PRId64 " max %" PRId64
+        " us, queued input max %u, capture max %u, capture starved %u\n",
+        mIsEncoder ? "encoder" : "decoder", mStats.frames,
+        mLatencySumUs / mStats.frames, mStats.latencyMaxUs,
+        mDqbufWaitSumUs / mStats.frames, mStats.dqbufWaitMaxUs,
+        mStats.maxInputQueued, mStats.maxCaptureQueued, mStats.captureStarved);
+}
+
+void V4l2CodecDeviceSoft::doneBuffer_l(Queue &queue, uint32_t index)
+{
+    queue.buffers[index].doneUs = getTimeUs();
+    queue.done.push_back(index);
+    mDoneCount++;
+    mPollCond.broadcast();
+}
+
+void V4l2CodecDeviceSoft::clearOutputs_l()
+{
+    while (!mOutputs.empty()) {
+        av_frame_free(&mOutputs.front().frame);
+        av_packet_free(&mOutputs.front().packet);
+        mOutputs.pop_front();
+    }
+}
+
+void V4l2CodecDeviceSoft::work()
+{
+    MMAutoLock locker(mLock);
+    while (!mExit) {
+        if (mPauseCount || !step(locker))
+            mWorkCond.wait();
+    }
+}
+
+// one unit of work, false if there is nothing to do
+bool V4l2CodecDeviceSoft::step(MMAutoLock &locker)
+{
+    if (deliverOutput(locker))
+        return true;
+
+    if (!mOutputQ.streaming || mOutputQ.pending.empty() || mDraining)
+        return false;
+    if (mOutputs.size() >= kMaxPendingOutputs)
+        return false;
+    if (!mCodec && !openCodec())
+        return false;
+
+    uint32_t index = mOutputQ.pending.front();
+    mOutputQ.pending.pop_front();
+    Buffer &in = mOutputQ.buffers[index];
+
+    bool eos = in.flags & V4L2_BUF_FLAG_EOS;
+    int64_t pts = 0;
+    TIMEVAL_TO_INT64(pts, in.timestamp);
+    uint8_t *src[kMaxPlanes] = {NULL, NULL, NULL};
+    for (uint32_t j = 0; j < mOutputQ.planeCount; j++) {
+        if (in.mem[j]) {
+            src[j] = in.mem[j];
+        } else {
+            unsigned long userptr = in.planes[j].m.userptr;
+            // VideoDecodeV4l2 passes its memory in reserved
+            if (!userptr && !j)
+                memcpy(&userptr, in.planes[0].reserved, sizeof(userptr));
+            src[j] = (uint8_t*)userptr;
+        }
+    }
+    uint32_t size = in.planes[0].bytesused;
+    if (!size || !src[0]) {
+        src[0] = NULL;
+        // a buffer without payload ends the stream for the decoder
+        eos = eos || !mIsEncoder;
+    } else {
+        mInputTimes[pts] = in.queuedUs;
+    }
+    bool forceKeyFrame = mForceKeyFrame;
+    mForceKeyFrame = false;
+
+    std::vector<Output> outputs;
+    mBusy = true;
+    locker.unlock();
+    if (mIsEncoder)
+        encode(src[0] ? src : NULL, pts, forceKeyFrame, eos, outputs);
+    else
+        decode(src[0], src[0] ? size : 0, pts, outputs);
+    locker.lock();
+    mBusy = false;
+    mIdleCond.broadcast();
+
+    // nothing else touches the buffers while the worker is busy
+    doneBuffer_l(mOutputQ, index);
+    for (size_t i = 0; i < outputs.size(); i++) {
+        int64_t outPts = outputs[i].frame ? outputs[i].frame->pkt_pts : outputs[i].packet->pts;
+        std::map<int64_t, int64_t>::iterator it = mInputTimes.find(outPts);
+        if (it != mInputTimes.end()) {
+            outputs[i].inputUs = it->second;
+            mInputTimes.erase(it);
+        }
+        mOutputs.push_back(outputs[i]);
+    }
+    if (mInputTimes.size() > 64) {
+        WARNING("%zu inputs without output, drop their times\n", mInputTimes.size());
+        mInputTimes.clear();
+    }
+    if (eos) {
+        DEBUG("input EOS, %zu outputs left\n", mOutputs.size());
+        mDraining = true;
+    }
+    return true;
+}
+
+// moves the oldest output (or the EOS) to a capture buffer
+bool V4l2CodecDeviceSoft::deliverOutput(MMAutoLock &locker)
+{
+    if (mOutputs.empty() && !mDraining)
+        return false;
+
+    if (!mIsEncoder && !mOutputs.empty() && !mResolutionChanged) {
+        AVFrame *frame = mOutputs.front().frame;
+        if (!mFormatKnown || frame->width != mWidth || frame->height != mHeight) {
+            INFO("video size %dx%d -> %dx%d\n", mWidth, mHeight, frame->width, frame->height);
+            mWidth = frame->width;
+            mHeight = frame->height;
+            mFormatKnown = true;
+            if (!mCaptureQ.buffers.empty()) {
+                struct v4l2_event ev;
+                memset(&ev, 0, sizeof(ev));
+                ev.type = V4L2_EVENT_RESOLUTION_CHANGE;
+                mEvents.push_back(ev);
+                mResolutionChanged = true;
+            }
+            mPollCond.broadcast();
+        }
+    }
+    if (mResolutionChanged || !mCaptureQ.streaming)
+        return false;
+
+    if (mCaptureQ.pending.empty()) {
+        if (!mStarved) {
+            mStarved = true;
+            mStats.captureStarved++;
+        }
+        return false;
+    }
+    mStarved = false;
+
+    uint32_t index = mCaptureQ.pending.front();
+    mCaptureQ.pending.pop_front();
+    Buffer &buf = mCaptureQ.buffers[index];
+    memset(buf.planes, 0, sizeof(buf.planes));
+    for (uint32_t j = 0; j < mCaptureQ.planeCount; j++) {
+        buf.planes[j].length = buf.length[j];
+        buf.planes[j].m.mem_offset = kCaptureCookie | (index << 4) | j;
+    }
+    buf.flags = 0;
+    buf.bytesused = 0;
+    buf.inputUs = 0;
+
+    if (mOutputs.empty()) {
+        DEBUG("output EOS on capture buffer %u\n", index);
+        buf.flags = V4L2_BUF_FLAG_EOS | V4L2_BUF_FLAG_LAST;
+        mDraining = false;
+        // ready for the next stream
+        if (mIsEncoder)
+            closeCodec();
+        else if (mCodec)
+            avcodec_flush_buffers(mCodec);
+        doneBuffer_l(mCaptureQ, index);
+        return true;
+    }
+
+    Output out = mOutputs.front();
+    mOutputs.pop_front();
+    mBusy = true;
+    locker.unlock();
+    bool ok = out.frame ? copyFrame(out.frame, buf) : copyPacket(out.packet, buf);
+    locker.lock();
+    mBusy = false;
+    mIdleCond.broadcast();
+
+    int64_t pts = out.frame ? out.frame->pkt_pts : out.packet->pts;
+    INT64_TO_TIMEVAL(pts, buf.timestamp);
+    if (!ok)
+        buf.flags |= V4L2_BUF_FLAG_ERROR;
+    if (out.packet && (out.packet->flags & AV_PKT_FLAG_KEY))
+        buf.flags |= V4L2_BUF_FLAG_KEYFRAME;
+    buf.inputUs = out.inputUs;
+    av_frame_free(&out.frame);
+    av_packet_free(&out.packet);
+    doneBuffer_l(mCaptureQ, index);
+    return true;
+}
+
+bool V4l2CodecDeviceSoft::openCodec()
+{
+    mFrame = av_frame_alloc();
+    if (!mFrame)
+        return false;
+
+    AVCodec *codec = NULL;
+    if (mIsEncoder) {
+        codec = avcodec_find_encoder(AV_CODEC_ID_H264);
+    } else {
+        codec = avcodec_find_decoder(codecIdOf(mOutputFourcc));
+    }
+    if (!codec) {
+        ERROR("no %s for 0x%x\n", mIsEncoder ? "h264 encoder" : "decoder", mOutputFourcc);
+        closeCodec();
+        return false;
+    }
+
+    mCodec = avcodec_alloc_context3(codec);
+    if (!mCodec) {
+        closeCodec();
+        return false;
+    }
+    // one engine as the hardware, frame threads would add their own queue depth
+    mCodec->thread_count = envUint("mm.v4l2.soft.threads", "MM_V4L2_SOFT_THREADS", 1);
+
+    AVDictionary *opts = NULL;
+    if (mIsEncoder) {
+        if (!mFormatKnown) {
+            ERROR("no frame size to encode\n");
+            closeCodec();
+            return false;
+        }
+        mFrame->format = AV_PIX_FMT_YUV420P;
+        mFrame->width = mWidth;
+        mFrame->height = mHeight;
+        if (av_frame_get_buffer(mFrame, 32) < 0) {
+            closeCodec();
+            return false;
+        }
+
+        mCodec->width = mWidth;
+        mCodec->height = mHeight;
+        mCodec->pix_fmt = AV_PIX_FMT_YUV420P;
+        mCodec->time_base.num = 1;
+        mCodec->time_base.den = 1000000;
+        mCodec->framerate.num = mFramerateNum;
+        mCodec->framerate.den = mFramerateDenom;
+        if (mBitrate)
+            mCodec->bit_rate = mBitrate;
+        mCodec->gop_size = mGop ? mGop : mFramerateNum / mFramerateDenom;
+        mCodec->max_b_frames = 0;
+
+        std::string preset = mm_get_env_str("mm.v4l2.soft.preset", "MM_V4L2_SOFT_PRESET");
+        av_dict_set(&opts, "preset", preset.empty() ? kDefaultPreset : preset.c_str(), 0);
+        if (mLowDelay)
+            av_dict_set(&opts, "tune", "zerolatency", 0);
+        if (mBaseline)
+            av_dict_set(&opts, "profile", "baseline", 0);
+        // SPS/PPS in front of every key frame, as the hardware encoders do
+        av_dict_set(&opts, "x264-params", "repeat-headers=1", 0);
+    } else {
+        mCodec->refcounted_frames = 1;
+        if (!mCodecData.empty()) {
+            mCodec->extradata = (uint8_t*)av_mallocz(mCodecData.size() + AV_INPUT_BUFFER_PADDING_SIZE);
+            if (mCodec->extradata) {
+                memcpy(mCodec->extradata, mCodecData.data(), mCodecData.size());
+                mCodec->extradata_size = mCodecData.size();
+            }
+        }
+    }
+
+    int ret = avcodec_open2(mCodec, codec, &opts);
+    av_dict_free(&opts);
+    if (ret < 0) {
+        ERROR("fail to open %s: %d\n", codec->name, ret);
+        closeCodec();
+        return false;
+    }
+    INFO("%s opened, %d threads\n", codec->name, mCodec->thread_count);
+    return true;
+}
+
+void V4l2CodecDeviceSoft::closeCodec()
+{
+    avcodec_free_context(&mCodec);
+    av_frame_free(&mFrame);
+    if (mSws) {
+        sws_freeContext(mSws);
+        mSws = NULL;
+    }
+}
+
+void V4l2CodecDeviceSoft::decode(const uint8_t *data, uint32_t size, int64_t pts, std::vector<Output> &outputs)
+{
+    AVPacket pkt;
+    av_init_packet(&pkt);
+    pkt.data = (uint8_t*)data;
+    pkt.size = size;
+    pkt.pts = size ? pts : AV_NOPTS_VALUE;
+
+    // an empty packet drains the decoder, until no frame comes
+    do {
+        int gotFrame = 0;
+        int len = avcodec_decode_video2(mCodec, mFrame, &gotFrame, &pkt);
+        if (len < 0) {
+            WARNING("decode error %d, pts %" PRId64 "\n", len, pts);
+            break;
+        }
+        if (gotFrame) {
+            Output out = {av_frame_clone(mFrame), NULL, 0};
+            av_frame_unref(mFrame);
+            if (out.frame)
+                outputs.push_back(out);
+        } else if (!size || !len) {
+            break;
+        }
+        if (size) {
+            pkt.data += len;
+            pkt.size -= len;
+        }
+    } while (!size || pkt.size > 0);
+}
+
+void V4l2CodecDeviceSoft::encode(uint8_t **src, int64_t pts, bool forceKeyFrame, bool drain, std::vector<Output> &outputs)
+{
+    AVFrame *frame = NULL;
+    if (src) {
+        AVPixelFormat fmt = pixFmtOf(mOutputFourcc);
+        uint8_t *data[4] = {src[0], src[1], src[2], NULL};
+        int linesizes[4] = {0};
+        av_image_fill_linesizes(linesizes, fmt, mWidth);
+        // planes of one buffer, as VideoEncodeV4l2 passes YUV420
+        if (planeCountOf(mOutputFourcc) > 1 && !data[1])
+            av_image_fill_pointers(data, fmt, mHeight, src[0], linesizes);
+        if (mOutputFourcc == V4L2_PIX_FMT_YVU420)
+            std::swap(data[1], data[2]);
+
+        mSws = sws_getCachedContext(mSws, mWidth, mHeight, fmt, mWidth, mHeight, AV_PIX_FMT_YUV420P,
+                                    SWS_FAST_BILINEAR, NULL, NULL, NULL);
+        // the encoder may still reference the last picture
+        if (!mSws || av_frame_make_writable(mFrame) < 0) {
+            ERROR("no memory for the frame\n");
+        } else {
+            sws_scale(mSws, (const uint8_t* const*)data, linesizes, 0, mHeight, mFrame->data, mFrame->linesize);
+            mFrame->pts = pts;
+            mFrame->pict_type = forceKeyFrame ? AV_PICTURE_TYPE_I : AV_PICTURE_TYPE_NONE;
+            frame = mFrame;
+        }
+    }
+
+    if (frame)
+        encodeFrame(frame, outputs);
+    // a NULL frame drains the encoder, until no unit comes
+    while (drain && encodeFrame(NULL, outputs)) {
+    }
+}
+
+bool V4l2CodecDeviceSoft::encodeFrame(AVFrame *frame, std::vector<Output> &outputs)
+{
+    AVPacket *pkt = av_packet_alloc();
+    int gotPacket = 0;
+    int ret = pkt ? avcodec_encode_video2(mCodec, pkt, frame, &gotPacket) : AVERROR(ENOMEM);
+    if (ret < 0 || !gotPacket) {
+        if (ret < 0)
+            ERROR("encode failed: %d\n", ret);
+        av_packet_free(&pkt);
+        return false;
+    }
+    Output out = {NULL, pkt, 0};
+    outputs.push_back(out);
+    return true;
+}
+
+bool V4l2CodecDeviceSoft::copyFrame(AVFrame *frame, Buffer &buf)
+{
+    int32_t stride = nv12Stride(frame->width);
+    uint8_t *dst[4] = {buf.mem[0], buf.mem[1], NULL, NULL};
+    int dstStrides[4] = {stride, stride, 0, 0};
+
+    mSws = sws_getCachedContext(mSws, frame->width, frame->height, (AVPixelFormat)frame->format,
+                                frame->width, frame->height, AV_PIX_FMT_NV12,
+                                SWS_FAST_BILINEAR, NULL, NULL, NULL);
+    if (!mSws || !dst[0] || !dst[1])
+        return false;
+    sws_scale(mSws, (const uint8_t* const*)frame->data, frame->linesize, 0, frame->height, dst, dstStrides);
+
+    buf.planes[0].bytesused = stride * frame->height;
+    buf.planes[1].bytesused = stride * ((frame->height + 1) / 2);
+    buf.bytesused = buf.planes[0].bytesused + buf.planes[1].bytesused;
+    return true;
+}
+
+bool V4l2CodecDeviceSoft::copyPacket(AVPacket *packet, Buffer &buf)
+{
+    uint32_t size = packet->size;
+    if (size > buf.length[0]) {
+        ERROR("encoded unit of %u bytes doesn't fit the %u bytes buffer\n", size, buf.length[0]);
+        size = buf.length[0];
+    }
+    memcpy(buf.mem[0], packet->data, size);
+    buf.planes[0].bytesused = size;
+    buf.bytesused = size;
+    return size == (uint32_t)packet->size;
+}
+
+} // namespace YUNOS_MM
@@ -0,0 +1,218 @@
+/**
+ * Copyright (C) 2017 Alibaba Group Holding Limited. All Rights Reserved.
+ *
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef v4l2codec_device_soft_h
+#define v4l2codec_device_soft_h
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+#include "multimedia/mm_cpp_utils.h"
+#include "multimedia/mmthread.h"
+#include "v4l2codec_device.h"
+
+struct AVCodecContext;
+struct AVFrame;
+struct AVPacket;
+struct SwsContext;
+
+namespace YUNOS_MM {
+
+/*
+ * V4L2 M2M codec emulated in process on libavcodec, to run VideoDecodeV4l2/VideoEncodeV4l2
+ * without codec hardware (benchmarks and stress tests on servers).
+ * V4l2CodecDevice::create() picks it with mm.v4l2.soft/MM_V4L2_SOFT=1 in builds with _V4L2CODEC_SOFT.
+ * - "decoder": OUTPUT_MPLANE takes the bitstream (1 plane, MMAP or USERPTR), CAPTURE_MPLANE
+ *   returns NV12M (2 planes). capture memory other than MMAP is an opaque handle, the frame stays
+ *   in device memory; MMAP capture planes are memfd backed and VIDIOC_EXPBUF hands out their fds.
+ *   the size is known (G_FMT) after the first decoded frame; a new size once the capture queue
+ *   is set up raises V4L2_EVENT_RESOLUTION_CHANGE and holds the frames until the capture buffers
+ *   are requested again.
+ * - "encoder": OUTPUT_MPLANE takes NV12/NV21/YUV420/YVU420/YUYV/YVYU/RGB32 frames, MMAP or USERPTR;
+ *   CAPTURE_MPLANE returns h264 access units, key frames with SPS/PPS and V4L2_BUF_FLAG_KEYFRAME.
+ * an input buffer with V4L2_BUF_FLAG_EOS (or no payload) drains the codec, the last capture buffer
+ * carries V4L2_BUF_FLAG_EOS | V4L2_BUF_FLAG_LAST.
+ * one worker thread runs the codec, a few outputs are kept while no capture buffer is queued and
+ * input waits after that, like a hardware queue. DQBUF returns -1 with errno EAGAIN when nothing is done.
+ */
+class V4l2CodecDeviceSoft : public V4l2CodecDevice {
+  public:
+    virtual ~V4l2CodecDeviceSoft();
+
+    virtual int32_t ioctl(uint64_t request, void* arg);
+    virtual int32_t poll(bool poll_device, bool* event_pending);
+    virtual int32_t setDevicePollInterrupt();
+    virtual int32_t clearDevicePollInterrupt();
+    virtual void* mmap(void* addr, size_t length, uint32_t prot, uint32_t flags, uint32_t offset);
+    virtual int32_t munmap(void* addr, size_t length);
+    virtual int32_t setParameter(const char* key, const char* value);
+
+    // since open, also logged at capture STREAMOFF and close
+    struct Stats {
+        uint32_t frames;            // capture buffers dequeued with payload
+        int64_t latencyAvgUs;       // input QBUF to capture DQBUF
+        int64_t latencyMaxUs;
+        int64_t dqbufWaitAvgUs;     // capture buffer done to DQBUF, the client's share
+        int64_t dqbufWaitMaxUs;
+        uint32_t maxInputQueued;    // input buffers queued and not processed, high water mark
+        uint32_t maxCaptureQueued;
+        uint32_t captureStarved;    // times an output waited for a capture buffer
+    };
+    void getStats(Stats &stats);
+
+  protected:
+    V4l2CodecDeviceSoft();
+    virtual bool open(const char* name, uint32_t flags);
+    virtual bool close();
+
+  private:
+    enum {
+        kMaxPlanes = 3
+    };
+    struct Buffer {
+        Buffer();
+        uint8_t *mem[kMaxPlanes];              // device memory, NULL for client memory
+        uint32_t length[kMaxPlanes];
+        int fd[kMaxPlanes];                    // memfd behind exportable memory, -1 for heap memory
+        struct v4l2_plane planes[kMaxPlanes];  // as queued, handed back on DQBUF
+        unsigned long handle;                  // m.userptr of a capture buffer, not touched
+        uint32_t flags;
+        uint32_t bytesused;
+        struct timeval timestamp;
+        int64_t queuedUs;
+        int64_t inputUs;                       // QBUF time of the input behind a capture buffer
+        int64_t doneUs;
+        bool queued;
+    };
+    struct Queue {
+        Queue();
+        uint32_t memory;
+        uint32_t planeCount;
+        bool streaming;
+        std::vector<Buffer> buffers;
+        std::deque<uint32_t> pending;   // queued by the client, not processed yet
+        std::deque<uint32_t> done;      // for DQBUF
+    };
+    // decoded frame or encoded unit waiting for a capture buffer
+    struct Output {
+        AVFrame *frame;
+        AVPacket *packet;
+        int64_t inputUs;
+    };
+
+    class WorkerThread : public MMThread {
+      public:
+        explicit WorkerThread(V4l2CodecDeviceSoft *owner);
+      protected:
+        virtual void main();
+      private:
+        V4l2CodecDeviceSoft *mOwner;
+    };
+
+    Queue *queueOf(uint32_t type);
+    int32_t querycap(struct v4l2_capability *caps);
+    int32_t setFormat(struct v4l2_format *format);
+    int32_t getFormat(struct v4l2_format *format);
+    int32_t setParm(struct v4l2_streamparm *parms);
+    int32_t setExtCtrls(struct v4l2_ext_controls *control);
+    int32_t getCtrl(struct v4l2_control *ctrl);
+    int32_t reqbufs(struct v4l2_requestbuffers *reqbufs);
+    int32_t querybuf(struct v4l2_buffer *buf);
+    int32_t qbuf(struct v4l2_buffer *buf);
+    int32_t dqbuf(struct v4l2_buffer *buf);
+    int32_t stream(uint32_t type, bool on);
+    int32_t dqevent(struct v4l2_event *ev);
+    int32_t expbuf(struct v4l2_exportbuffer *expbuf);
+
+    void pauseWorker_l();
+    void resumeWorker_l();
+    void freeBuffers_l(Queue &queue);
+    void allocBuffers_l(Queue &queue, bool capture, uint32_t count);
+    static int createSharedMemory(size_t length, uint8_t **mem);
+    void doneBuffer_l(Queue &queue, uint32_t index);
+    void clearOutputs_l();
+    void logStats_l();
+
+    // worker thread, the codec is only used there (or while the worker is paused)
+    void work();
+    bool step(MMAutoLock &locker);
+    bool deliverOutput(MMAutoLock &locker);
+    bool openCodec();
+    void closeCodec();
+    void decode(const uint8_t *data, uint32_t size, int64_t pts, std::vector<Output> &outputs);
+    void encode(uint8_t **src, int64_t pts, bool forceKeyFrame, bool drain, std::vector<Output> &outputs);
+    bool encodeFrame(AVFrame *frame, std::vector<Output> &outputs);
+    bool copyFrame(AVFrame *frame, Buffer &buf);
+    bool copyPacket(AVPacket *packet, Buffer &buf);
+
+    bool mIsEncoder;
+    Queue mOutputQ;     // V4L2 OUTPUT: bitstream to decode, frames to encode
+    Queue mCaptureQ;    // V4L2 CAPTURE: decoded frames, encoded units
+
+    // OUTPUT format: the codec for the decoder, the raw format for the encoder
+    uint32_t mOutputFourcc;
+    uint32_t mBitstreamSize;
+    std::string mCodecData;
+    // frame size: decoded (G_FMT) or to encode (S_FMT)
+    int32_t mWidth;
+    int32_t mHeight;
+    bool mFormatKnown;
+    uint32_t mMinCaptureBuffers;
+
+    // encoder settings
+    int32_t mFramerateNum;
+    int32_t mFramerateDenom;
+    int32_t mBitrate;
+    int32_t mGop;
+    bool mBaseline;
+    bool mLowDelay;
+    bool mForceKeyFrame;
+
+    AVCodecContext *mCodec;
+    AVFrame *mFrame;
+    SwsContext *mSws;
+
+    std::deque<Output> mOutputs;
+    std::map<int64_t, int64_t> mInputTimes;   // pts to QBUF time
+    std::deque<struct v4l2_event> mEvents;
+    bool mResolutionChanged;
+    bool mDraining;     // EOS taken from input, not on a capture buffer yet
+    bool mStarved;
+
+    Lock mLock;
+    Condition mWorkCond;
+    Condition mIdleCond;
+    Condition mPollCond;
+    MMSharedPtr<WorkerThread> mWorker;
+    bool mExit;
+    bool mBusy;         // the worker runs the codec without the lock
+    int32_t mPauseCount;
+    bool mPollInterrupt;
+    uint32_t mDoneCount;
+    uint32_t mPolledDoneCount;
+
+    Stats mStats;
+    int64_t mLatencySumUs;
+    int64_t mDqbufWaitSumUs;
+
+    friend class V4l2CodecDevice;
+    MM_DISALLOW_COPY(V4l2CodecDeviceSoft);
+};
+
+} // namespace YUNOS_MM
+
+#endif // v4l2codec_device_soft_h
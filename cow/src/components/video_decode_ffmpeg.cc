@@ -671,36 +671,50 @@ void VideoDecodeFFmpeg::onPrepare(param1_type param1, param2_type param2, uint32
 
     notify(kEventInfo, kEventCostMemorySize, memorySize, nilParam);
 #endif
+    // open the codec while the other components prepare, instead of delaying the first frame at start
+    if (openCodec_l() != MM_ERROR_SUCCESS) {
+        notify(kEventPrepareResult, MM_ERROR_OP_FAILED, 0, nilParam);
+        EXIT();
+    }
     notify(kEventPrepareResult, MM_ERROR_SUCCESS, 0, nilParam);
     EXIT();
 }
 
+mm_status_t VideoDecodeFFmpeg::openCodec_l()
+{
+    if (mAVCodec)
+        return MM_ERROR_SUCCESS;
+
+    AVCodec *codec = avcodec_find_decoder((AVCodecID)mCodecID);
+    if (codec == NULL) {
+        ERROR("error no Codec found :%d\n", mCodecID);
+        return MM_ERROR_OP_FAILED;
+    }
 
+    int64_t begin = getTimeUs();
+    if(mAVCodecContextLock)
+        mAVCodecContextLock->acquire();
+    int ret = avcodec_open2(mAVCodecContext, codec, NULL);
+    if(mAVCodecContextLock)
+        mAVCodecContextLock->release();
+    if ( ret < 0) {
+        ERROR("error avcodec_open failed:%d\n",ret);
+        return MM_ERROR_OP_FAILED;
+    }
+
+    mAVCodec = codec;
+    INFO("codec %d opened, cost %" PRId64 " us", mCodecID, getTimeUs() - begin);
+    return MM_ERROR_SUCCESS;
+}
 
 void VideoDecodeFFmpeg::onStart(param1_type param1, param2_type param2, uint32_t rspId)
 {
     ENTER();
     MMAutoLock locker(mLock);
-    if (mAVCodec == NULL) {
-        int ret = -1;
-        mAVCodec = avcodec_find_decoder((AVCodecID)mCodecID);
-        if (mAVCodec == NULL) {
-            ERROR("error no Codec found :%d\n", mCodecID);
-            notify(kEventStartResult, MM_ERROR_OP_FAILED, 0, nilParam);
-            EXIT();
-        }
-        {
-            if(mAVCodecContextLock)
-                mAVCodecContextLock->acquire();
-            ret = avcodec_open2(mAVCodecContext, mAVCodec, NULL);
-            if(mAVCodecContextLock)
-                mAVCodecContextLock->release();
-        }
-        if ( ret < 0) {
-            ERROR("error avcodec_open failed:%d\n",ret);
-            notify(kEventStartResult, MM_ERROR_OP_FAILED, 0, nilParam);
-            EXIT();
-        }
+    // reopen after stop
+    if (openCodec_l() != MM_ERROR_SUCCESS) {
+        notify(kEventStartResult, MM_ERROR_OP_FAILED, 0, nilParam);
+        EXIT();
     }
 
     if (!mDecodeThread) {
@@ -781,6 +795,15 @@ void VideoDecodeFFmpeg::onReset(param1_type param1, param2_type param2, uint32_t
         }
     }
     MMAutoLock locker(mLock);
+    // opened at prepare, reset may come without stop
+    if (mAVCodec && mAVCodecContext) {
+        if(mAVCodecContextLock)
+            mAVCodecContextLock->acquire();
+        avcodec_close(mAVCodecContext);
+        mAVCodec = NULL;
+        if(mAVCodecContextLock)
+            mAVCodecContextLock->release();
+    }
     release();
     mReader.reset();
     mWriter.reset();
@@ -125,6 +125,7 @@ private:
     AVCodecID CodecId2AVCodecId(CowCodecID id);
     MediaBufferSP createMediaBufferFromAVFrame();
     mm_status_t parseInputMeta(MediaMetaSP & meta);
+    mm_status_t openCodec_l();
     static bool releaseOutputBuffer(MediaBuffer* mediaBuffer);
     static bool releaseOutputAVBuffer(MediaBuffer* mediaBuffer);
 #ifdef __USEING_SOFT_VIDEO_CODEC_FOR_MS__
@@ -20,6 +20,7 @@
 #include <unistd.h>
 #include <errno.h>
 #include <sys/mman.h>
+#include <fcntl.h>
 #include <stdlib.h>
 #include <arpa/inet.h>
 #include <iostream>
@@ -336,6 +337,10 @@ VideoDecodeV4l2::VideoDecodeV4l2(const char* mimeType, bool isEncoder)
     , mLastTimeInputRetry(0)
     , mOutputQueueCapacity(0)
     , mOutputPlaneCount(0)
+    , mInputQueueDepth(kInputBufferCount)
+    , mOutputExtraFrames(kExtraOutputFrameCount)
+    , mOutputDmaBuf(false)
+    , mOutputExported(false)
     , mDumpInput(false)
     , mDumpOutput(false)
     , mSurfaceWrapper(NULL)
@@ -363,6 +368,7 @@ VideoDecodeV4l2::VideoDecodeV4l2(const char* mimeType, bool isEncoder)
 
     if (mm_check_env_str("mm.vdv4l2.memory.userptr","MM_VDV4L2_MEMORY_USERPTR", "1"))
         mInputMemoryType = V4L2_MEMORY_USERPTR;
+    mOutputDmaBuf = mm_check_env_str("mm.vdv4l2.output.dmabuf","MM_VDV4L2_OUTPUT_DMABUF", "1", 0);
 
     mDumpOutput = mm_check_env_str("mm.vdv4l2.dump.output","MM_VDV4L2_DUMP_OUTPUT", "1", 0);
     mDumpInput = mm_check_env_str("mm.vdv4l2.dump.input","MM_VDV4L2_DUMP_INPUT", "1", 0);
@@ -623,13 +629,19 @@ void VideoDecodeV4l2::onPrepare(param1_type param1, param2_type param2, uint32_t
     ASSERT(mV4l2Decoder);
 
     // set output frame memory type
+    if (mOutputDmaBuf) {
+        // frames are decoded to the device's own buffers, no surface buffer is handed over
+        mOutputMemoryType = V4L2_MEMORY_MMAP;
+    } else {
 #if defined (__MM_YUNOS_CNTRHAL_BUILD__)
-    mV4l2Decoder->setParameter("frame-memory-type", "plugin-buffer-handle");
-    mOutputMemoryType = (enum v4l2_memory)V4L2_MEMORY_PLUGIN_BUFFER_HANDLE;
+        mV4l2Decoder->setParameter("frame-memory-type", "plugin-buffer-handle");
+        mOutputMemoryType = (enum v4l2_memory)V4L2_MEMORY_PLUGIN_BUFFER_HANDLE;
 #elif defined(__MM_YUNOS_YUNHAL_BUILD__)
-    mV4l2Decoder->setParameter("frame-memory-type", "yunos-native-target");
-    mOutputMemoryType = (enum v4l2_memory)V4L2_MEMORY_MMAP;
-#elif defined(__MM_YUNOS_LINUX_BSP_BUILD__)
+        mV4l2Decoder->setParameter("frame-memory-type", "yunos-native-target");
+        mOutputMemoryType = (enum v4l2_memory)V4L2_MEMORY_MMAP;
+#endif
+    }
+#if defined(__MM_YUNOS_LINUX_BSP_BUILD__)
     if (mDecodeThumbNail) {
         mV4l2Decoder->setParameter(MEDIA_ATTR_DECODE_MODE, MEDIA_ATTR_DECODE_THUMBNAIL);
     }
@@ -712,6 +724,8 @@ mm_status_t VideoDecodeV4l2::handlePortSettingChanged()
     int ioctlRet = 0;
 
     // 3. free all output buffers: reqbufs.count = 0
+    if (mOutputDmaBuf)
+        releaseDeviceOutputBuffers();
     struct v4l2_requestbuffers reqbufs;
     memset(&reqbufs, 0, sizeof(reqbufs));
     reqbufs.type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
@@ -736,11 +750,12 @@ mm_status_t VideoDecodeV4l2::handlePortSettingChanged()
         } else if (mOutputFrames[i].mOwner == BufferInfo::OWNED_BY_NATIVE_WINDOW) {
             continue;
         }
-        cancelBufferToNativeWindow(&mOutputFrames[i]);
+        if (!mOutputDmaBuf)
+            cancelBufferToNativeWindow(&mOutputFrames[i]);
     }
 
     // 6. reallocate buffers
-    mm_status_t status = allocateOutputBuffersFromNativeWindow();
+    mm_status_t status = mOutputDmaBuf ? allocateOutputBuffers() : allocateOutputBuffersFromNativeWindow();
     if (status != MM_ERROR_SUCCESS) {
         notify(kEventError, MM_ERROR_NO_MEM, 0, nilParam);
         return status;
@@ -879,8 +894,9 @@ mm_status_t VideoDecodeV4l2::allocateOutputBuffers()
     memset(&ctrl, 0, sizeof(ctrl));
     ctrl.id = V4L2_CID_MIN_BUFFERS_FOR_CAPTURE;
     ioctlRet = mV4l2Decoder->ioctl(VIDIOC_G_CTRL, &ctrl);
-    CHECK_V4L2_CMD_RESULT(ioctlRet, VIDIOC_G_CTRL);
+    CHECK_V4L2_CMD_RESULT_RET(ioctlRet, VIDIOC_G_CTRL);
     mOutputQueueCapacity = ctrl.value ? ctrl.value : mOutputQueueCapacity;
+    mVideoDpbSize = ctrl.value;
 
     struct v4l2_requestbuffers reqbufs;
     memset(&reqbufs, 0, sizeof(reqbufs));
@@ -888,15 +904,24 @@ mm_status_t VideoDecodeV4l2::allocateOutputBuffers()
     reqbufs.memory = mOutputMemoryType;
     // Check mOutputQueueCapacity here, otherwise output buffer count is 2, cause to block here.
     mOutputQueueCapacity = (mOutputQueueCapacity == 0) ? 3 : mOutputQueueCapacity;
-    reqbufs.count = mOutputQueueCapacity + kExtraOutputFrameCount;
+    reqbufs.count = mOutputQueueCapacity + mOutputExtraFrames;
     DEBUG("reqbufs.count %d", reqbufs.count);
     ioctlRet = mV4l2Decoder->ioctl(VIDIOC_REQBUFS, &reqbufs);
-    CHECK_V4L2_CMD_RESULT(ioctlRet, VIDIOC_REQBUFS);
+    CHECK_V4L2_CMD_RESULT_RET(ioctlRet, VIDIOC_REQBUFS);
     ASSERT(reqbufs.count>0);
     mOutputQueueCapacity = reqbufs.count;
     DEBUG("reqbufs.count %d", reqbufs.count);
 
+    // plane pitch of the decoded frames
+    struct v4l2_format format;
+    memset(&format, 0, sizeof(format));
+    format.type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+    ioctlRet = mV4l2Decoder->ioctl(VIDIOC_G_FMT, &format);
+    CHECK_V4L2_CMD_RESULT_RET(ioctlRet, VIDIOC_G_FMT);
+
+    mOutputFrames.clear();
     mOutputFrames.resize(mOutputQueueCapacity);
+    mOutputExported = true;
     uint32_t i=0;
     for (i=0; i<mOutputQueueCapacity; i++) {
         struct v4l2_plane planes[kMaxOutputPlaneCount];
@@ -909,47 +934,111 @@ mm_status_t VideoDecodeV4l2::allocateOutputBuffers()
         buffer.m.planes = planes;
         buffer.length = mOutputPlaneCount;
         ioctlRet = mV4l2Decoder->ioctl(VIDIOC_QUERYBUF, &buffer);
-        CHECK_V4L2_CMD_RESULT(ioctlRet, VIDIOC_QUERYBUF);
+        CHECK_V4L2_CMD_RESULT_RET(ioctlRet, VIDIOC_QUERYBUF);
 
         mOutputFrames[i].width = mWidth;
         mOutputFrames[i].height = mHeight;
         mOutputFrames[i].fourcc = mFormat;
 
-        if (mOutputMemoryType == V4L2_MEMORY_MMAP) {
-            for (uint32_t j=0; j<mOutputPlaneCount; j++) {
-                // length and mem_offset are filled by VIDIOC_QUERYBUF above
-                void* address = mV4l2Decoder->mmap(NULL,
-                                              buffer.m.planes[j].length,
-                                              PROT_READ | PROT_WRITE,
-                                              MAP_SHARED,
-                                              buffer.m.planes[j].m.mem_offset);
-                ASSERT(address);
-                if (j == 0) {
-                    mOutputFrames[i].data = static_cast<uint8_t*>(address);
-                    mOutputFrames[i].offset[0] = 0;
-                } else {
-                    mOutputFrames[i].offset[j] = static_cast<uint8_t*>(address) - mOutputFrames[i].data;
-                }
-
-                //mOutputFrames[i].pitch[j] = format.fmt.pix_mp.plane_fmt[j].bytesperline;
-                DEBUG("mOutputFrames[%d][%d] = %p\n", i, j, address);
+        for (uint32_t j=0; j<mOutputPlaneCount; j++) {
+            // length and mem_offset are filled by VIDIOC_QUERYBUF above
+            void* address = mV4l2Decoder->mmap(NULL,
+                                          buffer.m.planes[j].length,
+                                          PROT_READ | PROT_WRITE,
+                                          MAP_SHARED,
+                                          buffer.m.planes[j].m.mem_offset);
+            ASSERT(address);
+            mOutputFrames[i].data[j] = static_cast<uint8_t*>(address);
+            mOutputFrames[i].length[j] = buffer.m.planes[j].length;
+            mOutputFrames[i].pitch[j] = format.fmt.pix_mp.plane_fmt[j].bytesperline ?
+                format.fmt.pix_mp.plane_fmt[j].bytesperline : mWidth;
+            DEBUG("mOutputFrames[%d][%d] = %p, pitch %d\n", i, j, address, mOutputFrames[i].pitch[j]);
+
+            if (!mOutputExported)
+                continue;
+            struct v4l2_exportbuffer expbuf;
+            memset(&expbuf, 0, sizeof(expbuf));
+            expbuf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+            expbuf.index = i;
+            expbuf.plane = j;
+            expbuf.flags = O_CLOEXEC | O_RDWR;
+            if (mV4l2Decoder->ioctl(VIDIOC_EXPBUF, &expbuf) == 0) {
+                mOutputFrames[i].fd[j] = expbuf.fd;
+            } else {
+                WARNING("VIDIOC_EXPBUF isn't supported, decoded frames are copied out");
+                mOutputExported = false;
             }
         }
 
         // feed the output frame to v4l2codec
-        // FIXME, multi-plane frame are enqued multi-times
-        int ioctlRet = mV4l2Decoder->ioctl(VIDIOC_QBUF, &buffer);
-        CHECK_V4L2_CMD_RESULT(ioctlRet, VIDIOC_QBUF);
+        ioctlRet = mV4l2Decoder->ioctl(VIDIOC_QBUF, &buffer);
+        CHECK_V4L2_CMD_RESULT_RET(ioctlRet, VIDIOC_QBUF);
+        mOutputFrames[i].mOwner = BufferInfo::OWNED_BY_V4L2CCODEC;
+    }
+
+    if (!mOutputExported) {
+        // don't keep the fds exported before the failure
+        for (i=0; i<mOutputQueueCapacity; i++) {
+            for (uint32_t j=0; j<mOutputPlaneCount; j++) {
+                if (mOutputFrames[i].fd[j] >= 0) {
+                    ::close(mOutputFrames[i].fd[j]);
+                    mOutputFrames[i].fd[j] = -1;
+                }
+            }
+        }
     }
+    INFO("%d output buffers in device memory, exported %d", mOutputQueueCapacity, mOutputExported);
 
      // start output port
     __u32 type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
     ioctlRet = mV4l2Decoder->ioctl(VIDIOC_STREAMON, &type);
-    CHECK_V4L2_CMD_RESULT(ioctlRet, VIDIOC_STREAMON);
+    CHECK_V4L2_CMD_RESULT_RET(ioctlRet, VIDIOC_STREAMON);
+
+    return MM_ERROR_SUCCESS;
+}
+
+mm_status_t VideoDecodeV4l2::queueDeviceOutputBuffer(uint32_t index)
+{
+    struct v4l2_plane planes[kMaxOutputPlaneCount];
+    struct v4l2_buffer buffer;
+    memset(&buffer, 0, sizeof(buffer));
+    memset(planes, 0, sizeof(planes));
+    buffer.index = index;
+    buffer.type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+    buffer.memory = mOutputMemoryType;
+    buffer.m.planes = planes;
+    buffer.length = mOutputPlaneCount;
+
+    int ioctlRet = mV4l2Decoder->ioctl(VIDIOC_QBUF, &buffer);
+    if (ioctlRet != 0) {
+        ERROR("fail to enqueue output buffer[%d], ret %d, errno %d", index, ioctlRet, errno);
+        return MM_ERROR_UNKNOWN;
+    }
+    DEBUG("enqueue one output buffer[%d] to codec", index);
+    mOutputFrames[index].mOwner = BufferInfo::OWNED_BY_V4L2CCODEC;
 
     return MM_ERROR_SUCCESS;
 }
 
+void VideoDecodeV4l2::releaseDeviceOutputBuffers()
+{
+    // a sink importing the dma-buf keeps its own reference to the memory
+    for (uint32_t i = 0; i < mOutputFrames.size(); i++) {
+        BufferInfo &frame = mOutputFrames[i];
+        for (int j = 0; j < kMaxOutputPlaneCount; j++) {
+            if (frame.fd[j] >= 0) {
+                ::close(frame.fd[j]);
+                frame.fd[j] = -1;
+            }
+            if (frame.data[j]) {
+                mV4l2Decoder->munmap(frame.data[j], frame.length[j]);
+                frame.data[j] = NULL;
+            }
+        }
+    }
+    mOutputExported = false;
+}
+
 int VideoDecodeV4l2::getCSDInfo(uint8_t *data, int32_t &size)
 {
     ASSERT(data);
@@ -1360,7 +1449,9 @@ mm_status_t VideoDecodeV4l2::renderOutputBuffer(struct v4l2_buffer *buf, bool re
 
 
     // DO NOT queue output buffer to codec if format changed
-    if (mState < kStateStopping && !mPortSettingChange) {
+    if (mState < kStateStopping && !mPortSettingChange && mOutputDmaBuf) {
+        queueDeviceOutputBuffer(buf->index);
+    } else if (mState < kStateStopping && !mPortSettingChange) {
         buf->m.userptr = (unsigned long)mm_getBufferHandle(mOutputFrames[buf->index].mANB);
         int ioctlRet = mV4l2Decoder->ioctl(VIDIOC_QBUF, buf);
         DEBUG("enqueue one output buffer[%d]: %p, handle %p to codec",
@@ -1417,7 +1508,7 @@ mm_status_t VideoDecodeV4l2::renderOutputBuffer(struct v4l2_buffer *buf, bool re
 
     int32_t isRender = 0; // set to 0 means not to render as default
     ret = meta->getInt32(MEDIA_ATTR_IS_VIDEO_RENDER, isRender);
-    if (decoder->mSurfaceOwnedByUs || decoder->mDecodeThumbNail) {
+    if (decoder->mSurfaceOwnedByUs || decoder->mDecodeThumbNail || decoder->mOutputDmaBuf) {
         isRender = false;
     }
 
@@ -1438,11 +1529,15 @@ void VideoDecodeV4l2::onHandleOutputBuffer(param1_type param1, param2_type param
     int64_t pts = 0;
 
     do {
-        struct v4l2_buffer *buf = (struct v4l2_buffer*)calloc(1, sizeof(struct v4l2_buffer));
+        // device memory buffers are dequeued with their planes, kept behind the v4l2_buffer
+        size_t bufSize = sizeof(struct v4l2_buffer);
+        if (mOutputDmaBuf)
+            bufSize += sizeof(struct v4l2_plane) * kMaxOutputPlaneCount;
+        struct v4l2_buffer *buf = (struct v4l2_buffer*)calloc(1, bufSize);
 
         buf->type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE; //decode output
         buf->memory = mOutputMemoryType;
-        buf->m.planes = NULL;
+        buf->m.planes = mOutputDmaBuf ? (struct v4l2_plane*)(buf + 1) : NULL;
         buf->length = mOutputPlaneCount;
 
         ioctlRet = mV4l2Decoder->ioctl(VIDIOC_DQBUF, buf);
@@ -1510,13 +1605,15 @@ void VideoDecodeV4l2::onHandleOutputBuffer(param1_type param1, param2_type param
     #endif
 
     #ifdef __MM_YUNOS_YUNHAL_BUILD__
-        if (mDumpOutput)
+        if (mDumpOutput && mOutputFrames[buf->index].mANB)
             dumpBuffer((MMBufferHandleT)mm_getBufferHandle(mOutputFrames[buf->index].mANB),
                        mOutputFrames[buf->index].mANB->stride,
                        mOutputFrames[buf->index].mANB->height);
     #endif
         MediaBufferSP mediaBuffer;
-        if (mSurfaceOwnedByUs || mDecodeThumbNail) {
+        if (mOutputDmaBuf) {
+            mediaBuffer = createDmaBufMediaBuffer(buf);
+        } else if (mSurfaceOwnedByUs || mDecodeThumbNail) {
             mediaBuffer = createRawMediaBuffer(buf);
         } else {
             mediaBuffer = createHwMediaBuffer(buf);
@@ -1576,6 +1673,71 @@ MediaBufferSP VideoDecodeV4l2::createHwMediaBuffer(v4l2_buffer *buf)
     return mediaBuffer;
 }
 
+MediaBufferSP VideoDecodeV4l2::createDmaBufMediaBuffer(v4l2_buffer *buf)
+{
+    int64_t pts = 0;
+    BufferInfo &frame = mOutputFrames[buf->index];
+    int32_t chromaRows = (mHeight + 1) / 2;
+    int32_t size = mWidth * (mHeight + chromaRows);
+    MediaBufferSP mediaBuffer;
+
+    if (mOutputExported) {
+        // the sink imports the planes, the frame goes back to the codec on release
+        mediaBuffer = MediaBuffer::createMediaBuffer(MediaBuffer::MBT_DmaBufHandle);
+        uintptr_t buffers[kMaxOutputPlaneCount] = {0};
+        int32_t offsets[kMaxOutputPlaneCount] = {0};
+        int32_t strides[kMaxOutputPlaneCount] = {0};
+        for (uint32_t j = 0; j < mOutputPlaneCount; j++) {
+            buffers[j] = frame.fd[j];
+            strides[j] = frame.pitch[j];
+        }
+        mediaBuffer->setBufferInfo(buffers, offsets, strides, mOutputPlaneCount);
+    } else {
+        // fallback: one copy to packed NV12
+        mediaBuffer = MediaBuffer::createMediaBuffer(MediaBuffer::MBT_RawVideo);
+        uint8_t *data = new uint8_t[size];
+        uint8_t *dst = data;
+        for (uint32_t j = 0; j < mOutputPlaneCount && j < 2; j++) {
+            int32_t rows = j ? chromaRows : mHeight;
+            if (frame.pitch[j] == (uint32_t)mWidth) {
+                memcpy(dst, frame.data[j], mWidth * rows);
+            } else {
+                for (int32_t i = 0; i < rows; i++) {
+                    memcpy(dst + mWidth * i, frame.data[j] + frame.pitch[j] * i, mWidth);
+                }
+            }
+            dst += mWidth * rows;
+        }
+        int32_t offset = 0;
+        mediaBuffer->setBufferInfo((uintptr_t *)&data, &offset, &size, 1);
+    }
+    mediaBuffer->setSize(size);
+
+    if (buf->flags & V4L2_BUF_FLAG_EOS) {
+        mediaBuffer->setFlag(MediaBuffer::MBFT_EOS);
+        mEosState = kOutputEOS;
+        setState(kStatePaused);
+        DEBUG("VDV4L2-EOS, setDevicePollInterrupt");
+        mV4l2Decoder->setDevicePollInterrupt();
+    }
+
+    MediaMetaSP meta = mediaBuffer->getMediaMeta();
+    meta->setInt32(MEDIA_ATTR_WIDTH, mWidth);
+    meta->setInt32(MEDIA_ATTR_HEIGHT, mHeight);
+    meta->setInt32(MEDIA_ATTR_COLOR_FOURCC, 'NV12');
+    meta->setInt32(MEDIA_ATTR_STRIDE, mOutputExported ? frame.pitch[0] : mWidth);
+    meta->setPointer("v4l2-buffer", buf);
+    meta->setPointer("v4l2-decoder", this);
+
+    buf->sequence = mGeneration;
+
+    TIMEVAL_TO_INT64(pts, buf->timestamp);
+    mediaBuffer->setPts(pts);
+    mediaBuffer->addReleaseBufferFunc(releaseOutputBuffer);
+
+    return mediaBuffer;
+}
+
 MediaBufferSP VideoDecodeV4l2::createRawMediaBuffer(v4l2_buffer *buf)
 {
     MediaBufferSP buffer = MediaBuffer::createMediaBuffer(MediaBuffer::MBT_RawVideo);
@@ -1701,11 +1863,16 @@ void VideoDecodeV4l2::onStartInput(param1_type param1, param2_type param2, uint3
         CHECK_V4L2_CMD_RESULT(ioctlRet, VIDIOC_STREAMON);
 
         // setup input buffers
+        if (mInputMemoryType == V4L2_MEMORY_USERPTR && mIsAVCcType && mForceByteStream) {
+            // avcC input is rewritten to annexb (and prefixed with sps/pps) in device memory
+            WARNING("avcC input can't be queued as userptr, use mmap input buffers");
+            mInputMemoryType = V4L2_MEMORY_MMAP;
+        }
         struct v4l2_requestbuffers reqbufs;
         memset(&reqbufs, 0, sizeof(reqbufs));
         reqbufs.type = V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE;
         reqbufs.memory = mInputMemoryType;
-        reqbufs.count = kInputBufferCount;
+        reqbufs.count = mInputQueueDepth;
         ioctlRet = mV4l2Decoder->ioctl(VIDIOC_REQBUFS, &reqbufs);
         CHECK_V4L2_CMD_RESULT(ioctlRet, VIDIOC_REQBUFS);
         ASSERT(reqbufs.count>0);
@@ -1926,7 +2093,7 @@ mm_status_t VideoDecodeV4l2::configOutputSurface()
     reqbufs.type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
     reqbufs.memory = mOutputMemoryType;
 
-    for (uint32_t extraBuffers = kExtraOutputFrameCount; /*condition inside*/; extraBuffers--) {
+    for (uint32_t extraBuffers = mOutputExtraFrames; /*condition inside*/; extraBuffers--) {
         DEBUG("mOutputQueueCapacity =%u, minUndequeuedBuffers=%u, extraBuffers=%u",
             mOutputQueueCapacity, minUndequeuedBuffers, extraBuffers);
         uint32_t newBufferCount = mOutputQueueCapacity;
@@ -2067,8 +2234,13 @@ void VideoDecodeV4l2::onStartOutput(param1_type param1, param2_type param2, uint
         // Number of output buffers we need.
 
         // setup output buffers
-        setSurface();
-        mm_status_t status = allocateOutputBuffersFromNativeWindow();
+        mm_status_t status = MM_ERROR_SUCCESS;
+        if (mOutputDmaBuf) {
+            status = allocateOutputBuffers();
+        } else {
+            setSurface();
+            status = allocateOutputBuffersFromNativeWindow();
+        }
         if (status != MM_ERROR_SUCCESS) {
             DEBUG("allocate outout buffer failed, status %d", status);
             notify(kEventStartResult, status, 0, nilParam);
@@ -2155,6 +2327,9 @@ void VideoDecodeV4l2::onStop(param1_type param1, param2_type param2, uint32_t rs
     ioctlRet = mV4l2Decoder->ioctl(VIDIOC_REQBUFS, &reqbufs);
     CHECK_V4L2_CMD_RESULT(ioctlRet, VIDIOC_REQBUFS);
 
+    // device memory can't be freed while it is mapped
+    if (mOutputDmaBuf)
+        releaseDeviceOutputBuffers();
     memset(&reqbufs, 0, sizeof(reqbufs));
     reqbufs.type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
     reqbufs.memory = mOutputMemoryType;
@@ -2191,7 +2366,8 @@ void VideoDecodeV4l2::onStop(param1_type param1, param2_type param2, uint32_t rs
         } else if (mOutputFrames[i].mOwner == BufferInfo::OWNED_BY_NATIVE_WINDOW) {
             continue;
         }
-        cancelBufferToNativeWindow(&mOutputFrames[i]);
+        if (!mOutputDmaBuf)
+            cancelBufferToNativeWindow(&mOutputFrames[i]);
     }
 
 
@@ -2283,6 +2459,10 @@ void VideoDecodeV4l2::onFlush(param1_type param1, param2_type param2, uint32_t r
 
         if (mOutputFrames[i].mOwner == BufferInfo::OWNED_BY_NATIVE_WINDOW)
             continue;
+        if (mOutputDmaBuf) {
+            queueDeviceOutputBuffer(i);
+            continue;
+        }
 
         memset(&buffer, 0, sizeof(buffer));
         buffer.index = i;
@@ -2367,6 +2547,60 @@ mm_status_t VideoDecodeV4l2::setParameter(const MediaMetaSP & meta)
             INFO("key: %s, value: %d\n", item.mName, mMemorySize);
             continue;
         }
+        else if ( !strcmp(item.mName, "input-buffer-count") ) {
+            if ( item.mType != MediaMeta::MT_Int32 || item.mValue.ii <= 0 ) {
+                WARNING("invalid type or value for %s\n", item.mName);
+                continue;
+            }
+            // takes effect when the input port is set up, the driver may adjust it
+            mInputQueueDepth = item.mValue.ii;
+            INFO("key: %s, value: %d\n", item.mName, mInputQueueDepth);
+            continue;
+        }
+        else if ( !strcmp(item.mName, "output-extra-buffer-count") ) {
+            if ( item.mType != MediaMeta::MT_Int32 || item.mValue.ii < 0 ) {
+                WARNING("invalid type or value for %s\n", item.mName);
+                continue;
+            }
+            // frames on top of what the codec (V4L2_CID_MIN_BUFFERS_FOR_CAPTURE) and the surface hold
+            mOutputExtraFrames = item.mValue.ii;
+            INFO("key: %s, value: %d\n", item.mName, mOutputExtraFrames);
+            continue;
+        }
+        else if ( !strcmp(item.mName, "input-memory-type") ) {
+            if ( item.mType != MediaMeta::MT_String ) {
+                WARNING("invalid type for %s\n", item.mName);
+                continue;
+            }
+            if (mState != kStateNull) {
+                WARNING("%s can't be changed after prepare\n", item.mName);
+                continue;
+            }
+            // "userptr" queues the demuxed data as is, "mmap" copies it into device buffers
+            if (!strcmp(item.mValue.str, "userptr")) {
+                mInputMemoryType = V4L2_MEMORY_USERPTR;
+            } else if (!strcmp(item.mValue.str, "mmap")) {
+                mInputMemoryType = V4L2_MEMORY_MMAP;
+            } else {
+                WARNING("unknown %s: %s\n", item.mName, item.mValue.str);
+            }
+            INFO("key: %s, value: %s\n", item.mName, item.mValue.str);
+            continue;
+        }
+        else if ( !strcmp(item.mName, "output-buffer-type") ) {
+            if ( item.mType != MediaMeta::MT_String ) {
+                WARNING("invalid type for %s\n", item.mName);
+                continue;
+            }
+            if (mState != kStateNull) {
+                WARNING("%s can't be changed after prepare\n", item.mName);
+                continue;
+            }
+            // "dmabuf": MBT_DmaBufHandle from device memory, "surface": frames are decoded to surface buffers
+            mOutputDmaBuf = !strcmp(item.mValue.str, "dmabuf");
+            INFO("key: %s, value: %s\n", item.mName, item.mValue.str);
+            continue;
+        }
         else if ( !strcmp(item.mName, MEDIA_ATTR_DECODE_MODE) ) {
             if ( item.mType != MediaMeta::MT_String ) {
                 WARNING("invalid type for %s\n", item.mName);
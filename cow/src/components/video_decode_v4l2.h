@@ -106,17 +106,25 @@ friend class V4l2TexureListener;
                                             , width(-1)
                                             , height(-1)
                                             , fourcc(-1)
-                                            , data(NULL)
-                                            {}
+                                            {
+                                                for (int i = 0; i < 4; i++) {
+                                                    pitch[i] = 0;
+                                                    data[i] = NULL;
+                                                    length[i] = 0;
+                                                    fd[i] = -1;
+                                                }
+                                            }
         MMNativeBuffer *mANB;
 
         BufferStatus mOwner;
         uint32_t width;
         uint32_t height;
         uint32_t pitch[4];
-        uint32_t offset[4];
         uint32_t fourcc;            //NV12
-        uint8_t *data;
+        // device memory output (mOutputDmaBuf) only: mmap'ed planes and their VIDIOC_EXPBUF fds
+        uint8_t *data[4];
+        uint32_t length[4];
+        int32_t fd[4];
     };
 
     mm_status_t renderOutputBuffer(struct v4l2_buffer *buf, bool renderIt);
@@ -125,6 +133,7 @@ friend class V4l2TexureListener;
 
     MediaBufferSP createRawMediaBuffer(v4l2_buffer *buf);
     MediaBufferSP createHwMediaBuffer(v4l2_buffer *buf);
+    MediaBufferSP createDmaBufMediaBuffer(v4l2_buffer *buf);
     bool allBuffersBelongToUs();
     void dumpBuffer(MMBufferHandleT target, int w, int h);
     void dbgSurfaceBufferStatus(int line, bool forceErrorDebug = false);
@@ -132,6 +141,8 @@ friend class V4l2TexureListener;
     const char *bufferStatusToString(BufferInfo::BufferStatus s);
     static int getTransform(int degree);
     mm_status_t allocateOutputBuffers();
+    mm_status_t queueDeviceOutputBuffer(uint32_t index);
+    void releaseDeviceOutputBuffers();
     mm_status_t handlePortSettingChanged();
     void processDeferMessage();
     void deferMessage(msg_type what, param1_type param1, param2_type param2, uint32_t rspId);
@@ -176,6 +187,14 @@ friend class V4l2TexureListener;
 
     uint32_t mOutputQueueCapacity;
     uint32_t mOutputPlaneCount;
+    // requested queue depths, "input-buffer-count" and "output-extra-buffer-count" of setParameter
+    uint32_t mInputQueueDepth;
+    uint32_t mOutputExtraFrames;
+    /* decoded frames stay in device (MMAP) buffers and go to the sink as MBT_DmaBufHandle,
+     * no surface is used. when the device can't export them, they are copied to MBT_RawVideo.
+     */
+    bool mOutputDmaBuf;
+    bool mOutputExported;
     bool mDumpInput;
     bool mDumpOutput;
     mm_status_t configOutputSurface();
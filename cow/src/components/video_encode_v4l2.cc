@@ -1296,9 +1296,12 @@ void VideoEncodeV4l2::dequeueInputBuffer()
 
         ioctlRet = mV4l2Encoder->ioctl(VIDIOC_DQBUF, &buf);
         if (ioctlRet == 0) {
+            // the address takes reserved[0] and [1] on 64 bit
+            unsigned long address = 0;
+            memcpy(&address, buf.m.planes[0].reserved, sizeof(address));
             DEBUG("dequeue one input buffer, buf.index %d, reserved %p\n",
-                buf.index, (void *)buf.m.planes[0].reserved[0]);
-            /*uint32_t index = */returnInputBuffer(buf.m.planes[0].reserved[0]);
+                buf.index, (void *)address);
+            /*uint32_t index = */returnInputBuffer(address);
 
             // ASSERT(buf.index == index);
             {
@@ -356,9 +356,11 @@ mm_status_t VideoSink::scheduleRenderFrame_l()
     //TODO. lateUs needs to re-sync
 
     // video is ahead of audio
-    // video too early is invalid pts, render immedicately
+    // video too early is invalid pts, render immedicately;
+    // in trick play key frames may legitimately be seconds apart
+    int64_t maxEarlyUs = (mScaledPlayRate < 0 || mScaledPlayRate > SCALED_PLAY_RATE) ? 4000*1000ll : 1000*1000ll;
     int64_t delayUs = -1ll;
-    if (lateUs <= -10*1000ll && lateUs >= -1000*1000ll && mForceRender != 1){
+    if (lateUs <= -10*1000ll && lateUs >= -maxEarlyUs && mForceRender != 1){
         delayUs = lateUs + 10*1000ll;
     } else {
         // when force-render, schedule to render the frame immediately
@@ -427,9 +429,9 @@ void VideoSink::onRenderFrame(param1_type param1, param2_type param2, uint32_t r
     int64_t pts = buffer->pts();
     int64_t lateUs = mClockWrapper->getMediaLateUs(pts);
 
-    //check the buffer is too late only in slower/normal playback speed
+    //check the buffer is too late only in slower/normal playback speed, not in trick play
     bool render = true;
-    if (mScaledPlayRate <= SCALED_PLAY_RATE) {
+    if (mScaledPlayRate > 0 && mScaledPlayRate <= SCALED_PLAY_RATE) {
         // on start/resume/seek, ignore a/v sync for the first several frames
         if (mSegmentFrameCount++ > SKIP_AV_SYNC_FRM_COUNT_AT_BEGINING)
             render = lateUs < 150*1000ll;
@@ -33,6 +33,8 @@
 #include <errno.h>
 #include <sys/mman.h>
 #include <sys/ioctl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <linux/videodev2.h>
 //#include <pthread.h>
 
@@ -61,8 +63,23 @@ static const char * MMTHREAD_NAME = "VideoSourceUVC::Private::InputThread";
 #define DEFAULT_FRAME_PTS 0
 #define DEFAULT_FRAME_DTS 0
 #define DEFAULT_FRAME_DURATION 0.0f
-#define DEFAULT_FRAME_COUNT 5
+#define DEFAULT_FRAME_COUNT 6
+#define MAX_FRAME_COUNT 32
 #define DEFAULT_FRAME_BUFFER_SIZE 0
+#define DEFAULT_DEVICE "/dev/video0"
+// frames the driver keeps to capture into; below it, frames are copied instead of lent downstream
+#define MIN_QUEUED_FRAMES 2
+#define DEQUEUE_TIMEOUT_MS 1000
+#define LATENCY_LOG_INTERVAL 300
+
+// meta of a lent frame, see FramePool::releaseLentFrame()
+static const char * FRAME_POOL_KEY = "uvc-frame-pool";
+static const char * FRAME_INDEX_KEY = "uvc-frame-index";
+// capture statistics, from getParameter()
+static const char * STAT_FRAMES_LENT = "uvc-frames-lent";
+static const char * STAT_FRAMES_COPIED = "uvc-frames-copied";
+static const char * STAT_LATENCY_AVG = "uvc-latency-avg-us";
+static const char * STAT_LATENCY_MAX = "uvc-latency-max-us";
 
 #define ENTER() VERBOSE(">>>\n")
 #define EXIT() do {VERBOSE(" <<<\n"); return;}while(0)
@@ -108,6 +125,159 @@ class VideoSourceUVC::Private
         // CAMERA_DATA_MODE_DMABUF_USRPTR,
     };
 
+    /* the device and its mmap'd frames. a frame is lent downstream without copy: its MediaBuffer
+     * keeps the pool alive and queues the frame back to the driver when released. so the memory
+     * stays mapped after reset() until the last lent frame is released, and the device is closed then.
+     */
+    class FramePool;
+    typedef MMSharedPtr<FramePool> FramePoolSP;
+    class FramePool {
+    public:
+        explicit FramePool(int32_t device)
+            : mDevice(device)
+            , mFrameSize(0)
+            , mQueued(0)
+            , mLent(0)
+            , mStreaming(false)
+        {
+        }
+
+        ~FramePool()
+        {
+            for (size_t i = 0; i < mFrames.size(); i++) {
+                if (mFrames[i] && munmap(mFrames[i], mFrameSize) == -1)
+                    ERROR("munmap failed, %s\n", strerror(errno));
+            }
+            if (mDevice >= 0)
+                close(mDevice);
+        }
+
+        mm_status_t streamOn()
+        {
+            MMAutoLock locker(mLock);
+            for (uint32_t i = 0; i < mFrames.size(); i++) {
+                mm_status_t ret = queue_l(i);
+                if (ret != MM_ERROR_SUCCESS)
+                    return ret;
+            }
+            enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+            IOCTL_CHECK_RET(mDevice, VIDIOC_STREAMON, "VIDIOC_STREAMON", type, MM_ERROR_OP_FAILED);
+            mStreaming = true;
+            return MM_ERROR_SUCCESS;
+        }
+
+        // the driver gives back every queued frame, lent ones are no longer queued when released
+        mm_status_t streamOff()
+        {
+            MMAutoLock locker(mLock);
+            if (!mStreaming)
+                return MM_ERROR_SUCCESS;
+            mStreaming = false;
+            mQueued = 0;
+            enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+            IOCTL_CHECK_RET(mDevice, VIDIOC_STREAMOFF, "VIDIOC_STREAMOFF", type, MM_ERROR_OP_FAILED);
+            return MM_ERROR_SUCCESS;
+        }
+
+        // one filled frame, -1 if there is none
+        int32_t dequeue(struct v4l2_buffer &buf)
+        {
+            MMAutoLock locker(mLock);
+            memset(&buf, 0, sizeof(buf));
+            buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+            buf.memory = V4L2_MEMORY_MMAP;
+            int ret = 0;
+            do {
+                ret = ioctl(mDevice, VIDIOC_DQBUF, &buf);
+            } while (ret == -1 && errno == EINTR);
+            if (ret == -1) {
+                if (errno != EAGAIN)
+                    ERROR("VIDIOC_DQBUF failed, %s\n", strerror(errno));
+                return -1;
+            }
+            if (buf.index >= mFrames.size()) {
+                ERROR("invalid frame index %d\n", buf.index);
+                return -1;
+            }
+            mQueued--;
+            return buf.index;
+        }
+
+        mm_status_t queue(uint32_t index)
+        {
+            MMAutoLock locker(mLock);
+            return queue_l(index);
+        }
+
+        void lend()
+        {
+            MMAutoLock locker(mLock);
+            mLent++;
+        }
+
+        uint32_t queued()
+        {
+            MMAutoLock locker(mLock);
+            return mQueued;
+        }
+
+        uint32_t lent()
+        {
+            MMAutoLock locker(mLock);
+            return mLent;
+        }
+
+        static bool releaseLentFrame(MediaBuffer *mediaBuf)
+        {
+            MediaMetaSP meta = mediaBuf->getMediaMeta();
+            void *ptr = NULL;
+            int32_t index = -1;
+            if (!meta || !meta->getPointer(FRAME_POOL_KEY, ptr) || !ptr ||
+                !meta->getInt32(FRAME_INDEX_KEY, index)) {
+                WARNING("lent frame without its pool\n");
+                return false;
+            }
+            FramePoolSP *pool = (FramePoolSP*)ptr;
+            (*pool)->recycle(index);
+            delete pool;
+            return true;
+        }
+
+        int32_t mDevice;
+        std::vector<uint8_t*> mFrames;
+        uint32_t mFrameSize;
+
+    private:
+        mm_status_t queue_l(uint32_t index)
+        {
+            struct v4l2_buffer buf;
+            memset(&buf, 0, sizeof(buf));
+            buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+            buf.memory = V4L2_MEMORY_MMAP;
+            buf.index = index;
+            buf.length = mFrameSize;
+            IOCTL_CHECK_RET(mDevice, VIDIOC_QBUF, "VIDIOC_QBUF", buf, MM_ERROR_OP_FAILED);
+            mQueued++;
+            return MM_ERROR_SUCCESS;
+        }
+
+        void recycle(uint32_t index)
+        {
+            MMAutoLock locker(mLock);
+            mLent--;
+            // after stream off, the frame only waits for the unmap
+            if (mStreaming)
+                queue_l(index);
+        }
+
+        Lock mLock;
+        uint32_t mQueued;   // owned by the driver
+        uint32_t mLent;
+        bool mStreaming;
+
+        MM_DISALLOW_COPY(FramePool);
+    };
+
     class VideoSrcReader : public Reader {
     public:
         VideoSrcReader(VideoSourceUVC * src){
@@ -153,6 +323,7 @@ class VideoSourceUVC::Private
           MMAutoLock locker(mPriv->mLock);
           mContinue = false;
           mPriv->mCondition.signal();
+          mPriv->wakeup();
           EXIT();
         }
 
@@ -200,33 +371,27 @@ class VideoSourceUVC::Private
                         continue;
                     }
                 }
-                index = -1;
-                index = mPriv->dequeFrame();
-                if( index == -1 || (uint32_t)index > mPriv->mFrameBufferCount)
+                int64_t captureUs = 0;
+                uint32_t size = 0;
+                index = mPriv->dequeFrame(captureUs, size);
+                if (index < 0)
+                    continue;
+                MediaBufferSP mediaBuf = mPriv->wrapFrame(index, size);
+                if (!mediaBuf)
                     continue;
-                MediaBufferSP mediaBuf = MediaBuffer::createMediaBuffer(MediaBuffer::MBT_RawVideo);
-                uint8_t *buffer = NULL;
-                buffer = new uint8_t[mPriv->mFrameBufferSize];
-                memcpy(buffer, mPriv->mFrameBuffers[index], mPriv->mFrameBufferSize);
 
-#ifdef DUMP_UVC_DATA
-                fwrite(buffer, 1, mPriv->mFrameBufferSize, mPriv->mDumpFile);
-#endif
                 mediaBuf->setPts(mPriv->mDTS);
                 //mediaBuf->setDuration(mPriv->mDTS);
                 mediaBuf->setDts(mPriv->mDTS);
+                // kept in us like the default birth time, for the capture to delivery latency
+                mediaBuf->setBirthTimeInMs(captureUs);
                 mPriv->mPTS += mPriv->mFrameDuration;
                 mPriv->mDTS += mPriv->mFrameDuration;
-                mediaBuf->setBufferInfo((uintptr_t *)&buffer, NULL, (int32_t *)&mPriv->mFrameBufferSize, 1);
-                mediaBuf->setSize((int64_t)mPriv->mFrameBufferSize);
-                mediaBuf->addReleaseBufferFunc(releaseInputBuffer);
                 {
                     MMAutoLock locker(mPriv->mLock);
                     mPriv->mAvailableSourceBuffers.push(mediaBuf);
                     mPriv->mCondition.signal();
                 }
-                mPriv->enqueFrame(index);
-
             }
 
             INFO("Input thread exited\n");
@@ -264,16 +429,20 @@ class VideoSourceUVC::Private
 #endif
         EXIT_AND_RETURN(MM_ERROR_SUCCESS);
     }
-    ~Private() {}
+    ~Private() { closeWaitFds(); }
 
     mm_status_t openDevice();
     mm_status_t initMmap();
     mm_status_t initBuffers();
     mm_status_t stopCapture();
     mm_status_t closeDevice();
-    uint32_t dequeFrame();
-    mm_status_t enqueFrame(uint32_t index);
+    int32_t dequeFrame(int64_t &captureUs, uint32_t &size);
+    MediaBufferSP wrapFrame(uint32_t index, uint32_t size);
     mm_status_t release();
+    void wakeup();
+    void closeWaitFds();
+    void updateLatency_l(const MediaBufferSP &buffer);
+    void resetStats_l();
 
     void clearSourceBuffers();
     mm_status_t resumeInternal();
@@ -303,11 +472,21 @@ class VideoSourceUVC::Private
     uint64_t mFrameDuration;
 
     int32_t mDevice;
-    std::vector<uint8_t*> mFrameBuffers;
+    FramePoolSP mPool;
+    int32_t mEpollFd;
+    int32_t mWakeupFd;  // eventfd, stops the wait for a frame on exit
     uint32_t mFrameBufferCount;
     uint32_t mFrameBufferSize;
+    bool mZeroCopy;
     std::string mUri;
 
+    // capture statistics, under mLock
+    int64_t mFramesLent;
+    int64_t mFramesCopied;
+    int64_t mLatencyCount;
+    int64_t mLatencySumUs;
+    int64_t mLatencyMaxUs;
+
 #ifdef DUMP_UVC_DATA
             FILE* mDumpFile;
 #endif
@@ -328,8 +507,16 @@ class VideoSourceUVC::Private
         mDTS(DEFAULT_FRAME_DTS),
         mFrameDuration(DEFAULT_FRAME_DURATION),
         mDevice(-1),
+        mEpollFd(-1),
+        mWakeupFd(-1),
         mFrameBufferCount(DEFAULT_FRAME_COUNT),
-        mFrameBufferSize(DEFAULT_FRAME_BUFFER_SIZE)
+        mFrameBufferSize(DEFAULT_FRAME_BUFFER_SIZE),
+        mZeroCopy(true),
+        mFramesLent(0),
+        mFramesCopied(0),
+        mLatencyCount(0),
+        mLatencySumUs(0),
+        mLatencyMaxUs(0)
     {
         ENTER();
         mMetaData = MediaMeta::create();
@@ -488,6 +675,7 @@ mm_status_t VideoSourceUVC::Private::VideoSrcReader::read(MediaBufferSP & buffer
     } else {
         buffer = mSrc->mPriv->mAvailableSourceBuffers.front();
         mSrc->mPriv->mAvailableSourceBuffers.pop();
+        mSrc->mPriv->updateLatency_l(buffer);
         EXIT_AND_RETURN(MM_ERROR_SUCCESS);
     }
 }
@@ -549,6 +737,20 @@ mm_status_t VideoSourceUVC::setParameter(const MediaMetaSP & meta)
             DEBUG_FOURCC(NULL, mPriv->mVideoFourcc);
             continue;
         }
+        // number of capture buffers requested from the driver, takes effect on prepare()
+        if ( !strcmp(item.mName, MEDIA_ATTR_INPUT_BUFFER_NUM) ) {
+            if ( item.mType != MediaMeta::MT_Int32 ) {
+                WARNING("invalid type for %s\n", item.mName);
+                continue;
+            }
+            if (item.mValue.ii <= MIN_QUEUED_FRAMES || item.mValue.ii > MAX_FRAME_COUNT) {
+                WARNING("invalid buffer count %d, keep %d\n", item.mValue.ii, mPriv->mFrameBufferCount);
+                continue;
+            }
+            mPriv->mFrameBufferCount = item.mValue.ii;
+            INFO("key: %s, value: %d\n", item.mName, mPriv->mFrameBufferCount);
+            continue;
+        }
     }
 
     EXIT_AND_RETURN(MM_ERROR_SUCCESS);
@@ -561,6 +763,13 @@ mm_status_t VideoSourceUVC::getParameter(MediaMetaSP & meta) const
     if (!mPriv)
         return MM_ERROR_NO_COMPONENT;
 
+    if (!meta)
+        meta = MediaMeta::create();
+    MMAutoLock locker(mPriv->mLock);
+    meta->setInt64(STAT_FRAMES_LENT, mPriv->mFramesLent);
+    meta->setInt64(STAT_FRAMES_COPIED, mPriv->mFramesCopied);
+    meta->setInt64(STAT_LATENCY_AVG, mPriv->mLatencyCount ? mPriv->mLatencySumUs / mPriv->mLatencyCount : 0);
+    meta->setInt64(STAT_LATENCY_MAX, mPriv->mLatencyMaxUs);
 
     EXIT_AND_RETURN(MM_ERROR_SUCCESS);
 }
@@ -584,6 +793,10 @@ void VideoSourceUVC::onPrepare(param1_type param1, param2_type param2, uint32_t
 
     mPriv->mFrameDuration = (1000.0f / mPriv->mFrameRate) * 1000;
     mPriv->mDoubleDuration = mPriv->mFrameDuration * 2ll;
+    {
+        MMAutoLock locker(mPriv->mLock);
+        mPriv->resetStats_l();
+    }
     setState(mPriv->mState, mPriv->STATE_PREPARED);
     notify(kEventPrepareResult, MM_ERROR_SUCCESS, 0, nilParam);
     EXIT1();
@@ -740,16 +953,48 @@ mm_status_t VideoSourceUVC::Private::openDevice()
     mm_status_t ret = MM_ERROR_INVALID_PARAM;
 
     INFO();
-    mUri = "/dev/video0";
+    // "/dev/videoN" or "camera:///dev/videoN" picks the device (the vivid test camera is usually not video0)
+    std::string device = DEFAULT_DEVICE;
+    size_t pos = mUri.find("/dev/");
+    if (pos != std::string::npos)
+        device = mUri.substr(pos);
     //mDevice = open(mUri.c_str(), O_RDWR | O_NONBLOCK, 0);
-    mDevice = open(mUri.c_str(), O_RDWR | O_NONBLOCK, 0);
+    mDevice = open(device.c_str(), O_RDWR | O_NONBLOCK, 0);
 
     if (-1 == mDevice) {
-        ERROR("Cannot open '%s': %d, %s\n", mUri.c_str(), errno, strerror(errno));
+        ERROR("Cannot open '%s': %d, %s\n", device.c_str(), errno, strerror(errno));
         return MM_ERROR_INVALID_PARAM;
     }
+    // the pool owns the device from now on, it is closed with the last reference
+    mPool.reset(new FramePool(mDevice));
+
+    // left open by a failed prepare, a retry creates them again
+    closeWaitFds();
+    mEpollFd = epoll_create1(EPOLL_CLOEXEC);
+    mWakeupFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (mEpollFd < 0 || mWakeupFd < 0) {
+        ERROR("failed to create epoll/eventfd, %s\n", strerror(errno));
+        return MM_ERROR_NO_MEM;
+    }
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = mDevice;
+    if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, mDevice, &ev) < 0) {
+        ERROR("failed to watch the device, %s\n", strerror(errno));
+        return MM_ERROR_OP_FAILED;
+    }
+    ev.data.fd = mWakeupFd;
+    if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, mWakeupFd, &ev) < 0) {
+        ERROR("failed to watch the wakeup fd, %s\n", strerror(errno));
+        return MM_ERROR_OP_FAILED;
+    }
+
+    std::string zeroCopy = mm_get_env_str("mm.uvc.zerocopy", "MM_UVC_ZEROCOPY");
+    mZeroCopy = !(zeroCopy == "0" || zeroCopy == "false");
+    INFO("device %s, zero copy %d\n", device.c_str(), mZeroCopy);
 
-    IOCTL_CHECK_RET(mDevice, VIDIOC_QUERYCAP, "VIDIOC_QUERYCAP", cap, false);
+    IOCTL_CHECK_RET(mDevice, VIDIOC_QUERYCAP, "VIDIOC_QUERYCAP", cap, MM_ERROR_OP_FAILED);
     DEBUG("cap.capabilities 0x%0x\n", cap.capabilities);
 
     if (!(cap.capabilities & V4L2_CAP_VIDEO_CAPTURE)) {
@@ -777,10 +1022,10 @@ mm_status_t VideoSourceUVC::Private::openDevice()
     fmt.fmt.pix.height      = mHeight;
     //fmt.fmt.pix.pixelformat = V4L2_PIX_FMT_YUYV;
     fmt.fmt.pix.pixelformat = fourccConvert(mVideoFourcc);
-    IOCTL_CHECK_RET(mDevice, VIDIOC_S_FMT, "VIDIOC_S_FMT", fmt, false);
+    IOCTL_CHECK_RET(mDevice, VIDIOC_S_FMT, "VIDIOC_S_FMT", fmt, MM_ERROR_OP_FAILED);
     DEBUG("video resolution: %dx%d = %dx%d, format 0x%0x:0x%0x",
         mWidth, mHeight, fmt.fmt.pix.width, fmt.fmt.pix.height, mVideoFourcc, fmt.fmt.pix.pixelformat);
-    IOCTL_CHECK_RET(mDevice, VIDIOC_G_FMT, "VIDIOC_G_FMT", fmt, false);
+    IOCTL_CHECK_RET(mDevice, VIDIOC_G_FMT, "VIDIOC_G_FMT", fmt, MM_ERROR_OP_FAILED);
     if (mWidth != fmt.fmt.pix.width || mHeight != fmt.fmt.pix.height) {
         ERROR("not supported resolution(%dx%d), use %dx%d from camera\n", mWidth, mHeight, fmt.fmt.pix.width, fmt.fmt.pix.height);
         mWidth = fmt.fmt.pix.width;
@@ -810,10 +1055,14 @@ mm_status_t VideoSourceUVC::Private::initMmap()
     rqbufs.memory = V4L2_MEMORY_MMAP;
     rqbufs.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
 
-    IOCTL_CHECK_RET(mDevice, VIDIOC_REQBUFS, "VIDIOC_REQBUFS", rqbufs, false);
+    IOCTL_CHECK_RET(mDevice, VIDIOC_REQBUFS, "VIDIOC_REQBUFS", rqbufs, MM_ERROR_OP_FAILED);
     INFO("rqbufs.count: %d\n", rqbufs.count);
 
-    mFrameBuffers.resize(rqbufs.count);
+    if (rqbufs.count < MIN_QUEUED_FRAMES) {
+        ERROR("only %d buffers from the driver\n", rqbufs.count);
+        return MM_ERROR_NO_MEM;
+    }
+    mPool->mFrames.resize(rqbufs.count, NULL);
     mFrameBufferCount = rqbufs.count;
 
     DEBUG("map video frames: ");
@@ -824,21 +1073,23 @@ mm_status_t VideoSourceUVC::Private::initMmap()
         buf.memory      = V4L2_MEMORY_MMAP;
         buf.index       = index;
 
-        IOCTL_CHECK_RET(mDevice, VIDIOC_QUERYBUF, "VIDIOC_QUERYBUF", buf, false);
+        IOCTL_CHECK_RET(mDevice, VIDIOC_QUERYBUF, "VIDIOC_QUERYBUF", buf, MM_ERROR_OP_FAILED);
         if (mFrameBufferSize)
             ASSERT(mFrameBufferSize == buf.length);
         mFrameBufferSize = buf.length;
+        mPool->mFrameSize = buf.length;
 
-        mFrameBuffers[index]= (uint8_t*)mmap(NULL, buf.length,
+        void *addr = mmap(NULL, buf.length,
                   PROT_READ | PROT_WRITE, MAP_SHARED,
                   mDevice, buf.m.offset);
 
-        if (MAP_FAILED == mFrameBuffers[index]) {
+        if (MAP_FAILED == addr) {
             ERROR("mmap failed");
             return MM_ERROR_INVALID_PARAM;
         }
+        mPool->mFrames[index] = (uint8_t*)addr;
 
-        DEBUG("index: %d, buf.length: %d, addr: %p", buf.index, buf.length, mFrameBuffers[index]);
+        DEBUG("index: %d, buf.length: %d, addr: %p", buf.index, buf.length, addr);
     }
 
     return MM_ERROR_SUCCESS;
@@ -846,24 +1097,11 @@ mm_status_t VideoSourceUVC::Private::initMmap()
 
 mm_status_t VideoSourceUVC::Private::initBuffers()
 {
-    unsigned int i;
-    enum v4l2_buf_type type;
-
     INFO();
     switch (mDataMode) {
         case CAMERA_DATA_MODE_MMAP:
-            for (i = 0; i < mFrameBufferCount; ++i) {
-                struct v4l2_buffer buf;
-                memset(&buf, 0, sizeof(buf));
-                buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-                buf.memory = V4L2_MEMORY_MMAP;
-                buf.index = i;
-
-                IOCTL_CHECK_RET(mDevice, VIDIOC_QBUF, "VIDIOC_QBUF", buf, false);
-            }
-
-            type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-            IOCTL_CHECK_RET(mDevice, VIDIOC_STREAMON, "VIDIOC_STREAMON", type, false);
+            if (!mPool || mPool->streamOn() != MM_ERROR_SUCCESS)
+                return MM_ERROR_OP_FAILED;
             INFO("STREAMON ok\n");
             break;
         default:
@@ -876,13 +1114,11 @@ mm_status_t VideoSourceUVC::Private::initBuffers()
 
 mm_status_t VideoSourceUVC::Private::stopCapture()
 {
-    enum v4l2_buf_type type;
-
     INFO();
     switch (mDataMode) {
         case CAMERA_DATA_MODE_MMAP:
-            type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-            IOCTL_CHECK_RET(mDevice, VIDIOC_STREAMOFF, "VIDIOC_STREAMOFF", type, false);
+            if (mPool)
+                return mPool->streamOff();
             break;
         default:
             return MM_ERROR_INVALID_PARAM;
@@ -894,121 +1130,172 @@ mm_status_t VideoSourceUVC::Private::stopCapture()
 
 mm_status_t VideoSourceUVC::Private::closeDevice()
 {
-    unsigned int i;
+    mm_status_t ret = MM_ERROR_SUCCESS;
 
     INFO();
-    switch (mDataMode) {
-        case CAMERA_DATA_MODE_MMAP:
-            for (i = 0; i < mFrameBufferCount; ++i)
-                if (-1 == munmap(mFrameBuffers[i], mFrameBufferSize)) {
-                    ERROR("munmap failed\n");
-                    return MM_ERROR_INVALID_PARAM;
-                }
-            break;
-        default:
-            return MM_ERROR_INVALID_PARAM;
-            break;
+    if (mPool) {
+        ret = stopCapture();
+        uint32_t lent = mPool->lent();
+        if (lent)
+            INFO("%d frames are still held downstream, the device is closed when they are released\n", lent);
+        mPool.reset();
     }
+    closeWaitFds();
 
-    if (-1 == close(mDevice)) {
-        ERROR("close device failed\n");
-        return MM_ERROR_INVALID_PARAM;
+    mDevice = -1;
+    return ret;
+}
+
+void VideoSourceUVC::Private::closeWaitFds()
+{
+    if (mEpollFd >= 0) {
+        close(mEpollFd);
+        mEpollFd = -1;
     }
+    if (mWakeupFd >= 0) {
+        close(mWakeupFd);
+        mWakeupFd = -1;
+    }
+}
 
-    mDevice = -1;
-    return MM_ERROR_SUCCESS;
+void VideoSourceUVC::Private::wakeup()
+{
+    if (mWakeupFd < 0)
+        return;
+    uint64_t one = 1;
+    if (write(mWakeupFd, &one, sizeof(one)) != sizeof(one))
+        WARNING("failed to wake up the input thread, %s\n", strerror(errno));
 }
 
-uint32_t VideoSourceUVC::Private::dequeFrame()
+int32_t VideoSourceUVC::Private::dequeFrame(int64_t &captureUs, uint32_t &size)
 {
+    struct epoll_event events[2];
     struct v4l2_buffer buf;
     int ret = 0;
 
-    INFO();
-    memset(&buf, 0, sizeof(buf));
+    VERBOSE();
+    if (!mPool || mEpollFd < 0)
+        return -1;
 
     switch (mDataMode) {
     case CAMERA_DATA_MODE_MMAP: {
-        // poll until there is available frames
-        while(1) {
-            fd_set fds;
-            struct timeval tv;
-
-            FD_ZERO(&fds);
-            FD_SET(mDevice, &fds);
-
-            /* Timeout. */
-            tv.tv_sec = 1;
-            tv.tv_usec = 0;
-
-            ret= select(mDevice + 1, &fds, NULL, NULL, &tv);
+        // wait until there is available frames, or the thread is asked to exit
+        ret = epoll_wait(mEpollFd, events, 2, DEQUEUE_TIMEOUT_MS);
+        if (-1 == ret) {
+            if (EINTR != errno)
+                ERROR("epoll_wait failed, %s\n", strerror(errno));
+            return -1;
+        } else if (0 == ret) {
+            ERROR("no frame in %d ms\n", DEQUEUE_TIMEOUT_MS);
+            return -1;
+        }
 
-            if (-1 == ret) {
-                if (EINTR == errno)
-                    continue;
-                ERROR("select failed");
+        bool readable = false;
+        for (int i = 0; i < ret; i++) {
+            if (events[i].data.fd == mWakeupFd) {
+                uint64_t count = 0;
+                if (read(mWakeupFd, &count, sizeof(count)) < 0)
+                    DEBUG("nothing to read from the wakeup fd\n");
                 return -1;
-            } else if (0 == ret) {
-                ERROR("select timeout\n");
+            }
+            // no frame queued, or not streaming: the driver has nothing to fill
+            if (events[i].events & EPOLLERR) {
+                WARNING("device error, %d frames queued\n", mPool->queued());
+                usleep(5000);
                 return -1;
-            } else
-                break;
+            }
+            if (events[i].events & EPOLLIN)
+                readable = true;
         }
-
-        DEBUG("get one frame");
-        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        buf.memory = V4L2_MEMORY_MMAP;
-        buf.length = mFrameBufferSize;
-
-        do {
-            ret = ioctl(mDevice, VIDIOC_DQBUF, &buf);
-            if (-1 == ret) {
-                usleep(5000);
-            } else
-                break;
-        } while (errno == EAGAIN || EINTR == errno);
-
-        ASSERT(ret != -1);
-        ASSERT(buf.index < mFrameBufferCount);
+        if (!readable)
+            return -1;
+
+        int32_t index = mPool->dequeue(buf);
+        if (index < 0)
+            return -1;
+
+        size = buf.bytesused ? buf.bytesused : mFrameBufferSize;
+        // the driver stamps the frame at capture in CLOCK_MONOTONIC, as getTimeUs()
+        if ((buf.flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) == V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC)
+            captureUs = buf.timestamp.tv_sec * 1000000LL + buf.timestamp.tv_usec;
+        else
+            captureUs = getTimeUs();
+        DEBUG("get one frame (index: %d, size: %d)", index, size);
+        return index;
     }
-    break;
     default:
         ASSERT(0);
         break;
     }
 
-    return buf.index;
+    return -1;
 }
 
-mm_status_t VideoSourceUVC::Private::enqueFrame(uint32_t index)
+MediaBufferSP VideoSourceUVC::Private::wrapFrame(uint32_t index, uint32_t size)
 {
-    assert(index >=0 && index < mFrameBufferCount);
-    struct v4l2_buffer buf;
-    memset(&buf, 0, sizeof(buf));
+    MediaBufferSP mediaBuf = MediaBuffer::createMediaBuffer(MediaBuffer::MBT_RawVideo);
+    uint8_t *buffer = NULL;
+    bool lend = mZeroCopy && mPool->queued() >= MIN_QUEUED_FRAMES;
 
-    switch (mDataMode) {
-    case CAMERA_DATA_MODE_MMAP:
-        DEBUG("recycle one frame (index: %d)\n", index);
-        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        buf.memory = V4L2_MEMORY_MMAP;
-        buf.index = index;
-        buf.length = mFrameBufferSize;
-
-        IOCTL_CHECK_RET(mDevice, VIDIOC_QBUF, "VIDIOC_QBUF", buf, false);
-        break;
-    default:
-        ASSERT(0);
-        break;
+#ifdef DUMP_UVC_DATA
+    fwrite(mPool->mFrames[index], 1, size, mDumpFile);
+#endif
+    if (lend) {
+        // the frame goes downstream as is, released back to the driver by FramePool::releaseLentFrame()
+        buffer = mPool->mFrames[index];
+        MediaMetaSP meta = mediaBuf->getMediaMeta();
+        meta->setPointer(FRAME_POOL_KEY, new FramePoolSP(mPool));
+        meta->setInt32(FRAME_INDEX_KEY, index);
+        mPool->lend();
+        mediaBuf->addReleaseBufferFunc(FramePool::releaseLentFrame);
+    } else {
+        // downstream holds too many frames, a copy keeps the driver capturing
+        buffer = new uint8_t[size];
+        memcpy(buffer, mPool->mFrames[index], size);
+        mPool->queue(index);
+        mediaBuf->addReleaseBufferFunc(InputThread::releaseInputBuffer);
     }
-    return MM_ERROR_SUCCESS;
+    mediaBuf->setBufferInfo((uintptr_t *)&buffer, NULL, (int32_t *)&size, 1);
+    mediaBuf->setSize((int64_t)size);
+
+    MMAutoLock locker(mLock);
+    if (lend)
+        mFramesLent++;
+    else
+        mFramesCopied++;
+    return mediaBuf;
+}
+
+void VideoSourceUVC::Private::updateLatency_l(const MediaBufferSP &buffer)
+{
+    if (buffer->isFlagSet(MediaBuffer::MBFT_EOS))
+        return;
+    int64_t latency = getTimeUs() - buffer->birthTimeInMs();
+    mLatencyCount++;
+    mLatencySumUs += latency;
+    if (latency > mLatencyMaxUs)
+        mLatencyMaxUs = latency;
+    if (mLatencyCount % LATENCY_LOG_INTERVAL == 0) {
+        INFO("capture to delivery latency: avg %" PRId64 " us, max %" PRId64 " us, frames lent %" PRId64 ", copied %" PRId64 "\n",
+            mLatencySumUs / mLatencyCount, mLatencyMaxUs, mFramesLent, mFramesCopied);
+    }
+}
+
+void VideoSourceUVC::Private::resetStats_l()
+{
+    mFramesLent = 0;
+    mFramesCopied = 0;
+    mLatencyCount = 0;
+    mLatencySumUs = 0;
+    mLatencyMaxUs = 0;
 }
 
 mm_status_t VideoSourceUVC::Private::release()
 {
     ENTER();
     mm_status_t ret;
-    ret = closeDevice();
     clearSourceBuffers();
+    ret = closeDevice();
 
     EXIT_AND_RETURN(ret);
 }
@@ -577,6 +577,20 @@ LOCAL_LDLIBS += -lpthread -lstdc++
 LOCAL_MODULE:= libFileSink
 include $(BUILD_SHARED_LIBRARY)
 
+#### libSegmenterSink
+include $(CLEAR_VARS)
+include $(LOCAL_PATH)/../../build/cow_common.mk
+LOCAL_MODULE_PATH = $(COW_PLUGIN_PATH)
+
+LOCAL_SRC_FILES:= segmenter_sink.cc
+
+LOCAL_CPPFLAGS += -D_FILE_OFFSET_BITS=64 -D_LARGEFILE_SOURCE
+LOCAL_SHARED_LIBRARIES += libcowbase
+LOCAL_LDLIBS += -lpthread -lstdc++
+
+LOCAL_MODULE:= libSegmenterSink
+include $(BUILD_SHARED_LIBRARY)
+
 #### libAudioSrcFile
 include $(CLEAR_VARS)
 include $(LOCAL_PATH)/../../build/cow_common.mk
@@ -604,6 +618,18 @@ LOCAL_SHARED_LIBRARIES += libcowbase
 LOCAL_MODULE := libMediaFission
 include $(BUILD_SHARED_LIBRARY)
 
+#### libAudioMixer
+include $(CLEAR_VARS)
+include $(LOCAL_PATH)/../../build/cow_common.mk
+LOCAL_MODULE_PATH = $(COW_PLUGIN_PATH)
+
+LOCAL_SRC_FILES := audio_mixer.cc
+LOCAL_LDLIBS += -lpthread -lstdc++
+LOCAL_SHARED_LIBRARIES += libcowbase
+
+LOCAL_MODULE := libAudioMixer
+include $(BUILD_SHARED_LIBRARY)
+
 #### libVideoDecodeV4l2
 include $(CLEAR_VARS)
 include $(LOCAL_PATH)/../../build/cow_common.mk
@@ -664,6 +690,12 @@ else
 endif
 REQUIRE_WAYLAND = 1
 REQUIRE_SURFACE = 1
+ifeq ($(USING_V4L2CODEC_SOFT),1)
+LOCAL_SRC_FILES += v4l2codec_device_soft.cc
+LOCAL_C_INCLUDES += $(libav-includes)
+LOCAL_CPPFLAGS += -D_V4L2CODEC_SOFT
+REQUIRE_LIBAV = 1
+endif
 include $(MM_ROOT_PATH)/base/build/xmake_req_libs.mk
 
 LOCAL_MODULE := libVideoDecodeV4l2
@@ -719,6 +751,12 @@ ifeq ($(USING_DRM_SURFACE),1)
 REQUIRE_LIBDCE = 1
 REQUIRE_LIBDRM = 1
 endif
+ifeq ($(USING_V4L2CODEC_SOFT),1)
+LOCAL_SRC_FILES += v4l2codec_device_soft.cc
+LOCAL_C_INCLUDES += $(libav-includes)
+LOCAL_CPPFLAGS += -D_V4L2CODEC_SOFT
+REQUIRE_LIBAV = 1
+endif
 include $(MM_ROOT_PATH)/base/build/xmake_req_libs.mk
 
 LOCAL_MODULE := libVideoEncodeV4l2
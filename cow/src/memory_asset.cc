@@ -0,0 +1,146 @@
+/**
+ * Copyright (C) 2017 Alibaba Group Holding Limited. All Rights Reserved.
+ *
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include <multimedia/memory_asset.h>
+#include <multimedia/mm_debug.h>
+
+namespace YUNOS_MM {
+
+MM_LOG_DEFINE_MODULE_NAME("MemoryAsset")
+
+const char * MemoryAssetCache::kScheme = "mem://";
+Lock MemoryAssetCache::sLock;
+uint64_t MemoryAssetCache::sNextId = 1;
+std::map<uint64_t, MMWeakPtr<MemoryAsset> > MemoryAssetCache::sAssets;
+std::map<std::string, MemoryAssetSP> MemoryAssetCache::sNamed;
+
+MemoryAsset::MemoryAsset(uint64_t id, const uint8_t * data, size_t size, uint8_t * owned)
+    : mId(id)
+    , mData(data)
+    , mSize(size)
+    , mOwned(owned)
+{
+    char uri[64];
+    snprintf(uri, sizeof(uri), "%s%" PRIu64, MemoryAssetCache::kScheme, id);
+    mUri = uri;
+}
+
+MemoryAsset::~MemoryAsset()
+{
+    DEBUG("%s released, %zu bytes\n", mUri.c_str(), mSize);
+    free(mOwned);
+}
+
+/*static*/ MemoryAssetSP MemoryAssetCache::create_l(const uint8_t * data, size_t size, uint8_t * owned)
+{
+    // drop the entries of released assets
+    std::map<uint64_t, MMWeakPtr<MemoryAsset> >::iterator it = sAssets.begin();
+    while (it != sAssets.end()) {
+        if (it->second.expired())
+            sAssets.erase(it++);
+        else
+            ++it;
+    }
+
+    uint64_t id = sNextId++;
+    MemoryAssetSP asset(new MemoryAsset(id, data, size, owned));
+    sAssets[id] = asset;
+    return asset;
+}
+
+/*static*/ MemoryAssetSP MemoryAssetCache::wrap(const uint8_t * data, size_t size)
+{
+    if (!data || !size)
+        return MemoryAssetSP();
+
+    MMAutoLock lock(sLock);
+    std::map<uint64_t, MMWeakPtr<MemoryAsset> >::iterator it;
+    for (it = sAssets.begin(); it != sAssets.end(); ++it) {
+        MemoryAssetSP asset = it->second.lock();
+        if (asset && !asset->mOwned && asset->mData == data && asset->mSize == size)
+            return asset;
+    }
+
+    MemoryAssetSP asset = create_l(data, size, NULL);
+    INFO("%s: %zu bytes at %p\n", asset->uri().c_str(), size, data);
+    return asset;
+}
+
+/*static*/ MemoryAssetSP MemoryAssetCache::add(const char * name, const uint8_t * data, size_t size)
+{
+    if (!name || !data || !size)
+        return MemoryAssetSP();
+
+    uint8_t * copy = (uint8_t*)malloc(size);
+    if (!copy) {
+        ERROR("no mem for %zu bytes\n", size);
+        return MemoryAssetSP();
+    }
+    memcpy(copy, data, size);
+
+    MMAutoLock lock(sLock);
+    MemoryAssetSP asset = create_l(copy, size, copy);
+    sNamed[name] = asset;
+    INFO("%s: %s, %zu bytes\n", asset->uri().c_str(), name, size);
+    return asset;
+}
+
+/*static*/ MemoryAssetSP MemoryAssetCache::get(const char * name)
+{
+    if (!name)
+        return MemoryAssetSP();
+
+    MMAutoLock lock(sLock);
+    std::map<std::string, MemoryAssetSP>::iterator it = sNamed.find(name);
+    return it != sNamed.end() ? it->second : MemoryAssetSP();
+}
+
+/*static*/ void MemoryAssetCache::remove(const char * name)
+{
+    if (!name)
+        return;
+
+    MMAutoLock lock(sLock);
+    sNamed.erase(name);
+}
+
+/*static*/ bool MemoryAssetCache::isMemoryUri(const char * uri)
+{
+    return uri && !strncmp(uri, kScheme, strlen(kScheme));
+}
+
+/*static*/ MemoryAssetSP MemoryAssetCache::find(const char * uri)
+{
+    if (!isMemoryUri(uri))
+        return MemoryAssetSP();
+
+    char * end = NULL;
+    uint64_t id = strtoull(uri + strlen(kScheme), &end, 10);
+    if (!end || *end != '\0')
+        return MemoryAssetSP();
+
+    MMAutoLock lock(sLock);
+    std::map<uint64_t, MMWeakPtr<MemoryAsset> >::iterator it = sAssets.find(id);
+    return it != sAssets.end() ? it->second.lock() : MemoryAssetSP();
+}
+
+} // YUNOS_MM
@@ -19,6 +19,7 @@
 #include "multimedia/media_attr_str.h"
 #include "multimedia/mm_debug.h"
 #include "multimedia/elapsedtimer.h"
+#include "multimedia/mmthread.h"
 
 namespace YUNOS_MM {
 
@@ -164,6 +165,66 @@ ComponentSP Pipeline::createComponentHelper(const char* componentName, const cha
     return comp;
 }
 
+class ComponentCreator : public MMThread {
+  public:
+    explicit ComponentCreator(Pipeline::ComponentRequest &request)
+        : MMThread("CompCreator")
+        , mRequest(request)
+    {
+    }
+    ~ComponentCreator()
+    {
+        destroy();
+    }
+
+  protected:
+    virtual void main()
+    {
+        mRequest.component = ComponentFactory::create(mRequest.componentName, mRequest.mimeType, mRequest.isEncoder);
+    }
+
+  private:
+    Pipeline::ComponentRequest &mRequest;
+
+    MM_DISALLOW_COPY(ComponentCreator)
+};
+
+void Pipeline::createComponentsHelper(std::vector<ComponentRequest> & requests)
+{
+    FUNC_TRACK();
+    if (requests.empty())
+        return;
+
+    int64_t begin = getTimeUs();
+    std::vector<MMSharedPtr<ComponentCreator> > creators;
+    for (uint32_t i = 1; i < requests.size(); i++) {
+        MMSharedPtr<ComponentCreator> creator(new ComponentCreator(requests[i]));
+        if (creator->create()) {
+            WARNING("fail to create thread for %s, create it inline", PRINTABLE_STR(requests[i].mimeType));
+            requests[i].component = ComponentFactory::create(requests[i].componentName, requests[i].mimeType, requests[i].isEncoder);
+            continue;
+        }
+        creators.push_back(creator);
+    }
+
+    // the first one in the calling thread
+    requests[0].component = ComponentFactory::create(requests[0].componentName, requests[0].mimeType, requests[0].isEncoder);
+
+    // join
+    creators.clear();
+
+    for (uint32_t i = 0; i < requests.size(); i++) {
+        if (!requests[i].component) {
+            ERROR("fail to create component <%s:%s>\n",
+                PRINTABLE_STR(requests[i].componentName), PRINTABLE_STR(requests[i].mimeType));
+            continue;
+        }
+        if (mListenerReceive)
+            requests[i].component->setListener(mListenerReceive);
+    }
+    INFO("%zu components created, cost %" PRId64 " us", requests.size(), getTimeUs() - begin);
+}
+
 ComponentSP Pipeline::createComponentHelper(const char* componentName, const char* mimeType, Component::ListenerSP listener, bool isEncoder )
 {
     FUNC_TRACK();
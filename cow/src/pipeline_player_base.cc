@@ -29,9 +29,12 @@ MM_LOG_DEFINE_MODULE_NAME("COW-PLPB")
 #define FUNC_TRACK() FuncTracker tracker(MM_LOG_TAG, __FUNCTION__, __LINE__)
 // #define FUNC_TRACK()
 
+#define PL_MSG_checkItemBoundary (MMMsgThread::msg_type)3
+
 BEGIN_MSG_LOOP(PipelinePlayerBase)
     MSG_ITEM2(PL_MSG_componentMessage, onComponentMessage)
     MSG_ITEM2(PL_MSG_cowMessage, onCowMessage)
+    MSG_ITEM(PL_MSG_checkItemBoundary, onCheckItemBoundary)
 END_MSG_LOOP()
 
 
@@ -87,6 +90,9 @@ PipelinePlayerBase::PipelinePlayerBase()
     , mHeight(-1)
     , mRotation(0)
     , mAudioStreamType(3)
+    , mNextUriHandedOver(false)
+    , mItemStartMs(0)
+    , mSeamlessLoop(0)
     , mHasVideo(false)
     , mHasAudio(false)
     , mHasSubTitle(false)
@@ -94,6 +100,9 @@ PipelinePlayerBase::PipelinePlayerBase()
     , mExternalSubtitleEnabled(false)
     , mSeekPreviewDoneCondition(mLock)
     , mBufferUpdateEventFilterCount(0)
+    , mPrepareBeginUs(-1)
+    , mStartBeginUs(-1)
+    , mFirstFrameReported(false)
 {
     FUNC_TRACK();
     int i=0;
@@ -274,6 +283,7 @@ Pipeline::UriType PipelinePlayerBase::getUriType(const char* uri) {
         status = source->setUri(uri, headers);
         INFO("status = %d\n", status);
         ASSERT(status == MM_ERROR_SUCCESS);
+        applySeamlessLoop();
     }
 
     return status;
@@ -295,6 +305,7 @@ mm_status_t PipelinePlayerBase::load(int fd, int64_t offset, int64_t length)
     ASSERT_RET(source, MM_ERROR_NO_COMPONENT);
     status = source->setUri(fd, offset, length);
     ASSERT(status == MM_ERROR_SUCCESS);
+    applySeamlessLoop();
 
     return status;
 }
@@ -316,6 +327,176 @@ mm_status_t PipelinePlayerBase::load(int fd, int64_t offset, int64_t length)
     return MM_ERROR_SUCCESS;
 }
 
+mm_status_t PipelinePlayerBase::queueUri(const char * uri,
+                          const std::map<std::string, std::string> * headers)
+{
+    FUNC_TRACK();
+    if (!uri || !*uri)
+        return MM_ERROR_INVALID_URI;
+
+    {
+        MMAutoLock locker(mLock);
+        QueuedUri item;
+        item.mUri = uri;
+        if (headers)
+            item.mHeaders = *headers;
+        mUriQueue.push_back(item);
+        INFO("queued %s, %zu in queue\n", uri, mUriQueue.size());
+    }
+
+    handOverNextUri();
+    return MM_ERROR_SUCCESS;
+}
+
+mm_status_t PipelinePlayerBase::clearQueue()
+{
+    FUNC_TRACK();
+    bool handedOver = false;
+    {
+        MMAutoLock locker(mLock);
+        mUriQueue.clear();
+        handedOver = mNextUriHandedOver;
+        mNextUriHandedOver = false;
+    }
+
+    PlaySourceComponent* source = getSourceComponent();
+    if (handedOver && source)
+        source->setNextUri(NULL);
+    return MM_ERROR_SUCCESS;
+}
+
+bool PipelinePlayerBase::dequeueUri(std::string & uri, std::map<std::string, std::string> & headers)
+{
+    FUNC_TRACK();
+    MMAutoLock locker(mLock);
+    if (mUriQueue.empty())
+        return false;
+
+    uri = mUriQueue.front().mUri;
+    headers = mUriQueue.front().mHeaders;
+    mUriQueue.pop_front();
+    mNextUriHandedOver = false;
+    return true;
+}
+
+// let the source open the head of the queue while the current item is playing
+void PipelinePlayerBase::handOverNextUri()
+{
+    QueuedUri item;
+    {
+        MMAutoLock locker(mLock);
+        if (mNextUriHandedOver || mUriQueue.empty() || mUriType != kUriDefault)
+            return;
+        if (mState < kComponentStatePrepared || mState > kComponentStatePlaying)
+            return;
+        item = mUriQueue.front();
+        mNextUriHandedOver = true;
+    }
+
+    PlaySourceComponent* source = getSourceComponent();
+    if (!source)
+        return;
+    mm_status_t status = source->setNextUri(item.mUri.c_str(), &item.mHeaders);
+    if (status != MM_ERROR_SUCCESS)
+        INFO("%s can't join %s (%d), it is loaded after EOS\n", source->name(), item.mUri.c_str(), status);
+}
+
+void PipelinePlayerBase::applySeamlessLoop()
+{
+    PlaySourceComponent* source = getSourceComponent();
+    if (!source)
+        return;
+
+    MediaMetaSP meta = MediaMeta::create();
+    meta->setInt32(PlaySourceComponent::PARAM_KEY_SEAMLESS_LOOP, mSeamlessLoop);
+    mm_status_t status = source->setParameter(meta);
+    if (status != MM_ERROR_SUCCESS)
+        INFO("%s: no seamless loop (%d)\n", source->name(), status);
+}
+
+void PipelinePlayerBase::reportFirstFrame()
+{
+    int64_t ttffMs, startMs = -1;
+    {
+        MMAutoLock locker(mLock);
+        if (mFirstFrameReported || mPrepareBeginUs < 0)
+            return;
+        mFirstFrameReported = true;
+        int64_t nowUs = getTimeUs();
+        ttffMs = (nowUs - mPrepareBeginUs) / 1000;
+        if (mStartBeginUs >= 0)
+            startMs = (nowUs - mStartBeginUs) / 1000;
+    }
+
+    INFO("time to first frame %" PRId64 " ms (%" PRId64 " ms after start)\n", ttffMs, startMs);
+    if (mMediaMeta)
+        mMediaMeta->setInt64(MEDIA_ATTR_TIME_TO_FIRST_FRAME, ttffMs);
+}
+
+int64_t PipelinePlayerBase::sinkPositionMs() const
+{
+    if (mSinkClockIndex < 0 || mSinkClockIndex >= (int32_t)mComponents.size())
+        return -1;
+
+    PlaySinkComponent *sink = DYNAMIC_CAST<PlaySinkComponent*>(mComponents[mSinkClockIndex].component.get());
+    if (!sink)
+        return -1;
+
+    int64_t positionUs = sink->getCurrentPosition();
+    return positionUs < 0 ? -1 : positionUs / 1000;
+}
+
+// the joined items become current once the sink renders them, all of them if positionMs is negative
+void PipelinePlayerBase::advanceItems(int64_t positionMs)
+{
+    std::list<ItemBoundary> started;
+    {
+        MMAutoLock locker(mLock);
+        while (!mItemBoundaries.empty() && (positionMs < 0 || mItemBoundaries.front().mStartMs <= positionMs)) {
+            ItemBoundary &boundary = mItemBoundaries.front();
+            mItemStartMs = boundary.mStartMs;
+            if (boundary.mDurationMs > 0)
+                mDurationMs = boundary.mDurationMs;
+            started.push_back(boundary);
+            mItemBoundaries.pop_front();
+        }
+    }
+
+    std::list<ItemBoundary>::iterator it;
+    for (it = started.begin(); it != started.end(); it++) {
+        if (it->mLoop > 0) {
+            INFO("loop %d started at %" PRId64 " ms\n", it->mLoop, it->mStartMs);
+            notify(int(Component::kEventInfo), int(PlaySourceComponent::kEventInfoLoopStarted), it->mLoop, nilParam);
+            continue;
+        }
+        INFO("next item started at %" PRId64 " ms, duration %" PRId64 " ms\n", it->mStartMs, it->mDurationMs);
+        notify(int(Component::kEventInfo), int(PlaySourceComponent::kEventInfoNextSourceStarted), int(it->mDurationMs), nilParam);
+    }
+}
+
+void PipelinePlayerBase::onCheckItemBoundary(param1_type param1, param2_type param2, uint32_t rspId)
+{
+    ASSERT(rspId == 0);
+    int64_t positionMs = sinkPositionMs();
+    if (positionMs >= 0)
+        advanceItems(positionMs);
+
+    int64_t waitMs = 0;
+    {
+        MMAutoLock locker(mLock);
+        if (mItemBoundaries.empty() || mState < kComponentStatePrepared || mState > kComponentStatePlaying)
+            return;
+        waitMs = positionMs < 0 ? 100 : mItemBoundaries.front().mStartMs - positionMs;
+    }
+
+    // poll closer as the boundary comes near
+    if (waitMs < 10)
+        waitMs = 10;
+    else if (waitMs > 200)
+        waitMs = 200;
+    postMsg(PL_MSG_checkItemBoundary, 0, NULL, waitMs * 1000);
+}
+
 MMParamSP PipelinePlayerBase::getTrackInfo()
 {
     FUNC_TRACK();
@@ -432,6 +613,13 @@ mm_status_t PipelinePlayerBase::prepare()
         mMediaMeta = MediaMeta::create();
     }
 
+    {
+        MMAutoLock locker(mLock);
+        mPrepareBeginUs = getTimeUs();
+        mStartBeginUs = -1;
+        mFirstFrameReported = false;
+    }
+
     mm_status_t status = MM_ERROR_SUCCESS;
     status = prepareInternal();
     if (status != MM_ERROR_SUCCESS) {
@@ -448,6 +636,12 @@ mm_status_t PipelinePlayerBase::start()
     mm_status_t status = MM_ERROR_SUCCESS;
     CHECK_PIPELINE_STATE(kComponentStatePlaying, Component::kEventStartResult);
 
+    handOverNextUri();
+    {
+        MMAutoLock locker(mLock);
+        if (mStartBeginUs < 0)
+            mStartBeginUs = getTimeUs();
+    }
     SET_PIPELINE_STATE(status, start, kComponentStatePlay, kComponentStatePlaying, Component::kEventStartResult);
 
     return status;
@@ -568,6 +762,9 @@ mm_status_t PipelinePlayerBase::seek(SeekEventParamSP param)
     setState(mComponents[mDemuxIndex].state2, kComponentStateInvalid);
     setState(mState2, kComponentStateInvalid);
 
+    // the source seeks in the item it is reading, which may not be rendered yet
+    advanceItems(-1);
+
     int64_t msec = param->getSeekTime();
     DEBUG("seek to %" PRId64, msec);
     status = source->seek(msec, mSeekSequence);
@@ -712,6 +909,12 @@ mm_status_t PipelinePlayerBase::reset()
     // always destroy the components here.
     mComponents.clear();
     resetMemberVariables();
+    {
+        MMAutoLock locker(mLock);
+        mNextUriHandedOver = false;
+        mItemStartMs = 0;
+        mItemBoundaries.clear();
+    }
     mMediaMeta.reset();
     mClock.reset();
     mDownloadPath.clear();
@@ -872,6 +1075,13 @@ void PipelinePlayerBase::onComponentMessage(param1_type param1, param2_type para
                     if (done && mComponents.size()>1) {  // during pipelineplayerbase construction, we should NOT send kEventPrepareResult when there is demux component only
                         INFO("pipelineplayerbase reach state %s\n", sInternalStateStr[reachedState]);
                         setState(mState, reachedState);
+                        if (event == Component::kEventPrepareResult && mPrepareBeginUs >= 0 && mMediaMeta) {
+                            int64_t prepareMs = (getTimeUs() - mPrepareBeginUs) / 1000;
+                            INFO("prepare cost %" PRId64 " ms\n", prepareMs);
+                            mMediaMeta->setInt64(MEDIA_ATTR_PREPARE_TIME, prepareMs);
+                        } else if (event == Component::kEventStartResult && !mHasVideo) {
+                            reportFirstFrame();
+                        }
                         // inform upper layer state change is done
                         if (event == Component::kEventResumed) {
                             DEBUG("kEventResumed --> kEventStartResult");
@@ -1080,6 +1290,7 @@ void PipelinePlayerBase::onComponentMessage(param1_type param1, param2_type para
                     break;
                 case Component::kEventInfoVideoRenderStart:
                     INFO("receive and send kEventInfoVideoRenderStart\n");
+                    reportFirstFrame();
                     notify(int(Component::kEventInfo), int(Component::kEventInfoVideoRenderStart), 0, nilParam);
                     break;
                 case Component::kEventInfoMediaRenderStarted:
@@ -1094,6 +1305,39 @@ void PipelinePlayerBase::onComponentMessage(param1_type param1, param2_type para
                         mSeekPreviewDoneCondition.broadcast();
                     }
                     break;
+                case PlaySourceComponent::kEventInfoNextSourceStarted:
+                {
+                    ItemBoundary boundary;
+                    boundary.mStartMs = (int32_t)(intptr_t)param2;
+                    boundary.mDurationMs = paramRef->mParam ? paramRef->mParam->readInt64() : -1;
+                    boundary.mLoop = 0;
+                    INFO("%s joined the next item at %" PRId64 " ms\n", sender->name(), boundary.mStartMs);
+                    {
+                        MMAutoLock locker(mLock);
+                        if (!mUriQueue.empty())
+                            mUriQueue.pop_front();
+                        mNextUriHandedOver = false;
+                        mItemBoundaries.push_back(boundary);
+                    }
+                    handOverNextUri();
+                    postMsg(PL_MSG_checkItemBoundary, 0, NULL, 0);
+                }
+                    break;
+                case PlaySourceComponent::kEventInfoLoopStarted:
+                {
+                    // same duration, the position restarts from 0 once the sink renders the wrap
+                    ItemBoundary boundary;
+                    boundary.mStartMs = (int32_t)(intptr_t)param2;
+                    boundary.mDurationMs = -1;
+                    boundary.mLoop = paramRef->mParam ? paramRef->mParam->readInt32() : 1;
+                    DEBUG("%s looped at %" PRId64 " ms\n", sender->name(), boundary.mStartMs);
+                    {
+                        MMAutoLock locker(mLock);
+                        mItemBoundaries.push_back(boundary);
+                    }
+                    postMsg(PL_MSG_checkItemBoundary, 0, NULL, 0);
+                }
+                    break;
                 case Component::kEventCostMemorySize:
                     INFO("receive and send kEventCostMemorySize\n");
                     notify(int(Component::kEventInfo), int(Component::kEventCostMemorySize), reinterpret_cast<int32_t>(param2), nilParam);
@@ -1235,6 +1479,14 @@ mm_status_t PipelinePlayerBase::getCurrentPosition(int64_t& positionMs) const
     } else {
         mSeekPositionMs = -1; //clear position once we got right current position
         positionMs /= 1000;
+
+        // relative to the current item, including the joined one being rendered already
+        MMAutoLock locker(mLock);
+        int64_t startMs = mItemStartMs;
+        std::list<ItemBoundary>::const_iterator it;
+        for (it = mItemBoundaries.begin(); it != mItemBoundaries.end() && it->mStartMs <= positionMs; it++)
+            startMs = it->mStartMs;
+        positionMs = positionMs > startMs ? positionMs - startMs : 0;
     }
 
     DEBUG("getCurrentPosition %" PRId64 " ms", positionMs);
@@ -1384,6 +1636,7 @@ mm_status_t PipelinePlayerBase::setParameter(const MediaMetaSP & meta)
                 INFO("mScaledPlayRate already is %d\n", mScaledPlayRate);
                 continue;
             }
+            bool reverse = (item.mValue.ii < 0) != (mScaledPlayRate < 0);
             mScaledPlayRate = item.mValue.ii;
 
             INFO("key: %s, value: %d\n", item.mName, mScaledPlayRate);
@@ -1397,6 +1650,10 @@ mm_status_t PipelinePlayerBase::setParameter(const MediaMetaSP & meta)
                 flush();
 
                 DEBUG("variable play --> normal play, flush done\n");
+            } else if (reverse) {
+                //queued frames are in the other direction
+                DEBUG("play direction changes, flush\n");
+                flush();
             }
 
             for (uint32_t i=0; i<mComponents.size(); i++) {
@@ -1425,6 +1682,10 @@ mm_status_t PipelinePlayerBase::setParameter(const MediaMetaSP & meta)
         if (!strcmp(item.mName, MEDIA_ATTR_FILE_DOWNLOAD_PATH) && item.mType == MediaMeta::MT_String) {
             mDownloadPath = item.mValue.str;
         }
+        if (!strcmp(item.mName, PlaySourceComponent::PARAM_KEY_SEAMLESS_LOOP) && item.mType == MediaMeta::MT_Int32) {
+            mSeamlessLoop = item.mValue.ii;
+            applySeamlessLoop();
+        }
 
         // codec parameters
         if (!strncmp("codec-", item.mName, 6) ||
@@ -14,6 +14,8 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 #include "pipeline_recorder_base.h"
@@ -32,6 +34,9 @@ BEGIN_MSG_LOOP(PipelineRecorderBase)
 END_MSG_LOOP()
 
 
+// output queue depth behind the tee, about one second of video
+static const int32_t OUTPUT_QUEUE_SIZE_DEF = 30;
+
 #define SET_PARAMETER_INT32(key, from, to) do {   \
     int32_t i = 0;                                \
     if (from->getInt32(key, i)) {                 \
@@ -358,6 +363,7 @@ mm_status_t PipelineRecorderBase::reset()
     // FIXME: destroy all components, restart recorder is required to begin from prepare()
     // always destroy the components here.
     mComponents.clear();
+    mOutputs.clear();
     return status;
 }
 
@@ -601,6 +607,13 @@ void PipelineRecorderBase::onComponentMessage(param1_type param1, param2_type pa
                 case Component::kEventInfoMediaRenderStarted:
                     notify(int(Component::kEventInfo), int(Component::kEventInfoMediaRenderStarted), 0, nilParam);
                     break;
+                case Component::kEventSegmentCompleted:
+                {
+                    int32_t index = (int32_t)(intptr_t)param2;
+                    INFO("segment %d completed\n", index);
+                    notify(int(Component::kEventInfo), int(Component::kEventSegmentCompleted), index, paramSP);
+                }
+                    break;
                 default:
                     notify(event, param1, 0, nilParam);
                     break;
@@ -698,6 +711,18 @@ mm_status_t PipelineRecorderBase::setParameter(const MediaMetaSP & meta)
     SET_PARAMETER_STRING(MEDIA_ATTR_FILE_PATH, meta, mMediaMetaFile);
     SET_PARAMETER_STRING(MEDIA_ATTR_OUTPUT_FORMAT, meta, mMediaMetaFile);
     SET_PARAMETER_INT32(MEDIA_ATTR_ROTATION, meta, mMediaMetaFile);
+    SET_PARAMETER_INT32(MEDIA_ATTR_PRE_ROLL_DURATION, meta, mMediaMetaFile);
+    SET_PARAMETER_INT32(MEDIA_ATTR_PRE_ROLL_MAX_BYTES, meta, mMediaMetaFile);
+    SET_PARAMETER_INT32(MEDIA_ATTR_FILE_ROTATION, meta, mMediaMetaFile);
+    SET_PARAMETER_INT32(MEDIA_ATTR_SEGMENT_DURATION, meta, mMediaMetaFile);
+    SET_PARAMETER_INT32(MEDIA_ATTR_SEGMENT_PART_DURATION, meta, mMediaMetaFile);
+    SET_PARAMETER_INT32(MEDIA_ATTR_SEGMENT_LIST_SIZE, meta, mMediaMetaFile);
+
+    const char * specs = NULL;
+    if (meta->getString(MEDIA_ATTR_OUTPUT_SPECS, specs) && specs) {
+        DEBUG("output specs %s", specs);
+        mOutputSpecs = specs;
+    }
 
     //for audio
     SET_PARAMETER_INT32(MEDIA_ATTR_SAMPLE_RATE, meta, mMediaMetaAudio);
@@ -837,6 +862,173 @@ mm_status_t PipelineRecorderBase::setOutputFormat(const char* extension)
     return MM_ERROR_SUCCESS;
 }
 
+/*static*/const char * PipelineRecorderBase::getFileSinkMime(const MediaMetaSP & meta)
+{
+    int32_t segmentMs = 0;
+    const char * format = NULL;
+    if ((meta->getInt32(MEDIA_ATTR_SEGMENT_DURATION, segmentMs) && segmentMs > 0) ||
+        (meta->getString(MEDIA_ATTR_OUTPUT_FORMAT, format) && format &&
+        (!strcmp(format, "hls") || !strcmp(format, "dash")))) {
+        return MEDIA_MIMETYPE_MEDIA_SEGMENTER_SINK;
+    }
+    return MEDIA_MIMETYPE_MEDIA_FILE_SINK;
+}
+
+mm_status_t PipelineRecorderBase::createOutputs(int32_t trackCount)
+{
+    FUNC_TRACK();
+    mOutputs.clear();
+
+    Output primary;
+    primary.mMeta = mMediaMetaFile;
+    primary.mDrop = false;
+    primary.mQueueSize = OUTPUT_QUEUE_SIZE_DEF;
+    mOutputs.push_back(primary);
+
+    // "<format>,<path>[,drop][,queue=<n>];..."
+    size_t start = 0;
+    while (start < mOutputSpecs.size()) {
+        size_t end = mOutputSpecs.find(';', start);
+        if (end == std::string::npos)
+            end = mOutputSpecs.size();
+        std::string spec = mOutputSpecs.substr(start, end - start);
+        start = end + 1;
+        if (spec.empty())
+            continue;
+
+        std::vector<std::string> fields;
+        size_t pos = 0;
+        while (pos <= spec.size()) {
+            size_t comma = spec.find(',', pos);
+            if (comma == std::string::npos)
+                comma = spec.size();
+            fields.push_back(spec.substr(pos, comma - pos));
+            pos = comma + 1;
+        }
+        if (fields.size() < 2 || fields[0].empty() || fields[1].empty()) {
+            WARNING("invalid output spec %s\n", spec.c_str());
+            continue;
+        }
+
+        Output output;
+        output.mMeta = MediaMeta::create();
+        output.mMeta->setString(MEDIA_ATTR_OUTPUT_FORMAT, fields[0].c_str());
+        output.mMeta->setString(MEDIA_ATTR_FILE_PATH, fields[1].c_str());
+        SET_PARAMETER_INT32(MEDIA_ATTR_ROTATION, mMediaMetaFile, output.mMeta);
+        output.mDrop = false;
+        output.mQueueSize = OUTPUT_QUEUE_SIZE_DEF;
+        for (size_t i = 2; i < fields.size(); i++) {
+            if (fields[i] == "drop") {
+                output.mDrop = true;
+            } else if (!strncmp(fields[i].c_str(), "queue=", 6) && atoi(fields[i].c_str() + 6) > 0) {
+                output.mQueueSize = atoi(fields[i].c_str() + 6);
+            } else {
+                WARNING("unknown option %s of output %s\n", fields[i].c_str(), fields[1].c_str());
+            }
+        }
+        INFO("output %zu: %s %s, drop %d, queue %d\n", mOutputs.size(), fields[0].c_str(), fields[1].c_str(),
+            output.mDrop, output.mQueueSize);
+        mOutputs.push_back(output);
+    }
+
+    for (size_t i = 0; i < mOutputs.size(); i++) {
+        Output & output = mOutputs[i];
+        const char * format = NULL;
+        output.mMeta->getString(MEDIA_ATTR_OUTPUT_FORMAT, format);
+        bool isRtp = format && (strstr(format, "rtp") || strstr(format, "RTP"));
+
+        output.mMuxer = createComponentHelper(NULL, isRtp ? MEDIA_MIMETYPE_MEDIA_RTP_MUXER : MEDIA_MIMETYPE_MEDIA_MUXER,
+            mListenerReceive, false);
+        if (!output.mMuxer) {
+            ERROR("failed to create muxer of output %zu\n", i);
+            return MM_ERROR_NO_COMPONENT;
+        }
+        if (!isRtp) {
+            output.mSink = createComponentHelper(NULL, getFileSinkMime(output.mMeta), mListenerReceive, false);
+            if (!output.mSink) {
+                ERROR("failed to create sink of output %zu\n", i);
+                return MM_ERROR_NO_COMPONENT;
+            }
+        }
+
+        MMAutoLock locker(mLock);
+        mComponents.push_back(ComponentInfo(output.mMuxer, ComponentInfo::kComponentTypeFilter));
+        if (i == 0)
+            mMuxIndex = mComponents.size() - 1;
+        if (output.mSink) {
+            mComponents.push_back(ComponentInfo(output.mSink, ComponentInfo::kComponentTypeSink));
+            if (i == 0) {
+                mSinkIndex = mComponents.size() - 1;
+                mSinkClockIndex = mSinkIndex;
+            }
+        }
+        // a sink notifies EOS once, an rtp muxer (no sink) once per track, single output or not
+        mConnectedStreamCount += output.mSink ? 1 : trackCount;
+    }
+
+    return MM_ERROR_SUCCESS;
+}
+
+mm_status_t PipelineRecorderBase::connectOutputs(Component * encoder, Component::MediaType mediaType)
+{
+    FUNC_TRACK();
+    mm_status_t status = MM_ERROR_SUCCESS;
+    if (mOutputs.size() == 1) {
+        return encoder->addSink(mOutputs[0].mMuxer.get(), mediaType);
+    }
+
+    // encode once: the tee shares the encoded buffers, each muxer gets its own queue
+    ComponentSP tee = createComponentHelper("MediaFission", "media/all", mListenerReceive);
+    if (!tee) {
+        return MM_ERROR_NO_COMPONENT;
+    }
+    {
+        MMAutoLock locker(mLock);
+        mComponents.push_back(ComponentInfo(tee, ComponentInfo::kComponentTypeFilter));
+    }
+
+    status = encoder->addSink(tee.get(), mediaType);
+    ASSERT_RET(status == MM_ERROR_SUCCESS, MM_ERROR_COMPONENT_CONNECT_FAILED);
+
+    for (size_t i = 0; i < mOutputs.size(); i++) {
+        MediaMetaSP meta = MediaMeta::create();
+        meta->setInt32(MEDIA_ATTR_OUTPUT_QUEUE_SIZE, mOutputs[i].mQueueSize);
+        meta->setInt32(MEDIA_ATTR_OUTPUT_DROP, mOutputs[i].mDrop ? 1 : 0);
+        tee->setParameter(meta);
+
+        status = tee->addSink(mOutputs[i].mMuxer.get(), mediaType);
+        ASSERT_RET(status == MM_ERROR_SUCCESS, MM_ERROR_COMPONENT_CONNECT_FAILED);
+    }
+
+    return status;
+}
+
+mm_status_t PipelineRecorderBase::setupOutputs(Component::MediaType mediaType)
+{
+    FUNC_TRACK();
+    mm_status_t status = MM_ERROR_SUCCESS;
+    for (size_t i = 0; i < mOutputs.size(); i++) {
+        Output & output = mOutputs[i];
+        if (output.mSink) {
+            status = output.mMuxer->addSink(output.mSink.get(), mediaType);
+            ASSERT_RET(status == MM_ERROR_SUCCESS, MM_ERROR_COMPONENT_CONNECT_FAILED);
+        }
+
+        // setup components parameters
+        status = output.mMuxer->setParameter(output.mMeta);
+        if (status != MM_ERROR_SUCCESS)
+            return status;
+
+        if (output.mSink) {
+            status = output.mSink->setParameter(output.mMeta);
+            if (status != MM_ERROR_SUCCESS)
+                return status;
+        }
+    }
+
+    return status;
+}
+
 mm_status_t PipelineRecorderBase::setOutputFile(const char* filePath)
 {
     FUNC_TRACK();
@@ -94,6 +94,15 @@ class PipelineRecorderBase : public Pipeline {
      //resetInternal can be implemented by each derived class if needed
      virtual mm_status_t resetInternal(){return MM_ERROR_SUCCESS;}
      virtual Component* getSourceComponent(bool isAudio = false);
+     // the segmenter sink for live segments ("segment-duration-ms", output format "hls"/"dash"), else the file sink
+     static const char * getFileSinkMime(const MediaMetaSP & meta);
+
+     // outputs: the primary one (mMediaMetaFile) and the ones of "output-specs", each with its muxer and sink.
+     // with more than one, every encoder feeds a MediaFission which hands the encoded buffers to all muxers.
+     // createOutputs() before the encoders are connected, setupOutputs() at last.
+     mm_status_t createOutputs(int32_t trackCount);
+     mm_status_t connectOutputs(Component * encoder, Component::MediaType mediaType);
+     mm_status_t setupOutputs(Component::MediaType mediaType);
 
     //protected?
   public:
@@ -173,6 +182,16 @@ class PipelineRecorderBase : public Pipeline {
     MediaMetaSP mMediaMetaOutput;
 
     std::string mOutputFormat;
+    std::string mOutputSpecs;
+
+    struct Output {
+        MediaMetaSP mMeta;      // output format, file path
+        bool mDrop;             // a full queue drops (video up to the next key frame) instead of holding the encoder
+        int32_t mQueueSize;
+        ComponentSP mMuxer;
+        ComponentSP mSink;      // NULL when the muxer is the sink (rtp)
+    };
+    std::vector<Output> mOutputs;   // [0]: the primary output, mMuxIndex/mSinkIndex
 
     RecorderUsage mUsage;
     int64_t mDelayTimeUs; // start delay time, in us
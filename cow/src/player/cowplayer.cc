@@ -18,6 +18,7 @@
 
 #include "multimedia/media_attr_str.h"
 #include "multimedia/cowplayer.h"
+#include "multimedia/memory_asset.h"
 #include "pipeline_player.h"
 #include "pipeline_LPA.h"
 #include "multimedia/pipeline_audioplayer.h"
@@ -148,9 +149,11 @@ class CowPlayer::Private : public MMMsgThread
     int mFd;
     int64_t mOffset;
     int64_t mLength;
+    MemoryAssetSP mMemAsset; // of setDataSource(mem, size), until reset
     //MediaMetaSP mParam;
     SeekEventParamSP mSeekParam;
     int mPlayType;
+    bool mLoop; // of setLoop(), handed to every pipeline
 
     Private()
         : MMMsgThread(MMMSGTHREAD_NAME)
@@ -158,6 +161,7 @@ class CowPlayer::Private : public MMMsgThread
         , mOffset(-1)
         , mLength(-1)
         , mPlayType(0)
+        , mLoop(false)
     {
         FUNC_TRACK();
         mSeekParam = SeekEventParam::create();
@@ -168,6 +172,7 @@ class CowPlayer::Private : public MMMsgThread
         if (pipeline) {
             mPipeline = pipeline;
             mPipeline->setListener(mListenerReceive);
+            applyLoop();
         }
         return MM_ERROR_SUCCESS;
     }
@@ -186,9 +191,19 @@ class CowPlayer::Private : public MMMsgThread
             mPipeline = Pipeline::create(new PipelinePlayer(), mListenerReceive);
             ASSERT(mPipeline);
         }
+        applyLoop();
         return mPipeline;
     }
 
+    // the source wraps to the start by itself when it can; EOS (seek and restart) otherwise
+    void applyLoop() {
+        if (!mPipeline)
+            return;
+        MediaMetaSP meta = MediaMeta::create();
+        meta->setInt32(PlaySourceComponent::PARAM_KEY_SEAMLESS_LOOP, mLoop ? 1 : 0);
+        mPipeline->setParameter(meta);
+    }
+
     void flushCommandList() // discard the pending actions in message List
     {
         MMAutoLock locker(mMsgThrdLock);
@@ -212,6 +227,7 @@ class CowPlayer::Private : public MMMsgThread
     DECLARE_MSG_HANDLER(onSeek)
     DECLARE_MSG_HANDLER(onReset)
     DECLARE_MSG_HANDLER2(onSetParameter)
+    DECLARE_MSG_HANDLER(onPlayNext)
 };
 
 #define CPP_MSG_pipelineMessage (MMMsgThread::msg_type)1
@@ -227,6 +243,7 @@ class CowPlayer::Private : public MMMsgThread
 #define CPP_MSG_setParameterMessage (MMMsgThread::msg_type)11
 #define CPP_MSG_setDisplayName (MMMsgThread::msg_type)12
 #define CPP_MSG_setSubtitleSource (MMMsgThread::msg_type)13
+#define CPP_MSG_playNextMessage (MMMsgThread::msg_type)14
 
 
 BEGIN_MSG_LOOP(CowPlayer::Private)
@@ -242,6 +259,7 @@ BEGIN_MSG_LOOP(CowPlayer::Private)
     MSG_ITEM(CPP_MSG_seekMessage, onSeek)
     MSG_ITEM(CPP_MSG_resetMessage, onReset)
     MSG_ITEM2(CPP_MSG_setParameterMessage, onSetParameter)
+    MSG_ITEM(CPP_MSG_playNextMessage, onPlayNext)
 END_MSG_LOOP()
 
 CowPlayer::CowPlayer(int playType)
@@ -334,6 +352,50 @@ void CowPlayer::Private::onSetDataSource_1(param1_type param1, param2_type param
     CHECK_PIPELINE_RET(status, "setDataSource");
 }
 
+mm_status_t CowPlayer::queueDataSource(const char * uri,
+                 const std::map<std::string, std::string> * headers)
+{
+    FUNC_TRACK();
+    MMAutoLock locker(mPriv->mLock);
+    ENSURE_PIPELINE();
+
+    return mPriv->mPipeline->queueUri(uri, headers);
+}
+
+mm_status_t CowPlayer::clearDataSourceQueue()
+{
+    FUNC_TRACK();
+    MMAutoLock locker(mPriv->mLock);
+    ENSURE_PIPELINE();
+
+    return mPriv->mPipeline->clearQueue();
+}
+
+// the queued source couldn't be joined by the demuxer, rebuild the pipeline for it
+void CowPlayer::Private::onPlayNext(param1_type param1, param2_type param2, uint32_t rspId)
+{
+    FUNC_TRACK();
+    ASSERT(rspId == 0);
+
+    mm_status_t status = mPipeline->stop();
+    CHECK_PIPELINE_RET(status, "stop");
+    status = mPipeline->reset();
+    CHECK_PIPELINE_RET(status, "reset");
+
+    status = mPipeline->load(mUri.c_str(), &mHeaders);
+    CHECK_PIPELINE_RET(status, "setDataSource");
+    if (status != MM_ERROR_SUCCESS)
+        return;
+    status = mPipeline->prepare();
+    CHECK_PIPELINE_RET(status, "prepare");
+    if (status != MM_ERROR_SUCCESS)
+        return;
+    status = mPipeline->start();
+    CHECK_PIPELINE_RET(status, "start");
+    if (status == MM_ERROR_SUCCESS)
+        mPipeline->postCowMsgBridge(Component::kEventInfo, PlaySourceComponent::kEventInfoNextSourceStarted, NULL);
+}
+
 mm_status_t CowPlayer::setDataSourceAsync(int fd, int64_t offset, int64_t length)
 {
     FUNC_TRACK();
@@ -380,11 +442,21 @@ mm_status_t CowPlayer::setDataSource(const unsigned char * mem, size_t size)
 {
     FUNC_TRACK();
     MMAutoLock locker(mPriv->mLock);
-    // ENSURE_PIPELINE();
+    ENSURE_PIPELINE();
 
-    ERROR("not implemented yet\n");
-    return MM_ERROR_UNSUPPORTED;
-    // return mPipeline->setDataSource(mem, size);
+    // no copy, the caller keeps the memory until reset; players of the same memory share the asset
+    MemoryAssetSP asset = MemoryAssetCache::wrap(mem, size);
+    if (!asset)
+        return MM_ERROR_INVALID_PARAM;
+
+    mPriv->mMemAsset = asset;
+    mPriv->mUri = asset->uri();
+    mPriv->mHeaders.clear();
+    INFO("got memory source %p, %zu bytes: %s\n", mem, size, mPriv->mUri.c_str());
+
+    mPriv->postMsgBridge(CPP_MSG_setDataSource1Message, 0, NULL);
+
+    return MM_ERROR_ASYNC;
 }
 
 mm_status_t CowPlayer::setSubtitleSource(const char* uri)
@@ -702,6 +774,7 @@ void CowPlayer::Private::onReset(param1_type param1, param2_type param2, uint32_
     FUNC_TRACK();
 
     mm_status_t status = mPipeline->reset();
+    mMemAsset.reset();
 
     CHECK_PIPELINE_RET(status, "reset");
 
@@ -790,6 +863,9 @@ mm_status_t CowPlayer::setLoop(bool loop)
     FUNC_TRACK();
     MMAutoLock locker(mPriv->mLock);
     mLoop = loop;
+    // applied now or when the pipeline is created
+    mPriv->mLoop = loop;
+    mPriv->applyLoop();
     return MM_ERROR_SUCCESS;
 }
 
@@ -898,6 +974,19 @@ void CowPlayer::Private::onPipelineMessage(param1_type param1, param2_type param
 mm_status_t CowPlayer::notify(int msg, int param1, int param2, const MMParamSP param)
 {
     //FUNC_TRACK();
+    if (msg == Component::kEventEOS && mPriv->mPipeline) {
+        std::string uri;
+        std::map<std::string, std::string> headers;
+        if (mPriv->mPipeline->dequeueUri(uri, headers)) {
+            INFO("EOS, play the next queued source: %s\n", uri.c_str());
+            MMAutoLock locker(mPriv->mLock);
+            mPriv->mUri = uri;
+            mPriv->mHeaders = headers;
+            mPriv->postMsgBridge(CPP_MSG_playNextMessage, 0, NULL);
+            return MM_ERROR_SUCCESS;
+        }
+    }
+
     {
         MMAutoLock locker(mPriv->mLock);
         if ( !mListenderSend ) {
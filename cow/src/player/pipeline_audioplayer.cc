@@ -62,8 +62,12 @@ mm_status_t PipelineAudioPlayer::prepareInternal()//audio source is followed by
 
     while (audioMime) {
         // setup audio components
-        ComponentSP audioDecoder = createComponentHelper(NULL, audioMime);
-        ComponentSP audioSink = createComponentHelper(NULL, MEDIA_MIMETYPE_AUDIO_RENDER);
+        std::vector<ComponentRequest> requests;
+        requests.push_back(ComponentRequest(NULL, audioMime));
+        requests.push_back(ComponentRequest(NULL, MEDIA_MIMETYPE_AUDIO_RENDER));
+        createComponentsHelper(requests);
+        ComponentSP audioDecoder = requests[0].component;
+        ComponentSP audioSink = requests[1].component;
         if (!audioDecoder) {
             ERROR("fail to create audio decoder\n");
             break;
@@ -189,15 +189,35 @@ mm_status_t PipelinePlayer::prepareInternal()//audio source is followed by video
 
     mMediaMeta->setInt32(MEDIA_ATTR_VARIABLE_RATE_SUPPORT, false);
 
-
-    while (videoMime) {
-        // setup video components
-        videoDecoder = createComponentHelper(NULL, videoMime);
+    // decoders and sinks depend on the track mime only, create them in parallel
+    std::vector<ComponentRequest> requests;
+    int32_t videoDecoderReq = -1, videoFilterReq = -1, videoSinkReq = -1;
+    int32_t audioDecoderReq = -1, audioSinkReq = -1;
+    if (videoMime) {
+        videoDecoderReq = requests.size();
+        requests.push_back(ComponentRequest(NULL, videoMime));
         if (mm_check_env_str("mm.player.gl.filter","MM_PLAYER_GL_FILTER", "1", false)) {
             INFO("test OpenGL video filter in cowplayer");
-            videoFilter = createComponentHelper(NULL, "video/filter-gl");
+            videoFilterReq = requests.size();
+            requests.push_back(ComponentRequest(NULL, "video/filter-gl"));
         }
-        videoSink = createComponentHelper(NULL, MEDIA_MIMETYPE_VIDEO_RENDER);
+        videoSinkReq = requests.size();
+        requests.push_back(ComponentRequest(NULL, MEDIA_MIMETYPE_VIDEO_RENDER));
+    }
+    if (audioMime) {
+        audioDecoderReq = requests.size();
+        requests.push_back(ComponentRequest(NULL, audioMime));
+        audioSinkReq = requests.size();
+        requests.push_back(ComponentRequest(NULL, MEDIA_MIMETYPE_AUDIO_RENDER));
+    }
+    createComponentsHelper(requests);
+
+    while (videoMime) {
+        // setup video components
+        videoDecoder = requests[videoDecoderReq].component;
+        if (videoFilterReq >= 0)
+            videoFilter = requests[videoFilterReq].component;
+        videoSink = requests[videoSinkReq].component;
         //ASSERT_RET(videoDecoder && videoSink, MM_ERROR_NO_COMPONENT);
         if (!videoDecoder) {
             status = MM_ERROR_NO_COMPONENT;
@@ -292,8 +312,8 @@ mm_status_t PipelinePlayer::prepareInternal()//audio source is followed by video
 
     while (audioMime) {
         // setup audio components
-        ComponentSP audioDecoder = createComponentHelper(NULL, audioMime);
-        ComponentSP audioSink = createComponentHelper(NULL, MEDIA_MIMETYPE_AUDIO_RENDER);
+        ComponentSP audioDecoder = requests[audioDecoderReq].component;
+        ComponentSP audioSink = requests[audioSinkReq].component;
         // ASSERT_RET(audioDecoder && audioSink, MM_ERROR_NO_COMPONENT);
         if (!audioDecoder) {
             ERROR("fail to create audio decoder\n");
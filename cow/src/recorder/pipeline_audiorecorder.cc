@@ -54,22 +54,9 @@ mm_status_t PipelineAudioRecorder::prepareInternal()//audio source is followed b
 #ifdef __MM_YUNOS_LINUX_BSP_BUILD__
     audioSource->setAudioConnectionId(mAudioConnectionId.c_str());
 #endif
-    ComponentSP muxer = createComponentHelper(NULL, MEDIA_MIMETYPE_MEDIA_MUXER, mListenerReceive, false);
-    ASSERT(muxer);
-    muxer->setParameter(mMediaMetaFile);
-    ComponentSP fileSink = createComponentHelper(NULL, MEDIA_MIMETYPE_MEDIA_FILE_SINK, mListenerReceive, false);
-    ASSERT(fileSink);
-    fileSink->setParameter(mMediaMetaFile);
-
-    {
-        MMAutoLock locker(mLock);
-        mComponents.push_back(ComponentInfo(muxer, ComponentInfo::kComponentTypeFilter));
-        mMuxIndex = mComponents.size() - 1;
-        mComponents.push_back(ComponentInfo(fileSink, ComponentInfo::kComponentTypeSink));
-        mSinkIndex = mComponents.size() - 1;
-        mConnectedStreamCount++;
-        mSinkClockIndex = mComponents.size() - 1;
-    }
+    status = createOutputs(1);
+    if (status != MM_ERROR_SUCCESS)
+        return status;
 
     ComponentSP audioEncoder;
     // create components, setup pipeline
@@ -78,8 +65,8 @@ mm_status_t PipelineAudioRecorder::prepareInternal()//audio source is followed b
 
     audioEncoder->setParameter(mMediaMetaAudio);
 
-    DEBUG("audio encoder: %p, muxer: %p, fileSink: %p\n", audioEncoder.get(), muxer.get(), fileSink.get());
-    if (!audioEncoder || !muxer || !fileSink) {
+    DEBUG("audio encoder: %p, outputs: %zu\n", audioEncoder.get(), mOutputs.size());
+    if (!audioEncoder) {
         return MM_ERROR_NO_COMPONENT;
     }
 
@@ -109,11 +96,10 @@ mm_status_t PipelineAudioRecorder::prepareInternal()//audio source is followed b
     status = audioEncoder->addSource(audioSource.get(), Component::kMediaTypeAudio);
     ASSERT_RET(status == MM_ERROR_SUCCESS, MM_ERROR_COMPONENT_CONNECT_FAILED);
 
-    status = audioEncoder->addSink(muxer.get(), Component::kMediaTypeAudio);
+    status = connectOutputs(audioEncoder.get(), Component::kMediaTypeAudio);
     ASSERT_RET(status == MM_ERROR_SUCCESS, MM_ERROR_COMPONENT_CONNECT_FAILED);
 
-    status = muxer->addSink(fileSink.get(),
-        Component::MediaType(Component::kMediaTypeAudio));
+    status = setupOutputs(Component::kMediaTypeAudio);
     ASSERT_RET(status == MM_ERROR_SUCCESS, MM_ERROR_COMPONENT_CONNECT_FAILED);
 
 
@@ -56,7 +56,7 @@ mm_status_t PipelineRTSPRecorder::prepareInternal()
     muxer->setParameter(mMediaMetaFile);
 
     MMLOGV("Creating filesink\n");
-    ComponentSP fileSink = createComponentHelper(NULL, MEDIA_MIMETYPE_MEDIA_FILE_SINK, mListenerReceive, false);
+    ComponentSP fileSink = createComponentHelper(NULL, getFileSinkMime(mMediaMetaFile), mListenerReceive, false);
     if (fileSink == NULL) {
         MMLOGE("failed to create fileSink\n");
         return MM_ERROR_OP_FAILED;
@@ -60,11 +60,6 @@ mm_status_t PipelineVideoRecorder::prepareInternal()
 
     ASSERT(mComponents.size() == 0);
 
-    bool isRtp = false;
-    if ( strstr(mOutputFormat.c_str(), "rtp") ||
-          strstr(mOutputFormat.c_str(), "RTP"))
-          isRtp = true;
-
     if (mHasAudio) {
         audioSource = createComponentHelper(NULL,
             Pipeline::getSourceUri(mAudioSourceUri.c_str(), true).c_str(),
@@ -94,15 +89,6 @@ mm_status_t PipelineVideoRecorder::prepareInternal()
         videoSource->setParameter(mMediaMetaVideo);
     }
 
-    ComponentSP muxer, fileSink;
-    const char *muxerName = isRtp ? MEDIA_MIMETYPE_MEDIA_RTP_MUXER : MEDIA_MIMETYPE_MEDIA_MUXER;
-    muxer = createComponentHelper(NULL, muxerName, mListenerReceive, false);
-    ASSERT(muxer);
-    if ( !isRtp ) {
-        fileSink = createComponentHelper(NULL, MEDIA_MIMETYPE_MEDIA_FILE_SINK, mListenerReceive, false);
-        ASSERT(fileSink);
-    }
-
     /*
      * Sink and Source compoents should be ahead of codec component in vector.
      * If codec component changes to prepared/started state first,
@@ -110,18 +96,9 @@ mm_status_t PipelineVideoRecorder::prepareInternal()
      * but source component have not change to prepared/started state, which may cause to read failed/error.
      * it's the same to sink component.
      */
-    {
-        MMAutoLock locker(mLock);
-        mComponents.push_back(ComponentInfo(muxer, ComponentInfo::kComponentTypeFilter));
-        mMuxIndex = mComponents.size() - 1;
-        if (!isRtp) {
-            mComponents.push_back(ComponentInfo(fileSink, ComponentInfo::kComponentTypeSink));
-            mSinkIndex = mComponents.size() - 1;
-            mSinkClockIndex = mSinkIndex;
-        }
-        mConnectedStreamCount++;
-
-    }
+    status = createOutputs((mHasAudio ? 1 : 0) + (mHasVideo ? 1 : 0));
+    if (status != MM_ERROR_SUCCESS)
+        return status;
 
 
     ComponentSP audioEncoder;
@@ -134,8 +111,8 @@ mm_status_t PipelineVideoRecorder::prepareInternal()
         ASSERT(audioEncoder);
         audioEncoder->setParameter(mMediaMetaAudio);
 
-        DEBUG("audio encoder: %p, muxer: %p, fileSink: %p\n", audioEncoder.get(), muxer.get(), fileSink.get());
-        if (!audioEncoder || !muxer || ((!fileSink)&&(!isRtp))) {
+        DEBUG("audio encoder: %p, outputs: %zu\n", audioEncoder.get(), mOutputs.size());
+        if (!audioEncoder) {
             return MM_ERROR_NO_COMPONENT;
         }
 
@@ -166,7 +143,7 @@ mm_status_t PipelineVideoRecorder::prepareInternal()
         status = audioEncoder->addSource(audioSource.get(), Component::kMediaTypeAudio);
         ASSERT_RET(status == MM_ERROR_SUCCESS, MM_ERROR_COMPONENT_CONNECT_FAILED);
 
-        status = audioEncoder->addSink(muxer.get(), Component::kMediaTypeAudio);
+        status = connectOutputs(audioEncoder.get(), Component::kMediaTypeAudio);
         ASSERT_RET(status == MM_ERROR_SUCCESS, MM_ERROR_COMPONENT_CONNECT_FAILED);
 
     }
@@ -182,8 +159,8 @@ mm_status_t PipelineVideoRecorder::prepareInternal()
         videoEncoder = createComponentHelper(NULL, mVideoEncoderMime.c_str(), mListenerReceive, true);
         ASSERT(videoEncoder);
 
-        DEBUG("video encoder: %p, muxer: %p, fileSink: %p\n", videoEncoder.get(), muxer.get(), fileSink.get());
-        if (!videoEncoder || !muxer || (!fileSink  && !isRtp) || (addCameraRecordPreview && (!mediaFission || !videoSink))) {
+        DEBUG("video encoder: %p, outputs: %zu\n", videoEncoder.get(), mOutputs.size());
+        if (!videoEncoder || (addCameraRecordPreview && (!mediaFission || !videoSink))) {
             return MM_ERROR_NO_COMPONENT;
         }
 
@@ -228,7 +205,7 @@ mm_status_t PipelineVideoRecorder::prepareInternal()
 
             status = videoEncoder->addSource(mediaFission.get(), Component::kMediaTypeVideo);
             ASSERT_RET(status == MM_ERROR_SUCCESS, MM_ERROR_COMPONENT_CONNECT_FAILED);
-            status = videoEncoder->addSink(muxer.get(), Component::kMediaTypeVideo);
+            status = connectOutputs(videoEncoder.get(), Component::kMediaTypeVideo);
             ASSERT_RET(status == MM_ERROR_SUCCESS, MM_ERROR_COMPONENT_CONNECT_FAILED);
 
             status = mediaFission->addSink(videoSink.get(), Component::kMediaTypeVideo);
@@ -238,30 +215,15 @@ mm_status_t PipelineVideoRecorder::prepareInternal()
             status = videoEncoder->addSource(videoSource.get(), Component::kMediaTypeVideo);
             ASSERT_RET(status == MM_ERROR_SUCCESS, MM_ERROR_COMPONENT_CONNECT_FAILED);
 
-            status = videoEncoder->addSink(muxer.get(), Component::kMediaTypeVideo);
+            status = connectOutputs(videoEncoder.get(), Component::kMediaTypeVideo);
             ASSERT_RET(status == MM_ERROR_SUCCESS, MM_ERROR_COMPONENT_CONNECT_FAILED);
         }
     }
 
     if (mHasAudio | mHasVideo) {
-        if (!isRtp) {
-            status = muxer->addSink(fileSink.get(),
-                Component::MediaType(mHasVideo ? Component::kMediaTypeVideo : Component::kMediaTypeAudio));
-            ASSERT_RET(status == MM_ERROR_SUCCESS, MM_ERROR_COMPONENT_CONNECT_FAILED);
-
-            // setup components parameters
-            status = muxer->setParameter(mMediaMetaFile);
-            if (status != MM_ERROR_SUCCESS)
-                return status;
-
-            status = fileSink->setParameter(mMediaMetaFile);
-            if (status != MM_ERROR_SUCCESS)
-                return status;
-        } else {
-            status = muxer->setParameter(mMediaMetaFile);
-            if (status != MM_ERROR_SUCCESS)
-                return status;
-        }
+        status = setupOutputs(mHasVideo ? Component::kMediaTypeVideo : Component::kMediaTypeAudio);
+        if (status != MM_ERROR_SUCCESS)
+            return status;
     }
 
     return status;
@@ -360,6 +322,18 @@ mm_status_t PipelineVideoRecorder::setParameter(const MediaMetaSP & meta)
         }
     }
 
+    // an action, not kept in the file meta (it would trigger the next recording at once)
+    int32_t trigger = 0;
+    if (meta->getInt32(MEDIA_ATTR_PRE_ROLL_TRIGGER, trigger) && trigger) {
+        if (mMuxIndex < 0 || mMuxIndex >= (int32_t)mComponents.size()) {
+            ERROR("pre-roll trigger before prepare");
+            return MM_ERROR_INVALID_STATE;
+        }
+        MediaMetaSP triggerMeta = MediaMeta::create();
+        triggerMeta->setInt32(MEDIA_ATTR_PRE_ROLL_TRIGGER, trigger);
+        status = mComponents[mMuxIndex].component->setParameter(triggerMeta);
+    }
+
     return status;
 }
 
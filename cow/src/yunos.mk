@@ -34,6 +34,8 @@ LOCAL_SRC_FILES:= \
     pipeline_recorder_base.cc \
     pipeline_player_base.cc \
     cow_util.cc \
+    memory_asset.cc \
+    audio_process.cc \
     make_csd.cc \
     third_helper.cc \
     mm_vendor_format.cc
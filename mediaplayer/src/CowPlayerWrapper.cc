@@ -110,8 +110,8 @@ mm_status_t CowPlayerWrapper::setDataSource(int fd, int64_t offset, int64_t leng
 
 mm_status_t CowPlayerWrapper::setDataSource(const unsigned char * mem, size_t size)
 {
-    MMLOGI("mem: %p, size: %d\n", mem, size);
-    fleave_invalid(MM_ERROR_UNSUPPORTED);
+    MMLOGI("mem: %p, size: %zu\n", mem, size);
+    call_cowplayer(setDataSource(mem, size));
 }
 
 mm_status_t CowPlayerWrapper::setSubtitleSource(const char* uri)
@@ -308,4 +308,9 @@ mm_status_t ProxyPlayerWrapper::captureVideo()
     call_Proxyplayer(captureVideo());
 }
 
+mm_status_t ProxyPlayerWrapper::pushData(MediaBufferSP & buffer)
+{
+    call_Proxyplayer(pushData(buffer));
+}
+
 }
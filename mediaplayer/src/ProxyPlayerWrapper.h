@@ -64,6 +64,7 @@ public:
     virtual mm_status_t enableExternalSubtitleSupport(bool enable);
 
     virtual mm_status_t captureVideo();
+    virtual mm_status_t pushData(MediaBufferSP & buffer);
 
 private:
     bool mPlayType;
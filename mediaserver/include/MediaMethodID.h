@@ -68,6 +68,7 @@ enum MediaMethodID {
     MM_METHOD_INVOKE,        //30
     MM_METHOD_CAPTURE_VIDEO, //31
     MM_METHOD_RELEASE,       //32
+    MM_METHOD_PUSH_DATA_CHANNEL, //33
 
     // recorder
     MM_METHOD_SET_CAMERA = 100,    //100
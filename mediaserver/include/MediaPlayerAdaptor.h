@@ -49,6 +49,7 @@ namespace YUNOS_MM {
 using namespace yunos;
 
 class SideBandIPC;
+class SharedBufferRing;
 
 class MediaPlayerAdaptor : public DAdaptor,
                            public MMSession {
@@ -99,8 +100,13 @@ private:
         MediaPlayerAdaptor *mOwner;
     };
 
+    // feeds the buffers of the client push data ring to pushData()
+    class PushDataThread;
+
     void notify(int msg, int param1, int param2, const MMParamSP meta);
     void fillBackGround();
+    mm_status_t startPushData();
+    void stopPushData();
 
     static const char * MM_LOG_TAG;
     String mCallbackName;
@@ -120,6 +126,17 @@ private:
     MMSharedPtr<SideBandIPC> mSideBand2;
     MMNativeBuffer* mCurBuffer;
 
+    // client push data ring, see SharedBufferRing
+    MMSharedPtr<SideBandIPC> mPushSideBand;
+    MMSharedPtr<PushDataThread> mPushThread;
+
+    // session pool, see MediaSessionPool
+    int mPlayType;
+    bool mWarmStart;
+    bool mPlayerReusable;
+    int64_t mSetDataSourceUs;
+    int64_t mPrepareCostUs;
+
     SharedPtr<LooperThread> mLooper;
 
     static void postNotify1(MediaPlayerAdaptor* p, int msg, int param1, int param2, MMParamSP param);
@@ -92,6 +92,12 @@ public:
     mm_status_t captureVideo();
     mm_status_t enableExternalSubtitleSupport(bool enable);
 
+    // buffers go to the service through a shared memory ring set up by the first call,
+    // no DBus call per buffer. returns MM_ERROR_AGAIN if the service doesn't drain the ring
+    mm_status_t pushData(MediaBufferSP & buffer);
+    // buffer in the ring for pushData() without copy: write the data, set the size and push it
+    mm_status_t dequeuePushBuffer(MediaBufferSP & buffer);
+
     mm_status_t release();
 
 friend class MediaClientHelper;
@@ -107,6 +113,8 @@ private:
     bool getShowFlag();
     int setMstListener(YunOSMediaCodec::SurfaceTextureListener *listener);
 
+    mm_status_t setupPushDataRing_l();
+
 #ifdef SINGLE_THREAD_PROXY
     int64_t sendMethodCommand(MMParam &param);
     static void sendMethodCommand1(MediaPlayerClient* p, MMParam &param, uint32_t seq);
@@ -144,6 +152,9 @@ private:
     uint32_t mCallSeq;
     std::map<uint32_t, int64_t> mCallSeqMap;
 
+    Lock mPushLock;
+    SharedBufferRingSP mPushRing;
+
 #ifdef __USING_VR_VIDEO__
     MMSharedPtr<yunos::yvr::VrVideoView> mVrView;
 #endif
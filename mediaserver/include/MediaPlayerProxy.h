@@ -21,6 +21,7 @@
 #include <dbus/DProxy.h>
 
 #include <multimedia/mm_cpp_utils.h>
+#include <SharedBufferRing.h>
 
 #include <map>
 #include <string>
@@ -73,6 +74,8 @@ public:
     mm_status_t invoke(const MMParam * request, MMParam * reply);
     mm_status_t captureVideo();
     mm_status_t enableExternalSubtitleSupport(bool enable);
+    // hand the fds of ring to the service, which feeds its buffers to pushData()
+    mm_status_t setPushDataChannel(SharedBufferRing *ring);
 
     /* MediaSurfaceTexture consumer proxy */
     void returnAcquiredBuffers();
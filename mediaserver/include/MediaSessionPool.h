@@ -0,0 +1,132 @@
+/**
+ * Copyright (C) 2017 Alibaba Group Holding Limited. All Rights Reserved.
+ *
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string/String.h>
+
+#include <list>
+#include <map>
+
+#include <multimedia/mm_cpp_utils.h>
+#include <multimedia/component.h>
+
+#ifndef __media_session_pool_h
+#define __media_session_pool_h
+
+namespace YUNOS_MM {
+
+using namespace yunos;
+
+class CowPlayer;
+class CowRecorder;
+
+/*
+ * warm CowPlayer/CowRecorder objects for new sessions of the media service.
+ * - a pooled object has its msg thread running and its default pipeline created,
+ *   a player returned by a finished session is reset and recycled
+ * - recorders keep their configuration across reset(), so a used recorder is destroyed,
+ *   the pool is refilled from the service looper instead
+ * - a few components are kept alive so the plugin libs stay loaded and plugins xml is parsed
+ * - idle objects are trimmed after mm.ms.pool.idle.sec, all of them under memory pressure
+ */
+class MediaSessionPool {
+
+public:
+    // warm is set to true if the player/recorder comes from the pool
+    static CowPlayer* acquirePlayer(int playType, bool *warm = NULL);
+    // player is reset; reusable false means the player has state reset() doesn't clear
+    static void releasePlayer(CowPlayer *player, int playType, bool reusable = true);
+
+    static CowRecorder* acquireRecorder(bool *warm = NULL);
+    static void releaseRecorder(CowRecorder *recorder);
+
+    // fill the pools up to the configured size, run from the service looper
+    static void warmUp();
+    static void refill();
+
+    // release objects idle for too long, or everything if memory is low
+    static void trimIdle();
+    static void trim(bool all);
+
+    // time from setDataSource to MSG_PREPARED
+    static void recordPrepareTime(int64_t costUs, bool warm);
+
+    static void dump(String &info);
+
+    // interval of trimIdle() in ms, 0 if idle trimming is disabled
+    static int32_t trimIntervalMs();
+
+private:
+    struct PlayerItem {
+        CowPlayer *mPlayer;
+        int64_t mIdleSinceUs;
+    };
+
+    struct RecorderItem {
+        CowRecorder *mRecorder;
+        int64_t mIdleSinceUs;
+    };
+
+    struct PrepareStat {
+        PrepareStat() : mCount(0), mTotalUs(0), mMinUs(-1), mMaxUs(0), mLastUs(-1) {}
+        void add(int64_t costUs);
+        uint32_t mCount;
+        int64_t mTotalUs;
+        int64_t mMinUs;
+        int64_t mMaxUs;
+        int64_t mLastUs;
+    };
+
+    typedef std::list<PlayerItem> PlayerList;
+    typedef std::map<int, PlayerList> PlayerPoolMap;
+    typedef std::list<RecorderItem> RecorderList;
+
+    static void loadConfig_l();
+    static CowPlayer* createPlayer(int playType);
+    static CowRecorder* createRecorder();
+    static void loadResidentComponents_l();
+    static bool isMemoryLow();
+
+    static Lock sLock;
+    static bool sConfigLoaded;
+    static int32_t sMaxPlayers;
+    static int32_t sMaxRecorders;
+    static int32_t sIdleSec;
+    static int32_t sLowMemKb;
+    static bool sKeepComponents;
+
+    static PlayerPoolMap sPlayers;
+    static std::list<int> sPlayTypes;   // play types to refill, most recent first
+    static RecorderList sRecorders;
+    static bool sRecorderUsed;
+    static std::list<ComponentSP> sResidentComponents;
+
+    static uint32_t sHits;
+    static uint32_t sMisses;
+    static uint32_t sTrimmed;
+    static PrepareStat sWarmPrepare;
+    static PrepareStat sColdPrepare;
+
+    static const char * MM_LOG_TAG;
+
+    MediaSessionPool();
+    ~MediaSessionPool();
+    MediaSessionPool(const MediaSessionPool &);
+    MediaSessionPool & operator=(const MediaSessionPool &);
+};
+
+} // end of YUNOS_MM
+#endif
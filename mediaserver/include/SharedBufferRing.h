@@ -0,0 +1,121 @@
+/**
+ * Copyright (C) 2017 Alibaba Group Holding Limited. All Rights Reserved.
+ *
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <multimedia/mm_errors.h>
+#include <multimedia/mm_cpp_utils.h>
+#include <multimedia/mm_ashmem.h>
+#include <multimedia/media_buffer.h>
+
+#include <vector>
+
+#ifndef __shared_buffer_ring_h
+#define __shared_buffer_ring_h
+
+namespace YUNOS_MM {
+
+class SharedBufferRing;
+typedef MMSharedPtr<SharedBufferRing> SharedBufferRingSP;
+
+/*
+ * single producer/single consumer ring of fixed size slots in memfd shared memory,
+ * for media buffers between MediaPlayerClient and the media service.
+ * - the memfd and two eventfd doorbells (data available, space available) are passed once
+ *   over SideBandIPC, after that a buffer costs no DBus call and no serialization
+ * - a doorbell is only rung when the peer is waiting on it
+ * - the producer writes in place into the slot of dequeueBuffer(), or writeBuffer() copies once
+ * - the consumer gets MediaBuffers pointing into the slots, a slot is handed back to the
+ *   producer when its MediaBuffer is destroyed; out of order release is allowed
+ */
+class SharedBufferRing : public EnableSharedFromThis<SharedBufferRing> {
+
+public:
+    enum Role {
+        kProducer,
+        kConsumer,
+    };
+
+    static SharedBufferRingSP create(Role role, uint32_t slotCount, uint32_t slotSize);
+    // fds of the peer (see memFd/dataFd/spaceFd), owned by the ring, closed on failure
+    static SharedBufferRingSP import(Role role, int memFd, int dataFd, int spaceFd);
+
+    ~SharedBufferRing();
+
+    int memFd() const;
+    int dataFd() const { return mDataFd; }
+    int spaceFd() const { return mSpaceFd; }
+    const MMAshMemSP & memory() const { return mMem; }
+
+    uint32_t slotCount() const { return mSlotCount; }
+    uint32_t slotSize() const { return mSlotSize; }
+
+    /* producer, timeoutMs < 0 waits forever
+     * returns MM_ERROR_AGAIN on timeout, MM_ERROR_EOS once the ring is closed
+     */
+    // buffer pointing into the next free slot, stays reserved until it is written
+    mm_status_t dequeueBuffer(MediaBufferSP &buffer, int32_t timeoutMs);
+    // data, size, timestamps, flags and mime of the meta are published to the consumer;
+    // data outside of the reserved slot is copied into it
+    mm_status_t writeBuffer(const MediaBufferSP &buffer, int32_t timeoutMs);
+
+    /* consumer */
+    mm_status_t readBuffer(MediaBufferSP &buffer, int32_t timeoutMs);
+
+    // both sides: wake up and fail the peer, used on reset/release
+    void close();
+    bool isClosed() const;
+
+    // slots in use, for debug
+    uint32_t pending() const;
+
+private:
+    struct Header;
+    struct SlotDesc;
+
+    SharedBufferRing(Role role);
+    bool init(uint32_t slotCount, uint32_t slotSize, bool create);
+
+    uint8_t *slotData(uint32_t index) const;
+    SlotDesc *slotDesc(uint32_t index) const;
+    mm_status_t waitFor(bool space, int32_t timeoutMs);
+    void ring(int fd);
+    void releaseSlot(uint32_t index);
+    static bool releaseMediaBuffer(MediaBuffer *buffer);
+
+    Role mRole;
+    MMAshMemSP mMem;
+    Header *mHeader;
+    uint32_t mSlotCount;
+    uint32_t mSlotSize;
+    uint32_t mDataOffset;
+    int mDataFd;
+    int mSpaceFd;
+
+    // producer
+    bool mReserved;
+    // consumer, slots read but not released yet
+    Lock mLock;
+    uint32_t mReadIndex;
+    std::vector<bool> mReleased;
+
+    static const char * MM_LOG_TAG;
+
+    SharedBufferRing(const SharedBufferRing &);
+    SharedBufferRing & operator=(const SharedBufferRing &);
+};
+
+} // end of YUNOS_MM
+#endif
@@ -18,6 +18,7 @@
 #include <multimedia/mm_errors.h>
 #include <multimedia/mmmsgthread.h>
 #include <multimedia/mm_cpp_utils.h>
+#include <multimedia/mm_ashmem.h>
 #include <string>
 
 #ifndef __ipc_socket_fd_h
@@ -36,6 +37,11 @@ public:
 
     int recvFd();
 
+    // share memfd backed MMAshMem (see MMAshMem::createMemFd) with the peer, fd and size
+    // are sent in one message; use either fd or ashmem messages on one channel
+    mm_status_t sendAshMem(const MMAshMemSP &mem);
+    MMAshMemSP recvAshMem(bool readonly = false);
+
     bool init();
     bool initAsync();
 
@@ -53,6 +59,9 @@ private:
     /* client */
     bool connectSideBandChannel();
 
+    mm_status_t sendFdMsg(int fd, const void *data, size_t size);
+    int recvFdMsg(void *data, size_t size);
+
 private:
     std::string mName;
 
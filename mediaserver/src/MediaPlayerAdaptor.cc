@@ -26,11 +26,14 @@
 #include <pointer/SharedPtr.h>
 
 #include <MediaPlayerAdaptor.h>
+#include <MediaSessionPool.h>
 #include <SideBandIPC.h>
+#include <SharedBufferRing.h>
 
 #include <multimedia/mm_debug.h>
 #include <multimedia/mmparam.h>
 #include <multimedia/mediaplayer.h>
+#include <multimedia/mmthread.h>
 #include <media_surface_texture.h>
 
 // support local window
@@ -55,6 +58,55 @@ using namespace yunos;
 
 DEFINE_LOGTAG(MediaPlayerAdaptor)
 
+#define PUSH_DATA_WAIT_MS 200
+
+class MediaPlayerAdaptor::PushDataThread : public MMThread {
+public:
+    PushDataThread(CowPlayer *player, const SharedBufferRingSP &ring)
+        : MMThread("PushData"),
+          mPlayer(player),
+          mRing(ring),
+          mContinue(true),
+          mCount(0) {
+    }
+
+    virtual ~PushDataThread() {
+        stop();
+    }
+
+    void stop() {
+        mContinue = false;
+        mRing->close();
+        destroy();
+    }
+
+protected:
+    // buffers point into the ring, a slot is returned to the client when the pipeline drops it
+    virtual void main() {
+        INFO("push data thread start");
+        while (mContinue) {
+            MediaBufferSP buffer;
+            mm_status_t status = mRing->readBuffer(buffer, PUSH_DATA_WAIT_MS);
+            if (status == MM_ERROR_AGAIN)
+                continue;
+            if (status != MM_ERROR_SUCCESS)
+                break;
+
+            mCount++;
+            status = mPlayer->pushData(buffer);
+            if (status != MM_ERROR_SUCCESS)
+                WARNING("pushData return %d", status);
+        }
+        INFO("push data thread exit, %u buffers", mCount);
+    }
+
+private:
+    CowPlayer *mPlayer;
+    SharedBufferRingSP mRing;
+    volatile bool mContinue;
+    uint32_t mCount;
+};
+
 MediaPlayerAdaptor::MediaPlayerAdaptor(const SharedPtr<DService>& service,
                    const String& path,
                    const String& iface,
@@ -67,7 +119,12 @@ MediaPlayerAdaptor::MediaPlayerAdaptor(const SharedPtr<DService>& service,
       mMst(NULL),
       mMstShow(false),
       mUid(uid),
-      mCurBuffer(NULL) {
+      mCurBuffer(NULL),
+      mPlayType(playType),
+      mWarmStart(false),
+      mPlayerReusable(true),
+      mSetDataSourceUs(-1),
+      mPrepareCostUs(-1) {
     ENTER1();
 
     mType = MU_Player;
@@ -77,7 +134,7 @@ MediaPlayerAdaptor::MediaPlayerAdaptor(const SharedPtr<DService>& service,
     mMstListener.reset(new MstListener(this));
     mUseMstListener = false;
 
-    mPlayer = new CowPlayer(playType);
+    mPlayer = MediaSessionPool::acquirePlayer(playType, &mWarmStart);
     if ( !mPlayer ) {
         ERROR("failed to create player\n");
         EXIT1();
@@ -102,9 +159,11 @@ MediaPlayerAdaptor::MediaPlayerAdaptor(const SharedPtr<DService>& service,
 MediaPlayerAdaptor::~MediaPlayerAdaptor() {
     ENTER1();
 
+    stopPushData();
+
     if (mPlayer != NULL)
         //MediaPlayer::destroy(mPlayer);
-        delete mPlayer;
+        MediaSessionPool::releasePlayer(mPlayer, mPlayType, mPlayerReusable);
 
     if (mMst)
         delete mMst;
@@ -130,6 +189,11 @@ void MediaPlayerAdaptor::notify(int msg, int param1, int param2, const MMParamSP
         case Component::kEventPrepareResult:
             msg = MediaPlayer::Listener::MSG_PREPARED;
             NOTIFY_STATUS(PREPARED);
+            if (!param1 && mSetDataSourceUs > 0) {
+                mPrepareCostUs = getTimeUs() - mSetDataSourceUs;
+                mSetDataSourceUs = -1;
+                MediaSessionPool::recordPrepareTime(mPrepareCostUs, mWarmStart);
+            }
             break;
         case Component::kEventEOS:
             msg = MediaPlayer::Listener::MSG_PLAYBACK_COMPLETE;
@@ -273,6 +337,8 @@ bool MediaPlayerAdaptor::handleMethodCall(const SharedPtr<DMessage>& msg) {
         uri = msg->readString();
         count = msg->readInt32();
         mUri = uri;
+        mSetDataSourceUs = getTimeUs();
+        mPrepareCostUs = -1;
 
         if (count <= 0 || count > maxCnt) {
             status = mPlayer->setDataSource(uri.c_str(), &headers);
@@ -296,6 +362,8 @@ bool MediaPlayerAdaptor::handleMethodCall(const SharedPtr<DMessage>& msg) {
         offset = msg->readInt64();
         length = msg->readInt64();
 
+        mSetDataSourceUs = getTimeUs();
+        mPrepareCostUs = -1;
         status= mPlayer->setDataSource(fd, offset, length);
 
         mUri = "";
@@ -309,6 +377,8 @@ bool MediaPlayerAdaptor::handleMethodCall(const SharedPtr<DMessage>& msg) {
             FINISH_METHOD_CALL(true);
         } else {
             status = mPlayer->setSubtitleSource(uri.c_str());
+            // reset() keeps the subtitle uri, don't hand the player to another session
+            mPlayerReusable = false;
         }
 
         FINISH_METHOD_CALL(true);
@@ -335,6 +405,24 @@ bool MediaPlayerAdaptor::handleMethodCall(const SharedPtr<DMessage>& msg) {
 
         sendMessage(reply);
         return true;
+    } else if (msg->methodName() == "pushDataChannel") {
+        stopPushData();
+        reply->writeInt32(MM_ERROR_SUCCESS);
+        String str("/mnt/data/share/media/.");
+        str.append(interface());
+        str.append(".pushdata");
+        INFO("push data channel: %s", str.c_str());
+        reply->writeString(str);
+        mPushSideBand.reset(new SideBandIPC(str.c_str(), true));
+        if (!mPushSideBand->initAsync()) {
+            ERROR("fail to init side band ipc");
+        }
+
+        sendMessage(reply);
+        return true;
+    } else if (msg->methodName() == "startPushData") {
+        status = startPushData();
+        FINISH_METHOD_CALL(true);
     } else if (msg->methodName() == "setVideoDisplay") {
         String name = msg->readString();
         if (!strcmp(name.c_str(), "bad-name")) {
@@ -698,7 +786,7 @@ bool MediaPlayerAdaptor::handleMethodCall(const SharedPtr<DMessage>& msg) {
         sendMessage(reply);
 
         if (mPlayer && mUid == uid) {
-            delete mPlayer;
+            MediaSessionPool::releasePlayer(mPlayer, mPlayType, mPlayerReusable);
             mPlayer = NULL;
         }
 
@@ -766,6 +854,10 @@ const char* MediaPlayerAdaptor::debugInfoMsg() {
     mDebugInfoMsg.append(ProcStat::getCmdLine(mPid));
     mDebugInfoMsg.appendFormat("\n\n");
     mDebugInfoMsg.appendFormat("    uri: %s\n\n", mUri.c_str());
+    mDebugInfoMsg.appendFormat("    player: %s", mWarmStart ? "warm" : "cold");
+    if (mPrepareCostUs >= 0)
+        mDebugInfoMsg.appendFormat(", setDataSource to prepared %.1fms", mPrepareCostUs / 1000.0f);
+    mDebugInfoMsg.append("\n\n");
 
     if (getSessionState() < PREPARED || getSessionState() > STOPPED)
         return mDebugInfoMsg.c_str();
@@ -839,6 +931,39 @@ void MediaPlayerAdaptor::postNotify(int msg, int param1, int param2, MMParamSP p
     sendMessage(signal);
 }
 
+// the client connected to mPushSideBand and sent memfd, data doorbell and space doorbell
+mm_status_t MediaPlayerAdaptor::startPushData() {
+    if (!mPushSideBand) {
+        ERROR("push data channel is not setup");
+        return MM_ERROR_IVALID_OPERATION;
+    }
+
+    int memFd = mPushSideBand->recvFd();
+    int dataFd = mPushSideBand->recvFd();
+    int spaceFd = mPushSideBand->recvFd();
+    mPushSideBand.reset();
+
+    SharedBufferRingSP ring =
+        SharedBufferRing::import(SharedBufferRing::kConsumer, memFd, dataFd, spaceFd);
+    if (!ring) {
+        ERROR("fail to import push data ring");
+        return MM_ERROR_OP_FAILED;
+    }
+
+    mPushThread.reset(new PushDataThread(mPlayer, ring));
+    if (mPushThread->create()) {
+        mPushThread.reset();
+        return MM_ERROR_NO_MEM;
+    }
+
+    return MM_ERROR_SUCCESS;
+}
+
+void MediaPlayerAdaptor::stopPushData() {
+    mPushSideBand.reset();
+    mPushThread.reset();
+}
+
 void MediaPlayerAdaptor::fillBackGround() {
 
     if (!mm_check_env_str("mm.ms.enable.fill", NULL, "1", true))
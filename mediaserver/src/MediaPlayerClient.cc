@@ -22,6 +22,8 @@
 #include <media_surface_texture.h>
 #include <native_surface_help.h>
 
+#include <stdlib.h>
+
 #include <dbus/DProxy.h>
 #include <dbus/DAdaptor.h>
 
@@ -639,10 +641,77 @@ mm_status_t MediaPlayerClient::enableExternalSubtitleSupport(bool enable)
 #endif
 }
 
+#define PUSH_DATA_SLOTS             16
+#define PUSH_DATA_SLOT_KB           512
+#define PUSH_DATA_TIMEOUT_MS        1000
+
+/* ring fds are passed once, buffers are written on the caller thread */
+mm_status_t MediaPlayerClient::setupPushDataRing_l() {
+    if (mPushRing && !mPushRing->isClosed())
+        return MM_ERROR_SUCCESS;
+    mPushRing.reset();
+
+    std::string str = mm_get_env_str("mm.pushdata.slots", "MM_PUSHDATA_SLOTS");
+    uint32_t slots = str.empty() ? PUSH_DATA_SLOTS : atoi(str.c_str());
+    str = mm_get_env_str("mm.pushdata.slot.kb", "MM_PUSHDATA_SLOT_KB");
+    uint32_t slotKb = str.empty() ? PUSH_DATA_SLOT_KB : atoi(str.c_str());
+
+    SharedBufferRingSP ring = SharedBufferRing::create(SharedBufferRing::kProducer, slots, slotKb * 1024);
+    if (!ring)
+        return MM_ERROR_NO_MEM;
+
+    mm_status_t status;
+#ifdef SINGLE_THREAD_PROXY
+    INIT_MEDIA_METHOD(MM_METHOD_PUSH_DATA_CHANNEL);
+    param.writeRawPointer((uint8_t*)ring.get());
+    status = (mm_status_t)sendMethodCommand(param);
+#else
+    status = getProxy()->setPushDataChannel(ring.get());
+#endif
+    if (status != MM_ERROR_SUCCESS) {
+        ERROR("fail to setup push data ring, %d", status);
+        return status;
+    }
+
+    INFO("push data ring %u x %u KB", slots, slotKb);
+    mPushRing = ring;
+    return MM_ERROR_SUCCESS;
+}
+
+mm_status_t MediaPlayerClient::pushData(MediaBufferSP & buffer) {
+    ENTER();
+    CHECK_PLAYER();
+
+    MMAutoLock lock(mPushLock);
+    mm_status_t status = setupPushDataRing_l();
+    if (status != MM_ERROR_SUCCESS)
+        return status;
+
+    return mPushRing->writeBuffer(buffer, PUSH_DATA_TIMEOUT_MS);
+}
+
+mm_status_t MediaPlayerClient::dequeuePushBuffer(MediaBufferSP & buffer) {
+    ENTER();
+    CHECK_PLAYER();
+
+    MMAutoLock lock(mPushLock);
+    mm_status_t status = setupPushDataRing_l();
+    if (status != MM_ERROR_SUCCESS)
+        return status;
+
+    return mPushRing->dequeueBuffer(buffer, PUSH_DATA_TIMEOUT_MS);
+}
+
 mm_status_t MediaPlayerClient::release() {
     ENTER();
     CHECK_PLAYER();
 
+    {
+        // wakes up the feeding thread of the service
+        MMAutoLock lock(mPushLock);
+        mPushRing.reset();
+    }
+
 #ifdef SINGLE_THREAD_PROXY
     INIT_MEDIA_METHOD(MM_METHOD_RELEASE);
     return (mm_status_t)sendMethodCommand(param);
@@ -20,6 +20,7 @@
 #include <multimedia/mmparam.h>
 
 #include <MediaPlayerProxy.h>
+#include <SideBandIPC.h>
 #include <native_surface_help.h>
 #include <media_surface_texture.h>
 
@@ -291,6 +292,30 @@ mm_status_t MediaPlayerProxy::enableExternalSubtitleSupport(bool enable) {
     return makeCallSetBool("enableExternalSubtitleSupport", enable);
 }
 
+mm_status_t MediaPlayerProxy::setPushDataChannel(SharedBufferRing *ring) {
+    if (!ring)
+        return MM_ERROR_INVALID_PARAM;
+
+    String socketName;
+    mm_status_t status = makeCallGetString("pushDataChannel", socketName);
+    if (status != MM_ERROR_SUCCESS) {
+        ERROR("fail to setup 'push data channel', return %d", status);
+        return status;
+    }
+
+    // memfd, data doorbell and space doorbell, in this order
+    SideBandIPC p(socketName.c_str(), false);
+    if (!p.init() ||
+        p.sendFd(ring->memFd()) != MM_ERROR_SUCCESS ||
+        p.sendFd(ring->dataFd()) != MM_ERROR_SUCCESS ||
+        p.sendFd(ring->spaceFd()) != MM_ERROR_SUCCESS) {
+        ERROR("fail to send ring fds");
+        return MM_ERROR_OP_FAILED;
+    }
+
+    return makeCallVoid("startPushData");
+}
+
 void MediaPlayerProxy::returnAcquiredBuffers() {
     makeCallVoid("returnAcquiredBuffers");
 }
@@ -456,6 +481,9 @@ int64_t MediaPlayerProxy::handleMethod(MMParam &param) {
         return (int64_t)enableExternalSubtitleSupport(enable);
     } else if (method == MM_METHOD_RELEASE) {
         return (int64_t)release();
+    } else if (method == MM_METHOD_PUSH_DATA_CHANNEL) {
+        SharedBufferRing *ring = (SharedBufferRing*)param.readRawPointer();
+        return (int64_t)setPushDataChannel(ring);
     } else if (method == MM_METHOD_RETURN_ACQUIRED_BUFFERS) {
         returnAcquiredBuffers();
         return (int64_t)0;
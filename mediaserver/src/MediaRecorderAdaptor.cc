@@ -27,6 +27,7 @@
 #include <pointer/SharedPtr.h>
 
 #include <MediaRecorderAdaptor.h>
+#include <MediaSessionPool.h>
 
 #include <multimedia/mm_debug.h>
 #include <multimedia/mmparam.h>
@@ -65,7 +66,7 @@ MediaRecorderAdaptor::MediaRecorderAdaptor(const SharedPtr<DService>& service,
     //mRecorder = MediaRecorder::create(MediaRecorder::RecorderType_COW);
     mListener.reset(new Listener(this));
 
-    mRecorder = new CowRecorder(RecorderType_COWAudio);
+    mRecorder = MediaSessionPool::acquireRecorder();
     if ( !mRecorder ) {
         ERROR("failed to create recorder\n");
         return;
@@ -93,7 +94,7 @@ MediaRecorderAdaptor::~MediaRecorderAdaptor() {
     }
     if (mRecorder != NULL)
         //MediaRecorder::destroy(mRecorder);
-        delete mRecorder;
+        MediaSessionPool::releaseRecorder(mRecorder);
 }
 
 void MediaRecorderAdaptor::notify(int msg, int param1, int param2, const MMParamSP param) {
@@ -430,7 +431,7 @@ bool MediaRecorderAdaptor::handleMethodCall(const SharedPtr<DMessage>& msg) {
     } else if (msg->methodName() == "tearDown") {
         if (mUid == uid) {
             if (mRecorder) {
-                delete mRecorder;
+                MediaSessionPool::releaseRecorder(mRecorder);
                 mRecorder = NULL;
             }
 
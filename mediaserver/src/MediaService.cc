@@ -20,6 +20,7 @@
 #include "MediaPlayerInstance.h"
 #include "MediaRecorderInstance.h"
 #include "MMSession.h"
+#include "MediaSessionPool.h"
 
 #include <multimedia/mm_debug.h>
 #include <multimedia/mm_cpp_utils.h>
@@ -137,6 +138,14 @@ private:
 MediaServiceAdaptor *gMediaService = NULL;
 Looper *gLooper;
 
+static void trimSessionPool() {
+    MediaSessionPool::trimIdle();
+
+    int32_t intervalMs = MediaSessionPool::trimIntervalMs();
+    if (gLooper && intervalMs > 0)
+        gLooper->sendDelayedTask(Task(trimSessionPool), intervalMs);
+}
+
 void MediaService::main() {
     Looper looper;
     SharedPtr<DServiceManager> instance = DServiceManager::getInstance();
@@ -149,11 +158,18 @@ void MediaService::main() {
 
 
     gLooper = &looper;
+    // pre-create players/recorders after the service is published
+    looper.sendTask(Task(MediaSessionPool::warmUp));
+    int32_t intervalMs = MediaSessionPool::trimIntervalMs();
+    if (intervalMs > 0)
+        looper.sendDelayedTask(Task(trimSessionPool), intervalMs);
+
     looper.run();
     INFO("end looper");
 
     gMediaService = NULL;
     gLooper = NULL;
+    MediaSessionPool::trim(true);
     instance->unregisterService(service);
 }
 
@@ -281,6 +297,10 @@ bool MediaServiceAdaptor::createMediaInstance(
 
     bool ret = instance->init();
 
+    // the session may have taken a pooled player/recorder
+    if (gLooper && (type == MMSession::MU_Player || type == MMSession::MU_Recorder))
+        gLooper->sendTask(Task(MediaSessionPool::refill));
+
     {
         MMAutoLock lock(MMSession::sStatusLock);
         mSessions[serviceName] = instance->getSession();
@@ -471,6 +491,11 @@ bool MediaServiceAdaptor::handleMethodCall(const SharedPtr<DMessage>& msg) {
         dumpService(sysInfo);
         INFO("%s", sysInfo.c_str());
         return true;
+    } else if (msg->methodName() == "trimMemory") {
+        MediaSessionPool::trim(true);
+        SharedPtr<DMessage> reply = DMessage::makeMethodReturn(msg);
+        sendMessage(reply);
+        return true;
     } else if (msg->methodName() == "dumpsys") {
         SharedPtr<DMessage> reply = DMessage::makeMethodReturn(msg);
         String sysInfo;
@@ -503,6 +528,8 @@ void MediaServiceAdaptor::dumpService(String &sysInfo) {
         sessionInfo = session->second->debugInfoMsg();
         sysInfo.append(sessionInfo);
     }
+
+    MediaSessionPool::dump(sysInfo);
 }
 
 static void rmMediaInstance(String mediaName, MMSession::MediaUsage type, uid_t uid) {
@@ -0,0 +1,439 @@
+/**
+ * Copyright (C) 2017 Alibaba Group Holding Limited. All Rights Reserved.
+ *
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "MediaSessionPool.h"
+
+#include <multimedia/mm_debug.h>
+#include <multimedia/media_attr_str.h>
+#include <multimedia/component_factory.h>
+#include <multimedia/cowplayer.h>
+#include <multimedia/cowrecorder.h>
+
+namespace YUNOS_MM {
+
+// libbase name space
+using namespace yunos;
+
+#define POOL_MAX_PLAYERS_DEFAULT        1
+#define POOL_MAX_RECORDERS_DEFAULT      1
+#define POOL_IDLE_SEC_DEFAULT           300
+#define POOL_LOW_MEM_KB_DEFAULT         (64 * 1024)
+#define POOL_TRIM_INTERVAL_MIN_MS       5000
+#define POOL_TRIM_INTERVAL_MAX_MS       60000
+
+DEFINE_LOGTAG(MediaSessionPool)
+
+Lock MediaSessionPool::sLock;
+bool MediaSessionPool::sConfigLoaded = false;
+int32_t MediaSessionPool::sMaxPlayers = POOL_MAX_PLAYERS_DEFAULT;
+int32_t MediaSessionPool::sMaxRecorders = POOL_MAX_RECORDERS_DEFAULT;
+int32_t MediaSessionPool::sIdleSec = POOL_IDLE_SEC_DEFAULT;
+int32_t MediaSessionPool::sLowMemKb = POOL_LOW_MEM_KB_DEFAULT;
+bool MediaSessionPool::sKeepComponents = true;
+
+MediaSessionPool::PlayerPoolMap MediaSessionPool::sPlayers;
+std::list<int> MediaSessionPool::sPlayTypes;
+MediaSessionPool::RecorderList MediaSessionPool::sRecorders;
+bool MediaSessionPool::sRecorderUsed = false;
+std::list<ComponentSP> MediaSessionPool::sResidentComponents;
+
+uint32_t MediaSessionPool::sHits = 0;
+uint32_t MediaSessionPool::sMisses = 0;
+uint32_t MediaSessionPool::sTrimmed = 0;
+MediaSessionPool::PrepareStat MediaSessionPool::sWarmPrepare;
+MediaSessionPool::PrepareStat MediaSessionPool::sColdPrepare;
+
+static int32_t getEnvInt(const char *property, const char *env, int32_t defaultValue) {
+    std::string str = mm_get_env_str(property, env);
+    if (str.empty())
+        return defaultValue;
+    return atoi(str.c_str());
+}
+
+void MediaSessionPool::PrepareStat::add(int64_t costUs) {
+    mCount++;
+    mTotalUs += costUs;
+    if (mMinUs < 0 || costUs < mMinUs)
+        mMinUs = costUs;
+    if (costUs > mMaxUs)
+        mMaxUs = costUs;
+    mLastUs = costUs;
+}
+
+/*static*/ void MediaSessionPool::loadConfig_l() {
+    if (sConfigLoaded)
+        return;
+
+    sMaxPlayers = getEnvInt("mm.ms.pool.players", "MM_MS_POOL_PLAYERS", POOL_MAX_PLAYERS_DEFAULT);
+    sMaxRecorders = getEnvInt("mm.ms.pool.recorders", "MM_MS_POOL_RECORDERS", POOL_MAX_RECORDERS_DEFAULT);
+    sIdleSec = getEnvInt("mm.ms.pool.idle.sec", "MM_MS_POOL_IDLE_SEC", POOL_IDLE_SEC_DEFAULT);
+    sLowMemKb = getEnvInt("mm.ms.pool.lowmem.kb", "MM_MS_POOL_LOWMEM_KB", POOL_LOW_MEM_KB_DEFAULT);
+    sKeepComponents = mm_check_env_str("mm.ms.pool.components", "MM_MS_POOL_COMPONENTS", "1", true);
+
+    if (sMaxPlayers < 0)
+        sMaxPlayers = 0;
+    if (sMaxRecorders < 0)
+        sMaxRecorders = 0;
+
+    sConfigLoaded = true;
+    INFO("players %d, recorders %d, idle %ds, low memory %dKB, keep components %d",
+         sMaxPlayers, sMaxRecorders, sIdleSec, sLowMemKb, sKeepComponents);
+}
+
+/*static*/ CowPlayer* MediaSessionPool::createPlayer(int playType) {
+    CowPlayer *player = new CowPlayer(playType);
+    if (!player)
+        return NULL;
+
+    // creates the default pipeline, it is done lazily by the first call otherwise
+    player->isPlaying();
+    return player;
+}
+
+/*static*/ CowRecorder* MediaSessionPool::createRecorder() {
+    CowRecorder *recorder = new CowRecorder(RecorderType_COWAudio);
+    if (!recorder)
+        return NULL;
+
+    recorder->isRecording();
+    return recorder;
+}
+
+// components are created per uri at prepare time, holding one instance of the common ones
+// keeps their plugin lib loaded (ComponentFactory dlcloses a lib with its last instance)
+/*static*/ void MediaSessionPool::loadResidentComponents_l() {
+    if (!sKeepComponents || !sResidentComponents.empty())
+        return;
+
+    const char *mimes[] = {
+        MEDIA_MIMETYPE_MEDIA_DEMUXER,
+        MEDIA_MIMETYPE_AUDIO_RENDER,
+        MEDIA_MIMETYPE_VIDEO_RENDER,
+    };
+
+    for (uint32_t i = 0; i < sizeof(mimes) / sizeof(mimes[0]); i++) {
+        ComponentSP comp = ComponentFactory::create(NULL, mimes[i], false);
+        if (!comp) {
+            WARNING("fail to create resident component %s", mimes[i]);
+            continue;
+        }
+        sResidentComponents.push_back(comp);
+    }
+}
+
+/*static*/ bool MediaSessionPool::isMemoryLow() {
+    if (sLowMemKb <= 0)
+        return false;
+
+    FILE *fp = fopen("/proc/meminfo", "r");
+    if (!fp)
+        return false;
+
+    char line[128];
+    long availableKb = -1;
+    while (fgets(line, sizeof(line), fp)) {
+        if (sscanf(line, "MemAvailable: %ld kB", &availableKb) == 1)
+            break;
+    }
+    fclose(fp);
+
+    return availableKb >= 0 && availableKb < sLowMemKb;
+}
+
+/*static*/ CowPlayer* MediaSessionPool::acquirePlayer(int playType, bool *warm) {
+    {
+        MMAutoLock lock(sLock);
+        loadConfig_l();
+
+        sPlayTypes.remove(playType);
+        sPlayTypes.push_front(playType);
+
+        PlayerPoolMap::iterator it = sPlayers.find(playType);
+        if (it != sPlayers.end() && !it->second.empty()) {
+            CowPlayer *player = it->second.front().mPlayer;
+            it->second.pop_front();
+            sHits++;
+            if (warm)
+                *warm = true;
+            INFO("warm player %p, play type %d", player, playType);
+            return player;
+        }
+        sMisses++;
+    }
+
+    if (warm)
+        *warm = false;
+    return new CowPlayer(playType);
+}
+
+/*static*/ void MediaSessionPool::releasePlayer(CowPlayer *player, int playType, bool reusable) {
+    if (!player)
+        return;
+
+    // the session listener goes away with the session, stop reporting to it before reset
+    player->removeListener();
+
+    if (reusable && player->reset() == MM_ERROR_SUCCESS && !isMemoryLow()) {
+        // state reset() keeps in the pipeline
+        player->setVideoSurface(NULL);
+        player->setLoop(false);
+        player->clearDataSourceQueue();
+
+        MMAutoLock lock(sLock);
+        loadConfig_l();
+        int32_t count = 0;
+        for (PlayerPoolMap::iterator it = sPlayers.begin(); it != sPlayers.end(); it++)
+            count += it->second.size();
+
+        if (count < sMaxPlayers) {
+            PlayerItem item;
+            item.mPlayer = player;
+            item.mIdleSinceUs = getTimeUs();
+            sPlayers[playType].push_front(item);
+            INFO("player %p is back to pool, play type %d", player, playType);
+            return;
+        }
+    }
+
+    delete player;
+}
+
+/*static*/ CowRecorder* MediaSessionPool::acquireRecorder(bool *warm) {
+    {
+        MMAutoLock lock(sLock);
+        loadConfig_l();
+        sRecorderUsed = true;
+
+        if (!sRecorders.empty()) {
+            CowRecorder *recorder = sRecorders.front().mRecorder;
+            sRecorders.pop_front();
+            sHits++;
+            if (warm)
+                *warm = true;
+            INFO("warm recorder %p", recorder);
+            return recorder;
+        }
+        sMisses++;
+    }
+
+    if (warm)
+        *warm = false;
+    return new CowRecorder(RecorderType_COWAudio);
+}
+
+/*static*/ void MediaSessionPool::releaseRecorder(CowRecorder *recorder) {
+    if (!recorder)
+        return;
+
+    // recorder pipelines keep the session configuration (encoders, output format) after reset()
+    recorder->removeListener();
+    delete recorder;
+}
+
+/*static*/ void MediaSessionPool::warmUp() {
+    {
+        MMAutoLock lock(sLock);
+        loadConfig_l();
+        if (sPlayTypes.empty())
+            sPlayTypes.push_back(0);
+        // warm up the recorder pool at start, later only after a recorder session
+        sRecorderUsed = true;
+        loadResidentComponents_l();
+    }
+
+    // dlopen the hot codec libraries before the first session asks for them
+    ComponentFactory::preloadAsync();
+    refill();
+}
+
+/*static*/ void MediaSessionPool::refill() {
+    std::vector<int> playTypes;
+    int32_t recorders = 0;
+
+    {
+        MMAutoLock lock(sLock);
+        loadConfig_l();
+
+        int32_t count = 0;
+        for (PlayerPoolMap::iterator it = sPlayers.begin(); it != sPlayers.end(); it++)
+            count += it->second.size();
+
+        // the free slots go to the play type of the latest session
+        if (!sPlayTypes.empty()) {
+            for (; count < sMaxPlayers; count++)
+                playTypes.push_back(sPlayTypes.front());
+        }
+
+        if (sRecorderUsed)
+            recorders = sMaxRecorders - (int32_t)sRecorders.size();
+
+        if (!playTypes.empty() || recorders > 0)
+            loadResidentComponents_l();
+    }
+
+    if ((!playTypes.empty() || recorders > 0) && isMemoryLow()) {
+        INFO("memory is low, skip refill");
+        return;
+    }
+
+    // create outside of the lock, it spawns the msg threads of player and pipeline
+    for (uint32_t i = 0; i < playTypes.size(); i++) {
+        CowPlayer *player = createPlayer(playTypes[i]);
+        if (!player)
+            continue;
+
+        MMAutoLock lock(sLock);
+        PlayerItem item;
+        item.mPlayer = player;
+        item.mIdleSinceUs = getTimeUs();
+        sPlayers[playTypes[i]].push_back(item);
+        DEBUG("pre-created player %p, play type %d", player, playTypes[i]);
+    }
+
+    for (int32_t i = 0; i < recorders; i++) {
+        CowRecorder *recorder = createRecorder();
+        if (!recorder)
+            continue;
+
+        MMAutoLock lock(sLock);
+        RecorderItem item;
+        item.mRecorder = recorder;
+        item.mIdleSinceUs = getTimeUs();
+        sRecorders.push_back(item);
+        DEBUG("pre-created recorder %p", recorder);
+    }
+}
+
+/*static*/ void MediaSessionPool::trimIdle() {
+    bool low = isMemoryLow();
+    if (low)
+        WARNING("memory is low, trim session pool");
+    trim(low);
+}
+
+/*static*/ void MediaSessionPool::trim(bool all) {
+    std::vector<CowPlayer*> players;
+    std::vector<CowRecorder*> recorders;
+    std::list<ComponentSP> components;
+
+    {
+        MMAutoLock lock(sLock);
+        loadConfig_l();
+        int64_t nowUs = getTimeUs();
+        int64_t idleUs = sIdleSec > 0 ? sIdleSec * 1000000LL : -1;
+
+        for (PlayerPoolMap::iterator it = sPlayers.begin(); it != sPlayers.end(); it++) {
+            PlayerList::iterator item = it->second.begin();
+            while (item != it->second.end()) {
+                if (all || (idleUs > 0 && nowUs - item->mIdleSinceUs > idleUs)) {
+                    players.push_back(item->mPlayer);
+                    item = it->second.erase(item);
+                } else {
+                    item++;
+                }
+            }
+        }
+
+        RecorderList::iterator item = sRecorders.begin();
+        while (item != sRecorders.end()) {
+            if (all || (idleUs > 0 && nowUs - item->mIdleSinceUs > idleUs)) {
+                recorders.push_back(item->mRecorder);
+                item = sRecorders.erase(item);
+            } else {
+                item++;
+            }
+        }
+
+        // nothing is warm any more, unload the plugin libs as well
+        if (all) {
+            components.swap(sResidentComponents);
+            sRecorderUsed = false;
+        }
+
+        sTrimmed += players.size() + recorders.size();
+    }
+
+    if (players.empty() && recorders.empty() && components.empty())
+        return;
+
+    INFO("trim %zu players, %zu recorders, %zu components",
+         players.size(), recorders.size(), components.size());
+
+    for (uint32_t i = 0; i < players.size(); i++)
+        delete players[i];
+    for (uint32_t i = 0; i < recorders.size(); i++)
+        delete recorders[i];
+    components.clear();
+}
+
+/*static*/ int32_t MediaSessionPool::trimIntervalMs() {
+    MMAutoLock lock(sLock);
+    loadConfig_l();
+
+    if (sIdleSec <= 0)
+        return sLowMemKb > 0 ? POOL_TRIM_INTERVAL_MAX_MS : 0;
+
+    int32_t intervalMs = sIdleSec * 1000 / 2;
+    if (intervalMs < POOL_TRIM_INTERVAL_MIN_MS)
+        intervalMs = POOL_TRIM_INTERVAL_MIN_MS;
+    if (intervalMs > POOL_TRIM_INTERVAL_MAX_MS)
+        intervalMs = POOL_TRIM_INTERVAL_MAX_MS;
+    return intervalMs;
+}
+
+/*static*/ void MediaSessionPool::recordPrepareTime(int64_t costUs, bool warm) {
+    MMAutoLock lock(sLock);
+    if (warm)
+        sWarmPrepare.add(costUs);
+    else
+        sColdPrepare.add(costUs);
+}
+
+/*static*/ void MediaSessionPool::dump(String &info) {
+    MMAutoLock lock(sLock);
+    loadConfig_l();
+
+    info.append("\n************MediaService session pool************\n");
+
+    info.appendFormat("    players: max %d, idle", sMaxPlayers);
+    for (PlayerPoolMap::iterator it = sPlayers.begin(); it != sPlayers.end(); it++)
+        info.appendFormat(" %zu(type %d)", it->second.size(), it->first);
+    info.appendFormat("\n    recorders: max %d, idle %zu\n", sMaxRecorders, sRecorders.size());
+    info.appendFormat("    resident components %zu, idle timeout %ds, low memory %dKB\n",
+                      sResidentComponents.size(), sIdleSec, sLowMemKb);
+    info.appendFormat("    hit %u, miss %u, trimmed %u\n\n", sHits, sMisses, sTrimmed);
+
+    const PrepareStat *stats[] = { &sWarmPrepare, &sColdPrepare };
+    const char *names[] = { "warm", "cold" };
+    for (int i = 0; i < 2; i++) {
+        const PrepareStat *s = stats[i];
+        if (!s->mCount) {
+            info.appendFormat("    setDataSource to prepared (%s): n/a\n", names[i]);
+            continue;
+        }
+        info.appendFormat("    setDataSource to prepared (%s): count %u, avg %.1fms, min %.1fms, max %.1fms, last %.1fms\n",
+                          names[i], s->mCount, s->mTotalUs / 1000.0f / s->mCount,
+                          s->mMinUs / 1000.0f, s->mMaxUs / 1000.0f, s->mLastUs / 1000.0f);
+    }
+    info.append("\n");
+}
+
+} // end of namespace YUNOS_MM
@@ -0,0 +1,482 @@
+/**
+ * Copyright (C) 2017 Alibaba Group Holding Limited. All Rights Reserved.
+ *
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <multimedia/mm_debug.h>
+#include <multimedia/media_meta.h>
+#include <multimedia/media_attr_str.h>
+
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+
+#include <SharedBufferRing.h>
+
+namespace YUNOS_MM {
+
+DEFINE_LOGTAG(SharedBufferRing);
+
+#define RING_MAGIC          0x4d4d5242  // 'MMRB'
+#define RING_VERSION        1
+#define RING_MIN_SLOTS      2
+#define RING_MAX_SLOTS      1024
+#define RING_MAX_SLOT_SIZE  (64 * 1024 * 1024)
+#define RING_ALIGN          64
+#define RING_PAGE_SIZE      4096
+#define RING_MIME_SIZE      36
+
+#define RING_META_OWNER     "shm-ring"
+#define RING_META_SLOT      "shm-ring-slot"
+
+#define ALIGN_UP(x, a)      (((x) + (a) - 1) & ~((a) - 1))
+// slot descriptors follow the header, used in member functions only
+#define RING_DESC_OFFSET    ALIGN_UP(sizeof(Header), RING_ALIGN)
+
+// head and its waiting flag are written by the producer, tail and its flag by the consumer,
+// each pair has its own cache line
+struct SharedBufferRing::Header {
+    uint32_t mMagic;
+    uint32_t mVersion;
+    uint32_t mSlotCount;
+    uint32_t mSlotSize;
+    uint32_t mDataOffset;
+    uint32_t mClosed;
+
+    uint32_t mHead __attribute__((aligned(RING_ALIGN)));
+    uint32_t mProducerWaiting;
+
+    uint32_t mTail __attribute__((aligned(RING_ALIGN)));
+    uint32_t mConsumerWaiting;
+} __attribute__((aligned(RING_ALIGN)));
+
+struct SharedBufferRing::SlotDesc {
+    uint32_t mSize;
+    uint32_t mFlags;        // bits of MediaBuffer::MediaBufferFlagType
+    int64_t mPts;
+    int64_t mDts;
+    int64_t mDuration;
+    int32_t mType;          // MediaBuffer::MediaBufferType
+    char mMime[RING_MIME_SIZE];
+};
+
+SharedBufferRing::SharedBufferRing(Role role)
+    : mRole(role),
+      mHeader(NULL),
+      mSlotCount(0),
+      mSlotSize(0),
+      mDataOffset(0),
+      mDataFd(-1),
+      mSpaceFd(-1),
+      mReserved(false),
+      mReadIndex(0) {
+}
+
+SharedBufferRing::~SharedBufferRing() {
+    if (mHeader)
+        close();
+
+    if (mDataFd >= 0)
+        ::close(mDataFd);
+    if (mSpaceFd >= 0)
+        ::close(mSpaceFd);
+}
+
+/*static*/ SharedBufferRingSP SharedBufferRing::create(Role role, uint32_t slotCount, uint32_t slotSize) {
+    SharedBufferRingSP ring;
+
+    if (slotCount < RING_MIN_SLOTS || slotCount > RING_MAX_SLOTS ||
+        slotSize == 0 || slotSize > RING_MAX_SLOT_SIZE) {
+        ERROR("invalid ring %u x %u", slotCount, slotSize);
+        return ring;
+    }
+
+    ring.reset(new SharedBufferRing(role));
+    ring->mDataFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    ring->mSpaceFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (ring->mDataFd < 0 || ring->mSpaceFd < 0) {
+        ERROR("eventfd fail, %s", strerror(errno));
+        ring.reset();
+        return ring;
+    }
+
+    if (!ring->init(slotCount, slotSize, true))
+        ring.reset();
+
+    return ring;
+}
+
+/*static*/ SharedBufferRingSP SharedBufferRing::import(Role role, int memFd, int dataFd, int spaceFd) {
+    SharedBufferRingSP ring(new SharedBufferRing(role));
+    ring->mDataFd = dataFd;
+    ring->mSpaceFd = spaceFd;
+
+    if (memFd < 0 || dataFd < 0 || spaceFd < 0) {
+        ERROR("invalid fd %d %d %d", memFd, dataFd, spaceFd);
+        if (memFd >= 0)
+            ::close(memFd);
+        ring.reset();
+        return ring;
+    }
+
+    ring->mMem = MMAshMem::importFd(memFd);
+    if (!ring->mMem || !ring->init(0, 0, false))
+        ring.reset();
+
+    return ring;
+}
+
+bool SharedBufferRing::init(uint32_t slotCount, uint32_t slotSize, bool create) {
+    uint32_t dataOffset;
+    size_t total;
+
+    if (create) {
+        slotSize = ALIGN_UP(slotSize, RING_ALIGN);
+        dataOffset = ALIGN_UP(RING_DESC_OFFSET + slotCount * sizeof(SlotDesc), RING_PAGE_SIZE);
+        total = dataOffset + (size_t)slotCount * slotSize;
+
+        mMem = MMAshMem::createMemFd("mm-buffer-ring", total);
+        if (!mMem || !mMem->getBase()) {
+            ERROR("fail to create ring memory, size %zu", total);
+            return false;
+        }
+
+        mHeader = (Header*)mMem->getBase();
+        memset(mHeader, 0, dataOffset);
+        mHeader->mVersion = RING_VERSION;
+        mHeader->mSlotCount = slotCount;
+        mHeader->mSlotSize = slotSize;
+        mHeader->mDataOffset = dataOffset;
+        __atomic_store_n(&mHeader->mMagic, RING_MAGIC, __ATOMIC_RELEASE);
+    } else {
+        // the header is written by the peer, check it against the size of our mapping
+        // and never read the geometry from shared memory again
+        total = mMem->getSize();
+        mHeader = (Header*)mMem->getBase();
+        if (!mHeader || total < sizeof(Header)) {
+            ERROR("ring memory too small, %zu", total);
+            mHeader = NULL;
+            return false;
+        }
+
+        slotCount = mHeader->mSlotCount;
+        slotSize = mHeader->mSlotSize;
+        dataOffset = mHeader->mDataOffset;
+        if (__atomic_load_n(&mHeader->mMagic, __ATOMIC_ACQUIRE) != RING_MAGIC ||
+            mHeader->mVersion != RING_VERSION ||
+            slotCount < RING_MIN_SLOTS || slotCount > RING_MAX_SLOTS ||
+            slotSize == 0 || slotSize > RING_MAX_SLOT_SIZE ||
+            dataOffset < RING_DESC_OFFSET + slotCount * sizeof(SlotDesc) ||
+            dataOffset + (size_t)slotCount * slotSize > total) {
+            ERROR("invalid ring header");
+            mHeader = NULL;
+            return false;
+        }
+    }
+
+    mSlotCount = slotCount;
+    mSlotSize = slotSize;
+    mDataOffset = dataOffset;
+    mReadIndex = __atomic_load_n(&mHeader->mTail, __ATOMIC_ACQUIRE);
+    mReleased.assign(mSlotCount, true);
+
+    INFO("ring %s %u x %u, memfd %d", create ? "created" : "imported",
+        mSlotCount, mSlotSize, mMem->getFd());
+    return true;
+}
+
+int SharedBufferRing::memFd() const {
+    return mMem ? mMem->getFd() : -1;
+}
+
+uint8_t *SharedBufferRing::slotData(uint32_t index) const {
+    return (uint8_t*)mHeader + mDataOffset + (size_t)(index % mSlotCount) * mSlotSize;
+}
+
+SharedBufferRing::SlotDesc *SharedBufferRing::slotDesc(uint32_t index) const {
+    return (SlotDesc*)((uint8_t*)mHeader + RING_DESC_OFFSET) + (index % mSlotCount);
+}
+
+bool SharedBufferRing::isClosed() const {
+    return !mHeader || __atomic_load_n(&mHeader->mClosed, __ATOMIC_ACQUIRE);
+}
+
+uint32_t SharedBufferRing::pending() const {
+    if (!mHeader)
+        return 0;
+    return __atomic_load_n(&mHeader->mHead, __ATOMIC_ACQUIRE) -
+        __atomic_load_n(&mHeader->mTail, __ATOMIC_ACQUIRE);
+}
+
+void SharedBufferRing::close() {
+    if (!mHeader)
+        return;
+    __atomic_store_n(&mHeader->mClosed, 1, __ATOMIC_SEQ_CST);
+    ring(mDataFd);
+    ring(mSpaceFd);
+}
+
+void SharedBufferRing::ring(int fd) {
+    uint64_t one = 1;
+    if (write(fd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+        WARNING("fail to ring doorbell %d, %s", fd, strerror(errno));
+}
+
+/*
+ * the waiting flag is set before checking the ring again, and the peer publishes head/tail
+ * before checking the flag; both are seq_cst so one of the two sides sees the other
+ */
+mm_status_t SharedBufferRing::waitFor(bool space, int32_t timeoutMs) {
+    uint32_t *waiting = space ? &mHeader->mProducerWaiting : &mHeader->mConsumerWaiting;
+    int fd = space ? mSpaceFd : mDataFd;
+    int64_t deadlineUs = timeoutMs >= 0 ? getTimeUs() + (int64_t)timeoutMs * 1000 : -1;
+
+    for (bool armed = false;; armed = true) {
+        if (isClosed())
+            return MM_ERROR_EOS;
+
+        uint32_t head = __atomic_load_n(&mHeader->mHead, __ATOMIC_SEQ_CST);
+        uint32_t tail = __atomic_load_n(&mHeader->mTail, __ATOMIC_SEQ_CST);
+        uint32_t used = space ? head - tail : head - mReadIndex;
+        if (used > mSlotCount) {
+            ERROR("ring corrupted, head %u tail %u read %u", head, tail, mReadIndex);
+            __atomic_store_n(waiting, 0, __ATOMIC_RELAXED);
+            return MM_ERROR_OP_FAILED;
+        }
+        if (space ? used < mSlotCount : used > 0) {
+            __atomic_store_n(waiting, 0, __ATOMIC_RELAXED);
+            return MM_ERROR_SUCCESS;
+        }
+
+        if (!armed) {
+            // check the ring once more with the flag set before going to sleep
+            __atomic_store_n(waiting, 1, __ATOMIC_SEQ_CST);
+            continue;
+        }
+
+        int waitMs = -1;
+        if (deadlineUs >= 0) {
+            int64_t leftUs = deadlineUs - getTimeUs();
+            if (leftUs <= 0) {
+                __atomic_store_n(waiting, 0, __ATOMIC_RELAXED);
+                return MM_ERROR_AGAIN;
+            }
+            waitMs = (int)((leftUs + 999) / 1000);
+        }
+
+        struct pollfd pfd;
+        pfd.fd = fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        int ret = poll(&pfd, 1, waitMs);
+        if (ret < 0 && errno != EINTR) {
+            ERROR("poll fail, %s", strerror(errno));
+            __atomic_store_n(waiting, 0, __ATOMIC_RELAXED);
+            return MM_ERROR_OP_FAILED;
+        }
+        if (ret > 0) {
+            uint64_t count;
+            if (read(fd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+                WARNING("fail to read doorbell, %s", strerror(errno));
+        }
+    }
+}
+
+mm_status_t SharedBufferRing::dequeueBuffer(MediaBufferSP &buffer, int32_t timeoutMs) {
+    if (mRole != kProducer || !mHeader)
+        return MM_ERROR_IVALID_OPERATION;
+
+    if (!mReserved) {
+        mm_status_t status = waitFor(true, timeoutMs);
+        if (status != MM_ERROR_SUCCESS)
+            return status;
+        mReserved = true;
+    }
+
+    uint32_t head = __atomic_load_n(&mHeader->mHead, __ATOMIC_RELAXED);
+    uint8_t *data = slotData(head);
+    int32_t offset = 0;
+    int32_t stride = mSlotSize;
+
+    // size is the capacity of the slot, set it to the size written
+    buffer = MediaBuffer::createMediaBuffer(MediaBuffer::MBT_ByteBuffer);
+    buffer->setBufferInfo((uintptr_t*)&data, &offset, &stride, 1);
+    buffer->setSize(mSlotSize);
+    return MM_ERROR_SUCCESS;
+}
+
+mm_status_t SharedBufferRing::writeBuffer(const MediaBufferSP &buffer, int32_t timeoutMs) {
+    if (mRole != kProducer || !mHeader)
+        return MM_ERROR_IVALID_OPERATION;
+    if (!buffer)
+        return MM_ERROR_INVALID_PARAM;
+
+    uint8_t *data = NULL;
+    int32_t offset = 0;
+    buffer->getBufferInfo((uintptr_t*)&data, &offset, NULL, 1);
+    int64_t size = buffer->size();
+    if (!data || size < 0)
+        size = 0;
+    if (size > mSlotSize) {
+        ERROR("buffer size %" PRId64 " exceeds slot size %u", size, mSlotSize);
+        return MM_ERROR_INVALID_PARAM;
+    }
+
+    if (!mReserved) {
+        mm_status_t status = waitFor(true, timeoutMs);
+        if (status != MM_ERROR_SUCCESS)
+            return status;
+    }
+
+    uint32_t head = __atomic_load_n(&mHeader->mHead, __ATOMIC_RELAXED);
+    uint8_t *slot = slotData(head);
+    if (size > 0) {
+        data += offset;
+        // written in place into the slot of dequeueBuffer(), nothing to copy
+        if (data >= slot && data < slot + mSlotSize) {
+            if (data != slot)
+                memmove(slot, data, size);
+        } else {
+            memcpy(slot, data, size);
+        }
+    }
+
+    SlotDesc *desc = slotDesc(head);
+    desc->mSize = (uint32_t)size;
+    desc->mFlags = 0;
+    for (int i = 0; i < MediaBuffer::MBFT_LAST; i++) {
+        MediaBuffer::MediaBufferFlagType flag = (MediaBuffer::MediaBufferFlagType)i;
+        // the data is plain bytes in the slot
+        if (flag == MediaBuffer::MBFT_AVPacket || flag == MediaBuffer::MBFT_AVFrame ||
+            flag == MediaBuffer::MBFT_BufferInited)
+            continue;
+        if (buffer->isFlagSet(flag))
+            desc->mFlags |= 1 << i;
+    }
+    desc->mPts = buffer->pts();
+    desc->mDts = buffer->dts();
+    desc->mDuration = buffer->duration();
+    desc->mType = buffer->type();
+    desc->mMime[0] = '\0';
+    MediaMetaSP meta = buffer->getMediaMeta();
+    const char *mime = NULL;
+    if (meta && meta->getString(MEDIA_ATTR_MIME, mime) && mime) {
+        strncpy(desc->mMime, mime, RING_MIME_SIZE - 1);
+        desc->mMime[RING_MIME_SIZE - 1] = '\0';
+    }
+
+    mReserved = false;
+    __atomic_store_n(&mHeader->mHead, head + 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&mHeader->mConsumerWaiting, __ATOMIC_SEQ_CST))
+        ring(mDataFd);
+
+    return MM_ERROR_SUCCESS;
+}
+
+mm_status_t SharedBufferRing::readBuffer(MediaBufferSP &buffer, int32_t timeoutMs) {
+    if (mRole != kConsumer || !mHeader)
+        return MM_ERROR_IVALID_OPERATION;
+
+    mm_status_t status = waitFor(false, timeoutMs);
+    if (status != MM_ERROR_SUCCESS)
+        return status;
+
+    uint32_t index;
+    {
+        MMAutoLock lock(mLock);
+        index = mReadIndex++;
+        mReleased[index % mSlotCount] = false;
+    }
+
+    // the producer doesn't touch a published slot, but don't trust it
+    SlotDesc desc = *slotDesc(index);
+    desc.mMime[RING_MIME_SIZE - 1] = '\0';
+    if (desc.mSize > mSlotSize) {
+        ERROR("invalid slot size %u", desc.mSize);
+        desc.mSize = 0;
+        desc.mFlags |= 1 << MediaBuffer::MBFT_Corrupt;
+    }
+
+    MediaBuffer::MediaBufferType type = (MediaBuffer::MediaBufferType)desc.mType;
+    if (type != MediaBuffer::MBT_RawVideo && type != MediaBuffer::MBT_RawAudio)
+        type = MediaBuffer::MBT_ByteBuffer;
+
+    uint8_t *data = slotData(index);
+    int32_t offset = 0;
+    int32_t stride = desc.mSize;
+    buffer = MediaBuffer::createMediaBuffer(type);
+    buffer->setBufferInfo((uintptr_t*)&data, &offset, &stride, 1);
+    buffer->setSize(desc.mSize);
+    buffer->setPts(desc.mPts);
+    buffer->setDts(desc.mDts);
+    buffer->setDuration(desc.mDuration);
+    for (int i = 0; i < MediaBuffer::MBFT_LAST; i++) {
+        if (desc.mFlags & (1 << i))
+            buffer->setFlag((MediaBuffer::MediaBufferFlagType)i);
+    }
+
+    // the slot goes back to the producer when the last reference of buffer is gone,
+    // the buffer keeps the ring alive until then
+    MediaMetaSP meta = MediaMeta::create();
+    if (desc.mMime[0])
+        meta->setString(MEDIA_ATTR_MIME, desc.mMime);
+    meta->setPointer(RING_META_OWNER, new SharedBufferRingSP(shared_from_this()));
+    meta->setInt32(RING_META_SLOT, (int32_t)(index % mSlotCount));
+    buffer->setMediaMeta(meta);
+    buffer->addReleaseBufferFunc(releaseMediaBuffer);
+
+    return MM_ERROR_SUCCESS;
+}
+
+void SharedBufferRing::releaseSlot(uint32_t index) {
+    MMAutoLock lock(mLock);
+
+    if (index >= mSlotCount || mReleased[index]) {
+        ERROR("invalid release of slot %u", index);
+        return;
+    }
+    mReleased[index] = true;
+
+    uint32_t tail = __atomic_load_n(&mHeader->mTail, __ATOMIC_RELAXED);
+    uint32_t newTail = tail;
+    while (newTail != mReadIndex && mReleased[newTail % mSlotCount])
+        newTail++;
+    if (newTail == tail)
+        return;
+
+    __atomic_store_n(&mHeader->mTail, newTail, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&mHeader->mProducerWaiting, __ATOMIC_SEQ_CST))
+        ring(mSpaceFd);
+}
+
+/*static*/ bool SharedBufferRing::releaseMediaBuffer(MediaBuffer *buffer) {
+    MediaMetaSP meta = buffer->getMediaMeta();
+    void *ptr = NULL;
+    int32_t index = -1;
+    if (!meta || !meta->getPointer(RING_META_OWNER, ptr) || !ptr ||
+        !meta->getInt32(RING_META_SLOT, index)) {
+        ERROR("buffer lost its ring slot");
+        return false;
+    }
+
+    SharedBufferRingSP *ring = (SharedBufferRingSP*)ptr;
+    (*ring)->releaseSlot((uint32_t)index);
+    delete ring;
+    return true;
+}
+
+} // end of namespace YUNOS_MM
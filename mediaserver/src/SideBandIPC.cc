@@ -278,6 +278,62 @@ mm_status_t SideBandIPC::sendFd(int fd) {
         return MM_ERROR_NOT_INITED;
 
     char buf = '1';
+    mm_status_t status = sendFdMsg(fd, &buf, 1);
+
+    INFO("sendFd return status %d", status);
+    return status;
+}
+
+int SideBandIPC::recvFd() {
+
+    // not an mm_status_t, MM_ERROR_NOT_INITED would look like a valid fd
+    if (!init())
+        return -1;
+
+    char c;
+    return recvFdMsg(&c, 1);
+}
+
+struct AshMemMsg {
+    uint64_t size;
+};
+
+mm_status_t SideBandIPC::sendAshMem(const MMAshMemSP &mem) {
+
+    if (!mem || mem->getFd() < 0) {
+        ERROR("not fd backed ashmem");
+        return MM_ERROR_INVALID_PARAM;
+    }
+
+    if (!init())
+        return MM_ERROR_NOT_INITED;
+
+    AshMemMsg msg;
+    msg.size = mem->getSize();
+    mm_status_t status = sendFdMsg(mem->getFd(), &msg, sizeof(msg));
+
+    DEBUG("sendAshMem fd %d size %" PRIu64 " return status %d", mem->getFd(), msg.size, status);
+    return status;
+}
+
+MMAshMemSP SideBandIPC::recvAshMem(bool readonly) {
+    MMAshMemSP mem;
+
+    if (!init())
+        return mem;
+
+    AshMemMsg msg;
+    int fd = recvFdMsg(&msg, sizeof(msg));
+    if (fd < 0)
+        return mem;
+
+    // importFd owns fd, closes it on failure
+    mem = MMAshMem::importFd(fd, (size_t)msg.size, readonly);
+    return mem;
+}
+
+mm_status_t SideBandIPC::sendFdMsg(int fd, const void *data, size_t size) {
+
     struct msghdr   hdr;
     struct iovec    vec[1];
 
@@ -298,8 +354,8 @@ mm_status_t SideBandIPC::sendFd(int fd) {
     cmptr->cmsg_type = SCM_RIGHTS;
     *((int *) CMSG_DATA(cmptr)) = fd;
 
-    vec[0].iov_base = &buf;
-    vec[0].iov_len = 1;
+    vec[0].iov_base = (void*)data;
+    vec[0].iov_len = size;
 
     hdr.msg_name = NULL;
     hdr.msg_namelen = 0;
@@ -307,21 +363,28 @@ mm_status_t SideBandIPC::sendFd(int fd) {
     hdr.msg_iovlen = 1;
     hdr.msg_flags = 0;
 
-    if(sendmsg(mFd, &hdr, 0) < 0) {
+    ssize_t n = sendmsg(mFd, &hdr, 0);
+    if (n < 0) {
         ERROR("sendmsg fail");
-        status = MM_ERROR_OP_FAILED;
+        return MM_ERROR_OP_FAILED;
+    }
+
+    // the fd goes with the first byte, send the rest of data if the socket buffer is short
+    while ((size_t)n < size) {
+        ssize_t ret = send(mFd, (const char*)data + n, size - n, 0);
+        if (ret <= 0) {
+            ERROR("send fail");
+            status = MM_ERROR_OP_FAILED;
+            break;
+        }
+        n += ret;
     }
 
-    INFO("sendFd return status %d", status);
     return status;
 }
 
-int SideBandIPC::recvFd() {
-
-    if (!init())
-        return MM_ERROR_NOT_INITED;
+int SideBandIPC::recvFdMsg(void *data, size_t size) {
 
-    char c;
     struct iovec vec[1];
     ssize_t n;
     struct msghdr msg;
@@ -338,8 +401,8 @@ int SideBandIPC::recvFd() {
     msg.msg_name = NULL;
     msg.msg_namelen = 0;
 
-    vec[0].iov_base = &c;
-    vec[0].iov_len = 1;
+    vec[0].iov_base = data;
+    vec[0].iov_len = size;
     msg.msg_iov = vec;
     msg.msg_iovlen = 1;
     msg.msg_flags = 0;
@@ -366,6 +429,16 @@ int SideBandIPC::recvFd() {
         fd = -1;
     }
 
+    while (fd >= 0 && (size_t)n < size) {
+        ssize_t ret = recv(mFd, (char*)data + n, size - n, 0);
+        if (ret <= 0) {
+            ERROR("recv return %" PRId64 "", (int64_t)ret);
+            close(fd);
+            return -1;
+        }
+        n += ret;
+    }
+
     return fd;
 }
 
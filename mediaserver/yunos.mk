@@ -34,7 +34,8 @@ LOCAL_C_INCLUDES += $(dbus-includes)                 \
 
 LOCAL_SRC_FILES:= src/MediaServiceName.cc        \
                   src/MediaServiceLooper.cc      \
-                  src/SideBandIPC.cc
+                  src/SideBandIPC.cc             \
+                  src/SharedBufferRing.cc
 
 LOCAL_MODULE:= libmediaservice_client_common
 LOCAL_CFLAGS += -fno-rtti
@@ -73,6 +74,7 @@ LOCAL_SRC_FILES:= src/MediaService.cc            \
                   src/MediaPlayerAdaptor.cc      \
                   src/MediaRecorderInstance.cc   \
                   src/MediaRecorderAdaptor.cc    \
+                  src/MediaSessionPool.cc        \
                   src/MMDpmsProxy.cc
 
 ##create local window
@@ -102,7 +104,7 @@ ifeq ($(USING_CAMERA),1)
 REQUIRE_CAMERASVR = 1
 endif
 include $(MM_ROOT_PATH)/base/build/xmake_req_libs.mk
-LOCAL_SHARED_LIBRARIES += libcowplayer libcowrecorder##libmediaplayer #libmediarecorder
+LOCAL_SHARED_LIBRARIES += libcowbase libcowplayer libcowrecorder##libmediaplayer #libmediarecorder
 ##LOCAL_SHARED_LIBRARIES += libcowaudiorecorder
 
 LOCAL_LDFLAGS += -lstdc++
@@ -184,6 +184,35 @@ TEST_F(MMAshMemTest, mmashmemtest) {
     INFO("done\n");
 }
 
+TEST_F(MMAshMemTest, memfdtest) {
+    size_t size = 64 * 1024;
+    MMAshMemSP mem = MMAshMem::createMemFd("MMAshMemTest", size);
+    ASSERT_TRUE(mem.get() != NULL);
+    ASSERT_TRUE(mem->getBase() != NULL);
+    EXPECT_GE(mem->getFd(), 0);
+    EXPECT_EQ(size, mem->getSize());
+    memset(mem->getBase(), 0x5a, size);
+
+    // size is sealed
+    EXPECT_NE(0, ftruncate(mem->getFd(), size / 2));
+
+    // as if the fd is received from another process
+    MMAshMemSP peer = MMAshMem::importFd(dup(mem->getFd()), 0, true);
+    ASSERT_TRUE(peer.get() != NULL);
+    EXPECT_EQ(size, peer->getSize());
+    EXPECT_EQ(0x5a, ((uint8_t*)peer->getBase())[size - 1]);
+
+    ((uint8_t*)mem->getBase())[0] = 0xa5;
+    EXPECT_EQ(0xa5, ((uint8_t*)peer->getBase())[0]);
+
+    // falls back to normal pages without hugetlb pages reserved
+    MMAshMemSP huge = MMAshMem::createMemFd("MMAshMemTest", size,
+        MMAshMem::kMemFdSeal | MMAshMem::kMemFdHugePage);
+    ASSERT_TRUE(huge.get() != NULL);
+    EXPECT_TRUE(huge->getBase() != NULL);
+    EXPECT_GE(huge->getSize(), size);
+}
+
 int main(int argc, char* const argv[]) {
   int ret;
   MMLOGD("testing begin\n");
@@ -18,6 +18,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h>
+#include <pthread.h>
 
 #ifndef MM_LOG_OUTPUT_V
 #define MM_LOG_OUTPUT_V
@@ -68,4 +69,23 @@ TEST_F(MMDebugTest, logTest) {
     ERROR("test mmdebug ERROR \n");
 }
 
+static void *asyncLogThread(void *arg) {
+    for (int i = 0; i < 20; i++)
+        INFO("async log thread %ld, message %d\n", (long)arg, i);
+    return NULL;
+}
+
+TEST_F(MMDebugTest, asyncLogTest) {
+    setenv("MM_LOG_ASYNC", "1", 1);
+    EXPECT_TRUE(mm_log_set_level(MM_LOG_VERBOSE));
 
+    pthread_t threads[4];
+    for (long i = 0; i < 4; i++)
+        EXPECT_EQ(0, pthread_create(&threads[i], NULL, asyncLogThread, (void*)i));
+    for (int i = 0; i < 4; i++)
+        pthread_join(threads[i], NULL);
+
+    EXPECT_EQ(0, mm_log(MM_LOG_ERROR, MM_LOG_TAG, "test async log ERROR\n"));
+    mm_log_flush();
+    EXPECT_EQ((uint64_t)0, mm_log_get_dropped());
+}
@@ -0,0 +1,282 @@
+/**
+ * Copyright (C) 2017 Alibaba Group Holding Limited. All Rights Reserved.
+ *
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include <multimedia/mm_debug.h>
+#include <multimedia/mm_errors.h>
+#include <multimedia/media_buffer.h>
+#include <multimedia/media_attr_str.h>
+
+#include "components/audio_mixer.h"
+
+MM_LOG_DEFINE_MODULE_NAME("audio-mixer-test");
+
+using namespace YUNOS_MM;
+
+static const int32_t kSampleRate = 48000;
+static const int32_t kFrames = 1000; // per input buffer
+
+// keeps every buffer the mixer pushes
+class FakeSink : public SinkComponent {
+  public:
+    class FakeWriter : public Writer {
+      public:
+        FakeWriter(FakeSink *sink) : mSink(sink) {}
+        virtual mm_status_t write(const MediaBufferSP &buffer) {
+            MMAutoLock locker(mSink->mLock);
+            mSink->mBuffers.push_back(buffer);
+            return MM_ERROR_SUCCESS;
+        }
+        virtual mm_status_t setMetaData(const MediaMetaSP &metaData) {
+            metaData->getInt32(MEDIA_ATTR_SAMPLE_RATE, mSink->mSampleRate);
+            metaData->getInt32(MEDIA_ATTR_CHANNEL_COUNT, mSink->mChannels);
+            return MM_ERROR_SUCCESS;
+        }
+      private:
+        FakeSink *mSink;
+    };
+
+    FakeSink() : mSampleRate(0), mChannels(0) {}
+    virtual const char * name() const { return "FakeSink"; }
+    COMPONENT_VERSION;
+    virtual WriterSP getWriter(MediaType mediaType) { return WriterSP(new FakeWriter(this)); }
+    virtual mm_status_t addSource(Component * component, MediaType mediaType) { return MM_ERROR_SUCCESS; }
+    virtual int64_t getCurrentPosition() { return 0; }
+
+    void takeBuffers(std::vector<MediaBufferSP> &buffers) {
+        MMAutoLock locker(mLock);
+        buffers.insert(buffers.end(), mBuffers.begin(), mBuffers.end());
+        mBuffers.clear();
+    }
+
+    Lock mLock;
+    std::vector<MediaBufferSP> mBuffers;
+    int32_t mSampleRate;
+    int32_t mChannels;
+};
+
+class MixerListener : public Component::Listener {
+    virtual void onMessage(int msg, int param1, int param2, const MMParamSP param, const Component * sender) {}
+};
+
+static bool releasePcm(MediaBuffer *buffer)
+{
+    uint8_t *data = NULL;
+    if (!buffer->getBufferInfo((uintptr_t*)&data, NULL, NULL, 1))
+        return false;
+    delete [] (int16_t*)data;
+    return true;
+}
+
+static MediaBufferSP createPcm(int16_t value, int32_t channels, int64_t pts)
+{
+    MediaBufferSP buffer = MediaBuffer::createMediaBuffer(MediaBuffer::MBT_RawAudio);
+    int16_t *data = new int16_t[kFrames * channels];
+    for (int32_t i = 0; i < kFrames * channels; i++)
+        data[i] = value;
+    int32_t size = kFrames * channels * sizeof(int16_t);
+    buffer->setBufferInfo((uintptr_t*)&data, NULL, &size, 1);
+    buffer->setSize(size);
+    buffer->setPts(pts);
+    buffer->addReleaseBufferFunc(releasePcm);
+    return buffer;
+}
+
+// skip frames of garbage before the payload, size is the payload after the offset
+static MediaBufferSP createPcmAt(int16_t value, int32_t channels, int64_t pts, int32_t skip)
+{
+    MediaBufferSP buffer = MediaBuffer::createMediaBuffer(MediaBuffer::MBT_RawAudio);
+    int16_t *data = new int16_t[(skip + kFrames) * channels];
+    for (int32_t i = 0; i < (skip + kFrames) * channels; i++)
+        data[i] = i < skip * channels ? -7777 : value;
+    int32_t offset = skip * channels * sizeof(int16_t);
+    int32_t size = kFrames * channels * sizeof(int16_t);
+    buffer->setBufferInfo((uintptr_t*)&data, &offset, &size, 1);
+    buffer->setSize(size);
+    buffer->setPts(pts);
+    buffer->addReleaseBufferFunc(releasePcm);
+    return buffer;
+}
+
+static MediaBufferSP createEOS()
+{
+    MediaBufferSP buffer = MediaBuffer::createMediaBuffer(MediaBuffer::MBT_RawAudio);
+    buffer->setFlag(MediaBuffer::MBFT_EOS);
+    buffer->setSize(0);
+    return buffer;
+}
+
+class AudioMixerTest : public testing::Test {
+protected:
+    virtual void SetUp() {
+    }
+
+    virtual void TearDown() {
+    }
+};
+
+// input 0: stereo 1000 for 5 buffers, input 1: mono 2000 with gain 0.5 for 3 buffers
+TEST_F(AudioMixerTest, mixTwoInputs) {
+    AudioMixer mixer;
+    Component::ListenerSP listener(new MixerListener());
+    mixer.setListener(listener);
+    ASSERT_EQ(MM_ERROR_SUCCESS, mixer.init());
+
+    MediaMetaSP param = MediaMeta::create();
+    param->setInt32(MEDIA_ATTR_SAMPLE_RATE, kSampleRate);
+    mixer.setParameter(param);
+
+    FakeSink sink;
+    ASSERT_EQ(MM_ERROR_SUCCESS, mixer.addSink(&sink, Component::kMediaTypeAudio));
+    EXPECT_EQ(kSampleRate, sink.mSampleRate);
+    EXPECT_EQ(2, sink.mChannels);
+
+    Component::WriterSP input0 = mixer.getWriter(Component::kMediaTypeAudio);
+    Component::WriterSP input1 = mixer.getWriter(Component::kMediaTypeAudio);
+    ASSERT_TRUE(input0 && input1);
+
+    MediaMetaSP meta = MediaMeta::create();
+    meta->setInt32(MEDIA_ATTR_SAMPLE_RATE, kSampleRate);
+    meta->setInt32(MEDIA_ATTR_SAMPLE_FORMAT, SND_FORMAT_PCM_16_BIT);
+    meta->setInt32(MEDIA_ATTR_CHANNEL_COUNT, 2);
+    ASSERT_EQ(MM_ERROR_SUCCESS, input0->setMetaData(meta));
+    MediaMetaSP mono = meta->copy();
+    mono->setInt32(MEDIA_ATTR_CHANNEL_COUNT, 1);
+    ASSERT_EQ(MM_ERROR_SUCCESS, input1->setMetaData(mono));
+
+    param = MediaMeta::create();
+    param->setInt32(AUDIO_MIXER_INPUT_INDEX, 1);
+    param->setFloat(AUDIO_MIXER_INPUT_GAIN, 0.5f);
+    ASSERT_EQ(MM_ERROR_SUCCESS, mixer.setParameter(param));
+
+    int64_t durationUs = kFrames * 1000000ll / kSampleRate;
+    for (int32_t i = 0; i < 5; i++)
+        EXPECT_EQ(MM_ERROR_SUCCESS, input0->write(createPcm(1000, 2, i * durationUs)));
+    for (int32_t i = 0; i < 3; i++)
+        EXPECT_EQ(MM_ERROR_SUCCESS, input1->write(createPcm(2000, 1, i * durationUs)));
+    input0->write(createEOS());
+    input1->write(createEOS());
+
+    // all input is queued before the first period, so no input underruns
+    mixer.prepare();
+    mixer.start();
+
+    // the mix runs in real time and is paced by the sink, release the output as it comes
+    std::vector<int16_t> output;
+    bool eos = false;
+    for (int32_t retry = 0; retry < 100 && !eos; retry++) {
+        usleep(20000);
+        std::vector<MediaBufferSP> buffers;
+        sink.takeBuffers(buffers);
+        for (size_t i = 0; i < buffers.size(); i++) {
+            if (buffers[i]->isFlagSet(MediaBuffer::MBFT_EOS)) {
+                eos = true;
+                continue;
+            }
+            int16_t *pcm = NULL;
+            int32_t size = 0;
+            if (buffers[i]->getBufferInfo((uintptr_t*)&pcm, NULL, &size, 1) && pcm)
+                output.insert(output.end(), pcm, pcm + size / sizeof(int16_t));
+        }
+    }
+
+    // tear down before checking, the mix thread must not outlive a failed assertion
+    mixer.stop();
+    mixer.reset();
+    input0.reset();
+    input1.reset();
+    mixer.uninit();
+
+    ASSERT_TRUE(eos);
+    int64_t frames = output.size() / 2;
+    for (int64_t f = 0; f < frames; f++) {
+        // 1000 from input 0, 2000 * 0.5 from input 1 while it lasts
+        int32_t expected = (f < 5 * kFrames ? 1000 : 0) + (f < 3 * kFrames ? 1000 : 0);
+        ASSERT_NEAR(expected, output[f * 2], 1) << "frame " << f;
+        ASSERT_NEAR(expected, output[f * 2 + 1], 1) << "frame " << f;
+    }
+    EXPECT_GE(frames, 5 * kFrames);
+}
+
+// 3 stereo buffers of 1000 after 100 frames of garbage: every payload frame and none of the garbage
+TEST_F(AudioMixerTest, mixWithOffset) {
+    AudioMixer mixer;
+    Component::ListenerSP listener(new MixerListener());
+    mixer.setListener(listener);
+    ASSERT_EQ(MM_ERROR_SUCCESS, mixer.init());
+
+    MediaMetaSP param = MediaMeta::create();
+    param->setInt32(MEDIA_ATTR_SAMPLE_RATE, kSampleRate);
+    mixer.setParameter(param);
+
+    FakeSink sink;
+    ASSERT_EQ(MM_ERROR_SUCCESS, mixer.addSink(&sink, Component::kMediaTypeAudio));
+    Component::WriterSP input = mixer.getWriter(Component::kMediaTypeAudio);
+    ASSERT_TRUE(input);
+
+    MediaMetaSP meta = MediaMeta::create();
+    meta->setInt32(MEDIA_ATTR_SAMPLE_RATE, kSampleRate);
+    meta->setInt32(MEDIA_ATTR_SAMPLE_FORMAT, SND_FORMAT_PCM_16_BIT);
+    meta->setInt32(MEDIA_ATTR_CHANNEL_COUNT, 2);
+    ASSERT_EQ(MM_ERROR_SUCCESS, input->setMetaData(meta));
+
+    int64_t durationUs = kFrames * 1000000ll / kSampleRate;
+    for (int32_t i = 0; i < 3; i++)
+        EXPECT_EQ(MM_ERROR_SUCCESS, input->write(createPcmAt(1000, 2, i * durationUs, 100)));
+    input->write(createEOS());
+
+    mixer.prepare();
+    mixer.start();
+
+    std::vector<int16_t> output;
+    bool eos = false;
+    for (int32_t retry = 0; retry < 100 && !eos; retry++) {
+        usleep(20000);
+        std::vector<MediaBufferSP> buffers;
+        sink.takeBuffers(buffers);
+        for (size_t i = 0; i < buffers.size(); i++) {
+            if (buffers[i]->isFlagSet(MediaBuffer::MBFT_EOS)) {
+                eos = true;
+                continue;
+            }
+            int16_t *pcm = NULL;
+            int32_t size = 0;
+            if (buffers[i]->getBufferInfo((uintptr_t*)&pcm, NULL, &size, 1) && pcm)
+                output.insert(output.end(), pcm, pcm + size / sizeof(int16_t));
+        }
+    }
+
+    mixer.stop();
+    mixer.reset();
+    input.reset();
+    mixer.uninit();
+
+    ASSERT_TRUE(eos);
+    int64_t frames = output.size() / 2;
+    ASSERT_GE(frames, 3 * kFrames);
+    for (int64_t f = 0; f < frames; f++) {
+        int32_t expected = f < 3 * kFrames ? 1000 : 0;
+        ASSERT_NEAR(expected, output[f * 2], 1) << "frame " << f;
+        ASSERT_NEAR(expected, output[f * 2 + 1], 1) << "frame " << f;
+    }
+}
@@ -17,9 +17,16 @@
 
 #include <unistd.h>
 #include <semaphore.h>
+#include <stdio.h>
+#include <time.h>
+#include <limits>
+#include <vector>
+#include <algorithm>
 #include <gtest/gtest.h>
 #include <multimedia/mmthread.h>
 #include <multimedia/component.h>
+#include <multimedia/media_attr_str.h>
+#include <multimedia/memory_asset.h>
 
 #ifndef MM_LOG_OUTPUT_V
 #define MM_LOG_OUTPUT_V
@@ -469,3 +476,375 @@ init:
     MMLOGI("bye\n");
 
 }
+
+// seamless loop: records the dts of every buffer and when it is read, the loop point is checked after
+class LoopSink : public MMThread {
+public:
+    LoopSink(PlaySourceComponent * source, Component::MediaType mediaType)
+        : MMThread("LoopSink")
+        , mMediaType(mediaType)
+        , mContinue(false)
+    {
+        mReader = source->getReader(mediaType);
+    }
+
+    void start() { mContinue = true; create(); }
+    void stop() { mContinue = false; destroy(); }
+
+    struct Sample {
+        int64_t dtsUs;
+        int64_t readUs;
+    };
+    std::vector<Sample> mSamples;
+
+protected:
+    virtual void main()
+    {
+        while ( mContinue && mReader ) {
+            MediaBufferSP buffer;
+            mm_status_t ret = mReader->read(buffer);
+            if ( ret != MM_ERROR_SUCCESS || !buffer ) {
+                usleep(1000);
+                continue;
+            }
+            if ( buffer->isFlagSet(MediaBuffer::MBFT_EOS) )
+                break;
+            if ( buffer->dts() == std::numeric_limits<int64_t>::min() || buffer->size() == 0 )
+                continue;
+            Sample sample = { buffer->dts(), getTimeUs() };
+            mSamples.push_back(sample);
+        }
+    }
+
+private:
+    Component::MediaType mMediaType;
+    Component::ReaderSP mReader;
+    bool mContinue;
+};
+
+static sem_t sgLoopSem;
+static int64_t sgLoopStartMs[2] = { -1, -1 };
+
+class LoopListener : public Component::Listener {
+public:
+    virtual void onMessage(int msg, int param1, int param2, const MMParamSP obj, const Component * sender)
+    {
+        if ( msg == Component::kEventPrepareResult ) {
+            sgPrepareResult = param1;
+            sem_post(&sgLoopSem);
+        } else if ( msg == Component::kEventInfo && param1 == PlaySourceComponent::kEventInfoLoopStarted ) {
+            int32_t count = obj ? obj->readInt32() : 0;
+            MMLOGI("loop %d at %d ms\n", count, param2);
+            if ( count >= 1 && count <= 2 ) {
+                sgLoopStartMs[count - 1] = param2;
+                sem_post(&sgLoopSem);
+            }
+        }
+    }
+};
+
+// checks the buffers around the loop point: dts keeps increasing, the dts step there is about a
+// normal one of the pass that ends at it, the pass starting at passUs
+static void checkLoopPoint(const char * name, const std::vector<LoopSink::Sample> & samples,
+    int64_t passUs, int64_t loopUs)
+{
+    size_t at = 0;
+    int64_t maxStepUs = 0;
+    for ( size_t i = 1; i < samples.size(); ++i ) {
+        EXPECT_GT(samples[i].dtsUs, samples[i - 1].dtsUs) << name << " buffer " << i;
+        if ( !at && samples[i].dtsUs >= loopUs )
+            at = i;
+        else if ( samples[i - 1].dtsUs >= passUs && samples[i].dtsUs < loopUs )
+            maxStepUs = std::max(maxStepUs, samples[i].dtsUs - samples[i - 1].dtsUs);
+    }
+    ASSERT_GT(at, 0u) << name << ": no buffer after the loop point";
+    ASSERT_GT(maxStepUs, 0) << name << ": no buffer in the pass";
+
+    int64_t glitchUs = samples[at].dtsUs - samples[at - 1].dtsUs;
+    int64_t latencyUs = samples[at].readUs - samples[at - 1].readUs;
+    MMLOGI("%s loop point: dts step %" PRId64 " us (max elsewhere %" PRId64 " us), read latency %" PRId64 " us\n",
+        name, glitchUs, maxStepUs, latencyUs);
+    // audio and video don't end at the same time, the shorter one may gap by the difference
+    EXPECT_LE(glitchUs, maxStepUs + 100000) << name;
+    EXPECT_LT(latencyUs, 200000) << name;
+}
+
+TEST_F(AvdemuxerTest, seamlessLoop) {
+    sem_init(&sgLoopSem, 0, 0);
+    PlaySourceComponent * source = createSource();
+    ASSERT_NE(source, NULL);
+    ASSERT_EQ(source->init(), MM_ERROR_SUCCESS);
+    source->setListener(Component::ListenerSP(new LoopListener()));
+
+    MediaMetaSP meta = MediaMeta::create();
+    meta->setInt32(PlaySourceComponent::PARAM_KEY_SEAMLESS_LOOP, 1);
+    EXPECT_EQ(source->setParameter(meta), MM_ERROR_SUCCESS);
+    EXPECT_EQ(source->setUri(TEST_FILE), MM_ERROR_SUCCESS);
+    EXPECT_EQ(source->prepare(), MM_ERROR_ASYNC);
+    sem_wait(&sgLoopSem);
+    ASSERT_EQ(sgPrepareResult, MM_ERROR_SUCCESS);
+
+    LoopSink audio(source, Component::kMediaTypeAudio);
+    LoopSink video(source, Component::kMediaTypeVideo);
+    bool hasAudio = source->hasMedia(Component::kMediaTypeAudio);
+    bool hasVideo = source->hasMedia(Component::kMediaTypeVideo);
+    if ( hasAudio )
+        audio.start();
+    if ( hasVideo )
+        video.start();
+    EXPECT_EQ(source->start(), MM_ERROR_SUCCESS);
+
+    // two loops, then let the sinks read past the second loop point
+    for ( int i = 0; i < 2; ++i ) {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_sec += 60;
+        EXPECT_EQ(sem_timedwait(&sgLoopSem, &ts), 0) << "loop " << i + 1;
+    }
+    usleep(500000);
+
+    source->stop();
+    if ( hasAudio )
+        audio.stop();
+    if ( hasVideo )
+        video.stop();
+
+    // the step of each loop point is measured against its own pass, a glitch at the first
+    // one doesn't hide one at the second
+    for ( int i = 0; i < 2; ++i ) {
+        if ( sgLoopStartMs[i] < 0 )
+            continue;
+        int64_t passUs = i > 0 ? sgLoopStartMs[i - 1] * 1000 : std::numeric_limits<int64_t>::min();
+        if ( hasAudio )
+            checkLoopPoint("audio", audio.mSamples, passUs, sgLoopStartMs[i] * 1000);
+        if ( hasVideo )
+            checkLoopPoint("video", video.mSamples, passUs, sgLoopStartMs[i] * 1000);
+    }
+
+    source->reset();
+    source->uninit();
+    destroySource(source);
+    sem_destroy(&sgLoopSem);
+}
+
+
+static sem_t sgNextSem;
+static int64_t sgNextStartMs = -1;
+
+class NextListener : public Component::Listener {
+public:
+    virtual void onMessage(int msg, int param1, int param2, const MMParamSP obj, const Component * sender)
+    {
+        if ( msg == Component::kEventPrepareResult ) {
+            sgPrepareResult = param1;
+            sem_post(&sgNextSem);
+        } else if ( msg == Component::kEventInfo && param1 == PlaySourceComponent::kEventInfoNextSourceStarted ) {
+            MMLOGI("next source at %d ms\n", param2);
+            sgNextStartMs = param2;
+            sem_post(&sgNextSem);
+        }
+    }
+};
+
+// a buffer wrapped by MemoryAssetCache plays as the first source and joins again as the next one
+TEST_F(AvdemuxerTest, memoryNextSource) {
+    std::vector<uint8_t> data;
+    FILE * fp = fopen(TEST_FILE, "rb");
+    ASSERT_TRUE(fp != NULL);
+    uint8_t buf[4096];
+    size_t len;
+    while ( (len = fread(buf, 1, sizeof(buf), fp)) > 0 )
+        data.insert(data.end(), buf, buf + len);
+    fclose(fp);
+    ASSERT_FALSE(data.empty());
+    MemoryAssetSP asset = MemoryAssetCache::wrap(&data[0], data.size());
+    ASSERT_TRUE(asset);
+
+    sem_init(&sgNextSem, 0, 0);
+    PlaySourceComponent * source = createSource();
+    ASSERT_NE(source, NULL);
+    ASSERT_EQ(source->init(), MM_ERROR_SUCCESS);
+    source->setListener(Component::ListenerSP(new NextListener()));
+
+    EXPECT_EQ(source->setUri(asset->uri().c_str()), MM_ERROR_SUCCESS);
+    EXPECT_EQ(source->prepare(), MM_ERROR_ASYNC);
+    sem_wait(&sgNextSem);
+    ASSERT_EQ(sgPrepareResult, MM_ERROR_SUCCESS);
+
+    LoopSink audio(source, Component::kMediaTypeAudio);
+    LoopSink video(source, Component::kMediaTypeVideo);
+    bool hasAudio = source->hasMedia(Component::kMediaTypeAudio);
+    bool hasVideo = source->hasMedia(Component::kMediaTypeVideo);
+    if ( hasAudio )
+        audio.start();
+    if ( hasVideo )
+        video.start();
+    EXPECT_EQ(source->start(), MM_ERROR_SUCCESS);
+    EXPECT_EQ(source->setNextUri(asset->uri().c_str()), MM_ERROR_SUCCESS);
+
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += 60;
+    EXPECT_EQ(sem_timedwait(&sgNextSem, &ts), 0);
+    usleep(500000);
+
+    source->stop();
+    if ( hasAudio )
+        audio.stop();
+    if ( hasVideo )
+        video.stop();
+
+    ASSERT_GT(sgNextStartMs, 0);
+    if ( hasAudio )
+        checkLoopPoint("audio", audio.mSamples, std::numeric_limits<int64_t>::min(), sgNextStartMs * 1000);
+    if ( hasVideo )
+        checkLoopPoint("video", video.mSamples, std::numeric_limits<int64_t>::min(), sgNextStartMs * 1000);
+
+    source->reset();
+    source->uninit();
+    destroySource(source);
+    sem_destroy(&sgNextSem);
+}
+
+// trick play: records the dts of every video buffer and counts the EOS, reading goes on after it
+class TrickSink : public MMThread {
+public:
+    TrickSink(PlaySourceComponent * source)
+        : MMThread("TrickSink")
+        , mContinue(false)
+        , mEOSCount(0)
+    {
+        mReader = source->getReader(Component::kMediaTypeVideo);
+    }
+
+    void start() { mContinue = true; create(); }
+    void stop() { mContinue = false; destroy(); }
+
+    // blocks until the count-th EOS, false on timeout
+    bool waitEOS(int count)
+    {
+        for ( int i = 0; i < 3000; ++i ) {
+            {
+                MMAutoLock locker(mLock);
+                if ( mEOSCount >= count )
+                    return true;
+            }
+            usleep(10000);
+        }
+        return false;
+    }
+
+    std::vector<int64_t> takeDts()
+    {
+        MMAutoLock locker(mLock);
+        std::vector<int64_t> dts;
+        dts.swap(mDts);
+        return dts;
+    }
+
+protected:
+    virtual void main()
+    {
+        while ( mContinue && mReader ) {
+            MediaBufferSP buffer;
+            mm_status_t ret = mReader->read(buffer);
+            if ( ret != MM_ERROR_SUCCESS || !buffer ) {
+                usleep(1000);
+                continue;
+            }
+            MMAutoLock locker(mLock);
+            if ( buffer->isFlagSet(MediaBuffer::MBFT_EOS) )
+                mEOSCount++;
+            else if ( buffer->dts() != std::numeric_limits<int64_t>::min() && buffer->size() > 0 )
+                mDts.push_back(buffer->dts());
+        }
+    }
+
+private:
+    Component::ReaderSP mReader;
+    bool mContinue;
+    Lock mLock;
+    std::vector<int64_t> mDts;
+    int mEOSCount;
+};
+
+static sem_t sgTrickSem;
+
+class TrickListener : public Component::Listener {
+public:
+    virtual void onMessage(int msg, int param1, int param2, const MMParamSP obj, const Component * sender)
+    {
+        if ( msg == Component::kEventPrepareResult ) {
+            sgPrepareResult = param1;
+            sem_post(&sgTrickSem);
+        } else if ( msg == Component::kEventSeekComplete ) {
+            sem_post(&sgTrickSem);
+        }
+    }
+};
+
+// plays the file at rate (in SCALED_PLAY_RATE units) to the end, seeks to seekMs and plays to the
+// end again: the second pass goes on from the seek target
+static void trickSeek(int32_t rate, int64_t seekMs, std::vector<int64_t> & before, std::vector<int64_t> & after)
+{
+    sem_init(&sgTrickSem, 0, 0);
+    PlaySourceComponent * source = createSource();
+    ASSERT_NE(source, NULL);
+    ASSERT_EQ(source->init(), MM_ERROR_SUCCESS);
+    source->setListener(Component::ListenerSP(new TrickListener()));
+
+    EXPECT_EQ(source->setUri(TEST_FILE), MM_ERROR_SUCCESS);
+    EXPECT_EQ(source->prepare(), MM_ERROR_ASYNC);
+    sem_wait(&sgTrickSem);
+    ASSERT_EQ(sgPrepareResult, MM_ERROR_SUCCESS);
+    ASSERT_TRUE(source->hasMedia(Component::kMediaTypeVideo));
+
+    int64_t durationMs = 0;
+    source->getDuration(durationMs);
+    MediaMetaSP meta = MediaMeta::create();
+    meta->setInt32(MEDIA_ATTR_PALY_RATE, rate);
+    EXPECT_EQ(source->setParameter(meta), MM_ERROR_SUCCESS);
+
+    TrickSink video(source);
+    video.start();
+    EXPECT_EQ(source->start(), MM_ERROR_SUCCESS);
+    EXPECT_TRUE(video.waitEOS(1));
+    before = video.takeDts();
+
+    EXPECT_EQ(source->seek(seekMs < 0 ? durationMs / 2 : seekMs, 1), MM_ERROR_ASYNC);
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += 10;
+    EXPECT_EQ(sem_timedwait(&sgTrickSem, &ts), 0);
+    EXPECT_TRUE(video.waitEOS(2));
+    after = video.takeDts();
+
+    source->stop();
+    video.stop();
+    source->reset();
+    source->uninit();
+    destroySource(source);
+    sem_destroy(&sgTrickSem);
+}
+
+// 8x (trick play for any video size): a seek back to the start plays the key frames from there again
+TEST_F(AvdemuxerTest, trickSeekForward) {
+    std::vector<int64_t> before, after;
+    trickSeek(SCALED_PLAY_RATE * 8, 0, before, after);
+
+    ASSERT_GE(before.size(), 2u);
+    ASSERT_GE(after.size(), 2u);
+    EXPECT_LT(after.front(), before.back());
+    for ( size_t i = 1; i < after.size(); ++i )
+        EXPECT_GT(after[i], after[i - 1]) << "buffer " << i;
+}
+
+// reverse: the first pass ends at the start, a seek to the middle plays backward from there
+TEST_F(AvdemuxerTest, trickSeekReverse) {
+    std::vector<int64_t> before, after;
+    trickSeek(-SCALED_PLAY_RATE * 8, -1, before, after);
+
+    ASSERT_GE(after.size(), 2u);
+    for ( size_t i = 1; i < after.size(); ++i )
+        EXPECT_LT(after[i], after[i - 1]) << "buffer " << i;
+}
@@ -15,8 +15,12 @@
  * limitations under the License.
  */
 
+#include <stdio.h>
 #include <unistd.h>
 #include <semaphore.h>
+#include <map>
+#include <vector>
+#include <string>
 
 #include <multimedia/mmthread.h>
 #include <multimedia/component.h>
@@ -731,6 +735,11 @@ protected:
 
     virtual void TearDown() {
     }
+
+    // libAVMuxer with one 320x240 MPEG4 video track in us feeding sink, NULL on failure.
+    // writer takes the frames of writeVideoFrames()
+    static Component * createVideoMuxer(Component * sink, void *& h, Component::WriterSP & writer);
+    static void runSegmenter(const char * format, const char * dir, int32_t partMs, std::string & live);
 };
 
 
@@ -792,3 +801,303 @@ init:
 }
 
 
+
+class CountingSink : public SinkComponent {
+public:
+    class CountingWriter : public Writer {
+    public:
+        CountingWriter(CountingSink * owner) : mOwner(owner) {}
+        virtual mm_status_t write(const MediaBufferSP & buffer) {
+            if ( buffer->isFlagSet(MediaBuffer::MBFT_EOS) ) {
+                mOwner->mEOS = true;
+            } else if ( buffer->size() > 0 ) {
+                mOwner->mBytes += buffer->size();
+            }
+            return MM_ERROR_SUCCESS;
+        }
+        virtual mm_status_t setMetaData(const MediaMetaSP & metaData) {return MM_ERROR_SUCCESS;}
+    private:
+        CountingSink * mOwner;
+    };
+
+    CountingSink() : mBytes(0), mEOS(false) {}
+    virtual const char * name() const { return "CountingSink"; }
+    COMPONENT_VERSION;
+    virtual WriterSP getWriter(MediaType mediaType) { return WriterSP(new CountingWriter(this)); }
+    virtual mm_status_t addSource(Component * component, MediaType mediaType) {return MM_ERROR_SUCCESS;}
+    virtual int64_t getCurrentPosition() {return -1ll;}
+
+    volatile int64_t mBytes;
+    volatile bool mEOS;
+};
+
+static void writeVideoFrames(Component::WriterSP & writer, int from, int to)
+{
+    static uint8_t data[4096];
+    for ( int i = from; i < to; i++ ) {
+        MediaBufferSP buffer = MediaBuffer::createMediaBuffer(MediaBuffer::MBT_ByteBuffer);
+        uintptr_t buffers = (uintptr_t)data;
+        int32_t offsets = 0;
+        int32_t strides = (i % 30) ? 1024 : 4096;
+        buffer->setBufferInfo(&buffers, &offsets, &strides, 1);
+        buffer->setSize(strides);
+        buffer->setPts(i * 33333ll);
+        buffer->setDts(i * 33333ll);
+        if ( i % 30 == 0 )
+            buffer->setFlag(MediaBuffer::MBFT_KeyFrame);
+        while ( writer->write(buffer) == MM_ERROR_AGAIN )
+            usleep(1000);
+    }
+}
+
+/*static */Component * AvmuxerTest::createVideoMuxer(Component * sink, void *& h, Component::WriterSP & writer)
+{
+    Component * muxer = createCompoent("libAVMuxer.so", h);
+    EXPECT_TRUE(muxer != NULL);
+    if ( !muxer )
+        return NULL;
+    muxer->setListener(Component::ListenerSP(new AVMuxerListener()));
+
+    writer = muxer->getWriter(Component::kMediaTypeVideo);
+    EXPECT_TRUE(writer);
+    if ( !writer ) {
+        releaseCompoent(h, muxer);
+        return NULL;
+    }
+    MediaMetaSP meta = MediaMeta::create();
+    uint8_t codecData[] = {0x00, 0x00, 0x01, 0xb0, 0x01};
+    meta->setInt32(MEDIA_ATTR_CODECID, kCodecIDMPEG4);
+    meta->setFraction(MEDIA_ATTR_TIMEBASE, 1, 1000000);
+    meta->setInt32(MEDIA_ATTR_WIDTH, 320);
+    meta->setInt32(MEDIA_ATTR_HEIGHT, 240);
+    meta->setByteBuffer(MEDIA_ATTR_CODEC_DATA, codecData, sizeof(codecData));
+    writer->setMetaData(meta);
+    EXPECT_EQ(muxer->addSink(sink, Component::kMediaTypeVideo), MM_ERROR_SUCCESS);
+    return muxer;
+}
+
+TEST_F(AvmuxerTest, preRollTest) {
+    sem_init(&sgSem, 0, 0);
+    CountingSink sink;
+    void * muxerH = NULL;
+    Component::WriterSP writer;
+    Component * muxer = createVideoMuxer(&sink, muxerH, writer);
+    ASSERT_TRUE(muxer != NULL);
+
+    MediaMetaSP param = MediaMeta::create();
+    param->setString(MEDIA_ATTR_OUTPUT_FORMAT, "mpegts");
+    param->setInt32(MEDIA_ATTR_PRE_ROLL_DURATION, 1000);
+    param->setInt32(MEDIA_ATTR_PRE_ROLL_MAX_BYTES, 1024 * 1024);
+    EXPECT_EQ(muxer->setParameter(param), MM_ERROR_SUCCESS);
+    EXPECT_EQ(muxer->start(), MM_ERROR_SUCCESS);
+
+    // 3 seconds kept in memory only
+    writeVideoFrames(writer, 0, 90);
+    usleep(200000);
+    EXPECT_EQ(sink.mBytes, 0);
+
+    MediaMetaSP trigger = MediaMeta::create();
+    trigger->setInt32(MEDIA_ATTR_PRE_ROLL_TRIGGER, 1);
+    EXPECT_EQ(muxer->setParameter(trigger), MM_ERROR_SUCCESS);
+    writeVideoFrames(writer, 90, 120);
+
+    MediaBufferSP eos = MediaBuffer::createMediaBuffer(MediaBuffer::MBT_ByteBuffer);
+    eos->setFlag(MediaBuffer::MBFT_EOS);
+    eos->setSize(0);
+    writer->write(eos);
+
+    if ( muxer->stop() == MM_ERROR_ASYNC )
+        sem_wait(&sgSem);
+    // the last 1-2 seconds before the trigger and the second after it, not the first second
+    EXPECT_GT(sink.mBytes, 60 * 1024);
+    EXPECT_LT(sink.mBytes, 120 * 1024);
+    EXPECT_TRUE(sink.mEOS);
+
+    muxer->reset();
+    sem_wait(&sgSem);
+    writer.reset();
+    releaseCompoent(muxerH, muxer);
+    sem_destroy(&sgSem);
+}
+
+class SegmentSink : public SinkComponent {
+public:
+    class SegmentWriter : public Writer {
+    public:
+        SegmentWriter(SegmentSink * owner) : mOwner(owner) {}
+        virtual mm_status_t write(const MediaBufferSP & buffer) {
+            MMAutoLock lock(mOwner->mLock);
+            int32_t index = -1;
+            int32_t end = 0;
+            buffer->getMediaMeta()->getInt32(MEDIA_ATTR_SEGMENT_INDEX, index);
+            if ( buffer->isFlagSet(MediaBuffer::MBFT_EOS) ) {
+                mOwner->mEOS = true;
+            } else if ( buffer->getMediaMeta()->getInt32(MEDIA_ATTR_SEGMENT_END, end) && end ) {
+                mOwner->mEnded.push_back(index);
+            } else if ( buffer->size() > 0 ) {
+                mOwner->mBytes[index] += buffer->size();
+            }
+            return MM_ERROR_SUCCESS;
+        }
+        virtual mm_status_t setMetaData(const MediaMetaSP & metaData) {return MM_ERROR_SUCCESS;}
+    private:
+        SegmentSink * mOwner;
+    };
+
+    SegmentSink() : mEOS(false) {}
+    virtual const char * name() const { return "SegmentSink"; }
+    COMPONENT_VERSION;
+    virtual WriterSP getWriter(MediaType mediaType) { return WriterSP(new SegmentWriter(this)); }
+    virtual mm_status_t addSource(Component * component, MediaType mediaType) {return MM_ERROR_SUCCESS;}
+    virtual int64_t getCurrentPosition() {return -1ll;}
+
+    Lock mLock;
+    std::map<int32_t, int64_t> mBytes;
+    std::vector<int32_t> mEnded;
+    bool mEOS;
+};
+
+TEST_F(AvmuxerTest, fileRotationTest) {
+    sem_init(&sgSem, 0, 0);
+    SegmentSink sink;
+    void * muxerH = NULL;
+    Component::WriterSP writer;
+    Component * muxer = createVideoMuxer(&sink, muxerH, writer);
+    ASSERT_TRUE(muxer != NULL);
+
+    MediaMetaSP param = MediaMeta::create();
+    param->setString(MEDIA_ATTR_OUTPUT_FORMAT, "mpegts");
+    param->setInt64(MEDIA_ATTR_MAX_DURATION, 1000);
+    param->setInt32(MEDIA_ATTR_FILE_ROTATION, 1);
+    EXPECT_EQ(muxer->setParameter(param), MM_ERROR_SUCCESS);
+    EXPECT_EQ(muxer->start(), MM_ERROR_SUCCESS);
+
+    // key frames every second: each one starts the next file
+    writeVideoFrames(writer, 0, 100);
+
+    MediaBufferSP eos = MediaBuffer::createMediaBuffer(MediaBuffer::MBT_ByteBuffer);
+    eos->setFlag(MediaBuffer::MBFT_EOS);
+    eos->setSize(0);
+    writer->write(eos);
+
+    if ( muxer->stop() == MM_ERROR_ASYNC )
+        sem_wait(&sgSem);
+    // frames 0-29, 30-59, 60-89 and 90-99, the first three files are finished before EOS
+    EXPECT_EQ(sink.mBytes.size(), 4u);
+    for ( int32_t i = 0; i < 4; i++ )
+        EXPECT_GT(sink.mBytes[i], 0) << "file " << i;
+    EXPECT_LT(sink.mBytes[3], sink.mBytes[2]);
+    ASSERT_EQ(sink.mEnded.size(), 3u);
+    for ( int32_t i = 0; i < 3; i++ )
+        EXPECT_EQ(sink.mEnded[i], i);
+    EXPECT_TRUE(sink.mEOS);
+
+    muxer->reset();
+    sem_wait(&sgSem);
+    writer.reset();
+    releaseCompoent(muxerH, muxer);
+    sem_destroy(&sgSem);
+}
+
+static std::string readTextFile(const char * path)
+{
+    std::string text;
+    FILE * f = fopen(path, "r");
+    if ( !f )
+        return text;
+    char buf[1024];
+    size_t n;
+    while ( (n = fread(buf, 1, sizeof(buf), f)) > 0 )
+        text.append(buf, n);
+    fclose(f);
+    return text;
+}
+
+// 300 frames (10 s) with key frames every second into SegmenterSink, live is the playlist
+// before the eos: the parts are only listed while the playlist is live
+/*static */void AvmuxerTest::runSegmenter(const char * format, const char * dir, int32_t partMs, std::string & live)
+{
+    sem_init(&sgSem, 0, 0);
+    void * sinkH = NULL;
+    Component * sink = createCompoent("libSegmenterSink.so", sinkH);
+    ASSERT_TRUE(sink != NULL);
+    void * muxerH = NULL;
+    Component::WriterSP writer;
+    Component * muxer = createVideoMuxer(sink, muxerH, writer);
+    ASSERT_TRUE(muxer != NULL);
+
+    MediaMetaSP param = MediaMeta::create();
+    param->setString(MEDIA_ATTR_OUTPUT_FORMAT, format);
+    param->setString(MEDIA_ATTR_FILE_PATH, dir);
+    param->setInt32(MEDIA_ATTR_SEGMENT_DURATION, 2000);
+    if ( partMs > 0 )
+        param->setInt32(MEDIA_ATTR_SEGMENT_PART_DURATION, partMs);
+    param->setInt32(MEDIA_ATTR_SEGMENT_LIST_SIZE, 3);
+    EXPECT_EQ(muxer->setParameter(param), MM_ERROR_SUCCESS);
+    EXPECT_EQ(sink->setParameter(param), MM_ERROR_SUCCESS);
+    EXPECT_EQ(sink->start(), MM_ERROR_SUCCESS);
+    EXPECT_EQ(muxer->start(), MM_ERROR_SUCCESS);
+
+    writeVideoFrames(writer, 0, 300);
+
+    // the muxer writes on its own thread, wait for the last segment (9 s) to be listed
+    std::string playlist = std::string(dir) + "/index.m3u8";
+    const char * last = partMs > 0 ? "seg_3." : NULL;
+    for ( int i = 0; i < 200; i++ ) {
+        live = readTextFile(playlist.c_str());
+        if ( !last || live.find(last) != std::string::npos )
+            break;
+        usleep(10000);
+    }
+
+    MediaBufferSP eos = MediaBuffer::createMediaBuffer(MediaBuffer::MBT_ByteBuffer);
+    eos->setFlag(MediaBuffer::MBFT_EOS);
+    eos->setSize(0);
+    writer->write(eos);
+
+    if ( muxer->stop() == MM_ERROR_ASYNC )
+        sem_wait(&sgSem);
+    sink->stop();
+
+    muxer->reset();
+    sem_wait(&sgSem);
+    sink->reset();
+    writer.reset();
+    releaseCompoent(muxerH, muxer);
+    releaseCompoent(sinkH, sink);
+    sem_destroy(&sgSem);
+}
+
+TEST_F(AvmuxerTest, segmenterTest) {
+    // key frames every second: segments start at 0, 3, 6 and 9 seconds
+    std::string live;
+    runSegmenter("hls", "/tmp/avmuxer_segments", 0, live);
+
+    std::string playlist = readTextFile("/tmp/avmuxer_segments/index.m3u8");
+    EXPECT_NE(playlist.find("#EXT-X-MEDIA-SEQUENCE:1\n"), std::string::npos);
+    EXPECT_NE(playlist.find("seg_3.ts"), std::string::npos);
+    EXPECT_EQ(playlist.find("seg_0.ts"), std::string::npos);
+    EXPECT_NE(playlist.find("#EXT-X-ENDLIST"), std::string::npos);
+    EXPECT_EQ(access("/tmp/avmuxer_segments/seg_0.ts", F_OK), 0);
+
+    // fMP4 with low latency parts: init segment, DASH manifest and byte range parts
+    runSegmenter("dash", "/tmp/avmuxer_segments_fmp4", 500, live);
+
+    EXPECT_NE(live.find("#EXT-X-PART-INF:PART-TARGET="), std::string::npos);
+    EXPECT_NE(live.find("#EXT-X-PART:DURATION="), std::string::npos);
+    EXPECT_NE(live.find("URI=\"seg_3.m4s\",BYTERANGE="), std::string::npos);
+    EXPECT_NE(live.find(",INDEPENDENT=YES"), std::string::npos);
+    EXPECT_NE(live.find("#EXT-X-MAP:URI=\"init.mp4\""), std::string::npos);
+
+    playlist = readTextFile("/tmp/avmuxer_segments_fmp4/index.m3u8");
+    EXPECT_NE(playlist.find("seg_3.m4s"), std::string::npos);
+    EXPECT_EQ(playlist.find("#EXT-X-PART:"), std::string::npos);
+    EXPECT_NE(playlist.find("#EXT-X-ENDLIST"), std::string::npos);
+    EXPECT_EQ(access("/tmp/avmuxer_segments_fmp4/init.mp4", F_OK), 0);
+    EXPECT_EQ(access("/tmp/avmuxer_segments_fmp4/seg_0.m4s", F_OK), 0);
+
+    std::string manifest = readTextFile("/tmp/avmuxer_segments_fmp4/manifest.mpd");
+    EXPECT_NE(manifest.find("<MPD "), std::string::npos);
+    EXPECT_NE(manifest.find("initialization=\"init.mp4\""), std::string::npos);
+    EXPECT_NE(manifest.find("media=\"seg_$Number$.m4s\""), std::string::npos);
+}
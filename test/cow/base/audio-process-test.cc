@@ -0,0 +1,175 @@
+/**
+ * Copyright (C) 2017 Alibaba Group Holding Limited. All Rights Reserved.
+ *
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <gtest/gtest.h>
+
+#include <multimedia/mm_debug.h>
+#include <multimedia/mm_errors.h>
+#include <multimedia/media_buffer.h>
+
+#include <audio_process.h>
+
+MM_LOG_DEFINE_MODULE_NAME("audio-process-test");
+
+using namespace YUNOS_MM;
+
+static const int32_t kFrames = 1027; // not a multiple of the SIMD width
+
+class AudioProcessTest : public testing::Test {
+protected:
+    virtual void SetUp() {
+    }
+
+    virtual void TearDown() {
+    }
+};
+
+TEST_F(AudioProcessTest, kernelRoundTrip) {
+    std::vector<int16_t> src(kFrames * 2), dst(kFrames * 2);
+    std::vector<float> f(kFrames * 2);
+    for (int32_t i = 0; i < kFrames * 2; i++) {
+        src[i] = (int16_t)((i * 37) % 65536 - 32768);
+    }
+
+    AudioKernels::s16ToF32(&src[0], &f[0], kFrames * 2);
+    AudioKernels::f32ToS16(&f[0], &dst[0], kFrames * 2);
+    EXPECT_EQ(0, memcmp(&src[0], &dst[0], src.size() * sizeof(int16_t)));
+
+    std::vector<float> l(kFrames), r(kFrames);
+    float *planes[2] = { &l[0], &r[0] };
+    AudioKernels::deinterleaveS16ToF32(&src[0], planes, 2, kFrames);
+    memset(&dst[0], 0, dst.size() * sizeof(int16_t));
+    AudioKernels::interleaveF32ToS16(planes, &dst[0], 2, kFrames);
+    EXPECT_EQ(0, memcmp(&src[0], &dst[0], src.size() * sizeof(int16_t)));
+}
+
+TEST_F(AudioProcessTest, gainSaturates) {
+    std::vector<int16_t> data(kFrames, 30000);
+    AudioKernels::applyGainS16(&data[0], kFrames, 2.0f);
+    for (int32_t i = 0; i < kFrames; i++) {
+        ASSERT_EQ(32767, data[i]);
+    }
+}
+
+TEST_F(AudioProcessTest, processorDownmix) {
+    AudioProcessor processor("audio-process-test");
+    ASSERT_EQ(MM_ERROR_SUCCESS, processor.configure(SND_FORMAT_PCM_FLOAT, 6, SND_FORMAT_PCM_16_BIT, 2));
+    EXPECT_FALSE(processor.isPassThrough());
+
+    AudioBufferPoolSP pool = AudioBufferPool::create("audio-process-test");
+    int32_t size = kFrames * 6 * sizeof(float);
+    uint8_t *data = NULL;
+    MediaBufferSP in = pool->getBuffer(size, &data);
+    ASSERT_TRUE(in && data);
+    float *samples = (float*)data;
+    for (int32_t i = 0; i < kFrames * 6; i++) {
+        samples[i] = 0.25f;
+    }
+    in->setBufferInfo((uintptr_t*)&data, NULL, &size, 1);
+    in->setSize(size);
+    in->setPts(1234);
+
+    MediaBufferSP out = processor.process(in);
+    ASSERT_TRUE(out);
+    EXPECT_EQ(1234, out->pts());
+
+    uint8_t *outData = NULL;
+    int32_t outSize = 0;
+    ASSERT_TRUE(out->getBufferInfo((uintptr_t*)&outData, NULL, &outSize, 1));
+    ASSERT_EQ(kFrames * 2 * (int32_t)sizeof(int16_t), outSize);
+    int16_t *pcm = (int16_t*)outData;
+    for (int32_t i = 0; i < kFrames * 2; i++) {
+        ASSERT_GT(pcm[i], 0);
+    }
+}
+
+TEST_F(AudioProcessTest, poolOutlivedByBuffer) {
+    MediaBufferSP buffer;
+    {
+        AudioBufferPoolSP pool = AudioBufferPool::create("audio-process-test", 2);
+        uint8_t *data = NULL;
+        buffer = pool->getBuffer(4096, &data);
+        ASSERT_TRUE(buffer && data);
+        memset(data, 0, 4096);
+    }
+    // the chunk is freed on release now that the pool is gone
+    buffer.reset();
+}
+
+TEST_F(AudioProcessTest, mixWithGain) {
+    std::vector<int16_t> a(kFrames, 8000), b(kFrames, -4000);
+    std::vector<float> bus(kFrames, 0.0f);
+    AudioKernels::mixS16ToF32(&a[0], &bus[0], kFrames, 1.0f);
+    AudioKernels::mixS16ToF32(&b[0], &bus[0], kFrames, 0.5f);
+
+    std::vector<float> c(kFrames, 0.25f);
+    AudioKernels::mixF32(&c[0], &bus[0], kFrames, 2.0f);
+
+    std::vector<int16_t> out(kFrames);
+    AudioKernels::f32ToS16(&bus[0], &out[0], kFrames);
+    for (int32_t i = 0; i < kFrames; i++) {
+        // 8000 + (-4000 * 0.5) + (0.25 * 2.0 * 32768)
+        ASSERT_NEAR(22384, out[i], 1);
+    }
+}
+
+TEST_F(AudioProcessTest, processorOffset) {
+    AudioProcessor processor("audio-process-test");
+    ASSERT_EQ(MM_ERROR_SUCCESS, processor.configure(SND_FORMAT_PCM_16_BIT, 2, SND_FORMAT_PCM_FLOAT, 2));
+
+    AudioBufferPoolSP pool = AudioBufferPool::create("audio-process-test");
+    const int32_t skip = 64;
+    int32_t size = kFrames * 2 * sizeof(int16_t);
+    uint8_t *data = NULL;
+    MediaBufferSP in = pool->getBuffer(size + skip, &data);
+    ASSERT_TRUE(in && data);
+    int16_t *pcm = (int16_t*)(data + skip);
+    for (int32_t i = 0; i < kFrames * 2; i++) {
+        pcm[i] = (int16_t)(i - kFrames);
+    }
+    // the payload starts at offset, size is its length
+    int32_t offset = skip;
+    in->setBufferInfo((uintptr_t*)&data, &offset, &size, 1);
+    in->setSize(size);
+
+    MediaBufferSP out = processor.process(in);
+    ASSERT_TRUE(out);
+    uint8_t *outData = NULL;
+    int32_t outSize = 0;
+    ASSERT_TRUE(out->getBufferInfo((uintptr_t*)&outData, NULL, &outSize, 1));
+    ASSERT_EQ(kFrames * 2 * (int32_t)sizeof(float), outSize);
+    float *samples = (float*)outData;
+    for (int32_t i = 0; i < kFrames * 2; i++) {
+        ASSERT_FLOAT_EQ((i - kFrames) / 32768.0f, samples[i]);
+    }
+}
+
+TEST_F(AudioProcessTest, f32ToS16Rounds) {
+    std::vector<float> f(kFrames);
+    std::vector<int16_t> out(kFrames);
+    for (int32_t i = 0; i < kFrames; i++) {
+        // +-(n + 0.75) / 32768, truncating would give +-n
+        f[i] = ((i & 1) ? -1.0f : 1.0f) * (i + 0.75f) / 32768.0f;
+    }
+    AudioKernels::f32ToS16(&f[0], &out[0], kFrames);
+    for (int32_t i = 0; i < kFrames; i++) {
+        ASSERT_EQ(((i & 1) ? -1 : 1) * (i + 1), out[i]);
+    }
+}
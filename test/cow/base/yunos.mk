@@ -33,6 +33,20 @@ LOCAL_MODULE := clock-test
 include $(BUILD_EXECUTABLE)
 
 
+#### audio-process-test
+include $(CLEAR_VARS)
+include $(MM_ROOT_PATH)/cow/build/cow_common.mk
+include $(MM_ROOT_PATH)/test/gtest_common.mk
+
+LOCAL_SRC_FILES := audio-process-test.cc
+
+LOCAL_LDFLAGS += -lpthread -lstdc++
+LOCAL_SHARED_LIBRARIES += libcowbase
+LOCAL_MODULE := audio-process-test
+
+include $(BUILD_EXECUTABLE)
+
+
 #### buffer-test
 include $(CLEAR_VARS)
 include $(MM_ROOT_PATH)/cow/build/cow_common.mk
@@ -21,6 +21,7 @@ all:
 	make -C base -f factory_test.mk
 	make -C base -f buffer_test.mk
 	make -C base -f clock_test.mk
+	make -C base -f audio_process_test.mk
 	make -C base -f meta_test.mk
 	make -C base -f monitor_test.mk
 	make -C recorder -f cowrecorder_test.mk
@@ -29,6 +30,11 @@ all:
 	make -C video-ffmpeg -f video_ffmpeg_dtest.mk
 	make -C video-ffmpeg -f video_ffmpeg_etest.mk
 	make -C rtpmuxer -f rtpmuxer_test.mk
+	make -C audio-mixer -f audio_mixer_test.mk
+	make -C media-fission -f media_fission_test.mk
+ifeq ($(USING_V4L2CODEC_SOFT),1)
+	make -C video-v4l2 -f video_v4l2_test.mk
+endif
 
 clean:
 	make clean -C avmuxer -f avmuxer_test.mk
@@ -36,6 +42,7 @@ clean:
 	make clean -C base -f factory_test.mk
 	make clean -C base -f buffer_test.mk
 	make clean -C base -f clock_test.mk
+	make clean -C base -f audio_process_test.mk
 	make clean -C base -f meta_test.mk
 	make clean -C base -f monitor_test.mk
 	make clean -C recorder -f cowrecorder_test.mk
@@ -44,6 +51,11 @@ clean:
 	make clean -C video-ffmpeg -f video_ffmpeg_dtest.mk
 	make clean -C video-ffmpeg -f video_ffmpeg_etest.mk
 	make clean -C rtpmuxer -f rtpmuxer_test.mk
+	make clean -C audio-mixer -f audio_mixer_test.mk
+	make clean -C media-fission -f media_fission_test.mk
+ifeq ($(USING_V4L2CODEC_SOFT),1)
+	make clean -C video-v4l2 -f video_v4l2_test.mk
+endif
 
 install:
 	make install -C avmuxer -f avmuxer_test.mk
@@ -51,6 +63,7 @@ install:
 	make install -C base -f factory_test.mk
 	make install -C base -f buffer_test.mk
 	make install -C base -f clock_test.mk
+	make install -C base -f audio_process_test.mk
 	make install -C base -f meta_test.mk
 	make install -C base -f monitor_test.mk
 	make install -C recorder -f cowrecorder_test.mk
@@ -59,3 +72,8 @@ install:
 	make install -C video-ffmpeg -f video_ffmpeg_dtest.mk
 	make install -C video-ffmpeg -f video_ffmpeg_etest.mk
 	make install -C rtpmuxer -f rtpmuxer_test.mk
+	make install -C audio-mixer -f audio_mixer_test.mk
+	make install -C media-fission -f media_fission_test.mk
+ifeq ($(USING_V4L2CODEC_SOFT),1)
+	make install -C video-v4l2 -f video_v4l2_test.mk
+endif
@@ -0,0 +1,213 @@
+/**
+ * Copyright (C) 2017 Alibaba Group Holding Limited. All Rights Reserved.
+ *
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <map>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include <multimedia/mm_debug.h>
+#include <multimedia/mm_errors.h>
+#include <multimedia/mm_cpp_utils.h>
+#include <multimedia/media_buffer.h>
+#include <multimedia/media_attr_str.h>
+
+#include "components/media_fission.h"
+
+MM_LOG_DEFINE_MODULE_NAME("media-fission-test");
+
+using namespace YUNOS_MM;
+
+static const int64_t kTimeoutUs = 10 * 1000000ll;
+static const int32_t kFrames = 200;
+static const int32_t kGop = 30;
+static const int64_t kFrameUs = 33333;
+
+// keeps the result of every event, waitResult() blocks until it comes
+class EventListener : public Component::Listener {
+  public:
+    EventListener() : mCond(mLock) {}
+    virtual void onMessage(int msg, int param1, int param2, const MMParamSP obj, const Component * sender) {
+        MMAutoLock locker(mLock);
+        mResults[msg] = param1;
+        mCond.broadcast();
+    }
+
+    // the result of an async call
+    mm_status_t waitResult(mm_status_t status, int msg) {
+        if (status != MM_ERROR_ASYNC)
+            return status;
+        MMAutoLock locker(mLock);
+        int64_t deadlineUs = getTimeUs() + kTimeoutUs;
+        while (mResults.find(msg) == mResults.end()) {
+            int64_t leftUs = deadlineUs - getTimeUs();
+            if (leftUs <= 0)
+                return MM_ERROR_TIMED_OUT;
+            mCond.timedWait(leftUs);
+        }
+        mm_status_t result = (mm_status_t)mResults[msg];
+        mResults.erase(msg);
+        return result;
+    }
+
+  private:
+    Lock mLock;
+    Condition mCond;
+    std::map<int, int> mResults;
+};
+
+// records the pts and flags of every buffer, a slow sink sleeps in write()
+class RecordSink : public SinkComponent {
+  public:
+    struct Record {
+        int64_t pts;
+        bool keyFrame;
+        bool eos;
+    };
+
+    class RecordWriter : public Writer {
+      public:
+        RecordWriter(RecordSink *sink) : mSink(sink) {}
+        virtual mm_status_t write(const MediaBufferSP &buffer) {
+            if (mSink->mDelayUs)
+                usleep(mSink->mDelayUs);
+            Record record = { buffer->pts(), buffer->isFlagSet(MediaBuffer::MBFT_KeyFrame),
+                buffer->isFlagSet(MediaBuffer::MBFT_EOS) };
+            MMAutoLock locker(mSink->mLock);
+            mSink->mRecords.push_back(record);
+            return MM_ERROR_SUCCESS;
+        }
+        virtual mm_status_t setMetaData(const MediaMetaSP &metaData) { return MM_ERROR_SUCCESS; }
+      private:
+        RecordSink *mSink;
+    };
+
+    RecordSink(int64_t delayUs) : mDelayUs(delayUs) {}
+    virtual const char * name() const { return "RecordSink"; }
+    COMPONENT_VERSION;
+    virtual WriterSP getWriter(MediaType mediaType) { return WriterSP(new RecordWriter(this)); }
+    virtual mm_status_t addSource(Component * component, MediaType mediaType) { return MM_ERROR_SUCCESS; }
+    virtual int64_t getCurrentPosition() { return 0; }
+
+    bool gotEOS() {
+        MMAutoLock locker(mLock);
+        return !mRecords.empty() && mRecords.back().eos;
+    }
+
+    int64_t mDelayUs;
+    Lock mLock;
+    std::vector<Record> mRecords;
+};
+
+class MediaFissionTest : public testing::Test {
+protected:
+    virtual void SetUp() {
+    }
+
+    virtual void TearDown() {
+    }
+};
+
+// a fast blocking output and a slow dropping one (queue of 3): the fast output gets every
+// buffer, the slow one drops and resumes at the next key frame
+TEST_F(MediaFissionTest, blockingAndDroppingOutputs) {
+    MediaFission fission("video/avc");
+    EventListener *events = new EventListener();
+    Component::ListenerSP listener(events);
+    fission.setListener(listener);
+    ASSERT_EQ(MM_ERROR_SUCCESS, fission.init());
+
+    Component::WriterSP input = fission.getWriter(Component::kMediaTypeVideo);
+    ASSERT_TRUE(input);
+    MediaMetaSP meta = MediaMeta::create();
+    meta->setInt32(MEDIA_ATTR_WIDTH, 320);
+    meta->setInt32(MEDIA_ATTR_HEIGHT, 240);
+    input->setMetaData(meta);
+
+    RecordSink fast(0);
+    RecordSink slow(20000);
+    ASSERT_EQ(MM_ERROR_SUCCESS, fission.addSink(&fast, Component::kMediaTypeVideo));
+    MediaMetaSP param = MediaMeta::create();
+    param->setInt32(MEDIA_ATTR_OUTPUT_DROP, 1);
+    param->setInt32(MEDIA_ATTR_OUTPUT_QUEUE_SIZE, 3);
+    ASSERT_EQ(MM_ERROR_SUCCESS, fission.setParameter(param));
+    ASSERT_EQ(MM_ERROR_SUCCESS, fission.addSink(&slow, Component::kMediaTypeVideo));
+
+    ASSERT_EQ(MM_ERROR_SUCCESS, events->waitResult(fission.prepare(), Component::kEventPrepareResult));
+    ASSERT_EQ(MM_ERROR_SUCCESS, events->waitResult(fission.start(), Component::kEventStartResult));
+
+    // 2 ms per frame, ten times faster than the slow output
+    static uint8_t data[16];
+    for (int32_t i = 0; i < kFrames; i++) {
+        MediaBufferSP buffer = MediaBuffer::createMediaBuffer(MediaBuffer::MBT_ByteBuffer);
+        uintptr_t buffers = (uintptr_t)data;
+        int32_t offsets = 0;
+        int32_t strides = sizeof(data);
+        buffer->setBufferInfo(&buffers, &offsets, &strides, 1);
+        buffer->setSize(sizeof(data));
+        buffer->setPts(i * kFrameUs);
+        buffer->setDts(i * kFrameUs);
+        if (i % kGop == 0)
+            buffer->setFlag(MediaBuffer::MBFT_KeyFrame);
+        while (input->write(buffer) == MM_ERROR_AGAIN)
+            usleep(1000);
+        usleep(2000);
+    }
+    MediaBufferSP eos = MediaBuffer::createMediaBuffer(MediaBuffer::MBT_ByteBuffer);
+    eos->setFlag(MediaBuffer::MBFT_EOS);
+    eos->setSize(0);
+    while (input->write(eos) == MM_ERROR_AGAIN)
+        usleep(1000);
+
+    for (int32_t retry = 0; retry < 500 && !(fast.gotEOS() && slow.gotEOS()); retry++)
+        usleep(10000);
+
+    // tear down before checking, the push threads must not outlive a failed assertion
+    EXPECT_EQ(MM_ERROR_SUCCESS, events->waitResult(fission.stop(), Component::kEventStopped));
+    EXPECT_EQ(MM_ERROR_SUCCESS, events->waitResult(fission.reset(), Component::kEventResetComplete));
+    input.reset();
+    fission.uninit();
+
+    // every frame and the eos
+    ASSERT_EQ((size_t)kFrames + 1, fast.mRecords.size());
+    for (int32_t i = 0; i < kFrames; i++)
+        ASSERT_EQ(i * kFrameUs, fast.mRecords[i].pts) << "frame " << i;
+    EXPECT_TRUE(fast.mRecords.back().eos);
+
+    // the eos is never dropped, the first frame of every gap is a key frame
+    ASSERT_TRUE(slow.gotEOS());
+    int32_t received = slow.mRecords.size() - 1;
+    int32_t dropped = kFrames - received;
+    EXPECT_GT(received, 0);
+    EXPECT_GT(dropped, kFrames / 2);
+    int32_t gaps = 0;
+    int64_t nextPts = 0;
+    for (int32_t i = 0; i < received; i++) {
+        const RecordSink::Record & record = slow.mRecords[i];
+        ASSERT_GE(record.pts, nextPts);
+        if (record.pts != nextPts) {
+            EXPECT_TRUE(record.keyFrame) << "pts " << record.pts;
+            EXPECT_EQ(0, record.pts / kFrameUs % kGop) << "pts " << record.pts;
+            gaps++;
+        }
+        nextPts = record.pts + kFrameUs;
+    }
+    EXPECT_GT(gaps, 0);
+}
@@ -0,0 +1,595 @@
+/**
+ * Copyright (C) 2017 Alibaba Group Holding Limited. All Rights Reserved.
+ *
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <list>
+#include <map>
+#include <string>
+#include <gtest/gtest.h>
+
+#include <multimedia/mm_debug.h>
+#include <multimedia/mm_errors.h>
+#include <multimedia/mm_cpp_utils.h>
+#include <multimedia/media_buffer.h>
+#include <multimedia/media_attr_str.h>
+
+#include "components/av_demuxer.h"
+#include "components/video_decode_v4l2.h"
+#include "components/video_encode_v4l2.h"
+
+MM_LOG_DEFINE_MODULE_NAME("video-v4l2-test");
+
+using namespace YUNOS_MM;
+
+#ifndef __MM_NATIVE_BUILD__
+static const char * TEST_FILE = "/usr/bin/ut/res/video/test.mp4";
+#else
+static const char * TEST_FILE = "./ut/res/test.mp4";
+#endif
+static const int64_t kTimeoutUs = 60 * 1000000ll;
+static const int32_t kFrames = 30;    // handed to the encoder, the rest of the file is dropped
+static const size_t kMaxQueued = 4;
+
+// keeps the result of every event, waitEvent() blocks until it comes
+class EventListener : public Component::Listener {
+  public:
+    EventListener() : mCond(mLock), mError(MM_ERROR_SUCCESS) {}
+    virtual void onMessage(int msg, int param1, int param2, const MMParamSP obj, const Component * sender) {
+        MMAutoLock locker(mLock);
+        if (msg == Component::kEventError)
+            mError = param1;
+        mResults[msg] = param1;
+        mCond.broadcast();
+    }
+
+    // the result of an async call
+    mm_status_t waitResult(mm_status_t status, int msg) {
+        if (status != MM_ERROR_ASYNC)
+            return status;
+        MMAutoLock locker(mLock);
+        int64_t deadlineUs = getTimeUs() + kTimeoutUs;
+        while (mResults.find(msg) == mResults.end()) {
+            int64_t leftUs = deadlineUs - getTimeUs();
+            if (leftUs <= 0)
+                return MM_ERROR_TIMED_OUT;
+            mCond.timedWait(leftUs);
+        }
+        return (mm_status_t)mResults[msg];
+    }
+
+    int error() {
+        MMAutoLock locker(mLock);
+        return mError;
+    }
+
+  private:
+    Lock mLock;
+    Condition mCond;
+    std::map<int, int> mResults;
+    int mError;
+};
+
+/*
+ * sink of the decoder and source of the encoder: the decoded NV12 frames, dma-buf or raw, are
+ * copied to packed NV12 and go to the encoder the way VideoTestSource hands them over, as the
+ * address of the frame. the first kFrames frames are passed, then EOS.
+ */
+class FrameBridge : public FilterComponent {
+  public:
+    class BridgeWriter : public Writer {
+      public:
+        BridgeWriter(FrameBridge *bridge) : mBridge(bridge) {}
+        virtual mm_status_t write(const MediaBufferSP &buffer) { return mBridge->push(buffer); }
+        virtual mm_status_t setMetaData(const MediaMetaSP &metaData) {
+            MMAutoLock locker(mBridge->mLock);
+            metaData->getInt32(MEDIA_ATTR_WIDTH, mBridge->mWidth);
+            metaData->getInt32(MEDIA_ATTR_HEIGHT, mBridge->mHeight);
+            mBridge->mFormat->setInt32(MEDIA_ATTR_WIDTH, mBridge->mWidth);
+            mBridge->mFormat->setInt32(MEDIA_ATTR_HEIGHT, mBridge->mHeight);
+            return MM_ERROR_SUCCESS;
+        }
+      private:
+        FrameBridge *mBridge;
+    };
+
+    class BridgeReader : public Reader {
+      public:
+        BridgeReader(FrameBridge *bridge) : mBridge(bridge) {}
+        virtual mm_status_t read(MediaBufferSP &buffer) { return mBridge->pop(buffer); }
+        virtual MediaMetaSP getMetaData() {
+            MMAutoLock locker(mBridge->mLock);
+            return mBridge->mFormat;
+        }
+      private:
+        FrameBridge *mBridge;
+    };
+
+    FrameBridge()
+        : mCond(mLock)
+        , mWidth(0)
+        , mHeight(0)
+        , mFrames(0)
+        , mDmaBufFrames(0)
+        , mBadFrames(0)
+        , mEOS(false)
+    {
+        mFormat = MediaMeta::create();
+        mFormat->setInt32(MEDIA_ATTR_COLOR_FOURCC, 'NV12');
+        mFormat->setInt32(MEDIA_META_BUFFER_TYPE, MediaBuffer::MBT_RawVideo);
+    }
+
+    virtual const char * name() const { return "FrameBridge"; }
+    COMPONENT_VERSION;
+    virtual ReaderSP getReader(MediaType mediaType) { return ReaderSP(new BridgeReader(this)); }
+    virtual WriterSP getWriter(MediaType mediaType) { return WriterSP(new BridgeWriter(this)); }
+    virtual mm_status_t addSource(Component * component, MediaType mediaType) { return MM_ERROR_SUCCESS; }
+    virtual mm_status_t addSink(Component * component, MediaType mediaType) { return MM_ERROR_SUCCESS; }
+
+    mm_status_t push(const MediaBufferSP &buffer) {
+        MMAutoLock locker(mLock);
+        if (mEOS)
+            return MM_ERROR_SUCCESS;
+        if (buffer->isFlagSet(MediaBuffer::MBFT_EOS) && buffer->size() == 0) {
+            queueEOS_l();
+            return MM_ERROR_SUCCESS;
+        }
+
+        // the decoder waits for room, its output buffers go back as soon as they are copied
+        int64_t deadlineUs = getTimeUs() + kTimeoutUs;
+        while (mQueue.size() >= kMaxQueued && getTimeUs() < deadlineUs)
+            mCond.timedWait(deadlineUs - getTimeUs());
+
+        MediaBufferSP frame = copyFrame_l(buffer);
+        if (!frame) {
+            mBadFrames++;
+            return MM_ERROR_SUCCESS;
+        }
+        mQueue.push_back(frame);
+        if (++mFrames == kFrames || buffer->isFlagSet(MediaBuffer::MBFT_EOS))
+            queueEOS_l();
+        mCond.broadcast();
+        return MM_ERROR_SUCCESS;
+    }
+
+    mm_status_t pop(MediaBufferSP &buffer) {
+        MMAutoLock locker(mLock);
+        if (mQueue.empty())
+            return MM_ERROR_AGAIN;
+        buffer = mQueue.front();
+        mQueue.pop_front();
+        mCond.broadcast();
+        return MM_ERROR_SUCCESS;
+    }
+
+    Lock mLock;
+    Condition mCond;
+    MediaMetaSP mFormat;
+    int32_t mWidth;
+    int32_t mHeight;
+    int32_t mFrames;
+    int32_t mDmaBufFrames;
+    int32_t mBadFrames;    // planes that can't be mapped, strides narrower than the width
+    bool mEOS;
+    std::list<MediaBufferSP> mQueue;
+
+  private:
+    static bool releaseFrame(MediaBuffer *buffer) {
+        uint8_t *data = NULL;
+        if (!buffer->getBufferInfo((uintptr_t*)&data, NULL, NULL, 1))
+            return false;
+        delete [] data;
+        return true;
+    }
+
+    void queueEOS_l() {
+        MediaBufferSP eos = MediaBuffer::createMediaBuffer(MediaBuffer::MBT_RawVideo);
+        eos->setFlag(MediaBuffer::MBFT_EOS);
+        eos->setSize(0);
+        mQueue.push_back(eos);
+        mEOS = true;
+        mCond.broadcast();
+    }
+
+    MediaBufferSP copyFrame_l(const MediaBufferSP &buffer) {
+        int32_t width = mWidth, height = mHeight;
+        MediaMetaSP meta = buffer->getMediaMeta();
+        if (meta) {
+            meta->getInt32(MEDIA_ATTR_WIDTH, width);
+            meta->getInt32(MEDIA_ATTR_HEIGHT, height);
+        }
+        int32_t rows[2] = {height, (height + 1) / 2};
+        int32_t frameSize = width * (rows[0] + rows[1]);
+        uint8_t *data = new uint8_t[sizeof(uintptr_t) + frameSize];
+        uint8_t *frame = data + sizeof(uintptr_t);
+
+        uintptr_t buffers[2] = {0};
+        int32_t offsets[2] = {0};
+        int32_t strides[2] = {0};
+        if (buffer->type() == MediaBuffer::MBT_DmaBufHandle) {
+            // one fd per plane, pitch in strides
+            if (!buffer->getBufferInfo(buffers, offsets, strides, 2)) {
+                delete [] data;
+                return MediaBufferSP((MediaBuffer*)NULL);
+            }
+            uint8_t *dst = frame;
+            for (int32_t j = 0; j < 2; j++) {
+                size_t length = offsets[j] + strides[j] * rows[j];
+                void *plane = strides[j] >= width ?
+                    mmap(NULL, length, PROT_READ, MAP_SHARED, (int)buffers[j], 0) : MAP_FAILED;
+                if (plane == MAP_FAILED) {
+                    delete [] data;
+                    return MediaBufferSP((MediaBuffer*)NULL);
+                }
+                for (int32_t i = 0; i < rows[j]; i++)
+                    memcpy(dst + width * i, (uint8_t*)plane + offsets[j] + strides[j] * i, width);
+                munmap(plane, length);
+                dst += width * rows[j];
+            }
+            mDmaBufFrames++;
+        } else {
+            // packed NV12
+            if (!buffer->getBufferInfo(buffers, offsets, strides, 1) || !buffers[0] ||
+                buffer->size() < frameSize) {
+                delete [] data;
+                return MediaBufferSP((MediaBuffer*)NULL);
+            }
+            memcpy(frame, (uint8_t*)buffers[0] + offsets[0], frameSize);
+        }
+
+        *(uintptr_t*)data = (uintptr_t)frame;
+        MediaBufferSP out = MediaBuffer::createMediaBuffer(MediaBuffer::MBT_RawVideo);
+        int32_t offset = 0;
+        int32_t stride = sizeof(uintptr_t);
+        out->setBufferInfo((uintptr_t*)&data, &offset, &stride, 1);
+        out->setSize(frameSize);
+        out->setPts(buffer->pts());
+        out->setDts(buffer->pts());
+        out->addReleaseBufferFunc(releaseFrame);
+        return out;
+    }
+};
+
+// counts what the encoder writes
+class EncodedSink : public SinkComponent {
+  public:
+    class EncodedWriter : public Writer {
+      public:
+        EncodedWriter(EncodedSink *sink) : mSink(sink) {}
+        virtual mm_status_t write(const MediaBufferSP &buffer) { return mSink->write(buffer); }
+        virtual mm_status_t setMetaData(const MediaMetaSP &metaData) { return MM_ERROR_SUCCESS; }
+      private:
+        EncodedSink *mSink;
+    };
+
+    EncodedSink()
+        : mCond(mLock)
+        , mFrames(0)
+        , mKeyFrames(0)
+        , mBytes(0)
+        , mFirstIsKey(false)
+        , mHasCodecData(false)
+        , mStartCode(false)
+        , mEOS(false)
+    {}
+    virtual const char * name() const { return "EncodedSink"; }
+    COMPONENT_VERSION;
+    virtual WriterSP getWriter(MediaType mediaType) { return WriterSP(new EncodedWriter(this)); }
+    virtual mm_status_t addSource(Component * component, MediaType mediaType) { return MM_ERROR_SUCCESS; }
+    virtual int64_t getCurrentPosition() { return 0; }
+
+    mm_status_t write(const MediaBufferSP &buffer) {
+        MMAutoLock locker(mLock);
+        if (buffer->isFlagSet(MediaBuffer::MBFT_EOS)) {
+            mEOS = true;
+            mCond.broadcast();
+            if (buffer->size() == 0)
+                return MM_ERROR_SUCCESS;
+        }
+
+        uint8_t *data = NULL;
+        int32_t offset = 0, size = 0;
+        if (!buffer->getBufferInfo((uintptr_t*)&data, &offset, &size, 1) || !data || buffer->size() <= 0)
+            return MM_ERROR_SUCCESS;
+        bool key = buffer->isFlagSet(MediaBuffer::MBFT_KeyFrame);
+        if (!mFrames) {
+            mFirstIsKey = key;
+            uint8_t *p = data + offset;
+            mStartCode = buffer->size() > 4 && !p[0] && !p[1] && (p[2] == 1 || (!p[2] && p[3] == 1));
+            uint8_t *csd = NULL;
+            int32_t csdSize = 0;
+            MediaMetaSP meta = buffer->getMediaMeta();
+            mHasCodecData = meta && meta->getByteBuffer(MEDIA_ATTR_CODEC_DATA, csd, csdSize) && csdSize > 0;
+        }
+        mFrames++;
+        mKeyFrames += key;
+        mBytes += buffer->size();
+        return MM_ERROR_SUCCESS;
+    }
+
+    bool waitEOS() {
+        MMAutoLock locker(mLock);
+        int64_t deadlineUs = getTimeUs() + kTimeoutUs;
+        while (!mEOS && getTimeUs() < deadlineUs)
+            mCond.timedWait(deadlineUs - getTimeUs());
+        return mEOS;
+    }
+
+    Lock mLock;
+    Condition mCond;
+    int32_t mFrames;
+    int32_t mKeyFrames;
+    int64_t mBytes;
+    bool mFirstIsKey;
+    bool mHasCodecData;
+    bool mStartCode;
+    bool mEOS;
+};
+
+// checks the dma-buf frames of VideoDecodeV4l2 and hands them back at once
+class DmaBufSink : public SinkComponent {
+  public:
+    class DmaBufWriter : public Writer {
+      public:
+        DmaBufWriter(DmaBufSink *sink) : mSink(sink) {}
+        virtual mm_status_t write(const MediaBufferSP &buffer) { return mSink->write(buffer); }
+        virtual mm_status_t setMetaData(const MediaMetaSP &metaData) { return MM_ERROR_SUCCESS; }
+      private:
+        DmaBufSink *mSink;
+    };
+
+    DmaBufSink()
+        : mCond(mLock)
+        , mFrames(0)
+        , mOtherFrames(0)
+        , mBadFrames(0)
+        , mBlankFrames(0)
+        , mEOS(false)
+    {}
+    virtual const char * name() const { return "DmaBufSink"; }
+    COMPONENT_VERSION;
+    virtual WriterSP getWriter(MediaType mediaType) { return WriterSP(new DmaBufWriter(this)); }
+    virtual mm_status_t addSource(Component * component, MediaType mediaType) { return MM_ERROR_SUCCESS; }
+    virtual int64_t getCurrentPosition() { return 0; }
+
+    mm_status_t write(const MediaBufferSP &buffer) {
+        MMAutoLock locker(mLock);
+        if (buffer->isFlagSet(MediaBuffer::MBFT_EOS)) {
+            mEOS = true;
+            mCond.broadcast();
+            if (buffer->size() == 0)
+                return MM_ERROR_SUCCESS;
+        }
+        if (buffer->type() != MediaBuffer::MBT_DmaBufHandle) {
+            mOtherFrames++;
+            return MM_ERROR_SUCCESS;
+        }
+
+        uintptr_t fds[2] = {0};
+        int32_t offsets[2] = {0};
+        int32_t strides[2] = {0};
+        int32_t width = 0, height = 0, fourcc = 0;
+        MediaMetaSP meta = buffer->getMediaMeta();
+        if (!buffer->getBufferInfo(fds, offsets, strides, 2) || !meta ||
+            !meta->getInt32(MEDIA_ATTR_WIDTH, width) || !meta->getInt32(MEDIA_ATTR_HEIGHT, height) ||
+            !meta->getInt32(MEDIA_ATTR_COLOR_FOURCC, fourcc) || fourcc != 'NV12' ||
+            strides[0] < width || strides[1] < width) {
+            mBadFrames++;
+            return MM_ERROR_SUCCESS;
+        }
+
+        // both planes map, there is a picture in the luma
+        size_t lengths[2] = {(size_t)(offsets[0] + strides[0] * height),
+                             (size_t)(offsets[1] + strides[1] * ((height + 1) / 2))};
+        uint8_t *planes[2] = {NULL, NULL};
+        for (int32_t j = 0; j < 2; j++) {
+            void *plane = mmap(NULL, lengths[j], PROT_READ, MAP_SHARED, (int)fds[j], 0);
+            planes[j] = plane == MAP_FAILED ? NULL : (uint8_t*)plane;
+        }
+        if (!planes[0] || !planes[1]) {
+            mBadFrames++;
+        } else {
+            bool blank = true;
+            const uint8_t *row = planes[0] + offsets[0] + strides[0] * (height / 2);
+            for (int32_t i = 0; i < width && blank; i++)
+                blank = !row[i];
+            mBlankFrames += blank;
+            mFrames++;
+        }
+        for (int32_t j = 0; j < 2; j++) {
+            if (planes[j])
+                munmap(planes[j], lengths[j]);
+        }
+        mCond.broadcast();
+        return MM_ERROR_SUCCESS;
+    }
+
+    // false if EOS or the timeout comes first
+    bool waitFrames(int32_t frames) {
+        MMAutoLock locker(mLock);
+        int64_t deadlineUs = getTimeUs() + kTimeoutUs;
+        while (mFrames < frames && !mEOS && getTimeUs() < deadlineUs)
+            mCond.timedWait(deadlineUs - getTimeUs());
+        return mFrames >= frames;
+    }
+
+    Lock mLock;
+    Condition mCond;
+    int32_t mFrames;
+    int32_t mOtherFrames;
+    int32_t mBadFrames;
+    int32_t mBlankFrames;
+    bool mEOS;
+};
+
+class VideoV4l2Test : public testing::Test {
+protected:
+    virtual void SetUp() {
+        // V4l2CodecDevice::create() picks the libavcodec device
+        setenv("MM_V4L2_SOFT", "1", 1);
+    }
+
+    virtual void TearDown() {
+    }
+};
+
+// demuxer -> VideoDecodeV4l2 (dma-buf output) -> FrameBridge -> VideoEncodeV4l2 -> EncodedSink
+TEST_F(VideoV4l2Test, decodeEncode) {
+    Component::ListenerSP sourceListener(new EventListener());
+    Component::ListenerSP decoderListener(new EventListener());
+    Component::ListenerSP encoderListener(new EventListener());
+    EventListener *sourceEvents = (EventListener*)sourceListener.get();
+    EventListener *decoderEvents = (EventListener*)decoderListener.get();
+    EventListener *encoderEvents = (EventListener*)encoderListener.get();
+
+    AVDemuxer *source = new AVDemuxer();
+    source->setListener(sourceListener);
+    ASSERT_EQ(MM_ERROR_SUCCESS, source->init());
+    ASSERT_EQ(MM_ERROR_SUCCESS, source->setUri(TEST_FILE));
+    ASSERT_EQ(MM_ERROR_SUCCESS, sourceEvents->waitResult(source->prepare(), Component::kEventPrepareResult));
+    ASSERT_TRUE(source->hasMedia(Component::kMediaTypeVideo));
+
+    std::string mime;
+    Component::ReaderSP reader = source->getReader(Component::kMediaTypeVideo);
+    ASSERT_TRUE(reader && reader->getMetaData());
+    const char *str = NULL;
+    ASSERT_TRUE(reader->getMetaData()->getString(MEDIA_ATTR_MIME, str) && str);
+    mime = str;
+    reader.reset();
+
+    VideoDecodeV4l2 *decoder = new VideoDecodeV4l2(mime.c_str());
+    decoder->setListener(decoderListener);
+    ASSERT_EQ(MM_ERROR_SUCCESS, decoder->init());
+    MediaMetaSP param = MediaMeta::create();
+    param->setString("output-buffer-type", "dmabuf");
+    ASSERT_EQ(MM_ERROR_SUCCESS, decoder->setParameter(param));
+
+    FrameBridge bridge;
+    EncodedSink sink;
+    ASSERT_EQ(MM_ERROR_SUCCESS, decoder->addSource(source, Component::kMediaTypeVideo));
+    ASSERT_EQ(MM_ERROR_SUCCESS, decoder->addSink(&bridge, Component::kMediaTypeVideo));
+    ASSERT_GT(bridge.mWidth, 0);
+    ASSERT_GT(bridge.mHeight, 0);
+
+    VideoEncodeV4l2 *encoder = new VideoEncodeV4l2(MEDIA_MIMETYPE_VIDEO_AVC, true);
+    encoder->setListener(encoderListener);
+    ASSERT_EQ(MM_ERROR_SUCCESS, encoder->init());
+    param = MediaMeta::create();
+    param->setInt32(MEDIA_ATTR_BIT_RATE, 1000000);
+    encoder->setParameter(param);
+    ASSERT_EQ(MM_ERROR_SUCCESS, encoder->addSource(&bridge, Component::kMediaTypeVideo));
+    ASSERT_EQ(MM_ERROR_SUCCESS, encoder->addSink(&sink, Component::kMediaTypeVideo));
+
+    EXPECT_EQ(MM_ERROR_SUCCESS, decoderEvents->waitResult(decoder->prepare(), Component::kEventPrepareResult));
+    EXPECT_EQ(MM_ERROR_SUCCESS, encoderEvents->waitResult(encoder->prepare(), Component::kEventPrepareResult));
+    EXPECT_EQ(MM_ERROR_SUCCESS, sourceEvents->waitResult(source->start(), Component::kEventStartResult));
+    EXPECT_EQ(MM_ERROR_SUCCESS, encoderEvents->waitResult(encoder->start(), Component::kEventStartResult));
+    EXPECT_EQ(MM_ERROR_SUCCESS, decoderEvents->waitResult(decoder->start(), Component::kEventStartResult));
+
+    bool eos = sink.waitEOS();
+
+    // tear down before checking, no component thread may outlive a failed assertion
+    decoder->stop();
+    encoder->stop();
+    source->stop();
+    decoder->reset();
+    encoder->reset();
+    source->reset();
+    decoder->uninit();
+    encoder->uninit();
+    source->uninit();
+    delete decoder;
+    delete encoder;
+    delete source;
+
+    EXPECT_EQ(MM_ERROR_SUCCESS, sourceEvents->error());
+    EXPECT_EQ(MM_ERROR_SUCCESS, decoderEvents->error());
+    EXPECT_EQ(MM_ERROR_SUCCESS, encoderEvents->error());
+    ASSERT_TRUE(eos);
+    EXPECT_EQ(0, bridge.mBadFrames);
+    EXPECT_EQ(kFrames, bridge.mFrames);
+    // every frame in is encoded, the first one is an IDR with SPS/PPS in front
+    EXPECT_EQ(bridge.mFrames, sink.mFrames);
+    EXPECT_TRUE(sink.mFirstIsKey);
+    EXPECT_TRUE(sink.mHasCodecData);
+    EXPECT_TRUE(sink.mStartCode);
+    EXPECT_GE(sink.mKeyFrames, 1);
+    EXPECT_GT(sink.mBytes, 0);
+    MMLOGI("%dx%d, %d frames (%d dma-buf) -> %d frames %" PRId64 " bytes, %d key frames\n",
+        bridge.mWidth, bridge.mHeight, bridge.mFrames, bridge.mDmaBufFrames,
+        sink.mFrames, sink.mBytes, sink.mKeyFrames);
+}
+
+// decoded frames stay in the device buffers, the soft device exports them (VIDIOC_EXPBUF)
+TEST_F(VideoV4l2Test, dmabufOutput) {
+    Component::ListenerSP sourceListener(new EventListener());
+    Component::ListenerSP decoderListener(new EventListener());
+    EventListener *sourceEvents = (EventListener*)sourceListener.get();
+    EventListener *decoderEvents = (EventListener*)decoderListener.get();
+
+    AVDemuxer *source = new AVDemuxer();
+    source->setListener(sourceListener);
+    ASSERT_EQ(MM_ERROR_SUCCESS, source->init());
+    ASSERT_EQ(MM_ERROR_SUCCESS, source->setUri(TEST_FILE));
+    ASSERT_EQ(MM_ERROR_SUCCESS, sourceEvents->waitResult(source->prepare(), Component::kEventPrepareResult));
+    ASSERT_TRUE(source->hasMedia(Component::kMediaTypeVideo));
+
+    Component::ReaderSP reader = source->getReader(Component::kMediaTypeVideo);
+    ASSERT_TRUE(reader && reader->getMetaData());
+    const char *mime = NULL;
+    ASSERT_TRUE(reader->getMetaData()->getString(MEDIA_ATTR_MIME, mime) && mime);
+
+    VideoDecodeV4l2 *decoder = new VideoDecodeV4l2(mime);
+    reader.reset();
+    decoder->setListener(decoderListener);
+    ASSERT_EQ(MM_ERROR_SUCCESS, decoder->init());
+    MediaMetaSP param = MediaMeta::create();
+    param->setString("output-buffer-type", "dmabuf");
+    ASSERT_EQ(MM_ERROR_SUCCESS, decoder->setParameter(param));
+
+    DmaBufSink sink;
+    ASSERT_EQ(MM_ERROR_SUCCESS, decoder->addSource(source, Component::kMediaTypeVideo));
+    ASSERT_EQ(MM_ERROR_SUCCESS, decoder->addSink(&sink, Component::kMediaTypeVideo));
+
+    EXPECT_EQ(MM_ERROR_SUCCESS, decoderEvents->waitResult(decoder->prepare(), Component::kEventPrepareResult));
+    EXPECT_EQ(MM_ERROR_SUCCESS, sourceEvents->waitResult(source->start(), Component::kEventStartResult));
+    EXPECT_EQ(MM_ERROR_SUCCESS, decoderEvents->waitResult(decoder->start(), Component::kEventStartResult));
+
+    // more frames than the device has capture buffers, so released buffers are queued again
+    bool done = sink.waitFrames(kFrames * 2);
+
+    decoder->stop();
+    source->stop();
+    decoder->reset();
+    source->reset();
+    decoder->uninit();
+    source->uninit();
+    delete decoder;
+    delete source;
+
+    EXPECT_EQ(MM_ERROR_SUCCESS, sourceEvents->error());
+    EXPECT_EQ(MM_ERROR_SUCCESS, decoderEvents->error());
+    EXPECT_TRUE(done);
+    EXPECT_EQ(0, sink.mOtherFrames);
+    EXPECT_EQ(0, sink.mBadFrames);
+    EXPECT_LT(sink.mBlankFrames, sink.mFrames);
+    MMLOGI("%d dma-buf frames, %d blank\n", sink.mFrames, sink.mBlankFrames);
+}
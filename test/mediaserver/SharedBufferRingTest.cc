@@ -0,0 +1,143 @@
+/**
+ * Copyright (C) 2017 Alibaba Group Holding Limited. All Rights Reserved.
+ *
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <deque>
+
+#include "multimedia/mm_debug.h"
+#include "multimedia/media_meta.h"
+#include "multimedia/media_attr_str.h"
+#include "SharedBufferRing.h"
+
+MM_LOG_DEFINE_MODULE_NAME("RINGTEST")
+
+using namespace YUNOS_MM;
+
+static const int kBufferCount = 2000;
+static const char *kMime = "video/h264";
+
+class SharedBufferRingTest : public testing::Test {
+protected:
+    virtual void SetUp() {
+    }
+
+    virtual void TearDown() {
+    }
+};
+
+static int bufferSize(int i) {
+    return 100 + i % 900;
+}
+
+// odd buffers are written in place, even buffers are copied into the ring
+static void *producerThread(void *arg) {
+    SharedBufferRing *ring = (SharedBufferRing*)arg;
+    static uint8_t data[1024];
+
+    for (int i = 0; i < kBufferCount; i++) {
+        MediaBufferSP buffer;
+        uint8_t *ptr = data;
+        if (i % 2) {
+            if (ring->dequeueBuffer(buffer, -1) != MM_ERROR_SUCCESS)
+                return NULL;
+            buffer->getBufferInfo((uintptr_t*)&ptr, NULL, NULL, 1);
+        } else {
+            int32_t offset = 0;
+            int32_t stride = sizeof(data);
+            buffer = MediaBuffer::createMediaBuffer(MediaBuffer::MBT_ByteBuffer);
+            buffer->setBufferInfo((uintptr_t*)&ptr, &offset, &stride, 1);
+        }
+        memset(ptr, i & 0xff, bufferSize(i));
+        buffer->setSize(bufferSize(i));
+        buffer->setPts(i);
+        if (i == kBufferCount - 1)
+            buffer->setFlag(MediaBuffer::MBFT_EOS);
+        MediaMetaSP meta = MediaMeta::create();
+        meta->setString(MEDIA_ATTR_MIME, kMime);
+        buffer->setMediaMeta(meta);
+
+        if (ring->writeBuffer(buffer, -1) != MM_ERROR_SUCCESS)
+            return NULL;
+    }
+    return NULL;
+}
+
+TEST_F(SharedBufferRingTest, pushTest) {
+    SharedBufferRingSP producer = SharedBufferRing::create(SharedBufferRing::kProducer, 8, 4096);
+    ASSERT_TRUE(producer);
+    // the consumer maps the memory and uses the doorbells through its own fds, like the service
+    SharedBufferRingSP consumer = SharedBufferRing::import(SharedBufferRing::kConsumer,
+        dup(producer->memFd()), dup(producer->dataFd()), dup(producer->spaceFd()));
+    ASSERT_TRUE(consumer);
+    EXPECT_EQ(consumer->slotCount(), 8u);
+
+    pthread_t thread;
+    ASSERT_EQ(pthread_create(&thread, NULL, producerThread, producer.get()), 0);
+
+    // hold a few buffers and release them out of order
+    std::deque<MediaBufferSP> held;
+    int count = 0;
+    for (;;) {
+        MediaBufferSP buffer;
+        ASSERT_EQ(consumer->readBuffer(buffer, 2000), MM_ERROR_SUCCESS);
+
+        uint8_t *ptr = NULL;
+        buffer->getBufferInfo((uintptr_t*)&ptr, NULL, NULL, 1);
+        const char *mime = NULL;
+        ASSERT_TRUE(buffer->getMediaMeta()->getString(MEDIA_ATTR_MIME, mime));
+        EXPECT_STREQ(mime, kMime);
+        EXPECT_EQ(buffer->pts(), count);
+        ASSERT_EQ(buffer->size(), bufferSize(count));
+        EXPECT_EQ(ptr[0], count & 0xff);
+        EXPECT_EQ(ptr[buffer->size() - 1], count & 0xff);
+        count++;
+
+        bool eos = buffer->isFlagSet(MediaBuffer::MBFT_EOS);
+        held.push_back(buffer);
+        if (held.size() > 3)
+            held.erase(held.begin() + count % 3);
+        if (eos)
+            break;
+    }
+    held.clear();
+    pthread_join(thread, NULL);
+
+    EXPECT_EQ(count, kBufferCount);
+    EXPECT_EQ(producer->pending(), 0u);
+
+    MediaBufferSP buffer;
+    EXPECT_EQ(consumer->readBuffer(buffer, 10), MM_ERROR_AGAIN);
+    producer->close();
+    EXPECT_EQ(consumer->readBuffer(buffer, 10), MM_ERROR_EOS);
+    EXPECT_EQ(producer->writeBuffer(MediaBuffer::createMediaBuffer(), 10), MM_ERROR_EOS);
+}
+
+int main(int argc, char* const argv[]) {
+    int ret;
+    try {
+        ::testing::InitGoogleTest(&argc, (char **)argv);
+        ret = RUN_ALL_TESTS();
+    } catch (...) {
+        MMLOGE("InitGoogleTest failed!");
+        return -1;
+    }
+    return ret;
+}
@@ -43,3 +43,26 @@ include $(MM_ROOT_PATH)/base/build/xmake_req_libs.mk
 include $(BUILD_EXECUTABLE)
 
 endif
+
+## shared-buffer-ring-test
+LOCAL_PATH:=$(call my-dir)
+MM_ROOT_PATH:= $(LOCAL_PATH)/../../
+
+include $(CLEAR_VARS)
+include $(MM_ROOT_PATH)/base/build/build.mk
+include $(MM_ROOT_PATH)/test/gtest_common.mk
+
+LOCAL_SRC_FILES:= SharedBufferRingTest.cc
+
+LOCAL_MODULE:= shared-buffer-ring-test
+
+LOCAL_C_INCLUDES +=              \
+    $(base-includes)             \
+    $(MM_ROOT_PATH)/base/include \
+    $(MM_ROOT_PATH)/mediaserver/include
+
+LOCAL_SHARED_LIBRARIES += libmmbase libmediaservice_client_common
+
+LOCAL_LDFLAGS += -lpthread -lstdc++
+
+include $(BUILD_EXECUTABLE)
@@ -0,0 +1,154 @@
+/**
+ * Copyright (C) 2017 Alibaba Group Holding Limited. All Rights Reserved.
+ *
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include <multimedia/mm_debug.h>
+#include <multimedia/mm_errors.h>
+
+#include "frame_extractor.h"
+
+MM_LOG_DEFINE_MODULE_NAME("frame-extractor-test");
+
+using namespace YUNOS_MM;
+
+static const char *g_video_file_path = "/usr/bin/ut/res/video/test.mp4";
+
+class FrameCollector : public FrameExtractor::Listener {
+public:
+    struct Frame {
+        int32_t index;
+        int64_t timeUs;
+        int32_t width;
+        int32_t height;
+        std::vector<uint8_t> jpeg;
+    };
+
+    FrameCollector() : mStatus(MM_ERROR_UNKNOWN), mDoneFrames(-1) {}
+
+    virtual void onFrame(const char *uri, int32_t index, int64_t timeUs,
+                         int32_t width, int32_t height,
+                         const uint8_t *jpeg, size_t size) {
+        Frame frame;
+        frame.index = index;
+        frame.timeUs = timeUs;
+        frame.width = width;
+        frame.height = height;
+        frame.jpeg.assign(jpeg, jpeg + size);
+        MMAutoLock locker(mLock);
+        mFrames.push_back(frame);
+    }
+
+    virtual void onDone(const char *uri, mm_status_t status, int32_t frames) {
+        MMAutoLock locker(mLock);
+        mStatus = status;
+        mDoneFrames = frames;
+    }
+
+    Lock mLock;
+    std::vector<Frame> mFrames;
+    mm_status_t mStatus;
+    int32_t mDoneFrames;
+};
+
+static void checkJpeg(const FrameCollector::Frame &frame)
+{
+    ASSERT_GT(frame.jpeg.size(), 4u);
+    // SOI and EOI markers
+    EXPECT_EQ(0xff, frame.jpeg[0]);
+    EXPECT_EQ(0xd8, frame.jpeg[1]);
+    EXPECT_EQ(0xff, frame.jpeg[frame.jpeg.size() - 2]);
+    EXPECT_EQ(0xd9, frame.jpeg[frame.jpeg.size() - 1]);
+}
+
+class FrameExtractorTest : public testing::Test {
+protected:
+    virtual void SetUp() {
+    }
+
+    virtual void TearDown() {
+    }
+};
+
+TEST_F(FrameExtractorTest, extractKeyFrames) {
+    FrameExtractor extractor;
+    ASSERT_EQ(MM_ERROR_SUCCESS, extractor.open(g_video_file_path));
+    ASSERT_GT(extractor.sourceWidth(), 0);
+    ASSERT_GT(extractor.sourceHeight(), 0);
+    ASSERT_GT(extractor.durationUs(), 0);
+
+    FrameExtractor::Options options;
+    options.width = 160;
+    options.count = 3;
+    FrameCollector collector;
+    int32_t frames = 0;
+    ASSERT_EQ(MM_ERROR_SUCCESS, extractor.extract(options, &collector, &frames));
+    ASSERT_GT(frames, 0);
+    ASSERT_LE(frames, 3);
+    ASSERT_EQ((size_t)frames, collector.mFrames.size());
+
+    int64_t lastUs = -1;
+    for (size_t i = 0; i < collector.mFrames.size(); i++) {
+        const FrameCollector::Frame &frame = collector.mFrames[i];
+        EXPECT_EQ(160, frame.width);
+        // height follows the aspect ratio, even for the 420 jpeg
+        EXPECT_GT(frame.height, 0);
+        EXPECT_EQ(0, frame.height % 2);
+        EXPECT_GT(frame.timeUs, lastUs);
+        EXPECT_LE(frame.timeUs, extractor.durationUs());
+        lastUs = frame.timeUs;
+        checkJpeg(frame);
+    }
+    extractor.close();
+}
+
+TEST_F(FrameExtractorTest, openFails) {
+    FrameExtractor extractor;
+    EXPECT_NE(MM_ERROR_SUCCESS, extractor.open("/usr/bin/ut/res/video/not_exist.mp4"));
+    EXPECT_EQ(MM_ERROR_INVALID_PARAM, extractor.open(""));
+
+    FrameExtractor::Options options;
+    FrameCollector collector;
+    EXPECT_NE(MM_ERROR_SUCCESS, extractor.extract(options, &collector));
+    EXPECT_TRUE(collector.mFrames.empty());
+}
+
+TEST_F(FrameExtractorTest, engine) {
+    ThumbnailEngine engine(2);
+    ASSERT_EQ(MM_ERROR_SUCCESS, engine.start());
+
+    FrameExtractor::Options options;
+    options.width = 96;
+    options.height = 96;
+    FrameCollector collectors[2];
+    for (int32_t i = 0; i < 2; i++)
+        ASSERT_EQ(MM_ERROR_SUCCESS, engine.addJob(g_video_file_path, options, &collectors[i]));
+    engine.waitAll();
+    engine.stop();
+
+    for (int32_t i = 0; i < 2; i++) {
+        EXPECT_EQ(MM_ERROR_SUCCESS, collectors[i].mStatus);
+        ASSERT_EQ(1, collectors[i].mDoneFrames);
+        ASSERT_EQ(1u, collectors[i].mFrames.size());
+        EXPECT_EQ(96, collectors[i].mFrames[0].width);
+        EXPECT_EQ(96, collectors[i].mFrames[0].height);
+        checkJpeg(collectors[i].mFrames[0]);
+    }
+}
@@ -0,0 +1,106 @@
+/**
+ * Copyright (C) 2017 Alibaba Group Holding Limited. All Rights Reserved.
+ *
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <gtest/gtest.h>
+
+extern "C" {
+#ifndef __STDC_CONSTANT_MACROS
+#define __STDC_CONSTANT_MACROS
+#endif
+#include <libavformat/avformat.h>
+}
+
+#include <multimedia/mm_debug.h>
+#include <multimedia/mm_errors.h>
+
+#include "seg_transcoder.h"
+
+MM_LOG_DEFINE_MODULE_NAME("seg-transcoder-test");
+
+using namespace YUNOS_MM;
+
+static const char *g_video_file_path = "/usr/bin/ut/res/video/test.mp4";
+static const char *g_out_file_path = "/tmp/seg_transcoder_test.mp4";
+
+// duration and the number of video frames of a file
+static bool probeVideo(const char *path, int64_t &durationUs, int32_t &frames)
+{
+    AVFormatContext *fmt = NULL;
+    av_register_all();
+    if (avformat_open_input(&fmt, path, NULL, NULL) < 0)
+        return false;
+    if (avformat_find_stream_info(fmt, NULL) < 0) {
+        avformat_close_input(&fmt);
+        return false;
+    }
+    int video = av_find_best_stream(fmt, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
+    durationUs = fmt->duration;
+    frames = 0;
+    AVPacket pkt;
+    av_init_packet(&pkt);
+    while (video >= 0 && av_read_frame(fmt, &pkt) >= 0) {
+        if (pkt.stream_index == video)
+            frames++;
+        av_free_packet(&pkt);
+    }
+    avformat_close_input(&fmt);
+    return video >= 0;
+}
+
+class SegmentTranscoderTest : public testing::Test {
+protected:
+    virtual void SetUp() {
+        unlink(g_out_file_path);
+    }
+
+    virtual void TearDown() {
+        unlink(g_out_file_path);
+    }
+};
+
+// segments on 4 threads, joined in order: every frame once, the duration of the input
+TEST_F(SegmentTranscoderTest, transcodeSegments) {
+    int64_t inDurationUs = 0;
+    int32_t inFrames = 0;
+    ASSERT_TRUE(probeVideo(g_video_file_path, inDurationUs, inFrames));
+    ASSERT_GT(inFrames, 0);
+
+    SegmentTranscoder::Options options;
+    options.width = 320;
+    options.height = 240;
+    options.threads = 4;
+    options.preset = "ultrafast";
+    SegmentTranscoder transcoder;
+    ASSERT_EQ(MM_ERROR_SUCCESS, transcoder.transcode(g_video_file_path, g_out_file_path, options));
+    EXPECT_GT(transcoder.segmentCount(), 1);
+
+    int64_t outDurationUs = 0;
+    int32_t outFrames = 0;
+    ASSERT_TRUE(probeVideo(g_out_file_path, outDurationUs, outFrames));
+    EXPECT_EQ(inFrames, outFrames);
+    EXPECT_NEAR(inDurationUs, outDurationUs, 100000);
+}
+
+TEST_F(SegmentTranscoderTest, openFails) {
+    SegmentTranscoder::Options options;
+    SegmentTranscoder transcoder;
+    EXPECT_NE(MM_ERROR_SUCCESS, transcoder.transcode("/usr/bin/ut/res/video/not_exist.mp4", g_out_file_path, options));
+    EXPECT_NE(0, access(g_out_file_path, F_OK));
+}
@@ -0,0 +1,191 @@
+/**
+ * Copyright (C) 2017 Alibaba Group Holding Limited. All Rights Reserved.
+ *
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <gtest/gtest.h>
+
+extern "C" {
+#ifndef __STDC_CONSTANT_MACROS
+#define __STDC_CONSTANT_MACROS
+#endif
+#include <libavformat/avformat.h>
+}
+
+#include <multimedia/mm_debug.h>
+#include <multimedia/mm_errors.h>
+
+#include "stream_remuxer.h"
+
+MM_LOG_DEFINE_MODULE_NAME("stream-remuxer-test");
+
+using namespace YUNOS_MM;
+
+static const char *g_video_file_path = "/usr/bin/ut/res/video/test.mp4";
+static const char *g_out_file_path = "/tmp/stream_remuxer_test.mkv";
+static const char *g_sparse_file_path = "/tmp/stream_remuxer_sparse.mkv";
+
+static int64_t fileSize(const char *path)
+{
+    struct stat st;
+    return stat(path, &st) ? -1 : st.st_size;
+}
+
+// duration and the number of streams of a file
+static bool probe(const char *path, int64_t &durationUs, int32_t &streams)
+{
+    AVFormatContext *fmt = NULL;
+    av_register_all();
+    if (avformat_open_input(&fmt, path, NULL, NULL) < 0)
+        return false;
+    bool ok = avformat_find_stream_info(fmt, NULL) >= 0;
+    durationUs = fmt->duration;
+    streams = fmt->nb_streams;
+    avformat_close_input(&fmt);
+    return ok;
+}
+
+// the video of the test file and a subtitle track with a single cue at the start
+static bool writeSparseFile(const char *output)
+{
+    AVFormatContext *in = NULL;
+    AVFormatContext *out = NULL;
+    bool ok = false;
+    av_register_all();
+    if (avformat_open_input(&in, g_video_file_path, NULL, NULL) < 0)
+        return false;
+    int video = -1;
+    AVStream *vs = NULL;
+    AVStream *ss = NULL;
+    AVPacket pkt;
+    static char cue[] = "sparse";
+
+    if (avformat_find_stream_info(in, NULL) < 0 ||
+        (video = av_find_best_stream(in, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0)) < 0 ||
+        avformat_alloc_output_context2(&out, NULL, "matroska", output) < 0)
+        goto done;
+
+    vs = avformat_new_stream(out, NULL);
+    ss = avformat_new_stream(out, NULL);
+    if (!vs || !ss || avcodec_parameters_copy(vs->codecpar, in->streams[video]->codecpar) < 0)
+        goto done;
+    vs->codecpar->codec_tag = 0;
+    vs->time_base = in->streams[video]->time_base;
+    ss->codecpar->codec_type = AVMEDIA_TYPE_SUBTITLE;
+    ss->codecpar->codec_id = AV_CODEC_ID_SUBRIP;
+    ss->time_base = av_make_q(1, 1000);
+    if (avio_open(&out->pb, output, AVIO_FLAG_WRITE) < 0 || avformat_write_header(out, NULL) < 0)
+        goto done;
+
+    av_init_packet(&pkt);
+    pkt.data = (uint8_t*)cue;
+    pkt.size = strlen(cue);
+    pkt.pts = pkt.dts = 0;
+    pkt.duration = 500;
+    pkt.stream_index = ss->index;
+    pkt.flags = AV_PKT_FLAG_KEY;
+    av_packet_rescale_ts(&pkt, av_make_q(1, 1000), ss->time_base);
+    if (av_interleaved_write_frame(out, &pkt) < 0)
+        goto done;
+
+    ok = true;
+    while (ok) {
+        av_init_packet(&pkt);
+        pkt.data = NULL;
+        pkt.size = 0;
+        if (av_read_frame(in, &pkt) < 0)
+            break;
+        if (pkt.stream_index == video) {
+            av_packet_rescale_ts(&pkt, in->streams[video]->time_base, vs->time_base);
+            pkt.stream_index = vs->index;
+            pkt.pos = -1;
+            ok = av_interleaved_write_frame(out, &pkt) >= 0;
+        }
+        av_free_packet(&pkt);
+    }
+    ok = ok && av_write_trailer(out) >= 0;
+
+done:
+    if (out) {
+        if (out->pb)
+            avio_closep(&out->pb);
+        avformat_free_context(out);
+    }
+    avformat_close_input(&in);
+    return ok;
+}
+
+class StreamRemuxerTest : public testing::Test {
+protected:
+    virtual void SetUp() {
+        unlink(g_out_file_path);
+    }
+
+    virtual void TearDown() {
+        unlink(g_out_file_path);
+        unlink(g_sparse_file_path);
+    }
+};
+
+// the second quarter of the file: it starts at the key frame before its start, reading stops
+// soon after its end
+TEST_F(StreamRemuxerTest, trimRange) {
+    int64_t inDurationUs = 0;
+    int32_t inStreams = 0;
+    ASSERT_TRUE(probe(g_video_file_path, inDurationUs, inStreams));
+    ASSERT_GT(inDurationUs, 0);
+
+    StreamRemuxer::Options options;
+    options.startUs = inDurationUs / 4;
+    options.endUs = inDurationUs / 2;
+    options.maxInterleaveUs = 200000;
+    StreamRemuxer remuxer;
+    ASSERT_EQ(MM_ERROR_SUCCESS, remuxer.remux(g_video_file_path, g_out_file_path, options));
+    EXPECT_GT(remuxer.packets(), 0);
+    EXPECT_LT(remuxer.readBytes(), fileSize(g_video_file_path) * 3 / 4);
+
+    int64_t outDurationUs = 0;
+    int32_t outStreams = 0;
+    ASSERT_TRUE(probe(g_out_file_path, outDurationUs, outStreams));
+    EXPECT_EQ(inStreams, outStreams);
+    EXPECT_GE(outDurationUs, options.endUs - options.startUs - 100000);
+    EXPECT_LE(outDurationUs, options.endUs + 100000);
+}
+
+// a subtitle track without a packet past the end doesn't keep the reading going to the end of file
+TEST_F(StreamRemuxerTest, sparseTrack) {
+    ASSERT_TRUE(writeSparseFile(g_sparse_file_path));
+    int64_t inDurationUs = 0;
+    int32_t inStreams = 0;
+    ASSERT_TRUE(probe(g_sparse_file_path, inDurationUs, inStreams));
+    ASSERT_EQ(2, inStreams);
+
+    StreamRemuxer::Options options;
+    options.endUs = inDurationUs / 4;
+    options.maxInterleaveUs = 200000;
+    StreamRemuxer remuxer;
+    ASSERT_EQ(MM_ERROR_SUCCESS, remuxer.remux(g_sparse_file_path, g_out_file_path, options));
+    EXPECT_LT(remuxer.readBytes(), fileSize(g_sparse_file_path) * 3 / 4);
+
+    int64_t outDurationUs = 0;
+    int32_t outStreams = 0;
+    ASSERT_TRUE(probe(g_out_file_path, outDurationUs, outStreams));
+    EXPECT_EQ(2, outStreams);
+    EXPECT_LE(outDurationUs, options.endUs + 100000);
+}
@@ -0,0 +1,586 @@
+/**
+ * Copyright (C) 2017 Alibaba Group Holding Limited. All Rights Reserved.
+ *
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <unistd.h>
+#include <pthread.h>
+
+extern "C" {
+#ifndef __STDC_FORMAT_MACROS
+#define __STDC_FORMAT_MACROS
+#endif
+#ifndef __STDC_CONSTANT_MACROS
+#define __STDC_CONSTANT_MACROS
+#endif
+#include <inttypes.h>
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libswscale/swscale.h>
+#include <turbojpeg.h>
+}
+
+#include <multimedia/mm_debug.h>
+#include <multimedia/av_ffmpeg_helper.h>
+
+#include "frame_extractor.h"
+
+namespace YUNOS_MM {
+
+DEFINE_LOGTAG(FrameExtractor)
+DEFINE_LOGTAG(ThumbnailEngine)
+
+// packets read after one seek before giving up on finding a decodable keyframe
+static const int32_t kMaxPacketsPerSeek = 1024;
+static const int32_t kDefaultQuality = 80;
+
+static pthread_once_t s_av_once = PTHREAD_ONCE_INIT;
+static void av_init_once()
+{
+    avcodec_register_all();
+    av_register_all();
+    avformat_network_init();
+}
+
+static int32_t even(int32_t v)
+{
+    v &= ~1;
+    return v < 2 ? 2 : v;
+}
+
+FrameExtractor::Options::Options()
+    : width(0)
+    , height(0)
+    , count(1)
+    , intervalUs(0)
+    , startUs(0)
+    , quality(kDefaultQuality)
+    , fastDecode(true)
+{
+}
+
+FrameExtractor::FrameExtractor()
+    : mFormat(NULL)
+    , mCodec(NULL)
+    , mStreamIndex(-1)
+    , mDurationUs(-1)
+    , mFrame(NULL)
+    , mSws(NULL)
+    , mJpeg(NULL)
+    , mJpegBuf(NULL)
+    , mJpegBufSize(0)
+    , mJpegSize(0)
+{
+    pthread_once(&s_av_once, av_init_once);
+}
+
+FrameExtractor::~FrameExtractor()
+{
+    close();
+    if (mFrame)
+        av_frame_free(&mFrame);
+    if (mSws)
+        sws_freeContext(mSws);
+    if (mJpegBuf)
+        tjFree(mJpegBuf);
+    if (mJpeg)
+        tjDestroy((tjhandle)mJpeg);
+}
+
+mm_status_t FrameExtractor::open(const char *uri)
+{
+    if (!uri || !*uri)
+        return MM_ERROR_INVALID_PARAM;
+    close();
+    mUri = uri;
+
+    int ret = avformat_open_input(&mFormat, uri, NULL, NULL);
+    if (ret < 0) {
+        ERROR("%s: open failed: %d\n", uri, ret);
+        mFormat = NULL;
+        return MM_ERROR_IO;
+    }
+    ret = avformat_find_stream_info(mFormat, NULL);
+    if (ret < 0) {
+        ERROR("%s: find stream info failed: %d\n", uri, ret);
+        close();
+        return MM_ERROR_UNSUPPORTED;
+    }
+
+    for (unsigned int i = 0; i < mFormat->nb_streams; i++) {
+        AVStream *st = mFormat->streams[i];
+        if (st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO &&
+            !(st->disposition & AV_DISPOSITION_ATTACHED_PIC)) {
+            mStreamIndex = i;
+            break;
+        }
+    }
+    if (mStreamIndex < 0) {
+        ERROR("%s: no video stream\n", uri);
+        close();
+        return MM_ERROR_UNSUPPORTED;
+    }
+
+    // nothing but the keyframes of the video stream is read, demuxers honoring
+    // AVDISCARD_NONKEY (mov, mkv) skip the other samples without touching their data
+    for (unsigned int i = 0; i < mFormat->nb_streams; i++)
+        mFormat->streams[i]->discard = (int)i == mStreamIndex ? AVDISCARD_NONKEY : AVDISCARD_ALL;
+
+    AVStream *st = mFormat->streams[mStreamIndex];
+    if (mFormat->duration != AV_NOPTS_VALUE && mFormat->duration > 0)
+        mDurationUs = mFormat->duration;
+    else if (st->duration != AV_NOPTS_VALUE && st->duration > 0)
+        mDurationUs = av_rescale_q(st->duration, st->time_base, AV_TIME_BASE_Q);
+    else
+        mDurationUs = -1;
+
+    DEBUG("%s: video stream %d, %dx%d, duration %" PRId64 "\n", uri, mStreamIndex,
+        st->codecpar->width, st->codecpar->height, mDurationUs);
+    return MM_ERROR_SUCCESS;
+}
+
+void FrameExtractor::close()
+{
+    if (mCodec)
+        avcodec_free_context(&mCodec);
+    if (mFormat)
+        avformat_close_input(&mFormat);
+    mStreamIndex = -1;
+    mDurationUs = -1;
+}
+
+int32_t FrameExtractor::sourceWidth() const
+{
+    return mStreamIndex < 0 ? 0 : mFormat->streams[mStreamIndex]->codecpar->width;
+}
+
+int32_t FrameExtractor::sourceHeight() const
+{
+    return mStreamIndex < 0 ? 0 : mFormat->streams[mStreamIndex]->codecpar->height;
+}
+
+mm_status_t FrameExtractor::targetSize(const Options &options, int32_t &width, int32_t &height) const
+{
+    AVStream *st = mFormat->streams[mStreamIndex];
+    int64_t srcWidth = st->codecpar->width;
+    int64_t srcHeight = st->codecpar->height;
+    if (srcWidth <= 0 || srcHeight <= 0) {
+        // the stream info was not probed far enough
+        ERROR("%s: unknown video size %" PRId64 "x%" PRId64 "\n", mUri.c_str(), srcWidth, srcHeight);
+        return MM_ERROR_MALFORMED;
+    }
+    AVRational sar = av_guess_sample_aspect_ratio(mFormat, st, NULL);
+    if (sar.num > 0 && sar.den > 0)
+        srcWidth = srcWidth * sar.num / sar.den;
+
+    width = options.width;
+    height = options.height;
+    if (width <= 0 && height <= 0) {
+        width = srcWidth;
+        height = srcHeight;
+    } else if (width <= 0) {
+        width = srcWidth * height / srcHeight;
+    } else if (height <= 0) {
+        height = srcHeight * width / srcWidth;
+    }
+    width = even(width);
+    height = even(height);
+    if (width <= 0 || height <= 0) {
+        ERROR("%s: invalid thumbnail size %dx%d\n", mUri.c_str(), width, height);
+        return MM_ERROR_INVALID_PARAM;
+    }
+    return MM_ERROR_SUCCESS;
+}
+
+void FrameExtractor::targetTimes(const Options &options, std::vector<int64_t> &times) const
+{
+    times.clear();
+    int64_t start = options.startUs > 0 ? options.startUs : 0;
+    if (mDurationUs <= start) {
+        times.push_back(start);
+        return;
+    }
+
+    if (options.intervalUs > 0) {
+        for (int64_t t = start; t < mDurationUs; t += options.intervalUs)
+            times.push_back(t);
+        return;
+    }
+
+    // middle of each of count equal slices, keeps away from the fade-in and the end
+    int32_t count = options.count > 0 ? options.count : 1;
+    int64_t span = mDurationUs - start;
+    for (int32_t i = 0; i < count; i++)
+        times.push_back(start + span * (2 * i + 1) / (2 * count));
+}
+
+mm_status_t FrameExtractor::openCodec_l(const Options &options, int32_t dstWidth, int32_t dstHeight)
+{
+    AVStream *st = mFormat->streams[mStreamIndex];
+    AVCodec *codec = avcodec_find_decoder(st->codecpar->codec_id);
+    if (!codec) {
+        ERROR("%s: no decoder for codec id %d\n", mUri.c_str(), st->codecpar->codec_id);
+        return MM_ERROR_UNSUPPORTED;
+    }
+
+    mCodec = avcodec_alloc_context3(codec);
+    if (!mCodec)
+        return MM_ERROR_NO_MEM;
+    if (avcodec_parameters_to_context(mCodec, st->codecpar) < 0) {
+        avcodec_free_context(&mCodec);
+        return MM_ERROR_UNSUPPORTED;
+    }
+
+    // files are spread over the cores, a single decoder thread avoids the frame delay of
+    // frame threading and keeps the per-thread memory low
+    mCodec->thread_count = 1;
+    mCodec->skip_frame = AVDISCARD_NONKEY;
+
+    AVDictionary *opts = NULL;
+    if (options.fastDecode) {
+        mCodec->skip_loop_filter = AVDISCARD_ALL;
+        mCodec->flags2 |= AV_CODEC_FLAG2_FAST;
+
+        // largest downscale by the decoder that still covers the target
+        int lowres = 0;
+        while (lowres < codec->max_lowres &&
+               (st->codecpar->width >> (lowres + 1)) >= dstWidth &&
+               (st->codecpar->height >> (lowres + 1)) >= dstHeight)
+            lowres++;
+        if (lowres) {
+            DEBUG("%s: decode with lowres %d\n", mUri.c_str(), lowres);
+            av_dict_set_int(&opts, "lowres", lowres, 0);
+        }
+    }
+
+    int ret = avcodec_open2(mCodec, codec, &opts);
+    av_dict_free(&opts);
+    if (ret < 0) {
+        ERROR("%s: open decoder failed: %d\n", mUri.c_str(), ret);
+        avcodec_free_context(&mCodec);
+        return MM_ERROR_UNSUPPORTED;
+    }
+    return MM_ERROR_SUCCESS;
+}
+
+mm_status_t FrameExtractor::decodeKeyFrame(int64_t timeUs, int64_t &frameUs)
+{
+    AVStream *st = mFormat->streams[mStreamIndex];
+    int64_t ts = av_rescale_q(timeUs, AV_TIME_BASE_Q, st->time_base);
+    if (st->start_time != AV_NOPTS_VALUE)
+        ts += st->start_time;
+
+    if (av_seek_frame(mFormat, mStreamIndex, ts, AVSEEK_FLAG_BACKWARD) < 0)
+        DEBUG("%s: seek to %" PRId64 " failed, read on\n", mUri.c_str(), timeUs);
+    avcodec_flush_buffers(mCodec);
+
+    AVPacket pkt;
+    av_init_packet(&pkt);
+    pkt.data = NULL;
+    pkt.size = 0;
+
+    for (int32_t i = 0; i < kMaxPacketsPerSeek; i++) {
+        int ret = av_read_frame(mFormat, &pkt);
+        if (ret < 0)
+            return ret == AVERROR_EOF ? MM_ERROR_EOS : MM_ERROR_IO;
+        if (pkt.stream_index != mStreamIndex || !(pkt.flags & AV_PKT_FLAG_KEY)) {
+            av_free_packet(&pkt);
+            continue;
+        }
+
+        int64_t pktPts = pkt.pts != AV_NOPTS_VALUE ? pkt.pts : pkt.dts;
+        int gotFrame = 0;
+        ret = avcodec_decode_video2(mCodec, mFrame, &gotFrame, &pkt);
+        av_free_packet(&pkt);
+        if (ret >= 0 && !gotFrame) {
+            // reordering decoders hold the keyframe back, drain it out;
+            // the decoder is flushed again on the next seek
+            AVPacket empty;
+            av_init_packet(&empty);
+            empty.data = NULL;
+            empty.size = 0;
+            ret = avcodec_decode_video2(mCodec, mFrame, &gotFrame, &empty);
+        }
+        if (ret < 0 || !gotFrame) {
+            avcodec_flush_buffers(mCodec);
+            continue;
+        }
+
+        int64_t pts = mFrame->best_effort_timestamp;
+        if (pts == AV_NOPTS_VALUE)
+            pts = pktPts;
+        if (pts == AV_NOPTS_VALUE) {
+            frameUs = timeUs;
+        } else {
+            if (st->start_time != AV_NOPTS_VALUE)
+                pts -= st->start_time;
+            frameUs = av_rescale_q(pts, st->time_base, AV_TIME_BASE_Q);
+        }
+        return MM_ERROR_SUCCESS;
+    }
+
+    ERROR("%s: no keyframe within %d packets of %" PRId64 "\n", mUri.c_str(), kMaxPacketsPerSeek, timeUs);
+    return MM_ERROR_MALFORMED;
+}
+
+mm_status_t FrameExtractor::encodeFrame(int32_t width, int32_t height, int32_t quality)
+{
+    // yuvj420p: full range, as jpeg expects
+    mSws = sws_getCachedContext(mSws, mFrame->width, mFrame->height, (AVPixelFormat)mFrame->format,
+                                width, height, AV_PIX_FMT_YUVJ420P, SWS_BILINEAR, NULL, NULL, NULL);
+    if (!mSws) {
+        ERROR("%s: no scaler for %dx%d fmt %d\n", mUri.c_str(), mFrame->width, mFrame->height, mFrame->format);
+        return MM_ERROR_UNSUPPORTED;
+    }
+
+    // planar 4:2:0 without padding, the layout tjCompressFromYUV() takes with pad 1
+    size_t ySize = width * height;
+    size_t cSize = (width / 2) * (height / 2);
+    if (mYuv.size() < ySize + 2 * cSize)
+        mYuv.resize(ySize + 2 * cSize);
+    uint8_t *dst[4] = { &mYuv[0], &mYuv[ySize], &mYuv[ySize + cSize], NULL };
+    int dstStride[4] = { width, width / 2, width / 2, 0 };
+    sws_scale(mSws, (const uint8_t* const*)mFrame->data, mFrame->linesize, 0, mFrame->height, dst, dstStride);
+
+    if (!mJpeg) {
+        mJpeg = tjInitCompress();
+        if (!mJpeg) {
+            ERROR("tjInitCompress failed: %s\n", tjGetErrorStr());
+            return MM_ERROR_NO_MEM;
+        }
+    }
+    // worst case size, kept for the following frames
+    unsigned long needSize = tjBufSize(width, height, TJSAMP_420);
+    if (needSize > mJpegBufSize) {
+        if (mJpegBuf)
+            tjFree(mJpegBuf);
+        mJpegBuf = tjAlloc(needSize);
+        mJpegBufSize = mJpegBuf ? needSize : 0;
+        if (!mJpegBuf)
+            return MM_ERROR_NO_MEM;
+    }
+
+    mJpegSize = mJpegBufSize;
+    int ret = tjCompressFromYUV((tjhandle)mJpeg, &mYuv[0], width, 1, height, TJSAMP_420,
+                                &mJpegBuf, &mJpegSize, quality, TJFLAG_NOREALLOC | TJFLAG_FASTDCT);
+    if (ret < 0) {
+        ERROR("compress to jpeg failed: %s\n", tjGetErrorStr());
+        return MM_ERROR_OP_FAILED;
+    }
+    return MM_ERROR_SUCCESS;
+}
+
+mm_status_t FrameExtractor::extract(const Options &options, Listener *listener, int32_t *frames)
+{
+    if (frames)
+        *frames = 0;
+    if (!mFormat || !listener)
+        return MM_ERROR_INVALID_PARAM;
+
+    int32_t width, height;
+    mm_status_t status = targetSize(options, width, height);
+    if (status != MM_ERROR_SUCCESS)
+        return status;
+    int32_t quality = options.quality > 0 && options.quality <= 100 ? options.quality : kDefaultQuality;
+
+    if (mCodec)
+        avcodec_free_context(&mCodec);
+    status = openCodec_l(options, width, height);
+    if (status != MM_ERROR_SUCCESS)
+        return status;
+    if (!mFrame && !(mFrame = av_frame_alloc()))
+        return MM_ERROR_NO_MEM;
+
+    std::vector<int64_t> times;
+    targetTimes(options, times);
+
+    int32_t count = 0;
+    int64_t lastUs = -1;
+    status = MM_ERROR_SUCCESS;
+    for (size_t i = 0; i < times.size(); i++) {
+        int64_t frameUs = 0;
+        status = decodeKeyFrame(times[i], frameUs);
+        if (status == MM_ERROR_EOS) {
+            // the last slices may map behind the last keyframe
+            status = MM_ERROR_SUCCESS;
+            break;
+        }
+        if (status != MM_ERROR_SUCCESS)
+            break;
+        if (frameUs == lastUs) {
+            av_frame_unref(mFrame);
+            continue;
+        }
+        lastUs = frameUs;
+
+        status = encodeFrame(width, height, quality);
+        av_frame_unref(mFrame);
+        if (status != MM_ERROR_SUCCESS)
+            break;
+        VERBOSE("%s: frame %d at %" PRId64 " (asked %" PRId64 "), jpeg %lu bytes\n",
+            mUri.c_str(), count, frameUs, times[i], mJpegSize);
+        listener->onFrame(mUri.c_str(), count, frameUs, width, height, mJpegBuf, mJpegSize);
+        count++;
+    }
+
+    // the decoder depends on the file, the rest is kept for the next one
+    avcodec_free_context(&mCodec);
+    if (frames)
+        *frames = count;
+    if (status == MM_ERROR_SUCCESS && !count)
+        status = MM_ERROR_MALFORMED;
+    return status;
+}
+
+ThumbnailEngine::Worker::Worker(ThumbnailEngine *engine)
+    : MMThread("ThumbnailWorker")
+    , mEngine(engine)
+{
+}
+
+void ThumbnailEngine::Worker::main()
+{
+    Job job;
+    while (mEngine->nextJob(job)) {
+        int32_t frames = 0;
+        mm_status_t status = mExtractor.open(job.uri.c_str());
+        if (status == MM_ERROR_SUCCESS)
+            status = mExtractor.extract(job.options, job.listener, &frames);
+        mExtractor.close();
+        INFO("%s: %d frames, status %d\n", job.uri.c_str(), frames, status);
+        job.listener->onDone(job.uri.c_str(), status, frames);
+        mEngine->jobDone();
+    }
+}
+
+ThumbnailEngine::ThumbnailEngine(int32_t threads, int32_t maxPending)
+    : mThreadCount(threads)
+    , mMaxPending(maxPending)
+    , mRunning(0)
+    , mStopping(false)
+    , mJobCond(mLock)
+    , mRoomCond(mLock)
+    , mIdleCond(mLock)
+{
+    if (mThreadCount <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        mThreadCount = cpus > 0 ? cpus : 1;
+    }
+    if (mMaxPending <= 0)
+        mMaxPending = mThreadCount * 2;
+}
+
+ThumbnailEngine::~ThumbnailEngine()
+{
+    stop();
+}
+
+mm_status_t ThumbnailEngine::start()
+{
+    MMAutoLock lock(mLock);
+    if (!mWorkers.empty())
+        return MM_ERROR_SUCCESS;
+    mStopping = false;
+    for (int32_t i = 0; i < mThreadCount; i++) {
+        Worker *worker = new Worker(this);
+        if (worker->create()) {
+            ERROR("create worker %d failed\n", i);
+            delete worker;
+            break;
+        }
+        mWorkers.push_back(worker);
+    }
+    if (mWorkers.empty())
+        return MM_ERROR_NO_MEM;
+    INFO("%zu workers, %d pending jobs at most\n", mWorkers.size(), mMaxPending);
+    return MM_ERROR_SUCCESS;
+}
+
+mm_status_t ThumbnailEngine::addJob(const char *uri, const FrameExtractor::Options &options,
+                                   FrameExtractor::Listener *listener)
+{
+    if (!uri || !listener)
+        return MM_ERROR_INVALID_PARAM;
+
+    MMAutoLock lock(mLock);
+    while (!mStopping && !mWorkers.empty() && (int32_t)mJobs.size() >= mMaxPending)
+        mRoomCond.wait();
+    if (mStopping || mWorkers.empty())
+        return MM_ERROR_INVALID_STATE;
+
+    Job job;
+    job.uri = uri;
+    job.options = options;
+    job.listener = listener;
+    mJobs.push_back(job);
+    mJobCond.signal();
+    return MM_ERROR_SUCCESS;
+}
+
+bool ThumbnailEngine::nextJob(Job &job)
+{
+    MMAutoLock lock(mLock);
+    while (!mStopping && mJobs.empty())
+        mJobCond.wait();
+    if (mStopping)
+        return false;
+
+    job = mJobs.front();
+    mJobs.pop_front();
+    mRunning++;
+    mRoomCond.signal();
+    return true;
+}
+
+void ThumbnailEngine::jobDone()
+{
+    MMAutoLock lock(mLock);
+    mRunning--;
+    if (!mRunning && mJobs.empty())
+        mIdleCond.broadcast();
+}
+
+void ThumbnailEngine::waitAll()
+{
+    MMAutoLock lock(mLock);
+    while (!mWorkers.empty() && (mRunning || !mJobs.empty()))
+        mIdleCond.wait();
+}
+
+void ThumbnailEngine::stop()
+{
+    std::vector<Worker*> workers;
+    std::list<Job> dropped;
+    {
+        MMAutoLock lock(mLock);
+        mStopping = true;
+        dropped.swap(mJobs);
+        workers.swap(mWorkers);
+        mJobCond.broadcast();
+        mRoomCond.broadcast();
+        mIdleCond.broadcast();
+    }
+
+    for (size_t i = 0; i < workers.size(); i++) {
+        workers[i]->destroy();
+        delete workers[i];
+    }
+
+    // queued jobs never ran, their listeners still wait for onDone()
+    for (std::list<Job>::iterator it = dropped.begin(); it != dropped.end(); it++)
+        it->listener->onDone(it->uri.c_str(), MM_ERROR_INTERRUPTED, 0);
+}
+
+} // end of YUNOS_MM
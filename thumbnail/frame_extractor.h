@@ -0,0 +1,177 @@
+/**
+ * Copyright (C) 2017 Alibaba Group Holding Limited. All Rights Reserved.
+ *
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __frame_extractor_h
+#define __frame_extractor_h
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <list>
+
+#include <multimedia/mm_errors.h>
+#include <multimedia/mm_cpp_utils.h>
+#include <multimedia/mmthread.h>
+
+struct AVFormatContext;
+struct AVCodecContext;
+struct AVFrame;
+struct SwsContext;
+
+namespace YUNOS_MM {
+
+/*
+ * extracts thumbnails/poster frames of one file at a time, without a player pipeline:
+ * - seeks to the keyframe at or before each requested time, only keyframes are read and decoded
+ * - the decoder runs with lowres (when the codec supports it and the target is small enough)
+ *   and skips the loop filter
+ * - the decoded frame is scaled once to the target size and encoded by turbojpeg
+ * the scaler, the jpeg encoder and the buffers are kept across files, so one extractor per
+ * thread works through a list of files with constant memory.
+ */
+class FrameExtractor {
+public:
+    struct Options {
+        Options();
+
+        // target size; 0 keeps the display aspect ratio of the other one, both 0 is the source size
+        int32_t width;
+        int32_t height;
+        // frames spread evenly over the duration, used when intervalUs <= 0
+        int32_t count;
+        // one frame per interval, starting at startUs
+        int64_t intervalUs;
+        int64_t startUs;
+        // jpeg quality, 1-100
+        int32_t quality;
+        // lowres and no loop filter
+        bool fastDecode;
+    };
+
+    class Listener {
+    public:
+        virtual ~Listener() {}
+        // called from the extracting thread, jpeg is only valid during the call
+        virtual void onFrame(const char *uri, int32_t index, int64_t timeUs,
+                             int32_t width, int32_t height,
+                             const uint8_t *jpeg, size_t size) = 0;
+        // ThumbnailEngine only, after the last onFrame() of the file
+        virtual void onDone(const char *uri, mm_status_t status, int32_t frames) {}
+    };
+
+    FrameExtractor();
+    ~FrameExtractor();
+
+    mm_status_t open(const char *uri);
+    void close();
+
+    int64_t durationUs() const { return mDurationUs; }
+    int32_t sourceWidth() const;
+    int32_t sourceHeight() const;
+
+    // frames is the number of jpegs handed to the listener, consecutive requests
+    // landing on the same keyframe produce it once
+    mm_status_t extract(const Options &options, Listener *listener, int32_t *frames = NULL);
+
+private:
+    mm_status_t openCodec_l(const Options &options, int32_t dstWidth, int32_t dstHeight);
+    mm_status_t targetSize(const Options &options, int32_t &width, int32_t &height) const;
+    void targetTimes(const Options &options, std::vector<int64_t> &times) const;
+    mm_status_t decodeKeyFrame(int64_t timeUs, int64_t &frameUs);
+    mm_status_t encodeFrame(int32_t width, int32_t height, int32_t quality);
+
+    std::string mUri;
+    AVFormatContext *mFormat;
+    AVCodecContext *mCodec;
+    int32_t mStreamIndex;
+    int64_t mDurationUs;
+    AVFrame *mFrame;
+
+    // kept across files
+    SwsContext *mSws;
+    void *mJpeg;
+    std::vector<uint8_t> mYuv;
+    uint8_t *mJpegBuf;
+    unsigned long mJpegBufSize;
+    unsigned long mJpegSize;
+
+    static const char * MM_LOG_TAG;
+
+    MM_DISALLOW_COPY(FrameExtractor);
+};
+
+/*
+ * runs FrameExtractor jobs on a pool of threads, one extractor per thread
+ * - threads <= 0 uses one thread per online cpu
+ * - at most maxPending jobs wait besides the running ones, addJob() blocks until there is room;
+ *   memory is bounded by the thread count whatever the size of the library
+ */
+class ThumbnailEngine {
+public:
+    ThumbnailEngine(int32_t threads = 0, int32_t maxPending = 0);
+    ~ThumbnailEngine();
+
+    mm_status_t start();
+    // listener must stay valid until its onDone(), it is called from the worker threads
+    mm_status_t addJob(const char *uri, const FrameExtractor::Options &options,
+                       FrameExtractor::Listener *listener);
+    // blocks until all jobs added so far are done
+    void waitAll();
+    // drops the queued jobs (onDone() with MM_ERROR_INTERRUPTED), finishes the running ones
+    // and joins the threads
+    void stop();
+
+    int32_t threads() const { return mThreadCount; }
+
+private:
+    struct Job {
+        std::string uri;
+        FrameExtractor::Options options;
+        FrameExtractor::Listener *listener;
+    };
+
+    class Worker : public MMThread {
+    public:
+        explicit Worker(ThumbnailEngine *engine);
+    protected:
+        virtual void main();
+    private:
+        ThumbnailEngine *mEngine;
+        FrameExtractor mExtractor;
+    };
+
+    bool nextJob(Job &job);
+    void jobDone();
+
+    int32_t mThreadCount;
+    int32_t mMaxPending;
+    std::vector<Worker*> mWorkers;
+    std::list<Job> mJobs;
+    int32_t mRunning;
+    bool mStopping;
+    Lock mLock;
+    Condition mJobCond;
+    Condition mRoomCond;
+    Condition mIdleCond;
+
+    static const char * MM_LOG_TAG;
+
+    MM_DISALLOW_COPY(ThumbnailEngine);
+};
+
+} // end of YUNOS_MM
+#endif
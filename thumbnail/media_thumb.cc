@@ -0,0 +1,166 @@
+/**
+ * Copyright (C) 2017 Alibaba Group Holding Limited. All Rights Reserved.
+ *
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <glib.h>
+
+#include "multimedia/mm_debug.h"
+#include "multimedia/mm_cpp_utils.h"
+#include "frame_extractor.h"
+
+MM_LOG_DEFINE_MODULE_NAME("MEDIA-THUMB")
+
+#if 1
+#undef INFO
+#undef ERROR
+#define INFO(format, ...)  fprintf(stderr, "[I] %s, line: %d:" format "\n", __FILE__, __LINE__, ##__VA_ARGS__)
+#define ERROR(format, ...)  fprintf(stderr, "[E] %s, line: %d:" format "\n", __FILE__, __LINE__, ##__VA_ARGS__)
+#endif
+
+using namespace YUNOS_MM;
+
+// command line options
+static gchar **g_files = NULL;
+static const char *g_out_dir = NULL;
+static int32_t g_width = 320;
+static int32_t g_height = 0;
+static int32_t g_count = 1;
+static int32_t g_interval_ms = 0;
+static int32_t g_quality = 80;
+static int32_t g_threads = 0;
+static gboolean g_full_decode = FALSE;
+
+static GOptionEntry entries[] = {
+    {"out", 'o', 0, G_OPTION_ARG_STRING, &g_out_dir, " set the output directory (default is next to each input file)", NULL},
+    {"width", 'w', 0, G_OPTION_ARG_INT, &g_width, "thumbnail width, 0 keeps the aspect ratio of the height (default 320)", NULL},
+    {"height", 'h', 0, G_OPTION_ARG_INT, &g_height, "thumbnail height, 0 keeps the aspect ratio of the width (default 0)", NULL},
+    {"count", 'n', 0, G_OPTION_ARG_INT, &g_count, "frames per file, spread over the duration (default 1)", NULL},
+    {"interval", 'i', 0, G_OPTION_ARG_INT, &g_interval_ms, "one frame every interval ms, overrides count", NULL},
+    {"quality", 'q', 0, G_OPTION_ARG_INT, &g_quality, "jpeg quality (default 80)", NULL},
+    {"threads", 'j', 0, G_OPTION_ARG_INT, &g_threads, "files processed in parallel (default one per cpu)", NULL},
+    {"full_decode", 'f', 0, G_OPTION_ARG_NONE, &g_full_decode, "decode at full resolution with loop filter", NULL},
+    {G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_FILENAME_ARRAY, &g_files, "input files", NULL},
+    {NULL}
+};
+
+class JpegWriter : public FrameExtractor::Listener {
+public:
+    JpegWriter() : mFiles(0), mFailed(0), mFrames(0) {}
+
+    virtual void onFrame(const char *uri, int32_t index, int64_t timeUs,
+                         int32_t width, int32_t height,
+                         const uint8_t *jpeg, size_t size)
+    {
+        std::string name = outName(uri, index);
+        FILE *fp = fopen(name.c_str(), "wb");
+        if (!fp) {
+            ERROR("open %s failed\n", name.c_str());
+            return;
+        }
+        if (fwrite(jpeg, 1, size, fp) != size)
+            ERROR("write %s failed\n", name.c_str());
+        fclose(fp);
+        INFO("%s: %dx%d at %" PRId64 " ms\n", name.c_str(), width, height, timeUs / 1000);
+    }
+
+    virtual void onDone(const char *uri, mm_status_t status, int32_t frames)
+    {
+        MMAutoLock lock(mLock);
+        mFiles++;
+        mFrames += frames;
+        if (status != MM_ERROR_SUCCESS) {
+            mFailed++;
+            ERROR("%s: failed: %d\n", uri, status);
+        }
+    }
+
+    int32_t mFiles;
+    int32_t mFailed;
+    int32_t mFrames;
+
+private:
+    std::string outName(const char *uri, int32_t index)
+    {
+        std::string name(uri);
+        if (g_out_dir) {
+            const char *base = strrchr(uri, '/');
+            name = g_out_dir;
+            name += "/";
+            name += base ? base + 1 : uri;
+        }
+        char suffix[32];
+        snprintf(suffix, sizeof(suffix), ".%03d.jpg", index);
+        return name + suffix;
+    }
+
+    Lock mLock;
+};
+
+int main(int argc, char* argv[]) {
+    GError *error = NULL;
+    GOptionContext *context;
+
+    context = g_option_context_new("FILE... - extract jpeg thumbnails of video files");
+    g_option_context_add_main_entries(context, entries, NULL);
+    g_option_context_set_help_enabled(context, TRUE);
+
+    if (!g_option_context_parse(context, &argc, &argv, &error)) {
+        ERROR("option parsing failed: %s\n", error->message);
+        g_error_free(error);
+        g_option_context_free(context);
+        return -1;
+    }
+    g_option_context_free(context);
+
+    if (!g_files || !g_files[0]) {
+        ERROR("no input file\n");
+        return -1;
+    }
+
+    FrameExtractor::Options options;
+    options.width = g_width;
+    options.height = g_height;
+    options.count = g_count;
+    options.intervalUs = (int64_t)g_interval_ms * 1000;
+    options.quality = g_quality;
+    options.fastDecode = !g_full_decode;
+
+    JpegWriter writer;
+    ThumbnailEngine engine(g_threads);
+    if (engine.start() != MM_ERROR_SUCCESS) {
+        ERROR("failed to start the engine\n");
+        g_strfreev(g_files);
+        return -1;
+    }
+
+    int64_t beginUs = getTimeUs();
+    for (int i = 0; g_files[i]; i++) {
+        if (engine.addJob(g_files[i], options, &writer) != MM_ERROR_SUCCESS)
+            ERROR("%s: not queued\n", g_files[i]);
+    }
+    engine.waitAll();
+    engine.stop();
+
+    INFO("%d files, %d failed, %d frames in %" PRId64 " ms with %d threads\n",
+        writer.mFiles, writer.mFailed, writer.mFrames, (getTimeUs() - beginUs) / 1000, engine.threads());
+    g_strfreev(g_files);
+    return writer.mFailed ? 1 : 0;
+}
@@ -0,0 +1,63 @@
+#############################################################################
+# Copyright (C) 2015-2017 Alibaba Group Holding Limited. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#    http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#############################################################################
+
+
+LOCAL_PATH:=$(call my-dir)
+MM_ROOT_PATH:= $(LOCAL_PATH)/../
+
+#### libmmthumbnail
+include $(CLEAR_VARS)
+include $(MM_ROOT_PATH)/base/build/build.mk
+
+LOCAL_SRC_FILES:= frame_extractor.cc
+
+LOCAL_C_INCLUDES += \
+    $(MM_INCLUDE) \
+    $(MM_COW_INCLUDE) \
+    $(base-includes) \
+    $(libav-includes) \
+    $(libjpeg-turbo-includes)
+
+LOCAL_SHARED_LIBRARIES += libmmbase
+
+LOCAL_LDFLAGS += -lstdc++ -lpthread
+REQUIRE_LIBAV = 1
+REQUIRE_LIBJPEG_TURBO = 1
+include $(MM_ROOT_PATH)/base/build/xmake_req_libs.mk
+
+LOCAL_MODULE:= libmmthumbnail
+
+include $(BUILD_SHARED_LIBRARY)
+
+#### media thumbnail tool
+include $(CLEAR_VARS)
+include $(MM_ROOT_PATH)/base/build/build.mk
+
+LOCAL_SRC_FILES:= media_thumb.cc
+
+LOCAL_C_INCLUDES += \
+    $(MM_INCLUDE) \
+    $(base-includes) \
+    $(glib-includes)
+
+LOCAL_SHARED_LIBRARIES += libmmbase libmmthumbnail libglib-2.0
+
+LOCAL_LDFLAGS += -lstdc++ -lpthread -lglib-2.0
+include $(MM_ROOT_PATH)/base/build/xmake_req_libs.mk
+
+LOCAL_MODULE:= media-thumb
+
+include $(BUILD_EXECUTABLE)
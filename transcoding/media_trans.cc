@@ -18,6 +18,7 @@
 #include <unistd.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <inttypes.h>
 #include <gtest/gtest.h>
 
 #include "multimedia/mediaplayer.h"
@@ -26,6 +27,8 @@
 #include "multimedia/media_meta.h"
 #include "multimedia/media_attr_str.h"
 #include "mmwakelocker.h"
+#include "seg_transcoder.h"
+#include "stream_remuxer.h"
 #include <getopt.h>
 #include <glib.h>
 
@@ -59,13 +62,25 @@ const char *g_out_video_file_path = NULL;
 static uint32_t g_trans_mode = 1;
 static uint32_t g_encode_video_width = 0;
 static uint32_t g_encode_video_height = 0;
+static int32_t g_threads = 0;
+static gboolean g_use_pipeline = FALSE;
+static gint64 g_start_ms = -1;
+static gint64 g_end_ms = -1;
+int32_t g_segment_ms = 0;
+int32_t g_segment_part_ms = 0;
 
 static GOptionEntry entries[] = {
     {"add", 'a', 0, G_OPTION_ARG_STRING, &g_video_file_path, " set the file name to convert", NULL},
     {"out", 'o', 0, G_OPTION_ARG_STRING, &g_out_video_file_path, " set the output file name", NULL},
-    {"video_transcode_mode", 'm', 0, G_OPTION_ARG_INT, &g_trans_mode, "process mode: 1: remux, 2: video transcoding", NULL},
+    {"video_transcode_mode", 'm', 0, G_OPTION_ARG_INT, &g_trans_mode, "process mode: 1: remux, 2: video transcoding, 3: parallel video transcoding", NULL},
     {"encode_video_width", 'w', 0, G_OPTION_ARG_INT, &g_encode_video_width, "set scaled video width (default is input video width)", NULL},
     {"encode_video_height", 'h', 0, G_OPTION_ARG_INT, &g_encode_video_height, "scaled video height(default is input video height)", NULL},
+    {"threads", 'j', 0, G_OPTION_ARG_INT, &g_threads, "threads of mode 3 (default one per cpu)", NULL},
+    {"pipeline", 'p', 0, G_OPTION_ARG_NONE, &g_use_pipeline, "remux with the component pipeline instead of the stream copy loop", NULL},
+    {"start", 's', 0, G_OPTION_ARG_INT64, &g_start_ms, "remux from this time in ms (at the key frame before it)", NULL},
+    {"end", 'e', 0, G_OPTION_ARG_INT64, &g_end_ms, "remux up to this time in ms", NULL},
+    {"segment", 'g', 0, G_OPTION_ARG_INT, &g_segment_ms, "pipeline modes: HLS/DASH segments of this duration in ms, the output is a directory", NULL},
+    {"part", 'r', 0, G_OPTION_ARG_INT, &g_segment_part_ms, "low latency HLS parts of this duration in ms, with --segment", NULL},
     {NULL}
 };
 
@@ -241,10 +256,34 @@ int main(int argc, char* const argv[]) {
     INFO("input file is: %s", g_video_file_path);
     if (!g_out_video_file_path) {
         outFileName = g_video_file_path;
-        outFileName += ".tr.mp4";
+        outFileName += g_segment_ms > 0 ? ".tr" : ".tr.mp4";
         g_out_video_file_path = outFileName.c_str();
     }
 
+    if (g_trans_mode == 1 && !g_use_pipeline) {
+        StreamRemuxer::Options options;
+        options.startUs = g_start_ms >= 0 ? g_start_ms * 1000 : -1;
+        options.endUs = g_end_ms >= 0 ? g_end_ms * 1000 : -1;
+
+        StreamRemuxer remuxer;
+        mm_status_t status = remuxer.remux(g_video_file_path, g_out_video_file_path, options);
+        return status == MM_ERROR_SUCCESS ? 0 : -1;
+    }
+
+    if (g_trans_mode == 3) {
+        SegmentTranscoder::Options options;
+        options.width = g_encode_video_width;
+        options.height = g_encode_video_height;
+        options.threads = g_threads;
+
+        SegmentTranscoder transcoder;
+        int64_t beginUs = getTimeUs();
+        mm_status_t status = transcoder.transcode(g_video_file_path, g_out_video_file_path, options);
+        INFO("%s: %d segments, status %d, %" PRId64 " ms\n", g_out_video_file_path,
+            transcoder.segmentCount(), status, (getTimeUs() - beginUs) / 1000);
+        return status == MM_ERROR_SUCCESS ? 0 : -1;
+    }
+
     try {
         ::testing::InitGoogleTest(&argc, (char **)argv);
         ret = RUN_ALL_TESTS();
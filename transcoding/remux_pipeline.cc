@@ -66,6 +66,18 @@ mm_status_t RemuxPipeline::prepareInternal()//audio source is followed by video
     mediaMetaFile->setString(MEDIA_ATTR_OUTPUT_FORMAT, "mp4");
     mediaMetaFile->setString(MEDIA_ATTR_FILE_PATH, "/tmp/remux.mp4");
 
+    // live segments and playlists in the output directory (--out)
+    extern int32_t g_segment_ms;
+    extern int32_t g_segment_part_ms;
+    const char * sinkMime = "media/file-sink";
+    if (g_segment_ms > 0) {
+        extern const char *g_out_video_file_path;
+        mediaMetaFile->setString(MEDIA_ATTR_FILE_PATH, g_out_video_file_path);
+        mediaMetaFile->setInt32(MEDIA_ATTR_SEGMENT_DURATION, g_segment_ms);
+        mediaMetaFile->setInt32(MEDIA_ATTR_SEGMENT_PART_DURATION, g_segment_part_ms);
+        sinkMime = "media/segmenter-sink";
+    }
+
     // MMAutoLock locker(mLock); NO big lock
     setState(mState, kComponentStatePreparing);
     PlaySourceComponent* source = getSourceComponent();
@@ -190,7 +202,7 @@ mm_status_t RemuxPipeline::prepareInternal()//audio source is followed by video
     }
 
     while(status == MM_ERROR_SUCCESS) {
-        fileSink = createComponentHelper(NULL, "media/file-sink");
+        fileSink = createComponentHelper(NULL, sinkMime);
         if (!fileSink) {
             ERROR("fail to create file sink to write data");
             notify(Component::kEventError, MM_ERROR_COMPONENT_CONNECT_FAILED, 0, nilParam);
@@ -0,0 +1,783 @@
+/**
+ * Copyright (C) 2017 Alibaba Group Holding Limited. All Rights Reserved.
+ *
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <algorithm>
+
+extern "C" {
+#ifndef __STDC_FORMAT_MACROS
+#define __STDC_FORMAT_MACROS
+#endif
+#ifndef __STDC_CONSTANT_MACROS
+#define __STDC_CONSTANT_MACROS
+#endif
+#ifndef __STDC_LIMIT_MACROS
+#define __STDC_LIMIT_MACROS
+#endif
+#include <inttypes.h>
+#include <stdint.h>
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libavutil/opt.h>
+#include <libswscale/swscale.h>
+}
+
+#include <multimedia/mm_debug.h>
+#include <multimedia/av_ffmpeg_helper.h>
+
+#include "seg_transcoder.h"
+
+namespace YUNOS_MM {
+
+DEFINE_LOGTAG(SegmentTranscoder)
+
+static const int32_t kSegmentsPerThread = 4;
+// encoded segments waiting for the muxer, per thread
+static const int32_t kPendingPerThread = 2;
+// as VideoEncodeFFmpeg
+static const char * kDefaultPreset = "slow";
+static const int32_t kDefaultCRF = 40;
+static const int32_t kCRFMin = 0;
+static const int32_t kCRFMax = 51;
+
+static pthread_once_t s_av_once = PTHREAD_ONCE_INIT;
+static void av_init_once()
+{
+    avcodec_register_all();
+    av_register_all();
+}
+
+static int32_t even(int32_t v)
+{
+    v &= ~1;
+    return v < 2 ? 2 : v;
+}
+
+SegmentTranscoder::Options::Options()
+    : width(0)
+    , height(0)
+    , threads(0)
+    , gop(0)
+    , preset(kDefaultPreset)
+    , crf(kDefaultCRF)
+{
+}
+
+SegmentTranscoder::Segment::Segment()
+    : startTs(0)
+    , startPos(-1)
+    , endTs(INT64_MAX)
+    , endPos(-1)
+    , status(MM_ERROR_SUCCESS)
+    , done(false)
+{
+}
+
+SegmentTranscoder::Segment::~Segment()
+{
+    for (size_t i = 0; i < packets.size(); i++)
+        av_packet_free(&packets[i]);
+}
+
+SegmentTranscoder::Worker::Worker(SegmentTranscoder *owner)
+    : MMThread("SegTranscode")
+    , mOwner(owner)
+{
+}
+
+void SegmentTranscoder::Worker::main()
+{
+    int32_t index;
+    while ((index = mOwner->nextSegment()) >= 0) {
+        Segment *seg = mOwner->mSegments[index];
+        int64_t beginUs = getTimeUs();
+        mm_status_t status = mOwner->transcodeSegment(*seg);
+        INFO("segment %d: %zu packets in %" PRId64 " ms, status %d\n",
+            index, seg->packets.size(), (getTimeUs() - beginUs) / 1000, status);
+        mOwner->segmentDone(*seg, status);
+    }
+}
+
+SegmentTranscoder::SegmentTranscoder()
+    : mIn(NULL)
+    , mOut(NULL)
+    , mOutFormat(NULL)
+    , mVideoStream(-1)
+    , mAudioStream(-1)
+    , mOutVideoStream(-1)
+    , mOutAudioStream(-1)
+    , mWidth(0)
+    , mHeight(0)
+    , mGop(0)
+    , mLastVideoDts(AV_NOPTS_VALUE)
+    , mLastAudioDts(AV_NOPTS_VALUE)
+    , mLastAudioUs(INT64_MIN)
+    , mAudioEOS(true)
+    , mVideoParams(NULL)
+    , mSegmentCount(0)
+    , mNextSegment(0)
+    , mMuxedSegments(0)
+    , mAbort(false)
+    , mDoneCond(mLock)
+{
+    pthread_once(&s_av_once, av_init_once);
+}
+
+SegmentTranscoder::~SegmentTranscoder()
+{
+    closeAll();
+}
+
+mm_status_t SegmentTranscoder::transcode(const char *input, const char *output, const Options &options)
+{
+    if (!input || !output)
+        return MM_ERROR_INVALID_PARAM;
+
+    closeAll();
+    mInput = input;
+    mOutput = output;
+    mOptions = options;
+
+    std::string presetString = mm_get_env_str("mm.venc.preset", "MM_VENC_PRESET");
+    if (!presetString.empty())
+        mOptions.preset = presetString;
+    std::string crfString = mm_get_env_str("mm.venc.crf", "MM_VENC_CRF");
+    if (!crfString.empty())
+        mOptions.crf = atoi(crfString.c_str());
+    mOptions.crf = std::min(std::max(mOptions.crf, kCRFMin), kCRFMax);
+    if (mOptions.threads <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        mOptions.threads = cpus > 0 ? cpus : 1;
+    }
+
+    int64_t beginUs = getTimeUs();
+    mSegmentCount = 0;
+    mOutFormat = av_guess_format(NULL, mOutput.c_str(), NULL);
+    if (!mOutFormat)
+        mOutFormat = av_guess_format("mp4", NULL, NULL);
+    if (!mOutFormat) {
+        ERROR("%s: no muxer\n", mOutput.c_str());
+        return MM_ERROR_UNSUPPORTED;
+    }
+
+    mm_status_t status = openInput();
+    if (status == MM_ERROR_SUCCESS)
+        status = splitSegments();
+    mSegmentCount = mSegments.size();
+    if (status != MM_ERROR_SUCCESS) {
+        closeAll();
+        return status;
+    }
+
+    std::vector<Worker*> workers;
+    int32_t threads = std::min(mOptions.threads, (int32_t)mSegments.size());
+    for (int32_t i = 0; i < threads; i++) {
+        Worker *worker = new Worker(this);
+        if (worker->create()) {
+            ERROR("create worker %d failed\n", i);
+            delete worker;
+            break;
+        }
+        workers.push_back(worker);
+    }
+    INFO("%s: %zu segments on %zu threads, %dx%d gop %d preset %s crf %d\n", mInput.c_str(),
+        mSegments.size(), workers.size(), mWidth, mHeight, mGop, mOptions.preset.c_str(), mOptions.crf);
+
+    if (workers.empty())
+        status = MM_ERROR_NO_MEM;
+    else
+        status = muxSegments();
+
+    {
+        MMAutoLock lock(mLock);
+        if (status != MM_ERROR_SUCCESS)
+            mAbort = true;
+        mDoneCond.broadcast();
+    }
+    for (size_t i = 0; i < workers.size(); i++) {
+        workers[i]->destroy();
+        delete workers[i];
+    }
+
+    INFO("%s -> %s: status %d, %" PRId64 " ms\n", mInput.c_str(), mOutput.c_str(), status,
+        (getTimeUs() - beginUs) / 1000);
+    closeAll();
+    return status;
+}
+
+mm_status_t SegmentTranscoder::openInput()
+{
+    int ret = avformat_open_input(&mIn, mInput.c_str(), NULL, NULL);
+    if (ret < 0) {
+        ERROR("%s: open failed: %d\n", mInput.c_str(), ret);
+        mIn = NULL;
+        return MM_ERROR_IO;
+    }
+    if (avformat_find_stream_info(mIn, NULL) < 0) {
+        ERROR("%s: find stream info failed\n", mInput.c_str());
+        return MM_ERROR_UNSUPPORTED;
+    }
+
+    mVideoStream = av_find_best_stream(mIn, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
+    if (mVideoStream < 0) {
+        ERROR("%s: no video stream\n", mInput.c_str());
+        return MM_ERROR_UNSUPPORTED;
+    }
+    mAudioStream = av_find_best_stream(mIn, AVMEDIA_TYPE_AUDIO, -1, mVideoStream, NULL, 0);
+    if (mAudioStream < 0)
+        mAudioStream = -1;
+
+    AVStream *st = mIn->streams[mVideoStream];
+    int64_t srcWidth = st->codecpar->width;
+    int64_t srcHeight = st->codecpar->height;
+    if (srcWidth <= 0 || srcHeight <= 0)
+        return MM_ERROR_UNSUPPORTED;
+    mWidth = mOptions.width;
+    mHeight = mOptions.height;
+    if (mWidth <= 0 && mHeight <= 0) {
+        mWidth = srcWidth;
+        mHeight = srcHeight;
+    } else if (mWidth <= 0) {
+        mWidth = srcWidth * mHeight / srcHeight;
+    } else if (mHeight <= 0) {
+        mHeight = srcHeight * mWidth / srcWidth;
+    }
+    mWidth = even(mWidth);
+    mHeight = even(mHeight);
+
+    AVRational fr = av_guess_frame_rate(mIn, st, NULL);
+    double fps = fr.num > 0 && fr.den > 0 ? av_q2d(fr) : 25.0;
+    mGop = mOptions.gop > 0 ? mOptions.gop : (int32_t)(fps * 2 + 0.5);
+    return MM_ERROR_SUCCESS;
+}
+
+/* key frames come from the index of the container (mp4, mkv, ...); without one they are
+ * scanned, with the non key frames discarded by the demuxer.
+ * segments start at the key frame nearest after each 1/n of the duration.
+ */
+mm_status_t SegmentTranscoder::splitSegments()
+{
+    AVStream *st = mIn->streams[mVideoStream];
+    std::vector<std::pair<int64_t, int64_t> > keys; // ts, pos
+    for (int i = 0; i < st->nb_index_entries; i++) {
+        if (st->index_entries[i].flags & AVINDEX_KEYFRAME)
+            keys.push_back(std::make_pair(st->index_entries[i].timestamp, st->index_entries[i].pos));
+    }
+
+    if (keys.size() < 2) {
+        DEBUG("%s: no usable index, scan key frames\n", mInput.c_str());
+        keys.clear();
+        for (unsigned int i = 0; i < mIn->nb_streams; i++)
+            mIn->streams[i]->discard = (int)i == mVideoStream ? AVDISCARD_NONKEY : AVDISCARD_ALL;
+
+        AVPacket pkt;
+        av_init_packet(&pkt);
+        pkt.data = NULL;
+        pkt.size = 0;
+        while (av_read_frame(mIn, &pkt) >= 0) {
+            int64_t ts = pkt.dts != AV_NOPTS_VALUE ? pkt.dts : pkt.pts;
+            if (pkt.stream_index == mVideoStream && (pkt.flags & AV_PKT_FLAG_KEY) && ts != AV_NOPTS_VALUE)
+                keys.push_back(std::make_pair(ts, pkt.pos));
+            av_free_packet(&pkt);
+        }
+
+        for (unsigned int i = 0; i < mIn->nb_streams; i++)
+            mIn->streams[i]->discard = AVDISCARD_DEFAULT;
+        av_seek_frame(mIn, -1, mIn->start_time != AV_NOPTS_VALUE ? mIn->start_time : 0, AVSEEK_FLAG_BACKWARD);
+    }
+    if (keys.empty()) {
+        ERROR("%s: no key frame\n", mInput.c_str());
+        return MM_ERROR_MALFORMED;
+    }
+    std::sort(keys.begin(), keys.end());
+
+    int32_t count = std::min((int32_t)keys.size(), mOptions.threads * kSegmentsPerThread);
+    int64_t first = keys.front().first;
+    int64_t span = keys.back().first - first;
+    size_t prev = 0;
+    std::vector<size_t> starts;
+    starts.push_back(0);
+    for (int32_t i = 1; i < count; i++) {
+        int64_t target = first + span * i / count;
+        size_t k = prev + 1;
+        while (k < keys.size() && keys[k].first < target)
+            k++;
+        if (k >= keys.size())
+            break;
+        starts.push_back(k);
+        prev = k;
+    }
+
+    for (size_t i = 0; i < starts.size(); i++) {
+        Segment *seg = new Segment();
+        seg->startTs = keys[starts[i]].first;
+        seg->startPos = keys[starts[i]].second;
+        if (i + 1 < starts.size()) {
+            seg->endTs = keys[starts[i + 1]].first;
+            seg->endPos = keys[starts[i + 1]].second;
+        }
+        mSegments.push_back(seg);
+    }
+    return MM_ERROR_SUCCESS;
+}
+
+int32_t SegmentTranscoder::nextSegment()
+{
+    MMAutoLock lock(mLock);
+    // bounded memory: encoded segments wait for the muxer in order
+    while (!mAbort && mNextSegment < (int32_t)mSegments.size() &&
+           mNextSegment - mMuxedSegments >= mOptions.threads * kPendingPerThread)
+        mDoneCond.wait();
+    if (mAbort || mNextSegment >= (int32_t)mSegments.size())
+        return -1;
+    return mNextSegment++;
+}
+
+void SegmentTranscoder::segmentDone(Segment &seg, mm_status_t status)
+{
+    MMAutoLock lock(mLock);
+    seg.status = status;
+    seg.done = true;
+    if (status != MM_ERROR_SUCCESS)
+        mAbort = true;
+    mDoneCond.broadcast();
+}
+
+mm_status_t SegmentTranscoder::openEncoder(AVCodecContext *&encoder)
+{
+    AVCodec *codec = avcodec_find_encoder(AV_CODEC_ID_H264);
+    if (!codec) {
+        ERROR("no h264 encoder\n");
+        return MM_ERROR_UNSUPPORTED;
+    }
+    encoder = avcodec_alloc_context3(codec);
+    if (!encoder)
+        return MM_ERROR_NO_MEM;
+
+    AVStream *st = mIn->streams[mVideoStream];
+    encoder->width = mWidth;
+    encoder->height = mHeight;
+    encoder->pix_fmt = AV_PIX_FMT_YUV420P;
+    encoder->time_base = st->time_base;
+    encoder->framerate = av_guess_frame_rate(mIn, st, NULL);
+    encoder->sample_aspect_ratio = st->codecpar->sample_aspect_ratio;
+    // one thread per segment, the segments are what runs in parallel
+    encoder->thread_count = 1;
+    // fixed closed GOPs, every segment starts with the same IDR/SPS/PPS
+    encoder->gop_size = mGop;
+    encoder->keyint_min = mGop;
+    encoder->flags |= AV_CODEC_FLAG_CLOSED_GOP;
+    // mp4 and the like take SPS/PPS from extradata, ts keeps them in band
+    if (mOutFormat->flags & AVFMT_GLOBALHEADER)
+        encoder->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+
+    AVDictionary *opts = NULL;
+    av_dict_set(&opts, "preset", mOptions.preset.c_str(), 0);
+    av_dict_set(&opts, "sc_threshold", "0", 0);
+    av_opt_set_int(encoder, "crf", mOptions.crf, AV_OPT_SEARCH_CHILDREN);
+
+    int ret = avcodec_open2(encoder, codec, &opts);
+    av_dict_free(&opts);
+    if (ret < 0) {
+        ERROR("open h264 encoder failed: %d\n", ret);
+        avcodec_free_context(&encoder);
+        return MM_ERROR_UNSUPPORTED;
+    }
+    return MM_ERROR_SUCCESS;
+}
+
+mm_status_t SegmentTranscoder::transcodeSegment(Segment &seg)
+{
+    AVFormatContext *in = NULL;
+    AVCodecContext *decoder = NULL;
+    AVCodecContext *encoder = NULL;
+    SwsContext *sws = NULL;
+    AVFrame *frame = av_frame_alloc();
+    AVFrame *scaled = NULL;
+    mm_status_t status = MM_ERROR_SUCCESS;
+    int64_t startPts = AV_NOPTS_VALUE;
+    int64_t endPts = AV_NOPTS_VALUE;
+    bool inputEOS = false;
+
+    AVPacket pkt;
+    av_init_packet(&pkt);
+    pkt.data = NULL;
+    pkt.size = 0;
+
+    do { // make it easier to break to the end of func
+        if (!frame) {
+            status = MM_ERROR_NO_MEM;
+            break;
+        }
+        if (avformat_open_input(&in, mInput.c_str(), NULL, NULL) < 0 ||
+            avformat_find_stream_info(in, NULL) < 0) {
+            ERROR("%s: reopen failed\n", mInput.c_str());
+            status = MM_ERROR_IO;
+            break;
+        }
+        for (unsigned int i = 0; i < in->nb_streams; i++)
+            in->streams[i]->discard = (int)i == mVideoStream ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
+        AVStream *st = in->streams[mVideoStream];
+
+        AVCodec *codec = avcodec_find_decoder(st->codecpar->codec_id);
+        decoder = codec ? avcodec_alloc_context3(codec) : NULL;
+        if (!decoder || avcodec_parameters_to_context(decoder, st->codecpar) < 0) {
+            status = MM_ERROR_UNSUPPORTED;
+            break;
+        }
+        decoder->thread_count = 1;
+        if (avcodec_open2(decoder, codec, NULL) < 0) {
+            ERROR("open decoder failed\n");
+            status = MM_ERROR_UNSUPPORTED;
+            break;
+        }
+
+        status = openEncoder(encoder);
+        if (status != MM_ERROR_SUCCESS)
+            break;
+        seg.extraData.assign((const char*)encoder->extradata, encoder->extradata_size);
+        {
+            MMAutoLock lock(mLock);
+            if (!mVideoParams) {
+                mVideoParams = avcodec_parameters_alloc();
+                if (mVideoParams)
+                    avcodec_parameters_from_context(mVideoParams, encoder);
+            }
+        }
+
+        if (av_seek_frame(in, mVideoStream, seg.startTs, AVSEEK_FLAG_BACKWARD) < 0)
+            WARNING("seek to %" PRId64 " failed, read from the start\n", seg.startTs);
+
+        // decodes up to the first key frame after the end, the frames shown before the end
+        // may come after the end key frame in decode order
+        while (status == MM_ERROR_SUCCESS) {
+            AVPacket *in_pkt = &pkt;
+            if (!inputEOS) {
+                if (av_read_frame(in, &pkt) < 0) {
+                    inputEOS = true;
+                } else if (pkt.stream_index != mVideoStream) {
+                    av_free_packet(&pkt);
+                    continue;
+                } else {
+                    bool key = pkt.flags & AV_PKT_FLAG_KEY;
+                    int64_t ts = pkt.dts != AV_NOPTS_VALUE ? pkt.dts : pkt.pts;
+                    if (startPts == AV_NOPTS_VALUE) {
+                        if (!key) {
+                            av_free_packet(&pkt);
+                            continue;
+                        }
+                        startPts = pkt.pts != AV_NOPTS_VALUE ? pkt.pts : ts;
+                    } else if (key && endPts == AV_NOPTS_VALUE &&
+                               ((seg.endPos >= 0 && pkt.pos == seg.endPos) || ts >= seg.endTs)) {
+                        endPts = pkt.pts != AV_NOPTS_VALUE ? pkt.pts : ts;
+                    } else if (key && endPts != AV_NOPTS_VALUE) {
+                        av_free_packet(&pkt);
+                        inputEOS = true;
+                    }
+                }
+            }
+            if (inputEOS) {
+                av_init_packet(&pkt);
+                pkt.data = NULL;
+                pkt.size = 0;
+            }
+
+            int gotFrame = 0;
+            int ret = avcodec_decode_video2(decoder, frame, &gotFrame, in_pkt);
+            av_free_packet(&pkt);
+            if (ret < 0 && !inputEOS) {
+                WARNING("decode error %d, skip\n", ret);
+                continue;
+            }
+            if (!gotFrame) {
+                if (inputEOS)
+                    break;
+                continue;
+            }
+
+            int64_t pts = frame->best_effort_timestamp;
+            if (pts == AV_NOPTS_VALUE || pts < startPts ||
+                (endPts != AV_NOPTS_VALUE && pts >= endPts)) {
+                av_frame_unref(frame);
+                continue;
+            }
+
+            AVFrame *src = frame;
+            if (frame->width != mWidth || frame->height != mHeight || frame->format != AV_PIX_FMT_YUV420P) {
+                sws = sws_getCachedContext(sws, frame->width, frame->height, (AVPixelFormat)frame->format,
+                                           mWidth, mHeight, AV_PIX_FMT_YUV420P, SWS_BICUBIC, NULL, NULL, NULL);
+                if (!scaled) {
+                    scaled = av_frame_alloc();
+                    if (scaled) {
+                        scaled->format = AV_PIX_FMT_YUV420P;
+                        scaled->width = mWidth;
+                        scaled->height = mHeight;
+                        if (av_frame_get_buffer(scaled, 32) < 0)
+                            av_frame_free(&scaled);
+                    }
+                }
+                if (!sws || !scaled) {
+                    status = MM_ERROR_NO_MEM;
+                    av_frame_unref(frame);
+                    break;
+                }
+                // the encoder may still reference the last picture
+                if (av_frame_make_writable(scaled) < 0) {
+                    status = MM_ERROR_NO_MEM;
+                    av_frame_unref(frame);
+                    break;
+                }
+                sws_scale(sws, (const uint8_t* const*)frame->data, frame->linesize, 0, frame->height,
+                          scaled->data, scaled->linesize);
+                src = scaled;
+            }
+            src->pts = pts;
+            src->pict_type = AV_PICTURE_TYPE_NONE;
+
+            AVPacket *out = av_packet_alloc();
+            int gotPacket = 0;
+            ret = out ? avcodec_encode_video2(encoder, out, src, &gotPacket) : AVERROR(ENOMEM);
+            av_frame_unref(frame);
+            if (ret < 0) {
+                ERROR("encode failed: %d\n", ret);
+                av_packet_free(&out);
+                status = MM_ERROR_OP_FAILED;
+                break;
+            }
+            if (gotPacket)
+                seg.packets.push_back(out);
+            else
+                av_packet_free(&out);
+        }
+
+        // drain the encoder
+        while (status == MM_ERROR_SUCCESS) {
+            AVPacket *out = av_packet_alloc();
+            int gotPacket = 0;
+            if (!out || avcodec_encode_video2(encoder, out, NULL, &gotPacket) < 0 || !gotPacket) {
+                av_packet_free(&out);
+                break;
+            }
+            seg.packets.push_back(out);
+        }
+    } while (0);
+
+    if (status == MM_ERROR_SUCCESS && seg.packets.empty()) {
+        ERROR("segment %" PRId64 ": no frame encoded\n", seg.startTs);
+        status = MM_ERROR_MALFORMED;
+    }
+
+    av_frame_free(&scaled);
+    av_frame_free(&frame);
+    if (sws)
+        sws_freeContext(sws);
+    avcodec_free_context(&encoder);
+    avcodec_free_context(&decoder);
+    if (in)
+        avformat_close_input(&in);
+    return status;
+}
+
+mm_status_t SegmentTranscoder::openOutput()
+{
+    int ret = avformat_alloc_output_context2(&mOut, mOutFormat, NULL, mOutput.c_str());
+    if (ret < 0 || !mOut) {
+        ERROR("%s: no muxer\n", mOutput.c_str());
+        return MM_ERROR_UNSUPPORTED;
+    }
+
+    AVStream *vs = avformat_new_stream(mOut, NULL);
+    if (!vs || !mVideoParams || avcodec_parameters_copy(vs->codecpar, mVideoParams) < 0)
+        return MM_ERROR_NO_MEM;
+    vs->time_base = mIn->streams[mVideoStream]->time_base;
+    mOutVideoStream = vs->index;
+
+    if (mAudioStream >= 0) {
+        AVStream *as = avformat_new_stream(mOut, NULL);
+        if (!as || avcodec_parameters_copy(as->codecpar, mIn->streams[mAudioStream]->codecpar) < 0)
+            return MM_ERROR_NO_MEM;
+        as->codecpar->codec_tag = 0;
+        as->time_base = mIn->streams[mAudioStream]->time_base;
+        mOutAudioStream = as->index;
+
+        for (unsigned int i = 0; i < mIn->nb_streams; i++)
+            mIn->streams[i]->discard = (int)i == mAudioStream ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
+        mAudioEOS = false;
+    }
+
+    if (!(mOut->oformat->flags & AVFMT_NOFILE)) {
+        ret = avio_open(&mOut->pb, mOutput.c_str(), AVIO_FLAG_WRITE);
+        if (ret < 0) {
+            ERROR("%s: open failed: %d\n", mOutput.c_str(), ret);
+            return MM_ERROR_IO;
+        }
+    }
+    ret = avformat_write_header(mOut, NULL);
+    if (ret < 0) {
+        ERROR("%s: write header failed: %d\n", mOutput.c_str(), ret);
+        return MM_ERROR_IO;
+    }
+    return MM_ERROR_SUCCESS;
+}
+
+/* timestamps keep the input timeline less its start time; the first packets of a segment
+ * encoder may repeat the last dts of the previous one, dts is kept strictly increasing.
+ */
+mm_status_t SegmentTranscoder::writePacket(AVPacket *pkt, int32_t inStream, int32_t outStream, int64_t &lastDts)
+{
+    AVRational tb = mIn->streams[inStream]->time_base;
+    if (mIn->start_time != AV_NOPTS_VALUE) {
+        int64_t shift = av_rescale_q(mIn->start_time, AV_TIME_BASE_Q, tb);
+        if (pkt->pts != AV_NOPTS_VALUE)
+            pkt->pts -= shift;
+        if (pkt->dts != AV_NOPTS_VALUE)
+            pkt->dts -= shift;
+    }
+    if (pkt->dts != AV_NOPTS_VALUE) {
+        if (lastDts != AV_NOPTS_VALUE && pkt->dts <= lastDts)
+            pkt->dts = lastDts + 1;
+        if (pkt->pts != AV_NOPTS_VALUE && pkt->pts < pkt->dts)
+            pkt->pts = pkt->dts;
+        lastDts = pkt->dts;
+    }
+
+    av_packet_rescale_ts(pkt, tb, mOut->streams[outStream]->time_base);
+    pkt->stream_index = outStream;
+    int ret = av_interleaved_write_frame(mOut, pkt);
+    if (ret < 0) {
+        ERROR("write packet failed: %d\n", ret);
+        return MM_ERROR_IO;
+    }
+    return MM_ERROR_SUCCESS;
+}
+
+mm_status_t SegmentTranscoder::writeAudioUntil(int64_t dtsUs)
+{
+    AVPacket pkt;
+    while (!mAudioEOS && mLastAudioUs < dtsUs) {
+        av_init_packet(&pkt);
+        pkt.data = NULL;
+        pkt.size = 0;
+        if (av_read_frame(mIn, &pkt) < 0) {
+            mAudioEOS = true;
+            break;
+        }
+        if (pkt.stream_index != mAudioStream) {
+            av_free_packet(&pkt);
+            continue;
+        }
+        int64_t ts = pkt.dts != AV_NOPTS_VALUE ? pkt.dts : pkt.pts;
+        if (ts != AV_NOPTS_VALUE)
+            mLastAudioUs = av_rescale_q(ts, mIn->streams[mAudioStream]->time_base, AV_TIME_BASE_Q);
+        mm_status_t status = writePacket(&pkt, mAudioStream, mOutAudioStream, mLastAudioDts);
+        av_free_packet(&pkt);
+        if (status != MM_ERROR_SUCCESS)
+            return status;
+    }
+    return MM_ERROR_SUCCESS;
+}
+
+mm_status_t SegmentTranscoder::muxSegments()
+{
+    AVRational tb = mIn->streams[mVideoStream]->time_base;
+    mm_status_t status = MM_ERROR_SUCCESS;
+    bool headerWritten = false;
+
+    for (size_t i = 0; i < mSegments.size() && status == MM_ERROR_SUCCESS; i++) {
+        Segment *seg = mSegments[i];
+        {
+            MMAutoLock lock(mLock);
+            while (!seg->done && !mAbort)
+                mDoneCond.wait();
+            if (!seg->done) {
+                status = MM_ERROR_OP_FAILED;
+                break;
+            }
+        }
+        if (seg->status != MM_ERROR_SUCCESS) {
+            status = seg->status;
+            break;
+        }
+
+        if (i == 0) {
+            status = openOutput();
+            if (status != MM_ERROR_SUCCESS)
+                break;
+            headerWritten = true;
+        } else if (seg->extraData != mSegments[0]->extraData) {
+            WARNING("segment %zu: codec specific data differs from the first segment\n", i);
+        }
+
+        for (size_t j = 0; j < seg->packets.size() && status == MM_ERROR_SUCCESS; j++) {
+            AVPacket *pkt = seg->packets[j];
+            if (pkt->dts != AV_NOPTS_VALUE)
+                status = writeAudioUntil(av_rescale_q(pkt->dts, tb, AV_TIME_BASE_Q));
+            if (status == MM_ERROR_SUCCESS)
+                status = writePacket(pkt, mVideoStream, mOutVideoStream, mLastVideoDts);
+            av_packet_free(&seg->packets[j]);
+        }
+        seg->packets.clear();
+
+        MMAutoLock lock(mLock);
+        mMuxedSegments++;
+        mDoneCond.broadcast();
+    }
+
+    if (status == MM_ERROR_SUCCESS)
+        status = writeAudioUntil(INT64_MAX);
+    // the trailer releases the muxer state whatever the status, what is written stays playable
+    if (headerWritten && av_write_trailer(mOut) < 0 && status == MM_ERROR_SUCCESS)
+        status = MM_ERROR_IO;
+    closeOutput();
+    return status;
+}
+
+void SegmentTranscoder::closeOutput()
+{
+    if (!mOut)
+        return;
+    if (mOut->pb && !(mOut->oformat->flags & AVFMT_NOFILE))
+        avio_closep(&mOut->pb);
+    avformat_free_context(mOut);
+    mOut = NULL;
+}
+
+void SegmentTranscoder::closeAll()
+{
+    for (size_t i = 0; i < mSegments.size(); i++)
+        delete mSegments[i];
+    mSegments.clear();
+
+    closeOutput();
+    if (mIn)
+        avformat_close_input(&mIn);
+    if (mVideoParams)
+        avcodec_parameters_free(&mVideoParams);
+
+    mVideoStream = mAudioStream = -1;
+    mOutVideoStream = mOutAudioStream = -1;
+    mLastVideoDts = mLastAudioDts = AV_NOPTS_VALUE;
+    mLastAudioUs = INT64_MIN;
+    mAudioEOS = true;
+    mNextSegment = 0;
+    mMuxedSegments = 0;
+    mAbort = false;
+}
+
+} // end of YUNOS_MM
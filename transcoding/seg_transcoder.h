@@ -0,0 +1,147 @@
+/**
+ * Copyright (C) 2017 Alibaba Group Holding Limited. All Rights Reserved.
+ *
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __seg_transcoder_h
+#define __seg_transcoder_h
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <multimedia/mm_errors.h>
+#include <multimedia/mm_cpp_utils.h>
+#include <multimedia/mmthread.h>
+
+struct AVFormatContext;
+struct AVOutputFormat;
+struct AVCodecContext;
+struct AVCodecParameters;
+struct AVPacket;
+
+namespace YUNOS_MM {
+
+/*
+ * transcodes the video of one file on several cores:
+ * - the input is cut at key frames (from the demuxer index, or a key frame scan) into segments,
+ *   a few per thread so that threads finishing early pick up more work
+ * - every segment runs its own demux -> decode -> (scale) -> h264 encode chain; all encoders share
+ *   the settings, so the GOP structure and the codec specific data are the same in every segment
+ * - a segment decodes on into the next GOP to complete the frames displayed before its end,
+ *   it only encodes the frames in [start, end)
+ * - segments are muxed in order as soon as they are done, with the audio stream copied from
+ *   the input as one stream and interleaved by dts
+ * encoder defaults follow VideoEncodeFFmpeg (x264, preset/crf, mm.venc.preset and mm.venc.crf).
+ */
+class SegmentTranscoder {
+public:
+    struct Options {
+        Options();
+
+        // 0 keeps the input size
+        int32_t width;
+        int32_t height;
+        // 0 is one thread per online cpu
+        int32_t threads;
+        // key frame interval of the output in frames, 0 is two seconds of input frames
+        int32_t gop;
+        std::string preset;
+        int32_t crf;
+    };
+
+    SegmentTranscoder();
+    ~SegmentTranscoder();
+
+    mm_status_t transcode(const char *input, const char *output, const Options &options);
+
+    // of the last transcode()
+    int32_t segmentCount() const { return mSegmentCount; }
+
+private:
+    struct Segment {
+        Segment();
+        ~Segment();
+
+        // key frames in the index time base of the input video stream, pos -1 if unknown
+        int64_t startTs;
+        int64_t startPos;
+        int64_t endTs;    // next segment's first key frame, INT64_MAX for the last one
+        int64_t endPos;
+        std::vector<AVPacket*> packets;
+        std::string extraData;
+        mm_status_t status;
+        bool done;
+    };
+
+    class Worker : public MMThread {
+    public:
+        explicit Worker(SegmentTranscoder *owner);
+    protected:
+        virtual void main();
+    private:
+        SegmentTranscoder *mOwner;
+    };
+
+    mm_status_t openInput();
+    mm_status_t splitSegments();
+    mm_status_t openOutput();
+    mm_status_t muxSegments();
+    void closeOutput();
+    void closeAll();
+
+    int32_t nextSegment();
+    mm_status_t transcodeSegment(Segment &seg);
+    mm_status_t openEncoder(AVCodecContext *&encoder);
+    void segmentDone(Segment &seg, mm_status_t status);
+
+    mm_status_t writeAudioUntil(int64_t dtsUs);
+    mm_status_t writePacket(AVPacket *pkt, int32_t inStream, int32_t outStream, int64_t &lastDts);
+
+    std::string mInput;
+    std::string mOutput;
+    Options mOptions;
+
+    AVFormatContext *mIn;   // split and audio
+    AVFormatContext *mOut;
+    AVOutputFormat *mOutFormat; // known before the encoders open, the muxer is created later
+    int32_t mVideoStream;
+    int32_t mAudioStream;
+    int32_t mOutVideoStream;
+    int32_t mOutAudioStream;
+    int32_t mWidth;
+    int32_t mHeight;
+    int32_t mGop;
+    int64_t mLastVideoDts;
+    int64_t mLastAudioDts;
+    int64_t mLastAudioUs;
+    bool mAudioEOS;
+    AVCodecParameters *mVideoParams; // of the first encoder opened, for the output stream
+
+    std::vector<Segment*> mSegments;
+    int32_t mSegmentCount;
+    int32_t mNextSegment;
+    int32_t mMuxedSegments;
+    bool mAbort;
+    Lock mLock;
+    Condition mDoneCond;
+
+    static const char * MM_LOG_TAG;
+
+    MM_DISALLOW_COPY(SegmentTranscoder);
+};
+
+} // end of YUNOS_MM
+#endif
@@ -0,0 +1,371 @@
+/**
+ * Copyright (C) 2017 Alibaba Group Holding Limited. All Rights Reserved.
+ *
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <pthread.h>
+
+extern "C" {
+#ifndef __STDC_FORMAT_MACROS
+#define __STDC_FORMAT_MACROS
+#endif
+#ifndef __STDC_CONSTANT_MACROS
+#define __STDC_CONSTANT_MACROS
+#endif
+#ifndef __STDC_LIMIT_MACROS
+#define __STDC_LIMIT_MACROS
+#endif
+#include <inttypes.h>
+#include <stdint.h>
+#include <libavformat/avformat.h>
+}
+
+#include <multimedia/mm_debug.h>
+#include <multimedia/av_ffmpeg_helper.h>
+
+#include "stream_remuxer.h"
+
+namespace YUNOS_MM {
+
+DEFINE_LOGTAG(StreamRemuxer)
+
+static const int64_t kDefaultMaxInterleaveUs = 1000000;
+// packets of other streams held while looking for the first video key frame of a trim
+static const size_t kMaxPendingPackets = 1024;
+
+static pthread_once_t s_av_once = PTHREAD_ONCE_INIT;
+static void av_init_once()
+{
+    av_register_all();
+}
+
+StreamRemuxer::Options::Options()
+    : startUs(-1)
+    , endUs(-1)
+    , maxInterleaveUs(kDefaultMaxInterleaveUs)
+    , copySubtitle(true)
+{
+}
+
+StreamRemuxer::StreamRemuxer()
+    : mIn(NULL)
+    , mOut(NULL)
+    , mVideoStream(-1)
+    , mActiveStreams(0)
+    , mOffsetUs(INT64_MIN)
+    , mPackets(0)
+    , mBytes(0)
+    , mDurationUs(0)
+    , mReadBytes(0)
+{
+    pthread_once(&s_av_once, av_init_once);
+}
+
+StreamRemuxer::~StreamRemuxer()
+{
+    closeAll();
+}
+
+mm_status_t StreamRemuxer::remux(const char *input, const char *output, const Options &options)
+{
+    if (!input || !output)
+        return MM_ERROR_INVALID_PARAM;
+    if (options.startUs >= 0 && options.endUs >= 0 && options.endUs <= options.startUs)
+        return MM_ERROR_INVALID_PARAM;
+
+    closeAll();
+    mOptions = options;
+    mPackets = 0;
+    mBytes = 0;
+    mDurationUs = 0;
+    mReadBytes = 0;
+
+    int64_t beginUs = getTimeUs();
+    mm_status_t status = openInput(input);
+    if (status == MM_ERROR_SUCCESS)
+        status = openOutput(output);
+    if (status == MM_ERROR_SUCCESS)
+        status = copyPackets();
+    if (status == MM_ERROR_SUCCESS && av_write_trailer(mOut) < 0) {
+        ERROR("%s: write trailer failed\n", output);
+        status = MM_ERROR_IO;
+    }
+
+    int64_t costUs = getTimeUs() - beginUs;
+    INFO("%s -> %s: status %d, %" PRId64 " packets, %" PRId64 " bytes (%" PRId64 " read), %" PRId64 " ms of media in %" PRId64 " ms\n",
+        input, output, status, mPackets, mBytes, mReadBytes, mDurationUs / 1000, costUs / 1000);
+    closeAll();
+    return status;
+}
+
+mm_status_t StreamRemuxer::openInput(const char *input)
+{
+    int ret = avformat_open_input(&mIn, input, NULL, NULL);
+    if (ret < 0) {
+        ERROR("%s: open failed: %d\n", input, ret);
+        mIn = NULL;
+        return MM_ERROR_IO;
+    }
+    if (avformat_find_stream_info(mIn, NULL) < 0) {
+        ERROR("%s: find stream info failed\n", input);
+        return MM_ERROR_UNSUPPORTED;
+    }
+
+    mVideoStream = av_find_best_stream(mIn, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
+    if (mVideoStream < 0)
+        mVideoStream = -1;
+    mStreams.resize(mIn->nb_streams);
+    return MM_ERROR_SUCCESS;
+}
+
+mm_status_t StreamRemuxer::openOutput(const char *output)
+{
+    const char *format = mOptions.format.empty() ? NULL : mOptions.format.c_str();
+    int ret = avformat_alloc_output_context2(&mOut, NULL, format, output);
+    if (ret < 0 || !mOut)
+        ret = avformat_alloc_output_context2(&mOut, NULL, "mp4", output);
+    if (ret < 0 || !mOut) {
+        ERROR("%s: no muxer\n", output);
+        return MM_ERROR_UNSUPPORTED;
+    }
+
+    // one video stream (the others are thumbnails or alternates), every audio stream
+    for (unsigned int i = 0; i < mIn->nb_streams; i++) {
+        AVStream *in = mIn->streams[i];
+        AVCodecParameters *par = in->codecpar;
+        bool copy = false;
+        if (par->codec_type == AVMEDIA_TYPE_VIDEO)
+            copy = (int32_t)i == mVideoStream && !(in->disposition & AV_DISPOSITION_ATTACHED_PIC);
+        else if (par->codec_type == AVMEDIA_TYPE_AUDIO)
+            copy = true;
+        else if (par->codec_type == AVMEDIA_TYPE_SUBTITLE)
+            copy = mOptions.copySubtitle;
+
+        if (copy && avformat_query_codec(mOut->oformat, par->codec_id, FF_COMPLIANCE_NORMAL) != 1) {
+            WARNING("stream %u: codec %d not supported by %s, dropped\n", i, par->codec_id, mOut->oformat->name);
+            copy = false;
+        }
+        if (!copy) {
+            in->discard = AVDISCARD_ALL;
+            if ((int32_t)i == mVideoStream)
+                mVideoStream = -1;
+            continue;
+        }
+
+        AVStream *out = avformat_new_stream(mOut, NULL);
+        if (!out || avcodec_parameters_copy(out->codecpar, par) < 0)
+            return MM_ERROR_NO_MEM;
+        // a tag of the input container may mean something else, or nothing, in the output one
+        if (!mOut->oformat->codec_tag ||
+            av_codec_get_id(mOut->oformat->codec_tag, par->codec_tag) != par->codec_id)
+            out->codecpar->codec_tag = 0;
+        out->time_base = in->time_base;
+        out->disposition = in->disposition;
+        av_dict_copy(&out->metadata, in->metadata, 0);
+        mStreams[i].out = out->index;
+        // a sparse stream may have no packet past the end, it doesn't keep the reading going
+        if (par->codec_type != AVMEDIA_TYPE_SUBTITLE) {
+            mStreams[i].active = true;
+            mActiveStreams++;
+        }
+    }
+    if (!mActiveStreams) {
+        for (size_t i = 0; i < mStreams.size(); i++) {
+            if (mStreams[i].out >= 0) {
+                mStreams[i].active = true;
+                mActiveStreams++;
+            }
+        }
+    }
+    if (!mActiveStreams) {
+        ERROR("%s: nothing to copy\n", output);
+        return MM_ERROR_UNSUPPORTED;
+    }
+
+    av_dict_copy(&mOut->metadata, mIn->metadata, 0);
+    mOut->max_interleave_delta = mOptions.maxInterleaveUs;
+    mOut->avoid_negative_ts = AVFMT_AVOID_NEG_TS_MAKE_ZERO;
+
+    if (!(mOut->oformat->flags & AVFMT_NOFILE)) {
+        ret = avio_open(&mOut->pb, output, AVIO_FLAG_WRITE);
+        if (ret < 0) {
+            ERROR("%s: open failed: %d\n", output, ret);
+            return MM_ERROR_IO;
+        }
+    }
+    ret = avformat_write_header(mOut, NULL);
+    if (ret < 0) {
+        ERROR("%s: write header failed: %d\n", output, ret);
+        return MM_ERROR_IO;
+    }
+    return MM_ERROR_SUCCESS;
+}
+
+mm_status_t StreamRemuxer::copyPackets()
+{
+    int64_t fileStartUs = mIn->start_time != AV_NOPTS_VALUE ? mIn->start_time : 0;
+    int64_t startUs = INT64_MIN;
+    int64_t endUs = mOptions.endUs >= 0 ? fileStartUs + mOptions.endUs : INT64_MAX;
+    std::vector<AVPacket*> pending;
+    mm_status_t status = MM_ERROR_SUCCESS;
+
+    if (mOptions.startUs > 0) {
+        startUs = fileStartUs + mOptions.startUs;
+        if (av_seek_frame(mIn, -1, startUs, AVSEEK_FLAG_BACKWARD) < 0)
+            WARNING("seek to %" PRId64 " failed, trim from the start\n", startUs);
+        // without video the cut is where asked, with video at the key frame read first
+        if (mVideoStream < 0)
+            mOffsetUs = startUs;
+    } else {
+        mOffsetUs = fileStartUs;
+    }
+
+    AVPacket pkt;
+    while (mActiveStreams > 0 && status == MM_ERROR_SUCCESS) {
+        av_init_packet(&pkt);
+        pkt.data = NULL;
+        pkt.size = 0;
+        int ret = av_read_frame(mIn, &pkt);
+        if (ret < 0) {
+            if (ret != AVERROR_EOF && !avio_feof(mIn->pb))
+                WARNING("read error %d, end here\n", ret);
+            break;
+        }
+
+        StreamMap &m = mStreams[pkt.stream_index];
+        if (m.out < 0 || m.done) {
+            av_free_packet(&pkt);
+            continue;
+        }
+
+        int64_t ts = pkt.dts != AV_NOPTS_VALUE ? pkt.dts : pkt.pts;
+        int64_t tsUs = ts != AV_NOPTS_VALUE ?
+            av_rescale_q(ts, mIn->streams[pkt.stream_index]->time_base, AV_TIME_BASE_Q) : INT64_MIN;
+
+        if (tsUs != INT64_MIN && tsUs > endUs) {
+            av_free_packet(&pkt);
+            // the streams are interleaved within maxInterleaveUs, nothing to copy comes after
+            if (tsUs - endUs > mOptions.maxInterleaveUs) {
+                DEBUG("stream %d at %" PRId64 " ms, past the end\n", pkt.stream_index, (tsUs - fileStartUs) / 1000);
+                break;
+            }
+            m.done = true;
+            if (m.active)
+                mActiveStreams--;
+            continue;
+        }
+
+        if (mOffsetUs == INT64_MIN) {
+            if (pkt.stream_index != mVideoStream || !(pkt.flags & AV_PKT_FLAG_KEY) || tsUs == INT64_MIN) {
+                if (pkt.stream_index != mVideoStream && pending.size() < kMaxPendingPackets) {
+                    AVPacket *held = av_packet_clone(&pkt);
+                    if (held)
+                        pending.push_back(held);
+                }
+                av_free_packet(&pkt);
+                continue;
+            }
+            mOffsetUs = tsUs;
+            DEBUG("trim starts at the key frame of %" PRId64 " ms\n", (mOffsetUs - fileStartUs) / 1000);
+            for (size_t i = 0; i < pending.size() && status == MM_ERROR_SUCCESS; i++) {
+                AVPacket *held = pending[i];
+                int64_t heldTs = held->pts != AV_NOPTS_VALUE ? held->pts : held->dts;
+                if (heldTs != AV_NOPTS_VALUE &&
+                    av_rescale_q(heldTs, mIn->streams[held->stream_index]->time_base, AV_TIME_BASE_Q) >= mOffsetUs)
+                    status = writePacket(held);
+                av_packet_free(&pending[i]);
+            }
+            pending.clear();
+            if (status != MM_ERROR_SUCCESS) {
+                av_free_packet(&pkt);
+                break;
+            }
+        } else if (startUs != INT64_MIN && pkt.stream_index != mVideoStream) {
+            int64_t pts = pkt.pts != AV_NOPTS_VALUE ? pkt.pts : ts;
+            if (pts == AV_NOPTS_VALUE ||
+                av_rescale_q(pts, mIn->streams[pkt.stream_index]->time_base, AV_TIME_BASE_Q) < mOffsetUs) {
+                av_free_packet(&pkt);
+                continue;
+            }
+        }
+
+        status = writePacket(&pkt);
+        av_free_packet(&pkt);
+    }
+
+    for (size_t i = 0; i < pending.size(); i++)
+        av_packet_free(&pending[i]);
+    if (mIn->pb)
+        mReadBytes = avio_tell(mIn->pb);
+    return status;
+}
+
+mm_status_t StreamRemuxer::writePacket(AVPacket *pkt)
+{
+    StreamMap &m = mStreams[pkt->stream_index];
+    AVStream *in = mIn->streams[pkt->stream_index];
+    AVStream *out = mOut->streams[m.out];
+
+    int64_t shift = av_rescale_q(mOffsetUs, AV_TIME_BASE_Q, in->time_base);
+    if (pkt->pts != AV_NOPTS_VALUE)
+        pkt->pts -= shift;
+    if (pkt->dts != AV_NOPTS_VALUE)
+        pkt->dts -= shift;
+    av_packet_rescale_ts(pkt, in->time_base, out->time_base);
+
+    if (pkt->dts != AV_NOPTS_VALUE) {
+        if (m.lastDts != INT64_MIN && pkt->dts <= m.lastDts) {
+            DEBUG("stream %d: dts %" PRId64 " after %" PRId64 "\n", pkt->stream_index, pkt->dts, m.lastDts);
+            pkt->dts = m.lastDts + 1;
+        }
+        if (pkt->pts != AV_NOPTS_VALUE && pkt->pts < pkt->dts)
+            pkt->pts = pkt->dts;
+        m.lastDts = pkt->dts;
+    }
+    if (pkt->pts != AV_NOPTS_VALUE) {
+        int64_t endUs = av_rescale_q(pkt->pts + pkt->duration, out->time_base, AV_TIME_BASE_Q);
+        if (endUs > mDurationUs)
+            mDurationUs = endUs;
+    }
+
+    mPackets++;
+    mBytes += pkt->size;
+    pkt->pos = -1;
+    pkt->stream_index = m.out;
+    int ret = av_interleaved_write_frame(mOut, pkt);
+    if (ret < 0) {
+        ERROR("write packet failed: %d\n", ret);
+        return MM_ERROR_IO;
+    }
+    return MM_ERROR_SUCCESS;
+}
+
+void StreamRemuxer::closeAll()
+{
+    if (mOut) {
+        if (mOut->pb && !(mOut->oformat->flags & AVFMT_NOFILE))
+            avio_closep(&mOut->pb);
+        avformat_free_context(mOut);
+        mOut = NULL;
+    }
+    if (mIn)
+        avformat_close_input(&mIn);
+    mStreams.clear();
+    mVideoStream = -1;
+    mActiveStreams = 0;
+    mOffsetUs = INT64_MIN;
+}
+
+} // end of YUNOS_MM
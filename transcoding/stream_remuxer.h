@@ -0,0 +1,102 @@
+/**
+ * Copyright (C) 2017 Alibaba Group Holding Limited. All Rights Reserved.
+ *
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __stream_remuxer_h
+#define __stream_remuxer_h
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <multimedia/mm_errors.h>
+#include <multimedia/mm_cpp_utils.h>
+
+struct AVFormatContext;
+struct AVPacket;
+
+namespace YUNOS_MM {
+
+/*
+ * stream copy of a file into another container, in the calling thread:
+ * read -> retime -> write, the packets go straight from the input to the output format context.
+ * the muxer interleaves within Options::maxInterleaveUs, which bounds the memory used; the input
+ * is read in file order, already interleaved for any sane file.
+ * trimming starts at the video key frame at or before startUs (stream copy can't start elsewhere),
+ * audio read before that key frame is held (up to a limit) and written from its time on; a stream
+ * ends with its first packet past endUs. reading stops when every audio and video stream has
+ * ended, sparse streams (subtitles) don't keep it going, or at endUs + maxInterleaveUs.
+ * the remux pipeline (demuxer -> fission -> muxer -> file sink) does the same with four threads
+ * and two queues per stream.
+ */
+class StreamRemuxer {
+public:
+    struct Options {
+        Options();
+
+        int64_t startUs;    // -1 from the beginning
+        int64_t endUs;      // -1 to the end
+        std::string format; // empty guesses it from the output name, mp4 if unknown
+        int64_t maxInterleaveUs;
+        bool copySubtitle;
+    };
+
+    StreamRemuxer();
+    ~StreamRemuxer();
+
+    mm_status_t remux(const char *input, const char *output, const Options &options);
+
+    // of the last remux()
+    int64_t packets() const { return mPackets; }
+    int64_t bytes() const { return mBytes; }
+    int64_t durationUs() const { return mDurationUs; }
+    // input position the reading stopped at, a trim reads little more than its range
+    int64_t readBytes() const { return mReadBytes; }
+
+private:
+    struct StreamMap {
+        StreamMap() : out(-1), lastDts(INT64_MIN), done(false), active(false) {}
+        int32_t out;        // -1 not copied
+        int64_t lastDts;    // output time base
+        bool done;
+        bool active;        // counted in mActiveStreams
+    };
+
+    mm_status_t openInput(const char *input);
+    mm_status_t openOutput(const char *output);
+    mm_status_t copyPackets();
+    mm_status_t writePacket(AVPacket *pkt);
+    void closeAll();
+
+    Options mOptions;
+    AVFormatContext *mIn;
+    AVFormatContext *mOut;
+    std::vector<StreamMap> mStreams;
+    int32_t mVideoStream;
+    int32_t mActiveStreams; // audio and video streams not done, the copied ones without them
+    int64_t mOffsetUs;      // subtracted from every timestamp, INT64_MIN until the first packet
+    int64_t mPackets;
+    int64_t mBytes;
+    int64_t mDurationUs;
+    int64_t mReadBytes;
+
+    static const char * MM_LOG_TAG;
+
+    MM_DISALLOW_COPY(StreamRemuxer);
+};
+
+} // end of YUNOS_MM
+#endif
@@ -26,12 +26,15 @@ include $(MM_ROOT_PATH)/test/gtest_common.mk
 LOCAL_SRC_FILES:= media_trans.cc
 LOCAL_SRC_FILES += remux_pipeline.cc
 LOCAL_SRC_FILES += tr_pipeline.cc
+LOCAL_SRC_FILES += seg_transcoder.cc
+LOCAL_SRC_FILES += stream_remuxer.cc
 
 LOCAL_C_INCLUDES += \
     $(MM_INCLUDE) \
     $(MM_COW_INCLUDE) \
     $(MM_ROOT_PATH)/mediaplayer/include \
     $(base-includes)                    \
+    $(libav-includes)                   \
     $(MM_WAKELOCKER_PATH)
 
 LOCAL_SHARED_LIBRARIES += libmmbase libmediaplayer libmmwakelocker libcowbase libcowplayer
@@ -41,6 +44,7 @@ LOCAL_LDFLAGS += -lstdc++ -lpthread
 REQUIRE_WPC = 1
 REQUIRE_SURFACE = 1
 REQUIRE_PAGEWINDOW = 1
+REQUIRE_LIBAV = 1
 include $(MM_ROOT_PATH)/base/build/xmake_req_libs.mk
 
 LOCAL_MODULE:= media-trans